@@ -0,0 +1,96 @@
+#include "LatencyHistogram.h"
+
+
+namespace Implementation
+{
+	CLatencyHistogram::CLatencyHistogram()
+		: m_vecCounts((MAX_VALUE_BITS - SUB_BUCKET_BITS + 2) << SUB_BUCKET_BITS, 0)
+	{
+
+	}
+
+	void CLatencyHistogram::Record(unsigned long long ullNs)
+	{
+		const unsigned long long ullLimit = (1ULL << MAX_VALUE_BITS) - 1;
+		if (ullNs > ullLimit)
+			ullNs = ullLimit;
+
+		++m_vecCounts[IndexOf(ullNs)];
+		if (0 == m_ullCount || ullNs < m_ullMin)
+			m_ullMin = ullNs;
+		if (ullNs > m_ullMax)
+			m_ullMax = ullNs;
+		++m_ullCount;
+		m_dSum += static_cast<double>(ullNs);
+	}
+
+	void CLatencyHistogram::Merge(const CLatencyHistogram& other)
+	{
+		if (0 == other.m_ullCount)
+			return;
+
+		for (size_t nIndex = 0; nIndex < m_vecCounts.size(); ++nIndex)
+		{
+			m_vecCounts[nIndex] += other.m_vecCounts[nIndex];
+		}
+		if (0 == m_ullCount || other.m_ullMin < m_ullMin)
+			m_ullMin = other.m_ullMin;
+		if (other.m_ullMax > m_ullMax)
+			m_ullMax = other.m_ullMax;
+		m_ullCount += other.m_ullCount;
+		m_dSum += other.m_dSum;
+	}
+
+	double CLatencyHistogram::GetMean() const
+	{
+		return m_ullCount > 0 ? m_dSum / static_cast<double>(m_ullCount) : 0;
+	}
+
+	unsigned long long CLatencyHistogram::GetValueAtPercentile(double dPercentile) const
+	{
+		if (0 == m_ullCount)
+			return 0;
+
+		unsigned long long ullRank = static_cast<unsigned long long>(dPercentile / 100.0 * static_cast<double>(m_ullCount) + 0.5);
+		if (ullRank < 1)
+			ullRank = 1;
+		unsigned long long ullSeen = 0;
+		for (size_t nIndex = 0; nIndex < m_vecCounts.size(); ++nIndex)
+		{
+			ullSeen += m_vecCounts[nIndex];
+			if (ullSeen >= ullRank)
+			{
+				unsigned long long ullValue = HighestEquivalent(nIndex);
+				return ullValue < m_ullMax ? ullValue : m_ullMax;
+			}
+		}
+
+		return m_ullMax;
+	}
+
+	size_t CLatencyHistogram::IndexOf(unsigned long long ullValue)
+	{
+		if (ullValue < (1ULL << SUB_BUCKET_BITS))
+			return static_cast<size_t>(ullValue);
+
+		// Shift the value down until it has SUB_BUCKET_BITS + 1 significant bits; the top one is
+		// implied by the power of two, the others pick the bucket within it.
+		unsigned int uShift = 0;
+		while ((ullValue >> uShift) >= (2ULL << SUB_BUCKET_BITS))
+			++uShift;
+		unsigned long long ullSubBucket = (ullValue >> uShift) - (1ULL << SUB_BUCKET_BITS);
+
+		return (static_cast<size_t>(uShift + 1) << SUB_BUCKET_BITS) + static_cast<size_t>(ullSubBucket);
+	}
+
+	unsigned long long CLatencyHistogram::HighestEquivalent(size_t nIndex)
+	{
+		if (nIndex < (1U << SUB_BUCKET_BITS))
+			return nIndex;
+
+		unsigned int uShift = static_cast<unsigned int>(nIndex >> SUB_BUCKET_BITS) - 1;
+		unsigned long long ullSubBucket = (nIndex & ((1U << SUB_BUCKET_BITS) - 1)) + (1ULL << SUB_BUCKET_BITS);
+
+		return ((ullSubBucket + 1) << uShift) - 1;
+	}
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+
+namespace Implementation
+{
+	// Latencies in nanoseconds, counted HDR style: values below 2^SUB_BUCKET_BITS have a bucket of
+	// their own, larger ones fall in one of 2^SUB_BUCKET_BITS buckets per power of two. Percentiles
+	// are therefore exact to better than 1%, from a nanosecond up to about 18 minutes, in a fixed
+	// amount of memory, and recording is a couple of shifts and an increment.
+	class CLatencyHistogram
+	{
+	public:
+		CLatencyHistogram();
+
+		void Record(unsigned long long ullNs);
+		void Merge(const CLatencyHistogram& other);
+
+		unsigned long long GetCount() const { return m_ullCount; }
+		unsigned long long GetMin() const { return m_ullCount > 0 ? m_ullMin : 0; }
+		unsigned long long GetMax() const { return m_ullMax; }
+		double GetMean() const;
+		// The highest value equivalent to the one at dPercentile (0-100) of the recorded values.
+		unsigned long long GetValueAtPercentile(double dPercentile) const;
+
+	private:
+		static constexpr unsigned int SUB_BUCKET_BITS = 7;
+		static constexpr unsigned int MAX_VALUE_BITS = 40;
+
+		static size_t IndexOf(unsigned long long ullValue);
+		static unsigned long long HighestEquivalent(size_t nIndex);
+
+		std::vector<unsigned long long> m_vecCounts;
+		unsigned long long m_ullCount{ 0 };
+		unsigned long long m_ullMin{ 0 };
+		unsigned long long m_ullMax{ 0 };
+		double m_dSum{ 0 };
+	};
+}
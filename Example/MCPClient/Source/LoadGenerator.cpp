@@ -0,0 +1,192 @@
+#include "LoadGenerator.h"
+#include <Public/PublicDef.h>
+#include <json/json.h>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+
+namespace Implementation
+{
+	CLoadGenerator::CLoadGenerator(CLoadTarget& target, const LoadOptions& options)
+		: m_target(target)
+		, m_options(options)
+	{
+		for (auto nWeight : m_options.arrWeights)
+		{
+			m_nTotalWeight += nWeight;
+		}
+		if (0 == m_options.nConcurrency)
+			m_options.nConcurrency = 1;
+		m_strCallParams = "{\"name\":" + Json::valueToQuotedString(m_options.strTool.c_str())
+			+ ",\"arguments\":" + m_options.strArguments + "}";
+	}
+
+	int CLoadGenerator::Run(LoadReport& report)
+	{
+		if (0 == m_nTotalWeight)
+			return MCP::ERRNO_INVALID_PARAMS;
+
+		auto fnSeconds = [](double dSeconds)
+		{
+			return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(dSeconds));
+		};
+		m_tpStart = Clock::now();
+		m_tpMeasure = m_tpStart + fnSeconds(m_options.dWarmupS);
+		m_tpEnd = m_tpMeasure + fnSeconds(m_options.dDurationS);
+
+		// Every worker records into a report of its own; they are merged once all are done.
+		std::vector<LoadReport> vecReports(m_options.nConcurrency);
+		std::vector<std::thread> vecWorkers;
+		for (auto& workerReport : vecReports)
+		{
+			vecWorkers.emplace_back(&CLoadGenerator::Work, this, std::ref(workerReport));
+		}
+		for (auto& thrWorker : vecWorkers)
+		{
+			thrWorker.join();
+		}
+
+		for (auto& workerReport : vecReports)
+		{
+			for (int iOp = 0; iOp < LoadOp_Count; ++iOp)
+			{
+				report.arrLatency[iOp].Merge(workerReport.arrLatency[iOp]);
+				report.arrErrors[iOp] += workerReport.arrErrors[iOp];
+			}
+		}
+		report.dDurationS = m_options.dDurationS;
+
+		return MCP::ERRNO_OK;
+	}
+
+	void CLoadGenerator::Work(LoadReport& report)
+	{
+		unsigned long long ullSeed = 0x9E3779B97F4A7C15ULL ^ std::hash<std::thread::id>()(std::this_thread::get_id());
+		bool bOpenLoop = m_options.dRate > 0;
+		for (;;)
+		{
+			Clock::time_point tpDue = Clock::now();
+			if (bOpenLoop)
+			{
+				unsigned long long ullTicket = m_ullNextTicket++;
+				tpDue = m_tpStart + std::chrono::duration_cast<Clock::duration>(
+					std::chrono::duration<double>(static_cast<double>(ullTicket) / m_options.dRate));
+				if (tpDue >= m_tpEnd)
+					break;
+				std::this_thread::sleep_until(tpDue);
+			}
+			else if (tpDue >= m_tpEnd)
+			{
+				break;
+			}
+
+			LoadOp eOp = PickOp(ullSeed);
+			int iErrCode = RunOp(eOp);
+			if (tpDue < m_tpMeasure)
+				continue;
+			if (MCP::ERRNO_OK != iErrCode)
+			{
+				++report.arrErrors[eOp];
+				continue;
+			}
+			auto nsLatency = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - tpDue);
+			report.arrLatency[eOp].Record(static_cast<unsigned long long>(nsLatency.count()));
+		}
+	}
+
+	LoadOp CLoadGenerator::PickOp(unsigned long long& ullSeed) const
+	{
+		// xorshift64*: cheap, and good enough to draw from the mix.
+		ullSeed ^= ullSeed >> 12;
+		ullSeed ^= ullSeed << 25;
+		ullSeed ^= ullSeed >> 27;
+		unsigned int nPick = static_cast<unsigned int>((ullSeed * 0x2545F4914F6CDD1DULL) >> 32) % m_nTotalWeight;
+		for (int iOp = 0; iOp < LoadOp_Count; ++iOp)
+		{
+			if (nPick < m_options.arrWeights[iOp])
+				return static_cast<LoadOp>(iOp);
+			nPick -= m_options.arrWeights[iOp];
+		}
+
+		return LoadOp_Ping;
+	}
+
+	int CLoadGenerator::RunOp(LoadOp eOp)
+	{
+		long long llId = m_llNextId++;
+		switch (eOp)
+		{
+			case LoadOp_CallTool:
+				return m_target.Call(BuildRequest(MCP::METHOD_TOOLS_CALL, llId, m_strCallParams), llId);
+			case LoadOp_ListTools:
+				return m_target.Call(BuildRequest(MCP::METHOD_TOOLS_LIST, llId, ""), llId);
+			case LoadOp_Ping:
+				return m_target.Call(BuildRequest(MCP::METHOD_PING, llId, ""), llId);
+			case LoadOp_Cancel:
+			{
+				int iErrCode = m_target.Abandon(BuildRequest(MCP::METHOD_TOOLS_CALL, llId, m_strCallParams), llId);
+				if (MCP::ERRNO_OK != iErrCode)
+					return iErrCode;
+				std::string strCancel = std::string(R"({"jsonrpc":"2.0","method":")") + MCP::METHOD_NOTIFICATION_CANCELLED
+					+ R"(","params":{"requestId":)" + std::to_string(llId) + R"(,"reason":"load test"}})";
+				iErrCode = m_target.Notify(strCancel);
+				if (MCP::ERRNO_OK != iErrCode)
+					return iErrCode;
+				long long llPingId = m_llNextId++;
+				return m_target.Call(BuildRequest(MCP::METHOD_PING, llPingId, ""), llPingId);
+			}
+			default: break;
+		}
+
+		return MCP::ERRNO_INTERNAL_ERROR;
+	}
+
+	std::string CLoadGenerator::BuildRequest(const char* lpcszMethod, long long llId, const std::string& strParams) const
+	{
+		std::string strRequest = R"({"jsonrpc":"2.0","id":)" + std::to_string(llId) + R"(,"method":")" + lpcszMethod + "\"";
+		if (!strParams.empty())
+			strRequest += ",\"params\":" + strParams;
+		strRequest += "}";
+
+		return strRequest;
+	}
+
+	const char* CLoadGenerator::GetOpName(LoadOp eOp)
+	{
+		switch (eOp)
+		{
+			case LoadOp_CallTool: return "call";
+			case LoadOp_ListTools: return "list";
+			case LoadOp_Ping: return "ping";
+			case LoadOp_Cancel: return "cancel";
+			default: return "?";
+		}
+	}
+
+	void CLoadGenerator::PrintReport(const LoadReport& report)
+	{
+		auto fnUs = [](unsigned long long ullNs) { return static_cast<double>(ullNs) / 1000.0; };
+		CLatencyHistogram total;
+		unsigned long long ullErrors = 0;
+
+		printf("%-8s %10s %8s %10s %10s %10s %10s %10s %10s\n",
+			"op", "count", "errors", "req/s", "mean(us)", "p50(us)", "p99(us)", "p999(us)", "max(us)");
+		auto fnRow = [&](const char* lpcszName, const CLatencyHistogram& latency, unsigned long long ullOpErrors)
+		{
+			printf("%-8s %10llu %8llu %10.0f %10.1f %10.1f %10.1f %10.1f %10.1f\n", lpcszName,
+				latency.GetCount(), ullOpErrors, static_cast<double>(latency.GetCount()) / report.dDurationS,
+				latency.GetMean() / 1000.0, fnUs(latency.GetValueAtPercentile(50)), fnUs(latency.GetValueAtPercentile(99)),
+				fnUs(latency.GetValueAtPercentile(99.9)), fnUs(latency.GetMax()));
+		};
+		for (int iOp = 0; iOp < LoadOp_Count; ++iOp)
+		{
+			if (0 == report.arrLatency[iOp].GetCount() && 0 == report.arrErrors[iOp])
+				continue;
+			fnRow(GetOpName(static_cast<LoadOp>(iOp)), report.arrLatency[iOp], report.arrErrors[iOp]);
+			total.Merge(report.arrLatency[iOp]);
+			ullErrors += report.arrErrors[iOp];
+		}
+		fnRow("total", total, ullErrors);
+	}
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <string>
+#include <atomic>
+#include <chrono>
+#include "LatencyHistogram.h"
+#include "LoadTarget.h"
+
+
+namespace Implementation
+{
+	enum LoadOp
+	{
+		LoadOp_CallTool,
+		LoadOp_ListTools,
+		LoadOp_Ping,
+		// tools/call, cancelled right away, then a ping: measures how fast a cancellation settles.
+		LoadOp_Cancel,
+		LoadOp_Count,
+	};
+
+	struct LoadOptions
+	{
+		std::string strTool{ "echo" };
+		std::string strArguments{ R"({"input":"hello"})" };
+		// Relative weights of the operations in the mix.
+		unsigned int arrWeights[LoadOp_Count]{ 100, 0, 0, 0 };
+		// Workers, i.e. requests in flight at most.
+		size_t nConcurrency{ 1 };
+		// Requests per second started at a fixed rate (open loop); 0 runs the workers back to back
+		// (closed loop).
+		double dRate{ 0 };
+		double dWarmupS{ 1 };
+		double dDurationS{ 10 };
+	};
+
+	struct LoadReport
+	{
+		CLatencyHistogram arrLatency[LoadOp_Count];
+		unsigned long long arrErrors[LoadOp_Count]{};
+		double dDurationS{ 0 };
+	};
+
+	// Drives a mix of operations against the target and records their latencies. In open loop mode
+	// a latency is counted from the moment the request was due, not from when a worker got to send
+	// it, so that a stalled server is not hidden by the requests it kept from being sent
+	// (coordinated omission).
+	class CLoadGenerator
+	{
+	public:
+		CLoadGenerator(CLoadTarget& target, const LoadOptions& options);
+
+		int Run(LoadReport& report);
+
+		static const char* GetOpName(LoadOp eOp);
+		static void PrintReport(const LoadReport& report);
+
+	private:
+		using Clock = std::chrono::steady_clock;
+
+		void Work(LoadReport& report);
+		LoadOp PickOp(unsigned long long& ullSeed) const;
+		int RunOp(LoadOp eOp);
+		std::string BuildRequest(const char* lpcszMethod, long long llId, const std::string& strParams) const;
+
+		CLoadTarget& m_target;
+		LoadOptions m_options;
+		unsigned int m_nTotalWeight{ 0 };
+		std::string m_strCallParams;
+		Clock::time_point m_tpStart;
+		Clock::time_point m_tpMeasure;
+		Clock::time_point m_tpEnd;
+		std::atomic<unsigned long long> m_ullNextTicket{ 0 };
+		// Request ids; 0 was taken by initialize.
+		std::atomic<long long> m_llNextId{ 1 };
+	};
+}
@@ -0,0 +1,731 @@
+#include "LoadTarget.h"
+#include <Public/PublicDef.h>
+#include <Message/JsonParser.h>
+#include <Transport/LocalTransport.h>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <fcntl.h>
+#include <netdb.h>
+#include <signal.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+
+namespace Implementation
+{
+	static const char* INITIALIZE_REQUEST = R"({"jsonrpc":"2.0","id":0,"method":"initialize","params":{"protocolVersion":"2025-06-18",)"
+		R"("capabilities":{},"clientInfo":{"name":"MCPClient","version":"1.0.0"}}})";
+	static const char* INITIALIZED_NOTIFICATION = R"({"jsonrpc":"2.0","method":"notifications/initialized"})";
+
+	// Runs strCommand through the shell, which execs it so that the pid is the server's. Without
+	// pipes the child gets /dev/null as stdin and stdout; its stderr always goes to /dev/null so
+	// that server logs do not mix with the report.
+	static pid_t SpawnProcess(const std::string& strCommand, int* pFdWrite, int* pFdRead)
+	{
+		int fdsIn[2] = { -1, -1 };
+		int fdsOut[2] = { -1, -1 };
+		if (pFdWrite && (0 != pipe(fdsIn) || 0 != pipe(fdsOut)))
+			return -1;
+
+		pid_t pid = fork();
+		if (0 == pid)
+		{
+			int fdNull = open("/dev/null", O_RDWR);
+			dup2(pFdWrite ? fdsIn[0] : fdNull, STDIN_FILENO);
+			dup2(pFdWrite ? fdsOut[1] : fdNull, STDOUT_FILENO);
+			dup2(fdNull, STDERR_FILENO);
+			if (pFdWrite)
+			{
+				close(fdsIn[0]);
+				close(fdsIn[1]);
+				close(fdsOut[0]);
+				close(fdsOut[1]);
+			}
+			std::string strExec = "exec " + strCommand;
+			execl("/bin/sh", "sh", "-c", strExec.c_str(), static_cast<char*>(nullptr));
+			_exit(127);
+		}
+		if (pFdWrite)
+		{
+			close(fdsIn[0]);
+			close(fdsOut[1]);
+			if (pid < 0)
+			{
+				close(fdsIn[1]);
+				close(fdsOut[0]);
+				return -1;
+			}
+			fcntl(fdsIn[1], F_SETFD, FD_CLOEXEC);
+			fcntl(fdsOut[0], F_SETFD, FD_CLOEXEC);
+			*pFdWrite = fdsIn[1];
+			*pFdRead = fdsOut[0];
+		}
+
+		return pid;
+	}
+
+	// Gives the child a moment to exit on its own, then terminates it.
+	static void ReapProcess(pid_t pid)
+	{
+		if (pid <= 0)
+			return;
+
+		for (int i = 0; i < 40; ++i)
+		{
+			if (waitpid(pid, nullptr, WNOHANG) == pid)
+				return;
+			if (10 == i)
+				kill(pid, SIGTERM);
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		}
+		kill(pid, SIGKILL);
+		waitpid(pid, nullptr, 0);
+	}
+
+	static bool WriteAll(int iFd, const char* pData, size_t nLength)
+	{
+		while (nLength > 0)
+		{
+			ssize_t nWritten = write(iFd, pData, nLength);
+			if (nWritten < 0)
+				return false;
+			pData += nWritten;
+			nLength -= static_cast<size_t>(nWritten);
+		}
+
+		return true;
+	}
+
+	// The id of a response and what it carries: ERRNO_OK for a result, otherwise the error code.
+	static bool ParseResponse(MCP::CMCPJsonParser& parser, const char* pBegin, const char* pEnd, long long& llId, int& iResult)
+	{
+		Json::Value jMsg;
+		if (!parser.Parse(pBegin, pEnd, jMsg) || !jMsg.isObject())
+			return false;
+		auto& jId = jMsg[MCP::MSG_KEY_ID];
+		if (!jId.isIntegral() || jMsg.isMember(MCP::MSG_KEY_METHOD))
+			return false;
+
+		llId = jId.asInt64();
+		iResult = MCP::ERRNO_OK;
+		if (jMsg.isMember(MCP::MSG_KEY_ERROR))
+		{
+			auto& jCode = jMsg[MCP::MSG_KEY_ERROR][MCP::MSG_KEY_CODE];
+			iResult = jCode.isInt() && 0 != jCode.asInt() ? jCode.asInt() : MCP::ERRNO_INTERNAL_ERROR;
+		}
+
+		return true;
+	}
+
+	CStdioLoadTarget::CStdioLoadTarget(const std::string& strCommand)
+		: m_strCommand(strCommand)
+	{
+
+	}
+
+	CStdioLoadTarget::~CStdioLoadTarget()
+	{
+		Stop();
+	}
+
+	int CStdioLoadTarget::Start()
+	{
+		m_pid = SpawnProcess(m_strCommand, &m_fdWrite, &m_fdRead);
+		if (m_pid < 0)
+			return MCP::ERRNO_INTERNAL_ERROR;
+		m_thrReader = std::thread(&CStdioLoadTarget::ReadResponses, this);
+
+		int iErrCode = Call(INITIALIZE_REQUEST, 0);
+		if (MCP::ERRNO_OK != iErrCode)
+			return iErrCode;
+
+		return Notify(INITIALIZED_NOTIFICATION);
+	}
+
+	int CStdioLoadTarget::Stop()
+	{
+		if (m_fdWrite >= 0)
+		{
+			// End of input is the stdio transport's signal to shut down.
+			std::unique_lock<std::mutex> _lock(m_mtxWrite);
+			close(m_fdWrite);
+			m_fdWrite = -1;
+		}
+		ReapProcess(m_pid);
+		m_pid = -1;
+		if (m_thrReader.joinable())
+			m_thrReader.join();
+		if (m_fdRead >= 0)
+		{
+			close(m_fdRead);
+			m_fdRead = -1;
+		}
+
+		return MCP::ERRNO_OK;
+	}
+
+	int CStdioLoadTarget::Call(const std::string& strRequest, long long llId)
+	{
+		PendingCall pending;
+		std::unique_lock<std::mutex> _lock(m_mtxPending);
+		if (m_bClosed)
+			return MCP::ERRNO_INTERNAL_ERROR;
+		m_hashPending[llId] = &pending;
+		_lock.unlock();
+
+		if (MCP::ERRNO_OK != WriteLine(strRequest))
+		{
+			_lock.lock();
+			m_hashPending.erase(llId);
+			return MCP::ERRNO_INTERNAL_ERROR;
+		}
+
+		_lock.lock();
+		pending.cv.wait(_lock, [&]() { return pending.bDone || m_bClosed; });
+		if (!pending.bDone)
+		{
+			m_hashPending.erase(llId);
+			return MCP::ERRNO_INTERNAL_ERROR;
+		}
+
+		return pending.iResult;
+	}
+
+	int CStdioLoadTarget::Abandon(const std::string& strRequest, long long /*llId*/)
+	{
+		// Not registered: the reader drops a response to an id nobody waits for.
+		return WriteLine(strRequest);
+	}
+
+	int CStdioLoadTarget::Notify(const std::string& strNotification)
+	{
+		return WriteLine(strNotification);
+	}
+
+	int CStdioLoadTarget::WriteLine(const std::string& strLine)
+	{
+		std::unique_lock<std::mutex> _lock(m_mtxWrite);
+		if (m_fdWrite < 0)
+			return MCP::ERRNO_INTERNAL_ERROR;
+		if (!WriteAll(m_fdWrite, strLine.data(), strLine.size()) || !WriteAll(m_fdWrite, "\n", 1))
+			return MCP::ERRNO_INTERNAL_ERROR;
+
+		return MCP::ERRNO_OK;
+	}
+
+	void CStdioLoadTarget::ReadResponses()
+	{
+		MCP::CMCPJsonParser parser;
+		std::string strBuffer;
+		char szChunk[64 * 1024];
+		for (;;)
+		{
+			ssize_t nRead = read(m_fdRead, szChunk, sizeof(szChunk));
+			if (nRead <= 0)
+				break;
+			strBuffer.append(szChunk, static_cast<size_t>(nRead));
+
+			size_t nLineBegin = 0;
+			size_t nLineEnd = 0;
+			while ((nLineEnd = strBuffer.find('\n', nLineBegin)) != std::string::npos)
+			{
+				long long llId = 0;
+				int iResult = 0;
+				// Anything else on stdout (notifications, logs printed by the server) is skipped.
+				if (ParseResponse(parser, strBuffer.data() + nLineBegin, strBuffer.data() + nLineEnd, llId, iResult))
+				{
+					std::unique_lock<std::mutex> _lock(m_mtxPending);
+					auto itrPending = m_hashPending.find(llId);
+					if (itrPending != m_hashPending.end())
+					{
+						itrPending->second->bDone = true;
+						itrPending->second->iResult = iResult;
+						itrPending->second->cv.notify_one();
+						m_hashPending.erase(itrPending);
+					}
+				}
+				nLineBegin = nLineEnd + 1;
+			}
+			strBuffer.erase(0, nLineBegin);
+		}
+
+		std::unique_lock<std::mutex> _lock(m_mtxPending);
+		m_bClosed = true;
+		for (auto& pending : m_hashPending)
+		{
+			pending.second->cv.notify_one();
+		}
+	}
+
+	CLocalLoadTarget::CLocalLoadTarget(const std::string& strTransport, const std::string& strAddress, const std::string& strSpawnCommand)
+		: m_strTransport(strTransport)
+		, m_strAddress(strAddress)
+		, m_strSpawnCommand(strSpawnCommand)
+	{
+
+	}
+
+	CLocalLoadTarget::~CLocalLoadTarget()
+	{
+		Stop();
+	}
+
+	std::shared_ptr<MCP::CMCPTransport> CLocalLoadTarget::Connect() const
+	{
+		std::shared_ptr<MCP::CMCPTransport> spTransport;
+		if (m_strTransport == "shm")
+			spTransport = std::make_shared<MCP::CShmRingTransport>(m_strAddress, false);
+		else
+			spTransport = MCP::CUnixSocketTransport::ConnectTo(m_strAddress);
+		if (!spTransport || MCP::ERRNO_OK != spTransport->Connect())
+			return nullptr;
+
+		return spTransport;
+	}
+
+	int CLocalLoadTarget::Start()
+	{
+		if (!m_strSpawnCommand.empty())
+		{
+			m_pid = SpawnProcess(m_strSpawnCommand, nullptr, nullptr);
+			if (m_pid < 0)
+				return MCP::ERRNO_INTERNAL_ERROR;
+		}
+
+		// A spawned server needs a moment before it listens or has created its segment.
+		for (int i = 0; i < 100 && !m_spTransport; ++i)
+		{
+			m_spTransport = Connect();
+			if (!m_spTransport)
+				std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		}
+		if (!m_spTransport)
+			return MCP::ERRNO_INTERNAL_ERROR;
+		m_thrReader = std::thread(&CLocalLoadTarget::ReadResponses, this);
+
+		int iErrCode = Call(INITIALIZE_REQUEST, 0);
+		if (MCP::ERRNO_OK != iErrCode)
+			return iErrCode;
+
+		return Notify(INITIALIZED_NOTIFICATION);
+	}
+
+	int CLocalLoadTarget::Stop()
+	{
+		// Makes the reader return; a shm server ends its session on it, a unix one on SIGTERM below.
+		if (m_spTransport)
+			m_spTransport->Disconnect();
+		if (m_thrReader.joinable())
+			m_thrReader.join();
+		m_spTransport.reset();
+
+		if (m_pid > 0)
+		{
+			kill(m_pid, SIGTERM);
+			ReapProcess(m_pid);
+			m_pid = -1;
+		}
+
+		return MCP::ERRNO_OK;
+	}
+
+	int CLocalLoadTarget::Call(const std::string& strRequest, long long llId)
+	{
+		PendingCall pending;
+		std::unique_lock<std::mutex> _lock(m_mtxPending);
+		if (m_bClosed)
+			return MCP::ERRNO_INTERNAL_ERROR;
+		m_hashPending[llId] = &pending;
+		_lock.unlock();
+
+		if (MCP::ERRNO_OK != m_spTransport->Write(strRequest))
+		{
+			_lock.lock();
+			m_hashPending.erase(llId);
+			return MCP::ERRNO_INTERNAL_ERROR;
+		}
+
+		_lock.lock();
+		pending.cv.wait(_lock, [&]() { return pending.bDone || m_bClosed; });
+		if (!pending.bDone)
+		{
+			m_hashPending.erase(llId);
+			return MCP::ERRNO_INTERNAL_ERROR;
+		}
+
+		return pending.iResult;
+	}
+
+	int CLocalLoadTarget::Abandon(const std::string& strRequest, long long /*llId*/)
+	{
+		// Not registered: the reader drops a response to an id nobody waits for.
+		return m_spTransport->Write(strRequest);
+	}
+
+	int CLocalLoadTarget::Notify(const std::string& strNotification)
+	{
+		return m_spTransport->Write(strNotification);
+	}
+
+	void CLocalLoadTarget::ReadResponses()
+	{
+		MCP::CMCPJsonParser parser;
+		const char* pBegin = nullptr;
+		const char* pEnd = nullptr;
+		while (MCP::ERRNO_OK == m_spTransport->ReadFrame(pBegin, pEnd))
+		{
+			long long llId = 0;
+			int iResult = 0;
+			// Notifications are skipped.
+			if (!ParseResponse(parser, pBegin, pEnd, llId, iResult))
+				continue;
+
+			std::unique_lock<std::mutex> _lock(m_mtxPending);
+			auto itrPending = m_hashPending.find(llId);
+			if (itrPending != m_hashPending.end())
+			{
+				itrPending->second->bDone = true;
+				itrPending->second->iResult = iResult;
+				itrPending->second->cv.notify_one();
+				m_hashPending.erase(itrPending);
+			}
+		}
+
+		std::unique_lock<std::mutex> _lock(m_mtxPending);
+		m_bClosed = true;
+		for (auto& pending : m_hashPending)
+		{
+			pending.second->cv.notify_one();
+		}
+	}
+
+	CHttpLoadTarget::CHttpLoadTarget(const std::string& strUrl, const std::string& strSpawnCommand)
+		: m_strSpawnCommand(strSpawnCommand)
+	{
+		// http://host[:port][/path]
+		std::string strRest = strUrl;
+		if (0 == strRest.compare(0, 7, "http://"))
+			strRest.erase(0, 7);
+		size_t nSlash = strRest.find('/');
+		m_strPath = nSlash == std::string::npos ? "/mcp" : strRest.substr(nSlash);
+		std::string strAuthority = strRest.substr(0, nSlash);
+		size_t nColon = strAuthority.rfind(':');
+		m_strHost = strAuthority.substr(0, nColon);
+		m_strPort = nColon == std::string::npos ? "80" : strAuthority.substr(nColon + 1);
+	}
+
+	CHttpLoadTarget::~CHttpLoadTarget()
+	{
+		Stop();
+	}
+
+	int CHttpLoadTarget::Start()
+	{
+		if (!m_strSpawnCommand.empty())
+		{
+			m_pid = SpawnProcess(m_strSpawnCommand, nullptr, nullptr);
+			if (m_pid < 0)
+				return MCP::ERRNO_INTERNAL_ERROR;
+		}
+
+		// A spawned server needs a moment before it listens.
+		Connection conn;
+		for (int i = 0; i < 100 && MCP::ERRNO_OK != Connect(conn); ++i)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		}
+		if (conn.iFd < 0)
+			return MCP::ERRNO_INTERNAL_ERROR;
+		Release(conn);
+
+		Response response;
+		int iErrCode = Exchange("POST", INITIALIZE_REQUEST, response);
+		if (MCP::ERRNO_OK != iErrCode || 200 != response.iStatus)
+			return MCP::ERRNO_INTERNAL_ERROR;
+		auto itrSession = response.hashHeaders.find("mcp-session-id");
+		if (itrSession == response.hashHeaders.end())
+			return MCP::ERRNO_INTERNAL_ERROR;
+		m_strSessionId = itrSession->second;
+
+		return Notify(INITIALIZED_NOTIFICATION);
+	}
+
+	int CHttpLoadTarget::Stop()
+	{
+		if (!m_strSessionId.empty())
+		{
+			Response response;
+			Exchange("DELETE", "", response);
+			m_strSessionId.clear();
+		}
+
+		std::unique_lock<std::mutex> _lock(m_mtxConnections);
+		for (auto& conn : m_vecIdle)
+		{
+			close(conn.iFd);
+		}
+		m_vecIdle.clear();
+		for (int iFd : m_queueAbandoned)
+		{
+			close(iFd);
+		}
+		m_queueAbandoned.clear();
+		_lock.unlock();
+
+		if (m_pid > 0)
+		{
+			kill(m_pid, SIGTERM);
+			ReapProcess(m_pid);
+			m_pid = -1;
+		}
+
+		return MCP::ERRNO_OK;
+	}
+
+	int CHttpLoadTarget::Call(const std::string& strRequest, long long llId)
+	{
+		Response response;
+		if (MCP::ERRNO_OK != Exchange("POST", strRequest, response) || 200 != response.iStatus)
+			return MCP::ERRNO_INTERNAL_ERROR;
+
+		// The request is answered with an event stream: progress notifications, then the response.
+		MCP::CMCPJsonParser parser;
+		const std::string& strBody = response.strBody;
+		size_t nEvent = 0;
+		while ((nEvent = strBody.find("data: ", nEvent)) != std::string::npos)
+		{
+			nEvent += 6;
+			size_t nEnd = strBody.find("\n\n", nEvent);
+			if (nEnd == std::string::npos)
+				nEnd = strBody.size();
+			long long llResponseId = 0;
+			int iResult = 0;
+			if (ParseResponse(parser, strBody.data() + nEvent, strBody.data() + nEnd, llResponseId, iResult) && llResponseId == llId)
+				return iResult;
+			nEvent = nEnd;
+		}
+
+		return MCP::ERRNO_INTERNAL_ERROR;
+	}
+
+	int CHttpLoadTarget::Abandon(const std::string& strRequest, long long /*llId*/)
+	{
+		// The stream answering a cancelled request may never end, so the connection is not reused.
+		Connection conn;
+		if (MCP::ERRNO_OK != Connect(conn) || MCP::ERRNO_OK != SendRequest(conn, "POST", strRequest))
+		{
+			if (conn.iFd >= 0)
+				close(conn.iFd);
+			return MCP::ERRNO_INTERNAL_ERROR;
+		}
+
+		std::unique_lock<std::mutex> _lock(m_mtxConnections);
+		m_queueAbandoned.push_back(conn.iFd);
+		if (m_queueAbandoned.size() > 256)
+		{
+			close(m_queueAbandoned.front());
+			m_queueAbandoned.pop_front();
+		}
+
+		return MCP::ERRNO_OK;
+	}
+
+	int CHttpLoadTarget::Notify(const std::string& strNotification)
+	{
+		Response response;
+		if (MCP::ERRNO_OK != Exchange("POST", strNotification, response) || 202 != response.iStatus)
+			return MCP::ERRNO_INTERNAL_ERROR;
+
+		return MCP::ERRNO_OK;
+	}
+
+	int CHttpLoadTarget::Connect(Connection& conn) const
+	{
+		addrinfo hints;
+		memset(&hints, 0, sizeof(hints));
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_socktype = SOCK_STREAM;
+		addrinfo* pResult = nullptr;
+		if (0 != getaddrinfo(m_strHost.c_str(), m_strPort.c_str(), &hints, &pResult))
+			return MCP::ERRNO_INTERNAL_ERROR;
+
+		int iFd = -1;
+		for (addrinfo* pAddr = pResult; pAddr; pAddr = pAddr->ai_next)
+		{
+			iFd = socket(pAddr->ai_family, pAddr->ai_socktype, pAddr->ai_protocol);
+			if (iFd < 0)
+				continue;
+			if (0 == connect(iFd, pAddr->ai_addr, pAddr->ai_addrlen))
+				break;
+			close(iFd);
+			iFd = -1;
+		}
+		freeaddrinfo(pResult);
+		if (iFd < 0)
+			return MCP::ERRNO_INTERNAL_ERROR;
+
+		int iNoDelay = 1;
+		setsockopt(iFd, IPPROTO_TCP, TCP_NODELAY, &iNoDelay, sizeof(iNoDelay));
+		fcntl(iFd, F_SETFD, FD_CLOEXEC);
+		conn.iFd = iFd;
+		conn.strInput.clear();
+
+		return MCP::ERRNO_OK;
+	}
+
+	bool CHttpLoadTarget::Acquire(Connection& conn)
+	{
+		std::unique_lock<std::mutex> _lock(m_mtxConnections);
+		if (m_vecIdle.empty())
+			return false;
+		conn = std::move(m_vecIdle.back());
+		m_vecIdle.pop_back();
+
+		return true;
+	}
+
+	void CHttpLoadTarget::Release(Connection& conn)
+	{
+		std::unique_lock<std::mutex> _lock(m_mtxConnections);
+		m_vecIdle.push_back(std::move(conn));
+		conn.iFd = -1;
+	}
+
+	int CHttpLoadTarget::SendRequest(Connection& conn, const char* lpcszMethod, const std::string& strBody) const
+	{
+		std::string strRequest = std::string(lpcszMethod) + " " + m_strPath + " HTTP/1.1\r\n"
+			"Host: " + m_strHost + ":" + m_strPort + "\r\n"
+			"Accept: application/json, text/event-stream\r\n";
+		if (!strBody.empty())
+			strRequest += "Content-Type: application/json\r\n";
+		if (!m_strSessionId.empty())
+			strRequest += "Mcp-Session-Id: " + m_strSessionId + "\r\n";
+		strRequest += "Content-Length: " + std::to_string(strBody.size()) + "\r\n\r\n";
+		strRequest += strBody;
+
+		return WriteAll(conn.iFd, strRequest.data(), strRequest.size()) ? MCP::ERRNO_OK : MCP::ERRNO_INTERNAL_ERROR;
+	}
+
+	int CHttpLoadTarget::ReadResponse(Connection& conn, Response& response) const
+	{
+		auto fnFill = [&conn]()
+		{
+			char szChunk[16 * 1024];
+			ssize_t nRead = read(conn.iFd, szChunk, sizeof(szChunk));
+			if (nRead <= 0)
+				return false;
+			conn.strInput.append(szChunk, static_cast<size_t>(nRead));
+			return true;
+		};
+		// Waits until nBytes, or a line, are buffered.
+		auto fnNeed = [&conn, &fnFill](size_t nBytes)
+		{
+			while (conn.strInput.size() < nBytes)
+			{
+				if (!fnFill())
+					return false;
+			}
+			return true;
+		};
+		auto fnLine = [&conn, &fnFill](size_t nFrom, size_t& nEnd)
+		{
+			while ((nEnd = conn.strInput.find("\r\n", nFrom)) == std::string::npos)
+			{
+				if (!fnFill())
+					return false;
+			}
+			return true;
+		};
+
+		size_t nHeaderEnd = 0;
+		while ((nHeaderEnd = conn.strInput.find("\r\n\r\n")) == std::string::npos)
+		{
+			if (!fnFill())
+				return MCP::ERRNO_INTERNAL_ERROR;
+		}
+
+		// "HTTP/1.1 200 OK", then "Name: value" lines.
+		size_t nLineEnd = conn.strInput.find("\r\n");
+		size_t nSpace = conn.strInput.find(' ');
+		if (nSpace == std::string::npos || nSpace > nLineEnd)
+			return MCP::ERRNO_INTERNAL_ERROR;
+		response.iStatus = atoi(conn.strInput.c_str() + nSpace + 1);
+		response.hashHeaders.clear();
+		while (nLineEnd < nHeaderEnd)
+		{
+			size_t nBegin = nLineEnd + 2;
+			nLineEnd = conn.strInput.find("\r\n", nBegin);
+			size_t nColon = conn.strInput.find(':', nBegin);
+			if (nColon == std::string::npos || nColon > nLineEnd)
+				continue;
+			std::string strName = conn.strInput.substr(nBegin, nColon - nBegin);
+			for (auto& ch : strName)
+			{
+				ch = static_cast<char>(tolower(static_cast<unsigned char>(ch)));
+			}
+			size_t nValue = conn.strInput.find_first_not_of(' ', nColon + 1);
+			response.hashHeaders[strName] = conn.strInput.substr(nValue, nLineEnd - nValue);
+		}
+		conn.strInput.erase(0, nHeaderEnd + 4);
+
+		response.strBody.clear();
+		auto itrEncoding = response.hashHeaders.find("transfer-encoding");
+		if (itrEncoding != response.hashHeaders.end() && itrEncoding->second == "chunked")
+		{
+			for (;;)
+			{
+				size_t nSizeEnd = 0;
+				if (!fnLine(0, nSizeEnd))
+					return MCP::ERRNO_INTERNAL_ERROR;
+				size_t nChunk = strtoul(conn.strInput.c_str(), nullptr, 16);
+				if (!fnNeed(nSizeEnd + 2 + nChunk + 2))
+					return MCP::ERRNO_INTERNAL_ERROR;
+				response.strBody.append(conn.strInput, nSizeEnd + 2, nChunk);
+				conn.strInput.erase(0, nSizeEnd + 2 + nChunk + 2);
+				if (0 == nChunk)
+					break;
+			}
+		}
+		else
+		{
+			auto itrLength = response.hashHeaders.find("content-length");
+			size_t nLength = itrLength != response.hashHeaders.end() ? strtoul(itrLength->second.c_str(), nullptr, 10) : 0;
+			if (!fnNeed(nLength))
+				return MCP::ERRNO_INTERNAL_ERROR;
+			response.strBody.assign(conn.strInput, 0, nLength);
+			conn.strInput.erase(0, nLength);
+		}
+
+		return MCP::ERRNO_OK;
+	}
+
+	int CHttpLoadTarget::Exchange(const char* lpcszMethod, const std::string& strBody, Response& response)
+	{
+		// An idle connection may have been closed by the server meanwhile: retried once on a new one.
+		for (int iAttempt = 0; iAttempt < 2; ++iAttempt)
+		{
+			Connection conn;
+			bool bReused = Acquire(conn);
+			if (!bReused && MCP::ERRNO_OK != Connect(conn))
+				return MCP::ERRNO_INTERNAL_ERROR;
+			if (MCP::ERRNO_OK == SendRequest(conn, lpcszMethod, strBody) && MCP::ERRNO_OK == ReadResponse(conn, response))
+			{
+				auto itrConnection = response.hashHeaders.find("connection");
+				if (itrConnection != response.hashHeaders.end() && itrConnection->second == "close")
+					close(conn.iFd);
+				else
+					Release(conn);
+				return MCP::ERRNO_OK;
+			}
+			close(conn.iFd);
+			if (!bReused)
+				break;
+		}
+
+		return MCP::ERRNO_INTERNAL_ERROR;
+	}
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <thread>
+#include <sys/types.h>
+#include <Transport/Transport.h>
+
+
+namespace Implementation
+{
+	// The server under load, as seen by the load generator. Every method may be called from all
+	// the worker threads at once.
+	class CLoadTarget
+	{
+	public:
+		virtual ~CLoadTarget() {}
+
+		// Spawns or connects to the server and runs the initialize handshake.
+		virtual int Start() = 0;
+		virtual int Stop() = 0;
+
+		// Sends a request and blocks until its response arrives. Returns ERRNO_OK for a result, the
+		// JSON-RPC error code for an error response, and ERRNO_INTERNAL_ERROR if the server is gone.
+		virtual int Call(const std::string& strRequest, long long llId) = 0;
+		// Sends a request whose response, if any, is dropped: it is about to be cancelled.
+		virtual int Abandon(const std::string& strRequest, long long llId) = 0;
+		virtual int Notify(const std::string& strNotification) = 0;
+	};
+
+	// Runs the server as a child process and talks to it over its stdin and stdout. Requests from
+	// all the workers are pipelined on the one pipe; a reader thread hands each response to the
+	// worker waiting for its id.
+	class CStdioLoadTarget : public CLoadTarget
+	{
+	public:
+		explicit CStdioLoadTarget(const std::string& strCommand);
+		~CStdioLoadTarget();
+
+		int Start() override;
+		int Stop() override;
+		int Call(const std::string& strRequest, long long llId) override;
+		int Abandon(const std::string& strRequest, long long llId) override;
+		int Notify(const std::string& strNotification) override;
+
+	private:
+		struct PendingCall
+		{
+			std::condition_variable cv;
+			bool bDone{ false };
+			int iResult{ 0 };
+		};
+
+		int WriteLine(const std::string& strLine);
+		void ReadResponses();
+
+		std::string m_strCommand;
+		pid_t m_pid{ -1 };
+		int m_fdWrite{ -1 };
+		int m_fdRead{ -1 };
+		std::mutex m_mtxWrite;
+		std::thread m_thrReader;
+
+		std::mutex m_mtxPending;
+		std::condition_variable m_cvPending;
+		std::unordered_map<long long, PendingCall*> m_hashPending;
+		bool m_bClosed{ false };
+	};
+
+	// Talks to a server on one of the local transports of the SDK: "unix" (strAddress is the socket
+	// path) or "shm" (strAddress is the segment name), optionally spawning it with strSpawnCommand
+	// first. Like stdio, requests are pipelined on the one transport and a reader thread hands each
+	// response to the worker waiting for its id.
+	class CLocalLoadTarget : public CLoadTarget
+	{
+	public:
+		CLocalLoadTarget(const std::string& strTransport, const std::string& strAddress, const std::string& strSpawnCommand);
+		~CLocalLoadTarget();
+
+		int Start() override;
+		int Stop() override;
+		int Call(const std::string& strRequest, long long llId) override;
+		int Abandon(const std::string& strRequest, long long llId) override;
+		int Notify(const std::string& strNotification) override;
+
+	private:
+		struct PendingCall
+		{
+			std::condition_variable cv;
+			bool bDone{ false };
+			int iResult{ 0 };
+		};
+
+		std::shared_ptr<MCP::CMCPTransport> Connect() const;
+		void ReadResponses();
+
+		std::string m_strTransport;
+		std::string m_strAddress;
+		std::string m_strSpawnCommand;
+		pid_t m_pid{ -1 };
+		std::shared_ptr<MCP::CMCPTransport> m_spTransport;
+		std::thread m_thrReader;
+
+		std::mutex m_mtxPending;
+		std::unordered_map<long long, PendingCall*> m_hashPending;
+		bool m_bClosed{ false };
+	};
+
+	// Talks to a server already listening on the Streamable HTTP transport, or to one it spawns with
+	// strSpawnCommand. Every worker borrows a keep-alive connection of its own for each request.
+	class CHttpLoadTarget : public CLoadTarget
+	{
+	public:
+		CHttpLoadTarget(const std::string& strUrl, const std::string& strSpawnCommand);
+		~CHttpLoadTarget();
+
+		int Start() override;
+		int Stop() override;
+		int Call(const std::string& strRequest, long long llId) override;
+		int Abandon(const std::string& strRequest, long long llId) override;
+		int Notify(const std::string& strNotification) override;
+
+	private:
+		struct Connection
+		{
+			int iFd{ -1 };
+			std::string strInput;
+		};
+
+		struct Response
+		{
+			int iStatus{ 0 };
+			std::unordered_map<std::string, std::string> hashHeaders;	// lower case names
+			std::string strBody;
+		};
+
+		int Connect(Connection& conn) const;
+		bool Acquire(Connection& conn);
+		void Release(Connection& conn);
+		int SendRequest(Connection& conn, const char* lpcszMethod, const std::string& strBody) const;
+		int ReadResponse(Connection& conn, Response& response) const;
+		int Exchange(const char* lpcszMethod, const std::string& strBody, Response& response);
+
+		std::string m_strHost;
+		std::string m_strPort;
+		std::string m_strPath;
+		std::string m_strSpawnCommand;
+		pid_t m_pid{ -1 };
+		std::string m_strSessionId;
+
+		std::mutex m_mtxConnections;
+		std::vector<Connection> m_vecIdle;
+		// Connections still streaming the answer of an abandoned request; closed oldest first.
+		std::deque<int> m_queueAbandoned;
+	};
+}
@@ -1,18 +1,145 @@
 #include <iostream>
 #include <string>
-#include "../../../Source/Protocol/Transport/Transport.h"
-#include "../../../Source/Protocol/Transport/HttpSseTransport.h"
-#include "../../../Source/Protocol/Session/Session.h"
+#include <memory>
+#include <cstdlib>
+#include <cstring>
+#include <signal.h>
+#include "LoadGenerator.h"
+#include "../../../Source/Protocol/Public/PublicDef.h"
 
-int main()
+// Load generator for MCP servers: spawns the server (or connects to it over HTTP, a Unix domain
+// socket or shared memory), runs the initialize handshake, then drives a mix of tools/call,
+// tools/list, ping and cancellations and reports throughput and latency percentiles per operation.
+
+static void PrintUsage()
 {
-    // Minimal client placeholder: demonstrate constructing transports
-    MCP::CStdioTransport stdio;
-    MCP::CHttpSseTransport httpSse;
-    httpSse.SetEndpoint("http://127.0.0.1:9000/mcp");
+    std::cout <<
+        "Usage: MCPClient (--stdio \"<server command>\" | (--http <url> | --unix <path> | --shm <name>) [--spawn \"<server command>\"])\n"
+        "                 [--mix call=100,list=0,ping=0,cancel=0] [--tool echo] [--arguments '{\"input\":\"hello\"}']\n"
+        "                 [--concurrency 1] [--rate 0] [--warmup 1] [--duration 10]\n"
+        "\n"
+        "  --unix, --shm  a server with [server] transport=unix or shm; --shm serves one client at a time\n"
+        "  --concurrency  workers, i.e. requests in flight at most\n"
+        "  --rate         requests per second at a fixed schedule (open loop); 0 keeps every worker busy\n"
+        "                 (closed loop). Open loop latencies count from when a request was due.\n";
+}
 
-    std::cout << "MCPClient scaffold built successfully." << std::endl;
-    return 0;
+static bool ParseMix(const std::string& strMix, Implementation::LoadOptions& options)
+{
+    for (int iOp = 0; iOp < Implementation::LoadOp_Count; ++iOp)
+    {
+        options.arrWeights[iOp] = 0;
+    }
+    size_t nBegin = 0;
+    while (nBegin < strMix.size())
+    {
+        size_t nEnd = strMix.find(',', nBegin);
+        if (nEnd == std::string::npos)
+            nEnd = strMix.size();
+        std::string strItem = strMix.substr(nBegin, nEnd - nBegin);
+        size_t nEqual = strItem.find('=');
+        if (nEqual == std::string::npos)
+            return false;
+        std::string strName = strItem.substr(0, nEqual);
+        bool bFound = false;
+        for (int iOp = 0; iOp < Implementation::LoadOp_Count; ++iOp)
+        {
+            if (strName == Implementation::CLoadGenerator::GetOpName(static_cast<Implementation::LoadOp>(iOp)))
+            {
+                options.arrWeights[iOp] = static_cast<unsigned int>(atoi(strItem.c_str() + nEqual + 1));
+                bFound = true;
+            }
+        }
+        if (!bFound)
+            return false;
+        nBegin = nEnd + 1;
+    }
+
+    return true;
 }
 
+int main(int argc, char* argv[])
+{
+    // A server that goes away must show up as failed calls, not kill the generator.
+    signal(SIGPIPE, SIG_IGN);
+
+    std::string strStdioCommand;
+    std::string strUrl;
+    std::string strUnixPath;
+    std::string strShmName;
+    std::string strSpawnCommand;
+    Implementation::LoadOptions options;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string strArg = argv[i];
+        if (i + 1 >= argc)
+        {
+            PrintUsage();
+            return 1;
+        }
+        const char* lpcszValue = argv[++i];
+        if (strArg == "--stdio")
+            strStdioCommand = lpcszValue;
+        else if (strArg == "--http")
+            strUrl = lpcszValue;
+        else if (strArg == "--unix")
+            strUnixPath = lpcszValue;
+        else if (strArg == "--shm")
+            strShmName = lpcszValue;
+        else if (strArg == "--spawn")
+            strSpawnCommand = lpcszValue;
+        else if (strArg == "--tool")
+            options.strTool = lpcszValue;
+        else if (strArg == "--arguments")
+            options.strArguments = lpcszValue;
+        else if (strArg == "--concurrency")
+            options.nConcurrency = static_cast<size_t>(atoi(lpcszValue));
+        else if (strArg == "--rate")
+            options.dRate = atof(lpcszValue);
+        else if (strArg == "--warmup")
+            options.dWarmupS = atof(lpcszValue);
+        else if (strArg == "--duration")
+            options.dDurationS = atof(lpcszValue);
+        else if (strArg != "--mix" || !ParseMix(lpcszValue, options))
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+    int iTargets = !strStdioCommand.empty() + !strUrl.empty() + !strUnixPath.empty() + !strShmName.empty();
+    if (1 != iTargets || options.dDurationS <= 0)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    std::unique_ptr<Implementation::CLoadTarget> upTarget;
+    if (!strStdioCommand.empty())
+        upTarget.reset(new Implementation::CStdioLoadTarget(strStdioCommand));
+    else if (!strUnixPath.empty())
+        upTarget.reset(new Implementation::CLocalLoadTarget("unix", strUnixPath, strSpawnCommand));
+    else if (!strShmName.empty())
+        upTarget.reset(new Implementation::CLocalLoadTarget("shm", strShmName, strSpawnCommand));
+    else
+        upTarget.reset(new Implementation::CHttpLoadTarget(strUrl, strSpawnCommand));
+    if (MCP::ERRNO_OK != upTarget->Start())
+    {
+        std::cout << "The server could not be started or did not answer initialize." << std::endl;
+        upTarget->Stop();
+        return 1;
+    }
+
+    Implementation::LoadReport report;
+    Implementation::CLoadGenerator generator(*upTarget, options);
+    int iErrCode = generator.Run(report);
+    upTarget->Stop();
+    if (MCP::ERRNO_OK != iErrCode)
+    {
+        std::cout << "Nothing to run: every weight of the mix is 0." << std::endl;
+        return 1;
+    }
 
+    Implementation::CLoadGenerator::PrintReport(report);
+
+    return 0;
+}
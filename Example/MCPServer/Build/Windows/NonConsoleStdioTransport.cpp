@@ -1,9 +1,9 @@
 #include "stdafx.h"
 #include "NonConsoleStdioTransport.h"
 #include "../../Protocol/Public/StringHelper.h"
+#include "../../Protocol/Public/Logger.h"
 #include <memory>
 #include <atlstr.h>
-#include <CppHelper/StringHelper.h>
 
 namespace Implementation
 {
@@ -63,33 +63,14 @@ namespace Implementation
 			}
 			else
 			{
-#ifdef DEBUG
-				if (true)
-#else
-				if (g_bOutputLog)
-#endif // DEBUG
-				{
-					CString strLog;
-					strLog.Format(L"[%s] >>>>>>receive more data from cbAvail=%u\r\n", __FUNCTIONW__, cbAvail);
-					OutputDebugString(strLog.GetString());
-				}
-
+				MCP_LOG_DEBUG("transport", "[{}] >>>>>>receive more data from cbAvail={}", __FUNCTION__, cbAvail);
 			}
 		}
 
 		Tmp.ReleaseBufferSetLength(cbDataUsed);
 		strOut = Tmp;
 
-#ifdef _DEBUG
-		if (true)
-#else
-		if (g_bOutputLog)
-#endif // _DEBUG
-		{
-			CString strLog;
-			strLog.Format(L"[%s] >>>>>>receive data from client=%s\r\n", __FUNCTIONW__, YY::UTF8ToUnicode(strOut.c_str()));
-			OutputDebugString(strLog.GetString());
-		}
+		MCP_LOG_DEBUG("transport", "[{}] >>>>>>receive data from client={}", __FUNCTION__, strOut);
 
 		return iErrCode;
 	}
@@ -102,16 +83,7 @@ namespace Implementation
 		if (!WriteFile(m_hStdOut, strIn.c_str(), strlen(strIn.c_str()) * sizeof(char), &cbWrite, nullptr))
 			return MCP::ERRNO_INTERNAL_OUTPUT_ERROR;
 
-#ifdef _DEBUG
-		if (true)
-#else
-		if (g_bOutputLog)
-#endif // _DEBUG
-		{
-			CString strLog;
-			strLog.Format(L"[%s] <<<<<<send data to client=%s\r\n", __FUNCTIONW__, YY::UTF8ToUnicode(strIn.c_str()));
-			OutputDebugString(strLog.GetString());
-		}
+		MCP_LOG_DEBUG("transport", "[{}] <<<<<<send data to client={}", __FUNCTION__, strIn);
 
 		return MCP::ERRNO_OK;
 	}
@@ -1,8 +1,19 @@
 #include "EchoServer.h"
-#include "EchoTask.h"
+#include "TraceTask.h"
 
 namespace Implementation
 {
+    // The arguments of the echo tool, from which its input schema is generated.
+    struct EchoArguments
+    {
+        std::string strInput;
+
+        static auto Arguments()
+        {
+            return std::make_tuple(MCP::RequiredArgument("input", &EchoArguments::strInput, u8"client input data"));
+        }
+    };
+
     int CEchoServer::Initialize()
     {
         // 1. Set the basic information of the Server.
@@ -21,25 +32,51 @@ namespace Implementation
         resources.bSubscribe = false;
         RegisterServerResourcesCapabilities(resources);
 
-        // 3. Register the descriptions of the Server's actual capabilities and their calling methods.
-        MCP::Tool tool;
-        tool.strName = Implementation::CEchoTask::TOOL_NAME;
-        tool.strDescription = Implementation::CEchoTask::TOOL_DESCRIPTION;
-        std::string strInputSchema = Implementation::CEchoTask::TOOL_INPUT_SCHEMA;
-        Json::Reader reader;
-        Json::Value jInputSchema(Json::objectValue);
-        if (!reader.parse(strInputSchema, jInputSchema) || !jInputSchema.isObject())
-            return MCP::ERRNO_PARSE_ERROR;
-        tool.jInputSchema = jInputSchema;
+        // Register logging capabilities: clients get notifications/message after logging/setLevel
+        MCP::Logging logging;
+        RegisterServerLoggingCapabilities(logging);
+
+        // 3. Register the tasks implementing the actual capabilities.
+        // The echo task is bound to EchoArguments, from which the tool's input schema is generated.
+        RegisterToolTask<EchoArguments>(TOOL_NAME_ECHO,
+            [](EchoArguments& arguments, MCP::CallToolResult& result)
+            {
+                result.bIsError = false;
+                result.AddText(std::move(arguments.strInput));
+                return MCP::ERRNO_OK;
+            });
+
+        // Request tracing is diagnostics: the tool is only offered when it is switched on.
+        // The trace task is only constructed once the tool is first called.
+        bool bTrace = MCP::Config::GetInstance().GetTraceEnabled();
+        if (bTrace)
+            RegisterLazyToolsTasks(Implementation::CTraceDumpTask::TOOL_NAME,
+                []() { return std::make_shared<Implementation::CTraceDumpTask>(nullptr); });
+
+        // 4. Register the descriptions of the tools. With a snapshot of the catalog they are listed
+        // from it, as written by an earlier run with the same tasks, and only built without one.
+        std::string strSnapshot = MCP::Config::GetInstance().GetToolsSnapshotFile();
+        if (!strSnapshot.empty() && MCP::ERRNO_OK == LoadServerToolsSnapshot(strSnapshot, false))
+            return MCP::ERRNO_OK;
+
         std::vector<MCP::Tool> vecTools;
-        vecTools.push_back(tool);
+        vecTools.push_back(DescribeTool<EchoArguments>(TOOL_NAME_ECHO,
+            u8"Receive the data sent by the client and then return the exact same data to the client."));
+        if (bTrace)
+        {
+            MCP::Tool traceTool;
+            traceTool.strName = Implementation::CTraceDumpTask::TOOL_NAME;
+            traceTool.strDescription = Implementation::CTraceDumpTask::TOOL_DESCRIPTION;
+            MCP::CMCPJsonParser parser;
+            Json::Value jTraceSchema(Json::objectValue);
+            if (!parser.Parse(Implementation::CTraceDumpTask::TOOL_INPUT_SCHEMA, jTraceSchema) || !jTraceSchema.isObject())
+                return MCP::ERRNO_PARSE_ERROR;
+            traceTool.jInputSchema = jTraceSchema;
+            vecTools.push_back(traceTool);
+        }
         RegisterServerTools(vecTools, false);
-
-        // 4. Register the tasks for implementing the actual capabilities.
-        auto spCallToolsTask = std::make_shared<Implementation::CEchoTask>(nullptr);
-        if (!spCallToolsTask)
-            return MCP::ERRNO_INTERNAL_ERROR;
-        RegisterToolsTasks(Implementation::CEchoTask::TOOL_NAME, spCallToolsTask);
+        if (!strSnapshot.empty())
+            SaveServerToolsSnapshot(strSnapshot);
 
         return MCP::ERRNO_OK;
     }
@@ -12,6 +12,7 @@ namespace Implementation
 	public:
 		static constexpr const char* SERVER_NAME = "echo_server";
 		static constexpr const char* SERVER_VERSION = "1.0.0.1";
+		static constexpr const char* TOOL_NAME_ECHO = "echo";
 
 		// This is the initialization method, which is used to configure the Server. 
 		// The Server can be started only after the configuration is successful.
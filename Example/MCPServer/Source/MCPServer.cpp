@@ -5,6 +5,7 @@
 #include <signal.h>
 #include "EchoServer.h"
 #include "../../Source/Protocol/Public/Config.h"
+#include "../../Source/Protocol/Public/Trace.h"
 
 
 int LaunchEchoServer()
@@ -35,13 +36,22 @@ int LaunchEchoServer()
 }
 
 
-std::atomic_bool g_bStop{ false };
-void signal_handler(int signal) { g_bStop = true; }
+void signal_handler(int signal) { Implementation::CEchoServer::GetInstance().RequestStop(); }
+// Writes the trace spans to [trace] dump_file, e.g. kill -USR1 <pid>.
+void trace_signal_handler(int signal) { MCP::CMCPTrace::RequestDump(); }
+// Reloads config.ini, e.g. kill -HUP <pid>.
+void reload_signal_handler(int signal) { MCP::Config::RequestReload(); }
 
 int main(int argc, char* argv[])
 {
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
+#ifdef SIGUSR1
+    signal(SIGUSR1, trace_signal_handler);
+#endif
+#ifdef SIGHUP
+    signal(SIGHUP, reload_signal_handler);
+#endif
     
     return LaunchEchoServer();
 }
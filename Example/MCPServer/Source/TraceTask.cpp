@@ -0,0 +1,38 @@
+#include "TraceTask.h"
+#include <Public/PublicDef.h>
+#include <Public/Trace.h>
+
+
+namespace Implementation
+{
+	std::shared_ptr<MCP::CMCPTask> CTraceDumpTask::Clone() const
+	{
+		auto spClone = std::make_shared<CTraceDumpTask>(nullptr);
+		if (spClone)
+		{
+			*spClone = *this;
+		}
+
+		return spClone;
+	}
+
+	int CTraceDumpTask::Cancel()
+	{
+		return MCP::ERRNO_OK;
+	}
+
+	int CTraceDumpTask::Execute()
+	{
+		if (!IsValid())
+			return MCP::ERRNO_INTERNAL_ERROR;
+
+		auto spExecuteResult = BuildResult();
+		if (!spExecuteResult)
+			return MCP::ERRNO_INTERNAL_ERROR;
+
+		spExecuteResult->bIsError = false;
+		spExecuteResult->AddText(MCP::CMCPTrace::GetInstance().DumpChromeTrace());
+
+		return NotifyResult(spExecuteResult);
+	}
+}
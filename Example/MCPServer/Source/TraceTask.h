@@ -0,0 +1,30 @@
+#pragma once
+
+#include <Task/BasicTask.h>
+#include <Message/Request.h>
+#include <string>
+
+
+namespace Implementation
+{
+	// Returns the buffered trace spans (see [trace] in config.ini) as Chrome trace JSON, to be
+	// saved and opened in ui.perfetto.dev or chrome://tracing.
+	class CTraceDumpTask : public MCP::ProcessCallToolRequest
+	{
+	public:
+		static constexpr const char* TOOL_NAME = "trace_dump";
+		static constexpr const char* TOOL_DESCRIPTION = u8"Return the request trace spans recorded by the server in the Chrome trace event format.";
+		static constexpr const char* TOOL_INPUT_SCHEMA = u8R"({"type":"object","properties":{}})";
+
+		CTraceDumpTask(const std::shared_ptr<MCP::Request>& spRequest)
+			: ProcessCallToolRequest(spRequest)
+		{
+
+		}
+
+		std::shared_ptr<CMCPTask> Clone() const override;
+
+		int Execute() override;
+		int Cancel() override;
+	};
+}
@@ -81,6 +81,68 @@ bool operator!=(const SecureAllocator<T>&, const SecureAllocator<U>&) {
   return false;
 }
 
+/** \brief Backing store for the Value trees built on one thread.
+ *
+ * While a MemoryResourceScope is active, the string buffers and the
+ * object/array nodes of every Value created on that thread come from the
+ * resource. Such memory is never handed back block by block; the owner of the
+ * resource reclaims it all at once, so the trees built inside a scope have to
+ * be destroyed first. Memory obtained outside of a scope, copies of those
+ * trees included, comes from the heap as usual.
+ */
+class JSON_API MemoryResource {
+public:
+  virtual ~MemoryResource();
+  /// Returns at least \c bytes bytes, aligned for any fundamental type.
+  virtual void* allocate(std::size_t bytes) = 0;
+};
+
+/// Routes the Value allocations of the current thread to \c resource for the
+/// lifetime of the scope. Scopes nest; nullptr selects the heap.
+class JSON_API MemoryResourceScope {
+public:
+  explicit MemoryResourceScope(MemoryResource* resource);
+  ~MemoryResourceScope();
+  MemoryResourceScope(const MemoryResourceScope&) = delete;
+  MemoryResourceScope& operator=(const MemoryResourceScope&) = delete;
+
+private:
+  MemoryResource* previous_;
+};
+
+namespace detail {
+/// Allocates from the active MemoryResource, or from the heap without one.
+/// Blocks are tagged so that releaseBlock() knows where they came from.
+JSON_API void* allocateBlock(std::size_t bytes);
+JSON_API void releaseBlock(void* block);
+} // namespace detail
+
+/// Allocator of the Value object/array nodes, see MemoryResource.
+template <typename T> class NodeAllocator {
+public:
+  using value_type = T;
+
+  NodeAllocator() = default;
+  template <typename U> NodeAllocator(const NodeAllocator<U>&) {}
+
+  T* allocate(std::size_t n) {
+    return static_cast<T*>(detail::allocateBlock(n * sizeof(T)));
+  }
+  void deallocate(T* p, std::size_t) { detail::releaseBlock(p); }
+
+  template <typename U> struct rebind { using other = NodeAllocator<U>; };
+};
+
+template <typename T, typename U>
+bool operator==(const NodeAllocator<T>&, const NodeAllocator<U>&) {
+  return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const NodeAllocator<T>&, const NodeAllocator<U>&) {
+  return false;
+}
+
 } // namespace Json
 
 #pragma pack(pop)
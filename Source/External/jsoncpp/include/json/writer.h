@@ -353,6 +353,11 @@ String JSON_API valueToString(
     PrecisionType precisionType = PrecisionType::significantDigits);
 String JSON_API valueToString(bool value);
 String JSON_API valueToQuotedString(const char* value);
+/// Length of the leading part of value that a string literal can hold as is:
+/// the scan stops at '"', '\\', control characters and, unless emitUTF8,
+/// bytes above 0x7F. Vectorized where the CPU allows.
+size_t JSON_API countUnescapedPrefix(const char* value, size_t length,
+                                     bool emitUTF8 = false);
 
 /// \brief Output using the StyledStreamWriter.
 /// \see Json::operator>>()
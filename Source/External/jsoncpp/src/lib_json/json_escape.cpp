@@ -0,0 +1,188 @@
+// Copyright 2011 Baptiste Lepilleur and The JsonCpp Authors
+// Distributed under MIT license, or public domain if desired and
+// recognized in your jurisdiction.
+// See file LICENSE for detail or copy at http://jsoncpp.sourceforge.net/LICENSE
+
+// Vectorized scan for the characters a JSON string literal has to escape.
+// The kernel is chosen once at run time: AVX2 when the CPU supports it, SSE2
+// on the other x86-64 CPUs, NEON on ARM64, and a scalar loop elsewhere.
+
+#if !defined(JSON_IS_AMALGAMATION)
+#include <json/writer.h>
+#endif // if !defined(JSON_IS_AMALGAMATION)
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64) ||                                 \
+    (defined(__i386__) && defined(__SSE2__)) ||                                \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define JSON_ESCAPE_SSE2 1
+#include <emmintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define JSON_ESCAPE_AVX2 1
+#define JSON_ESCAPE_TARGET_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#elif defined(_MSC_VER)
+#define JSON_ESCAPE_AVX2 1
+#define JSON_ESCAPE_TARGET_AVX2
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define JSON_ESCAPE_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace Json {
+
+namespace {
+
+using CountFunction = size_t (*)(const char*, size_t, bool);
+
+inline bool requiresEscaping(unsigned char c, bool emitUTF8) {
+  return c == '\\' || c == '"' || c < 0x20 || (!emitUTF8 && c > 0x7F);
+}
+
+inline size_t countScalar(const char* value, size_t length, bool emitUTF8) {
+  size_t index = 0;
+  while (index < length &&
+         !requiresEscaping(static_cast<unsigned char>(value[index]), emitUTF8))
+    ++index;
+  return index;
+}
+
+#if defined(JSON_ESCAPE_SSE2)
+inline unsigned int lowestSetBit(unsigned int mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  unsigned long index = 0;
+  _BitScanForward(&index, mask);
+  return static_cast<unsigned int>(index);
+#else
+  return static_cast<unsigned int>(__builtin_ctz(mask));
+#endif
+}
+
+inline size_t countSSE2(const char* value, size_t length, bool emitUTF8) {
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  const __m128i space = _mm_set1_epi8(0x20);
+  const __m128i lastControl = _mm_set1_epi8(0x1F);
+  size_t index = 0;
+  for (; index + 16 <= length; index += 16) {
+    const __m128i chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(value + index));
+    __m128i special = _mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+                                   _mm_cmpeq_epi8(chunk, backslash));
+    if (emitUTF8)
+      special = _mm_or_si128(
+          special, _mm_cmpeq_epi8(_mm_min_epu8(chunk, lastControl), chunk));
+    else // signed compare: bytes >= 0x80 are negative
+      special = _mm_or_si128(special, _mm_cmplt_epi8(chunk, space));
+    const unsigned int mask =
+        static_cast<unsigned int>(_mm_movemask_epi8(special));
+    if (mask != 0)
+      return index + lowestSetBit(mask);
+  }
+  return index + countScalar(value + index, length - index, emitUTF8);
+}
+#endif // JSON_ESCAPE_SSE2
+
+#if defined(JSON_ESCAPE_AVX2)
+JSON_ESCAPE_TARGET_AVX2
+size_t countAVX2(const char* value, size_t length, bool emitUTF8) {
+  if (length < 32)
+    return countSSE2(value, length, emitUTF8);
+
+  const __m256i quote = _mm256_set1_epi8('"');
+  const __m256i backslash = _mm256_set1_epi8('\\');
+  const __m256i space = _mm256_set1_epi8(0x20);
+  const __m256i lastControl = _mm256_set1_epi8(0x1F);
+  size_t index = 0;
+  for (; index + 32 <= length; index += 32) {
+    const __m256i chunk =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(value + index));
+    __m256i special = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote),
+                                      _mm256_cmpeq_epi8(chunk, backslash));
+    if (emitUTF8)
+      special = _mm256_or_si256(
+          special,
+          _mm256_cmpeq_epi8(_mm256_min_epu8(chunk, lastControl), chunk));
+    else // signed compare: bytes >= 0x80 are negative
+      special = _mm256_or_si256(special, _mm256_cmpgt_epi8(space, chunk));
+    const unsigned int mask =
+        static_cast<unsigned int>(_mm256_movemask_epi8(special));
+    if (mask != 0) {
+      _mm256_zeroupper();
+      return index + lowestSetBit(mask);
+    }
+  }
+  // Clear the upper halves before running legacy SSE code again.
+  _mm256_zeroupper();
+  return index + countSSE2(value + index, length - index, emitUTF8);
+}
+
+bool cpuSupportsAVX2() {
+#if defined(_MSC_VER) && !defined(__clang__)
+  int info[4] = {0, 0, 0, 0};
+  __cpuid(info, 0);
+  if (info[0] < 7)
+    return false;
+  __cpuid(info, 1);
+  const bool osSavesYmm = (info[2] & (1 << 27)) != 0 && // OSXSAVE
+                          (_xgetbv(0) & 0x6) == 0x6;
+  if (!osSavesYmm)
+    return false;
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#else
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+#endif // JSON_ESCAPE_AVX2
+
+#if defined(JSON_ESCAPE_NEON)
+size_t countNEON(const char* value, size_t length, bool emitUTF8) {
+  const uint8x16_t quote = vdupq_n_u8('"');
+  const uint8x16_t backslash = vdupq_n_u8('\\');
+  const uint8x16_t space = vdupq_n_u8(0x20);
+  const uint8x16_t firstNonAscii = vdupq_n_u8(0x80);
+  size_t index = 0;
+  for (; index + 16 <= length; index += 16) {
+    const uint8x16_t chunk =
+        vld1q_u8(reinterpret_cast<const uint8_t*>(value + index));
+    uint8x16_t special =
+        vorrq_u8(vorrq_u8(vceqq_u8(chunk, quote), vceqq_u8(chunk, backslash)),
+                 vcltq_u8(chunk, space));
+    if (!emitUTF8)
+      special = vorrq_u8(special, vcgeq_u8(chunk, firstNonAscii));
+    const uint64x2_t halves = vreinterpretq_u64_u8(special);
+    if ((vgetq_lane_u64(halves, 0) | vgetq_lane_u64(halves, 1)) != 0)
+      return index + countScalar(value + index, 16, emitUTF8);
+  }
+  return index + countScalar(value + index, length - index, emitUTF8);
+}
+#endif // JSON_ESCAPE_NEON
+
+CountFunction selectKernel() {
+#if defined(JSON_ESCAPE_AVX2)
+  if (cpuSupportsAVX2())
+    return &countAVX2;
+#endif
+#if defined(JSON_ESCAPE_SSE2)
+  return &countSSE2;
+#elif defined(JSON_ESCAPE_NEON)
+  return &countNEON;
+#else
+  return &countScalar;
+#endif
+}
+
+} // namespace
+
+size_t countUnescapedPrefix(const char* value, size_t length, bool emitUTF8) {
+  static const CountFunction kernel = selectKernel();
+  return kernel(value, length, emitUTF8);
+}
+
+} // namespace Json
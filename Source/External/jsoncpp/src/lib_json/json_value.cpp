@@ -12,8 +12,10 @@
 #include <cassert>
 #include <cmath>
 #include <cstddef>
+#include <cstdint>
 #include <cstring>
 #include <iostream>
+#include <new>
 #include <sstream>
 #include <utility>
 
@@ -105,6 +107,67 @@ static inline bool InRange(double d, T min, U max) {
 }
 #endif // if !defined(JSON_USE_INT64_DOUBLE_CONVERSION)
 
+namespace {
+// Keeps the payload aligned like malloc() does.
+const size_t blockHeaderSize = alignof(std::max_align_t);
+const uintptr_t heapBlockTag = 0;
+const uintptr_t resourceBlockTag = 1;
+
+thread_local MemoryResource* currentResource = nullptr;
+} // namespace
+
+MemoryResource::~MemoryResource() = default;
+
+MemoryResourceScope::MemoryResourceScope(MemoryResource* resource)
+    : previous_(currentResource) {
+  currentResource = resource;
+}
+
+MemoryResourceScope::~MemoryResourceScope() { currentResource = previous_; }
+
+namespace detail {
+void* allocateBlock(size_t bytes) {
+  MemoryResource* resource = currentResource;
+  void* block = resource ? resource->allocate(blockHeaderSize + bytes)
+                         : malloc(blockHeaderSize + bytes);
+  if (block == nullptr)
+    throwRuntimeError("in Json::detail::allocateBlock(): "
+                      "Failed to allocate value memory");
+  *static_cast<uintptr_t*>(block) = resource ? resourceBlockTag : heapBlockTag;
+  return static_cast<char*>(block) + blockHeaderSize;
+}
+
+void releaseBlock(void* block) {
+  if (block == nullptr)
+    return;
+  void* header = static_cast<char*>(block) - blockHeaderSize;
+  // Memory of a MemoryResource is reclaimed by its owner in one go.
+  if (*static_cast<uintptr_t*>(header) == heapBlockTag)
+    free(header);
+}
+} // namespace detail
+
+// The map itself is placed like its nodes, see MemoryResource.
+template <typename... Args>
+static Value::ObjectValues* newObjectValues(Args&&... args) {
+  void* block = detail::allocateBlock(sizeof(Value::ObjectValues));
+#if JSON_USE_EXCEPTION
+  try {
+    return new (block) Value::ObjectValues(std::forward<Args>(args)...);
+  } catch (...) {
+    detail::releaseBlock(block);
+    throw;
+  }
+#else
+  return new (block) Value::ObjectValues(std::forward<Args>(args)...);
+#endif
+}
+
+static void deleteObjectValues(Value::ObjectValues* map) {
+  map->~map();
+  detail::releaseBlock(map);
+}
+
 /** Duplicates the specified string value.
  * @param value Pointer to the string to duplicate. Must be zero-terminated if
  *              length is "unknown".
@@ -118,7 +181,7 @@ static inline char* duplicateStringValue(const char* value, size_t length) {
   if (length >= static_cast<size_t>(Value::maxInt))
     length = Value::maxInt - 1;
 
-  auto newString = static_cast<char*>(malloc(length + 1));
+  auto newString = static_cast<char*>(detail::allocateBlock(length + 1));
   if (newString == nullptr) {
     throwRuntimeError("in Json::Value::duplicateStringValue(): "
                       "Failed to allocate string value buffer");
@@ -139,7 +202,7 @@ static inline char* duplicateAndPrefixStringValue(const char* value,
                       "in Json::Value::duplicateAndPrefixStringValue(): "
                       "length too big for prefixing");
   size_t actualLength = sizeof(length) + length + 1;
-  auto newString = static_cast<char*>(malloc(actualLength));
+  auto newString = static_cast<char*>(detail::allocateBlock(actualLength));
   if (newString == nullptr) {
     throwRuntimeError("in Json::Value::duplicateAndPrefixStringValue(): "
                       "Failed to allocate string value buffer");
@@ -170,17 +233,21 @@ static inline void releasePrefixedStringValue(char* value) {
   decodePrefixedString(true, value, &length, &valueDecoded);
   size_t const size = sizeof(unsigned) + length + 1U;
   memset(value, 0, size);
-  free(value);
+  detail::releaseBlock(value);
 }
 static inline void releaseStringValue(char* value, unsigned length) {
   // length==0 => we allocated the strings memory
   size_t size = (length == 0) ? strlen(value) : length;
   memset(value, 0, size);
-  free(value);
+  detail::releaseBlock(value);
 }
 #else  // !JSONCPP_USING_SECURE_MEMORY
-static inline void releasePrefixedStringValue(char* value) { free(value); }
-static inline void releaseStringValue(char* value, unsigned) { free(value); }
+static inline void releasePrefixedStringValue(char* value) {
+  detail::releaseBlock(value);
+}
+static inline void releaseStringValue(char* value, unsigned) {
+  detail::releaseBlock(value);
+}
 #endif // JSONCPP_USING_SECURE_MEMORY
 
 } // namespace Json
@@ -363,7 +430,7 @@ Value::Value(ValueType type) {
     break;
   case arrayValue:
   case objectValue:
-    value_.map_ = new ObjectValues();
+    value_.map_ = newObjectValues();
     break;
   case booleanValue:
     value_.bool_ = false;
@@ -998,7 +1065,7 @@ void Value::dupPayload(const Value& other) {
     break;
   case arrayValue:
   case objectValue:
-    value_.map_ = new ObjectValues(*other.value_.map_);
+    value_.map_ = newObjectValues(*other.value_.map_);
     break;
   default:
     JSON_ASSERT_UNREACHABLE;
@@ -1019,7 +1086,7 @@ void Value::releasePayload() {
     break;
   case arrayValue:
   case objectValue:
-    delete value_.map_;
+    deleteObjectValues(value_.map_);
     break;
   default:
     JSON_ASSERT_UNREACHABLE;
@@ -177,14 +177,6 @@ String valueToString(double value, unsigned int precision,
 
 String valueToString(bool value) { return value ? "true" : "false"; }
 
-static bool doesAnyCharRequireEscaping(char const* s, size_t n) {
-  assert(s || !n);
-
-  return std::any_of(s, s + n, [](unsigned char c) {
-    return c == '\\' || c == '"' || c < 0x20 || c > 0x7F;
-  });
-}
-
 static unsigned int utf8ToCodepoint(const char*& s, const char* e) {
   const unsigned int REPLACEMENT_CHARACTER = 0xFFFD;
 
@@ -277,8 +269,15 @@ static String valueToQuotedStringN(const char* value, size_t length,
   if (value == nullptr)
     return "";
 
-  if (!doesAnyCharRequireEscaping(value, length))
-    return String("\"") + value + "\"";
+  size_t run = countUnescapedPrefix(value, length, emitUTF8);
+  if (run == length) {
+    String quoted;
+    quoted.reserve(length + 2);
+    quoted += '"';
+    quoted.append(value, length);
+    quoted += '"';
+    return quoted;
+  }
   // We have to walk value and escape any special characters.
   // Appending to String is not efficient, but this should be rare.
   // (Note: forward slashes are *not* rare, but I am not escaping them.)
@@ -288,6 +287,12 @@ static String valueToQuotedStringN(const char* value, size_t length,
   result += "\"";
   char const* end = value + length;
   for (const char* c = value; c != end; ++c) {
+    // Copy the run of plain characters up to the next one to escape.
+    run = countUnescapedPrefix(c, static_cast<size_t>(end - c), emitUTF8);
+    result.append(c, run);
+    c += run;
+    if (c == end)
+      break;
     switch (*c) {
     case '\"':
       result += "\\\"";
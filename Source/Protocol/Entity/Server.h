@@ -3,9 +3,27 @@
 // ǱҪ£ֹʹضϵͳƽ̨API
 
 #include <memory>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <mutex>
 #include "../Public/PublicDef.h"
+#include "../Message/JsonParser.h"
 #include "../Session/Session.h"
+#include "../Session/SessionManager.h"
+#include "../Session/ServerDefinition.h"
+#include "../Task/TypedTool.h"
 #include "../Transport/Transport.h"
+#include "../Transport/HttpSseTransport.h"
+#include "../Transport/LocalTransport.h"
+#include "../Transport/RecordingTransport.h"
+#include "../Public/Config.h"
 
 namespace MCP
 {
@@ -22,70 +40,412 @@ namespace MCP
 
 		void SetServerInfo(const MCP::Implementation& serverInfo)
 		{
-			MCP::CMCPSession::GetInstance().SetServerInfo(serverInfo);
+			m_spDefinition->serverInfo = serverInfo;
 		}
 
+		// Serves a single client over the transport (stdio by default).
 		void SetTransport(const std::shared_ptr<MCP::CMCPTransport>& spTransport)
 		{
-			MCP::CMCPSession::GetInstance().SetTransport(spTransport);
+			m_spTransport = spTransport;
+		}
+
+		// Serves every client accepted by the listener, each in its own session.
+		void SetListener(const std::shared_ptr<MCP::CMCPListener>& spListener)
+		{
+			m_spListener = spListener;
 		}
 
 		void RegisterServerToolsCapabilities(const MCP::Tools& tools)
 		{
-			m_capabilities.tools = tools;
+			m_spDefinition->capabilities.tools = tools;
 		}
 
 		void RegisterServerResourcesCapabilities(const MCP::Resources& resources)
 		{
-			m_capabilities.resources = resources;
+			m_spDefinition->capabilities.resources = resources;
 		}
 
 		void RegisterServerPromptsCapabilities(const MCP::Prompts& prompts)
 		{
-			m_capabilities.prompts = prompts;
+			m_spDefinition->capabilities.prompts = prompts;
+		}
+
+		// logging/setLevel is always served; this only announces it.
+		void RegisterServerLoggingCapabilities(const MCP::Logging& logging)
+		{
+			m_spDefinition->capabilities.logging = logging;
+		}
+
+		// With pagination, nPageSize items are returned per page (0 takes [pagination] from the configuration).
+		// The lists can be registered again while serving; cursors already handed out stay valid.
+		// Registering tools while serving sends notifications/tools/list_changed when the tools
+		// capabilities announce listChanged; register the tasks of new tools first.
+		void RegisterServerTools(const std::vector<MCP::Tool>& tools, bool bPagination, size_t nPageSize = 0)
+		{
+			{
+				std::lock_guard<std::mutex> _lock(m_mtxTools);
+				ReplaceServerTools(std::vector<MCP::Tool>(tools), bPagination);
+				m_spDefinition->toolsList.Build(tools, [](const MCP::Tool& tool) { return tool.strName; },
+					GetPageSize(MSG_KEY_TOOLS, bPagination, nPageSize));
+			}
+			m_sessionManager.NotifyToolsChanged();
+		}
+
+		// Writes the registered tools, serialized as tools/list returns them, to a snapshot file for
+		// LoadServerToolsSnapshot(). The file is replaced as a whole, never left half written.
+		int SaveServerToolsSnapshot(const std::string& strPath)
+		{
+			std::string strSnapshot;
+			int iErrCode = BuildToolsSnapshotHeader(strSnapshot);
+			if (ERRNO_OK != iErrCode)
+				return iErrCode;
+			strSnapshot += '\n';
+			auto spTools = std::atomic_load(&m_spDefinition->spTools);
+			std::string strTool;
+			for (auto& tool : spTools->vecTools)
+			{
+				iErrCode = MCP::CMCPListCache::SerializeItem(tool, strTool);
+				if (ERRNO_OK != iErrCode)
+					return iErrCode;
+				strSnapshot += strTool;
+				strSnapshot += '\n';
+			}
+
+			std::string strTempPath = strPath + ".tmp";
+			{
+				std::ofstream ofs(strTempPath, std::ios::binary | std::ios::trunc);
+				if (!ofs.write(strSnapshot.data(), static_cast<std::streamsize>(strSnapshot.size())) || !ofs.flush())
+					return ERRNO_INTERNAL_ERROR;
+			}
+			std::remove(strPath.c_str());
+			if (0 != std::rename(strTempPath.c_str(), strPath.c_str()))
+				return ERRNO_INTERNAL_ERROR;
+
+			return ERRNO_OK;
+		}
+
+		// Registers the tools of a snapshot written by SaveServerToolsSnapshot(), instead of
+		// RegisterServerTools(): the items are listed with the bytes of the file, without serializing
+		// them again, and their schemas are compiled on first call. Register the tasks of the tools
+		// first: the snapshot belongs to the server name and version and to the tool tasks it was
+		// written with, and lists only tools with a task. Any other is refused with
+		// ERRNO_INVALID_PARAMS, as are missing or damaged files, and nothing is registered then.
+		// A tool whose description or schema changed needs a new server version.
+		int LoadServerToolsSnapshot(const std::string& strPath, bool bPagination, size_t nPageSize = 0)
+		{
+			std::ifstream ifs(strPath, std::ios::binary);
+			if (!ifs)
+				return ERRNO_INVALID_PARAMS;
+			std::string strLine;
+			std::string strHeader;
+			if (!std::getline(ifs, strLine) || ERRNO_OK != BuildToolsSnapshotHeader(strHeader) || strLine != strHeader)
+				return ERRNO_INVALID_PARAMS;
+			auto spRegistered = std::atomic_load(&m_spDefinition->spTools);
+
+			std::vector<MCP::Tool> vecTools;
+			std::vector<std::pair<std::string, std::string>> vecSerialized;
+			MCP::CMCPJsonParser parser;
+			Json::Value jTool;
+			while (std::getline(ifs, strLine))
+			{
+				if (strLine.empty())
+					continue;
+				MCP::Tool tool;
+				if (!parser.Parse(strLine, jTool) || ERRNO_OK != tool.DoDeserialize(jTool) || !tool.IsValid()
+					|| !spRegistered->hashCallToolsPools.count(tool.strName))
+					return ERRNO_INVALID_PARAMS;
+				vecSerialized.emplace_back(tool.strName, std::move(strLine));
+				vecTools.push_back(std::move(tool));
+			}
+
+			{
+				std::lock_guard<std::mutex> _lock(m_mtxTools);
+				ReplaceServerTools(std::move(vecTools), bPagination);
+				m_spDefinition->toolsList.BuildSerialized(std::move(vecSerialized),
+					GetPageSize(MSG_KEY_TOOLS, bPagination, nPageSize));
+			}
+			m_sessionManager.NotifyToolsChanged();
+
+			return ERRNO_OK;
+		}
+
+		void RegisterServerResources(const std::vector<MCP::Resource>& resources, bool bPagination, size_t nPageSize = 0)
+		{
+			m_spDefinition->resourcesList.Build(resources, [](const MCP::Resource& resource) { return resource.strUri; },
+				GetPageSize(MSG_KEY_RESOURCES, bPagination, nPageSize));
+		}
+
+		// Serves resources/read from the provider, and lists its resources like RegisterServerResources().
+		int RegisterResourceProvider(const std::shared_ptr<MCP::CMCPResourceProvider>& spProvider, bool bPagination, size_t nPageSize = 0)
+		{
+			if (!spProvider)
+				return ERRNO_INTERNAL_ERROR;
+			std::vector<MCP::Resource> vecResources;
+			int iErrCode = spProvider->ListResources(vecResources);
+			if (ERRNO_OK != iErrCode)
+				return iErrCode;
+			m_spDefinition->spResourceProvider = spProvider;
+			RegisterServerResources(vecResources, bPagination, nPageSize);
+
+			return ERRNO_OK;
+		}
+
+		void RegisterServerPrompts(const std::vector<MCP::Prompt>& prompts, bool bPagination, size_t nPageSize = 0)
+		{
+			m_spDefinition->promptsList.Build(prompts, [](const MCP::Prompt& prompt) { return prompt.strName; },
+				GetPageSize(MSG_KEY_PROMPTS, bPagination, nPageSize));
+		}
+
+		// nMaxConcurrency limits how many calls of this tool run at the same time (0 = unlimited).
+		// It can be overridden per tool in the [tool_limits] section of the configuration.
+		// spTask is the prototype: calls are served by clones of it, recycled through ProcessCallToolRequest::Reset().
+		// A tool whose result only depends on its arguments can pass nCacheTtlMs: calls with the same
+		// arguments are then answered from a cache for that long, without running the tool. It can be
+		// overridden per tool in the [tool_cache] section of the configuration.
+		void RegisterToolsTasks(const std::string& strToolName, std::shared_ptr<MCP::ProcessCallToolRequest> spTask, size_t nMaxConcurrency = 0,
+			unsigned int nCacheTtlMs = 0)
+		{
+			int iPoolSize = Config::GetInstance().GetToolPoolSize();
+			RegisterToolsPool(strToolName, std::make_shared<MCP::CMCPTaskPool>(spTask, iPoolSize > 0 ? static_cast<size_t>(iPoolSize) : 0),
+				nMaxConcurrency, nCacheTtlMs);
+		}
+
+		// As RegisterToolsTasks(), the prototype being made by fnCreateTask on the first call of the
+		// tool rather than now, for tools that load models, open connections or otherwise take long
+		// to construct. fnCreateTask runs in the session of the first call, and other calls of the tool
+		// wait for it; it may return nullptr to fail the call, it is then tried again on the next one.
+		void RegisterLazyToolsTasks(const std::string& strToolName, MCP::CMCPTaskPool::PrototypeFactory fnCreateTask,
+			size_t nMaxConcurrency = 0, unsigned int nCacheTtlMs = 0)
+		{
+			int iPoolSize = Config::GetInstance().GetToolPoolSize();
+			RegisterToolsPool(strToolName, std::make_shared<MCP::CMCPTaskPool>(std::move(fnCreateTask),
+				iPoolSize > 0 ? static_cast<size_t>(iPoolSize) : 0), nMaxConcurrency, nCacheTtlMs);
+		}
+
+		// Registers the task of a tool taking the arguments struct Args (see Task/TypedTool.h), served by
+		// fn(Args&, MCP::CallToolResult&) returning ERRNO_OK or an error. Returns the tool, with the input
+		// schema generated from Args, to be listed with RegisterServerTools(); the other parameters are
+		// those of RegisterToolsTasks().
+		template <class Args, class Fn>
+		MCP::Tool RegisterTool(const std::string& strName, const std::string& strDescription, Fn fn, size_t nMaxConcurrency = 0,
+			unsigned int nCacheTtlMs = 0)
+		{
+			RegisterToolTask<Args>(strName, std::move(fn), nMaxConcurrency, nCacheTtlMs);
+			return DescribeTool<Args>(strName, strDescription);
+		}
+
+		// The two halves of RegisterTool(), for servers listing their tools from a snapshot: the task
+		// is always registered, the tool only described when the snapshot cannot be loaded.
+		template <class Args, class Fn>
+		void RegisterToolTask(const std::string& strName, Fn fn, size_t nMaxConcurrency = 0, unsigned int nCacheTtlMs = 0)
+		{
+			auto spFn = std::make_shared<const Fn>(std::move(fn));
+			RegisterToolsTasks(strName, std::make_shared<MCP::ProcessTypedCallToolRequest<Args, Fn>>(nullptr, spFn),
+				nMaxConcurrency, nCacheTtlMs);
 		}
 
-		void RegisterServerTools(const std::vector<MCP::Tool>& tools, bool bPagination)
+		template <class Args>
+		static MCP::Tool DescribeTool(const std::string& strName, const std::string& strDescription)
 		{
-			MCP::CMCPSession::GetInstance().SetServerToolsPagination(bPagination);
-			MCP::CMCPSession::GetInstance().SetServerTools(tools);
+			MCP::Tool tool;
+			tool.strName = strName;
+			tool.strDescription = strDescription;
+			tool.jInputSchema = MCP::BuildInputSchema<Args>();
+			return tool;
 		}
 
-		void RegisterToolsTasks(const std::string& strToolName, std::shared_ptr<MCP::ProcessCallToolRequest> spTask)
+		// Adds a handler for a method the SDK does not implement (e.g. prompts/get,
+		// completion/complete or vendor extensions), or replaces a built-in handler.
+		int RegisterMethod(const std::string& strMethod, MessageCategory eCategory, MCP::MessageFactory fnCreate, MCP::MethodHandler fnHandle)
 		{
-			m_hashCallToolsTasks[strToolName] = spTask;
+			return m_spDefinition->methodRegistry.Register(strMethod, eCategory, std::move(fnCreate), std::move(fnHandle));
 		}
 
 		virtual int Initialize() = 0;
 
+		// Blocks until the stdio (or shm) client disconnects, or until RequestStop() when serving a listener.
 		int Start()
 		{
-			if (!MCP::CMCPSession::GetInstance().GetTransport())
-				MCP::CMCPSession::GetInstance().SetTransport(std::make_shared<CStdioTransport>());
-			MCP::CMCPSession::GetInstance().SetServerCapabilities(m_capabilities);
-			MCP::CMCPSession::GetInstance().SetServerCallToolsTasks(m_hashCallToolsTasks);
+			if (!m_spTransport && !m_spListener)
+			{
+				auto& config = Config::GetInstance();
+				std::string strTransport = config.GetServerTransport();
+				if (strTransport == "http")
+					m_spListener = std::make_shared<CHttpSseListener>();
+				else if (strTransport == "unix")
+					m_spListener = std::make_shared<CUnixSocketListener>();
+				else if (strTransport == "shm")
+					m_spTransport = std::make_shared<CShmRingTransport>(config.GetLocalShmName(), true);
+				else
+					m_spTransport = std::make_shared<CStdioTransport>();
+			}
+			auto spHttpListener = std::dynamic_pointer_cast<CHttpSseListener>(m_spListener);
+
+			// The sessions are recorded for CMCPTrafficReplay when [recording] names a file.
+			std::string strRecording = Config::GetInstance().GetRecordingFile();
+			if (!strRecording.empty())
+			{
+				m_spRecorder = std::make_shared<MCP::CMCPTrafficRecorder>();
+				if (ERRNO_OK != m_spRecorder->Open(strRecording))
+					return ERRNO_INTERNAL_ERROR;
+				if (m_spListener)
+					m_spListener = std::make_shared<MCP::CRecordingListener>(m_spListener, m_spRecorder);
+				else
+					m_spTransport = std::make_shared<MCP::CRecordingTransport>(m_spTransport, m_spRecorder);
+			}
+
+			// The definition is shared read-only by the sessions from here on.
+			int iErrCode = m_sessionManager.Start(m_spDefinition);
+			if (ERRNO_OK != iErrCode)
+				return iErrCode;
+
+			if (!m_spListener)
+			{
+				iErrCode = m_sessionManager.RunSession(m_spTransport);
+				if (m_spRecorder)
+					m_spRecorder->Flush();
+				return iErrCode;
+			}
 
-			int iErrCode = MCP::CMCPSession::GetInstance().Ready();
+			if (spHttpListener)
+				spHttpListener->SetMetricsHandler([this]() { return GetMetrics().ToPrometheus(); });
+			iErrCode = m_spListener->Listen([this](const std::shared_ptr<MCP::CMCPTransport>& spTransport)
+				{
+					if (ERRNO_OK != m_sessionManager.StartSession(spTransport))
+						spTransport->Disconnect();
+				});
 			if (ERRNO_OK != iErrCode)
 				return iErrCode;
 
-			MCP::CMCPSession::GetInstance().Run();
+			while (!m_bStopRequested)
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(100));
+			}
 
 			return ERRNO_OK;
 		}
 
+		// Async signal safe: makes Start() return.
+		void RequestStop()
+		{
+			m_bStopRequested = true;
+		}
+
 		int Stop()
 		{
-			MCP::CMCPSession::GetInstance().Terminate();
+			if (m_spListener)
+				m_spListener->Close();
+			m_sessionManager.Stop();
+			if (m_spRecorder)
+				m_spRecorder->Close();
 
 			return ERRNO_OK;
 		}
 
+		// What the server was configured with, for running sessions of one's own on it (e.g.
+		// CMCPTrafficReplay, benchmarks) rather than through Start().
+		std::shared_ptr<const MCP::ServerDefinition> GetDefinition() const
+		{
+			return m_spDefinition;
+		}
+
+		size_t GetSessionCount() const
+		{
+			return m_sessionManager.GetSessionCount();
+		}
+
+		// Per-method and per-tool counters and latencies of every session so far.
+		MCP::MetricsSnapshot GetMetrics() const
+		{
+			return m_sessionManager.GetMetrics().Snapshot();
+		}
+
+		// Tells the sessions subscribed to the resource that it changed. Needed only for providers
+		// without CMCPResourceProvider::GetResourceVersion(), the others are watched by the SDK.
+		void NotifyResourceUpdated(const std::string& strUri)
+		{
+			m_sessionManager.NotifyResourceUpdated(strUri);
+		}
+
 	protected:
-		CMCPServer() = default;
+		CMCPServer()
+			: m_spDefinition(std::make_shared<MCP::ServerDefinition>())
+		{
+			MCP::CMCPSession::RegisterBuiltinMethods(m_spDefinition->methodRegistry);
+		}
 		~CMCPServer() = default;
 
-		MCP::ServerCapabilities m_capabilities;
-		std::unordered_map<std::string, std::shared_ptr<MCP::ProcessCallToolRequest>> m_hashCallToolsTasks;
+		static size_t GetPageSize(const char* lpcszList, bool bPagination, size_t nPageSize)
+		{
+			if (!bPagination)
+				return 0;
+			if (nPageSize > 0)
+				return nPageSize;
+			int iPageSize = Config::GetInstance().GetListPageSize(lpcszList);
+			return iPageSize > 0 ? static_cast<size_t>(iPageSize) : 0;
+		}
+
+		// The first line of a tools snapshot: the server info, and a fingerprint of the names of the
+		// registered tool tasks (FNV-1a over the sorted names, which the file must outlive builds).
+		int BuildToolsSnapshotHeader(std::string& strHeader)
+		{
+			std::string strServerInfo;
+			int iErrCode = MCP::CMCPListCache::SerializeItem(m_spDefinition->serverInfo, strServerInfo);
+			if (ERRNO_OK != iErrCode)
+				return iErrCode;
+			auto spTools = std::atomic_load(&m_spDefinition->spTools);
+			std::vector<std::string> vecNames;
+			vecNames.reserve(spTools->hashCallToolsPools.size());
+			for (auto& itrPool : spTools->hashCallToolsPools)
+				vecNames.push_back(itrPool.first);
+			std::sort(vecNames.begin(), vecNames.end());
+			unsigned long long ullHash = 14695981039346656037ULL;
+			for (auto& strName : vecNames)
+			{
+				// The terminating zero separates the names.
+				for (size_t i = 0; i <= strName.size(); ++i)
+				{
+					ullHash ^= static_cast<unsigned char>(strName.c_str()[i]);
+					ullHash *= 1099511628211ULL;
+				}
+			}
+			char szHash[17];
+			snprintf(szHash, sizeof(szHash), "%016llx", ullHash);
+
+			strHeader = "{\"serverInfo\":" + strServerInfo + ",\"tasks\":\"" + szHash + "\"}";
+			return ERRNO_OK;
+		}
+
+		// Locked by the caller; the list is built by the caller too.
+		void ReplaceServerTools(std::vector<MCP::Tool>&& vecTools, bool bPagination)
+		{
+			auto spTools = std::make_shared<MCP::ServerTools>(*std::atomic_load(&m_spDefinition->spTools));
+			spTools->bPagination = bPagination;
+			spTools->hashValidators.clear();
+			for (auto& tool : vecTools)
+				spTools->hashValidators[tool.strName] = std::make_shared<MCP::CMCPLazySchemaValidator>(tool.jInputSchema);
+			spTools->vecTools = std::move(vecTools);
+			std::atomic_store(&m_spDefinition->spTools, std::shared_ptr<const MCP::ServerTools>(std::move(spTools)));
+		}
+
+		void RegisterToolsPool(const std::string& strToolName, std::shared_ptr<MCP::CMCPTaskPool> spPool, size_t nMaxConcurrency,
+			unsigned int nCacheTtlMs)
+		{
+			std::lock_guard<std::mutex> _lock(m_mtxTools);
+			auto spTools = std::make_shared<MCP::ServerTools>(*std::atomic_load(&m_spDefinition->spTools));
+			spTools->hashCallToolsPools[strToolName] = std::move(spPool);
+			spTools->hashToolsConcurrency[strToolName] = nMaxConcurrency;
+			spTools->hashToolsCacheTtl[strToolName] = nCacheTtlMs;
+			std::atomic_store(&m_spDefinition->spTools, std::shared_ptr<const MCP::ServerTools>(std::move(spTools)));
+		}
+
+		std::shared_ptr<MCP::ServerDefinition> m_spDefinition;
+		// Serializes the copy-and-replace of the tools between concurrent registrations.
+		std::mutex m_mtxTools;
+		std::shared_ptr<MCP::CMCPTransport> m_spTransport;
+		std::shared_ptr<MCP::CMCPListener> m_spListener;
+		std::shared_ptr<MCP::CMCPTrafficRecorder> m_spRecorder;
+		MCP::CMCPSessionManager m_sessionManager;
+		std::atomic_bool m_bStopRequested{ false };
 	};
 }
@@ -1,5 +1,7 @@
 #include "BasicMessage.h"
+#include "../Public/Base64.h"
 #include <json/json.h>
+#include <cstring>
 
 namespace MCP
 {
@@ -7,45 +9,47 @@ namespace MCP
 	// RequestId
 	int RequestId::DoSerialize(Json::Value & jMsg) const
 	{
-		std::string strMsgKey = MSG_KEY_ID;
-		if (!_strMsgKey.empty())
-			strMsgKey = _strMsgKey;
+		if (DataType_String == eIdDataType)
+			jMsg[_lpcszMsgKey] = strId;
+		else if (DataType_Integer == eIdDataType)
+			jMsg[_lpcszMsgKey] = iId;
 
+		return ERRNO_OK;
+	}
+
+	void RequestId::WriteMember(CMCPJsonWriter& writer) const
+	{
 		if (DataType_String == eIdDataType)
 		{
-			Json::Value jId(strId);
-			jMsg[strMsgKey] = jId;
+			writer.Key(_lpcszMsgKey);
+			writer.String(strId);
 		}
 		else if (DataType_Integer == eIdDataType)
 		{
-			Json::Value jId(iId);
-			jMsg[strMsgKey] = jId;
+			writer.Key(_lpcszMsgKey);
+			writer.Int(iId);
 		}
-
-		return ERRNO_OK;
 	}
 
 	int RequestId::DoDeserialize(const Json::Value& jMsg)
 	{
-		std::string strMsgKey = MSG_KEY_ID;
-		if (!_strMsgKey.empty())
-			strMsgKey = _strMsgKey;
-
-		if (!jMsg.isMember(strMsgKey))
+		// One lookup instead of one per check, and no key string built for it.
+		const Json::Value* pjId = jMsg.find(_lpcszMsgKey, _lpcszMsgKey + strlen(_lpcszMsgKey));
+		if (!pjId)
 			return ERRNO_INVALID_REQUEST;
-		bool bStrId = jMsg[strMsgKey].isString();
-		bool bIntId = jMsg[strMsgKey].isIntegral();
+		bool bStrId = pjId->isString();
+		bool bIntId = pjId->isIntegral();
 		if (!bStrId && !bIntId)
 			return ERRNO_INVALID_REQUEST;
 		if (bStrId)
 		{
 			eIdDataType = DataType_String;
-			strId = jMsg[strMsgKey].asString();
+			strId = pjId->asString();
 		}
 		if (bIntId)
 		{
 			eIdDataType = DataType_Integer;
-			iId = jMsg[strMsgKey].asInt();
+			iId = pjId->asInt();
 		}
 
 		return ERRNO_OK;
@@ -67,9 +71,9 @@ namespace MCP
 	int Implementation::DoSerialize(Json::Value& jMsg) const
 	{
 		Json::Value jName(strName);
-		jMsg[MSG_KEY_NAME] = jName;
+		jMsg[MSG_KEY_NAME] = std::move(jName);
 		Json::Value jVersion(strVersion);
-		jMsg[MSG_KEY_VERSION] = jVersion;
+		jMsg[MSG_KEY_VERSION] = std::move(jVersion);
 
 		return ERRNO_OK;
 	}
@@ -97,7 +101,7 @@ namespace MCP
 	int Prompts::DoSerialize(Json::Value& jMsg) const
 	{
 		Json::Value jListChanged(bListChanged);
-		jMsg[MSG_KEY_LISTCHANGED] = jListChanged;
+		jMsg[MSG_KEY_LISTCHANGED] = std::move(jListChanged);
 
 		return ERRNO_OK;
 	}
@@ -120,9 +124,9 @@ namespace MCP
 	int Resources::DoSerialize(Json::Value& jMsg) const
 	{
 		Json::Value jListChanged(bListChanged);
-		jMsg[MSG_KEY_LISTCHANGED] = jListChanged;
+		jMsg[MSG_KEY_LISTCHANGED] = std::move(jListChanged);
 		Json::Value jSubscribe(bSubscribe);
-		jMsg[MSG_KEY_SUBSCRIBE] = jSubscribe;
+		jMsg[MSG_KEY_SUBSCRIBE] = std::move(jSubscribe);
 
 		return ERRNO_OK;
 	}
@@ -147,7 +151,7 @@ namespace MCP
 	int Tools::DoSerialize(Json::Value& jMsg) const
 	{
 		Json::Value jListChanged(bListChanged);
-		jMsg[MSG_KEY_LISTCHANGED] = jListChanged;
+		jMsg[MSG_KEY_LISTCHANGED] = std::move(jListChanged);
 
 		return ERRNO_OK;
 	}
@@ -165,6 +169,23 @@ namespace MCP
 		return true;
 	}
 
+	////////////////////////////////////////////////////////////////////////////////////////
+	// Logging
+	int Logging::DoSerialize(Json::Value& /*jMsg*/) const
+	{
+		return ERRNO_OK;
+	}
+
+	int Logging::DoDeserialize(const Json::Value& /*jMsg*/)
+	{
+		return ERRNO_OK;
+	}
+
+	bool Logging::IsValid() const
+	{
+		return true;
+	}
+
 	////////////////////////////////////////////////////////////////////////////////////////
 	// ServerCapabilities
 	int ServerCapabilities::DoSerialize(Json::Value& jMsg) const
@@ -176,7 +197,7 @@ namespace MCP
 				Json::Value jMember(Json::objectValue);
 				if (ERRNO_OK == msgObj.DoSerialize(jMember))
 				{
-					jMsg[lpcszKey] = jMember;
+					jMsg[lpcszKey] = std::move(jMember);
 				}
 			}
 		};
@@ -184,6 +205,7 @@ namespace MCP
 		fnSerializeMember(prompts, MSG_KEY_PROMPTS);
 		fnSerializeMember(resources, MSG_KEY_RESOURCES);
 		fnSerializeMember(tools, MSG_KEY_TOOLS);
+		fnSerializeMember(logging, MSG_KEY_LOGGING);
 
 		return ERRNO_OK;
 	}
@@ -203,6 +225,7 @@ namespace MCP
 		fnDeserializeMember(prompts, MSG_KEY_PROMPTS);
 		fnDeserializeMember(resources, MSG_KEY_RESOURCES);
 		fnDeserializeMember(tools, MSG_KEY_TOOLS);
+		fnDeserializeMember(logging, MSG_KEY_LOGGING);
 
 		return ERRNO_OK;
 	}
@@ -217,12 +240,12 @@ namespace MCP
 	int Tool::DoSerialize(Json::Value& jMsg) const
 	{
 		Json::Value jName(strName);
-		jMsg[MSG_KEY_NAME] = jName;
+		jMsg[MSG_KEY_NAME] = std::move(jName);
 
 		if (!strDescription.empty())
 		{
 			Json::Value jDesc(strDescription);
-			jMsg[MSG_KEY_DESCRIPTION] = jDesc;
+			jMsg[MSG_KEY_DESCRIPTION] = std::move(jDesc);
 		}
 
 		jMsg[MSG_KEY_INPUT_SCHEMA] = jInputSchema;
@@ -262,9 +285,21 @@ namespace MCP
 	int TextContent::DoSerialize(Json::Value& jMsg) const
 	{
 		Json::Value jText(strText);
-		jMsg[MSG_KEY_TEXT] = jText;
+		jMsg[MSG_KEY_TEXT] = std::move(jText);
 		Json::Value jType(strType);
-		jMsg[MSG_KEY_TYPE] = jType;
+		jMsg[MSG_KEY_TYPE] = std::move(jType);
+
+		return ERRNO_OK;
+	}
+
+	int TextContent::DoWrite(CMCPJsonWriter& writer) const
+	{
+		writer.StartObject();
+		writer.Key(MSG_KEY_TEXT);
+		writer.String(strText);
+		writer.Key(MSG_KEY_TYPE);
+		writer.String(strType);
+		writer.EndObject();
 
 		return ERRNO_OK;
 	}
@@ -297,11 +332,37 @@ namespace MCP
 	int ImageContent::DoSerialize(Json::Value& jMsg) const
 	{
 		Json::Value jType(strType);
-		jMsg[MSG_KEY_TYPE] = jType;
+		jMsg[MSG_KEY_TYPE] = std::move(jType);
 		Json::Value jMimeType(strMimeType);
-		jMsg[MSG_KEY_MIMETYPE] = jMimeType;
-		Json::Value jData(strData);
-		jMsg[MSG_KEY_DATA] = jData;
+		jMsg[MSG_KEY_MIMETYPE] = std::move(jMimeType);
+		if (binData.IsEmpty())
+		{
+			Json::Value jData(strData);
+			jMsg[MSG_KEY_DATA] = std::move(jData);
+		}
+		else
+		{
+			std::string strEncoded;
+			Base64::Append(binData.pData, binData.nSize, strEncoded);
+			jMsg[MSG_KEY_DATA] = Json::Value(strEncoded);
+		}
+
+		return ERRNO_OK;
+	}
+
+	int ImageContent::DoWrite(CMCPJsonWriter& writer) const
+	{
+		writer.StartObject();
+		writer.Key(MSG_KEY_DATA);
+		if (binData.IsEmpty())
+			writer.String(strData);
+		else
+			writer.Base64(binData.pData, binData.nSize);
+		writer.Key(MSG_KEY_MIMETYPE);
+		writer.String(strMimeType);
+		writer.Key(MSG_KEY_TYPE);
+		writer.String(strType);
+		writer.EndObject();
 
 		return ERRNO_OK;
 	}
@@ -323,7 +384,7 @@ namespace MCP
 
 	bool ImageContent::IsValid() const
 	{
-		if (strType.empty() || strMimeType.empty() || strData.empty())
+		if (strType.empty() || strMimeType.empty() || (strData.empty() && binData.IsEmpty()))
 			return false;
 
 		if (strType.compare(CONST_IMAGE) != 0)
@@ -337,7 +398,7 @@ namespace MCP
 	int EmbeddedResource::DoSerialize(Json::Value& jMsg) const
 	{
 		Json::Value jType(strType);
-		jMsg[MSG_KEY_TYPE] = jType;
+		jMsg[MSG_KEY_TYPE] = std::move(jType);
 
 		if (textResource.IsValid())
 		{
@@ -345,7 +406,7 @@ namespace MCP
 			int iErrCode = textResource.DoSerialize(jTextResource);
 			if (ERRNO_OK != iErrCode)
 				return iErrCode;
-			jMsg[MSG_KEY_RESOURCE] = jTextResource;
+			jMsg[MSG_KEY_RESOURCE] = std::move(jTextResource);
 		}
 		else if (blobResource.IsValid())
 		{
@@ -353,8 +414,28 @@ namespace MCP
 			int iErrCode = blobResource.DoSerialize(jBlobResouce);
 			if (ERRNO_OK != iErrCode)
 				return iErrCode;
-			jMsg[MSG_KEY_RESOURCE] = jBlobResouce;
+			jMsg[MSG_KEY_RESOURCE] = std::move(jBlobResouce);
+		}
+
+		return ERRNO_OK;
+	}
+
+	int EmbeddedResource::DoWrite(CMCPJsonWriter& writer) const
+	{
+		writer.StartObject();
+		if (textResource.IsValid())
+		{
+			writer.Key(MSG_KEY_RESOURCE);
+			textResource.DoWrite(writer);
+		}
+		else if (blobResource.IsValid())
+		{
+			writer.Key(MSG_KEY_RESOURCE);
+			blobResource.DoWrite(writer);
 		}
+		writer.Key(MSG_KEY_TYPE);
+		writer.String(strType);
+		writer.EndObject();
 
 		return ERRNO_OK;
 	}
@@ -393,15 +474,43 @@ namespace MCP
 	// TextResourceContents
 	int TextResourceContents::DoSerialize(Json::Value& jMsg) const
 	{
-		Json::Value jText(strText);
-		jMsg[MSG_KEY_TEXT] = jText;
+		if (textData.IsEmpty())
+		{
+			Json::Value jText(strText);
+			jMsg[MSG_KEY_TEXT] = std::move(jText);
+		}
+		else
+		{
+			const char* pText = reinterpret_cast<const char*>(textData.pData);
+			jMsg[MSG_KEY_TEXT] = Json::Value(pText, pText + textData.nSize);
+		}
 		Json::Value jUri(strUri);
-		jMsg[MSG_KEY_URI] = jUri;
+		jMsg[MSG_KEY_URI] = std::move(jUri);
 		if (!strMimeType.empty())
 		{
 			Json::Value jMimeType(strMimeType);
-			jMsg[MSG_KEY_MIMETYPE] = jMimeType;
+			jMsg[MSG_KEY_MIMETYPE] = std::move(jMimeType);
+		}
+
+		return ERRNO_OK;
+	}
+
+	int TextResourceContents::DoWrite(CMCPJsonWriter& writer) const
+	{
+		writer.StartObject();
+		if (!strMimeType.empty())
+		{
+			writer.Key(MSG_KEY_MIMETYPE);
+			writer.String(strMimeType);
 		}
+		writer.Key(MSG_KEY_TEXT);
+		if (textData.IsEmpty())
+			writer.String(strText);
+		else
+			writer.String(reinterpret_cast<const char*>(textData.pData), textData.nSize);
+		writer.Key(MSG_KEY_URI);
+		writer.String(strUri);
+		writer.EndObject();
 
 		return ERRNO_OK;
 	}
@@ -422,7 +531,7 @@ namespace MCP
 
 	bool TextResourceContents::IsValid() const
 	{
-		if (strText.empty() || strUri.empty())
+		if ((strText.empty() && textData.IsEmpty()) || strUri.empty())
 			return false;
 
 		return true;
@@ -432,15 +541,44 @@ namespace MCP
 	// BlobResourceContents
 	int BlobResourceContents::DoSerialize(Json::Value& jMsg) const
 	{
-		Json::Value jBlob(strBlob);
-		jMsg[MSG_KEY_BLOB] = jBlob;
+		if (binBlob.IsEmpty())
+		{
+			Json::Value jBlob(strBlob);
+			jMsg[MSG_KEY_BLOB] = std::move(jBlob);
+		}
+		else
+		{
+			std::string strEncoded;
+			Base64::Append(binBlob.pData, binBlob.nSize, strEncoded);
+			jMsg[MSG_KEY_BLOB] = Json::Value(strEncoded);
+		}
 		Json::Value jUri(strUri);
-		jMsg[MSG_KEY_URI] = jUri;
+		jMsg[MSG_KEY_URI] = std::move(jUri);
 		if (!strMimeType.empty())
 		{
 			Json::Value jMimeType(strMimeType);
-			jMsg[MSG_KEY_MIMETYPE] = jMimeType;
+			jMsg[MSG_KEY_MIMETYPE] = std::move(jMimeType);
+		}
+
+		return ERRNO_OK;
+	}
+
+	int BlobResourceContents::DoWrite(CMCPJsonWriter& writer) const
+	{
+		writer.StartObject();
+		writer.Key(MSG_KEY_BLOB);
+		if (binBlob.IsEmpty())
+			writer.String(strBlob);
+		else
+			writer.Base64(binBlob.pData, binBlob.nSize);
+		if (!strMimeType.empty())
+		{
+			writer.Key(MSG_KEY_MIMETYPE);
+			writer.String(strMimeType);
 		}
+		writer.Key(MSG_KEY_URI);
+		writer.String(strUri);
+		writer.EndObject();
 
 		return ERRNO_OK;
 	}
@@ -461,12 +599,162 @@ namespace MCP
 
 	bool BlobResourceContents::IsValid() const
 	{
-		if (strBlob.empty() || strUri.empty())
+		if ((strBlob.empty() && binBlob.IsEmpty()) || strUri.empty())
 			return false;
 
 		return true;
 	}
 
+	////////////////////////////////////////////////////////////////////////////////////////
+	// Resource
+	int Resource::DoSerialize(Json::Value& jMsg) const
+	{
+		Json::Value jUri(strUri);
+		jMsg[MSG_KEY_URI] = std::move(jUri);
+		Json::Value jName(strName);
+		jMsg[MSG_KEY_NAME] = std::move(jName);
+
+		if (!strDescription.empty())
+		{
+			Json::Value jDesc(strDescription);
+			jMsg[MSG_KEY_DESCRIPTION] = std::move(jDesc);
+		}
+
+		if (!strMimeType.empty())
+		{
+			Json::Value jMimeType(strMimeType);
+			jMsg[MSG_KEY_MIMETYPE] = std::move(jMimeType);
+		}
+
+		return ERRNO_OK;
+	}
+
+	int Resource::DoDeserialize(const Json::Value& jMsg)
+	{
+		if (!jMsg.isMember(MSG_KEY_URI) || !jMsg[MSG_KEY_URI].isString())
+			return ERRNO_PARSE_ERROR;
+		strUri = jMsg[MSG_KEY_URI].asString();
+
+		if (!jMsg.isMember(MSG_KEY_NAME) || !jMsg[MSG_KEY_NAME].isString())
+			return ERRNO_PARSE_ERROR;
+		strName = jMsg[MSG_KEY_NAME].asString();
+
+		if (jMsg.isMember(MSG_KEY_DESCRIPTION) && jMsg[MSG_KEY_DESCRIPTION].isString())
+			strDescription = jMsg[MSG_KEY_DESCRIPTION].asString();
+
+		if (jMsg.isMember(MSG_KEY_MIMETYPE) && jMsg[MSG_KEY_MIMETYPE].isString())
+			strMimeType = jMsg[MSG_KEY_MIMETYPE].asString();
+
+		return ERRNO_OK;
+	}
+
+	bool Resource::IsValid() const
+	{
+		if (strUri.empty() || strName.empty())
+			return false;
+
+		return true;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	// PromptArgument
+	int PromptArgument::DoSerialize(Json::Value& jMsg) const
+	{
+		Json::Value jName(strName);
+		jMsg[MSG_KEY_NAME] = std::move(jName);
+
+		if (!strDescription.empty())
+		{
+			Json::Value jDesc(strDescription);
+			jMsg[MSG_KEY_DESCRIPTION] = std::move(jDesc);
+		}
+
+		Json::Value jRequired(bRequired);
+		jMsg[MSG_KEY_REQUIRED] = std::move(jRequired);
+
+		return ERRNO_OK;
+	}
+
+	int PromptArgument::DoDeserialize(const Json::Value& jMsg)
+	{
+		if (!jMsg.isMember(MSG_KEY_NAME) || !jMsg[MSG_KEY_NAME].isString())
+			return ERRNO_PARSE_ERROR;
+		strName = jMsg[MSG_KEY_NAME].asString();
+
+		if (jMsg.isMember(MSG_KEY_DESCRIPTION) && jMsg[MSG_KEY_DESCRIPTION].isString())
+			strDescription = jMsg[MSG_KEY_DESCRIPTION].asString();
+
+		if (jMsg.isMember(MSG_KEY_REQUIRED) && jMsg[MSG_KEY_REQUIRED].isBool())
+			bRequired = jMsg[MSG_KEY_REQUIRED].asBool();
+
+		return ERRNO_OK;
+	}
+
+	bool PromptArgument::IsValid() const
+	{
+		return !strName.empty();
+	}
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	// Prompt
+	int Prompt::DoSerialize(Json::Value& jMsg) const
+	{
+		Json::Value jName(strName);
+		jMsg[MSG_KEY_NAME] = std::move(jName);
+
+		if (!strDescription.empty())
+		{
+			Json::Value jDesc(strDescription);
+			jMsg[MSG_KEY_DESCRIPTION] = std::move(jDesc);
+		}
+
+		if (!vecArguments.empty())
+		{
+			Json::Value jArguments(Json::arrayValue);
+			for (auto& argument : vecArguments)
+			{
+				Json::Value jArgument(Json::objectValue);
+				int iErrCode = argument.DoSerialize(jArgument);
+				if (ERRNO_OK != iErrCode)
+					return iErrCode;
+				jArguments.append(std::move(jArgument));
+			}
+			jMsg[MSG_KEY_ARGUMENTS] = std::move(jArguments);
+		}
+
+		return ERRNO_OK;
+	}
+
+	int Prompt::DoDeserialize(const Json::Value& jMsg)
+	{
+		if (!jMsg.isMember(MSG_KEY_NAME) || !jMsg[MSG_KEY_NAME].isString())
+			return ERRNO_PARSE_ERROR;
+		strName = jMsg[MSG_KEY_NAME].asString();
+
+		if (jMsg.isMember(MSG_KEY_DESCRIPTION) && jMsg[MSG_KEY_DESCRIPTION].isString())
+			strDescription = jMsg[MSG_KEY_DESCRIPTION].asString();
+
+		vecArguments.clear();
+		if (jMsg.isMember(MSG_KEY_ARGUMENTS) && jMsg[MSG_KEY_ARGUMENTS].isArray())
+		{
+			for (auto& jArgument : jMsg[MSG_KEY_ARGUMENTS])
+			{
+				MCP::PromptArgument argument;
+				int iErrCode = argument.DoDeserialize(jArgument);
+				if (ERRNO_OK != iErrCode)
+					return iErrCode;
+				vecArguments.push_back(argument);
+			}
+		}
+
+		return ERRNO_OK;
+	}
+
+	bool Prompt::IsValid() const
+	{
+		return !strName.empty();
+	}
+
 	////////////////////////////////////////////////////////////////////////////////////////
 	// ProgressToken
 	int ProgressToken::DoSerialize(Json::Value& jMsg) const
@@ -474,17 +762,31 @@ namespace MCP
 		if (DataType_String == eTokenDataType)
 		{
 			Json::Value jId(strToken);
-			jMsg[MSG_KEY_PROGRESS_TOKEN] = jId;
+			jMsg[MSG_KEY_PROGRESS_TOKEN] = std::move(jId);
 		}
 		else if (DataType_Integer == eTokenDataType)
 		{
 			Json::Value jId(iToken);
-			jMsg[MSG_KEY_PROGRESS_TOKEN] = jId;
+			jMsg[MSG_KEY_PROGRESS_TOKEN] = std::move(jId);
 		}
 
 		return ERRNO_OK;
 	}
 
+	void ProgressToken::WriteMember(CMCPJsonWriter& writer) const
+	{
+		if (DataType_String == eTokenDataType)
+		{
+			writer.Key(MSG_KEY_PROGRESS_TOKEN);
+			writer.String(strToken);
+		}
+		else if (DataType_Integer == eTokenDataType)
+		{
+			writer.Key(MSG_KEY_PROGRESS_TOKEN);
+			writer.Int(iToken);
+		}
+	}
+
 	int ProgressToken::DoDeserialize(const Json::Value& jMsg)
 	{
 		if (!jMsg.isMember(MSG_KEY_PROGRESS_TOKEN))
@@ -3,9 +3,39 @@
 // ǱҪ£ֹʹضϵͳƽ̨API
 
 #include "Message.h"
+#include <functional>
+#include <memory>
+#include <vector>
 
 namespace MCP
 {
+	// Raw bytes of an image or blob, referenced instead of copied: the owner keeps them alive, e.g.
+	// a buffer shared with the tool, or a mapped file region unmapped by the owner's deleter.
+	// They are base64 encoded straight into the output when the message is written.
+	struct BinaryData
+	{
+		std::shared_ptr<const void> spOwner;
+		const unsigned char* pData{ nullptr };
+		size_t nSize{ 0 };
+
+		bool IsEmpty() const
+		{
+			return 0 == nSize;
+		}
+
+		static BinaryData FromBuffer(const std::shared_ptr<const std::vector<unsigned char>>& spBuffer)
+		{
+			BinaryData data;
+			if (spBuffer)
+			{
+				data.spOwner = spBuffer;
+				data.pData = spBuffer->data();
+				data.nSize = spBuffer->size();
+			}
+			return data;
+		}
+	};
+
 	struct RequestId : public MCP::Message
 	{
 	public:
@@ -22,20 +52,42 @@ namespace MCP
 		bool IsValid() const override;
 		int DoSerialize(Json::Value& jMsg) const override;
 		int DoDeserialize(const Json::Value& jMsg) override;
+		// Writes the id as a member of the object being written, like DoSerialize().
+		void WriteMember(CMCPJsonWriter& writer) const;
 
-		inline void SetMsgKey(const std::string& strMsgKey)
+		// lpcszMsgKey must outlive the id, e.g. one of the MSG_KEY_ literals.
+		inline void SetMsgKey(const char* lpcszMsgKey)
 		{
-			_strMsgKey = strMsgKey;
+			_lpcszMsgKey = lpcszMsgKey;
 		}
-		inline bool IsEqual(const MCP::RequestId& rhs)
+		inline bool IsEqual(const MCP::RequestId& rhs) const
 		{
 			return eIdDataType == rhs.eIdDataType
 				&& iId == rhs.iId
 				&& strId == rhs.strId;
 		}
+		inline bool operator==(const MCP::RequestId& rhs) const
+		{
+			return IsEqual(rhs);
+		}
+		inline size_t Hash() const
+		{
+			if (DataType_String == eIdDataType)
+				return std::hash<std::string>()(strId) ^ static_cast<size_t>(DataType_String);
+			return std::hash<int>()(iId) ^ (static_cast<size_t>(eIdDataType) << 28);
+		}
 
 	private:
-		std::string _strMsgKey;
+		const char* _lpcszMsgKey{ MSG_KEY_ID };
+	};
+
+	// Allows RequestId to key unordered containers (in-flight request tracking).
+	struct RequestIdHash
+	{
+		size_t operator()(const MCP::RequestId& requestId) const
+		{
+			return requestId.Hash();
+		}
 	};
 
 	struct Implementation : public MCP::Message
@@ -104,6 +156,21 @@ namespace MCP
 		int DoDeserialize(const Json::Value& jMsg) override;
 	};
 
+	// The server sends notifications/message and accepts logging/setLevel. No fields so far.
+	struct Logging : public MCP::Message
+	{
+	public:
+		Logging()
+			: Message(MessageType_Logging, MessageCategory_Basic, false)
+		{
+
+		}
+
+		bool IsValid() const override;
+		int DoSerialize(Json::Value& jMsg) const override;
+		int DoDeserialize(const Json::Value& jMsg) override;
+	};
+
 	struct ServerCapabilities : public MCP::Message
 	{
 	public:
@@ -113,11 +180,13 @@ namespace MCP
 			prompts.bExist = false;
 			resources.bExist = false;
 			tools.bExist = false;
+			logging.bExist = false;
 		}
 
 		MCP::Prompts prompts;
 		MCP::Resources resources;
 		MCP::Tools tools;
+		MCP::Logging logging;
 
 		bool IsValid() const override;
 		int DoSerialize(Json::Value& jMsg) const override;
@@ -155,6 +224,7 @@ namespace MCP
 		bool IsValid() const override;
 		int DoSerialize(Json::Value& jMsg) const override;
 		int DoDeserialize(const Json::Value& jMsg) override;
+		int DoWrite(CMCPJsonWriter& writer) const override;
 	};
 
 	struct ImageContent : public MCP::Message
@@ -167,11 +237,14 @@ namespace MCP
 
 		std::string strType;
 		std::string strMimeType;
+		// Already base64 encoded; ignored when binData is set.
 		std::string strData;
+		MCP::BinaryData binData;
 
 		bool IsValid() const override;
 		int DoSerialize(Json::Value& jMsg) const override;
 		int DoDeserialize(const Json::Value& jMsg) override;
+		int DoWrite(CMCPJsonWriter& writer) const override;
 	};
 
 	struct TextResourceContents : public MCP::Message
@@ -183,12 +256,15 @@ namespace MCP
 		}
 
 		std::string strText;
+		// UTF-8 text referenced instead of held, e.g. a mapped file; preferred over strText when set.
+		MCP::BinaryData textData;
 		std::string strUri;
 		std::string strMimeType;
 
 		bool IsValid() const override;
 		int DoSerialize(Json::Value& jMsg) const override;
 		int DoDeserialize(const Json::Value& jMsg) override;
+		int DoWrite(CMCPJsonWriter& writer) const override;
 	};
 
 	struct BlobResourceContents : public MCP::Message
@@ -199,13 +275,16 @@ namespace MCP
 
 		}
 
+		// Already base64 encoded; ignored when binBlob is set.
 		std::string strBlob;
+		MCP::BinaryData binBlob;
 		std::string strUri;
 		std::string strMimeType;
 
 		bool IsValid() const override;
 		int DoSerialize(Json::Value& jMsg) const override;
 		int DoDeserialize(const Json::Value& jMsg) override;
+		int DoWrite(CMCPJsonWriter& writer) const override;
 	};
 
 	struct EmbeddedResource : public MCP::Message
@@ -220,6 +299,61 @@ namespace MCP
 		TextResourceContents textResource;
 		BlobResourceContents blobResource;
 
+		bool IsValid() const override;
+		int DoSerialize(Json::Value& jMsg) const override;
+		int DoDeserialize(const Json::Value& jMsg) override;
+		int DoWrite(CMCPJsonWriter& writer) const override;
+	};
+
+	// Entry of a resources/list result.
+	struct Resource : public MCP::Message
+	{
+		Resource()
+			: Message(MessageType_Resource, MessageCategory_Basic, false)
+		{
+
+		}
+
+		std::string strUri;
+		std::string strName;
+		std::string strDescription;
+		std::string strMimeType;
+
+		bool IsValid() const override;
+		int DoSerialize(Json::Value& jMsg) const override;
+		int DoDeserialize(const Json::Value& jMsg) override;
+	};
+
+	struct PromptArgument : public MCP::Message
+	{
+		PromptArgument()
+			: Message(MessageType_PromptArgument, MessageCategory_Basic, false)
+		{
+
+		}
+
+		std::string strName;
+		std::string strDescription;
+		bool bRequired{ false };
+
+		bool IsValid() const override;
+		int DoSerialize(Json::Value& jMsg) const override;
+		int DoDeserialize(const Json::Value& jMsg) override;
+	};
+
+	// Entry of a prompts/list result.
+	struct Prompt : public MCP::Message
+	{
+		Prompt()
+			: Message(MessageType_Prompt, MessageCategory_Basic, false)
+		{
+
+		}
+
+		std::string strName;
+		std::string strDescription;
+		std::vector<MCP::PromptArgument> vecArguments;
+
 		bool IsValid() const override;
 		int DoSerialize(Json::Value& jMsg) const override;
 		int DoDeserialize(const Json::Value& jMsg) override;
@@ -240,6 +374,7 @@ namespace MCP
 		bool IsValid() const override;
 		int DoSerialize(Json::Value& jMsg) const override;
 		int DoDeserialize(const Json::Value& jMsg) override;
+		void WriteMember(CMCPJsonWriter& writer) const;
 
 		inline bool IsEqual(const MCP::ProgressToken& rhs)
 		{
@@ -0,0 +1,343 @@
+#include "FlatBuffersCodec.h"
+#include "../Public/PublicDef.h"
+
+#ifdef TINYMCP_WITH_FLATBUFFERS
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "mcp_generated.h"
+#endif
+
+namespace MCP
+{
+#ifdef TINYMCP_WITH_FLATBUFFERS
+	static bool ParseText(CMCPJsonParser& parser, const flatbuffers::String* pText, Json::Value& jValue)
+	{
+		return pText && parser.Parse(pText->c_str(), pText->c_str() + pText->size(), jValue);
+	}
+
+	static Json::Value ToValue(const flatbuffers::String* pText)
+	{
+		return Json::Value(pText->c_str(), pText->c_str() + pText->size());
+	}
+
+	static void SetVersion(const flatbuffers::String* pVersion, Json::Value& jMsg)
+	{
+		jMsg[MSG_KEY_JSONRPC] = pVersion ? ToValue(pVersion) : Json::Value(JSON_RPC_VER);
+	}
+
+	// Top level members of a JSON object as text spans; the values are skipped, not parsed.
+	struct MemberSpan
+	{
+		const char* pBegin{ nullptr };
+		const char* pEnd{ nullptr };
+
+		explicit operator bool() const { return nullptr != pBegin; }
+	};
+
+	static const char* SkipWhitespace(const char* p, const char* pEnd)
+	{
+		while (p < pEnd && (' ' == *p || '\t' == *p || '\r' == *p || '\n' == *p))
+			++p;
+		return p;
+	}
+
+	// p is at the opening quote; returns the position after the closing one.
+	static const char* SkipString(const char* p, const char* pEnd)
+	{
+		for (++p; p < pEnd; ++p)
+		{
+			if ('\\' == *p)
+				++p;
+			else if ('"' == *p)
+				return p + 1;
+		}
+		return nullptr;
+	}
+
+	static const char* SkipValue(const char* p, const char* pEnd)
+	{
+		if (p >= pEnd)
+			return nullptr;
+		if ('"' == *p)
+			return SkipString(p, pEnd);
+		if ('{' == *p || '[' == *p)
+		{
+			int iDepth = 0;
+			while (p < pEnd)
+			{
+				switch (*p)
+				{
+				case '"':
+					p = SkipString(p, pEnd);
+					if (!p)
+						return nullptr;
+					continue;
+				case '{':
+				case '[':
+					++iDepth;
+					break;
+				case '}':
+				case ']':
+					if (0 == --iDepth)
+						return p + 1;
+					break;
+				default:
+					break;
+				}
+				++p;
+			}
+			return nullptr;
+		}
+		while (p < pEnd && ',' != *p && '}' != *p && ']' != *p && ' ' != *p && '\t' != *p && '\r' != *p && '\n' != *p)
+			++p;
+		return p;
+	}
+
+	template <class Fn>
+	static bool ForEachMember(const char* p, const char* pEnd, Fn&& fnMember)
+	{
+		p = SkipWhitespace(p, pEnd);
+		if (p >= pEnd || '{' != *p)
+			return false;
+		p = SkipWhitespace(p + 1, pEnd);
+		if (p < pEnd && '}' == *p)
+			return true;
+		while (p < pEnd)
+		{
+			if ('"' != *p)
+				return false;
+			const char* pKeyEnd = SkipString(p, pEnd);
+			if (!pKeyEnd)
+				return false;
+			MemberSpan key{ p + 1, pKeyEnd - 1 };
+			p = SkipWhitespace(pKeyEnd, pEnd);
+			if (p >= pEnd || ':' != *p)
+				return false;
+			p = SkipWhitespace(p + 1, pEnd);
+			const char* pValueEnd = SkipValue(p, pEnd);
+			if (!pValueEnd)
+				return false;
+			fnMember(key, MemberSpan{ p, pValueEnd });
+			p = SkipWhitespace(pValueEnd, pEnd);
+			if (p < pEnd && ',' == *p)
+				p = SkipWhitespace(p + 1, pEnd);
+			else
+				return p < pEnd && '}' == *p;
+		}
+		return false;
+	}
+
+	static bool IsKey(const MemberSpan& key, const char* lpcszKey)
+	{
+		size_t nLength = strlen(lpcszKey);
+		return static_cast<size_t>(key.pEnd - key.pBegin) == nLength && 0 == memcmp(key.pBegin, lpcszKey, nLength);
+	}
+
+	// The unescaped content of a JSON string value.
+	static bool ReadString(const MemberSpan& value, std::string& strOut)
+	{
+		if (value.pEnd - value.pBegin < 2 || '"' != *value.pBegin)
+			return false;
+		if (!memchr(value.pBegin, '\\', value.pEnd - value.pBegin))
+		{
+			strOut.assign(value.pBegin + 1, value.pEnd - 1);
+			return true;
+		}
+
+		thread_local CMCPJsonParser s_parser;
+		Json::Value jString;
+		if (!s_parser.Parse(value.pBegin, value.pEnd, jString) || !jString.isString())
+			return false;
+		strOut = jString.asString();
+		return true;
+	}
+
+	static flatbuffers::Offset<flatbuffers::String> CreateText(flatbuffers::FlatBufferBuilder& fbb, const MemberSpan& span)
+	{
+		if (!span)
+			return 0;
+		return fbb.CreateString(span.pBegin, static_cast<size_t>(span.pEnd - span.pBegin));
+	}
+#endif
+
+	bool CMCPFlatBuffersCodec::IsAvailable()
+	{
+#ifdef TINYMCP_WITH_FLATBUFFERS
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	int CMCPFlatBuffersCodec::Decode(const char* pBegin, const char* pEnd, CMCPJsonParser& parser, Json::Value& jMsg)
+	{
+#ifdef TINYMCP_WITH_FLATBUFFERS
+		// Frames follow each other in the read buffer of the transport and may start anywhere in it;
+		// the tables are read in place, so a misaligned frame is moved first.
+		size_t nSize = static_cast<size_t>(pEnd - pBegin);
+		auto pData = reinterpret_cast<const uint8_t*>(pBegin);
+		thread_local std::vector<flatbuffers::uoffset_t> s_vecAligned;
+		if (0 != reinterpret_cast<uintptr_t>(pData) % alignof(flatbuffers::uoffset_t))
+		{
+			s_vecAligned.resize(nSize / sizeof(flatbuffers::uoffset_t) + 1);
+			memcpy(s_vecAligned.data(), pBegin, nSize);
+			pData = reinterpret_cast<const uint8_t*>(s_vecAligned.data());
+		}
+
+		flatbuffers::Verifier verifier(pData, nSize);
+		if (!mcp::VerifySizePrefixedRootBuffer(verifier))
+			return ERRNO_PARSE_ERROR;
+		auto pRoot = mcp::GetSizePrefixedRoot(pData);
+
+		jMsg = Json::Value(Json::objectValue);
+		switch (pRoot->message_type())
+		{
+			case mcp::RootMessage_JSONRPCRequest:
+			{
+				auto pRequest = pRoot->message_as_JSONRPCRequest();
+				if (!pRequest->method() || !ParseText(parser, pRequest->id(), jMsg[MSG_KEY_ID]))
+					return ERRNO_PARSE_ERROR;
+				SetVersion(pRequest->jsonrpc(), jMsg);
+				jMsg[MSG_KEY_METHOD] = ToValue(pRequest->method());
+				if (pRequest->params() && !ParseText(parser, pRequest->params(), jMsg[MSG_KEY_PARAMS]))
+					return ERRNO_PARSE_ERROR;
+			} break;
+			case mcp::RootMessage_JSONRPCResponse:
+			{
+				auto pResponse = pRoot->message_as_JSONRPCResponse();
+				if (!ParseText(parser, pResponse->id(), jMsg[MSG_KEY_ID]))
+					return ERRNO_PARSE_ERROR;
+				SetVersion(pResponse->jsonrpc(), jMsg);
+				if (pResponse->result())
+				{
+					if (!ParseText(parser, pResponse->result(), jMsg[MSG_KEY_RESULT]))
+						return ERRNO_PARSE_ERROR;
+				}
+				else if (pResponse->error())
+				{
+					auto pError = pResponse->error();
+					auto& jError = jMsg[MSG_KEY_ERROR];
+					jError[MSG_KEY_CODE] = pError->code();
+					jError[MSG_KEY_MESSAGE] = pError->message() ? ToValue(pError->message()) : Json::Value("");
+					if (pError->data() && !ParseText(parser, pError->data(), jError[MSG_KEY_DATA]))
+						return ERRNO_PARSE_ERROR;
+				}
+			} break;
+			case mcp::RootMessage_JSONRPCNotification:
+			{
+				auto pNotification = pRoot->message_as_JSONRPCNotification();
+				if (!pNotification->method())
+					return ERRNO_PARSE_ERROR;
+				SetVersion(pNotification->jsonrpc(), jMsg);
+				jMsg[MSG_KEY_METHOD] = ToValue(pNotification->method());
+				if (pNotification->params() && !ParseText(parser, pNotification->params(), jMsg[MSG_KEY_PARAMS]))
+					return ERRNO_PARSE_ERROR;
+			} break;
+			default:
+				return ERRNO_PARSE_ERROR;
+		}
+
+		return ERRNO_OK;
+#else
+		(void)pBegin;
+		(void)pEnd;
+		(void)parser;
+		(void)jMsg;
+		return ERRNO_INTERNAL_ERROR;
+#endif
+	}
+
+	int CMCPFlatBuffersCodec::Encode(const std::string& strMessage, std::string& strFrame)
+	{
+#ifdef TINYMCP_WITH_FLATBUFFERS
+		MemberSpan id, method, params, result, error;
+		bool bParsed = ForEachMember(strMessage.data(), strMessage.data() + strMessage.size(),
+			[&](const MemberSpan& key, const MemberSpan& value)
+			{
+				if (IsKey(key, MSG_KEY_ID))
+					id = value;
+				else if (IsKey(key, MSG_KEY_METHOD))
+					method = value;
+				else if (IsKey(key, MSG_KEY_PARAMS))
+					params = value;
+				else if (IsKey(key, MSG_KEY_RESULT))
+					result = value;
+				else if (IsKey(key, MSG_KEY_ERROR))
+					error = value;
+			});
+		if (!bParsed)
+			return ERRNO_INTERNAL_ERROR;
+
+		std::string strMethod;
+		if (method && !ReadString(method, strMethod))
+			return ERRNO_INTERNAL_ERROR;
+
+		// Reused: after the first messages of a session the builder no longer allocates.
+		thread_local flatbuffers::FlatBufferBuilder s_fbb(4096);
+		auto& fbb = s_fbb;
+		fbb.Clear();
+		auto version = fbb.CreateString(JSON_RPC_VER);
+		flatbuffers::Offset<void> message;
+		mcp::RootMessage eType = mcp::RootMessage_NONE;
+		if (id && method)
+		{
+			auto idText = CreateText(fbb, id);
+			auto methodText = fbb.CreateString(strMethod);
+			auto paramsText = CreateText(fbb, params);
+			message = mcp::CreateJSONRPCRequest(fbb, version, idText, methodText, paramsText).Union();
+			eType = mcp::RootMessage_JSONRPCRequest;
+		}
+		else if (id)
+		{
+			auto idText = CreateText(fbb, id);
+			auto resultText = CreateText(fbb, result);
+			flatbuffers::Offset<mcp::JSONRPCError> errorTable;
+			if (!result && error)
+			{
+				MemberSpan code, errorMessage, data;
+				if (!ForEachMember(error.pBegin, error.pEnd, [&](const MemberSpan& key, const MemberSpan& value)
+					{
+						if (IsKey(key, MSG_KEY_CODE))
+							code = value;
+						else if (IsKey(key, MSG_KEY_MESSAGE))
+							errorMessage = value;
+						else if (IsKey(key, MSG_KEY_DATA))
+							data = value;
+					}))
+					return ERRNO_INTERNAL_ERROR;
+				std::string strErrorMessage;
+				if (errorMessage && !ReadString(errorMessage, strErrorMessage))
+					return ERRNO_INTERNAL_ERROR;
+				int iCode = code ? static_cast<int>(strtol(std::string(code.pBegin, code.pEnd).c_str(), nullptr, 10)) : 0;
+				auto messageText = fbb.CreateString(strErrorMessage);
+				auto dataText = CreateText(fbb, data);
+				errorTable = mcp::CreateJSONRPCError(fbb, iCode, messageText, dataText);
+			}
+			message = mcp::CreateJSONRPCResponse(fbb, version, idText, resultText, errorTable).Union();
+			eType = mcp::RootMessage_JSONRPCResponse;
+		}
+		else if (method)
+		{
+			auto methodText = fbb.CreateString(strMethod);
+			auto paramsText = CreateText(fbb, params);
+			message = mcp::CreateJSONRPCNotification(fbb, version, methodText, paramsText).Union();
+			eType = mcp::RootMessage_JSONRPCNotification;
+		}
+		else
+		{
+			return ERRNO_INTERNAL_ERROR;
+		}
+		mcp::FinishSizePrefixedRootBuffer(fbb, mcp::CreateRoot(fbb, eType, message));
+
+		strFrame.assign(reinterpret_cast<const char*>(fbb.GetBufferPointer()), fbb.GetSize());
+
+		return ERRNO_OK;
+#else
+		(void)strMessage;
+		(void)strFrame;
+		return ERRNO_INTERNAL_ERROR;
+#endif
+	}
+}
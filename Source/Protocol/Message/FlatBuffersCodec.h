@@ -0,0 +1,30 @@
+#pragma once
+// To ensure good cross-platform compatibility, the MCP namespace code uses standard C++ only.
+// Avoid using platform-specific system APIs unless absolutely necessary.
+
+#include <string>
+#include <json/json.h>
+#include "JsonParser.h"
+
+namespace MCP
+{
+	// The binary message encoding a client can negotiate in initialize, see CMCPSession. A message
+	// is a size prefixed mcp.Root buffer (schemas/mcp.fbs) holding a JSONRPCRequest, JSONRPCResponse
+	// or JSONRPCNotification. Ids are carried as their JSON text, so that numeric and string ids
+	// round-trip; params and results are JSON text as the schema defines them.
+	//
+	// Only built with the TINYMCP_WITH_FLATBUFFERS CMake option; otherwise IsAvailable() is false and
+	// the encoding is never offered.
+	class CMCPFlatBuffersCodec
+	{
+	public:
+		static bool IsAvailable();
+
+		// Turns a frame into the tree a JSON frame would have been parsed into. The envelope is read
+		// in place and params are parsed straight out of the frame, without copying them first.
+		static int Decode(const char* pBegin, const char* pEnd, CMCPJsonParser& parser, Json::Value& jMsg);
+		// Frames a serialized JSON message. Only the envelope is scanned: params, result and error
+		// data are copied into the frame as they are, without being parsed.
+		static int Encode(const std::string& strMessage, std::string& strFrame);
+	};
+}
@@ -0,0 +1,435 @@
+#include "JsonParser.h"
+
+#if defined(TINYMCP_JSON_BACKEND_NATIVE)
+#include <cmath>
+#include <cstring>
+#include <locale>
+#include <sstream>
+#include <json/writer.h>
+#endif
+
+namespace MCP
+{
+	// Deeper documents are rejected by both backends.
+	static constexpr unsigned int MAX_NESTING_DEPTH = 1000;
+
+#if !defined(TINYMCP_JSON_BACKEND_NATIVE)
+
+	class CMCPJsonParser::CBackend
+	{
+	public:
+		CBackend()
+		{
+			Json::CharReaderBuilder builder;
+			Json::CharReaderBuilder::strictMode(&builder.settings_);
+			// Messages are objects, but single values are parsed too (e.g. the tool arguments). A
+			// repeated key overwrites the earlier member and a byte order mark is not skipped, as
+			// in the native backend.
+			builder["strictRoot"] = false;
+			builder["rejectDupKeys"] = false;
+			builder["skipBom"] = false;
+			builder["stackLimit"] = MAX_NESTING_DEPTH;
+			m_upReader.reset(builder.newCharReader());
+		}
+
+		bool Parse(const char* pBegin, const char* pEnd, Json::Value& jValue)
+		{
+			// Nesting past the stack limit is reported by an exception rather than by the result.
+			try
+			{
+				return m_upReader->parse(pBegin, pEnd, &jValue, nullptr);
+			}
+			catch (const Json::Exception&)
+			{
+				return false;
+			}
+		}
+
+	private:
+		// Reused so that parsing a message does not rebuild the reader.
+		std::unique_ptr<Json::CharReader> m_upReader;
+	};
+
+	const char* CMCPJsonParser::GetBackendName()
+	{
+		return "jsoncpp";
+	}
+
+#else
+
+	class CMCPJsonParser::CBackend
+	{
+	public:
+		CBackend()
+		{
+			m_issNumber.imbue(std::locale::classic());
+		}
+
+		bool Parse(const char* pBegin, const char* pEnd, Json::Value& jValue)
+		{
+			m_pCur = pBegin;
+			m_pEnd = pEnd;
+			SkipWhitespace();
+			if (!ParseValue(jValue, 0))
+				return false;
+			SkipWhitespace();
+
+			return m_pCur == m_pEnd;
+		}
+
+	private:
+		void SkipWhitespace()
+		{
+			while (m_pCur != m_pEnd && (*m_pCur == ' ' || *m_pCur == '\t' || *m_pCur == '\n' || *m_pCur == '\r'))
+				++m_pCur;
+		}
+
+		bool Consume(char ch)
+		{
+			if (m_pCur == m_pEnd || *m_pCur != ch)
+				return false;
+			++m_pCur;
+			return true;
+		}
+
+		bool ParseValue(Json::Value& jValue, unsigned int nDepth)
+		{
+			if (m_pCur == m_pEnd || nDepth > MAX_NESTING_DEPTH)
+				return false;
+
+			switch (*m_pCur)
+			{
+			case '{':
+				return ParseObject(jValue, nDepth);
+			case '[':
+				return ParseArray(jValue, nDepth);
+			case '"':
+			{
+				++m_pCur;
+				const char* pBegin{ nullptr };
+				const char* pEnd{ nullptr };
+				if (!ParseString(pBegin, pEnd))
+					return false;
+				jValue = Json::Value(pBegin, pEnd);
+				return true;
+			}
+			case 't':
+				jValue = Json::Value(true);
+				return ParseLiteral("true", 4);
+			case 'f':
+				jValue = Json::Value(false);
+				return ParseLiteral("false", 5);
+			case 'n':
+				jValue = Json::Value(Json::nullValue);
+				return ParseLiteral("null", 4);
+			default:
+				return ParseNumber(jValue);
+			}
+		}
+
+		bool ParseLiteral(const char* lpcszLiteral, size_t nLength)
+		{
+			if (static_cast<size_t>(m_pEnd - m_pCur) < nLength || std::memcmp(m_pCur, lpcszLiteral, nLength) != 0)
+				return false;
+			m_pCur += nLength;
+			return true;
+		}
+
+		bool ParseObject(Json::Value& jValue, unsigned int nDepth)
+		{
+			++m_pCur;
+			jValue = Json::Value(Json::objectValue);
+			SkipWhitespace();
+			if (Consume('}'))
+				return true;
+
+			for (;;)
+			{
+				const char* pKeyBegin{ nullptr };
+				const char* pKeyEnd{ nullptr };
+				if (!Consume('"') || !ParseString(pKeyBegin, pKeyEnd))
+					return false;
+				SkipWhitespace();
+				if (!Consume(':'))
+					return false;
+				SkipWhitespace();
+				// A repeated key overwrites the earlier member, like Json::Reader does.
+				if (!ParseValue(*jValue.demand(pKeyBegin, pKeyEnd), nDepth + 1))
+					return false;
+				SkipWhitespace();
+				if (Consume('}'))
+					return true;
+				if (!Consume(','))
+					return false;
+				SkipWhitespace();
+			}
+		}
+
+		bool ParseArray(Json::Value& jValue, unsigned int nDepth)
+		{
+			++m_pCur;
+			jValue = Json::Value(Json::arrayValue);
+			SkipWhitespace();
+			if (Consume(']'))
+				return true;
+
+			for (;;)
+			{
+				if (!ParseValue(jValue.append(Json::Value()), nDepth + 1))
+					return false;
+				SkipWhitespace();
+				if (Consume(']'))
+					return true;
+				if (!Consume(','))
+					return false;
+				SkipWhitespace();
+			}
+		}
+
+		// Called past the opening quote. The result points into the input when the string holds
+		// no escape sequence, otherwise into m_strScratch, which stays valid until the next string.
+		bool ParseString(const char*& pBegin, const char*& pEnd)
+		{
+			const char* pStart = m_pCur;
+			m_pCur += Json::countUnescapedPrefix(m_pCur, m_pEnd - m_pCur, true);
+			if (m_pCur != m_pEnd && *m_pCur == '"')
+			{
+				pBegin = pStart;
+				pEnd = m_pCur++;
+				return true;
+			}
+
+			m_strScratch.assign(pStart, m_pCur);
+			while (m_pCur != m_pEnd)
+			{
+				char ch = *m_pCur++;
+				if (ch == '"')
+				{
+					pBegin = m_strScratch.data();
+					pEnd = pBegin + m_strScratch.size();
+					return true;
+				}
+				if (ch == '\\')
+				{
+					if (!ParseEscape())
+						return false;
+				}
+				else
+				{
+					// Raw control characters are kept, as Json::Reader does.
+					m_strScratch.push_back(ch);
+				}
+
+				size_t nRun = Json::countUnescapedPrefix(m_pCur, m_pEnd - m_pCur, true);
+				m_strScratch.append(m_pCur, nRun);
+				m_pCur += nRun;
+			}
+
+			return false;
+		}
+
+		bool ParseEscape()
+		{
+			if (m_pCur == m_pEnd)
+				return false;
+
+			switch (*m_pCur++)
+			{
+			case '"': m_strScratch.push_back('"'); return true;
+			case '\\': m_strScratch.push_back('\\'); return true;
+			case '/': m_strScratch.push_back('/'); return true;
+			case 'b': m_strScratch.push_back('\b'); return true;
+			case 'f': m_strScratch.push_back('\f'); return true;
+			case 'n': m_strScratch.push_back('\n'); return true;
+			case 'r': m_strScratch.push_back('\r'); return true;
+			case 't': m_strScratch.push_back('\t'); return true;
+			case 'u':
+			{
+				unsigned int nCode{ 0 };
+				if (!ParseHex4(nCode))
+					return false;
+				if (nCode >= 0xD800 && nCode <= 0xDBFF)
+				{
+					// A high surrogate has to be followed by its low half.
+					unsigned int nLow{ 0 };
+					if (!Consume('\\') || !Consume('u') || !ParseHex4(nLow) || nLow < 0xDC00 || nLow > 0xDFFF)
+						return false;
+					nCode = 0x10000 + ((nCode & 0x3FF) << 10) + (nLow & 0x3FF);
+				}
+				AppendUtf8(nCode);
+				return true;
+			}
+			default:
+				return false;
+			}
+		}
+
+		bool ParseHex4(unsigned int& nCode)
+		{
+			if (m_pEnd - m_pCur < 4)
+				return false;
+
+			nCode = 0;
+			for (int i = 0; i < 4; ++i)
+			{
+				char ch = *m_pCur++;
+				nCode <<= 4;
+				if (ch >= '0' && ch <= '9')
+					nCode |= ch - '0';
+				else if (ch >= 'a' && ch <= 'f')
+					nCode |= ch - 'a' + 10;
+				else if (ch >= 'A' && ch <= 'F')
+					nCode |= ch - 'A' + 10;
+				else
+					return false;
+			}
+			return true;
+		}
+
+		void AppendUtf8(unsigned int nCode)
+		{
+			if (nCode < 0x80)
+			{
+				m_strScratch.push_back(static_cast<char>(nCode));
+			}
+			else if (nCode < 0x800)
+			{
+				m_strScratch.push_back(static_cast<char>(0xC0 | (nCode >> 6)));
+				m_strScratch.push_back(static_cast<char>(0x80 | (nCode & 0x3F)));
+			}
+			else if (nCode < 0x10000)
+			{
+				m_strScratch.push_back(static_cast<char>(0xE0 | (nCode >> 12)));
+				m_strScratch.push_back(static_cast<char>(0x80 | ((nCode >> 6) & 0x3F)));
+				m_strScratch.push_back(static_cast<char>(0x80 | (nCode & 0x3F)));
+			}
+			else
+			{
+				m_strScratch.push_back(static_cast<char>(0xF0 | (nCode >> 18)));
+				m_strScratch.push_back(static_cast<char>(0x80 | ((nCode >> 12) & 0x3F)));
+				m_strScratch.push_back(static_cast<char>(0x80 | ((nCode >> 6) & 0x3F)));
+				m_strScratch.push_back(static_cast<char>(0x80 | (nCode & 0x3F)));
+			}
+		}
+
+		static bool IsDigit(char ch)
+		{
+			return ch >= '0' && ch <= '9';
+		}
+
+		bool ConsumeDigits()
+		{
+			if (m_pCur == m_pEnd || !IsDigit(*m_pCur))
+				return false;
+			while (m_pCur != m_pEnd && IsDigit(*m_pCur))
+				++m_pCur;
+			return true;
+		}
+
+		bool ParseNumber(Json::Value& jValue)
+		{
+			const char* pStart = m_pCur;
+			bool bNegative = Consume('-');
+			const char* pDigits = m_pCur;
+			if (Consume('0'))
+			{
+				// No leading zeros.
+			}
+			else if (!ConsumeDigits())
+			{
+				return false;
+			}
+			const char* pDigitsEnd = m_pCur;
+
+			bool bInteger{ true };
+			if (Consume('.'))
+			{
+				if (!ConsumeDigits())
+					return false;
+				bInteger = false;
+			}
+			if (Consume('e') || Consume('E'))
+			{
+				if (!Consume('+'))
+					Consume('-');
+				if (!ConsumeDigits())
+					return false;
+				bInteger = false;
+			}
+
+			if (bInteger)
+			{
+				// Integers keep the typing of the jsoncpp backend: intValue for negatives and up to
+				// maxLargestInt, uintValue above it, and a double once they overflow 64 bits.
+				const Json::LargestUInt ullLimit = bNegative
+					? static_cast<Json::LargestUInt>(Json::Value::maxLargestInt) + 1
+					: Json::Value::maxLargestUInt;
+				Json::LargestUInt ullValue{ 0 };
+				bool bOverflow{ false };
+				for (const char* p = pDigits; p != pDigitsEnd && !bOverflow; ++p)
+				{
+					unsigned int nDigit = *p - '0';
+					if (ullValue > (ullLimit - nDigit) / 10)
+						bOverflow = true;
+					else
+						ullValue = ullValue * 10 + nDigit;
+				}
+
+				if (!bOverflow)
+				{
+					if (bNegative && ullValue == ullLimit)
+						jValue = Json::Value(Json::Value::minLargestInt);
+					else if (bNegative)
+						jValue = Json::Value(-static_cast<Json::LargestInt>(ullValue));
+					else if (ullValue <= static_cast<Json::LargestUInt>(Json::Value::maxLargestInt))
+						jValue = Json::Value(static_cast<Json::LargestInt>(ullValue));
+					else
+						jValue = Json::Value(ullValue);
+					return true;
+				}
+			}
+
+			// strtod() would follow the C locale and stop at the '.' where the decimal point is a comma.
+			m_issNumber.clear();
+			m_issNumber.str(std::string(pStart, m_pCur));
+			double dValue = 0;
+			// 1e400 overflows to infinity, which JSON cannot express: the writer would emit 1e+9999.
+			if (!(m_issNumber >> dValue) || !std::isfinite(dValue))
+				return false;
+
+			jValue = Json::Value(dValue);
+			return true;
+		}
+
+		const char* m_pCur{ nullptr };
+		const char* m_pEnd{ nullptr };
+		// Decoded text of strings with escape sequences, reused across strings and messages.
+		std::string m_strScratch;
+		// Reads the numbers that are not integers, in the classic locale.
+		std::istringstream m_issNumber;
+	};
+
+	const char* CMCPJsonParser::GetBackendName()
+	{
+		return "native";
+	}
+
+#endif // TINYMCP_JSON_BACKEND_NATIVE
+
+	CMCPJsonParser::CMCPJsonParser()
+		: m_upBackend(new CBackend())
+	{
+	}
+
+	CMCPJsonParser::~CMCPJsonParser() = default;
+
+	bool CMCPJsonParser::Parse(const char* pBegin, const char* pEnd, Json::Value& jValue)
+	{
+		return m_upBackend->Parse(pBegin, pEnd, jValue);
+	}
+
+	bool CMCPJsonParser::Parse(const std::string& strText, Json::Value& jValue)
+	{
+		return Parse(strText.data(), strText.data() + strText.size(), jValue);
+	}
+}
@@ -0,0 +1,37 @@
+#pragma once
+// To ensure good cross-platform compatibility, the MCP namespace code uses standard C++ only.
+// Avoid using platform-specific system APIs unless absolutely necessary.
+
+#include <memory>
+#include <string>
+#include <json/json.h>
+
+namespace MCP
+{
+	// Turns incoming JSON text into the Json::Value tree that Message::Deserialize() consumes.
+	// The backend is picked at build time with the TINYMCP_JSON_BACKEND CMake option:
+	// "jsoncpp" (default) wraps a strict Json::CharReader, "native" is a single pass RFC 8259 parser
+	// that builds the tree without a token stream and copies plain string runs with a vectorized scan.
+	// Both reject text after the document, numbers that overflow to infinity and nesting deeper than
+	// 1000 levels, and build the same tree; only jsoncpp reads the number forms 01, 1. and - (as 0).
+	// An instance keeps its scratch state between calls and must not be shared across threads.
+	class CMCPJsonParser
+	{
+	public:
+		CMCPJsonParser();
+		~CMCPJsonParser();
+		CMCPJsonParser(const CMCPJsonParser&) = delete;
+		CMCPJsonParser& operator=(const CMCPJsonParser&) = delete;
+
+		// Replaces jValue with the document held in [pBegin, pEnd).
+		bool Parse(const char* pBegin, const char* pEnd, Json::Value& jValue);
+		bool Parse(const std::string& strText, Json::Value& jValue);
+
+		// "jsoncpp" or "native".
+		static const char* GetBackendName();
+
+	private:
+		class CBackend;
+		std::unique_ptr<CBackend> m_upBackend;
+	};
+}
@@ -0,0 +1,349 @@
+#include "JsonWriter.h"
+#include "../Public/Base64.h"
+#include <cstdio>
+#include <cstring>
+#include <json/writer.h>
+
+namespace MCP
+{
+	static constexpr size_t CONTAINER_DEPTH_HINT = 16;
+	static constexpr unsigned int REPLACEMENT_CHARACTER = 0xFFFD;
+
+	// Same decoding as the jsoncpp writer, invalid sequences included.
+	static unsigned int DecodeUtf8(const char*& pCur, const char* pEnd)
+	{
+		unsigned int nFirst = static_cast<unsigned char>(*pCur);
+		if (nFirst < 0x80)
+			return nFirst;
+
+		if (nFirst < 0xE0)
+		{
+			if (pEnd - pCur < 2)
+				return REPLACEMENT_CHARACTER;
+			unsigned int nCode = ((nFirst & 0x1F) << 6) | (static_cast<unsigned int>(pCur[1]) & 0x3F);
+			pCur += 1;
+			return nCode < 0x80 ? REPLACEMENT_CHARACTER : nCode;
+		}
+
+		if (nFirst < 0xF0)
+		{
+			if (pEnd - pCur < 3)
+				return REPLACEMENT_CHARACTER;
+			unsigned int nCode = ((nFirst & 0x0F) << 12)
+				| ((static_cast<unsigned int>(pCur[1]) & 0x3F) << 6)
+				| (static_cast<unsigned int>(pCur[2]) & 0x3F);
+			pCur += 2;
+			if (nCode >= 0xD800 && nCode <= 0xDFFF)
+				return REPLACEMENT_CHARACTER;
+			return nCode < 0x800 ? REPLACEMENT_CHARACTER : nCode;
+		}
+
+		if (nFirst < 0xF8)
+		{
+			if (pEnd - pCur < 4)
+				return REPLACEMENT_CHARACTER;
+			unsigned int nCode = ((nFirst & 0x07) << 18)
+				| ((static_cast<unsigned int>(pCur[1]) & 0x3F) << 12)
+				| ((static_cast<unsigned int>(pCur[2]) & 0x3F) << 6)
+				| (static_cast<unsigned int>(pCur[3]) & 0x3F);
+			pCur += 3;
+			return nCode < 0x10000 ? REPLACEMENT_CHARACTER : nCode;
+		}
+
+		return REPLACEMENT_CHARACTER;
+	}
+
+	// Bytes DecodeUtf8() consumes for a sequence starting with nFirst, if they are all available.
+	static size_t Utf8SequenceLength(unsigned int nFirst)
+	{
+		if (nFirst < 0x80 || nFirst >= 0xF8)
+			return 1;
+		if (nFirst < 0xE0)
+			return 2;
+		if (nFirst < 0xF0)
+			return 3;
+		return 4;
+	}
+
+	static void AppendUnicodeEscape(std::string& strOut, unsigned int nCode)
+	{
+		static const char s_szDigits[] = "0123456789abcdef";
+		char szEscape[6] = { '\\', 'u',
+			s_szDigits[(nCode >> 12) & 0xF], s_szDigits[(nCode >> 8) & 0xF],
+			s_szDigits[(nCode >> 4) & 0xF], s_szDigits[nCode & 0xF] };
+		strOut.append(szEscape, sizeof(szEscape));
+	}
+
+	CMCPJsonWriter::CMCPJsonWriter(std::string& strOut)
+		: m_strOut(strOut)
+	{
+		m_vecHasValue.reserve(CONTAINER_DEPTH_HINT);
+	}
+
+	void CMCPJsonWriter::BeforeValue()
+	{
+		if (m_bAfterKey)
+		{
+			m_bAfterKey = false;
+			return;
+		}
+		if (!m_vecHasValue.empty())
+		{
+			if (m_vecHasValue.back())
+				m_strOut.push_back(',');
+			m_vecHasValue.back() = true;
+		}
+	}
+
+	void CMCPJsonWriter::StartObject()
+	{
+		BeforeValue();
+		m_strOut.push_back('{');
+		m_vecHasValue.push_back(false);
+	}
+
+	void CMCPJsonWriter::EndObject()
+	{
+		m_vecHasValue.pop_back();
+		m_strOut.push_back('}');
+	}
+
+	void CMCPJsonWriter::StartArray()
+	{
+		BeforeValue();
+		m_strOut.push_back('[');
+		m_vecHasValue.push_back(false);
+	}
+
+	void CMCPJsonWriter::EndArray()
+	{
+		m_vecHasValue.pop_back();
+		m_strOut.push_back(']');
+	}
+
+	void CMCPJsonWriter::Key(const char* lpcszKey)
+	{
+		BeforeValue();
+		AppendQuoted(lpcszKey, std::strlen(lpcszKey));
+		m_strOut.push_back(':');
+		m_bAfterKey = true;
+	}
+
+	void CMCPJsonWriter::Key(const std::string& strKey)
+	{
+		BeforeValue();
+		AppendQuoted(strKey.data(), strKey.size());
+		m_strOut.push_back(':');
+		m_bAfterKey = true;
+	}
+
+	void CMCPJsonWriter::String(const char* pData, size_t nLength)
+	{
+		BeforeValue();
+		AppendQuoted(pData, nLength);
+	}
+
+	void CMCPJsonWriter::String(const std::string& strValue)
+	{
+		String(strValue.data(), strValue.size());
+	}
+
+	void CMCPJsonWriter::StartString()
+	{
+		BeforeValue();
+		m_strOut.push_back('"');
+		m_strPartial.clear();
+	}
+
+	void CMCPJsonWriter::StringChunk(const char* pData, size_t nLength)
+	{
+		if (!m_strPartial.empty())
+		{
+			// Complete the split sequence with the first bytes of this chunk; a sequence is 4 bytes at most.
+			size_t nBorrowed = nLength < 4 ? nLength : 4;
+			size_t nCarried = m_strPartial.size();
+			m_strPartial.append(pData, nBorrowed);
+			size_t nConsumed = AppendEscaped(m_strPartial.data(), m_strPartial.size(), false);
+			if (nConsumed < nCarried)
+			{
+				m_strPartial.erase(0, nConsumed);
+				return;
+			}
+			m_strPartial.clear();
+			pData += nConsumed - nCarried;
+			nLength -= nConsumed - nCarried;
+		}
+
+		size_t nConsumed = AppendEscaped(pData, nLength, false);
+		m_strPartial.assign(pData + nConsumed, nLength - nConsumed);
+	}
+
+	void CMCPJsonWriter::EndString()
+	{
+		AppendEscaped(m_strPartial.data(), m_strPartial.size(), true);
+		m_strPartial.clear();
+		m_strOut.push_back('"');
+	}
+
+	void CMCPJsonWriter::Base64(const unsigned char* pData, size_t nLength)
+	{
+		BeforeValue();
+		m_strOut.push_back('"');
+		MCP::Base64::Append(pData, nLength, m_strOut);
+		m_strOut.push_back('"');
+	}
+
+	void CMCPJsonWriter::Base64Chunk(const unsigned char* pData, size_t nLength)
+	{
+		// The base64 alphabet needs no escaping.
+		MCP::Base64::Append(pData, nLength, m_strOut);
+	}
+
+	void CMCPJsonWriter::Int(long long llValue)
+	{
+		BeforeValue();
+		char szBuf[24];
+		int iLength = std::snprintf(szBuf, sizeof(szBuf), "%lld", llValue);
+		m_strOut.append(szBuf, iLength);
+	}
+
+	void CMCPJsonWriter::UInt(unsigned long long ullValue)
+	{
+		BeforeValue();
+		char szBuf[24];
+		int iLength = std::snprintf(szBuf, sizeof(szBuf), "%llu", ullValue);
+		m_strOut.append(szBuf, iLength);
+	}
+
+	void CMCPJsonWriter::Bool(bool bValue)
+	{
+		BeforeValue();
+		m_strOut.append(bValue ? "true" : "false");
+	}
+
+	void CMCPJsonWriter::Null()
+	{
+		BeforeValue();
+		m_strOut.append("null");
+	}
+
+	void CMCPJsonWriter::Value(const Json::Value& jValue)
+	{
+		switch (jValue.type())
+		{
+		case Json::nullValue:
+			Null();
+			break;
+		case Json::intValue:
+			Int(jValue.asLargestInt());
+			break;
+		case Json::uintValue:
+			UInt(jValue.asLargestUInt());
+			break;
+		case Json::realValue:
+			BeforeValue();
+			m_strOut.append(Json::valueToString(jValue.asDouble()));
+			break;
+		case Json::stringValue:
+		{
+			const char* pBegin = nullptr;
+			const char* pEnd = nullptr;
+			if (jValue.getString(&pBegin, &pEnd))
+				String(pBegin, pEnd - pBegin);
+			else
+				String("", 0);
+			break;
+		}
+		case Json::booleanValue:
+			Bool(jValue.asBool());
+			break;
+		case Json::arrayValue:
+			StartArray();
+			for (Json::ArrayIndex nIndex = 0; nIndex < jValue.size(); ++nIndex)
+				Value(jValue[nIndex]);
+			EndArray();
+			break;
+		case Json::objectValue:
+			// The members are stored, and therefore visited, in key order.
+			StartObject();
+			for (auto itr = jValue.begin(); itr != jValue.end(); ++itr)
+			{
+				const char* pNameEnd = nullptr;
+				const char* pName = itr.memberName(&pNameEnd);
+				BeforeValue();
+				AppendQuoted(pName, pNameEnd - pName);
+				m_strOut.push_back(':');
+				m_bAfterKey = true;
+				Value(*itr);
+			}
+			EndObject();
+			break;
+		}
+	}
+
+	void CMCPJsonWriter::AppendQuoted(const char* pData, size_t nLength)
+	{
+		m_strOut.push_back('"');
+		AppendEscaped(pData, nLength, true);
+		m_strOut.push_back('"');
+	}
+
+	size_t CMCPJsonWriter::AppendEscaped(const char* pData, size_t nLength, bool bFinal)
+	{
+		const char* pEnd = pData + nLength;
+		for (const char* pCur = pData; pCur != pEnd; ++pCur)
+		{
+			// Copy the run of plain characters up to the next one to escape.
+			size_t nRun = Json::countUnescapedPrefix(pCur, pEnd - pCur);
+			m_strOut.append(pCur, nRun);
+			pCur += nRun;
+			if (pCur == pEnd)
+				break;
+
+			switch (*pCur)
+			{
+			case '"':
+				m_strOut.append("\\\"");
+				break;
+			case '\\':
+				m_strOut.append("\\\\");
+				break;
+			case '\b':
+				m_strOut.append("\\b");
+				break;
+			case '\f':
+				m_strOut.append("\\f");
+				break;
+			case '\n':
+				m_strOut.append("\\n");
+				break;
+			case '\r':
+				m_strOut.append("\\r");
+				break;
+			case '\t':
+				m_strOut.append("\\t");
+				break;
+			default:
+			{
+				if (!bFinal && static_cast<size_t>(pEnd - pCur) < Utf8SequenceLength(static_cast<unsigned char>(*pCur)))
+					return static_cast<size_t>(pCur - pData);
+				unsigned int nCode = DecodeUtf8(pCur, pEnd);
+				if (nCode < 0x10000)
+				{
+					AppendUnicodeEscape(m_strOut, nCode);
+				}
+				else
+				{
+					// Outside the Basic Multilingual Plane: a surrogate pair.
+					nCode -= 0x10000;
+					AppendUnicodeEscape(m_strOut, 0xD800 + ((nCode >> 10) & 0x3FF));
+					AppendUnicodeEscape(m_strOut, 0xDC00 + (nCode & 0x3FF));
+				}
+				break;
+			}
+			}
+		}
+
+		return nLength;
+	}
+}
@@ -0,0 +1,61 @@
+#pragma once
+// To ensure good cross-platform compatibility, the MCP namespace code uses standard C++ only.
+// Avoid using platform-specific system APIs unless absolutely necessary.
+
+#include <string>
+#include <vector>
+#include <json/json.h>
+
+namespace MCP
+{
+	// Forward-only JSON writer appending compact text straight to a caller owned buffer, so an
+	// outgoing message needs no Json::Value tree. Strings are escaped exactly like Json::FastWriter
+	// (non-ASCII as \uXXXX); callers write object members in key order to get the same bytes.
+	class CMCPJsonWriter
+	{
+	public:
+		// Appends to strOut, which keeps its capacity when the caller reuses it.
+		explicit CMCPJsonWriter(std::string& strOut);
+
+		void StartObject();
+		void EndObject();
+		void StartArray();
+		void EndArray();
+		// Name of the next object member.
+		void Key(const char* lpcszKey);
+		void Key(const std::string& strKey);
+
+		void String(const char* pData, size_t nLength);
+		void String(const std::string& strValue);
+		// One string value written in pieces, for text too large to be held at once. The pieces may
+		// split UTF-8 sequences; the output is the same as for the whole string passed to String().
+		void StartString();
+		void StringChunk(const char* pData, size_t nLength);
+		void EndString();
+		// Raw bytes written as a base64 string value.
+		void Base64(const unsigned char* pData, size_t nLength);
+		// Inside StartString()/EndString(): appends the base64 encoding of the bytes. Every chunk
+		// but the last must hold a multiple of 3 bytes, so that no padding ends up in the middle.
+		void Base64Chunk(const unsigned char* pData, size_t nLength);
+		void Int(long long llValue);
+		void UInt(unsigned long long ullValue);
+		void Bool(bool bValue);
+		void Null();
+		// Writes a whole tree, for the members that are only available as Json::Value.
+		void Value(const Json::Value& jValue);
+
+	private:
+		// Emits the separator due before a new value or member.
+		void BeforeValue();
+		void AppendQuoted(const char* pData, size_t nLength);
+		// Returns the bytes consumed; unless bFinal, a trailing incomplete UTF-8 sequence is left over.
+		size_t AppendEscaped(const char* pData, size_t nLength, bool bFinal);
+
+		std::string& m_strOut;
+		// One entry per open container: whether it already holds a value.
+		std::vector<bool> m_vecHasValue;
+		bool m_bAfterKey{ false };
+		// Start of a UTF-8 sequence split between two StringChunk() calls.
+		std::string m_strPartial;
+	};
+}
@@ -1,6 +1,51 @@
 #include "Message.h"
+#include "../Public/Trace.h"
+#include <chrono>
 
 namespace MCP
 {
-	std::atomic_ulong Message::s_ulIdBase{ 0 };
+	// Runtime ids a thread reserves at once; 0 is left for messages that were never stamped.
+	static constexpr unsigned long RUNTIME_ID_BLOCK = 1024;
+
+	std::atomic_ulong Message::s_ulIdBase{ 1 };
+
+	void Message::Stamp()
+	{
+		if (!bNeedIdentity || IsStamped())
+			return;
+
+		thread_local unsigned long s_ulNextId = 0;
+		thread_local unsigned long s_ulEndId = 0;
+		if (s_ulNextId == s_ulEndId)
+		{
+			s_ulNextId = s_ulIdBase.fetch_add(RUNTIME_ID_BLOCK, std::memory_order_relaxed);
+			s_ulEndId = s_ulNextId + RUNTIME_ID_BLOCK;
+		}
+		ulRuntimeId = s_ulNextId++;
+		ullTimestamp = NowMs();
+	}
+
+	int Message::Serialize(std::string& str) const
+	{
+		MCP_TRACE_SCOPE("serialize");
+		str.clear();
+		CMCPJsonWriter writer(str);
+		int iErrCode = DoWrite(writer);
+		if (ERRNO_OK != iErrCode)
+			return iErrCode;
+		str.push_back('\n');
+
+		return ERRNO_OK;
+	}
+
+	unsigned long long Message::NowMs()
+	{
+		// The wall clock is read once; afterwards only the steady clock is.
+		static const auto s_tpSteadyBase = std::chrono::steady_clock::now();
+		static const auto s_llWallBaseMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::system_clock::now().time_since_epoch()).count();
+
+		auto llElapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - s_tpSteadyBase).count();
+		return static_cast<unsigned long long>(s_llWallBaseMs + llElapsedMs);
+	}
 }
\ No newline at end of file
@@ -3,6 +3,8 @@
 // ǱҪ£ֹʹضϵͳƽ̨API
 
 #include "../Public/PublicDef.h"
+#include "JsonParser.h"
+#include "JsonWriter.h"
 #include <atomic>
 
 namespace MCP
@@ -10,18 +12,12 @@ namespace MCP
 	struct Message
 	{
 	public:
+		// bNeedIdentity only allows the message to be stamped; construction itself reads no clock.
 		Message(MessageType eMsgType, MessageCategory eCategory, bool bNeedIdentity)
 			: eMessageType(eMsgType)
 			, eMessageCategory(eCategory)
+			, bNeedIdentity(bNeedIdentity)
 		{
-			if (bNeedIdentity)
-			{
-				auto now = std::chrono::system_clock::now();
-				auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch());
-				ullTimestamp = duration.count();
-
-				ulRuntimeId = s_ulIdBase++;
-			}
 		}
 		virtual ~Message() {};
 
@@ -30,26 +26,37 @@ namespace MCP
 		bool bExist{ true };	// ѡʱǷ
 		unsigned long long ullTimestamp{ 0 };	// 뼶ʱ
 		unsigned long ulRuntimeId{ 0 };	// ʱid
+		bool bNeedIdentity{ false };
 		static std::atomic_ulong s_ulIdBase;
 
-		int Serialize(std::string& str) const
-		{
-			Json::Value jMsg(Json::objectValue);
-			int iErrCode = DoSerialize(jMsg);
-			if (ERRNO_OK != iErrCode)
-				return iErrCode;
+		// Gives a message that is actually received or sent its timestamp and runtime id; a no-op
+		// if it is stamped already or does not need an identity. Ids are taken from per-thread
+		// blocks of s_ulIdBase, so they are unique but only ordered among the messages of one thread.
+		void Stamp();
+		bool IsStamped() const { return ulRuntimeId != 0; }
 
-			Json::FastWriter writer;
-			str = writer.write(jMsg);
+		// Milliseconds since the epoch, read from the steady clock: cheap, and never jumping
+		// backwards when the system time is adjusted.
+		static unsigned long long NowMs();
 
-			return ERRNO_OK;
-		}
+		// Replaces str with the compact JSON text of the message and a line feed.
+		int Serialize(std::string& str) const;
 
+		// Convenience wrapper for callers that only hold the raw text.
+		// The session dispatch path parses once and calls Deserialize(const Json::Value&).
 		int Deserialize(const std::string& str)
 		{
-			Json::Reader reader;
+			CMCPJsonParser parser;
 			Json::Value jMsg(Json::objectValue);
-			if (!reader.parse(str, jMsg) || !jMsg.isObject())
+			if (!parser.Parse(str, jMsg))
+				return ERRNO_PARSE_ERROR;
+
+			return Deserialize(jMsg);
+		}
+
+		int Deserialize(const Json::Value& jMsg)
+		{
+			if (!jMsg.isObject())
 				return ERRNO_PARSE_ERROR;
 
 			int iErrCode = DoDeserialize(jMsg);
@@ -62,5 +69,19 @@ namespace MCP
 		virtual bool IsValid() const = 0;
 		virtual int DoSerialize(Json::Value& jMsg) const = 0;
 		virtual int DoDeserialize(const Json::Value& jMsg) = 0;
+
+		// Writes the message as one JSON object. The default builds the Json::Value tree of
+		// DoSerialize(); messages sent often override it to write their members directly,
+		// and must check everything that can fail before the first write.
+		virtual int DoWrite(CMCPJsonWriter& writer) const
+		{
+			Json::Value jMsg(Json::objectValue);
+			int iErrCode = DoSerialize(jMsg);
+			if (ERRNO_OK != iErrCode)
+				return iErrCode;
+			writer.Value(jMsg);
+
+			return ERRNO_OK;
+		}
 	};
 }
@@ -11,10 +11,10 @@ namespace MCP
 			return ERRNO_INVALID_REQUEST;
 
 		Json::Value jRPC(JSON_RPC_VER);
-		jMsg[MSG_KEY_JSONRPC] = jRPC;
+		jMsg[MSG_KEY_JSONRPC] = std::move(jRPC);
 
 		Json::Value jMethod(strMethod);
-		jMsg[MSG_KEY_METHOD] = jMethod;
+		jMsg[MSG_KEY_METHOD] = std::move(jMethod);
 
 		return ERRNO_OK;
 	}
@@ -54,6 +54,16 @@ namespace MCP
 		return true;
 	}
 
+	////////////////////////////////////////////////////////////////////////////////////////
+	// ToolListChangedNotification
+	bool ToolListChangedNotification::IsValid() const
+	{
+		if (strMethod.compare(METHOD_NOTIFICATION_TOOLS_LIST_CHANGED) != 0)
+			return false;
+
+		return true;
+	}
+
 	////////////////////////////////////////////////////////////////////////////////////////
 	// CancelledNotification
 	int CancelledNotification::DoSerialize(Json::Value& jMsg) const
@@ -64,7 +74,7 @@ namespace MCP
 
 		Json::Value jParams(Json::objectValue);
 		requestId.DoSerialize(jParams);
-		jMsg[MSG_KEY_PARAMS] = jParams;
+		jMsg[MSG_KEY_PARAMS] = std::move(jParams);
 
 		return ERRNO_OK;
 	}
@@ -72,7 +82,9 @@ namespace MCP
 	int CancelledNotification::DoDeserialize(const Json::Value& jMsg)
 	{
 		int iErrCode = Notification::DoDeserialize(jMsg);
-		
+		if (ERRNO_OK != iErrCode)
+			return iErrCode;
+
 		if (!jMsg.isMember(MSG_KEY_PARAMS) || !jMsg[MSG_KEY_PARAMS].isObject())
 			return ERRNO_INVALID_NOTIFICATION;
 		auto& jParams = jMsg[MSG_KEY_PARAMS];
@@ -103,20 +115,48 @@ namespace MCP
 		Json::Value jParams(Json::objectValue);
 		progressToken.DoSerialize(jParams);
 		Json::Value jProgress(iProgress);
-		jParams[MSG_KEY_PROGRESS] = jProgress;
+		jParams[MSG_KEY_PROGRESS] = std::move(jProgress);
 		if (iTotal != -1)
 		{
 			Json::Value jTotal(iTotal);
-			jParams[MSG_KEY_TOTAL] = jTotal;
+			jParams[MSG_KEY_TOTAL] = std::move(jTotal);
 		}
-		jMsg[MSG_KEY_PARAMS] = jParams;
+		jMsg[MSG_KEY_PARAMS] = std::move(jParams);
 		
 		return ERRNO_OK;
 	}
 
+	int ProgressNotification::DoWrite(CMCPJsonWriter& writer) const
+	{
+		if (!IsValid())
+			return ERRNO_INVALID_REQUEST;
+
+		writer.StartObject();
+		writer.Key(MSG_KEY_JSONRPC);
+		writer.String(JSON_RPC_VER);
+		writer.Key(MSG_KEY_METHOD);
+		writer.String(strMethod);
+		writer.Key(MSG_KEY_PARAMS);
+		writer.StartObject();
+		writer.Key(MSG_KEY_PROGRESS);
+		writer.Int(iProgress);
+		progressToken.WriteMember(writer);
+		if (iTotal != -1)
+		{
+			writer.Key(MSG_KEY_TOTAL);
+			writer.Int(iTotal);
+		}
+		writer.EndObject();
+		writer.EndObject();
+
+		return ERRNO_OK;
+	}
+
 	int ProgressNotification::DoDeserialize(const Json::Value& jMsg)
 	{
 		int iErrCode = Notification::DoDeserialize(jMsg);
+		if (ERRNO_OK != iErrCode)
+			return iErrCode;
 
 		if (!jMsg.isMember(MSG_KEY_PARAMS) || !jMsg[MSG_KEY_PARAMS].isObject())
 			return ERRNO_INVALID_NOTIFICATION;
@@ -145,56 +185,112 @@ namespace MCP
 
 		return progressToken.IsValid();
 	}
-}
 
-namespace MCP
-{
-    // LogNotification
-    int LogNotification::DoSerialize(Json::Value& jMsg) const
-    {
-        int iErrCode = Notification::DoSerialize(jMsg);
-        if (ERRNO_OK != iErrCode)
-            return iErrCode;
-
-        Json::Value jParams(Json::objectValue);
-        if (!strLevel.empty())
-        {
-            Json::Value jLevel(strLevel);
-            jParams[MSG_KEY_LEVEL] = jLevel;
-        }
-        if (!strText.empty())
-        {
-            Json::Value jMessage(strText);
-            jParams[MSG_KEY_MESSAGE] = jMessage;
-        }
-        jMsg[MSG_KEY_PARAMS] = jParams;
-
-        return ERRNO_OK;
-    }
-
-    int LogNotification::DoDeserialize(const Json::Value& jMsg)
-    {
-        int iErrCode = Notification::DoDeserialize(jMsg);
-        if (ERRNO_OK != iErrCode)
-            return iErrCode;
-
-        if (jMsg.isMember(MSG_KEY_PARAMS) && jMsg[MSG_KEY_PARAMS].isObject())
-        {
-            auto& jParams = jMsg[MSG_KEY_PARAMS];
-            if (jParams.isMember(MSG_KEY_LEVEL) && jParams[MSG_KEY_LEVEL].isString())
-                strLevel = jParams[MSG_KEY_LEVEL].asString();
-            if (jParams.isMember(MSG_KEY_MESSAGE) && jParams[MSG_KEY_MESSAGE].isString())
-                strText = jParams[MSG_KEY_MESSAGE].asString();
-        }
-        return ERRNO_OK;
-    }
-
-    bool LogNotification::IsValid() const
-    {
-        if (!Notification::IsValid())
-            return false;
-        if (strMethod.compare(METHOD_NOTIFICATION_LOG) != 0)
-            return false;
-        return !strText.empty();
-    }
-}
\ No newline at end of file
+	////////////////////////////////////////////////////////////////////////////////////////
+	// ResourceUpdatedNotification
+	int ResourceUpdatedNotification::DoSerialize(Json::Value& jMsg) const
+	{
+		int iErrCode = Notification::DoSerialize(jMsg);
+		if (ERRNO_OK != iErrCode)
+			return iErrCode;
+
+		Json::Value jParams(Json::objectValue);
+		jParams[MSG_KEY_URI] = Json::Value(strUri);
+		jMsg[MSG_KEY_PARAMS] = std::move(jParams);
+
+		return ERRNO_OK;
+	}
+
+	int ResourceUpdatedNotification::DoWrite(CMCPJsonWriter& writer) const
+	{
+		if (!IsValid())
+			return ERRNO_INVALID_REQUEST;
+
+		writer.StartObject();
+		writer.Key(MSG_KEY_JSONRPC);
+		writer.String(JSON_RPC_VER);
+		writer.Key(MSG_KEY_METHOD);
+		writer.String(strMethod);
+		writer.Key(MSG_KEY_PARAMS);
+		writer.StartObject();
+		writer.Key(MSG_KEY_URI);
+		writer.String(strUri);
+		writer.EndObject();
+		writer.EndObject();
+
+		return ERRNO_OK;
+	}
+
+	int ResourceUpdatedNotification::DoDeserialize(const Json::Value& jMsg)
+	{
+		int iErrCode = Notification::DoDeserialize(jMsg);
+		if (ERRNO_OK != iErrCode)
+			return iErrCode;
+
+		if (!jMsg.isMember(MSG_KEY_PARAMS) || !jMsg[MSG_KEY_PARAMS].isObject())
+			return ERRNO_INVALID_NOTIFICATION;
+		auto& jParams = jMsg[MSG_KEY_PARAMS];
+		if (!jParams.isMember(MSG_KEY_URI) || !jParams[MSG_KEY_URI].isString())
+			return ERRNO_INVALID_NOTIFICATION;
+		strUri = jParams[MSG_KEY_URI].asString();
+
+		return ERRNO_OK;
+	}
+
+	bool ResourceUpdatedNotification::IsValid() const
+	{
+		if (!Notification::IsValid())
+			return false;
+
+		if (strMethod.compare(METHOD_NOTIFICATION_RESOURCES_UPDATED) != 0)
+			return false;
+
+		return !strUri.empty();
+	}
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	// LogNotification
+	int LogNotification::DoSerialize(Json::Value& jMsg) const
+	{
+		int iErrCode = Notification::DoSerialize(jMsg);
+		if (ERRNO_OK != iErrCode)
+			return iErrCode;
+
+		Json::Value jParams(Json::objectValue);
+		jParams[MSG_KEY_LEVEL] = strLevel;
+		if (!strLogger.empty())
+			jParams[MSG_KEY_LOGGER] = strLogger;
+		jParams[MSG_KEY_DATA] = jData;
+		jMsg[MSG_KEY_PARAMS] = std::move(jParams);
+
+		return ERRNO_OK;
+	}
+
+	int LogNotification::DoDeserialize(const Json::Value& jMsg)
+	{
+		int iErrCode = Notification::DoDeserialize(jMsg);
+		if (ERRNO_OK != iErrCode)
+			return iErrCode;
+
+		if (!jMsg.isMember(MSG_KEY_PARAMS) || !jMsg[MSG_KEY_PARAMS].isObject())
+			return ERRNO_INVALID_NOTIFICATION;
+		auto& jParams = jMsg[MSG_KEY_PARAMS];
+		if (!jParams.isMember(MSG_KEY_LEVEL) || !jParams[MSG_KEY_LEVEL].isString() || !jParams.isMember(MSG_KEY_DATA))
+			return ERRNO_INVALID_NOTIFICATION;
+		strLevel = jParams[MSG_KEY_LEVEL].asString();
+		if (jParams.isMember(MSG_KEY_LOGGER) && jParams[MSG_KEY_LOGGER].isString())
+			strLogger = jParams[MSG_KEY_LOGGER].asString();
+		jData = jParams[MSG_KEY_DATA];
+
+		return ERRNO_OK;
+	}
+
+	bool LogNotification::IsValid() const
+	{
+		if (!Notification::IsValid())
+			return false;
+		if (strMethod.compare(METHOD_NOTIFICATION_MESSAGE) != 0)
+			return false;
+		return !strLevel.empty() && !jData.isNull();
+	}
+}
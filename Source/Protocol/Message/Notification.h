@@ -67,9 +67,41 @@ namespace MCP
 		bool IsValid() const override;
 		int DoSerialize(Json::Value& jMsg) const override;
 		int DoDeserialize(const Json::Value& jMsg) override;
+		int DoWrite(CMCPJsonWriter& writer) const override;
 	};
 
-	// Structured log notification (utility in 2025-06-18 spec). This is optional for hosts.
+	// Sent to initialized clients when the tools were registered again while serving.
+	struct ToolListChangedNotification : public MCP::Notification
+	{
+	public:
+		ToolListChangedNotification(bool bNeedIdentity)
+			: Notification(MessageType_ToolListChangedNotification, bNeedIdentity)
+		{
+
+		}
+
+		bool IsValid() const override;
+	};
+
+	// Sent to the sessions subscribed to the resource once its content changed.
+	struct ResourceUpdatedNotification : public MCP::Notification
+	{
+	public:
+		ResourceUpdatedNotification(bool bNeedIdentity)
+			: Notification(MessageType_ResourceUpdatedNotification, bNeedIdentity)
+		{
+
+		}
+
+		std::string strUri;
+
+		bool IsValid() const override;
+		int DoSerialize(Json::Value& jMsg) const override;
+		int DoDeserialize(const Json::Value& jMsg) override;
+		int DoWrite(CMCPJsonWriter& writer) const override;
+	};
+
+	// notifications/message: a log message sent to clients that asked for it with logging/setLevel.
 	struct LogNotification : public MCP::Notification
 	{
 	public:
@@ -79,9 +111,12 @@ namespace MCP
 
 		}
 
-		// minimal fields: level and message
+		// One of the syslog severities, see LogLevelName().
 		std::string strLevel;
-		std::string strText;
+		// Optional name of the component logging.
+		std::string strLogger;
+		// Any JSON value; the SDK logger sends the formatted text.
+		Json::Value jData;
 
 		bool IsValid() const override;
 		int DoSerialize(Json::Value& jMsg) const override;
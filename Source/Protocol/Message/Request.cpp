@@ -11,21 +11,24 @@ namespace MCP
 			return ERRNO_INVALID_REQUEST;
 
 		Json::Value jRPC(JSON_RPC_VER);
-		jMsg[MSG_KEY_JSONRPC] = jRPC;
+		jMsg[MSG_KEY_JSONRPC] = std::move(jRPC);
 
 		Json::Value jMethod(strMethod);
-		jMsg[MSG_KEY_METHOD] = jMethod;
+		jMsg[MSG_KEY_METHOD] = std::move(jMethod);
 
-		if (progressToken.IsValid())
+		if (progressToken.IsValid() || nTimeoutMs > 0)
 		{
 			Json::Value jParams(Json::objectValue);
 			if (jMsg.isMember(MCP::MSG_KEY_PARAMS) && jMsg[MCP::MSG_KEY_PARAMS].isObject())
 				jParams = jMsg[MCP::MSG_KEY_PARAMS];
 
 			Json::Value jMeta(Json::objectValue);
-			progressToken.DoSerialize(jMeta);
-			jParams[MSG_KEY_META] = jMeta;
-			jMsg[MSG_KEY_PARAMS] = jParams;
+			if (progressToken.IsValid())
+				progressToken.DoSerialize(jMeta);
+			if (nTimeoutMs > 0)
+				jMeta[MSG_KEY_TIMEOUT_MS] = nTimeoutMs;
+			jParams[MSG_KEY_META] = std::move(jMeta);
+			jMsg[MSG_KEY_PARAMS] = std::move(jParams);
 		}
 
 		return requestId.DoSerialize(jMsg);
@@ -52,6 +55,8 @@ namespace MCP
 			{
 				auto& jMeta = jParams[MSG_KEY_META];
 				progressToken.DoDeserialize(jMeta);
+				if (jMeta.isMember(MSG_KEY_TIMEOUT_MS) && jMeta[MSG_KEY_TIMEOUT_MS].isUInt())
+					nTimeoutMs = jMeta[MSG_KEY_TIMEOUT_MS].asUInt();
 			}
 		}
 
@@ -94,6 +99,22 @@ namespace MCP
 			return ERRNO_INVALID_REQUEST;
 		auto& jClientInfo = jParams[MSG_KEY_CLIENT_INFO];
 
+		vecEncodings.clear();
+		if (jParams.isMember(MSG_KEY_CAPABILITIES) && jParams[MSG_KEY_CAPABILITIES].isObject())
+		{
+			auto& jCapabilities = jParams[MSG_KEY_CAPABILITIES];
+			if (jCapabilities.isMember(MSG_KEY_EXPERIMENTAL) && jCapabilities[MSG_KEY_EXPERIMENTAL].isObject()
+				&& jCapabilities[MSG_KEY_EXPERIMENTAL].isMember(MSG_KEY_ENCODINGS)
+				&& jCapabilities[MSG_KEY_EXPERIMENTAL][MSG_KEY_ENCODINGS].isArray())
+			{
+				for (auto& jEncoding : jCapabilities[MSG_KEY_EXPERIMENTAL][MSG_KEY_ENCODINGS])
+				{
+					if (jEncoding.isString())
+						vecEncodings.push_back(jEncoding.asString());
+				}
+			}
+		}
+
 		return clientInfo.DoDeserialize(jClientInfo);
 	}
 
@@ -262,6 +283,26 @@ namespace MCP
 			return ERRNO_INVALID_REQUEST;
 		strUri = jParams[MSG_KEY_URI].asString();
 
+		if (jParams.isMember(MSG_KEY_RANGE))
+		{
+			auto& jRange = jParams[MSG_KEY_RANGE];
+			if (!jRange.isObject())
+				return ERRNO_INVALID_PARAMS;
+			if (jRange.isMember(MSG_KEY_OFFSET))
+			{
+				if (!jRange[MSG_KEY_OFFSET].isUInt64())
+					return ERRNO_INVALID_PARAMS;
+				ullRangeOffset = jRange[MSG_KEY_OFFSET].asUInt64();
+			}
+			if (jRange.isMember(MSG_KEY_LENGTH))
+			{
+				if (!jRange[MSG_KEY_LENGTH].isUInt64())
+					return ERRNO_INVALID_PARAMS;
+				ullRangeLength = jRange[MSG_KEY_LENGTH].asUInt64();
+			}
+			bRange = true;
+		}
+
 		return ERRNO_OK;
 	}
 
@@ -276,6 +317,74 @@ namespace MCP
 		return true;
 	}
 
+	////////////////////////////////////////////////////////////////////////////////////////
+	// SubscribeRequest
+	int SubscribeRequest::DoSerialize(Json::Value& jMsg) const
+	{
+		return Request::DoSerialize(jMsg);
+	}
+
+	int SubscribeRequest::DoDeserialize(const Json::Value& jMsg)
+	{
+		int iErrCode = Request::DoDeserialize(jMsg);
+		if (ERRNO_OK != iErrCode)
+			return iErrCode;
+
+		if (!jMsg.isMember(MSG_KEY_PARAMS) || !jMsg[MSG_KEY_PARAMS].isObject())
+			return ERRNO_INVALID_REQUEST;
+		auto& jParams = jMsg[MSG_KEY_PARAMS];
+
+		if (!jParams.isMember(MSG_KEY_URI) || !jParams[MSG_KEY_URI].isString())
+			return ERRNO_INVALID_REQUEST;
+		strUri = jParams[MSG_KEY_URI].asString();
+
+		return ERRNO_OK;
+	}
+
+	bool SubscribeRequest::IsValid() const
+	{
+		if (!Request::IsValid())
+			return false;
+		if (strMethod.compare(METHOD_RESOURCES_SUBSCRIBE) != 0 && strMethod.compare(METHOD_RESOURCES_UNSUBSCRIBE) != 0)
+			return false;
+		if (strUri.empty())
+			return false;
+		return true;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	// SetLevelRequest
+	int SetLevelRequest::DoSerialize(Json::Value& jMsg) const
+	{
+		return Request::DoSerialize(jMsg);
+	}
+
+	int SetLevelRequest::DoDeserialize(const Json::Value& jMsg)
+	{
+		int iErrCode = Request::DoDeserialize(jMsg);
+		if (ERRNO_OK != iErrCode)
+			return iErrCode;
+
+		if (!jMsg.isMember(MSG_KEY_PARAMS) || !jMsg[MSG_KEY_PARAMS].isObject())
+			return ERRNO_INVALID_PARAMS;
+		auto& jParams = jMsg[MSG_KEY_PARAMS];
+
+		if (!jParams.isMember(MSG_KEY_LEVEL) || !jParams[MSG_KEY_LEVEL].isString())
+			return ERRNO_INVALID_PARAMS;
+		strLevel = jParams[MSG_KEY_LEVEL].asString();
+
+		return ERRNO_OK;
+	}
+
+	bool SetLevelRequest::IsValid() const
+	{
+		if (!Request::IsValid())
+			return false;
+		if (strMethod.compare(METHOD_LOGGING_SET_LEVEL) != 0)
+			return false;
+		return !strLevel.empty();
+	}
+
 	////////////////////////////////////////////////////////////////////////////////////////
 	// ListPromptsRequest
 	int ListPromptsRequest::DoSerialize(Json::Value& jMsg) const
@@ -3,6 +3,7 @@
 // Avoid using platform-specific system APIs unless absolutely necessary.
 
 #include <string>
+#include <vector>
 #include <json/json.h>
 #include "BasicMessage.h"
 
@@ -20,6 +21,8 @@ namespace MCP
 		MCP::RequestId requestId;
 		std::string strMethod;
 		MCP::ProgressToken progressToken;
+		// _meta.timeoutMs, 0 when the client did not ask for a deadline
+		unsigned int nTimeoutMs{ 0 };
 
 		bool IsValid() const override;
 		int DoSerialize(Json::Value& jMsg) const override;
@@ -37,6 +40,8 @@ namespace MCP
 
 		std::string strProtocolVer;
 		Implementation clientInfo;
+		// capabilities.experimental.encodings: message encodings the client can use besides JSON.
+		std::vector<std::string> vecEncodings;
 
 		bool IsValid() const override;
 		int DoSerialize(Json::Value& jMsg) const override;
@@ -99,6 +104,45 @@ namespace MCP
 		}
 
 		std::string strUri;
+		// Optional "range": {"offset", "length"} in bytes, an extension for reading part of a large
+		// resource; a length of 0 reads to the end.
+		bool bRange{ false };
+		unsigned long long ullRangeOffset{ 0 };
+		unsigned long long ullRangeLength{ 0 };
+
+		bool IsValid() const override;
+		int DoSerialize(Json::Value& jMsg) const override;
+		int DoDeserialize(const Json::Value& jMsg) override;
+	};
+
+	// resources/subscribe and resources/unsubscribe, which carry the same params.
+	struct SubscribeRequest : public MCP::Request
+	{
+	public:
+		SubscribeRequest(bool bNeedIdentity)
+			: Request(MessageType_SubscribeRequest, bNeedIdentity)
+		{
+
+		}
+
+		std::string strUri;
+
+		bool IsValid() const override;
+		int DoSerialize(Json::Value& jMsg) const override;
+		int DoDeserialize(const Json::Value& jMsg) override;
+	};
+
+	// logging/setLevel
+	struct SetLevelRequest : public MCP::Request
+	{
+	public:
+		SetLevelRequest(bool bNeedIdentity)
+			: Request(MessageType_SetLevelRequest, bNeedIdentity)
+		{
+
+		}
+
+		std::string strLevel;
 
 		bool IsValid() const override;
 		int DoSerialize(Json::Value& jMsg) const override;
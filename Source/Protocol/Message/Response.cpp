@@ -11,7 +11,7 @@ namespace MCP
 			return ERRNO_INVALID_RESPONSE;
 
 		Json::Value jRPC(JSON_RPC_VER);
-		jMsg[MSG_KEY_JSONRPC] = jRPC;
+		jMsg[MSG_KEY_JSONRPC] = std::move(jRPC);
 
 		return requestId.DoSerialize(jMsg);
 	}
@@ -32,6 +32,51 @@ namespace MCP
 		return requestId.IsValid();
 	}
 
+	void Response::WriteEnvelope(CMCPJsonWriter& writer) const
+	{
+		requestId.WriteMember(writer);
+		writer.Key(MSG_KEY_JSONRPC);
+		writer.String(JSON_RPC_VER);
+	}
+
+	void Response::WrapResult(const MCP::RequestId& requestId, const std::string& strResult, std::string& strResponse)
+	{
+		// The writer orders the keys, "result" comes last.
+		strResponse.clear();
+		strResponse.reserve(strResult.size() + 64);
+		CMCPJsonWriter writer(strResponse);
+		writer.StartObject();
+		requestId.WriteMember(writer);
+		writer.Key(MSG_KEY_JSONRPC);
+		writer.String(JSON_RPC_VER);
+		writer.Key(MSG_KEY_RESULT);
+		strResponse.append(strResult);
+		strResponse.append("}\n");
+	}
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	// EmptyResult
+	int EmptyResult::DoSerialize(Json::Value& jMsg) const
+	{
+		jMsg[MSG_KEY_RESULT] = Json::Value(Json::objectValue);
+		return Response::DoSerialize(jMsg);
+	}
+
+	int EmptyResult::DoWrite(CMCPJsonWriter& writer) const
+	{
+		if (!IsValid())
+			return ERRNO_INVALID_RESPONSE;
+
+		writer.StartObject();
+		WriteEnvelope(writer);
+		writer.Key(MSG_KEY_RESULT);
+		writer.StartObject();
+		writer.EndObject();
+		writer.EndObject();
+
+		return ERRNO_OK;
+	}
+
 	////////////////////////////////////////////////////////////////////////////////////////
 	// ErrorResponse
 	int ErrorResponse::DoSerialize(Json::Value& jMsg) const
@@ -45,11 +90,30 @@ namespace MCP
 
 		Json::Value jError(Json::objectValue);
 		Json::Value jCode(iCode);
-		jError[MSG_KEY_CODE] = jCode;
+		jError[MSG_KEY_CODE] = std::move(jCode);
 		Json::Value jMessage(strMesage);
-		jError[MSG_KEY_MESSAGE] = jMessage;
+		jError[MSG_KEY_MESSAGE] = std::move(jMessage);
+
+		jMsg[MSG_KEY_ERROR] = std::move(jError);
+
+		return ERRNO_OK;
+	}
+
+	int ErrorResponse::DoWrite(CMCPJsonWriter& writer) const
+	{
+		if (!IsValid())
+			return ERRNO_INVALID_RESPONSE;
 
-		jMsg[MSG_KEY_ERROR] = jError;
+		writer.StartObject();
+		writer.Key(MSG_KEY_ERROR);
+		writer.StartObject();
+		writer.Key(MSG_KEY_CODE);
+		writer.Int(iCode);
+		writer.Key(MSG_KEY_MESSAGE);
+		writer.String(strMesage);
+		writer.EndObject();
+		WriteEnvelope(writer);
+		writer.EndObject();
 
 		return ERRNO_OK;
 	}
@@ -74,7 +138,7 @@ namespace MCP
 		Json::Value jResult(Json::objectValue);
 		
 		Json::Value jProtocolVersion(strProtocolVersion);
-		jResult[MSG_KEY_PROTOCOL_VERSION] = jProtocolVersion;
+		jResult[MSG_KEY_PROTOCOL_VERSION] = std::move(jProtocolVersion);
 
 		auto fnSerializeMember = [&jResult](const auto& objMember, const char* lpcszKey) -> int
 		{
@@ -83,13 +147,15 @@ namespace MCP
 			int iErrCode = objMember.DoSerialize(jMember);
 			if (ERRNO_OK != iErrCode)
 				return iErrCode;
-			jResult[lpcszKey] = jMember;
+			jResult[lpcszKey] = std::move(jMember);
 			
 			return ERRNO_OK;
 		};
 		int iErrCode = fnSerializeMember(capabilities, MSG_KEY_CAPABILITIES);
 		if (ERRNO_OK != iErrCode)
 			return iErrCode;
+		if (!strEncoding.empty())
+			jResult[MSG_KEY_CAPABILITIES][MSG_KEY_EXPERIMENTAL][MSG_KEY_ENCODING] = strEncoding;
 		iErrCode = fnSerializeMember(implServerInfo, MSG_KEY_SERVER_INFO);
 		if (ERRNO_OK != iErrCode)
 			return iErrCode;
@@ -97,7 +163,7 @@ namespace MCP
 		iErrCode = Response::DoSerialize(jMsg);
 		if (ERRNO_OK != iErrCode)
 			return iErrCode;
-		jMsg[MSG_KEY_RESULT] = jResult;
+		jMsg[MSG_KEY_RESULT] = std::move(jResult);
 
 		return ERRNO_OK;
 	}
@@ -130,18 +196,18 @@ namespace MCP
 			Json::Value jTool(Json::objectValue);
 			if (ERRNO_OK == tool.DoSerialize(jTool))
 			{
-				jTools.append(jTool);
+				jTools.append(std::move(jTool));
 			}
 		}
-		jResult[MSG_KEY_TOOLS] = jTools;
+		jResult[MSG_KEY_TOOLS] = std::move(jTools);
 
 		if (!strNextCursor.empty())
 		{
 			Json::Value jNextCursor(strNextCursor);
-			jResult[MSG_KEY_NEXT_CURSOR] = jNextCursor;
+			jResult[MSG_KEY_NEXT_CURSOR] = std::move(jNextCursor);
 		}
 
-		jMsg[MSG_KEY_RESULT] = jResult;
+		jMsg[MSG_KEY_RESULT] = std::move(jResult);
 
 		return Response::DoSerialize(jMsg);
 	}
@@ -163,34 +229,65 @@ namespace MCP
 		Json::Value jResult(Json::objectValue);
 
 		Json::Value jIsError(bIsError);
-		jResult[MSG_KEY_IS_ERROR] = jIsError;
+		jResult[MSG_KEY_IS_ERROR] = std::move(jIsError);
 
 		Json::Value jContent(Json::arrayValue);
 		for (auto& text : vecTextContent)
 		{
 			Json::Value jTextContent(Json::objectValue);
 			if (ERRNO_OK == text.DoSerialize(jTextContent))
-				jContent.append(jTextContent);
+				jContent.append(std::move(jTextContent));
 		}
 		for (auto& image : vecImageContent)
 		{
 			Json::Value jImageContent(Json::objectValue);
 			if (ERRNO_OK == image.DoSerialize(jImageContent))
-				jContent.append(jImageContent);
+				jContent.append(std::move(jImageContent));
 		}
 		for (auto& embedded : vecEmbeddedResource)
 		{
 			Json::Value jEmbedded(Json::objectValue);
 			if (ERRNO_OK == embedded.DoSerialize(jEmbedded))
-				jContent.append(jEmbedded);
+				jContent.append(std::move(jEmbedded));
 		}
-		jResult[MSG_KEY_CONTENT] = jContent;
+		jResult[MSG_KEY_CONTENT] = std::move(jContent);
 
-		jMsg[MSG_KEY_RESULT] = jResult;
+		jMsg[MSG_KEY_RESULT] = std::move(jResult);
 
 		return Response::DoSerialize(jMsg);
 	}
 
+	int CallToolResult::DoWrite(CMCPJsonWriter& writer) const
+	{
+		if (!IsValid())
+			return ERRNO_INVALID_RESPONSE;
+
+		writer.StartObject();
+		WriteEnvelope(writer);
+		writer.Key(MSG_KEY_RESULT);
+		WriteResult(writer);
+		writer.EndObject();
+
+		return ERRNO_OK;
+	}
+
+	void CallToolResult::WriteResult(CMCPJsonWriter& writer) const
+	{
+		writer.StartObject();
+		writer.Key(MSG_KEY_CONTENT);
+		writer.StartArray();
+		for (auto& text : vecTextContent)
+			text.DoWrite(writer);
+		for (auto& image : vecImageContent)
+			image.DoWrite(writer);
+		for (auto& embedded : vecEmbeddedResource)
+			embedded.DoWrite(writer);
+		writer.EndArray();
+		writer.Key(MSG_KEY_IS_ERROR);
+		writer.Bool(bIsError);
+		writer.EndObject();
+	}
+
 	////////////////////////////////////////////////////////////////////////////////////////
 	// ListResourcesResult
 	int ListResourcesResult::DoSerialize(Json::Value& jMsg) const
@@ -198,21 +295,21 @@ namespace MCP
 		Json::Value jResult(Json::objectValue);
 
 		Json::Value jResources(Json::arrayValue);
-		for (auto& embedded : vecResources)
+		for (auto& resource : vecResources)
 		{
-			Json::Value jEmbedded(Json::objectValue);
-			if (ERRNO_OK == embedded.DoSerialize(jEmbedded))
-				jResources.append(jEmbedded);
+			Json::Value jResource(Json::objectValue);
+			if (ERRNO_OK == resource.DoSerialize(jResource))
+				jResources.append(std::move(jResource));
 		}
-		jResult[MSG_KEY_RESOURCES] = jResources;
+		jResult[MSG_KEY_RESOURCES] = std::move(jResources);
 
 		if (!strNextCursor.empty())
 		{
 			Json::Value jNextCursor(strNextCursor);
-			jResult[MSG_KEY_NEXT_CURSOR] = jNextCursor;
+			jResult[MSG_KEY_NEXT_CURSOR] = std::move(jNextCursor);
 		}
 
-		jMsg[MSG_KEY_RESULT] = jResult;
+		jMsg[MSG_KEY_RESULT] = std::move(jResult);
 		return Response::DoSerialize(jMsg);
 	}
 
@@ -229,7 +326,7 @@ namespace MCP
 		{
 			Json::Value jTextContent(Json::objectValue);
 			if (ERRNO_OK == textContent.DoSerialize(jTextContent))
-				jContents.append(jTextContent);
+				jContents.append(std::move(jTextContent));
 		}
 		
 		// Add blob contents
@@ -237,15 +334,39 @@ namespace MCP
 		{
 			Json::Value jBlobContent(Json::objectValue);
 			if (ERRNO_OK == blobContent.DoSerialize(jBlobContent))
-				jContents.append(jBlobContent);
+				jContents.append(std::move(jBlobContent));
 		}
 		
-		jResult[MSG_KEY_CONTENT] = jContents;
+		jResult[MSG_KEY_CONTENTS] = std::move(jContents);
 
-		jMsg[MSG_KEY_RESULT] = jResult;
+		jMsg[MSG_KEY_RESULT] = std::move(jResult);
 		return Response::DoSerialize(jMsg);
 	}
 
+	int ReadResourceResult::DoWrite(CMCPJsonWriter& writer) const
+	{
+		writer.StartObject();
+		WriteEnvelope(writer);
+		writer.Key(MSG_KEY_RESULT);
+		WriteResult(writer);
+		writer.EndObject();
+
+		return ERRNO_OK;
+	}
+
+	void ReadResourceResult::WriteResult(CMCPJsonWriter& writer) const
+	{
+		writer.StartObject();
+		writer.Key(MSG_KEY_CONTENTS);
+		writer.StartArray();
+		for (auto& textContent : vecTextContents)
+			textContent.DoWrite(writer);
+		for (auto& blobContent : vecBlobContents)
+			blobContent.DoWrite(writer);
+		writer.EndArray();
+		writer.EndObject();
+	}
+
 	////////////////////////////////////////////////////////////////////////////////////////
 	// ListPromptsResult
 	int ListPromptsResult::DoSerialize(Json::Value& jMsg) const
@@ -253,21 +374,21 @@ namespace MCP
 		Json::Value jResult(Json::objectValue);
 
 		Json::Value jPrompts(Json::arrayValue);
-		for (auto& text : vecPrompts)
+		for (auto& prompt : vecPrompts)
 		{
-			Json::Value jText(Json::objectValue);
-			if (ERRNO_OK == text.DoSerialize(jText))
-				jPrompts.append(jText);
+			Json::Value jPrompt(Json::objectValue);
+			if (ERRNO_OK == prompt.DoSerialize(jPrompt))
+				jPrompts.append(std::move(jPrompt));
 		}
-		jResult[MSG_KEY_PROMPTS] = jPrompts;
+		jResult[MSG_KEY_PROMPTS] = std::move(jPrompts);
 
 		if (!strNextCursor.empty())
 		{
 			Json::Value jNextCursor(strNextCursor);
-			jResult[MSG_KEY_NEXT_CURSOR] = jNextCursor;
+			jResult[MSG_KEY_NEXT_CURSOR] = std::move(jNextCursor);
 		}
 
-		jMsg[MSG_KEY_RESULT] = jResult;
+		jMsg[MSG_KEY_RESULT] = std::move(jResult);
 		return Response::DoSerialize(jMsg);
 	}
 
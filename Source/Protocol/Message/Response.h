@@ -21,6 +21,14 @@ namespace MCP
 		bool IsValid() const override;
 		int DoSerialize(Json::Value& jMsg) const override;
 		int DoDeserialize(const Json::Value& jMsg) override;
+
+		// Wraps a serialized "result" value (see the WriteResult() of the results) into the response
+		// message of the request, with the same bytes as serializing the result message.
+		static void WrapResult(const MCP::RequestId& requestId, const std::string& strResult, std::string& strResponse);
+
+	protected:
+		// The "id" and "jsonrpc" members, for the direct writers of the results.
+		void WriteEnvelope(CMCPJsonWriter& writer) const;
 	};
 
 	struct ErrorResponse : public MCP::Response
@@ -38,6 +46,7 @@ namespace MCP
 		bool IsValid() const override;
 		int DoSerialize(Json::Value& jMsg) const override;
 		int DoDeserialize(const Json::Value& jMsg) override;
+		int DoWrite(CMCPJsonWriter& writer) const override;
 	};
 
 	struct InitializeResult : public MCP::Response
@@ -52,6 +61,8 @@ namespace MCP
 		std::string strProtocolVersion;
 		MCP::ServerCapabilities capabilities;
 		MCP::Implementation implServerInfo;
+		// Returned in capabilities.experimental.encoding; the messages following the response use it.
+		std::string strEncoding;
 
 		bool IsValid() const override;
 		int DoSerialize(Json::Value& jMsg) const override;
@@ -68,8 +79,29 @@ namespace MCP
 		}
 
 		bool IsValid() const override { return Response::IsValid(); }
-		int DoSerialize(Json::Value& jMsg) const override { return Response::DoSerialize(jMsg); }
+		// JSON-RPC requires the "result" member, an empty object for ping.
+		int DoSerialize(Json::Value& jMsg) const override
+		{
+			jMsg[MSG_KEY_RESULT] = Json::Value(Json::objectValue);
+			return Response::DoSerialize(jMsg);
+		}
+		int DoDeserialize(const Json::Value& jMsg) override { return Response::DoDeserialize(jMsg); }
+	};
+
+	// A result without members, e.g. of resources/subscribe.
+	struct EmptyResult : public MCP::Response
+	{
+	public:
+		EmptyResult(bool bNeedIdentity)
+			: Response(MessageType_EmptyResult, bNeedIdentity)
+		{
+
+		}
+
+		bool IsValid() const override { return Response::IsValid(); }
+		int DoSerialize(Json::Value& jMsg) const override;
 		int DoDeserialize(const Json::Value& jMsg) override { return Response::DoDeserialize(jMsg); }
+		int DoWrite(CMCPJsonWriter& writer) const override;
 	};
 
 	struct ListToolsResult : public MCP::Response
@@ -98,7 +130,7 @@ namespace MCP
 
 		}
 
-		std::vector<MCP::EmbeddedResource> vecResources;
+		std::vector<MCP::Resource> vecResources;
 		std::string strNextCursor;
 
 		bool IsValid() const override { return true; }
@@ -121,6 +153,9 @@ namespace MCP
 		bool IsValid() const override { return true; }
 		int DoSerialize(Json::Value& jMsg) const override;
 		int DoDeserialize(const Json::Value& jMsg) override { return Response::DoDeserialize(jMsg); }
+		int DoWrite(CMCPJsonWriter& writer) const override;
+		// Only the value of the "result" member, as kept by the resource read cache.
+		void WriteResult(CMCPJsonWriter& writer) const;
 	};
 
 	struct ListPromptsResult : public MCP::Response
@@ -132,7 +167,7 @@ namespace MCP
 
 		}
 
-		std::vector<MCP::TextContent> vecPrompts;
+		std::vector<MCP::Prompt> vecPrompts;
 		std::string strNextCursor;
 
 		bool IsValid() const override { return true; }
@@ -154,8 +189,21 @@ namespace MCP
 		std::vector<MCP::ImageContent> vecImageContent;
 		std::vector<MCP::EmbeddedResource> vecEmbeddedResource;
 
+		// Appends a text item built in place, taking the text over.
+		MCP::TextContent& AddText(std::string strText)
+		{
+			vecTextContent.emplace_back();
+			auto& textContent = vecTextContent.back();
+			textContent.strType = CONST_TEXT;
+			textContent.strText = std::move(strText);
+			return textContent;
+		}
+
 		bool IsValid() const override;
 		int DoSerialize(Json::Value& jMsg) const override;
 		int DoDeserialize(const Json::Value& jMsg) override;
+		int DoWrite(CMCPJsonWriter& writer) const override;
+		// Only the value of the "result" member, as kept by the tool result cache.
+		void WriteResult(CMCPJsonWriter& writer) const;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,342 @@
+#include "SchemaValidator.h"
+#include <utility>
+#include "../Public/PublicDef.h"
+
+namespace MCP
+{
+	static bool IsEqualValue(const Json::Value& jLeft, const Json::Value& jRight)
+	{
+		// 1 and 1.0, or a signed and an unsigned 1, are the same JSON number.
+		if (jLeft.isNumeric() && jRight.isNumeric())
+			return jLeft.asDouble() == jRight.asDouble();
+
+		return jLeft == jRight;
+	}
+
+	// Code points, as JSON Schema counts them.
+	static size_t Utf8Length(const char* pBegin, const char* pEnd)
+	{
+		size_t nLength = 0;
+		for (; pBegin < pEnd; ++pBegin)
+		{
+			if (0x80 != (static_cast<unsigned char>(*pBegin) & 0xC0))
+				++nLength;
+		}
+		return nLength;
+	}
+
+	int CMCPSchemaValidator::Compile(const Json::Value& jSchema)
+	{
+		m_vecNodes.clear();
+		if (!jSchema.isObject())
+			return ERRNO_OK;
+
+		CompileNode(jSchema);
+
+		return ERRNO_OK;
+	}
+
+	size_t CMCPSchemaValidator::CompileNode(const Json::Value& jSchema)
+	{
+		size_t nNode = m_vecNodes.size();
+		m_vecNodes.emplace_back();
+		if (!jSchema.isObject())
+			return nNode;
+
+		// Children are compiled into the vector first: the node is only referenced by index.
+		Node node;
+		auto& jType = jSchema["type"];
+		if (jType.isString())
+		{
+			node.uTypes = ParseType(jType.asString());
+		}
+		else if (jType.isArray())
+		{
+			node.uTypes = 0;
+			for (auto& jItem : jType)
+			{
+				if (jItem.isString())
+					node.uTypes |= ParseType(jItem.asString());
+			}
+		}
+		if (0 == node.uTypes)
+			node.uTypes = TypeFlag_Any;
+
+		auto& jProperties = jSchema["properties"];
+		if (jProperties.isObject())
+		{
+			for (auto itrProperty = jProperties.begin(); itrProperty != jProperties.end(); ++itrProperty)
+			{
+				Property property;
+				property.strName = itrProperty.name();
+				property.nNode = CompileNode(*itrProperty);
+				node.vecProperties.push_back(std::move(property));
+			}
+		}
+		auto& jRequired = jSchema["required"];
+		if (jRequired.isArray())
+		{
+			for (auto& jName : jRequired)
+			{
+				if (jName.isString())
+					node.vecRequired.push_back(jName.asString());
+			}
+		}
+		auto& jAdditional = jSchema["additionalProperties"];
+		if (jAdditional.isBool())
+			node.bAdditionalProperties = jAdditional.asBool();
+		else if (jAdditional.isObject())
+			node.nAdditionalProperties = CompileNode(jAdditional);
+		auto& jItems = jSchema["items"];
+		if (jItems.isObject())
+			node.nItems = CompileNode(jItems);
+
+		auto& jEnum = jSchema["enum"];
+		if (jEnum.isArray())
+		{
+			node.bEnum = true;
+			for (auto& jValue : jEnum)
+			{
+				node.vecEnum.push_back(jValue);
+			}
+		}
+		if (jSchema.isMember("const"))
+		{
+			node.bEnum = true;
+			node.vecEnum.assign(1, jSchema["const"]);
+		}
+
+		auto fnNumber = [&jSchema](const char* lpcszKey, bool& bSet, double& dValue)
+		{
+			auto& jValue = jSchema[lpcszKey];
+			if (!jValue.isNumeric())
+				return;
+			bSet = true;
+			dValue = jValue.asDouble();
+		};
+		fnNumber("minimum", node.bMinimum, node.dMinimum);
+		fnNumber("maximum", node.bMaximum, node.dMaximum);
+		double dExclusive = 0;
+		bool bExclusive = false;
+		fnNumber("exclusiveMinimum", bExclusive, dExclusive);
+		if (bExclusive && (!node.bMinimum || dExclusive >= node.dMinimum))
+		{
+			node.bMinimum = node.bExclusiveMinimum = true;
+			node.dMinimum = dExclusive;
+		}
+		bExclusive = false;
+		fnNumber("exclusiveMaximum", bExclusive, dExclusive);
+		if (bExclusive && (!node.bMaximum || dExclusive <= node.dMaximum))
+		{
+			node.bMaximum = node.bExclusiveMaximum = true;
+			node.dMaximum = dExclusive;
+		}
+
+		auto fnCount = [&jSchema](const char* lpcszKey, size_t& nValue)
+		{
+			auto& jValue = jSchema[lpcszKey];
+			if (jValue.isIntegral() && jValue.asDouble() >= 0)
+				nValue = static_cast<size_t>(jValue.asLargestUInt());
+		};
+		fnCount("minLength", node.nMinLength);
+		fnCount("maxLength", node.nMaxLength);
+		fnCount("minItems", node.nMinItems);
+		fnCount("maxItems", node.nMaxItems);
+
+		m_vecNodes[nNode] = std::move(node);
+
+		return nNode;
+	}
+
+	bool CMCPSchemaValidator::Validate(const Json::Value& jValue, const char* lpcszPath, std::string& strError) const
+	{
+		if (m_vecNodes.empty())
+			return true;
+
+		std::string strPath(lpcszPath);
+		return ValidateNode(0, jValue, strPath, strError);
+	}
+
+	bool CMCPSchemaValidator::ValidateNode(size_t nNode, const Json::Value& jValue, std::string& strPath, std::string& strError) const
+	{
+		const Node& node = m_vecNodes[nNode];
+		auto fnFail = [&strPath, &strError](const std::string& strReason)
+		{
+			strError = strPath + ": " + strReason;
+			return false;
+		};
+
+		unsigned int uType = TypeOf(jValue);
+		bool bTypeMatch = 0 != (node.uTypes & uType) || (TypeFlag_Integer == uType && 0 != (node.uTypes & TypeFlag_Number));
+		if (!bTypeMatch)
+			return fnFail(std::string("expected ") + TypeName(node.uTypes));
+
+		if (node.bEnum)
+		{
+			bool bFound = false;
+			for (auto& jAllowed : node.vecEnum)
+			{
+				if (IsEqualValue(jAllowed, jValue))
+				{
+					bFound = true;
+					break;
+				}
+			}
+			if (!bFound)
+				return fnFail("value not allowed");
+		}
+
+		switch (uType)
+		{
+			case TypeFlag_Integer:
+			case TypeFlag_Number:
+			{
+				double dValue = jValue.asDouble();
+				if (node.bMinimum && (node.bExclusiveMinimum ? dValue <= node.dMinimum : dValue < node.dMinimum))
+					return fnFail("below minimum");
+				if (node.bMaximum && (node.bExclusiveMaximum ? dValue >= node.dMaximum : dValue > node.dMaximum))
+					return fnFail("above maximum");
+			} break;
+			case TypeFlag_String:
+			{
+				if (0 == node.nMinLength && NO_NODE == node.nMaxLength)
+					break;
+				const char* pBegin = nullptr;
+				const char* pEnd = nullptr;
+				jValue.getString(&pBegin, &pEnd);
+				size_t nLength = Utf8Length(pBegin, pEnd);
+				if (nLength < node.nMinLength)
+					return fnFail("shorter than minLength");
+				if (nLength > node.nMaxLength)
+					return fnFail("longer than maxLength");
+			} break;
+			case TypeFlag_Array:
+			{
+				if (jValue.size() < node.nMinItems)
+					return fnFail("fewer than minItems");
+				if (jValue.size() > node.nMaxItems)
+					return fnFail("more than maxItems");
+				if (NO_NODE == node.nItems)
+					break;
+				size_t nPathSize = strPath.size();
+				for (Json::ArrayIndex nIndex = 0; nIndex < jValue.size(); ++nIndex)
+				{
+					strPath += '[';
+					strPath += std::to_string(nIndex);
+					strPath += ']';
+					if (!ValidateNode(node.nItems, jValue[nIndex], strPath, strError))
+						return false;
+					strPath.resize(nPathSize);
+				}
+			} break;
+			case TypeFlag_Object:
+			{
+				for (auto& strName : node.vecRequired)
+				{
+					if (!jValue.isMember(strName))
+						return fnFail("missing required property " + strName);
+				}
+				size_t nPathSize = strPath.size();
+				for (auto& property : node.vecProperties)
+				{
+					auto pMember = jValue.find(property.strName.data(), property.strName.data() + property.strName.size());
+					if (!pMember)
+						continue;
+					strPath += '.';
+					strPath += property.strName;
+					if (!ValidateNode(property.nNode, *pMember, strPath, strError))
+						return false;
+					strPath.resize(nPathSize);
+				}
+				if (node.bAdditionalProperties && NO_NODE == node.nAdditionalProperties)
+					break;
+				for (auto itrMember = jValue.begin(); itrMember != jValue.end(); ++itrMember)
+				{
+					std::string strName = itrMember.name();
+					bool bDeclared = false;
+					for (auto& property : node.vecProperties)
+					{
+						if (property.strName == strName)
+						{
+							bDeclared = true;
+							break;
+						}
+					}
+					if (bDeclared)
+						continue;
+					if (!node.bAdditionalProperties)
+						return fnFail("unexpected property " + strName);
+					strPath += '.';
+					strPath += strName;
+					if (!ValidateNode(node.nAdditionalProperties, *itrMember, strPath, strError))
+						return false;
+					strPath.resize(nPathSize);
+				}
+			} break;
+			default: break;
+		}
+
+		return true;
+	}
+
+	unsigned int CMCPSchemaValidator::TypeOf(const Json::Value& jValue)
+	{
+		switch (jValue.type())
+		{
+			case Json::nullValue: return TypeFlag_Null;
+			case Json::booleanValue: return TypeFlag_Boolean;
+			case Json::intValue:
+			case Json::uintValue: return TypeFlag_Integer;
+			case Json::realValue: return jValue.isIntegral() ? TypeFlag_Integer : TypeFlag_Number;
+			case Json::stringValue: return TypeFlag_String;
+			case Json::arrayValue: return TypeFlag_Array;
+			case Json::objectValue: return TypeFlag_Object;
+			default: return TypeFlag_Any;
+		}
+	}
+
+	unsigned int CMCPSchemaValidator::ParseType(const std::string& strType)
+	{
+		if (strType == "null") return TypeFlag_Null;
+		if (strType == "boolean") return TypeFlag_Boolean;
+		if (strType == "integer") return TypeFlag_Integer;
+		if (strType == "number") return TypeFlag_Number;
+		if (strType == "string") return TypeFlag_String;
+		if (strType == "array") return TypeFlag_Array;
+		if (strType == "object") return TypeFlag_Object;
+
+		return 0;
+	}
+
+	const char* CMCPSchemaValidator::TypeName(unsigned int uTypes)
+	{
+		switch (uTypes)
+		{
+			case TypeFlag_Null: return "null";
+			case TypeFlag_Boolean: return "boolean";
+			case TypeFlag_Integer: return "integer";
+			case TypeFlag_Number: return "number";
+			case TypeFlag_String: return "string";
+			case TypeFlag_Array: return "array";
+			case TypeFlag_Object: return "object";
+			default: return "one of the declared types";
+		}
+	}
+
+	CMCPLazySchemaValidator::CMCPLazySchemaValidator(Json::Value jSchema)
+		: m_jSchema(std::move(jSchema))
+	{
+
+	}
+
+	bool CMCPLazySchemaValidator::Validate(const Json::Value& jValue, const char* lpcszPath, std::string& strError) const
+	{
+		std::call_once(m_onceCompile, [this]()
+			{
+				m_validator.Compile(m_jSchema);
+				m_jSchema = Json::Value();
+			});
+
+		return m_validator.Validate(jValue, lpcszPath, strError);
+	}
+}
@@ -0,0 +1,94 @@
+#pragma once
+// To ensure good cross-platform compatibility, the MCP namespace code uses standard C++ only.
+// Avoid using platform-specific system APIs unless absolutely necessary.
+
+#include <mutex>
+#include <string>
+#include <vector>
+#include <json/json.h>
+
+namespace MCP
+{
+	// A JSON Schema compiled once into a flat list of checks, used to reject tools/call arguments
+	// before a task is taken for them. Covers what tool input schemas use in practice: type,
+	// properties, required, additionalProperties, items, enum, const, minimum/maximum (and their
+	// exclusive forms), minLength/maxLength and minItems/maxItems. Other keywords are ignored, so a
+	// schema using them accepts more than it declares, never less.
+	class CMCPSchemaValidator
+	{
+	public:
+		// An empty or invalid schema accepts everything.
+		int Compile(const Json::Value& jSchema);
+		// strError names the first mismatch, e.g. "arguments.text: expected string".
+		bool Validate(const Json::Value& jValue, const char* lpcszPath, std::string& strError) const;
+
+	private:
+		enum TypeFlag : unsigned int
+		{
+			TypeFlag_Null = 1 << 0,
+			TypeFlag_Boolean = 1 << 1,
+			TypeFlag_Integer = 1 << 2,
+			TypeFlag_Number = 1 << 3,
+			TypeFlag_String = 1 << 4,
+			TypeFlag_Array = 1 << 5,
+			TypeFlag_Object = 1 << 6,
+			TypeFlag_Any = (1 << 7) - 1,
+		};
+
+		static constexpr size_t NO_NODE = static_cast<size_t>(-1);
+
+		struct Property
+		{
+			std::string strName;
+			size_t nNode{ NO_NODE };
+		};
+
+		struct Node
+		{
+			unsigned int uTypes{ TypeFlag_Any };
+			std::vector<Property> vecProperties;
+			std::vector<std::string> vecRequired;
+			bool bAdditionalProperties{ true };
+			size_t nAdditionalProperties{ NO_NODE };
+			size_t nItems{ NO_NODE };
+			std::vector<Json::Value> vecEnum;
+			bool bEnum{ false };
+			bool bMinimum{ false };
+			bool bExclusiveMinimum{ false };
+			double dMinimum{ 0 };
+			bool bMaximum{ false };
+			bool bExclusiveMaximum{ false };
+			double dMaximum{ 0 };
+			size_t nMinLength{ 0 };
+			size_t nMaxLength{ NO_NODE };
+			size_t nMinItems{ 0 };
+			size_t nMaxItems{ NO_NODE };
+		};
+
+		size_t CompileNode(const Json::Value& jSchema);
+		bool ValidateNode(size_t nNode, const Json::Value& jValue, std::string& strPath, std::string& strError) const;
+		static unsigned int TypeOf(const Json::Value& jValue);
+		static unsigned int ParseType(const std::string& strType);
+		static const char* TypeName(unsigned int uTypes);
+
+		// The root is node 0; children are referenced by index.
+		std::vector<Node> m_vecNodes;
+	};
+	// The input schema of a tool, compiled on the first call of the tool rather than when the tools are
+	// registered, so that a server with many tools answers initialize and tools/list right away.
+	class CMCPLazySchemaValidator
+	{
+	public:
+		explicit CMCPLazySchemaValidator(Json::Value jSchema);
+		CMCPLazySchemaValidator(const CMCPLazySchemaValidator&) = delete;
+		CMCPLazySchemaValidator& operator=(const CMCPLazySchemaValidator&) = delete;
+
+		bool Validate(const Json::Value& jValue, const char* lpcszPath, std::string& strError) const;
+
+	private:
+		mutable std::once_flag m_onceCompile;
+		// Released once compiled.
+		mutable Json::Value m_jSchema;
+		mutable CMCPSchemaValidator m_validator;
+	};
+}
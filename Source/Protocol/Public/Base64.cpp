@@ -0,0 +1,124 @@
+#include "Base64.h"
+#include <cstring>
+
+namespace MCP
+{
+	namespace Base64
+	{
+		static const char s_szAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+		// The two characters of every 12 bit value, so three input bytes take two lookups.
+		struct PairTable
+		{
+			PairTable()
+			{
+				for (int i = 0; i < 4096; ++i)
+				{
+					szPairs[i * 2] = s_szAlphabet[i >> 6];
+					szPairs[i * 2 + 1] = s_szAlphabet[i & 0x3F];
+				}
+			}
+
+			char szPairs[4096 * 2];
+		};
+
+		static const PairTable& GetPairTable()
+		{
+			static const PairTable s_table;
+			return s_table;
+		}
+
+		static inline void EncodeTriple(const char* pPairs, const unsigned char* pIn, char* pOut)
+		{
+			unsigned int nBits = (static_cast<unsigned int>(pIn[0]) << 16)
+				| (static_cast<unsigned int>(pIn[1]) << 8)
+				| static_cast<unsigned int>(pIn[2]);
+			std::memcpy(pOut, pPairs + (nBits >> 12) * 2, 2);
+			std::memcpy(pOut + 2, pPairs + (nBits & 0xFFF) * 2, 2);
+		}
+
+		void Encode(const unsigned char* pData, size_t nLength, char* pOut)
+		{
+			const char* pPairs = GetPairTable().szPairs;
+
+			// Four independent triples per iteration keep the loads and stores in flight.
+			while (nLength >= 12)
+			{
+				EncodeTriple(pPairs, pData, pOut);
+				EncodeTriple(pPairs, pData + 3, pOut + 4);
+				EncodeTriple(pPairs, pData + 6, pOut + 8);
+				EncodeTriple(pPairs, pData + 9, pOut + 12);
+				pData += 12;
+				pOut += 16;
+				nLength -= 12;
+			}
+			while (nLength >= 3)
+			{
+				EncodeTriple(pPairs, pData, pOut);
+				pData += 3;
+				pOut += 4;
+				nLength -= 3;
+			}
+
+			if (nLength > 0)
+			{
+				unsigned int nBits = static_cast<unsigned int>(pData[0]) << 16;
+				if (nLength > 1)
+					nBits |= static_cast<unsigned int>(pData[1]) << 8;
+				pOut[0] = s_szAlphabet[nBits >> 18];
+				pOut[1] = s_szAlphabet[(nBits >> 12) & 0x3F];
+				pOut[2] = nLength > 1 ? s_szAlphabet[(nBits >> 6) & 0x3F] : '=';
+				pOut[3] = '=';
+			}
+		}
+
+		void Append(const unsigned char* pData, size_t nLength, std::string& strOut)
+		{
+			size_t nOffset = strOut.size();
+			strOut.resize(nOffset + EncodedLength(nLength));
+			if (nLength > 0)
+				Encode(pData, nLength, &strOut[nOffset]);
+		}
+
+		bool DecodeUrl(const char* pData, size_t nLength, std::string& strOut)
+		{
+			while (nLength > 0 && '=' == pData[nLength - 1])
+				--nLength;
+			// A single character left over cannot encode a byte.
+			if (1 == nLength % 4)
+				return false;
+
+			strOut.clear();
+			strOut.reserve(nLength * 3 / 4);
+			unsigned int nBits = 0;
+			int iBitCount = 0;
+			for (size_t i = 0; i < nLength; ++i)
+			{
+				char ch = pData[i];
+				unsigned int nValue = 0;
+				if (ch >= 'A' && ch <= 'Z')
+					nValue = ch - 'A';
+				else if (ch >= 'a' && ch <= 'z')
+					nValue = ch - 'a' + 26;
+				else if (ch >= '0' && ch <= '9')
+					nValue = ch - '0' + 52;
+				else if ('-' == ch)
+					nValue = 62;
+				else if ('_' == ch)
+					nValue = 63;
+				else
+					return false;
+
+				nBits = (nBits << 6) | nValue;
+				iBitCount += 6;
+				if (iBitCount >= 8)
+				{
+					iBitCount -= 8;
+					strOut.push_back(static_cast<char>((nBits >> iBitCount) & 0xFF));
+				}
+			}
+
+			return true;
+		}
+	}
+}
@@ -0,0 +1,26 @@
+#pragma once
+// To ensure good cross-platform compatibility, the MCP namespace code uses standard C++ only.
+// Avoid using platform-specific system APIs unless absolutely necessary.
+
+#include <cstddef>
+#include <string>
+
+namespace MCP
+{
+	// Standard base64 (RFC 4648, padded), encoded straight into a caller provided buffer.
+	namespace Base64
+	{
+		inline size_t EncodedLength(size_t nLength)
+		{
+			return (nLength + 2) / 3 * 4;
+		}
+
+		// Writes exactly EncodedLength(nLength) characters to pOut.
+		void Encode(const unsigned char* pData, size_t nLength, char* pOut);
+		// Appends the encoding to strOut.
+		void Append(const unsigned char* pData, size_t nLength, std::string& strOut);
+		// Decodes the URL safe alphabet ("-_", RFC 4648 section 5) as used by JWTs, padded or not.
+		// False, with strOut in an unspecified state, on any other character.
+		bool DecodeUrl(const char* pData, size_t nLength, std::string& strOut);
+	}
+}
@@ -1,27 +1,61 @@
 #include "Config.h"
+#include "PublicDef.h"
 #include <fstream>
 #include <sstream>
 #include <algorithm>
 #include <cctype>
+#include <chrono>
 
 namespace MCP
 {
-    int Config::LoadFromFile(const std::string& configPath)
+    static std::atomic_bool s_bReloadRequested{ false };
+
+    // The snapshot the thread saw last, see Config::Current().
+    struct ConfigSnapshotCache
     {
-        std::ifstream file(configPath);
-        if (!file.is_open())
+        unsigned long long ullVersion{ 0 };
+        std::shared_ptr<const ConfigSnapshot> spSnapshot;
+    };
+    static thread_local ConfigSnapshotCache t_snapshotCache;
+
+    static int ParseInt(const std::string* pValue, int defaultValue)
+    {
+        if (!pValue || pValue->empty())
+            return defaultValue;
+
+        try
         {
-            return ERRNO_INTERNAL_ERROR;
+            return std::stoi(*pValue);
         }
+        catch (...)
+        {
+            return defaultValue;
+        }
+    }
 
+    static bool ParseBool(const std::string* pValue, bool defaultValue)
+    {
+        if (!pValue || pValue->empty())
+            return defaultValue;
+
+        // Convert to lowercase for comparison
+        std::string value = *pValue;
+        std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+
+        return (value == "1" || value == "true" || value == "yes" || value == "on");
+    }
+
+    static void ParseIni(const std::string& content, ConfigSnapshot& snapshot)
+    {
+        std::istringstream stream(content);
         std::string line;
         std::string currentSection;
-        
-        while (std::getline(file, line))
+
+        while (std::getline(stream, line))
         {
             // Remove whitespace
-            line.erase(0, line.find_first_not_of(" \t"));
-            line.erase(line.find_last_not_of(" \t") + 1);
+            line.erase(0, line.find_first_not_of(" \t\r"));
+            line.erase(line.find_last_not_of(" \t\r") + 1);
 
             // Skip empty lines and comments
             if (line.empty() || line[0] == '#' || line[0] == ';')
@@ -47,52 +81,237 @@ namespace MCP
                 value.erase(0, value.find_first_not_of(" \t"));
                 value.erase(value.find_last_not_of(" \t") + 1);
 
-                m_config[currentSection][key] = value;
+                snapshot.hashValues[currentSection][key] = value;
             }
         }
-
-        return ERRNO_OK;
     }
 
-    std::string Config::GetString(const std::string& section, const std::string& key, const std::string& defaultValue) const
+    // Parses the values read per request once, instead of on every read.
+    static void ParseTyped(ConfigSnapshot& snapshot)
     {
-        auto sectionIt = m_config.find(section);
-        if (sectionIt != m_config.end())
+        snapshot.bAuthEnabled = ParseBool(snapshot.Find("auth", "enable_auth"), false);
+        const std::string* pApiKey = snapshot.Find("auth", "api_key");
+        snapshot.strApiKey = pApiKey ? *pApiKey : "";
+        snapshot.iCallTimeoutMs = ParseInt(snapshot.Find("task", "call_timeout_ms"), 0);
+        snapshot.iProgressMaxRate = ParseInt(snapshot.Find("task", "progress_max_rate"), 20);
+        snapshot.bBatchStreamResponses = ParseBool(snapshot.Find("session", "batch_stream_responses"), false);
+        snapshot.iOutputHighWatermark = ParseInt(snapshot.Find("session", "output_high_watermark_bytes"), 4 * 1024 * 1024);
+        snapshot.bMetricsEnabled = ParseBool(snapshot.Find("metrics", "enabled"), true);
+        snapshot.iClientRateLimit = ParseInt(snapshot.Find("rate_limits", "client_calls_per_s"), 0);
+        snapshot.iClientRateBurst = ParseInt(snapshot.Find("rate_limits", "client_burst"), 0);
+        snapshot.iToolRateLimit = ParseInt(snapshot.Find("rate_limits", "tool_calls_per_s"), 0);
+
+        auto fnParseTools = [&snapshot](const char* lpcszSection, std::unordered_map<std::string, int>& hashTools)
         {
-            auto keyIt = sectionIt->second.find(key);
-            if (keyIt != sectionIt->second.end())
+            auto itrSection = snapshot.hashValues.find(lpcszSection);
+            if (itrSection == snapshot.hashValues.end())
+                return;
+            for (auto& itrTool : itrSection->second)
             {
-                return keyIt->second;
+                // Unparsable entries fall back to the default of the caller, as if they were not set.
+                try
+                {
+                    hashTools[itrTool.first] = std::stoi(itrTool.second);
+                }
+                catch (...)
+                {
+                }
             }
+        };
+        fnParseTools("tool_timeouts", snapshot.hashToolTimeoutsMs);
+        fnParseTools("tool_cache", snapshot.hashToolCacheTtlMs);
+        fnParseTools("tool_limits", snapshot.hashToolMaxConcurrency);
+        fnParseTools("tool_rate_limits", snapshot.hashToolRateLimits);
+    }
+
+    static bool ReadConfigFile(const std::string& configPath, std::string& content)
+    {
+        std::ifstream file(configPath, std::ios::binary);
+        if (!file.is_open())
+            return false;
+
+        std::ostringstream stream;
+        stream << file.rdbuf();
+        content = stream.str();
+
+        return true;
+    }
+
+    const std::string* ConfigSnapshot::Find(const std::string& section, const std::string& key) const
+    {
+        auto sectionIt = hashValues.find(section);
+        if (sectionIt == hashValues.end())
+            return nullptr;
+        auto keyIt = sectionIt->second.find(key);
+        if (keyIt == sectionIt->second.end())
+            return nullptr;
+
+        return &keyIt->second;
+    }
+
+    Config::Config()
+    {
+        auto spSnapshot = std::make_shared<ConfigSnapshot>();
+        ParseTyped(*spSnapshot);
+        Publish(spSnapshot);
+    }
+
+    Config::~Config()
+    {
+        StopWatching();
+    }
+
+    int Config::LoadFromFile(const std::string& configPath)
+    {
+        std::string content;
+        if (!ReadConfigFile(configPath, content))
+        {
+            return ERRNO_INTERNAL_ERROR;
+        }
+
+        auto spSnapshot = std::make_shared<ConfigSnapshot>();
+        ParseIni(content, *spSnapshot);
+        ParseTyped(*spSnapshot);
+
+        {
+            std::lock_guard<std::mutex> _lock(m_mtxReload);
+            m_strPath = configPath;
+            m_strContent = content;
+            Publish(spSnapshot);
+        }
+        // Held while the handlers run, so that RemoveReloadHandler() waits for them.
+        std::lock_guard<std::mutex> _lock(m_mtxHandlers);
+        for (auto& itrHandler : m_mapHandlers)
+        {
+            itrHandler.second(*spSnapshot);
         }
-        return defaultValue;
+
+        return ERRNO_OK;
     }
 
-    int Config::GetInt(const std::string& section, const std::string& key, int defaultValue) const
+    int Config::Reload()
     {
-        std::string value = GetString(section, key);
-        if (value.empty())
-            return defaultValue;
+        std::string configPath;
+        {
+            std::lock_guard<std::mutex> _lock(m_mtxReload);
+            configPath = m_strPath;
+        }
+        if (configPath.empty())
+            return ERRNO_INTERNAL_ERROR;
 
-        try
+        return LoadFromFile(configPath);
+    }
+
+    void Config::RequestReload()
+    {
+        s_bReloadRequested.store(true);
+    }
+
+    int Config::StartWatching()
+    {
+        std::lock_guard<std::mutex> _lock(m_mtxWatcher);
+        if (m_bWatching)
+            return ERRNO_OK;
+        m_bWatching = true;
+        m_thrWatcher = std::thread(&Config::WatcherProc, this);
+
+        return ERRNO_OK;
+    }
+
+    void Config::StopWatching()
+    {
         {
-            return std::stoi(value);
+            std::lock_guard<std::mutex> _lock(m_mtxWatcher);
+            if (!m_bWatching)
+                return;
+            m_bWatching = false;
         }
-        catch (...)
+        m_cvWatcher.notify_all();
+        if (m_thrWatcher.joinable())
+            m_thrWatcher.join();
+    }
+
+    int Config::AddReloadHandler(std::function<void(const ConfigSnapshot&)> fnHandler)
+    {
+        std::lock_guard<std::mutex> _lock(m_mtxHandlers);
+        int iHandlerId = m_iNextHandlerId++;
+        m_mapHandlers[iHandlerId] = std::move(fnHandler);
+
+        return iHandlerId;
+    }
+
+    void Config::RemoveReloadHandler(int iHandlerId)
+    {
+        std::lock_guard<std::mutex> _lock(m_mtxHandlers);
+        m_mapHandlers.erase(iHandlerId);
+    }
+
+    const ConfigSnapshot& Config::Current() const
+    {
+        auto ullVersion = m_ullVersion.load(std::memory_order_acquire);
+        if (t_snapshotCache.ullVersion != ullVersion)
         {
-            return defaultValue;
+            t_snapshotCache.spSnapshot = std::atomic_load(&m_spSnapshot);
+            t_snapshotCache.ullVersion = ullVersion;
         }
+
+        return *t_snapshotCache.spSnapshot;
     }
 
-    bool Config::GetBool(const std::string& section, const std::string& key, bool defaultValue) const
+    void Config::Publish(const std::shared_ptr<const ConfigSnapshot>& spSnapshot)
     {
-        std::string value = GetString(section, key);
-        if (value.empty())
-            return defaultValue;
+        std::atomic_store(&m_spSnapshot, spSnapshot);
+        m_ullVersion.fetch_add(1, std::memory_order_acq_rel);
+    }
 
-        // Convert to lowercase for comparison
-        std::transform(value.begin(), value.end(), value.begin(), ::tolower);
-        
-        return (value == "1" || value == "true" || value == "yes" || value == "on");
+    void Config::WatcherProc()
+    {
+        // A signal handler can only set the flag, so it is polled.
+        auto tpLastCheck = std::chrono::steady_clock::now();
+        std::unique_lock<std::mutex> _lock(m_mtxWatcher);
+        while (m_bWatching)
+        {
+            m_cvWatcher.wait_for(_lock, std::chrono::milliseconds(100));
+            if (!m_bWatching)
+                break;
+            _lock.unlock();
+
+            bool bReload = s_bReloadRequested.exchange(false);
+            int iInterval = GetWatchInterval();
+            auto tpNow = std::chrono::steady_clock::now();
+            if (!bReload && iInterval > 0 && tpNow - tpLastCheck >= std::chrono::milliseconds(iInterval))
+            {
+                tpLastCheck = tpNow;
+                std::string configPath;
+                std::string loadedContent;
+                {
+                    std::lock_guard<std::mutex> _reloadLock(m_mtxReload);
+                    configPath = m_strPath;
+                    loadedContent = m_strContent;
+                }
+                std::string content;
+                bReload = !configPath.empty() && ReadConfigFile(configPath, content) && content != loadedContent;
+            }
+            if (bReload)
+                Reload();
+
+            _lock.lock();
+        }
+    }
+
+    std::string Config::GetString(const std::string& section, const std::string& key, const std::string& defaultValue) const
+    {
+        const std::string* pValue = Current().Find(section, key);
+        return pValue ? *pValue : defaultValue;
+    }
+
+    int Config::GetInt(const std::string& section, const std::string& key, int defaultValue) const
+    {
+        return ParseInt(Current().Find(section, key), defaultValue);
+    }
+
+    bool Config::GetBool(const std::string& section, const std::string& key, bool defaultValue) const
+    {
+        return ParseBool(Current().Find(section, key), defaultValue);
     }
 }
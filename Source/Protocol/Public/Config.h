@@ -2,11 +2,45 @@
 // Simple configuration loader for TinyMCP
 // Uses INI file format for easy configuration
 
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
 
 namespace MCP
 {
+    // One version of the configuration file, never modified once published. The values read on
+    // every request are parsed once into typed fields; everything else stays in hashValues.
+    struct ConfigSnapshot
+    {
+        std::unordered_map<std::string, std::unordered_map<std::string, std::string>> hashValues;
+
+        bool bAuthEnabled{ false };
+        std::string strApiKey;
+        int iCallTimeoutMs{ 0 };
+        // [tool_timeouts], [tool_cache] and [tool_limits] by tool name.
+        std::unordered_map<std::string, int> hashToolTimeoutsMs;
+        std::unordered_map<std::string, int> hashToolCacheTtlMs;
+        std::unordered_map<std::string, int> hashToolMaxConcurrency;
+        // [rate_limits] and [tool_rate_limits], in calls per second.
+        int iClientRateLimit{ 0 };
+        int iClientRateBurst{ 0 };
+        int iToolRateLimit{ 0 };
+        std::unordered_map<std::string, int> hashToolRateLimits;
+        int iProgressMaxRate{ 20 };
+        bool bBatchStreamResponses{ false };
+        int iOutputHighWatermark{ 4 * 1024 * 1024 };
+        bool bMetricsEnabled{ true };
+
+        // nullptr when the key is not set.
+        const std::string* Find(const std::string& section, const std::string& key) const;
+    };
+
     class Config
     {
     public:
@@ -18,6 +52,24 @@ namespace MCP
 
         // Load configuration from file
         int LoadFromFile(const std::string& configPath);
+        // Loads the file of LoadFromFile() again and runs the reload handlers.
+        int Reload();
+        // Async signal safe (e.g. SIGHUP): the watcher thread reloads shortly after.
+        static void RequestReload();
+        // Starts the thread reloading on RequestReload(), and whenever the file changes when
+        // [config] watch_interval_ms is set. Settings applied at startup (ports, threads, ...) still
+        // need a restart; those read per request take effect right away.
+        int StartWatching();
+        void StopWatching();
+        // Called after every reload, on the thread that reloaded; returns an id for RemoveReloadHandler(),
+        // which waits for a call in progress. Handlers must not add or remove handlers.
+        int AddReloadHandler(std::function<void(const ConfigSnapshot&)> fnHandler);
+        void RemoveReloadHandler(int iHandlerId);
+
+        // The current snapshot, read without locks: the calling thread keeps a reference to the
+        // version it saw last and only touches the shared pointer after a reload. The result stays
+        // valid until the same thread calls Current() (or a getter) again.
+        const ConfigSnapshot& Current() const;
 
         // Get configuration values
         std::string GetString(const std::string& section, const std::string& key, const std::string& defaultValue = "") const;
@@ -27,22 +79,186 @@ namespace MCP
         // Server configuration
         int GetPort() const { return GetInt("server", "port", 6666); }
         std::string GetHost() const { return GetString("server", "host", "localhost"); }
+        // "stdio", "http", "unix" or "shm"
+        std::string GetServerTransport() const { return GetString("server", "transport", "stdio"); }
+        // Snapshot of the tool catalog the server lists its tools from at startup, written on the first run; empty = none
+        std::string GetToolsSnapshotFile() const { return GetString("server", "tools_snapshot", ""); }
+
+        // HTTP transport configuration
+        std::string GetHttpEndpoint() const { return GetString("http", "endpoint", "/mcp"); }
+        int GetHttpKeepAliveTimeout() const { return GetInt("http", "keepalive_timeout_s", 60); }
+        int GetHttpMaxRequestBytes() const { return GetInt("http", "max_request_bytes", 16 * 1024 * 1024); }
+        // Pending output of one connection above which its input is no longer read.
+        int GetHttpOutputHighWatermark() const { return GetInt("http", "output_high_watermark", 256 * 1024); }
+        // Pending output of one connection above which the connection is dropped.
+        int GetHttpMaxOutputBytes() const { return GetInt("http", "max_output_bytes", 16 * 1024 * 1024); }
+        // Received messages not yet consumed by the session above which no connection is read.
+        int GetHttpMaxPendingInputBytes() const { return GetInt("http", "max_pending_input_bytes", 64 * 1024 * 1024); }
+        // Event loop threads serving the connections; 0 selects the hardware concurrency.
+        int GetHttpEventLoops() const { return GetInt("http", "event_loops", 0); }
+        // Run the event loops on io_uring when built with TINYMCP_WITH_IO_URING and the kernel supports it (epoll otherwise).
+        bool GetHttpIoUring() const { return GetBool("http", "io_uring", true); }
+        // A loop holding more sessions than this percentage of the average hands idle ones to the least loaded loop; 0 disables.
+        int GetHttpRebalanceThreshold() const { return GetInt("http", "rebalance_threshold_percent", 150); }
+
+        // WebSocket configuration (upgrades on the HTTP endpoint)
+        bool GetWebSocketEnabled() const { return GetBool("websocket", "enabled", true); }
+        // Negotiate permessage-deflate with clients offering it (builds with TINYMCP_WITH_ZLIB).
+        bool GetWebSocketDeflate() const { return GetBool("websocket", "deflate", true); }
+        // Messages shorter than this are sent uncompressed.
+        int GetWebSocketDeflateMinBytes() const { return GetInt("websocket", "deflate_min_bytes", 1024); }
+        // zlib compression level, 1 (fastest) to 9 (smallest).
+        int GetWebSocketDeflateLevel() const { return GetInt("websocket", "deflate_level", 6); }
+        // Idle seconds after which the server pings the client, keeping proxies from dropping the connection; 0 never pings.
+        int GetWebSocketPingInterval() const { return GetInt("websocket", "ping_interval_s", 30); }
 
         // Security configuration
         bool IsHttpsEnabled() const { return GetBool("security", "enable_https", false); }
         std::string GetCertFile() const { return GetString("security", "cert_file", "certs/server.crt"); }
         std::string GetKeyFile() const { return GetString("security", "key_file", "certs/server.key"); }
 
+        // Task execution configuration
+        // Number of threads executing tools/call requests; 0 selects the hardware concurrency.
+        int GetTaskWorkerThreads() const { return GetInt("task", "worker_threads", 0); }
+        // Workers that only run control and interactive lanes, never bulk tools.
+        int GetTaskReservedWorkers() const { return GetInt("task", "reserved_workers", 1); }
+        // Maximum concurrent executions of one tool; 0 is unlimited.
+        int GetToolMaxConcurrency(const std::string& toolName, int defaultValue = 0) const { return FindTool(Current().hashToolMaxConcurrency, toolName, defaultValue); }
+        // Tool calls queued or waiting for their [tool_limits] beyond which new ones are refused; 0 is unlimited.
+        int GetTaskMaxPendingCalls() const { return GetInt("task", "max_pending_calls", 0); }
+        // tools/call per second of one client (its principal when authenticated, otherwise its
+        // session) and of one tool over all clients; 0 is unlimited. The burst is the number of
+        // calls admitted at once, 0 = one second worth.
+        int GetClientRateLimit() const { return Current().iClientRateLimit; }
+        int GetClientRateBurst() const { return Current().iClientRateBurst; }
+        int GetToolRateLimit(const std::string& toolName) const { auto& snapshot = Current(); return FindTool(snapshot.hashToolRateLimits, toolName, snapshot.iToolRateLimit); }
+        // Idle task instances kept per tool for the next calls; 0 clones the registered task for every call.
+        int GetToolPoolSize() const { return GetInt("task", "tool_pool_size", 64); }
+        // Progress notifications per second and progressToken; faster updates are coalesced, 0 sends every update.
+        int GetProgressMaxRate() const { return Current().iProgressMaxRate; }
+        // Deadline of one tools/call in milliseconds, [tool_timeouts] overrides [task] call_timeout_ms; 0 disables it.
+        int GetToolTimeoutMs(const std::string& toolName) const { auto& snapshot = Current(); return FindTool(snapshot.hashToolTimeoutsMs, toolName, snapshot.iCallTimeoutMs); }
+        // Lifetime of the cached results of a tool, defaulting to the TTL it was registered with.
+        int GetToolCacheTtlMs(const std::string& toolName, int defaultValue = 0) const { return FindTool(Current().hashToolCacheTtlMs, toolName, defaultValue); }
+        // Bytes of tool results cached for all sessions (0 = no cache).
+        int GetToolCacheBytes() const { return GetInt("task", "tool_cache_bytes", 16 * 1024 * 1024); }
+
+        // Transport configuration
+        // How long the stdio writer may hold a partial batch, in microseconds; 0 flushes as soon as the queue drains.
+        int GetStdoutFlushLatencyUs() const { return GetInt("transport", "stdout_flush_latency_us", 0); }
+        // Pending bytes that force the stdio writer to flush.
+        int GetStdoutFlushBytes() const { return GetInt("transport", "stdout_flush_bytes", 64 * 1024); }
+        // Bytes of a streamed message (e.g. a large tool result) the stdio writer may have queued before the producer waits.
+        int GetStdoutStreamPendingBytes() const { return GetInt("transport", "stream_pending_bytes", 1024 * 1024); }
+        // Offer the FlatBuffers encoding to clients asking for it in initialize.
+        bool GetFlatBuffersEncoding() const { return GetBool("transport", "flatbuffers_encoding", true); }
+        // Largest length prefixed frame accepted from the client.
+        int GetTransportMaxFrameBytes() const { return GetInt("transport", "max_frame_bytes", 64 * 1024 * 1024); }
+
+        // Local transport configuration ("unix" and "shm")
+        std::string GetLocalSocketPath() const { return GetString("local", "socket_path", "/tmp/tinymcp.sock"); }
+        // Frames of this size or more are passed over the Unix socket as a sealed memfd (Linux); 0 = always inline.
+        int GetLocalFdPassingBytes() const { return GetInt("local", "fd_passing_bytes", 256 * 1024); }
+        std::string GetLocalShmName() const { return GetString("local", "shm_name", "/tinymcp"); }
+        // Bytes of each ring of the shared memory transport, rounded up to a power of two.
+        int GetLocalShmRingBytes() const { return GetInt("local", "shm_ring_bytes", 4 * 1024 * 1024); }
+        // How long a side of the shared memory transport polls before it sleeps, in microseconds (not on a single core).
+        int GetLocalSpinUs() const { return GetInt("local", "spin_us", 50); }
+
+        // Session configuration
+        // Number of recent messages kept as lightweight records for debugging; 0 disables the history.
+        int GetSessionHistorySize() const { return GetInt("session", "history_size", 256); }
+        // First chunk of the per-thread arena holding the parse tree of an incoming message; 0 parses onto the heap.
+        int GetMessageArenaBytes() const { return GetInt("session", "message_arena_bytes", 64 * 1024); }
+        // Answers the requests of a JSON-RPC batch one by one as they complete instead of with one array, for clients accepting it.
+        bool GetBatchStreamResponses() const { return Current().bBatchStreamResponses; }
+        // Output a client has not taken yet beyond which progress and log notifications are held back
+        // or dropped (responses never are) and tools are told that writing would block; 0 = never.
+        int GetSessionOutputHighWatermark() const { return Current().iOutputHighWatermark; }
+
+        // Resource configuration
+        // Files kept mapped by CMCPFileResourceProvider after they were read.
+        int GetResourceMappingCacheSize() const { return GetInt("resources", "mapping_cache_size", 64); }
+        // Bytes of serialized resources/read results shared by the sessions (0 = no cache).
+        int GetResourceReadCacheBytes() const { return GetInt("resources", "read_cache_bytes", 16 * 1024 * 1024); }
+        // How often the subscribed resources are checked for changes.
+        int GetResourceWatchInterval() const { return GetInt("resources", "watch_interval_ms", 1000); }
+
+        // Pagination configuration
+        // Items per page of a paginated list ("tools", "resources" or "prompts"); 0 returns the whole list.
+        int GetListPageSize(const std::string& listName) const { return GetInt("pagination", listName + "_page_size", GetInt("pagination", "page_size", 50)); }
+
+        // Metrics configuration
+        // Per-method and per-tool counters and latency histograms, see CMCPMetrics.
+        bool GetMetricsEnabled() const { return Current().bMetricsEnabled; }
+        // Path answering GET with the metrics in the Prometheus text format on the HTTP transport; empty = not served.
+        std::string GetMetricsPrometheusPath() const { return GetString("metrics", "prometheus_path", ""); }
+
+        // Traffic recording: frames of every session appended to this file for replay; empty = not recorded
+        std::string GetRecordingFile() const { return GetString("recording", "file", ""); }
+
+        // Trace configuration (builds with TINYMCP_WITH_TRACING), see CMCPTrace.
+        bool GetTraceEnabled() const { return GetBool("trace", "enabled", false); }
+        // Spans kept per thread; older ones are overwritten.
+        int GetTraceBufferSpans() const { return GetInt("trace", "buffer_spans", 8192); }
+        // File the spans are written to on CMCPTrace::RequestDump(); empty = no dump on request.
+        std::string GetTraceDumpFile() const { return GetString("trace", "dump_file", "trace.json"); }
+
+        // Logging configuration, see CMCPLogger. Levels are those of logging/setLevel, or "off".
+        std::string GetLoggingStderrLevel() const { return GetString("logging", "stderr_level", "off"); }
+        // File receiving JSON lines; empty = no file.
+        std::string GetLoggingFile() const { return GetString("logging", "file", ""); }
+        std::string GetLoggingFileLevel() const { return GetString("logging", "file_level", "info"); }
+        // Bytes of pending records buffered per thread; records beyond are dropped (and counted).
+        int GetLoggingBufferBytes() const { return GetInt("logging", "buffer_bytes", 64 * 1024); }
+
         // Auth configuration
-        bool IsAuthEnabled() const { return GetBool("auth", "enable_auth", false); }
-        std::string GetApiKey() const { return GetString("auth", "api_key", ""); }
+        bool IsAuthEnabled() const { return Current().bAuthEnabled; }
+        std::string GetApiKey() const { return Current().strApiKey; }
+        // HS256 key of the JWTs accepted as bearer tokens; empty = JWTs are not accepted.
+        std::string GetJwtSecret() const { return GetString("auth", "jwt_secret", ""); }
+        // Required iss / aud claims; empty = not checked.
+        std::string GetJwtIssuer() const { return GetString("auth", "jwt_issuer", ""); }
+        std::string GetJwtAudience() const { return GetString("auth", "jwt_audience", ""); }
+        // Tolerance of the exp / nbf checks, in seconds.
+        int GetJwtClockSkew() const { return GetInt("auth", "clock_skew_s", 30); }
+        // Verified tokens remembered, and for how long at most (a JWT no longer than its exp).
+        int GetTokenCacheSize() const { return GetInt("auth", "token_cache_size", 4096); }
+        int GetTokenCacheTtl() const { return GetInt("auth", "token_cache_ttl_s", 300); }
+
+        // Reload configuration
+        // How often the watcher compares the file with what was loaded, in milliseconds; 0 = only on RequestReload().
+        int GetWatchInterval() const { return GetInt("config", "watch_interval_ms", 0); }
 
     private:
-        Config() = default;
-        ~Config() = default;
+        Config();
+        ~Config();
         Config(const Config&) = delete;
         Config& operator=(const Config&) = delete;
 
-        std::unordered_map<std::string, std::unordered_map<std::string, std::string>> m_config;
+        static int FindTool(const std::unordered_map<std::string, int>& hashTools, const std::string& toolName, int defaultValue)
+        {
+            auto itrTool = hashTools.find(toolName);
+            return itrTool != hashTools.end() ? itrTool->second : defaultValue;
+        }
+        void Publish(const std::shared_ptr<const ConfigSnapshot>& spSnapshot);
+        void WatcherProc();
+
+        // Replaced as a whole on reload, see Current().
+        std::shared_ptr<const ConfigSnapshot> m_spSnapshot;
+        std::atomic<unsigned long long> m_ullVersion{ 0 };
+
+        std::mutex m_mtxReload;
+        std::string m_strPath;
+        std::string m_strContent;
+
+        std::mutex m_mtxHandlers;
+        int m_iNextHandlerId{ 1 };
+        std::map<int, std::function<void(const ConfigSnapshot&)>> m_mapHandlers;
+
+        std::mutex m_mtxWatcher;
+        std::condition_variable m_cvWatcher;
+        bool m_bWatching{ false };
+        std::thread m_thrWatcher;
     };
 }
@@ -0,0 +1,577 @@
+#include "Logger.h"
+#include "Config.h"
+#include "PublicDef.h"
+#include "Trace.h"
+#include "../Message/JsonWriter.h"
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+
+namespace MCP
+{
+	std::atomic<int> CMCPLogger::s_iMinLevel{ LogLevel_Off };
+
+	static const char* s_arrLevelNames[] = {
+		"debug", "info", "notice", "warning", "error", "critical", "alert", "emergency", "off"
+	};
+
+	// Precedes the encoded arguments of a record.
+	struct LogRecordHeader
+	{
+		uint32_t nSize;
+		int32_t iLevel;
+		const char* lpcszLogger;
+		const char* lpcszFormat;
+		unsigned long long ullTimestampMs;
+		unsigned long long ullThread;
+		unsigned long ulRuntimeId;
+	};
+
+	// Hands the ring back when its thread exits.
+	struct LogRingHolder
+	{
+		std::shared_ptr<void> spOwner;
+		std::atomic_bool* pbInUse{ nullptr };
+		void* pRing{ nullptr };
+
+		~LogRingHolder()
+		{
+			if (pbInUse)
+				pbInUse->store(false, std::memory_order_release);
+		}
+	};
+	static thread_local LogRingHolder t_ringHolder;
+	// Set while the sinks write: what a sink logs itself, e.g. the transport writing a log
+	// notification, is dropped instead of feeding the sink forever.
+	static thread_local bool t_bWritingSinks = false;
+
+	const char* LogLevelName(LogLevel eLevel)
+	{
+		if (eLevel < LogLevel_Debug || eLevel > LogLevel_Off)
+			return "";
+		return s_arrLevelNames[eLevel];
+	}
+
+	bool ParseLogLevel(const std::string& strName, LogLevel& eLevel)
+	{
+		for (int iLevel = LogLevel_Debug; iLevel <= LogLevel_Off; ++iLevel)
+		{
+			if (strName.compare(s_arrLevelNames[iLevel]) == 0)
+			{
+				eLevel = static_cast<LogLevel>(iLevel);
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	// "2026-01-31T08:00:00.000Z", without gmtime() and its shared buffer.
+	static void FormatTimestamp(unsigned long long ullTimestampMs, char (&szTime)[48])
+	{
+		long long llDays = static_cast<long long>(ullTimestampMs / 86400000);
+		unsigned int nMsOfDay = static_cast<unsigned int>(ullTimestampMs % 86400000);
+		// Civil date from days since 1970-01-01 (proleptic Gregorian calendar).
+		llDays += 719468;
+		long long llEra = llDays / 146097;
+		unsigned int nDayOfEra = static_cast<unsigned int>(llDays - llEra * 146097);
+		unsigned int nYearOfEra = (nDayOfEra - nDayOfEra / 1460 + nDayOfEra / 36524 - nDayOfEra / 146096) / 365;
+		unsigned int nDayOfYear = nDayOfEra - (365 * nYearOfEra + nYearOfEra / 4 - nYearOfEra / 100);
+		unsigned int nMonthIndex = (5 * nDayOfYear + 2) / 153;
+		unsigned int nDay = nDayOfYear - (153 * nMonthIndex + 2) / 5 + 1;
+		unsigned int nMonth = nMonthIndex < 10 ? nMonthIndex + 3 : nMonthIndex - 9;
+		long long llYear = static_cast<long long>(nYearOfEra) + llEra * 400 + (nMonth <= 2 ? 1 : 0);
+		snprintf(szTime, sizeof(szTime), "%04lld-%02u-%02uT%02u:%02u:%02u.%03uZ", llYear, nMonth, nDay,
+			nMsOfDay / 3600000, nMsOfDay / 60000 % 60, nMsOfDay / 1000 % 60, nMsOfDay % 1000);
+	}
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	// CMCPStderrLogSink
+	CMCPStderrLogSink::CMCPStderrLogSink(LogLevel eLevel)
+		: m_eLevel(eLevel)
+	{
+	}
+
+	LogLevel CMCPStderrLogSink::GetLevel() const
+	{
+		return m_eLevel;
+	}
+
+	void CMCPStderrLogSink::Write(const std::vector<LogRecord>& vecRecords)
+	{
+		std::string strLines;
+		for (auto& record : vecRecords)
+		{
+			char szTime[48];
+			FormatTimestamp(record.ullTimestampMs, szTime);
+			strLines += szTime;
+			strLines += ' ';
+			strLines += LogLevelName(record.eLevel);
+			strLines += " [";
+			strLines += record.lpcszLogger;
+			strLines += "] ";
+			strLines += record.strMessage;
+			if (0 != record.ulRuntimeId)
+			{
+				strLines += " #";
+				strLines += std::to_string(record.ulRuntimeId);
+			}
+			strLines += '\n';
+		}
+		fwrite(strLines.data(), 1, strLines.size(), stderr);
+	}
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	// CMCPFileLogSink
+	CMCPFileLogSink::CMCPFileLogSink(const std::string& strPath, LogLevel eLevel)
+		: m_eLevel(eLevel)
+	{
+		m_pFile = fopen(strPath.c_str(), "ab");
+	}
+
+	CMCPFileLogSink::~CMCPFileLogSink()
+	{
+		if (m_pFile)
+			fclose(m_pFile);
+	}
+
+	bool CMCPFileLogSink::IsOpen() const
+	{
+		return nullptr != m_pFile;
+	}
+
+	LogLevel CMCPFileLogSink::GetLevel() const
+	{
+		return m_pFile ? m_eLevel : LogLevel_Off;
+	}
+
+	void CMCPFileLogSink::Write(const std::vector<LogRecord>& vecRecords)
+	{
+		if (!m_pFile)
+			return;
+
+		std::string strLines;
+		for (auto& record : vecRecords)
+		{
+			char szTime[48];
+			FormatTimestamp(record.ullTimestampMs, szTime);
+			CMCPJsonWriter writer(strLines);
+			writer.StartObject();
+			writer.Key("time");
+			writer.String(szTime);
+			writer.Key(MSG_KEY_LEVEL);
+			writer.String(LogLevelName(record.eLevel));
+			writer.Key(MSG_KEY_LOGGER);
+			writer.String(record.lpcszLogger);
+			writer.Key("message");
+			writer.String(record.strMessage);
+			writer.Key("thread");
+			writer.UInt(record.ullThread);
+			if (0 != record.ulRuntimeId)
+			{
+				writer.Key("runtimeId");
+				writer.UInt(record.ulRuntimeId);
+			}
+			writer.EndObject();
+			strLines.push_back('\n');
+		}
+		fwrite(strLines.data(), 1, strLines.size(), m_pFile);
+		fflush(m_pFile);
+	}
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	// CMCPLogger
+	CMCPLogger::Ring::Ring(size_t nCapacity)
+		: upBytes(new char[nCapacity])
+		, nMask(nCapacity - 1)
+	{
+	}
+
+	CMCPLogger& CMCPLogger::GetInstance()
+	{
+		static CMCPLogger s_instance;
+		return s_instance;
+	}
+
+	CMCPLogger::~CMCPLogger()
+	{
+		Stop();
+	}
+
+	int CMCPLogger::Start()
+	{
+		auto& config = Config::GetInstance();
+		int iBufferBytes = config.GetLoggingBufferBytes();
+		size_t nCapacity = 1024;
+		while (nCapacity < static_cast<size_t>(iBufferBytes > 0 ? iBufferBytes : 0))
+			nCapacity <<= 1;
+		{
+			std::lock_guard<std::mutex> _lock(m_mtxRings);
+			m_nRingCapacity = nCapacity;
+		}
+
+		{
+			std::lock_guard<std::mutex> _lock(m_mtxLogger);
+			if (m_bRunning)
+				return ERRNO_OK;
+			m_bRunning = true;
+		}
+
+		std::vector<std::shared_ptr<CMCPLogSink>> vecSinks;
+		LogLevel eLevel = LogLevel_Off;
+		if (ParseLogLevel(config.GetLoggingStderrLevel(), eLevel) && LogLevel_Off != eLevel)
+			vecSinks.push_back(std::make_shared<CMCPStderrLogSink>(eLevel));
+		std::string strFile = config.GetLoggingFile();
+		if (!strFile.empty() && ParseLogLevel(config.GetLoggingFileLevel(), eLevel) && LogLevel_Off != eLevel)
+		{
+			auto spFileSink = std::make_shared<CMCPFileLogSink>(strFile, eLevel);
+			if (spFileSink->IsOpen())
+				vecSinks.push_back(spFileSink);
+		}
+		for (auto& spSink : vecSinks)
+		{
+			AddSink(spSink);
+		}
+		{
+			std::lock_guard<std::mutex> _lock(m_mtxSinks);
+			m_vecConfigSinks = vecSinks;
+		}
+
+		m_thrLogger = std::thread(&CMCPLogger::LoggerProc, this);
+
+		return ERRNO_OK;
+	}
+
+	void CMCPLogger::Stop()
+	{
+		{
+			std::lock_guard<std::mutex> _lock(m_mtxLogger);
+			if (!m_bRunning)
+				return;
+			m_bRunning = false;
+		}
+		m_cvLogger.notify_all();
+		if (m_thrLogger.joinable())
+			m_thrLogger.join();
+		Drain();
+
+		std::vector<std::shared_ptr<CMCPLogSink>> vecSinks;
+		{
+			std::lock_guard<std::mutex> _lock(m_mtxSinks);
+			vecSinks.swap(m_vecConfigSinks);
+		}
+		for (auto& spSink : vecSinks)
+		{
+			RemoveSink(spSink);
+		}
+	}
+
+	void CMCPLogger::AddSink(const std::shared_ptr<CMCPLogSink>& spSink)
+	{
+		if (!spSink)
+			return;
+
+		{
+			std::lock_guard<std::mutex> _lock(m_mtxSinks);
+			m_vecSinks.push_back(spSink);
+		}
+		RefreshLevel();
+	}
+
+	void CMCPLogger::RemoveSink(const std::shared_ptr<CMCPLogSink>& spSink)
+	{
+		{
+			// Also waits for a Write() to the sink in progress.
+			std::lock_guard<std::mutex> _lock(m_mtxSinks);
+			m_vecSinks.erase(std::remove(m_vecSinks.begin(), m_vecSinks.end(), spSink), m_vecSinks.end());
+		}
+		RefreshLevel();
+	}
+
+	void CMCPLogger::RefreshLevel()
+	{
+		std::lock_guard<std::mutex> _lock(m_mtxSinks);
+		int iMinLevel = LogLevel_Off;
+		for (auto& spSink : m_vecSinks)
+		{
+			iMinLevel = (std::min)(iMinLevel, static_cast<int>(spSink->GetLevel()));
+		}
+		s_iMinLevel.store(iMinLevel, std::memory_order_relaxed);
+	}
+
+	void CMCPLogger::Flush()
+	{
+		Drain();
+	}
+
+	unsigned long long CMCPLogger::GetDroppedCount() const
+	{
+		unsigned long long ullDropped = 0;
+		std::lock_guard<std::mutex> _lock(m_mtxRings);
+		for (auto& spRing : m_vecRings)
+		{
+			ullDropped += spRing->ullDropped.load(std::memory_order_relaxed);
+		}
+
+		return ullDropped;
+	}
+
+	void CMCPLogger::EncodeString(std::string& strRecord, const char* pData, size_t nSize)
+	{
+		uint32_t nLength = static_cast<uint32_t>(nSize);
+		EncodeValue(strRecord, ArgType_String, nLength);
+		strRecord.append(pData, nLength);
+	}
+
+	std::string& CMCPLogger::BeginRecord(LogLevel eLevel, const char* lpcszLogger, const char* lpcszFormat)
+	{
+		// Reused by every record of the thread, so that logging does not allocate once warmed up.
+		static thread_local std::string t_strRecord;
+		LogRecordHeader header;
+		header.nSize = 0;
+		header.iLevel = eLevel;
+		header.lpcszLogger = lpcszLogger ? lpcszLogger : "";
+		header.lpcszFormat = lpcszFormat ? lpcszFormat : "";
+		header.ullTimestampMs = static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::system_clock::now().time_since_epoch()).count());
+		header.ullThread = 0;
+		header.ulRuntimeId = CMCPTrace::GetCurrentId();
+		t_strRecord.assign(reinterpret_cast<const char*>(&header), sizeof(header));
+
+		return t_strRecord;
+	}
+
+	void CMCPLogger::CommitRecord(std::string& strRecord)
+	{
+		if (t_bWritingSinks)
+			return;
+
+		Ring* pRing = GetThreadRing();
+		uint32_t nSize = static_cast<uint32_t>(strRecord.size());
+		memcpy(&strRecord[offsetof(LogRecordHeader, nSize)], &nSize, sizeof(nSize));
+		memcpy(&strRecord[offsetof(LogRecordHeader, ullThread)], &pRing->ullThread, sizeof(pRing->ullThread));
+
+		auto ullHead = pRing->ullHead.load(std::memory_order_relaxed);
+		auto ullTail = pRing->ullTail.load(std::memory_order_acquire);
+		size_t nCapacity = pRing->nMask + 1;
+		if (strRecord.size() > nCapacity - static_cast<size_t>(ullHead - ullTail))
+		{
+			pRing->ullDropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		size_t nOffset = static_cast<size_t>(ullHead) & pRing->nMask;
+		size_t nFirst = (std::min)(strRecord.size(), nCapacity - nOffset);
+		memcpy(pRing->upBytes.get() + nOffset, strRecord.data(), nFirst);
+		memcpy(pRing->upBytes.get(), strRecord.data() + nFirst, strRecord.size() - nFirst);
+		pRing->ullHead.store(ullHead + strRecord.size(), std::memory_order_release);
+	}
+
+	CMCPLogger::Ring* CMCPLogger::GetThreadRing()
+	{
+		if (t_ringHolder.pRing)
+			return static_cast<Ring*>(t_ringHolder.pRing);
+
+		std::lock_guard<std::mutex> _lock(m_mtxRings);
+		std::shared_ptr<Ring> spRing;
+		for (auto& spCandidate : m_vecRings)
+		{
+			bool bInUse = false;
+			if (spCandidate->nMask + 1 == m_nRingCapacity && spCandidate->bInUse.compare_exchange_strong(bInUse, true))
+			{
+				spRing = spCandidate;
+				break;
+			}
+		}
+		if (!spRing)
+		{
+			spRing = std::make_shared<Ring>(m_nRingCapacity);
+			spRing->bInUse = true;
+			m_vecRings.push_back(spRing);
+		}
+		spRing->ullThread = m_ullNextThread++;
+		t_ringHolder.spOwner = spRing;
+		t_ringHolder.pbInUse = &spRing->bInUse;
+		t_ringHolder.pRing = spRing.get();
+
+		return spRing.get();
+	}
+
+	void CMCPLogger::LoggerProc()
+	{
+		std::unique_lock<std::mutex> _lock(m_mtxLogger);
+		while (m_bRunning)
+		{
+			m_cvLogger.wait_for(_lock, std::chrono::milliseconds(20));
+			_lock.unlock();
+			Drain();
+			_lock.lock();
+		}
+	}
+
+	void CMCPLogger::Drain()
+	{
+		std::lock_guard<std::mutex> _drainLock(m_mtxDrain);
+		std::vector<std::shared_ptr<Ring>> vecRings;
+		{
+			std::lock_guard<std::mutex> _lock(m_mtxRings);
+			vecRings = m_vecRings;
+		}
+
+		m_vecRecords.clear();
+		unsigned long long ullDropped = 0;
+		for (auto& spRing : vecRings)
+		{
+			auto ullHead = spRing->ullHead.load(std::memory_order_acquire);
+			auto ullTail = spRing->ullTail.load(std::memory_order_relaxed);
+			const char* pBytes = spRing->upBytes.get();
+			size_t nCapacity = spRing->nMask + 1;
+			while (ullTail < ullHead)
+			{
+				// Records may wrap around the end of the ring, the header included.
+				auto fnCopy = [&](size_t nSize)
+				{
+					size_t nOffset = static_cast<size_t>(ullTail) & spRing->nMask;
+					size_t nFirst = (std::min)(nSize, nCapacity - nOffset);
+					m_strRecord.assign(pBytes + nOffset, nFirst);
+					m_strRecord.append(pBytes, nSize - nFirst);
+				};
+				fnCopy(sizeof(LogRecordHeader));
+				LogRecordHeader header;
+				memcpy(&header, m_strRecord.data(), sizeof(header));
+				fnCopy(header.nSize);
+				ullTail += header.nSize;
+
+				LogRecord record;
+				record.eLevel = static_cast<LogLevel>(header.iLevel);
+				record.lpcszLogger = header.lpcszLogger;
+				record.ullTimestampMs = header.ullTimestampMs;
+				record.ullThread = header.ullThread;
+				record.ulRuntimeId = header.ulRuntimeId;
+				FormatRecord(header.lpcszFormat, m_strRecord.data() + sizeof(header), m_strRecord.data() + m_strRecord.size(), record.strMessage);
+				m_vecRecords.push_back(std::move(record));
+			}
+			spRing->ullTail.store(ullTail, std::memory_order_release);
+			ullDropped += spRing->ullDropped.load(std::memory_order_relaxed);
+		}
+
+		if (ullDropped > m_ullDropped)
+		{
+			LogRecord record;
+			record.eLevel = LogLevel_Warning;
+			record.lpcszLogger = "logger";
+			record.ullTimestampMs = static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::milliseconds>(
+				std::chrono::system_clock::now().time_since_epoch()).count());
+			record.strMessage = std::to_string(ullDropped - m_ullDropped) + " records dropped, [logging] buffer_bytes is too small";
+			m_vecRecords.push_back(std::move(record));
+			m_ullDropped = ullDropped;
+		}
+		if (m_vecRecords.empty())
+			return;
+
+		std::stable_sort(m_vecRecords.begin(), m_vecRecords.end(), [](const LogRecord& left, const LogRecord& right)
+			{
+				return left.ullTimestampMs < right.ullTimestampMs;
+			});
+
+		std::vector<LogRecord> vecFiltered;
+		std::lock_guard<std::mutex> _lock(m_mtxSinks);
+		t_bWritingSinks = true;
+		for (auto& spSink : m_vecSinks)
+		{
+			LogLevel eLevel = spSink->GetLevel();
+			if (LogLevel_Off == eLevel)
+				continue;
+			if (LogLevel_Debug == eLevel)
+			{
+				spSink->Write(m_vecRecords);
+				continue;
+			}
+			vecFiltered.clear();
+			for (auto& record : m_vecRecords)
+			{
+				if (record.eLevel >= eLevel)
+					vecFiltered.push_back(record);
+			}
+			if (!vecFiltered.empty())
+				spSink->Write(vecFiltered);
+		}
+		t_bWritingSinks = false;
+	}
+
+	void CMCPLogger::FormatRecord(const char* lpcszFormat, const char* pArgs, const char* pArgsEnd, std::string& strMessage)
+	{
+		// Appends the next argument; false once there are none left.
+		auto fnAppendArg = [&]() -> bool
+		{
+			if (pArgs >= pArgsEnd)
+				return false;
+			auto eType = static_cast<ArgType>(*pArgs++);
+			char szValue[32];
+			switch (eType)
+			{
+				case ArgType_Int:
+				{
+					long long llValue = 0;
+					memcpy(&llValue, pArgs, sizeof(llValue));
+					pArgs += sizeof(llValue);
+					snprintf(szValue, sizeof(szValue), "%lld", llValue);
+					strMessage += szValue;
+					break;
+				}
+				case ArgType_UInt:
+				{
+					unsigned long long ullValue = 0;
+					memcpy(&ullValue, pArgs, sizeof(ullValue));
+					pArgs += sizeof(ullValue);
+					snprintf(szValue, sizeof(szValue), "%llu", ullValue);
+					strMessage += szValue;
+					break;
+				}
+				case ArgType_Bool:
+					strMessage += *pArgs++ ? "true" : "false";
+					break;
+				case ArgType_Double:
+				{
+					double dValue = 0;
+					memcpy(&dValue, pArgs, sizeof(dValue));
+					pArgs += sizeof(dValue);
+					snprintf(szValue, sizeof(szValue), "%g", dValue);
+					strMessage += szValue;
+					break;
+				}
+				case ArgType_String:
+				{
+					uint32_t nLength = 0;
+					memcpy(&nLength, pArgs, sizeof(nLength));
+					pArgs += sizeof(nLength);
+					strMessage.append(pArgs, nLength);
+					pArgs += nLength;
+					break;
+				}
+				default:
+					pArgs = pArgsEnd;
+					return false;
+			}
+			return true;
+		};
+
+		for (const char* pChar = lpcszFormat; *pChar; ++pChar)
+		{
+			if ('{' == pChar[0] && '}' == pChar[1] && pArgs < pArgsEnd)
+			{
+				fnAppendArg();
+				++pChar;
+				continue;
+			}
+			strMessage += *pChar;
+		}
+		// Arguments without a placeholder are kept too.
+		while (pArgs < pArgsEnd)
+		{
+			strMessage += ' ';
+			if (!fnAppendArg())
+				break;
+		}
+	}
+}
@@ -0,0 +1,255 @@
+#pragma once
+// To ensure good cross-platform compatibility, the MCP namespace code uses standard C++ only.
+// Avoid using platform-specific system APIs unless absolutely necessary.
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Logs a record when some sink wants eLevel; the arguments are not even evaluated otherwise.
+// lpcszLogger and the format (with a {} per argument) must be literals, they are kept by address.
+#define MCP_LOG(eLevel, lpcszLogger, ...) \
+	do { if (MCP::CMCPLogger::IsEnabled(eLevel)) MCP::CMCPLogger::GetInstance().Log(eLevel, lpcszLogger, __VA_ARGS__); } while (0)
+#define MCP_LOG_DEBUG(lpcszLogger, ...) MCP_LOG(MCP::LogLevel_Debug, lpcszLogger, __VA_ARGS__)
+#define MCP_LOG_INFO(lpcszLogger, ...) MCP_LOG(MCP::LogLevel_Info, lpcszLogger, __VA_ARGS__)
+#define MCP_LOG_WARNING(lpcszLogger, ...) MCP_LOG(MCP::LogLevel_Warning, lpcszLogger, __VA_ARGS__)
+#define MCP_LOG_ERROR(lpcszLogger, ...) MCP_LOG(MCP::LogLevel_Error, lpcszLogger, __VA_ARGS__)
+
+namespace MCP
+{
+	// The syslog severities of logging/setLevel, least severe first.
+	enum LogLevel
+	{
+		LogLevel_Debug,
+		LogLevel_Info,
+		LogLevel_Notice,
+		LogLevel_Warning,
+		LogLevel_Error,
+		LogLevel_Critical,
+		LogLevel_Alert,
+		LogLevel_Emergency,
+		// Above every level: a sink at LogLevel_Off receives nothing.
+		LogLevel_Off,
+	};
+
+	// "debug", "info", ..., "emergency", "off".
+	const char* LogLevelName(LogLevel eLevel);
+	// False for a name that is not a level.
+	bool ParseLogLevel(const std::string& strName, LogLevel& eLevel);
+
+	struct LogRecord
+	{
+		LogLevel eLevel{ LogLevel_Info };
+		const char* lpcszLogger{ "" };
+		std::string strMessage;
+		// Milliseconds since the epoch.
+		unsigned long long ullTimestampMs{ 0 };
+		// Numbers the threads in the order they first logged.
+		unsigned long long ullThread{ 0 };
+		// Message::ulRuntimeId of the message the thread worked on (CMCPTrace::GetCurrentId()), 0 = none.
+		unsigned long ulRuntimeId{ 0 };
+	};
+
+	class CMCPLogSink
+	{
+	public:
+		virtual ~CMCPLogSink() = default;
+
+		// The least severe level the sink wants; call CMCPLogger::RefreshLevel() when it changes.
+		virtual LogLevel GetLevel() const = 0;
+		// Called on the logger thread only, with the records at GetLevel() or above, oldest first.
+		virtual void Write(const std::vector<LogRecord>& vecRecords) = 0;
+	};
+
+	// One line of text per record.
+	class CMCPStderrLogSink : public CMCPLogSink
+	{
+	public:
+		explicit CMCPStderrLogSink(LogLevel eLevel);
+
+		LogLevel GetLevel() const override;
+		void Write(const std::vector<LogRecord>& vecRecords) override;
+
+	private:
+		const LogLevel m_eLevel;
+	};
+
+	// One JSON object per line, appended to the file.
+	class CMCPFileLogSink : public CMCPLogSink
+	{
+	public:
+		CMCPFileLogSink(const std::string& strPath, LogLevel eLevel);
+		~CMCPFileLogSink();
+		CMCPFileLogSink(const CMCPFileLogSink&) = delete;
+		CMCPFileLogSink& operator=(const CMCPFileLogSink&) = delete;
+
+		bool IsOpen() const;
+		LogLevel GetLevel() const override;
+		void Write(const std::vector<LogRecord>& vecRecords) override;
+
+	private:
+		const LogLevel m_eLevel;
+		FILE* m_pFile{ nullptr };
+	};
+
+	// Asynchronous structured logging.
+	//
+	// Whether a level is logged at all is a relaxed atomic load (IsEnabled(), checked by MCP_LOG), so
+	// a disabled log call costs a compare. An enabled one copies the format pointer and the binary
+	// arguments into a ring buffer of the calling thread, without locks or allocations; a background
+	// thread drains the rings every few milliseconds, formats the messages and hands them to the sinks.
+	// A record not fitting its ring is dropped, and the drops are reported by a warning of their own.
+	class CMCPLogger
+	{
+	public:
+		static CMCPLogger& GetInstance();
+
+		static bool IsEnabled(LogLevel eLevel)
+		{
+			return static_cast<int>(eLevel) >= s_iMinLevel.load(std::memory_order_relaxed);
+		}
+
+		// Adds the sinks of [logging] and starts the logger thread.
+		int Start();
+		// Writes out what is buffered, removes the sinks of [logging] and joins the logger thread.
+		void Stop();
+
+		void AddSink(const std::shared_ptr<CMCPLogSink>& spSink);
+		void RemoveSink(const std::shared_ptr<CMCPLogSink>& spSink);
+		// Recomputes the level IsEnabled() compares with from the levels of the sinks.
+		void RefreshLevel();
+		// Hands every record logged so far to the sinks before returning.
+		void Flush();
+		// Records dropped because their ring was full.
+		unsigned long long GetDroppedCount() const;
+
+		template <class... Args>
+		void Log(LogLevel eLevel, const char* lpcszLogger, const char* lpcszFormat, const Args&... args)
+		{
+			std::string& strRecord = BeginRecord(eLevel, lpcszLogger, lpcszFormat);
+			int arrEncoded[] = { 0, (Encode(strRecord, args), 0)... };
+			(void)arrEncoded;
+			CommitRecord(strRecord);
+		}
+
+	private:
+		enum ArgType : unsigned char
+		{
+			ArgType_Int,
+			ArgType_UInt,
+			ArgType_Bool,
+			ArgType_Double,
+			ArgType_String,
+		};
+
+		struct Ring
+		{
+			explicit Ring(size_t nCapacity);
+
+			std::unique_ptr<char[]> upBytes;
+			size_t nMask{ 0 };
+			// Written by the owning thread only.
+			std::atomic<unsigned long long> ullHead{ 0 };
+			// Written by the logger thread only.
+			std::atomic<unsigned long long> ullTail{ 0 };
+			std::atomic<unsigned long long> ullDropped{ 0 };
+			// Owned by a live thread; a ring whose thread exited is handed to the next new thread.
+			std::atomic_bool bInUse{ false };
+			unsigned long long ullThread{ 0 };
+		};
+
+		CMCPLogger() = default;
+		~CMCPLogger();
+		CMCPLogger(const CMCPLogger&) = delete;
+		CMCPLogger& operator=(const CMCPLogger&) = delete;
+
+		template <class T>
+		static void EncodeValue(std::string& strRecord, ArgType eType, T value)
+		{
+			strRecord.push_back(static_cast<char>(eType));
+			strRecord.append(reinterpret_cast<const char*>(&value), sizeof(value));
+		}
+		static void EncodeString(std::string& strRecord, const char* pData, size_t nSize);
+
+		template <class T>
+		static typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type Encode(std::string& strRecord, const T& value)
+		{
+			EncodeValue(strRecord, ArgType_Int, static_cast<long long>(value));
+		}
+		template <class T>
+		static typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value>::type Encode(std::string& strRecord, const T& value)
+		{
+			EncodeValue(strRecord, ArgType_UInt, static_cast<unsigned long long>(value));
+		}
+		template <class T>
+		static typename std::enable_if<std::is_enum<T>::value>::type Encode(std::string& strRecord, const T& value)
+		{
+			EncodeValue(strRecord, ArgType_Int, static_cast<long long>(value));
+		}
+		template <class T>
+		static typename std::enable_if<std::is_floating_point<T>::value>::type Encode(std::string& strRecord, const T& value)
+		{
+			EncodeValue(strRecord, ArgType_Double, static_cast<double>(value));
+		}
+		static void Encode(std::string& strRecord, bool bValue)
+		{
+			EncodeValue(strRecord, ArgType_Bool, static_cast<unsigned char>(bValue ? 1 : 0));
+		}
+		static void Encode(std::string& strRecord, char chValue)
+		{
+			EncodeString(strRecord, &chValue, 1);
+		}
+		static void Encode(std::string& strRecord, const char* lpcszValue)
+		{
+			if (lpcszValue)
+				EncodeString(strRecord, lpcszValue, strlen(lpcszValue));
+			else
+				EncodeString(strRecord, "(null)", 6);
+		}
+		static void Encode(std::string& strRecord, const std::string& strValue)
+		{
+			EncodeString(strRecord, strValue.data(), strValue.size());
+		}
+
+		// The scratch buffer of the thread, holding the header of a new record.
+		std::string& BeginRecord(LogLevel eLevel, const char* lpcszLogger, const char* lpcszFormat);
+		// Copies the record into the ring of the thread.
+		void CommitRecord(std::string& strRecord);
+		Ring* GetThreadRing();
+		void LoggerProc();
+		// Formats the records of every ring and writes them to the sinks.
+		void Drain();
+		static void FormatRecord(const char* lpcszFormat, const char* pArgs, const char* pArgsEnd, std::string& strMessage);
+
+		static std::atomic<int> s_iMinLevel;
+
+		size_t m_nRingCapacity{ 64 * 1024 };
+		mutable std::mutex m_mtxRings;
+		std::vector<std::shared_ptr<Ring>> m_vecRings;
+		unsigned long long m_ullNextThread{ 1 };
+
+		mutable std::mutex m_mtxSinks;
+		std::vector<std::shared_ptr<CMCPLogSink>> m_vecSinks;
+		// The sinks added by Start().
+		std::vector<std::shared_ptr<CMCPLogSink>> m_vecConfigSinks;
+
+		// Serializes Drain() between the logger thread and Flush().
+		std::mutex m_mtxDrain;
+		std::vector<LogRecord> m_vecRecords;
+		std::string m_strRecord;
+		unsigned long long m_ullDropped{ 0 };
+
+		std::mutex m_mtxLogger;
+		std::condition_variable m_cvLogger;
+		bool m_bRunning{ false };
+		std::thread m_thrLogger;
+	};
+}
@@ -0,0 +1,73 @@
+#pragma once
+// To ensure good cross-platform compatibility, the MCP namespace code uses standard C++ only.
+// Avoid using platform-specific system APIs unless absolutely necessary.
+
+#include <atomic>
+#include <utility>
+
+namespace MCP
+{
+	// Unbounded lock-free multi-producer single-consumer queue (Vyukov).
+	// Push() may be called from any thread, TryPop() and IsEmpty() only from the consumer.
+	template <class T>
+	class CMCPMpscQueue
+	{
+	public:
+		CMCPMpscQueue()
+		{
+			auto pStub = new Node();
+			m_pHead.store(pStub, std::memory_order_relaxed);
+			m_pTail = pStub;
+		}
+
+		~CMCPMpscQueue()
+		{
+			T value;
+			while (TryPop(value))
+			{
+			}
+			delete m_pTail;
+		}
+
+		CMCPMpscQueue(const CMCPMpscQueue&) = delete;
+		CMCPMpscQueue& operator=(const CMCPMpscQueue&) = delete;
+
+		void Push(T value)
+		{
+			auto pNode = new Node();
+			pNode->value = std::move(value);
+			auto pPrev = m_pHead.exchange(pNode);
+			pPrev->pNext.store(pNode, std::memory_order_release);
+		}
+
+		// May return false for an element whose Push() has not completed yet.
+		bool TryPop(T& value)
+		{
+			auto pNext = m_pTail->pNext.load(std::memory_order_acquire);
+			if (!pNext)
+				return false;
+
+			value = std::move(pNext->value);
+			delete m_pTail;
+			m_pTail = pNext;
+
+			return true;
+		}
+
+		// Also false while a Push() is in progress, so the consumer does not go to sleep on it.
+		bool IsEmpty() const
+		{
+			return m_pHead.load() == m_pTail;
+		}
+
+	private:
+		struct Node
+		{
+			std::atomic<Node*> pNext{ nullptr };
+			T value;
+		};
+
+		std::atomic<Node*> m_pHead;
+		Node* m_pTail;
+	};
+}
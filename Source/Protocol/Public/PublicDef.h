@@ -22,6 +22,8 @@ namespace MCP
 	static constexpr const char* MSG_KEY_MESSAGE = "message";
 	static constexpr const char* MSG_KEY_LEVEL = "level";
 	static constexpr const char* MSG_KEY_DATA = "data";
+	static constexpr const char* MSG_KEY_LOGGER = "logger";
+	static constexpr const char* MSG_KEY_LOGGING = "logging";
 	static constexpr const char* MSG_KEY_PROTOCOL_VERSION = "protocolVersion";	
 	static constexpr const char* MSG_KEY_CLIENT_INFO = "clientInfo";
 	static constexpr const char* MSG_KEY_NAME = "name";
@@ -38,8 +40,10 @@ namespace MCP
 	static constexpr const char* MSG_KEY_DESCRIPTION = "description";
 	static constexpr const char* MSG_KEY_INPUT_SCHEMA = "inputSchema";
 	static constexpr const char* MSG_KEY_ARGUMENTS = "arguments";
+	static constexpr const char* MSG_KEY_REQUIRED = "required";
 	static constexpr const char* MSG_KEY_IS_ERROR = "isError";
 	static constexpr const char* MSG_KEY_CONTENT = "content";
+	static constexpr const char* MSG_KEY_CONTENTS = "contents";
 	static constexpr const char* MSG_KEY_TEXT = "text";
 	static constexpr const char* MSG_KEY_TYPE = "type";
 	static constexpr const char* MSG_KEY_MIMETYPE = "mimeType";
@@ -51,19 +55,34 @@ namespace MCP
 	static constexpr const char* MSG_KEY_PROGRESS = "progress";
 	static constexpr const char* MSG_KEY_TOTAL = "total";
 	static constexpr const char* MSG_KEY_REQUEST_ID = "requestId";
+	static constexpr const char* MSG_KEY_REASON = "reason";
+	static constexpr const char* MSG_KEY_TIMEOUT_MS = "timeoutMs";
+	static constexpr const char* MSG_KEY_RANGE = "range";
+	static constexpr const char* MSG_KEY_OFFSET = "offset";
+	static constexpr const char* MSG_KEY_LENGTH = "length";
+	static constexpr const char* MSG_KEY_EXPERIMENTAL = "experimental";
+	// Offered by the client in capabilities.experimental, the one picked is returned by the server.
+	static constexpr const char* MSG_KEY_ENCODINGS = "encodings";
+	static constexpr const char* MSG_KEY_ENCODING = "encoding";
+	static constexpr const char* ENCODING_FLATBUFFERS = "flatbuffers";
 	
 
 	static constexpr const char* METHOD_INITIALIZE = "initialize";
 	static constexpr const char* METHOD_NOTIFICATION_INITIALIZED = "notifications/initialized";
 	static constexpr const char* METHOD_NOTIFICATION_CANCELLED = "notifications/cancelled";
 	static constexpr const char* METHOD_NOTIFICATION_PROGRESS = "notifications/progress";
-	// Optional utilities (placeholders for future expansion per 2025-06-18 spec)
-	static constexpr const char* METHOD_NOTIFICATION_LOG = "notifications/log";
+	// Logging utility: the client picks the lowest level it wants, the server sends log messages at or above it.
+	static constexpr const char* METHOD_LOGGING_SET_LEVEL = "logging/setLevel";
+	static constexpr const char* METHOD_NOTIFICATION_MESSAGE = "notifications/message";
 	static constexpr const char* METHOD_PING = "ping";
 	static constexpr const char* METHOD_TOOLS_LIST = "tools/list";
 	static constexpr const char* METHOD_TOOLS_CALL = "tools/call";
+	static constexpr const char* METHOD_NOTIFICATION_TOOLS_LIST_CHANGED = "notifications/tools/list_changed";
 	static constexpr const char* METHOD_RESOURCES_LIST = "resources/list";
 	static constexpr const char* METHOD_RESOURCES_READ = "resources/read";
+	static constexpr const char* METHOD_RESOURCES_SUBSCRIBE = "resources/subscribe";
+	static constexpr const char* METHOD_RESOURCES_UNSUBSCRIBE = "resources/unsubscribe";
+	static constexpr const char* METHOD_NOTIFICATION_RESOURCES_UPDATED = "notifications/resources/updated";
 	static constexpr const char* METHOD_PROMPTS_LIST = "prompts/list";
 
 	static constexpr const char* CONST_TEXT = "text";
@@ -75,6 +94,10 @@ namespace MCP
 	static constexpr const char* ERROR_MESSAGE_METHOD_NOT_FOUND = u8"method not found";
 	static constexpr const char* ERROR_MESSAGE_INVALID_PARAMS = u8"invalid params";
 	static constexpr const char* ERROR_MESSAGE_INTERNAL_ERROR = u8"internal error";
+	static constexpr const char* ERROR_MESSAGE_DUPLICATE_REQUEST_ID = u8"duplicate request id";
+	static constexpr const char* ERROR_MESSAGE_REQUEST_TIMEOUT = u8"request timed out";
+	static constexpr const char* ERROR_MESSAGE_RATE_LIMITED = u8"rate limit exceeded";
+	static constexpr const char* ERROR_MESSAGE_SERVER_OVERLOADED = u8"server overloaded";
 
 
 	// JSON-RPC 2.0 standard error codes
@@ -92,12 +115,18 @@ namespace MCP
 	static constexpr const int ERRNO_INTERNAL_INPUT_TERMINATE = -32003;
 	static constexpr const int ERRNO_INTERNAL_INPUT_ERROR = -32004;
 	static constexpr const int ERRNO_INTERNAL_OUTPUT_ERROR = -32005;
+	static constexpr const int ERRNO_REQUEST_TIMEOUT = -32006;
 	static constexpr const int ERRNO_SERVER_ERROR_LAST = -32099;
 
 	// Authorization related (server-defined)
 	static constexpr const int ERRNO_UNAUTHORIZED = -32010; // not authenticated
 	static constexpr const int ERRNO_FORBIDDEN = -32011;    // authenticated but not allowed
 
+	// Admission control (server-defined): the client may retry later
+	static constexpr const int ERRNO_RATE_LIMITED = -32012;         // a rate limit of [rate_limits] ran out
+	static constexpr const int ERRNO_SERVER_OVERLOADED = -32013;    // too many tool calls pending
+	static constexpr const int ERRNO_REQUEST_CANCELLED = -32014;    // internal: cancelled calls are not answered
+
 	enum DataType
 	{
 		DataType_Unknown,
@@ -149,5 +178,14 @@ namespace MCP
 		MessageType_ProgressNotification,
 		MessageType_ErrorResponse,
 		MessageType_Notification_Log,
+		MessageType_Resource,
+		MessageType_PromptArgument,
+		MessageType_Prompt,
+		MessageType_SubscribeRequest,
+		MessageType_EmptyResult,
+		MessageType_ResourceUpdatedNotification,
+		MessageType_Logging,
+		MessageType_SetLevelRequest,
+		MessageType_ToolListChangedNotification,
 	};
 }
@@ -0,0 +1,102 @@
+#include "Sha1.h"
+#include <cstdint>
+#include <cstring>
+
+namespace MCP
+{
+	namespace Sha1
+	{
+		static constexpr size_t BLOCK_SIZE = 64;
+
+		static inline uint32_t RotateLeft(uint32_t nValue, unsigned int nBits)
+		{
+			return (nValue << nBits) | (nValue >> (32 - nBits));
+		}
+
+		static void Transform(uint32_t (&arrState)[5], const unsigned char* pBlock)
+		{
+			uint32_t arrSchedule[80];
+			for (int i = 0; i < 16; ++i)
+			{
+				arrSchedule[i] = (static_cast<uint32_t>(pBlock[i * 4]) << 24) | (static_cast<uint32_t>(pBlock[i * 4 + 1]) << 16)
+					| (static_cast<uint32_t>(pBlock[i * 4 + 2]) << 8) | static_cast<uint32_t>(pBlock[i * 4 + 3]);
+			}
+			for (int i = 16; i < 80; ++i)
+			{
+				arrSchedule[i] = RotateLeft(arrSchedule[i - 3] ^ arrSchedule[i - 8] ^ arrSchedule[i - 14] ^ arrSchedule[i - 16], 1);
+			}
+
+			uint32_t a = arrState[0], b = arrState[1], c = arrState[2], d = arrState[3], e = arrState[4];
+			for (int i = 0; i < 80; ++i)
+			{
+				uint32_t f = 0;
+				uint32_t k = 0;
+				if (i < 20)
+				{
+					f = (b & c) | (~b & d);
+					k = 0x5a827999;
+				}
+				else if (i < 40)
+				{
+					f = b ^ c ^ d;
+					k = 0x6ed9eba1;
+				}
+				else if (i < 60)
+				{
+					f = (b & c) | (b & d) | (c & d);
+					k = 0x8f1bbcdc;
+				}
+				else
+				{
+					f = b ^ c ^ d;
+					k = 0xca62c1d6;
+				}
+				uint32_t temp = RotateLeft(a, 5) + f + e + k + arrSchedule[i];
+				e = d;
+				d = c;
+				c = RotateLeft(b, 30);
+				b = a;
+				a = temp;
+			}
+			arrState[0] += a;
+			arrState[1] += b;
+			arrState[2] += c;
+			arrState[3] += d;
+			arrState[4] += e;
+		}
+
+		void Hash(const void* pData, size_t nLength, unsigned char (&arrDigest)[DIGEST_SIZE])
+		{
+			uint32_t arrState[5] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0 };
+			auto pBytes = static_cast<const unsigned char*>(pData);
+			unsigned long long ullBits = static_cast<unsigned long long>(nLength) * 8;
+			while (nLength >= BLOCK_SIZE)
+			{
+				Transform(arrState, pBytes);
+				pBytes += BLOCK_SIZE;
+				nLength -= BLOCK_SIZE;
+			}
+
+			// The tail, 0x80 and the bit length take one or two more blocks.
+			unsigned char arrTail[BLOCK_SIZE * 2] = {};
+			std::memcpy(arrTail, pBytes, nLength);
+			arrTail[nLength] = 0x80;
+			size_t nTail = nLength < 56 ? BLOCK_SIZE : BLOCK_SIZE * 2;
+			for (int i = 0; i < 8; ++i)
+			{
+				arrTail[nTail - 1 - i] = static_cast<unsigned char>(ullBits >> (8 * i));
+			}
+			Transform(arrState, arrTail);
+			if (nTail > BLOCK_SIZE)
+				Transform(arrState, arrTail + BLOCK_SIZE);
+
+			for (int i = 0; i < 5; ++i)
+			{
+				arrDigest[i * 4] = static_cast<unsigned char>(arrState[i] >> 24);
+				arrDigest[i * 4 + 1] = static_cast<unsigned char>(arrState[i] >> 16);
+				arrDigest[i * 4 + 2] = static_cast<unsigned char>(arrState[i] >> 8);
+				arrDigest[i * 4 + 3] = static_cast<unsigned char>(arrState[i]);
+			}
+		}
+	}
+}
@@ -0,0 +1,17 @@
+#pragma once
+// To ensure good cross-platform compatibility, the MCP namespace code uses standard C++ only.
+// Avoid using platform-specific system APIs unless absolutely necessary.
+
+#include <cstddef>
+
+namespace MCP
+{
+	// SHA-1 (FIPS 180-4), only for the Sec-WebSocket-Accept key of the WebSocket handshake (RFC 6455),
+	// which prescribes it. Not for anything that needs collision resistance.
+	namespace Sha1
+	{
+		static constexpr size_t DIGEST_SIZE = 20;
+
+		void Hash(const void* pData, size_t nLength, unsigned char (&arrDigest)[DIGEST_SIZE]);
+	}
+}
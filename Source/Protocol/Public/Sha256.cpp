@@ -0,0 +1,175 @@
+#include "Sha256.h"
+#include <algorithm>
+#include <cstring>
+
+namespace MCP
+{
+	namespace Sha256
+	{
+		static const uint32_t s_arrRoundConstants[64] = {
+			0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+			0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+			0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+			0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+			0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+			0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+			0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+			0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+		};
+
+		static inline uint32_t RotateRight(uint32_t nValue, unsigned int nBits)
+		{
+			return (nValue >> nBits) | (nValue << (32 - nBits));
+		}
+
+		CHasher::CHasher()
+			: m_arrState{ 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 }
+		{
+		}
+
+		void CHasher::Update(const void* pData, size_t nLength)
+		{
+			auto pBytes = static_cast<const unsigned char*>(pData);
+			m_ullLength += nLength;
+			if (m_nBuffered > 0)
+			{
+				size_t nCopy = (std::min)(nLength, BLOCK_SIZE - m_nBuffered);
+				std::memcpy(m_arrBuffer + m_nBuffered, pBytes, nCopy);
+				m_nBuffered += nCopy;
+				pBytes += nCopy;
+				nLength -= nCopy;
+				if (m_nBuffered < BLOCK_SIZE)
+					return;
+				Transform(m_arrBuffer);
+				m_nBuffered = 0;
+			}
+			while (nLength >= BLOCK_SIZE)
+			{
+				Transform(pBytes);
+				pBytes += BLOCK_SIZE;
+				nLength -= BLOCK_SIZE;
+			}
+			std::memcpy(m_arrBuffer, pBytes, nLength);
+			m_nBuffered = nLength;
+		}
+
+		void CHasher::Final(unsigned char (&arrDigest)[DIGEST_SIZE])
+		{
+			unsigned long long ullBits = m_ullLength * 8;
+			static const unsigned char s_arrPadding[BLOCK_SIZE] = { 0x80 };
+			size_t nPadding = m_nBuffered < 56 ? 56 - m_nBuffered : 120 - m_nBuffered;
+			Update(s_arrPadding, nPadding);
+			unsigned char arrLength[8];
+			for (int i = 0; i < 8; ++i)
+			{
+				arrLength[i] = static_cast<unsigned char>(ullBits >> (56 - 8 * i));
+			}
+			Update(arrLength, sizeof(arrLength));
+
+			for (int i = 0; i < 8; ++i)
+			{
+				arrDigest[i * 4] = static_cast<unsigned char>(m_arrState[i] >> 24);
+				arrDigest[i * 4 + 1] = static_cast<unsigned char>(m_arrState[i] >> 16);
+				arrDigest[i * 4 + 2] = static_cast<unsigned char>(m_arrState[i] >> 8);
+				arrDigest[i * 4 + 3] = static_cast<unsigned char>(m_arrState[i]);
+			}
+		}
+
+		void CHasher::Transform(const unsigned char* pBlock)
+		{
+			uint32_t arrSchedule[64];
+			for (int i = 0; i < 16; ++i)
+			{
+				arrSchedule[i] = (static_cast<uint32_t>(pBlock[i * 4]) << 24) | (static_cast<uint32_t>(pBlock[i * 4 + 1]) << 16)
+					| (static_cast<uint32_t>(pBlock[i * 4 + 2]) << 8) | static_cast<uint32_t>(pBlock[i * 4 + 3]);
+			}
+			for (int i = 16; i < 64; ++i)
+			{
+				uint32_t s0 = RotateRight(arrSchedule[i - 15], 7) ^ RotateRight(arrSchedule[i - 15], 18) ^ (arrSchedule[i - 15] >> 3);
+				uint32_t s1 = RotateRight(arrSchedule[i - 2], 17) ^ RotateRight(arrSchedule[i - 2], 19) ^ (arrSchedule[i - 2] >> 10);
+				arrSchedule[i] = arrSchedule[i - 16] + s0 + arrSchedule[i - 7] + s1;
+			}
+
+			uint32_t a = m_arrState[0], b = m_arrState[1], c = m_arrState[2], d = m_arrState[3];
+			uint32_t e = m_arrState[4], f = m_arrState[5], g = m_arrState[6], h = m_arrState[7];
+			for (int i = 0; i < 64; ++i)
+			{
+				uint32_t S1 = RotateRight(e, 6) ^ RotateRight(e, 11) ^ RotateRight(e, 25);
+				uint32_t ch = (e & f) ^ (~e & g);
+				uint32_t temp1 = h + S1 + ch + s_arrRoundConstants[i] + arrSchedule[i];
+				uint32_t S0 = RotateRight(a, 2) ^ RotateRight(a, 13) ^ RotateRight(a, 22);
+				uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+				uint32_t temp2 = S0 + maj;
+				h = g;
+				g = f;
+				f = e;
+				e = d + temp1;
+				d = c;
+				c = b;
+				b = a;
+				a = temp1 + temp2;
+			}
+			m_arrState[0] += a;
+			m_arrState[1] += b;
+			m_arrState[2] += c;
+			m_arrState[3] += d;
+			m_arrState[4] += e;
+			m_arrState[5] += f;
+			m_arrState[6] += g;
+			m_arrState[7] += h;
+		}
+
+		void Hash(const void* pData, size_t nLength, unsigned char (&arrDigest)[DIGEST_SIZE])
+		{
+			CHasher hasher;
+			hasher.Update(pData, nLength);
+			hasher.Final(arrDigest);
+		}
+
+		void Hmac(const void* pKey, size_t nKeyLength, const void* pData, size_t nLength, unsigned char (&arrDigest)[DIGEST_SIZE])
+		{
+			unsigned char arrKey[BLOCK_SIZE] = {};
+			if (nKeyLength > BLOCK_SIZE)
+			{
+				unsigned char arrKeyDigest[DIGEST_SIZE];
+				Hash(pKey, nKeyLength, arrKeyDigest);
+				std::memcpy(arrKey, arrKeyDigest, DIGEST_SIZE);
+			}
+			else if (nKeyLength > 0)
+			{
+				std::memcpy(arrKey, pKey, nKeyLength);
+			}
+
+			unsigned char arrPad[BLOCK_SIZE];
+			for (size_t i = 0; i < BLOCK_SIZE; ++i)
+			{
+				arrPad[i] = arrKey[i] ^ 0x36;
+			}
+			unsigned char arrInner[DIGEST_SIZE];
+			CHasher inner;
+			inner.Update(arrPad, BLOCK_SIZE);
+			inner.Update(pData, nLength);
+			inner.Final(arrInner);
+
+			for (size_t i = 0; i < BLOCK_SIZE; ++i)
+			{
+				arrPad[i] = arrKey[i] ^ 0x5c;
+			}
+			CHasher outer;
+			outer.Update(arrPad, BLOCK_SIZE);
+			outer.Update(arrInner, DIGEST_SIZE);
+			outer.Final(arrDigest);
+		}
+
+		bool ConstantTimeEqual(const unsigned char* pLeft, const unsigned char* pRight, size_t nLength)
+		{
+			volatile unsigned char chDiff = 0;
+			for (size_t i = 0; i < nLength; ++i)
+			{
+				chDiff = chDiff | (pLeft[i] ^ pRight[i]);
+			}
+
+			return 0 == chDiff;
+		}
+	}
+}
@@ -0,0 +1,39 @@
+#pragma once
+// To ensure good cross-platform compatibility, the MCP namespace code uses standard C++ only.
+// Avoid using platform-specific system APIs unless absolutely necessary.
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace MCP
+{
+	// SHA-256 (FIPS 180-4) and HMAC-SHA256 (RFC 2104), for verifying tokens without a crypto library.
+	namespace Sha256
+	{
+		static constexpr size_t DIGEST_SIZE = 32;
+		static constexpr size_t BLOCK_SIZE = 64;
+
+		class CHasher
+		{
+		public:
+			CHasher();
+
+			void Update(const void* pData, size_t nLength);
+			void Final(unsigned char (&arrDigest)[DIGEST_SIZE]);
+
+		private:
+			void Transform(const unsigned char* pBlock);
+
+			uint32_t m_arrState[8];
+			unsigned char m_arrBuffer[BLOCK_SIZE];
+			size_t m_nBuffered{ 0 };
+			unsigned long long m_ullLength{ 0 };
+		};
+
+		void Hash(const void* pData, size_t nLength, unsigned char (&arrDigest)[DIGEST_SIZE]);
+		void Hmac(const void* pKey, size_t nKeyLength, const void* pData, size_t nLength, unsigned char (&arrDigest)[DIGEST_SIZE]);
+		// Compares in a time that does not depend on where the inputs differ.
+		bool ConstantTimeEqual(const unsigned char* pLeft, const unsigned char* pRight, size_t nLength);
+	}
+}
@@ -0,0 +1,310 @@
+#include "Trace.h"
+#include "Config.h"
+#include "PublicDef.h"
+#include "../Message/JsonWriter.h"
+#include "../Message/Message.h"
+#include <chrono>
+#include <fstream>
+
+namespace MCP
+{
+	static std::atomic_bool s_bDumpRequested{ false };
+	static thread_local unsigned long t_ulCurrentId = 0;
+
+	static const std::chrono::steady_clock::time_point& TraceBase()
+	{
+		static const auto s_tpBase = std::chrono::steady_clock::now();
+		return s_tpBase;
+	}
+
+	// Hands the ring back when its thread exits.
+	struct ThreadRingHolder
+	{
+		std::shared_ptr<void> spOwner;
+		std::atomic_bool* pbInUse{ nullptr };
+		void* pRing{ nullptr };
+
+		~ThreadRingHolder()
+		{
+			if (pbInUse)
+				pbInUse->store(false, std::memory_order_release);
+		}
+	};
+	static thread_local ThreadRingHolder t_ringHolder;
+
+	CMCPTrace::Ring::Ring(size_t nCapacity)
+		: upSlots(new Slot[nCapacity])
+		, nMask(nCapacity - 1)
+	{
+	}
+
+	CMCPTrace& CMCPTrace::GetInstance()
+	{
+		static CMCPTrace s_instance;
+		return s_instance;
+	}
+
+	CMCPTrace::~CMCPTrace()
+	{
+		Stop();
+	}
+
+	int CMCPTrace::Start()
+	{
+		auto& config = Config::GetInstance();
+		int iBufferSpans = config.GetTraceBufferSpans();
+		size_t nCapacity = 1;
+		while (nCapacity < static_cast<size_t>(iBufferSpans > 0 ? iBufferSpans : 1))
+			nCapacity <<= 1;
+		{
+			std::lock_guard<std::mutex> _lock(m_mtxRings);
+			m_nRingCapacity = nCapacity;
+		}
+		TraceBase();
+
+		std::lock_guard<std::mutex> _lock(m_mtxDump);
+		m_strDumpFile = config.GetTraceDumpFile();
+		SetEnabled(config.GetTraceEnabled());
+		if (!m_bDumpRunning && !m_strDumpFile.empty())
+		{
+			m_bDumpRunning = true;
+			m_thrDump = std::thread(&CMCPTrace::DumpProc, this);
+		}
+
+		return ERRNO_OK;
+	}
+
+	void CMCPTrace::Stop()
+	{
+		{
+			std::lock_guard<std::mutex> _lock(m_mtxDump);
+			if (!m_bDumpRunning)
+				return;
+			m_bDumpRunning = false;
+		}
+		m_cvDump.notify_all();
+		if (m_thrDump.joinable())
+			m_thrDump.join();
+	}
+
+	void CMCPTrace::SetEnabled(bool bEnabled)
+	{
+		m_bEnabled.store(bEnabled, std::memory_order_relaxed);
+	}
+
+	CMCPTrace::Ring* CMCPTrace::GetThreadRing()
+	{
+		if (t_ringHolder.pRing)
+			return static_cast<Ring*>(t_ringHolder.pRing);
+
+		std::lock_guard<std::mutex> _lock(m_mtxRings);
+		std::shared_ptr<Ring> spRing;
+		for (auto& spCandidate : m_vecRings)
+		{
+			bool bInUse = false;
+			if (spCandidate->nMask + 1 == m_nRingCapacity && spCandidate->bInUse.compare_exchange_strong(bInUse, true))
+			{
+				spRing = spCandidate;
+				break;
+			}
+		}
+		if (!spRing)
+		{
+			spRing = std::make_shared<Ring>(m_nRingCapacity);
+			spRing->bInUse = true;
+			m_vecRings.push_back(spRing);
+		}
+		// Spans keep the thread they were recorded by, so a reused ring tells both threads apart.
+		spRing->ullThread = m_ullNextThread++;
+		t_ringHolder.spOwner = spRing;
+		t_ringHolder.pbInUse = &spRing->bInUse;
+		t_ringHolder.pRing = spRing.get();
+
+		return spRing.get();
+	}
+
+	void CMCPTrace::Record(const char* lpcszName, unsigned long long ullBeginUs, unsigned long long ullEndUs)
+	{
+		if (!IsEnabled() || !lpcszName)
+			return;
+
+		Ring* pRing = GetThreadRing();
+		auto ullIndex = pRing->ullHead.load(std::memory_order_relaxed);
+		Slot& slot = pRing->upSlots[ullIndex & pRing->nMask];
+		slot.ullSequence.store(2 * ullIndex + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		slot.lpcszName.store(lpcszName, std::memory_order_relaxed);
+		slot.ulRuntimeId.store(t_ulCurrentId, std::memory_order_relaxed);
+		slot.ullThread.store(pRing->ullThread, std::memory_order_relaxed);
+		slot.ullBeginUs.store(ullBeginUs, std::memory_order_relaxed);
+		slot.ullDurationUs.store(ullEndUs > ullBeginUs ? ullEndUs - ullBeginUs : 0, std::memory_order_relaxed);
+		slot.ullSequence.store(2 * ullIndex + 2, std::memory_order_release);
+		pRing->ullHead.store(ullIndex + 1, std::memory_order_release);
+	}
+
+	std::string CMCPTrace::DumpChromeTrace() const
+	{
+		std::vector<std::shared_ptr<Ring>> vecRings;
+		{
+			std::lock_guard<std::mutex> _lock(m_mtxRings);
+			vecRings = m_vecRings;
+		}
+
+		std::string strTrace;
+		CMCPJsonWriter writer(strTrace);
+		writer.StartObject();
+		writer.Key("displayTimeUnit");
+		writer.String("ms");
+		// Relates ts to Message::ullTimestamp, i.e. to the records of the message history.
+		writer.Key("otherData");
+		writer.StartObject();
+		writer.Key("baseTimestampMs");
+		auto ullElapsedMs = NowUs() / 1000;
+		auto ullNowMs = Message::NowMs();
+		writer.UInt(ullNowMs > ullElapsedMs ? ullNowMs - ullElapsedMs : 0);
+		writer.EndObject();
+		writer.Key("traceEvents");
+		writer.StartArray();
+		for (auto& spRing : vecRings)
+		{
+			auto ullHead = spRing->ullHead.load(std::memory_order_acquire);
+			auto ullCapacity = static_cast<unsigned long long>(spRing->nMask) + 1;
+			for (auto ullIndex = ullHead > ullCapacity ? ullHead - ullCapacity : 0; ullIndex < ullHead; ++ullIndex)
+			{
+				const Slot& slot = spRing->upSlots[ullIndex & spRing->nMask];
+				auto ullSequence = slot.ullSequence.load(std::memory_order_acquire);
+				if (ullSequence != 2 * ullIndex + 2)
+					continue;
+				const char* lpcszName = slot.lpcszName.load(std::memory_order_relaxed);
+				auto ulRuntimeId = slot.ulRuntimeId.load(std::memory_order_relaxed);
+				auto ullThread = slot.ullThread.load(std::memory_order_relaxed);
+				auto ullBeginUs = slot.ullBeginUs.load(std::memory_order_relaxed);
+				auto ullDurationUs = slot.ullDurationUs.load(std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_acquire);
+				// Overwritten by the recording thread meanwhile.
+				if (slot.ullSequence.load(std::memory_order_relaxed) != ullSequence)
+					continue;
+
+				writer.StartObject();
+				writer.Key("name");
+				writer.String(lpcszName);
+				writer.Key("ph");
+				writer.String("X");
+				writer.Key("pid");
+				writer.UInt(1);
+				writer.Key("tid");
+				writer.UInt(ullThread);
+				writer.Key("ts");
+				writer.UInt(ullBeginUs);
+				writer.Key("dur");
+				writer.UInt(ullDurationUs);
+				if (0 != ulRuntimeId)
+				{
+					writer.Key("args");
+					writer.StartObject();
+					writer.Key("runtimeId");
+					writer.UInt(ulRuntimeId);
+					writer.EndObject();
+				}
+				writer.EndObject();
+			}
+		}
+		writer.EndArray();
+		writer.EndObject();
+		strTrace.push_back('\n');
+
+		return strTrace;
+	}
+
+	int CMCPTrace::DumpToFile(const std::string& strPath) const
+	{
+		std::string strTrace = DumpChromeTrace();
+		std::ofstream file(strPath, std::ios::binary | std::ios::trunc);
+		if (!file)
+			return ERRNO_INTERNAL_ERROR;
+		file.write(strTrace.data(), static_cast<std::streamsize>(strTrace.size()));
+
+		return file ? ERRNO_OK : ERRNO_INTERNAL_ERROR;
+	}
+
+	void CMCPTrace::RequestDump()
+	{
+		s_bDumpRequested.store(true);
+	}
+
+	void CMCPTrace::DumpProc()
+	{
+		// A signal handler can only set the flag, so it is polled.
+		std::unique_lock<std::mutex> _lock(m_mtxDump);
+		while (m_bDumpRunning)
+		{
+			m_cvDump.wait_for(_lock, std::chrono::milliseconds(100));
+			if (!s_bDumpRequested.exchange(false))
+				continue;
+			std::string strPath = m_strDumpFile;
+			_lock.unlock();
+			DumpToFile(strPath);
+			_lock.lock();
+		}
+	}
+
+	unsigned long long CMCPTrace::NowUs()
+	{
+		return static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::steady_clock::now() - TraceBase()).count());
+	}
+
+	void CMCPTrace::SetCurrentId(unsigned long ulRuntimeId)
+	{
+		t_ulCurrentId = ulRuntimeId;
+	}
+
+	unsigned long CMCPTrace::GetCurrentId()
+	{
+		return t_ulCurrentId;
+	}
+
+	const char* CMCPTrace::Intern(const std::string& strName)
+	{
+		// Most threads only ever trace a handful of names.
+		static thread_local std::unordered_map<std::string, const char*> t_hashNames;
+		auto itrName = t_hashNames.find(strName);
+		if (itrName != t_hashNames.end())
+			return itrName->second;
+
+		const char* lpcszName = nullptr;
+		{
+			std::lock_guard<std::mutex> _lock(m_mtxNames);
+			auto& upName = m_hashNames[strName];
+			if (!upName)
+				upName.reset(new std::string(strName));
+			lpcszName = upName->c_str();
+		}
+		t_hashNames.emplace(strName, lpcszName);
+
+		return lpcszName;
+	}
+
+	CMCPTraceScope::CMCPTraceScope(const char* lpcszName)
+	{
+		if (!CMCPTrace::GetInstance().IsEnabled())
+			return;
+		m_lpcszName = lpcszName;
+		m_ullBeginUs = CMCPTrace::NowUs();
+	}
+
+	CMCPTraceScope::CMCPTraceScope(const std::string& strName)
+	{
+		auto& trace = CMCPTrace::GetInstance();
+		if (!trace.IsEnabled())
+			return;
+		m_lpcszName = trace.Intern(strName);
+		m_ullBeginUs = CMCPTrace::NowUs();
+	}
+
+	CMCPTraceScope::~CMCPTraceScope()
+	{
+		if (m_lpcszName)
+			CMCPTrace::GetInstance().Record(m_lpcszName, m_ullBeginUs, CMCPTrace::NowUs());
+	}
+}
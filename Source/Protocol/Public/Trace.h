@@ -0,0 +1,129 @@
+#pragma once
+// To ensure good cross-platform compatibility, the MCP namespace code uses standard C++ only.
+// Avoid using platform-specific system APIs unless absolutely necessary.
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Spans are only recorded in builds with TINYMCP_WITH_TRACING; otherwise the macros compile to
+// nothing. Even then nothing is recorded unless [trace] enabled=1.
+#ifdef TINYMCP_WITH_TRACING
+#define MCP_TRACE_CONCAT_INNER(a, b) a##b
+#define MCP_TRACE_CONCAT(a, b) MCP_TRACE_CONCAT_INNER(a, b)
+// Records the enclosing scope as a span; lpcszName must be a literal, or a std::string (interned).
+#define MCP_TRACE_SCOPE(name) MCP::CMCPTraceScope MCP_TRACE_CONCAT(_traceScope, __LINE__)(name)
+// Records a span that ended now and began at ullBeginUs (CMCPTrace::NowUs()).
+#define MCP_TRACE_SPAN(name, ullBeginUs) MCP::CMCPTrace::GetInstance().Record(name, ullBeginUs, MCP::CMCPTrace::NowUs())
+// The runtime id (Message::ulRuntimeId) of the message the calling thread works on from here on.
+#define MCP_TRACE_SET_ID(ulRuntimeId) MCP::CMCPTrace::SetCurrentId(ulRuntimeId)
+#else
+#define MCP_TRACE_SCOPE(name) ((void)0)
+#define MCP_TRACE_SPAN(name, ullBeginUs) ((void)0)
+#define MCP_TRACE_SET_ID(ulRuntimeId) ((void)0)
+#endif
+
+namespace MCP
+{
+	// Request tracing: every thread records spans into a ring buffer of its own, overwriting the
+	// oldest ones, without locks. A span carries the runtime id of the message it belongs to, so the
+	// spans of one request line up across the session thread and the task workers.
+	//
+	// The buffers are dumped in the Chrome trace event format (chrome://tracing, ui.perfetto.dev):
+	// by DumpChromeTrace(), or into [trace] dump_file after RequestDump(), which may be called from a
+	// signal handler.
+	class CMCPTrace
+	{
+	public:
+		static CMCPTrace& GetInstance();
+
+		// Applies [trace] and starts the thread answering RequestDump().
+		int Start();
+		void Stop();
+
+		bool IsEnabled() const { return m_bEnabled.load(std::memory_order_relaxed); }
+		void SetEnabled(bool bEnabled);
+
+		void Record(const char* lpcszName, unsigned long long ullBeginUs, unsigned long long ullEndUs);
+		// The spans currently buffered, oldest first per thread.
+		std::string DumpChromeTrace() const;
+		int DumpToFile(const std::string& strPath) const;
+		// Async signal safe: asks for a dump into [trace] dump_file.
+		static void RequestDump();
+
+		// Microseconds of the steady clock since the trace started.
+		static unsigned long long NowUs();
+		static void SetCurrentId(unsigned long ulRuntimeId);
+		static unsigned long GetCurrentId();
+		// A name of static duration equal to strName, for span names that are not literals.
+		const char* Intern(const std::string& strName);
+
+	private:
+		struct Slot
+		{
+			// Odd while the slot is being written, 2 * (index + 1) once span index is complete.
+			std::atomic<unsigned long long> ullSequence{ 0 };
+			std::atomic<const char*> lpcszName{ nullptr };
+			std::atomic<unsigned long> ulRuntimeId{ 0 };
+			std::atomic<unsigned long long> ullThread{ 0 };
+			std::atomic<unsigned long long> ullBeginUs{ 0 };
+			std::atomic<unsigned long long> ullDurationUs{ 0 };
+		};
+
+		struct Ring
+		{
+			explicit Ring(size_t nCapacity);
+
+			std::unique_ptr<Slot[]> upSlots;
+			size_t nMask{ 0 };
+			std::atomic<unsigned long long> ullHead{ 0 };
+			// Owned by a live thread; a ring whose thread exited is handed to the next new thread.
+			std::atomic_bool bInUse{ false };
+			unsigned long long ullThread{ 0 };
+		};
+
+		CMCPTrace() = default;
+		~CMCPTrace();
+		CMCPTrace(const CMCPTrace&) = delete;
+		CMCPTrace& operator=(const CMCPTrace&) = delete;
+
+		Ring* GetThreadRing();
+		void DumpProc();
+
+		std::atomic_bool m_bEnabled{ false };
+		size_t m_nRingCapacity{ 8192 };
+		std::string m_strDumpFile;
+
+		mutable std::mutex m_mtxRings;
+		std::vector<std::shared_ptr<Ring>> m_vecRings;
+		unsigned long long m_ullNextThread{ 1 };
+
+		std::mutex m_mtxNames;
+		std::unordered_map<std::string, std::unique_ptr<std::string>> m_hashNames;
+
+		std::mutex m_mtxDump;
+		std::condition_variable m_cvDump;
+		bool m_bDumpRunning{ false };
+		std::thread m_thrDump;
+	};
+
+	// Records its lifetime as a span named lpcszName, with the current runtime id of the thread.
+	class CMCPTraceScope
+	{
+	public:
+		explicit CMCPTraceScope(const char* lpcszName);
+		explicit CMCPTraceScope(const std::string& strName);
+		~CMCPTraceScope();
+		CMCPTraceScope(const CMCPTraceScope&) = delete;
+		CMCPTraceScope& operator=(const CMCPTraceScope&) = delete;
+
+	private:
+		const char* m_lpcszName{ nullptr };
+		unsigned long long m_ullBeginUs{ 0 };
+	};
+}
@@ -0,0 +1,46 @@
+#include "BatchResponse.h"
+
+namespace MCP
+{
+	CMCPBatchResponse::CMCPBatchResponse(size_t nRequests)
+		: m_nPending(nRequests)
+	{
+	}
+
+	bool CMCPBatchResponse::Add(const std::string& strResponse, std::string& strBatch)
+	{
+		// Responses end with the newline delimiting messages, which has no place inside the array.
+		size_t nLength = strResponse.size();
+		while (nLength > 0 && ('\n' == strResponse[nLength - 1] || '\r' == strResponse[nLength - 1]))
+			--nLength;
+
+		std::lock_guard<std::mutex> _lock(m_mtxResponses);
+		if (0 == m_nPending)
+			return false;
+		m_strBatch.push_back(m_strBatch.empty() ? '[' : ',');
+		m_strBatch.append(strResponse, 0, nLength);
+
+		return Settle(strBatch);
+	}
+
+	bool CMCPBatchResponse::Drop(std::string& strBatch)
+	{
+		std::lock_guard<std::mutex> _lock(m_mtxResponses);
+		if (0 == m_nPending)
+			return false;
+
+		return Settle(strBatch);
+	}
+
+	bool CMCPBatchResponse::Settle(std::string& strBatch)
+	{
+		if (--m_nPending > 0)
+			return false;
+
+		if (!m_strBatch.empty())
+			m_strBatch.push_back(']');
+		strBatch.swap(m_strBatch);
+
+		return true;
+	}
+}
@@ -0,0 +1,33 @@
+#pragma once
+// To ensure good cross-platform compatibility, the MCP namespace code uses standard C++ only.
+// Avoid using platform-specific system APIs unless absolutely necessary.
+
+#include <mutex>
+#include <string>
+
+namespace MCP
+{
+	// The responses to the requests of one JSON-RPC batch, collected into the array that answers
+	// the batch. The array is complete once every request has been answered or dropped; requests
+	// that are not answered (cancelled ones) leave no element, and a batch without any response is
+	// not answered at all.
+	class CMCPBatchResponse
+	{
+	public:
+		explicit CMCPBatchResponse(size_t nRequests);
+		CMCPBatchResponse(const CMCPBatchResponse&) = delete;
+		CMCPBatchResponse& operator=(const CMCPBatchResponse&) = delete;
+
+		// Both return true for the call settling the last request; strBatch then holds the array,
+		// or nothing if no request was answered.
+		bool Add(const std::string& strResponse, std::string& strBatch);
+		bool Drop(std::string& strBatch);
+
+	private:
+		bool Settle(std::string& strBatch);
+
+		std::mutex m_mtxResponses;
+		size_t m_nPending{ 0 };
+		std::string m_strBatch;
+	};
+}
@@ -0,0 +1,66 @@
+#include "ClientLogSink.h"
+#include "Session.h"
+
+namespace MCP
+{
+	void CMCPClientLogSink::SetLevel(const std::shared_ptr<CMCPSession>& spSession, LogLevel eLevel)
+	{
+		if (!spSession)
+			return;
+
+		{
+			std::lock_guard<std::mutex> _lock(m_mtxClients);
+			auto& client = m_hashClients[spSession.get()];
+			client.wpSession = spSession;
+			client.eLevel = eLevel;
+		}
+		CMCPLogger::GetInstance().RefreshLevel();
+	}
+
+	void CMCPClientLogSink::RemoveSession(const CMCPSession* pSession)
+	{
+		{
+			std::lock_guard<std::mutex> _lock(m_mtxClients);
+			if (0 == m_hashClients.erase(pSession))
+				return;
+		}
+		CMCPLogger::GetInstance().RefreshLevel();
+	}
+
+	LogLevel CMCPClientLogSink::GetLevel() const
+	{
+		std::lock_guard<std::mutex> _lock(m_mtxClients);
+		LogLevel eMinLevel = LogLevel_Off;
+		for (auto& itrClient : m_hashClients)
+		{
+			if (itrClient.second.eLevel < eMinLevel)
+				eMinLevel = itrClient.second.eLevel;
+		}
+
+		return eMinLevel;
+	}
+
+	void CMCPClientLogSink::Write(const std::vector<LogRecord>& vecRecords)
+	{
+		std::vector<std::pair<std::shared_ptr<CMCPSession>, LogLevel>> vecClients;
+		{
+			std::lock_guard<std::mutex> _lock(m_mtxClients);
+			for (auto& itrClient : m_hashClients)
+			{
+				auto spSession = itrClient.second.wpSession.lock();
+				if (spSession)
+					vecClients.emplace_back(spSession, itrClient.second.eLevel);
+			}
+		}
+
+		// Written outside the lock: a session may block on its transport.
+		for (auto& itrClient : vecClients)
+		{
+			for (auto& record : vecRecords)
+			{
+				if (record.eLevel >= itrClient.second)
+					itrClient.first->SendLogMessage(record);
+			}
+		}
+	}
+}
@@ -0,0 +1,36 @@
+#pragma once
+// To ensure good cross-platform compatibility, the MCP namespace code uses standard C++ only.
+// Avoid using platform-specific system APIs unless absolutely necessary.
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include "../Public/Logger.h"
+
+namespace MCP
+{
+	class CMCPSession;
+
+	// Sends the log records to the clients as notifications/message, each at the level it asked for
+	// with logging/setLevel. Clients that never asked get nothing.
+	class CMCPClientLogSink : public CMCPLogSink
+	{
+	public:
+		void SetLevel(const std::shared_ptr<CMCPSession>& spSession, LogLevel eLevel);
+		void RemoveSession(const CMCPSession* pSession);
+
+		// The least severe level any client asked for.
+		LogLevel GetLevel() const override;
+		void Write(const std::vector<LogRecord>& vecRecords) override;
+
+	private:
+		struct Client
+		{
+			std::weak_ptr<CMCPSession> wpSession;
+			LogLevel eLevel{ LogLevel_Off };
+		};
+
+		mutable std::mutex m_mtxClients;
+		std::unordered_map<const CMCPSession*, Client> m_hashClients;
+	};
+}
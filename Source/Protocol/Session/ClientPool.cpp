@@ -0,0 +1,385 @@
+#include "ClientPool.h"
+#include "ToolResultCache.h"
+#include "../Message/JsonWriter.h"
+#include "../Transport/Transport.h"
+#include <algorithm>
+
+namespace MCP
+{
+	CMCPClientPool::CMCPClientPool(const ClientPoolOptions& options)
+		: m_options(options)
+	{
+		if (0 == m_options.nSessionsPerBackend)
+			m_options.nSessionsPerBackend = 1;
+		if (0 == m_options.nMaxAttempts)
+			m_options.nMaxAttempts = 1;
+		if (0 == m_options.nVirtualNodes)
+			m_options.nVirtualNodes = 1;
+	}
+
+	CMCPClientPool::~CMCPClientPool()
+	{
+		Stop();
+	}
+
+	int CMCPClientPool::AddBackend(const std::string& strName, TransportFactory fnConnect)
+	{
+		if (m_bRunning || !fnConnect)
+			return ERRNO_INTERNAL_ERROR;
+		for (auto& spBackend : m_vecBackends)
+		{
+			if (spBackend->strName == strName)
+				return ERRNO_INVALID_PARAMS;
+		}
+
+		size_t nBackend = m_vecBackends.size();
+		std::unique_ptr<Backend> spBackend(new Backend());
+		spBackend->strName = strName;
+		spBackend->fnConnect = std::move(fnConnect);
+		m_vecBackends.push_back(std::move(spBackend));
+
+		for (unsigned int i = 0; i < m_options.nVirtualNodes; ++i)
+		{
+			m_vecRing.emplace_back(Hash(strName + "#" + std::to_string(i)), nBackend);
+		}
+		std::sort(m_vecRing.begin(), m_vecRing.end());
+
+		return ERRNO_OK;
+	}
+
+	int CMCPClientPool::Start()
+	{
+		if (m_vecBackends.empty())
+			return ERRNO_INTERNAL_ERROR;
+		if (m_bRunning.exchange(true))
+			return ERRNO_OK;
+
+		for (auto& spBackend : m_vecBackends)
+		{
+			spBackend->vecSessions.resize(m_options.nSessionsPerBackend);
+			CheckBackend(*spBackend);
+		}
+		m_thrHealth = std::thread(&CMCPClientPool::HealthThreadProc, this);
+
+		return GetHealthyBackendCount() > 0 ? ERRNO_OK : ERRNO_INTERNAL_ERROR;
+	}
+
+	int CMCPClientPool::Stop()
+	{
+		{
+			std::unique_lock<std::mutex> _lock(m_mtxHealth);
+			if (!m_bRunning.exchange(false))
+				return ERRNO_OK;
+		}
+		m_cvHealth.notify_all();
+		if (m_thrHealth.joinable())
+			m_thrHealth.join();
+
+		// The calls in flight are answered without being retried.
+		for (auto& spBackend : m_vecBackends)
+		{
+			std::vector<std::shared_ptr<CMCPClientSession>> vecSessions;
+			{
+				std::unique_lock<std::mutex> _lock(spBackend->mtxSessions);
+				vecSessions.swap(spBackend->vecSessions);
+			}
+			for (auto& spSession : vecSessions)
+			{
+				if (spSession)
+					spSession->Stop();
+			}
+			spBackend->bHealthy = false;
+		}
+
+		return ERRNO_OK;
+	}
+
+	int CMCPClientPool::CallTool(const std::string& strTool, const Json::Value& jArguments, bool bIdempotent,
+		unsigned int nTimeoutMs, CMCPClientSession::ResponseCallback fnOnResponse)
+	{
+		if (!fnOnResponse)
+			return ERRNO_INVALID_PARAMS;
+		if (!m_bRunning)
+			return ERRNO_INTERNAL_ERROR;
+
+		auto spCall = std::make_shared<PooledCall>();
+		spCall->strMethod = METHOD_TOOLS_CALL;
+		CMCPJsonWriter writer(spCall->strParams);
+		writer.StartObject();
+		writer.Key(MSG_KEY_NAME);
+		writer.String(strTool);
+		writer.Key(MSG_KEY_ARGUMENTS);
+		writer.Value(jArguments);
+		writer.EndObject();
+		if (ClientPoolRouting_ConsistentHash == m_options.eRouting)
+		{
+			// The key of the tool result cache: calls the server could answer from it meet there.
+			spCall->bHashed = true;
+			spCall->ullHash = Hash(CMCPToolResultCache::MakeKey(strTool, jArguments));
+		}
+		spCall->bIdempotent = bIdempotent;
+		spCall->nTimeoutMs = nTimeoutMs;
+		spCall->fnOnResponse = std::move(fnOnResponse);
+		Dispatch(spCall);
+
+		return ERRNO_OK;
+	}
+
+	std::future<ClientResponse> CMCPClientPool::CallTool(const std::string& strTool, const Json::Value& jArguments,
+		bool bIdempotent, unsigned int nTimeoutMs)
+	{
+		auto spPromise = std::make_shared<std::promise<ClientResponse>>();
+		auto future = spPromise->get_future();
+		int iErrCode = CallTool(strTool, jArguments, bIdempotent, nTimeoutMs,
+			[spPromise](ClientResponse&& response) { spPromise->set_value(std::move(response)); });
+		if (ERRNO_OK != iErrCode)
+		{
+			ClientResponse response;
+			response.iErrCode = iErrCode;
+			spPromise->set_value(std::move(response));
+		}
+
+		return future;
+	}
+
+	int CMCPClientPool::SendRequest(const char* lpcszMethod, const std::string& strParams, bool bIdempotent,
+		unsigned int nTimeoutMs, CMCPClientSession::ResponseCallback fnOnResponse)
+	{
+		if (!lpcszMethod || !fnOnResponse)
+			return ERRNO_INVALID_PARAMS;
+		if (!m_bRunning)
+			return ERRNO_INTERNAL_ERROR;
+
+		auto spCall = std::make_shared<PooledCall>();
+		spCall->strMethod = lpcszMethod;
+		spCall->strParams = strParams;
+		spCall->bIdempotent = bIdempotent;
+		spCall->nTimeoutMs = nTimeoutMs;
+		spCall->fnOnResponse = std::move(fnOnResponse);
+		Dispatch(spCall);
+
+		return ERRNO_OK;
+	}
+
+	size_t CMCPClientPool::GetHealthyBackendCount() const
+	{
+		size_t nHealthy = 0;
+		for (auto& spBackend : m_vecBackends)
+		{
+			if (spBackend->bHealthy)
+				++nHealthy;
+		}
+
+		return nHealthy;
+	}
+
+	void CMCPClientPool::Dispatch(const std::shared_ptr<PooledCall>& spCall)
+	{
+		int iErrCode = ERRNO_INTERNAL_INPUT_TERMINATE;
+		size_t nBackend = 0;
+		while (m_bRunning && spCall->vecTried.size() < m_options.nMaxAttempts && PickBackend(*spCall, nBackend))
+		{
+			spCall->vecTried.push_back(nBackend);
+			auto& backend = *m_vecBackends[nBackend];
+			auto spSession = PickSession(backend);
+			if (!spSession)
+				continue;
+
+			++backend.nOutstanding;
+			iErrCode = spSession->SendRequest(spCall->strMethod.c_str(), spCall->strParams, spCall->nTimeoutMs,
+				[this, spCall, nBackend](ClientResponse&& response)
+				{
+					--m_vecBackends[nBackend]->nOutstanding;
+					if (IsRetryable(response.iErrCode, spCall->bIdempotent) && m_bRunning
+						&& spCall->vecTried.size() < m_options.nMaxAttempts)
+					{
+						Dispatch(spCall);
+						return;
+					}
+					spCall->fnOnResponse(std::move(response));
+				});
+			if (ERRNO_OK == iErrCode)
+				return;
+			// Not written: safe to send elsewhere whatever the call.
+			--backend.nOutstanding;
+		}
+
+		ClientResponse response;
+		response.iErrCode = iErrCode;
+		response.strMessage = "no backend available";
+		spCall->fnOnResponse(std::move(response));
+	}
+
+	bool CMCPClientPool::PickBackend(const PooledCall& call, size_t& nBackend) const
+	{
+		auto fnCandidate = [&](size_t nIndex)
+		{
+			return m_vecBackends[nIndex]->bHealthy
+				&& std::find(call.vecTried.begin(), call.vecTried.end(), nIndex) == call.vecTried.end();
+		};
+
+		if (call.bHashed && !m_vecRing.empty())
+		{
+			// The owner of the key, or the next backend clockwise when it is down or was tried.
+			auto itrPoint = std::lower_bound(m_vecRing.begin(), m_vecRing.end(),
+				std::make_pair(call.ullHash, static_cast<size_t>(0)));
+			for (size_t i = 0; i < m_vecRing.size(); ++i, ++itrPoint)
+			{
+				if (itrPoint == m_vecRing.end())
+					itrPoint = m_vecRing.begin();
+				if (fnCandidate(itrPoint->second))
+				{
+					nBackend = itrPoint->second;
+					return true;
+				}
+			}
+			return false;
+		}
+
+		// Ties go round robin, so that an idle fleet is not served by the first backend alone.
+		size_t nCount = m_vecBackends.size();
+		size_t nStart = m_nNextBackend++ % nCount;
+		bool bFound = false;
+		size_t nLeast = 0;
+		for (size_t i = 0; i < nCount; ++i)
+		{
+			size_t nIndex = (nStart + i) % nCount;
+			if (!fnCandidate(nIndex))
+				continue;
+			size_t nOutstanding = m_vecBackends[nIndex]->nOutstanding;
+			if (!bFound || nOutstanding < nLeast)
+			{
+				bFound = true;
+				nLeast = nOutstanding;
+				nBackend = nIndex;
+			}
+		}
+
+		return bFound;
+	}
+
+	std::shared_ptr<CMCPClientSession> CMCPClientPool::PickSession(Backend& backend)
+	{
+		std::unique_lock<std::mutex> _lock(backend.mtxSessions);
+		size_t nCount = backend.vecSessions.size();
+		unsigned int nStart = backend.nNextSession++;
+		for (size_t i = 0; i < nCount; ++i)
+		{
+			auto& spSession = backend.vecSessions[(nStart + i) % nCount];
+			if (spSession && !spSession->IsClosed())
+				return spSession;
+		}
+
+		return nullptr;
+	}
+
+	std::shared_ptr<CMCPClientSession> CMCPClientPool::Connect(Backend& backend) const
+	{
+		auto spTransport = backend.fnConnect();
+		if (!spTransport)
+			return nullptr;
+
+		auto spSession = std::make_shared<CMCPClientSession>(spTransport);
+		Json::Value jResult;
+		if (ERRNO_OK != spSession->Start()
+			|| ERRNO_OK != spSession->Initialize(m_options.strClientName, m_options.strClientVersion,
+				m_options.nInitializeTimeoutMs, jResult))
+			return nullptr;
+
+		return spSession;
+	}
+
+	bool CMCPClientPool::IsRetryable(int iErrCode, bool bIdempotent)
+	{
+		// Refused before the tool ran.
+		if (ERRNO_SERVER_OVERLOADED == iErrCode || ERRNO_RATE_LIMITED == iErrCode)
+			return true;
+		// The server may or may not have run it.
+		return bIdempotent && ERRNO_INTERNAL_INPUT_TERMINATE == iErrCode;
+	}
+
+	unsigned long long CMCPClientPool::Hash(const std::string& strKey)
+	{
+		// FNV-1a, then the splitmix64 finalizer: the names of the virtual nodes differ in a few
+		// trailing bytes only, and must still spread over the whole ring.
+		unsigned long long ullHash = 14695981039346656037ULL;
+		for (auto ch : strKey)
+		{
+			ullHash ^= static_cast<unsigned char>(ch);
+			ullHash *= 1099511628211ULL;
+		}
+		ullHash ^= ullHash >> 30;
+		ullHash *= 0xbf58476d1ce4e5b9ULL;
+		ullHash ^= ullHash >> 27;
+		ullHash *= 0x94d049bb133111ebULL;
+		ullHash ^= ullHash >> 31;
+
+		return ullHash;
+	}
+
+	void CMCPClientPool::HealthThreadProc()
+	{
+		std::unique_lock<std::mutex> _lock(m_mtxHealth);
+		while (m_bRunning)
+		{
+			m_cvHealth.wait_for(_lock, std::chrono::milliseconds(m_options.nHealthIntervalMs));
+			if (!m_bRunning)
+				break;
+			_lock.unlock();
+			for (auto& spBackend : m_vecBackends)
+			{
+				CheckBackend(*spBackend);
+			}
+			_lock.lock();
+		}
+	}
+
+	void CMCPClientPool::CheckBackend(Backend& backend)
+	{
+		std::vector<size_t> vecClosed;
+		std::shared_ptr<CMCPClientSession> spProbe;
+		{
+			std::unique_lock<std::mutex> _lock(backend.mtxSessions);
+			for (size_t i = 0; i < backend.vecSessions.size(); ++i)
+			{
+				auto& spSession = backend.vecSessions[i];
+				if (!spSession || spSession->IsClosed())
+					vecClosed.push_back(i);
+				else if (!spProbe)
+					spProbe = spSession;
+			}
+		}
+
+		// Connected without holding the lock, calls keep going to the open sessions meanwhile.
+		std::vector<std::pair<size_t, std::shared_ptr<CMCPClientSession>>> vecConnected;
+		for (auto nIndex : vecClosed)
+		{
+			auto spSession = Connect(backend);
+			if (!spSession)
+				break;
+			vecConnected.emplace_back(nIndex, spSession);
+		}
+		std::vector<std::shared_ptr<CMCPClientSession>> vecReplaced;
+		{
+			std::unique_lock<std::mutex> _lock(backend.mtxSessions);
+			for (auto& connected : vecConnected)
+			{
+				vecReplaced.push_back(std::move(backend.vecSessions[connected.first]));
+				backend.vecSessions[connected.first] = connected.second;
+			}
+		}
+		// Released here rather than by whichever caller drops the last reference.
+		vecReplaced.clear();
+		if (!spProbe && !vecConnected.empty())
+			spProbe = vecConnected.front().second;
+
+		bool bAnswered = false;
+		if (spProbe)
+		{
+			ClientResponse response;
+			bAnswered = ERRNO_OK == spProbe->Call(METHOD_PING, "", m_options.nPingTimeoutMs, response);
+		}
+		backend.nFailedPings = bAnswered ? 0 : backend.nFailedPings + 1;
+		backend.bHealthy = bAnswered || (spProbe && backend.nFailedPings < m_options.nUnhealthyPings);
+	}
+}
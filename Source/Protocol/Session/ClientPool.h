@@ -0,0 +1,139 @@
+#pragma once
+// To ensure good cross-platform compatibility, the MCP namespace code uses standard C++ only.
+// Avoid using platform-specific system APIs unless absolutely necessary.
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <json/json.h>
+#include "ClientSession.h"
+
+namespace MCP
+{
+	class CMCPTransport;
+
+	enum ClientPoolRouting
+	{
+		// The backend with the fewest requests in flight from this pool.
+		ClientPoolRouting_LeastOutstanding,
+		// tools/call goes to the backend owning the cache key of the tool and its arguments on a hash
+		// ring, so identical calls meet the tool result cache of the same server; other requests are
+		// routed by least outstanding requests.
+		ClientPoolRouting_ConsistentHash,
+	};
+
+	struct ClientPoolOptions
+	{
+		std::string strClientName{ "TinyMCP" };
+		std::string strClientVersion{ "1.0.0" };
+		ClientPoolRouting eRouting{ ClientPoolRouting_LeastOutstanding };
+		// Client sessions, i.e. transports, kept open to every backend.
+		size_t nSessionsPerBackend{ 2 };
+		// Points of every backend on the hash ring.
+		unsigned int nVirtualNodes{ 64 };
+		unsigned int nInitializeTimeoutMs{ 5000 };
+		// Every backend is pinged this often; it is taken out of rotation after nUnhealthyPings
+		// failed pings in a row, and back in after the first one answered.
+		unsigned int nHealthIntervalMs{ 2000 };
+		unsigned int nPingTimeoutMs{ 1000 };
+		unsigned int nUnhealthyPings{ 2 };
+		// Backends a call is tried on at most.
+		unsigned int nMaxAttempts{ 2 };
+	};
+
+	// Client sessions to a fleet of identical servers. Every call is routed to one healthy backend
+	// and pipelined on one of its sessions, picked round robin; sessions whose server went away are
+	// reconnected by the health check.
+	//
+	// A call that was not written, or that the server refused as overloaded or rate limited before
+	// running it, is tried on another backend. Calls marked idempotent are also tried again when the
+	// connection is lost while they are in flight; timeouts are not retried, as the server may still
+	// be working on the call.
+	class CMCPClientPool
+	{
+	public:
+		// Returns a connected transport to the backend, or nullptr.
+		using TransportFactory = std::function<std::shared_ptr<CMCPTransport>()>;
+
+		explicit CMCPClientPool(const ClientPoolOptions& options);
+		~CMCPClientPool();
+		CMCPClientPool(const CMCPClientPool&) = delete;
+		CMCPClientPool& operator=(const CMCPClientPool&) = delete;
+
+		// Before Start(). strName identifies the backend on the hash ring and must be unique.
+		int AddBackend(const std::string& strName, TransportFactory fnConnect);
+
+		// Connects to every backend; fails when none could be reached, the health check keeps trying.
+		int Start();
+		int Stop();
+
+		int CallTool(const std::string& strTool, const Json::Value& jArguments, bool bIdempotent,
+			unsigned int nTimeoutMs, CMCPClientSession::ResponseCallback fnOnResponse);
+		std::future<ClientResponse> CallTool(const std::string& strTool, const Json::Value& jArguments,
+			bool bIdempotent, unsigned int nTimeoutMs);
+		// Any other request, routed by least outstanding requests.
+		int SendRequest(const char* lpcszMethod, const std::string& strParams, bool bIdempotent,
+			unsigned int nTimeoutMs, CMCPClientSession::ResponseCallback fnOnResponse);
+
+		size_t GetHealthyBackendCount() const;
+
+	private:
+		struct Backend
+		{
+			std::string strName;
+			TransportFactory fnConnect;
+
+			std::mutex mtxSessions;
+			std::vector<std::shared_ptr<CMCPClientSession>> vecSessions;
+			std::atomic<unsigned int> nNextSession{ 0 };
+			std::atomic<size_t> nOutstanding{ 0 };
+			std::atomic<bool> bHealthy{ false };
+			// Health thread only.
+			unsigned int nFailedPings{ 0 };
+		};
+
+		// One call of the caller, over all its attempts.
+		struct PooledCall
+		{
+			std::string strMethod;
+			std::string strParams;
+			bool bHashed{ false };
+			unsigned long long ullHash{ 0 };
+			bool bIdempotent{ false };
+			unsigned int nTimeoutMs{ 0 };
+			CMCPClientSession::ResponseCallback fnOnResponse;
+			std::vector<size_t> vecTried;
+		};
+
+		// Sends the call to the next backend, or answers it when none is left.
+		void Dispatch(const std::shared_ptr<PooledCall>& spCall);
+		// The index of the backend to try next; false when every healthy one was tried.
+		bool PickBackend(const PooledCall& call, size_t& nBackend) const;
+		std::shared_ptr<CMCPClientSession> PickSession(Backend& backend);
+		std::shared_ptr<CMCPClientSession> Connect(Backend& backend) const;
+		static bool IsRetryable(int iErrCode, bool bIdempotent);
+		static unsigned long long Hash(const std::string& strKey);
+
+		void HealthThreadProc();
+		// Reconnects the closed sessions of the backend and pings it.
+		void CheckBackend(Backend& backend);
+
+		ClientPoolOptions m_options;
+		std::vector<std::unique_ptr<Backend>> m_vecBackends;
+		// Sorted points of the hash ring: hash, backend index.
+		std::vector<std::pair<unsigned long long, size_t>> m_vecRing;
+		std::atomic<bool> m_bRunning{ false };
+		mutable std::atomic<unsigned int> m_nNextBackend{ 0 };
+
+		std::mutex m_mtxHealth;
+		std::condition_variable m_cvHealth;
+		std::thread m_thrHealth;
+	};
+}
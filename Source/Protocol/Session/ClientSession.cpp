@@ -0,0 +1,402 @@
+#include "ClientSession.h"
+#include "../Message/JsonWriter.h"
+#include "../Transport/Transport.h"
+#include <cstring>
+#include <vector>
+
+namespace MCP
+{
+	CMCPClientSession::CMCPClientSession(std::shared_ptr<CMCPTransport> spTransport)
+		: m_spTransport(std::move(spTransport))
+	{
+
+	}
+
+	CMCPClientSession::~CMCPClientSession()
+	{
+		Stop();
+	}
+
+	void CMCPClientSession::SetNotificationHandler(NotificationHandler fnOnNotification)
+	{
+		m_fnOnNotification = std::move(fnOnNotification);
+	}
+
+	int CMCPClientSession::Start()
+	{
+		if (!m_spTransport)
+			return ERRNO_INTERNAL_ERROR;
+
+		int iErrCode = m_timer.Start();
+		if (ERRNO_OK != iErrCode)
+			return iErrCode;
+
+		m_bPushMode = m_spTransport->SetFrameHandler(
+			[this](const char* pBegin, const char* pEnd) { OnFrame(pBegin, pEnd); },
+			[this]() { OnClose(); });
+		if (!m_bPushMode)
+			m_thrReader = std::thread(&CMCPClientSession::ReadResponses, this);
+
+		return ERRNO_OK;
+	}
+
+	int CMCPClientSession::Stop()
+	{
+		if (m_spTransport)
+			m_spTransport->Disconnect();
+		if (m_thrReader.joinable())
+			m_thrReader.join();
+		// The reader answers what is in flight when it sees the end of the input; a push mode
+		// transport may not report it after Disconnect().
+		OnClose();
+		m_timer.Stop();
+
+		return ERRNO_OK;
+	}
+
+	int CMCPClientSession::Initialize(const std::string& strClientName, const std::string& strClientVersion,
+		unsigned int nTimeoutMs, Json::Value& jResult)
+	{
+		std::string strParams;
+		CMCPJsonWriter writer(strParams);
+		writer.StartObject();
+		writer.Key(MSG_KEY_PROTOCOL_VERSION);
+		writer.String(PROTOCOL_VER);
+		writer.Key(MSG_KEY_CAPABILITIES);
+		writer.StartObject();
+		writer.EndObject();
+		writer.Key(MSG_KEY_CLIENT_INFO);
+		writer.StartObject();
+		writer.Key(MSG_KEY_NAME);
+		writer.String(strClientName);
+		writer.Key(MSG_KEY_VERSION);
+		writer.String(strClientVersion);
+		writer.EndObject();
+		writer.EndObject();
+
+		ClientResponse response;
+		int iErrCode = Call(METHOD_INITIALIZE, strParams, nTimeoutMs, response);
+		if (ERRNO_OK != iErrCode)
+			return iErrCode;
+		jResult = std::move(response.jResult);
+
+		return Notify(METHOD_NOTIFICATION_INITIALIZED, "");
+	}
+
+	int CMCPClientSession::SendRequest(const char* lpcszMethod, const std::string& strParams, unsigned int nTimeoutMs,
+		ResponseCallback fnOnResponse, MCP::RequestId* pRequestId)
+	{
+		if (!lpcszMethod || !fnOnResponse)
+			return ERRNO_INVALID_PARAMS;
+
+		MCP::RequestId requestId;
+		requestId.eIdDataType = DataType_Integer;
+		requestId.iId = m_iNextId++;
+		std::string strRequest;
+		BuildMessage(&requestId, lpcszMethod, strParams, strRequest);
+
+		// Registered before it is written: the response may arrive before Write() returns.
+		{
+			std::unique_lock<std::mutex> _lock(m_mtxPending);
+			if (m_bClosed)
+				return ERRNO_INTERNAL_INPUT_TERMINATE;
+			auto& pending = m_hashPending[requestId];
+			pending.fnOnResponse = std::move(fnOnResponse);
+			if (nTimeoutMs > 0)
+			{
+				pending.bHasDeadline = true;
+				pending.itrDeadline = m_mapDeadlines.emplace(Clock::now() + std::chrono::milliseconds(nTimeoutMs), requestId);
+				ScheduleTimer();
+			}
+		}
+		if (pRequestId)
+			*pRequestId = requestId;
+
+		int iErrCode = m_spTransport->Write(strRequest);
+		if (ERRNO_OK != iErrCode)
+		{
+			// Not answered through the callback: the caller learns it from the return value, unless
+			// the end of the session answered it meanwhile.
+			ResponseCallback fnDropped;
+			if (TakePending(requestId, fnDropped))
+				return iErrCode;
+		}
+
+		return ERRNO_OK;
+	}
+
+	std::future<ClientResponse> CMCPClientSession::SendRequest(const char* lpcszMethod, const std::string& strParams,
+		unsigned int nTimeoutMs, MCP::RequestId* pRequestId)
+	{
+		auto spPromise = std::make_shared<std::promise<ClientResponse>>();
+		auto future = spPromise->get_future();
+		int iErrCode = SendRequest(lpcszMethod, strParams, nTimeoutMs,
+			[spPromise](ClientResponse&& response) { spPromise->set_value(std::move(response)); }, pRequestId);
+		if (ERRNO_OK != iErrCode)
+		{
+			ClientResponse response;
+			response.iErrCode = iErrCode;
+			spPromise->set_value(std::move(response));
+		}
+
+		return future;
+	}
+
+	int CMCPClientSession::Call(const char* lpcszMethod, const std::string& strParams, unsigned int nTimeoutMs, ClientResponse& response)
+	{
+		response = SendRequest(lpcszMethod, strParams, nTimeoutMs).get();
+
+		return response.iErrCode;
+	}
+
+	int CMCPClientSession::Cancel(const MCP::RequestId& requestId, const std::string& strReason)
+	{
+		ResponseCallback fnOnResponse;
+		if (!TakePending(requestId, fnOnResponse))
+			return ERRNO_INVALID_PARAMS;
+
+		int iErrCode = SendCancelled(requestId, strReason);
+		ClientResponse response;
+		response.iErrCode = ERRNO_REQUEST_CANCELLED;
+		response.strMessage = strReason;
+		fnOnResponse(std::move(response));
+
+		return iErrCode;
+	}
+
+	int CMCPClientSession::Notify(const char* lpcszMethod, const std::string& strParams)
+	{
+		if (!lpcszMethod)
+			return ERRNO_INVALID_PARAMS;
+
+		std::string strNotification;
+		BuildMessage(nullptr, lpcszMethod, strParams, strNotification);
+
+		return m_spTransport->Write(strNotification);
+	}
+
+	size_t CMCPClientSession::GetInFlightCount() const
+	{
+		std::unique_lock<std::mutex> _lock(m_mtxPending);
+		return m_hashPending.size();
+	}
+
+	bool CMCPClientSession::IsClosed() const
+	{
+		std::unique_lock<std::mutex> _lock(m_mtxPending);
+		return m_bClosed;
+	}
+
+	void CMCPClientSession::ReadResponses()
+	{
+		const char* pBegin = nullptr;
+		const char* pEnd = nullptr;
+		while (ERRNO_OK == m_spTransport->ReadFrame(pBegin, pEnd))
+		{
+			OnFrame(pBegin, pEnd);
+		}
+		OnClose();
+	}
+
+	void CMCPClientSession::OnFrame(const char* pBegin, const char* pEnd)
+	{
+		// Messages are handled one at a time, on the reader or the loop thread.
+		if (!m_parser.Parse(pBegin, pEnd, m_jMessage) || !m_jMessage.isObject())
+			return;
+
+		const Json::Value* pjMethod = m_jMessage.find(MSG_KEY_METHOD, MSG_KEY_METHOD + strlen(MSG_KEY_METHOD));
+		if (pjMethod && pjMethod->isString())
+		{
+			if (m_jMessage.isMember(MSG_KEY_ID))
+			{
+				AnswerServerRequest(m_jMessage);
+				return;
+			}
+			if (m_fnOnNotification)
+				m_fnOnNotification(pjMethod->asString(), m_jMessage[MSG_KEY_PARAMS]);
+			return;
+		}
+
+		MCP::RequestId requestId;
+		if (ERRNO_OK != requestId.DoDeserialize(m_jMessage))
+			return;
+		ResponseCallback fnOnResponse;
+		// Cancelled or timed out already.
+		if (!TakePending(requestId, fnOnResponse))
+			return;
+
+		ClientResponse response;
+		const Json::Value* pjError = m_jMessage.find(MSG_KEY_ERROR, MSG_KEY_ERROR + strlen(MSG_KEY_ERROR));
+		if (pjError)
+		{
+			const Json::Value& jCode = (*pjError)[MSG_KEY_CODE];
+			response.iErrCode = jCode.isInt() && ERRNO_OK != jCode.asInt() ? jCode.asInt() : ERRNO_INVALID_RESPONSE;
+			response.strMessage = (*pjError)[MSG_KEY_MESSAGE].asString();
+		}
+		else if (m_jMessage.isMember(MSG_KEY_RESULT))
+		{
+			response.jResult = std::move(m_jMessage[MSG_KEY_RESULT]);
+		}
+		else
+		{
+			response.iErrCode = ERRNO_INVALID_RESPONSE;
+		}
+		fnOnResponse(std::move(response));
+	}
+
+	void CMCPClientSession::OnClose()
+	{
+		std::unordered_map<MCP::RequestId, PendingRequest, MCP::RequestIdHash> hashPending;
+		{
+			std::unique_lock<std::mutex> _lock(m_mtxPending);
+			m_bClosed = true;
+			hashPending.swap(m_hashPending);
+			m_mapDeadlines.clear();
+		}
+
+		for (auto& pending : hashPending)
+		{
+			ClientResponse response;
+			response.iErrCode = ERRNO_INTERNAL_INPUT_TERMINATE;
+			pending.second.fnOnResponse(std::move(response));
+		}
+	}
+
+	void CMCPClientSession::AnswerServerRequest(const Json::Value& jMessage)
+	{
+		MCP::RequestId requestId;
+		if (ERRNO_OK != requestId.DoDeserialize(jMessage))
+			return;
+
+		std::string strResponse;
+		CMCPJsonWriter writer(strResponse);
+		writer.StartObject();
+		requestId.WriteMember(writer);
+		writer.Key(MSG_KEY_JSONRPC);
+		writer.String(JSON_RPC_VER);
+		if (jMessage[MSG_KEY_METHOD].asString() == METHOD_PING)
+		{
+			writer.Key(MSG_KEY_RESULT);
+			writer.StartObject();
+			writer.EndObject();
+		}
+		else
+		{
+			writer.Key(MSG_KEY_ERROR);
+			writer.StartObject();
+			writer.Key(MSG_KEY_CODE);
+			writer.Int(ERRNO_METHOD_NOT_FOUND);
+			writer.Key(MSG_KEY_MESSAGE);
+			writer.String(ERROR_MESSAGE_METHOD_NOT_FOUND);
+			writer.EndObject();
+		}
+		writer.EndObject();
+		m_spTransport->Write(strResponse);
+	}
+
+	bool CMCPClientSession::TakePending(const MCP::RequestId& requestId, ResponseCallback& fnOnResponse)
+	{
+		std::unique_lock<std::mutex> _lock(m_mtxPending);
+		auto itrPending = m_hashPending.find(requestId);
+		if (itrPending == m_hashPending.end())
+			return false;
+
+		fnOnResponse = std::move(itrPending->second.fnOnResponse);
+		if (itrPending->second.bHasDeadline)
+			m_mapDeadlines.erase(itrPending->second.itrDeadline);
+		m_hashPending.erase(itrPending);
+
+		return true;
+	}
+
+	void CMCPClientSession::ScheduleTimer()
+	{
+		if (m_mapDeadlines.empty())
+			return;
+		auto tpEarliest = m_mapDeadlines.begin()->first;
+		if (m_bTimerArmed && m_tpTimer <= tpEarliest)
+			return;
+
+		if (ERRNO_OK == m_timer.Schedule(tpEarliest, [this]() { OnTimer(); }))
+		{
+			m_bTimerArmed = true;
+			m_tpTimer = tpEarliest;
+		}
+	}
+
+	void CMCPClientSession::OnTimer()
+	{
+		std::vector<std::pair<MCP::RequestId, ResponseCallback>> vecExpired;
+		{
+			std::unique_lock<std::mutex> _lock(m_mtxPending);
+			// An earlier callback replaced by this one still fires; it finds nothing due.
+			auto tpNow = Clock::now();
+			if (m_tpTimer <= tpNow)
+				m_bTimerArmed = false;
+			while (!m_mapDeadlines.empty() && m_mapDeadlines.begin()->first <= tpNow)
+			{
+				auto itrPending = m_hashPending.find(m_mapDeadlines.begin()->second);
+				if (itrPending != m_hashPending.end())
+				{
+					vecExpired.emplace_back(itrPending->first, std::move(itrPending->second.fnOnResponse));
+					m_hashPending.erase(itrPending);
+				}
+				m_mapDeadlines.erase(m_mapDeadlines.begin());
+			}
+			ScheduleTimer();
+		}
+
+		// The server is told to stop working on them, as for a cancellation.
+		for (auto& expired : vecExpired)
+		{
+			SendCancelled(expired.first, "timeout");
+			ClientResponse response;
+			response.iErrCode = ERRNO_REQUEST_TIMEOUT;
+			expired.second(std::move(response));
+		}
+	}
+
+	int CMCPClientSession::SendCancelled(const MCP::RequestId& requestId, const std::string& strReason)
+	{
+		std::string strParams;
+		CMCPJsonWriter writer(strParams);
+		writer.StartObject();
+		MCP::RequestId cancelledId = requestId;
+		cancelledId.SetMsgKey(MSG_KEY_REQUEST_ID);
+		cancelledId.WriteMember(writer);
+		if (!strReason.empty())
+		{
+			writer.Key(MSG_KEY_REASON);
+			writer.String(strReason);
+		}
+		writer.EndObject();
+
+		return Notify(METHOD_NOTIFICATION_CANCELLED, strParams);
+	}
+
+	void CMCPClientSession::BuildMessage(const MCP::RequestId* pRequestId, const char* lpcszMethod,
+		const std::string& strParams, std::string& strMessage)
+	{
+		strMessage.reserve(64 + strParams.size());
+		CMCPJsonWriter writer(strMessage);
+		writer.StartObject();
+		if (pRequestId)
+			pRequestId->WriteMember(writer);
+		writer.Key(MSG_KEY_JSONRPC);
+		writer.String(JSON_RPC_VER);
+		writer.Key(MSG_KEY_METHOD);
+		writer.String(lpcszMethod, strlen(lpcszMethod));
+		writer.EndObject();
+
+		// The params are JSON text already: spliced in rather than parsed and written again.
+		if (!strParams.empty())
+		{
+			strMessage.pop_back();
+			strMessage += ",\"";
+			strMessage += MSG_KEY_PARAMS;
+			strMessage += "\":";
+			strMessage += strParams;
+			strMessage += '}';
+		}
+	}
+}
@@ -0,0 +1,132 @@
+#pragma once
+// To ensure good cross-platform compatibility, the MCP namespace code uses standard C++ only.
+// Avoid using platform-specific system APIs unless absolutely necessary.
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <json/json.h>
+#include "../Message/BasicMessage.h"
+#include "../Message/JsonParser.h"
+#include "../Task/DeadlineTimer.h"
+
+namespace MCP
+{
+	class CMCPTransport;
+
+	// The answer to a request sent by a client session.
+	struct ClientResponse
+	{
+		// ERRNO_OK with the "result" value, the code of an error response, ERRNO_REQUEST_TIMEOUT,
+		// ERRNO_REQUEST_CANCELLED, or ERRNO_INTERNAL_INPUT_TERMINATE once the server is gone.
+		int iErrCode{ ERRNO_OK };
+		std::string strMessage;
+		Json::Value jResult;
+	};
+
+	// The client side of an MCP session over one connected transport. Requests from any number of
+	// threads are pipelined: they are written as they come, without waiting for earlier answers,
+	// and each response is matched to its request by id in the in-flight map. Responses are read
+	// on a thread of the session, or on the event loop of a transport that supports push mode.
+	//
+	// A request is answered exactly once: by its response, its timeout, Cancel(), or the end of the
+	// session. Callbacks run on the reader (or loop) thread or on the timer thread and must not block;
+	// blocking callers use the future or Call() instead.
+	class CMCPClientSession
+	{
+	public:
+		using ResponseCallback = std::function<void(ClientResponse&& response)>;
+		// Notifications of the server, e.g. notifications/progress or notifications/message.
+		using NotificationHandler = std::function<void(const std::string& strMethod, const Json::Value& jParams)>;
+
+		explicit CMCPClientSession(std::shared_ptr<CMCPTransport> spTransport);
+		~CMCPClientSession();
+		CMCPClientSession(const CMCPClientSession&) = delete;
+		CMCPClientSession& operator=(const CMCPClientSession&) = delete;
+
+		// Set before Start().
+		void SetNotificationHandler(NotificationHandler fnOnNotification);
+
+		// Starts reading responses; the transport must be connected.
+		int Start();
+		// Disconnects the transport and answers every request still in flight.
+		int Stop();
+
+		// Runs the initialize handshake, then sends notifications/initialized; jResult receives the
+		// capabilities and serverInfo of the server.
+		int Initialize(const std::string& strClientName, const std::string& strClientVersion,
+			unsigned int nTimeoutMs, Json::Value& jResult);
+
+		// Sends a request whose "params" value is the JSON text strParams (none when empty) and
+		// returns once it is written; fnOnResponse is called with its answer, unless an error is
+		// returned. nTimeoutMs 0 waits forever. pRequestId receives the id, for Cancel().
+		int SendRequest(const char* lpcszMethod, const std::string& strParams, unsigned int nTimeoutMs,
+			ResponseCallback fnOnResponse, MCP::RequestId* pRequestId = nullptr);
+		// As above, the answer being delivered through the future. A request that cannot be sent is
+		// answered right away with the error.
+		std::future<ClientResponse> SendRequest(const char* lpcszMethod, const std::string& strParams,
+			unsigned int nTimeoutMs, MCP::RequestId* pRequestId = nullptr);
+		// Sends a request and waits for its answer; returns response.iErrCode.
+		int Call(const char* lpcszMethod, const std::string& strParams, unsigned int nTimeoutMs, ClientResponse& response);
+
+		// Answers the request with ERRNO_REQUEST_CANCELLED and sends notifications/cancelled for it;
+		// a response arriving later is dropped. ERRNO_INVALID_PARAMS if it is no longer in flight.
+		int Cancel(const MCP::RequestId& requestId, const std::string& strReason);
+
+		int Notify(const char* lpcszMethod, const std::string& strParams);
+
+		size_t GetInFlightCount() const;
+		// Whether the session ended: stopped, or the server went away.
+		bool IsClosed() const;
+
+	private:
+		using Clock = CMCPDeadlineTimer::Clock;
+		using DeadlineMap = std::multimap<Clock::time_point, MCP::RequestId>;
+
+		struct PendingRequest
+		{
+			ResponseCallback fnOnResponse;
+			bool bHasDeadline{ false };
+			DeadlineMap::iterator itrDeadline;
+		};
+
+		void ReadResponses();
+		void OnFrame(const char* pBegin, const char* pEnd);
+		void OnClose();
+		// Replies to a request of the server: ping is answered, anything else is not supported.
+		void AnswerServerRequest(const Json::Value& jMessage);
+		// Takes the request out of the in-flight map; false if it was answered already.
+		bool TakePending(const MCP::RequestId& requestId, ResponseCallback& fnOnResponse);
+		// Arms the timer for the earliest deadline unless it fires before that anyway. Locked.
+		void ScheduleTimer();
+		void OnTimer();
+		int SendCancelled(const MCP::RequestId& requestId, const std::string& strReason);
+		static void BuildMessage(const MCP::RequestId* pRequestId, const char* lpcszMethod,
+			const std::string& strParams, std::string& strMessage);
+
+		std::shared_ptr<CMCPTransport> m_spTransport;
+		NotificationHandler m_fnOnNotification;
+		std::thread m_thrReader;
+		bool m_bPushMode{ false };
+		CMCPJsonParser m_parser;
+		Json::Value m_jMessage;
+
+		std::atomic<int> m_iNextId{ 1 };
+		mutable std::mutex m_mtxPending;
+		bool m_bClosed{ false };
+		std::unordered_map<MCP::RequestId, PendingRequest, MCP::RequestIdHash> m_hashPending;
+		// Deadlines of the requests in flight. One timer callback is armed for the earliest of them
+		// rather than one per request, so that requests answered in time leave nothing behind.
+		DeadlineMap m_mapDeadlines;
+		CMCPDeadlineTimer m_timer;
+		bool m_bTimerArmed{ false };
+		Clock::time_point m_tpTimer;
+	};
+}
@@ -0,0 +1,536 @@
+#include "FileResourceProvider.h"
+#include "../Public/Config.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#ifdef _WIN32
+#include <windows.h>
+#include <cstdlib>
+#else
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace MCP
+{
+	// Bytes looked at to tell text from binary content.
+	static constexpr size_t TEXT_SNIFF_BYTES = 8 * 1024;
+	// Files up to this size are read into memory rather than mapped.
+	static constexpr size_t MAPPED_FILE_MIN_BYTES = 64 * 1024;
+
+	struct FileMimeType
+	{
+		const char* lpcszExtension;
+		const char* lpcszMimeType;
+		bool bText;
+	};
+
+	static const FileMimeType s_arrMimeTypes[] =
+	{
+		{ "txt", "text/plain", true },
+		{ "md", "text/markdown", true },
+		{ "c", "text/x-c", true },
+		{ "h", "text/x-c", true },
+		{ "cc", "text/x-c++", true },
+		{ "cpp", "text/x-c++", true },
+		{ "cxx", "text/x-c++", true },
+		{ "hpp", "text/x-c++", true },
+		{ "py", "text/x-python", true },
+		{ "sh", "text/x-shellscript", true },
+		{ "js", "text/javascript", true },
+		{ "html", "text/html", true },
+		{ "css", "text/css", true },
+		{ "csv", "text/csv", true },
+		{ "json", "application/json", true },
+		{ "xml", "application/xml", true },
+		{ "yaml", "application/yaml", true },
+		{ "yml", "application/yaml", true },
+		{ "svg", "image/svg+xml", true },
+		{ "png", "image/png", false },
+		{ "jpg", "image/jpeg", false },
+		{ "jpeg", "image/jpeg", false },
+		{ "gif", "image/gif", false },
+		{ "webp", "image/webp", false },
+		{ "pdf", "application/pdf", false },
+		{ "zip", "application/zip", false },
+		{ "gz", "application/gzip", false },
+	};
+
+	static const FileMimeType* FindMimeType(const std::string& strPath)
+	{
+		size_t nDot = strPath.find_last_of("./");
+		if (std::string::npos == nDot || strPath[nDot] != '.')
+			return nullptr;
+		std::string strExtension = strPath.substr(nDot + 1);
+		std::transform(strExtension.begin(), strExtension.end(), strExtension.begin(),
+			[](unsigned char ch) { return static_cast<char>(std::tolower(ch)); });
+		for (auto& mimeType : s_arrMimeTypes)
+		{
+			if (strExtension == mimeType.lpcszExtension)
+				return &mimeType;
+		}
+
+		return nullptr;
+	}
+
+	// Valid UTF-8 without NULs; a sequence cut off at the end of the sniffed bytes is accepted.
+	static bool LooksLikeText(const unsigned char* pData, size_t nLength)
+	{
+		size_t i = 0;
+		while (i < nLength)
+		{
+			unsigned char ch = pData[i];
+			size_t nSequence = 1;
+			if (0 == ch)
+				return false;
+			else if (ch < 0x80)
+				nSequence = 1;
+			else if ((ch & 0xE0) == 0xC0 && ch >= 0xC2)
+				nSequence = 2;
+			else if ((ch & 0xF0) == 0xE0)
+				nSequence = 3;
+			else if ((ch & 0xF8) == 0xF0 && ch <= 0xF4)
+				nSequence = 4;
+			else
+				return false;
+
+			for (size_t j = 1; j < nSequence; ++j)
+			{
+				if (i + j >= nLength)
+					return true;
+				if ((pData[i + j] & 0xC0) != 0x80)
+					return false;
+			}
+			i += nSequence;
+		}
+
+		return true;
+	}
+
+	static bool IsContinuationByte(unsigned char ch)
+	{
+		return (ch & 0xC0) == 0x80;
+	}
+
+	static std::string CanonicalPath(const std::string& strPath)
+	{
+#ifdef _WIN32
+		char szPath[MAX_PATH];
+		if (!_fullpath(szPath, strPath.c_str(), MAX_PATH))
+			return std::string();
+		std::string strCanonical(szPath);
+		std::replace(strCanonical.begin(), strCanonical.end(), '\\', '/');
+		return strCanonical;
+#else
+		char szPath[PATH_MAX];
+		if (!realpath(strPath.c_str(), szPath))
+			return std::string();
+		return std::string(szPath);
+#endif
+	}
+
+	struct FileStat
+	{
+		unsigned long long ullSize{ 0 };
+		long long llModified{ 0 };
+		bool bRegular{ false };
+		bool bDirectory{ false };
+		bool bLink{ false };
+	};
+
+	static bool StatPath(const std::string& strPath, FileStat& fileStat)
+	{
+#ifdef _WIN32
+		WIN32_FILE_ATTRIBUTE_DATA attributes;
+		if (!GetFileAttributesExA(strPath.c_str(), GetFileExInfoStandard, &attributes))
+			return false;
+		fileStat.ullSize = (static_cast<unsigned long long>(attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow;
+		fileStat.llModified = static_cast<long long>((static_cast<unsigned long long>(attributes.ftLastWriteTime.dwHighDateTime) << 32)
+			| attributes.ftLastWriteTime.dwLowDateTime);
+		fileStat.bLink = 0 != (attributes.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT);
+		fileStat.bDirectory = 0 != (attributes.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY);
+		fileStat.bRegular = !fileStat.bDirectory && !fileStat.bLink;
+#else
+		struct stat st;
+		if (0 != lstat(strPath.c_str(), &st))
+			return false;
+		fileStat.ullSize = static_cast<unsigned long long>(st.st_size);
+		fileStat.llModified = static_cast<long long>(st.st_mtime) * 1000000000LL
+#ifdef __APPLE__
+			+ st.st_mtimespec.tv_nsec;
+#else
+			+ st.st_mtim.tv_nsec;
+#endif
+		fileStat.bLink = S_ISLNK(st.st_mode);
+		fileStat.bDirectory = S_ISDIR(st.st_mode);
+		fileStat.bRegular = S_ISREG(st.st_mode);
+#endif
+		return true;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	// CFileMapping
+	class CMCPFileResourceProvider::CFileMapping
+	{
+	public:
+		CFileMapping() = default;
+		CFileMapping(const CFileMapping&) = delete;
+		CFileMapping& operator=(const CFileMapping&) = delete;
+
+		~CFileMapping()
+		{
+			if (!m_pView)
+				return;
+#ifdef _WIN32
+			UnmapViewOfFile(m_pView);
+#else
+			munmap(m_pView, nSize);
+#endif
+		}
+
+		// The size is taken from the opened file, which may have changed since it was looked up.
+		int Map(const std::string& strPath)
+		{
+#ifdef _WIN32
+			HANDLE hFile = CreateFileA(strPath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+				nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (INVALID_HANDLE_VALUE == hFile)
+				return ERRNO_INTERNAL_ERROR;
+			LARGE_INTEGER liSize;
+			FILETIME ftModified;
+			if (!GetFileSizeEx(hFile, &liSize) || !GetFileTime(hFile, nullptr, nullptr, &ftModified))
+			{
+				CloseHandle(hFile);
+				return ERRNO_INTERNAL_ERROR;
+			}
+			nSize = static_cast<size_t>(liSize.QuadPart);
+			llModified = static_cast<long long>((static_cast<unsigned long long>(ftModified.dwHighDateTime) << 32) | ftModified.dwLowDateTime);
+			if (nSize <= MAPPED_FILE_MIN_BYTES)
+			{
+				m_strBuffer.resize(nSize);
+				DWORD dwRead = 0;
+				BOOL bRead = 0 == nSize || ReadFile(hFile, &m_strBuffer[0], static_cast<DWORD>(nSize), &dwRead, nullptr);
+				CloseHandle(hFile);
+				if (!bRead)
+					return ERRNO_INTERNAL_ERROR;
+				// Truncated meanwhile.
+				m_strBuffer.resize(nSize = dwRead);
+				pData = reinterpret_cast<const unsigned char*>(m_strBuffer.data());
+				return ERRNO_OK;
+			}
+			// Windows refuses to truncate a file while a view of it is mapped.
+			HANDLE hMapping = CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			CloseHandle(hFile);
+			if (!hMapping)
+				return ERRNO_INTERNAL_ERROR;
+			m_pView = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, nSize);
+			CloseHandle(hMapping);
+			if (!m_pView)
+				return ERRNO_INTERNAL_ERROR;
+#else
+			int iFd = open(strPath.c_str(), O_RDONLY | O_CLOEXEC);
+			if (iFd < 0)
+				return ERRNO_INTERNAL_ERROR;
+			struct stat st;
+			if (0 != fstat(iFd, &st) || !S_ISREG(st.st_mode))
+			{
+				close(iFd);
+				return ERRNO_INTERNAL_ERROR;
+			}
+			nSize = static_cast<size_t>(st.st_size);
+			llModified = static_cast<long long>(st.st_mtime) * 1000000000LL
+#ifdef __APPLE__
+				+ st.st_mtimespec.tv_nsec;
+#else
+				+ st.st_mtim.tv_nsec;
+#endif
+			if (nSize <= MAPPED_FILE_MIN_BYTES)
+			{
+				m_strBuffer.resize(nSize);
+				size_t nRead = 0;
+				while (nRead < nSize)
+				{
+					ssize_t nCount = read(iFd, &m_strBuffer[nRead], nSize - nRead);
+					if (nCount < 0 && EINTR == errno)
+						continue;
+					if (nCount < 0)
+					{
+						close(iFd);
+						return ERRNO_INTERNAL_ERROR;
+					}
+					// Truncated meanwhile.
+					if (0 == nCount)
+						break;
+					nRead += static_cast<size_t>(nCount);
+				}
+				close(iFd);
+				m_strBuffer.resize(nSize = nRead);
+				pData = reinterpret_cast<const unsigned char*>(m_strBuffer.data());
+				return ERRNO_OK;
+			}
+			// Reading a page cut off by a later truncation raises SIGBUS; see the class comment.
+			void* pView = mmap(nullptr, nSize, PROT_READ, MAP_PRIVATE, iFd, 0);
+			close(iFd);
+			if (MAP_FAILED == pView)
+				return ERRNO_INTERNAL_ERROR;
+			m_pView = pView;
+#endif
+			pData = static_cast<const unsigned char*>(m_pView);
+
+			return ERRNO_OK;
+		}
+
+		const unsigned char* pData{ nullptr };
+		size_t nSize{ 0 };
+		long long llModified{ 0 };
+		bool bText{ true };
+		std::string strMimeType;
+
+	private:
+		void* m_pView{ nullptr };
+		// The contents of a file too small to be mapped.
+		std::string m_strBuffer;
+	};
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	// CMCPFileResourceProvider
+	CMCPFileResourceProvider::CMCPFileResourceProvider(const std::string& strRoot, size_t nMaxMappings)
+		: m_strRoot(CanonicalPath(strRoot))
+		, m_nMaxMappings(nMaxMappings)
+	{
+		if (0 == m_nMaxMappings)
+		{
+			int iCacheSize = Config::GetInstance().GetResourceMappingCacheSize();
+			m_nMaxMappings = iCacheSize > 0 ? static_cast<size_t>(iCacheSize) : 1;
+		}
+		while (m_strRoot.size() > 1 && m_strRoot.back() == '/')
+			m_strRoot.pop_back();
+		m_strUriPrefix = "file://";
+		if (m_strRoot.empty() || m_strRoot.front() != '/')
+			m_strUriPrefix += "/";
+		m_strUriPrefix += m_strRoot;
+		if (m_strUriPrefix.back() != '/')
+			m_strUriPrefix += "/";
+	}
+
+	int CMCPFileResourceProvider::ListResources(std::vector<MCP::Resource>& vecResources)
+	{
+		if (m_strRoot.empty())
+			return ERRNO_INTERNAL_ERROR;
+		ListDirectory(std::string(), vecResources);
+		std::sort(vecResources.begin(), vecResources.end(),
+			[](const MCP::Resource& lhs, const MCP::Resource& rhs) { return lhs.strUri < rhs.strUri; });
+
+		return ERRNO_OK;
+	}
+
+	void CMCPFileResourceProvider::ListDirectory(const std::string& strRelative, std::vector<MCP::Resource>& vecResources) const
+	{
+		std::string strDirectory = strRelative.empty() ? m_strRoot : m_strRoot + "/" + strRelative;
+		std::vector<std::string> vecNames;
+#ifdef _WIN32
+		WIN32_FIND_DATAA findData;
+		HANDLE hFind = FindFirstFileA((strDirectory + "/*").c_str(), &findData);
+		if (INVALID_HANDLE_VALUE == hFind)
+			return;
+		do
+		{
+			vecNames.emplace_back(findData.cFileName);
+		} while (FindNextFileA(hFind, &findData));
+		FindClose(hFind);
+#else
+		DIR* pDir = opendir(strDirectory.c_str());
+		if (!pDir)
+			return;
+		while (struct dirent* pEntry = readdir(pDir))
+		{
+			vecNames.emplace_back(pEntry->d_name);
+		}
+		closedir(pDir);
+#endif
+
+		for (auto& strName : vecNames)
+		{
+			// Also skips "." and "..".
+			if (strName.empty() || strName.front() == '.')
+				continue;
+			std::string strChild = strRelative.empty() ? strName : strRelative + "/" + strName;
+			FileStat fileStat;
+			if (!StatPath(m_strRoot + "/" + strChild, fileStat) || fileStat.bLink)
+				continue;
+			if (fileStat.bDirectory)
+			{
+				ListDirectory(strChild, vecResources);
+				continue;
+			}
+			if (!fileStat.bRegular)
+				continue;
+
+			MCP::Resource resource;
+			resource.strUri = m_strUriPrefix + strChild;
+			resource.strName = strChild;
+			auto pMimeType = FindMimeType(strName);
+			if (pMimeType)
+				resource.strMimeType = pMimeType->lpcszMimeType;
+			vecResources.push_back(std::move(resource));
+		}
+	}
+
+	int CMCPFileResourceProvider::ReadResource(const MCP::ReadResourceRequest& request, MCP::ReadResourceResult& result)
+	{
+		std::string strPath = ResolvePath(request.strUri);
+		if (strPath.empty())
+			return ERRNO_INVALID_PARAMS;
+		std::shared_ptr<const CFileMapping> spMapping;
+		int iErrCode = GetMapping(strPath, spMapping);
+		if (ERRNO_OK != iErrCode)
+			return iErrCode;
+
+		size_t nBegin = 0;
+		size_t nEnd = spMapping->nSize;
+		if (request.bRange)
+		{
+			if (request.ullRangeOffset > spMapping->nSize)
+				return ERRNO_INVALID_PARAMS;
+			nBegin = static_cast<size_t>(request.ullRangeOffset);
+			if (request.ullRangeLength > 0 && request.ullRangeLength < spMapping->nSize - nBegin)
+				nEnd = nBegin + static_cast<size_t>(request.ullRangeLength);
+			// A text range is moved to whole characters.
+			if (spMapping->bText)
+			{
+				while (nBegin < nEnd && IsContinuationByte(spMapping->pData[nBegin]))
+					++nBegin;
+				while (nEnd > nBegin && nEnd < spMapping->nSize && IsContinuationByte(spMapping->pData[nEnd]))
+					--nEnd;
+			}
+		}
+
+		MCP::BinaryData data;
+		if (nEnd > nBegin)
+		{
+			data.spOwner = spMapping;
+			data.pData = spMapping->pData + nBegin;
+			data.nSize = nEnd - nBegin;
+		}
+		if (spMapping->bText)
+		{
+			MCP::TextResourceContents textContents;
+			textContents.strUri = request.strUri;
+			textContents.strMimeType = spMapping->strMimeType;
+			textContents.textData = std::move(data);
+			result.vecTextContents.push_back(std::move(textContents));
+		}
+		else
+		{
+			MCP::BlobResourceContents blobContents;
+			blobContents.strUri = request.strUri;
+			blobContents.strMimeType = spMapping->strMimeType;
+			blobContents.binBlob = std::move(data);
+			result.vecBlobContents.push_back(std::move(blobContents));
+		}
+
+		return ERRNO_OK;
+	}
+
+	bool CMCPFileResourceProvider::GetResourceVersion(const std::string& strUri, unsigned long long& ullVersion)
+	{
+		std::string strPath = ResolvePath(strUri);
+		FileStat fileStat;
+		if (strPath.empty() || !StatPath(strPath, fileStat) || !fileStat.bRegular)
+			return false;
+		ullVersion = static_cast<unsigned long long>(fileStat.llModified) ^ (fileStat.ullSize * 0x9E3779B97F4A7C15ULL);
+
+		return true;
+	}
+
+	std::string CMCPFileResourceProvider::ResolvePath(const std::string& strUri) const
+	{
+		if (m_strRoot.empty() || strUri.compare(0, m_strUriPrefix.size(), m_strUriPrefix) != 0)
+			return std::string();
+		std::string strRelative = strUri.substr(m_strUriPrefix.size());
+		if (strRelative.empty() || strRelative.find('\\') != std::string::npos)
+			return std::string();
+		// No hidden entries, which also rules out "." and "..".
+		size_t nComponent = 0;
+		while (nComponent < strRelative.size())
+		{
+			if (strRelative[nComponent] == '.' || strRelative[nComponent] == '/')
+				return std::string();
+			size_t nSlash = strRelative.find('/', nComponent);
+			if (std::string::npos == nSlash)
+				break;
+			nComponent = nSlash + 1;
+		}
+
+		// Links may point outside the root.
+		std::string strPath = CanonicalPath(m_strRoot + "/" + strRelative);
+		if (strPath.size() <= m_strRoot.size() || strPath.compare(0, m_strRoot.size(), m_strRoot) != 0
+			|| (m_strRoot.back() != '/' && strPath[m_strRoot.size()] != '/'))
+			return std::string();
+
+		return strPath;
+	}
+
+	int CMCPFileResourceProvider::GetMapping(const std::string& strPath, std::shared_ptr<const CFileMapping>& spMapping)
+	{
+		FileStat fileStat;
+		if (!StatPath(strPath, fileStat) || !fileStat.bRegular)
+			return ERRNO_INVALID_PARAMS;
+
+		{
+			std::lock_guard<std::mutex> _lock(m_mtxMappings);
+			auto itEntry = m_hashMappings.find(strPath);
+			if (itEntry != m_hashMappings.end())
+			{
+				auto& entry = itEntry->second;
+				if (entry.spMapping->nSize == fileStat.ullSize && entry.spMapping->llModified == fileStat.llModified)
+				{
+					m_lstRecent.splice(m_lstRecent.end(), m_lstRecent, entry.itRecent);
+					spMapping = entry.spMapping;
+					return ERRNO_OK;
+				}
+				m_lstRecent.erase(entry.itRecent);
+				m_hashMappings.erase(itEntry);
+			}
+		}
+
+		// Mapped outside the lock; two threads mapping the same file at once both succeed.
+		auto spNewMapping = std::make_shared<CFileMapping>();
+		int iErrCode = spNewMapping->Map(strPath);
+		if (ERRNO_OK != iErrCode)
+			return iErrCode;
+		auto pMimeType = FindMimeType(strPath);
+		if (pMimeType)
+			spNewMapping->bText = pMimeType->bText;
+		else
+			spNewMapping->bText = LooksLikeText(spNewMapping->pData, (std::min)(spNewMapping->nSize, TEXT_SNIFF_BYTES));
+		if (pMimeType)
+			spNewMapping->strMimeType = pMimeType->lpcszMimeType;
+		else
+			spNewMapping->strMimeType = spNewMapping->bText ? "text/plain" : "application/octet-stream";
+
+		std::lock_guard<std::mutex> _lock(m_mtxMappings);
+		auto itEntry = m_hashMappings.find(strPath);
+		if (itEntry != m_hashMappings.end())
+		{
+			m_lstRecent.erase(itEntry->second.itRecent);
+			m_hashMappings.erase(itEntry);
+		}
+		while (m_hashMappings.size() >= m_nMaxMappings && !m_lstRecent.empty())
+		{
+			m_hashMappings.erase(m_lstRecent.front());
+			m_lstRecent.pop_front();
+		}
+		auto itRecent = m_lstRecent.insert(m_lstRecent.end(), strPath);
+		m_hashMappings[strPath] = CacheEntry{ spNewMapping, itRecent };
+		spMapping = spNewMapping;
+
+		return ERRNO_OK;
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+// To ensure good cross-platform compatibility, the MCP namespace code uses standard C++ only.
+// Avoid using platform-specific system APIs unless absolutely necessary.
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "ResourceProvider.h"
+
+namespace MCP
+{
+	// Serves the files below a root directory as resources, named file://<root>/<relative path>.
+	//
+	// Files above 64 KiB are memory mapped and the contents handed to the serializer reference the
+	// mapping, so a read copies nothing but the escaped output; smaller files are read into memory. A
+	// mapped file must not be truncated in place while it is served: on POSIX systems reading the
+	// pages cut off raises SIGBUS. Files rewritten while served should be replaced by a rename, which
+	// leaves the mapped file intact. The most recently read mappings stay open, up to
+	// [resources] mapping_cache_size; a file changed on disk (size or modification time) is mapped
+	// again. Files are served as text when their extension says so or when their first bytes are
+	// valid UTF-8 without NULs, and as base64 blobs otherwise. Hidden entries and symbolic links are
+	// skipped, and uris leaving the root are rejected.
+	class CMCPFileResourceProvider : public CMCPResourceProvider
+	{
+	public:
+		// nMaxMappings of 0 takes [resources] mapping_cache_size from the configuration.
+		explicit CMCPFileResourceProvider(const std::string& strRoot, size_t nMaxMappings = 0);
+		CMCPFileResourceProvider(const CMCPFileResourceProvider&) = delete;
+		CMCPFileResourceProvider& operator=(const CMCPFileResourceProvider&) = delete;
+
+		int ListResources(std::vector<MCP::Resource>& vecResources) override;
+		int ReadResource(const MCP::ReadResourceRequest& request, MCP::ReadResourceResult& result) override;
+		// Derived from the size and modification time of the file.
+		bool GetResourceVersion(const std::string& strUri, unsigned long long& ullVersion) override;
+
+	private:
+		class CFileMapping;
+
+		// Empty when the uri does not name a file below the root.
+		std::string ResolvePath(const std::string& strUri) const;
+		int GetMapping(const std::string& strPath, std::shared_ptr<const CFileMapping>& spMapping);
+		void ListDirectory(const std::string& strRelative, std::vector<MCP::Resource>& vecResources) const;
+
+		std::string m_strRoot;
+		std::string m_strUriPrefix;
+		size_t m_nMaxMappings;
+
+		// Least recently used first; mappings evicted while referenced by a response stay valid.
+		std::mutex m_mtxMappings;
+		std::list<std::string> m_lstRecent;
+		struct CacheEntry
+		{
+			std::shared_ptr<const CFileMapping> spMapping;
+			std::list<std::string>::iterator itRecent;
+		};
+		std::unordered_map<std::string, CacheEntry> m_hashMappings;
+	};
+}
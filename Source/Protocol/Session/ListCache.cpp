@@ -0,0 +1,160 @@
+#include "ListCache.h"
+#include <algorithm>
+#include <json/writer.h>
+
+namespace MCP
+{
+	static constexpr size_t CURSOR_MAX_DIGITS = 16;
+
+	static std::string EncodeCursor(unsigned long long ullSeq)
+	{
+		static const char s_szDigits[] = "0123456789abcdef";
+		std::string strCursor;
+		do
+		{
+			strCursor.insert(strCursor.begin(), s_szDigits[ullSeq & 0xF]);
+			ullSeq >>= 4;
+		} while (ullSeq > 0);
+
+		return strCursor;
+	}
+
+	static bool DecodeCursor(const std::string& strCursor, unsigned long long& ullSeq)
+	{
+		if (strCursor.empty() || strCursor.size() > CURSOR_MAX_DIGITS)
+			return false;
+
+		ullSeq = 0;
+		for (char ch : strCursor)
+		{
+			unsigned long long ullDigit = 0;
+			if (ch >= '0' && ch <= '9')
+				ullDigit = ch - '0';
+			else if (ch >= 'a' && ch <= 'f')
+				ullDigit = ch - 'a' + 10;
+			else
+				return false;
+			ullSeq = (ullSeq << 4) | ullDigit;
+		}
+
+		return true;
+	}
+
+	CMCPListCache::CMCPListCache(const char* lpcszListKey)
+		: m_strListKey(lpcszListKey)
+	{
+		BuildSerialized({}, 0);
+	}
+
+	int CMCPListCache::SerializeItem(const MCP::Message& item, std::string& strJson)
+	{
+		strJson.clear();
+		CMCPJsonWriter writer(strJson);
+
+		return item.DoWrite(writer);
+	}
+
+	int CMCPListCache::BuildSerialized(std::vector<std::pair<std::string, std::string>>&& vecItems, size_t nPageSize)
+	{
+		auto spSnapshot = std::make_shared<Snapshot>();
+		spSnapshot->nPageSize = nPageSize;
+		spSnapshot->vecEntries.reserve(vecItems.size());
+
+		std::lock_guard<std::mutex> _lock(m_mtxBuild);
+
+		// Keys registered before keep their place; new keys go to the end. A key repeated in
+		// the same list gets a fresh number for every occurrence after the first.
+		std::unordered_map<std::string, unsigned long long> hashSequences;
+		for (auto& item : vecItems)
+		{
+			unsigned long long ullSeq = 0;
+			auto itr = m_hashSequences.find(item.first);
+			if (itr != m_hashSequences.end() && hashSequences.find(item.first) == hashSequences.end())
+				ullSeq = itr->second;
+			else
+				ullSeq = m_ullNextSeq++;
+			hashSequences.emplace(item.first, ullSeq);
+
+			Entry entry;
+			entry.ullSeq = ullSeq;
+			entry.strJson = std::move(item.second);
+			spSnapshot->vecEntries.push_back(std::move(entry));
+		}
+		std::stable_sort(spSnapshot->vecEntries.begin(), spSnapshot->vecEntries.end(),
+			[](const Entry& lhs, const Entry& rhs) { return lhs.ullSeq < rhs.ullSeq; });
+
+		for (size_t nIndex = 0; nIndex < spSnapshot->vecEntries.size(); ++nIndex)
+		{
+			if (nIndex > 0)
+				spSnapshot->strAllItems.push_back(',');
+			spSnapshot->strAllItems.append(spSnapshot->vecEntries[nIndex].strJson);
+		}
+
+		spSnapshot->ullNextSeq = m_ullNextSeq;
+		m_hashSequences.swap(hashSequences);
+		std::atomic_store(&m_spSnapshot, std::shared_ptr<const Snapshot>(std::move(spSnapshot)));
+
+		return ERRNO_OK;
+	}
+
+	int CMCPListCache::GetResponse(const MCP::RequestId& requestId, const std::string& strCursor, std::string& strResponse) const
+	{
+		auto spSnapshot = std::atomic_load(&m_spSnapshot);
+		if (!spSnapshot)
+			return ERRNO_INTERNAL_ERROR;
+
+		const auto& vecEntries = spSnapshot->vecEntries;
+		size_t nBegin = 0;
+		size_t nEnd = vecEntries.size();
+		if (spSnapshot->nPageSize > 0)
+		{
+			if (!strCursor.empty())
+			{
+				unsigned long long ullAfter = 0;
+				if (!DecodeCursor(strCursor, ullAfter) || ullAfter >= spSnapshot->ullNextSeq)
+					return ERRNO_INVALID_PARAMS;
+				auto itr = std::upper_bound(vecEntries.begin(), vecEntries.end(), ullAfter,
+					[](unsigned long long ullSeq, const Entry& entry) { return ullSeq < entry.ullSeq; });
+				nBegin = itr - vecEntries.begin();
+			}
+			nEnd = std::min(nEnd, nBegin + spSnapshot->nPageSize);
+		}
+
+		std::string strId;
+		if (DataType_String == requestId.eIdDataType)
+			strId = Json::valueToQuotedString(requestId.strId.c_str());
+		else if (DataType_Integer == requestId.eIdDataType)
+			strId = std::to_string(requestId.iId);
+		else
+			return ERRNO_INTERNAL_ERROR;
+
+		std::string strNextCursor;
+		if (nEnd < vecEntries.size())
+			strNextCursor = EncodeCursor(vecEntries[nEnd - 1].ullSeq);
+
+		// Same bytes as serializing the result message: the writer orders the keys.
+		strResponse.clear();
+		strResponse.append("{\"").append(MSG_KEY_ID).append("\":").append(strId);
+		strResponse.append(",\"").append(MSG_KEY_JSONRPC).append("\":\"").append(JSON_RPC_VER);
+		strResponse.append("\",\"").append(MSG_KEY_RESULT).append("\":{");
+		if (!strNextCursor.empty())
+			strResponse.append("\"").append(MSG_KEY_NEXT_CURSOR).append("\":\"").append(strNextCursor).append("\",");
+		strResponse.append("\"").append(m_strListKey).append("\":[");
+		if (0 == nBegin && vecEntries.size() == nEnd)
+		{
+			strResponse.append(spSnapshot->strAllItems);
+		}
+		else
+		{
+			for (size_t nIndex = nBegin; nIndex < nEnd; ++nIndex)
+			{
+				if (nIndex > nBegin)
+					strResponse.push_back(',');
+				strResponse.append(vecEntries[nIndex].strJson);
+			}
+		}
+		strResponse.append("]}}\n");
+
+		return ERRNO_OK;
+	}
+}
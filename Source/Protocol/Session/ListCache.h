@@ -0,0 +1,77 @@
+#pragma once
+// To ensure good cross-platform compatibility, the MCP namespace code uses standard C++ only.
+// Avoid using platform-specific system APIs unless absolutely necessary.
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <unordered_map>
+#include "../Public/PublicDef.h"
+#include "../Message/BasicMessage.h"
+
+namespace MCP
+{
+	// Pagination engine behind tools/list, resources/list and prompts/list.
+	//
+	// The items are serialized once when they are registered; answering a request only copies
+	// the bytes of its page behind its id. Every item keeps the sequence number it got when its
+	// key (tool name, resource uri...) was registered, and a cursor names the last item of the
+	// previous page, so cursors stay valid when items are added or removed in between.
+	class CMCPListCache
+	{
+	public:
+		// lpcszListKey names the array of the result, e.g. MSG_KEY_TOOLS.
+		explicit CMCPListCache(const char* lpcszListKey);
+
+		// Replaces the items; safe against concurrent GetResponse() calls.
+		// fnKey identifies an item across rebuilds. A page size of 0 returns every item at once.
+		template <class T, class KeyFn>
+		int Build(const std::vector<T>& vecItems, KeyFn fnKey, size_t nPageSize)
+		{
+			std::vector<std::pair<std::string, std::string>> vecSerialized;
+			vecSerialized.reserve(vecItems.size());
+			for (auto& item : vecItems)
+			{
+				// Items that fail to serialize are left out of the list.
+				std::string strJson;
+				if (ERRNO_OK == SerializeItem(item, strJson))
+					vecSerialized.emplace_back(fnKey(item), std::move(strJson));
+			}
+
+			return BuildSerialized(std::move(vecSerialized), nPageSize);
+		}
+
+		// As Build(), from items serialized already: pairs of key and JSON text, e.g. read back from
+		// a snapshot written with SerializeItem().
+		int BuildSerialized(std::vector<std::pair<std::string, std::string>>&& vecItems, size_t nPageSize);
+		// The JSON text an item is listed with.
+		static int SerializeItem(const MCP::Message& item, std::string& strJson);
+
+		// Returns ERRNO_INVALID_PARAMS when the cursor was not issued by this list.
+		int GetResponse(const MCP::RequestId& requestId, const std::string& strCursor, std::string& strResponse) const;
+
+	private:
+		struct Entry
+		{
+			unsigned long long ullSeq{ 0 };
+			std::string strJson;
+		};
+
+		struct Snapshot
+		{
+			size_t nPageSize{ 0 };
+			unsigned long long ullNextSeq{ 0 };	// cursors at or above it were never issued
+			std::vector<Entry> vecEntries;		// in sequence order
+			std::string strAllItems;			// the joined entries, for unpaginated lists
+		};
+
+		std::string m_strListKey;
+		// Guards the sequence numbers against concurrent rebuilds.
+		std::mutex m_mtxBuild;
+		std::unordered_map<std::string, unsigned long long> m_hashSequences;
+		unsigned long long m_ullNextSeq{ 1 };
+		std::shared_ptr<const Snapshot> m_spSnapshot;	// accessed with std::atomic_load/store
+	};
+}
@@ -0,0 +1,63 @@
+#include "MessageArena.h"
+#include <cstddef>
+
+namespace MCP
+{
+	static constexpr size_t ARENA_ALIGNMENT = alignof(std::max_align_t);
+
+	CMCPMessageArena::CMCPMessageArena(size_t nChunkSize)
+		: m_nChunkSize(nChunkSize)
+	{
+	}
+
+	void* CMCPMessageArena::Allocate(size_t nBytes)
+	{
+		nBytes = (nBytes + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+
+		while (m_nCurrent < m_vecChunks.size())
+		{
+			Chunk& chunk = m_vecChunks[m_nCurrent];
+			if (chunk.nSize - m_nOffset >= nBytes)
+			{
+				void* pBlock = chunk.upData.get() + m_nOffset;
+				m_nOffset += nBytes;
+				m_nBytesUsed += nBytes;
+				return pBlock;
+			}
+			++m_nCurrent;
+			m_nOffset = 0;
+		}
+
+		Chunk chunk;
+		chunk.nSize = nBytes > m_nChunkSize ? nBytes : m_nChunkSize;
+		chunk.upData.reset(new char[chunk.nSize]);
+		m_vecChunks.push_back(std::move(chunk));
+		m_nCurrent = m_vecChunks.size() - 1;
+		m_nOffset = nBytes;
+		m_nBytesUsed += nBytes;
+
+		return m_vecChunks.back().upData.get();
+	}
+
+	void CMCPMessageArena::Reset()
+	{
+		// Only a regular first chunk is kept, never the oversized one of a huge message.
+		if (!m_vecChunks.empty() && m_vecChunks.front().nSize > m_nChunkSize)
+			m_vecChunks.clear();
+		else if (m_vecChunks.size() > 1)
+			m_vecChunks.resize(1);
+		m_nCurrent = 0;
+		m_nOffset = 0;
+		m_nBytesUsed = 0;
+	}
+
+	size_t CMCPMessageArena::GetBytesUsed() const
+	{
+		return m_nBytesUsed;
+	}
+
+	void* CMCPMessageArena::allocate(size_t nBytes)
+	{
+		return Allocate(nBytes);
+	}
+}
@@ -0,0 +1,42 @@
+#pragma once
+// To ensure good cross-platform compatibility, the MCP namespace code uses standard C++ only.
+// Avoid using platform-specific system APIs unless absolutely necessary.
+
+#include <memory>
+#include <vector>
+#include <json/json.h>
+
+namespace MCP
+{
+	// Monotonic arena for the short lived data of one incoming message: allocation bumps a pointer
+	// and nothing is freed until Reset() makes the whole arena reusable at once. Installed as the
+	// Json::MemoryResource while a message is parsed, it takes the jsoncpp string buffers and nodes
+	// of the parse tree off the heap. Not thread safe; one arena serves one thread.
+	class CMCPMessageArena : public Json::MemoryResource
+	{
+	public:
+		// nChunkSize is the size of the chunk that Reset() keeps; a message that does not fit
+		// adds chunks that are released again by the next Reset().
+		explicit CMCPMessageArena(size_t nChunkSize);
+
+		void* Allocate(size_t nBytes);
+		void Reset();
+		// Bytes handed out since the last Reset().
+		size_t GetBytesUsed() const;
+
+	private:
+		void* allocate(size_t nBytes) override;
+
+		struct Chunk
+		{
+			std::unique_ptr<char[]> upData;
+			size_t nSize{ 0 };
+		};
+
+		std::vector<Chunk> m_vecChunks;
+		size_t m_nChunkSize{ 0 };
+		size_t m_nCurrent{ 0 };		// index of the chunk being filled
+		size_t m_nOffset{ 0 };		// first free byte of that chunk
+		size_t m_nBytesUsed{ 0 };
+	};
+}
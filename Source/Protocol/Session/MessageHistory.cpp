@@ -0,0 +1,84 @@
+#include "MessageHistory.h"
+
+namespace MCP
+{
+	CMCPMessageHistory::CMCPMessageHistory(size_t nCapacity)
+	{
+		SetCapacity(nCapacity);
+	}
+
+	void CMCPMessageHistory::SetCapacity(size_t nCapacity)
+	{
+		std::unique_lock<std::mutex> _lock(m_mtxHistory);
+		m_vecRecords.clear();
+		m_vecRecords.shrink_to_fit();
+		m_vecRecords.resize(nCapacity);
+		m_hashPending.clear();
+		m_ullNextSequence = 0;
+	}
+
+	size_t CMCPMessageHistory::GetCapacity() const
+	{
+		std::unique_lock<std::mutex> _lock(m_mtxHistory);
+		return m_vecRecords.size();
+	}
+
+	void CMCPMessageHistory::Record(MessageRecord record)
+	{
+		std::unique_lock<std::mutex> _lock(m_mtxHistory);
+		if (m_vecRecords.empty())
+			return;
+
+		auto& slot = m_vecRecords[m_ullNextSequence % m_vecRecords.size()];
+		if (slot.ullSequence != 0 && slot.requestId.IsValid() && 0 == slot.ullCompletedMs)
+		{
+			auto itrPending = m_hashPending.find(slot.requestId);
+			if (itrPending != m_hashPending.end() && itrPending->second == slot.ullSequence)
+				m_hashPending.erase(itrPending);
+		}
+
+		// Sequences start at 1 so that 0 marks an unused slot.
+		record.ullSequence = ++m_ullNextSequence;
+		if (MessageCategory_Request == record.eCategory && record.requestId.IsValid())
+			m_hashPending[record.requestId] = record.ullSequence;
+		slot = std::move(record);
+	}
+
+	void CMCPMessageHistory::Complete(const MCP::RequestId& requestId, int iStatus)
+	{
+		std::unique_lock<std::mutex> _lock(m_mtxHistory);
+		auto itrPending = m_hashPending.find(requestId);
+		if (itrPending == m_hashPending.end())
+			return;
+
+		auto& slot = m_vecRecords[(itrPending->second - 1) % m_vecRecords.size()];
+		if (slot.ullSequence == itrPending->second)
+		{
+			slot.ullCompletedMs = NowMs();
+			slot.iStatus = iStatus;
+		}
+		m_hashPending.erase(itrPending);
+	}
+
+	std::vector<MessageRecord> CMCPMessageHistory::GetRecords() const
+	{
+		std::unique_lock<std::mutex> _lock(m_mtxHistory);
+		std::vector<MessageRecord> vecRecords;
+		if (m_vecRecords.empty())
+			return vecRecords;
+
+		size_t nCount = m_ullNextSequence < m_vecRecords.size() ? static_cast<size_t>(m_ullNextSequence) : m_vecRecords.size();
+		vecRecords.reserve(nCount);
+		for (unsigned long long ullSequence = m_ullNextSequence - nCount; ullSequence < m_ullNextSequence; ++ullSequence)
+		{
+			vecRecords.push_back(m_vecRecords[ullSequence % m_vecRecords.size()]);
+		}
+
+		return vecRecords;
+	}
+
+	unsigned long long CMCPMessageHistory::NowMs()
+	{
+		return Message::NowMs();
+	}
+}
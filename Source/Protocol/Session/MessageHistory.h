@@ -0,0 +1,54 @@
+#pragma once
+// To ensure good cross-platform compatibility, the MCP namespace code uses standard C++ only.
+// Avoid using platform-specific system APIs unless absolutely necessary.
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include "../Public/PublicDef.h"
+#include "../Message/BasicMessage.h"
+
+namespace MCP
+{
+	// Lightweight trace of one incoming message; the payload itself is not retained.
+	struct MessageRecord
+	{
+		unsigned long long ullSequence{ 0 };
+		unsigned long ulRuntimeId{ 0 };		// Message::ulRuntimeId, 0 if the message was not stamped
+		MessageCategory eCategory{ MessageCategory_Unknown };
+		MCP::RequestId requestId;			// invalid for notifications
+		std::string strMethod;				// empty for responses
+		size_t nSize{ 0 };					// bytes of the raw message
+		unsigned long long ullReceivedMs{ 0 };
+		unsigned long long ullCompletedMs{ 0 };	// 0 while the request is pending
+		int iStatus{ ERRNO_OK };
+	};
+
+	// Fixed size ring buffer of the most recent messages of a session, for debugging.
+	// A capacity of 0 disables recording.
+	class CMCPMessageHistory
+	{
+	public:
+		explicit CMCPMessageHistory(size_t nCapacity = 0);
+
+		void SetCapacity(size_t nCapacity);
+		size_t GetCapacity() const;
+
+		void Record(MessageRecord record);
+		// Marks the most recent record of a request as answered.
+		void Complete(const MCP::RequestId& requestId, int iStatus);
+		// Oldest first.
+		std::vector<MessageRecord> GetRecords() const;
+
+		// Same clock as Message::Stamp(), so received and completed times are comparable.
+		static unsigned long long NowMs();
+
+	private:
+		mutable std::mutex m_mtxHistory;
+		std::vector<MessageRecord> m_vecRecords;
+		unsigned long long m_ullNextSequence{ 0 };
+		// Pending requests -> sequence of their record, evicted together with the record.
+		std::unordered_map<MCP::RequestId, unsigned long long, MCP::RequestIdHash> m_hashPending;
+	};
+}
@@ -0,0 +1,106 @@
+#include "MethodRegistry.h"
+#include <cstring>
+
+namespace MCP
+{
+	static constexpr size_t SLOT_EMPTY = static_cast<size_t>(-1);
+
+	int CMCPMethodRegistry::Register(const std::string& strMethod, MessageCategory eCategory, MessageFactory fnCreate, MethodHandler fnHandle)
+	{
+		if (strMethod.empty() || !fnCreate || !fnHandle)
+			return ERRNO_INTERNAL_ERROR;
+		if (MessageCategory_Request != eCategory && MessageCategory_Notification != eCategory)
+			return ERRNO_INTERNAL_ERROR;
+
+		MethodEntry entry;
+		entry.strMethod = strMethod;
+		entry.eCategory = eCategory;
+		entry.fnCreate = std::move(fnCreate);
+		entry.fnHandle = std::move(fnHandle);
+
+		for (auto& existing : m_vecEntries)
+		{
+			if (existing.strMethod == strMethod)
+			{
+				existing = std::move(entry);
+				return ERRNO_OK;
+			}
+		}
+
+		m_vecEntries.push_back(std::move(entry));
+		RebuildIndex();
+
+		return ERRNO_OK;
+	}
+
+	int CMCPMethodRegistry::Unregister(const std::string& strMethod)
+	{
+		for (auto itr = m_vecEntries.begin(); itr != m_vecEntries.end(); ++itr)
+		{
+			if (itr->strMethod == strMethod)
+			{
+				m_vecEntries.erase(itr);
+				RebuildIndex();
+				return ERRNO_OK;
+			}
+		}
+
+		return ERRNO_METHOD_NOT_FOUND;
+	}
+
+	const MethodEntry* CMCPMethodRegistry::Find(MessageCategory eCategory, const char* lpcszBegin, const char* lpcszEnd) const
+	{
+		if (!lpcszBegin || lpcszEnd <= lpcszBegin || m_vecSlots.empty())
+			return nullptr;
+
+		const size_t nLen = static_cast<size_t>(lpcszEnd - lpcszBegin);
+		const size_t nMask = m_vecSlots.size() - 1;
+		for (size_t nSlot = Hash(lpcszBegin, lpcszEnd) & nMask; ; nSlot = (nSlot + 1) & nMask)
+		{
+			size_t nIndex = m_vecSlots[nSlot];
+			if (SLOT_EMPTY == nIndex)
+				return nullptr;
+
+			auto& entry = m_vecEntries[nIndex];
+			if (entry.strMethod.size() == nLen && std::memcmp(entry.strMethod.data(), lpcszBegin, nLen) == 0)
+				return entry.eCategory == eCategory ? &entry : nullptr;
+		}
+	}
+
+	const MethodEntry* CMCPMethodRegistry::Find(MessageCategory eCategory, const std::string& strMethod) const
+	{
+		return Find(eCategory, strMethod.data(), strMethod.data() + strMethod.size());
+	}
+
+	size_t CMCPMethodRegistry::Hash(const char* lpcszBegin, const char* lpcszEnd)
+	{
+		// FNV-1a
+		size_t nHash = 2166136261u;
+		for (auto p = lpcszBegin; p != lpcszEnd; ++p)
+		{
+			nHash ^= static_cast<unsigned char>(*p);
+			nHash *= 16777619u;
+		}
+
+		return nHash;
+	}
+
+	void CMCPMethodRegistry::RebuildIndex()
+	{
+		// Keep the load factor at or below 1/2 so probe sequences stay short.
+		size_t nSlots = 8;
+		while (nSlots < m_vecEntries.size() * 2)
+			nSlots <<= 1;
+
+		m_vecSlots.assign(nSlots, SLOT_EMPTY);
+		const size_t nMask = nSlots - 1;
+		for (size_t nIndex = 0; nIndex < m_vecEntries.size(); ++nIndex)
+		{
+			auto& strMethod = m_vecEntries[nIndex].strMethod;
+			size_t nSlot = Hash(strMethod.data(), strMethod.data() + strMethod.size()) & nMask;
+			while (SLOT_EMPTY != m_vecSlots[nSlot])
+				nSlot = (nSlot + 1) & nMask;
+			m_vecSlots[nSlot] = nIndex;
+		}
+	}
+}
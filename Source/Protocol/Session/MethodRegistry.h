@@ -0,0 +1,52 @@
+#pragma once
+// To ensure good cross-platform compatibility, the MCP namespace code uses standard C++ only.
+// Avoid using platform-specific system APIs unless absolutely necessary.
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include "../Public/PublicDef.h"
+#include "../Message/Message.h"
+
+namespace MCP
+{
+	class CMCPSession;
+
+	// Creates the empty message object that an incoming method is deserialized into.
+	using MessageFactory = std::function<std::shared_ptr<MCP::Message>()>;
+	// Handles a deserialized message. On failure the handler may fill strErrMsg,
+	// which is used as the message of the error response sent for requests.
+	using MethodHandler = std::function<int(CMCPSession& session, const std::shared_ptr<MCP::Message>& spMsg, std::string& strErrMsg)>;
+
+	struct MethodEntry
+	{
+		std::string strMethod;
+		MessageCategory eCategory{ MessageCategory_Unknown };
+		MessageFactory fnCreate;
+		MethodHandler fnHandle;
+	};
+
+	// Method name -> (message factory, handler) table.
+	// Lookups hash the raw name bytes into an open-addressing index, so finding a method
+	// is O(1) and does not allocate. Registration rebuilds the index and is expected to
+	// happen before the session starts reading messages.
+	class CMCPMethodRegistry
+	{
+	public:
+		// Adds a method, replacing any entry already registered under the same name.
+		int Register(const std::string& strMethod, MessageCategory eCategory, MessageFactory fnCreate, MethodHandler fnHandle);
+		int Unregister(const std::string& strMethod);
+
+		const MethodEntry* Find(MessageCategory eCategory, const char* lpcszBegin, const char* lpcszEnd) const;
+		const MethodEntry* Find(MessageCategory eCategory, const std::string& strMethod) const;
+
+	private:
+		static size_t Hash(const char* lpcszBegin, const char* lpcszEnd);
+		void RebuildIndex();
+
+		std::vector<MethodEntry> m_vecEntries;
+		// Slot values are indexes into m_vecEntries, npos marks an empty slot.
+		std::vector<size_t> m_vecSlots;
+	};
+}
@@ -0,0 +1,286 @@
+#include "Metrics.h"
+#include "../Public/PublicDef.h"
+#include <cstdio>
+
+namespace MCP
+{
+	const unsigned long long MetricsHistogram::s_arrBoundsUs[MetricsHistogram::BUCKET_COUNT - 1] = {
+		50, 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000, 2500000, 5000000
+	};
+
+	static std::atomic<unsigned long long> s_ullNextInstance{ 1 };
+	static thread_local size_t t_nBytesWritten = 0;
+
+	void MetricsHistogram::Record(unsigned long long ullUs)
+	{
+		size_t nBucket = 0;
+		while (nBucket < BUCKET_COUNT - 1 && ullUs > s_arrBoundsUs[nBucket])
+			++nBucket;
+		++arrBuckets[nBucket];
+		++ullCount;
+		ullSumUs += ullUs;
+	}
+
+	void MetricsHistogram::Merge(const MetricsHistogram& other)
+	{
+		for (size_t nBucket = 0; nBucket < BUCKET_COUNT; ++nBucket)
+		{
+			arrBuckets[nBucket] += other.arrBuckets[nBucket];
+		}
+		ullCount += other.ullCount;
+		ullSumUs += other.ullSumUs;
+	}
+
+	void MethodMetrics::Merge(const MethodMetrics& other)
+	{
+		ullCount += other.ullCount;
+		for (auto& itrError : other.mapErrors)
+		{
+			mapErrors[itrError.first] += itrError.second;
+		}
+		ullBytesIn += other.ullBytesIn;
+		ullBytesOut += other.ullBytesOut;
+		latency.Merge(other.latency);
+		queueWait.Merge(other.queueWait);
+	}
+
+	static void AppendLabel(std::string& strOut, const char* lpcszName, const std::string& strValue)
+	{
+		strOut += lpcszName;
+		strOut += "=\"";
+		for (char ch : strValue)
+		{
+			switch (ch)
+			{
+				case '\\': strOut += "\\\\"; break;
+				case '"': strOut += "\\\""; break;
+				case '\n': strOut += "\\n"; break;
+				default: strOut += ch; break;
+			}
+		}
+		strOut += '"';
+	}
+
+	static void AppendHeader(std::string& strOut, const char* lpcszMetric, const char* lpcszType, const char* lpcszHelp)
+	{
+		strOut += "# HELP ";
+		strOut += lpcszMetric;
+		strOut += ' ';
+		strOut += lpcszHelp;
+		strOut += "\n# TYPE ";
+		strOut += lpcszMetric;
+		strOut += ' ';
+		strOut += lpcszType;
+		strOut += '\n';
+	}
+
+	static void AppendSample(std::string& strOut, const char* lpcszMetric, const char* lpcszSuffix, const std::string& strLabels, double dValue)
+	{
+		char szValue[32];
+		snprintf(szValue, sizeof(szValue), "%.15g", dValue);
+		strOut += lpcszMetric;
+		strOut += lpcszSuffix;
+		strOut += '{';
+		strOut += strLabels;
+		strOut += "} ";
+		strOut += szValue;
+		strOut += '\n';
+	}
+
+	// One metric family over all the series of mapSeries, labelled with lpcszLabel.
+	template <class FnValue>
+	static void AppendCounter(std::string& strOut, const std::map<std::string, MethodMetrics>& mapSeries, const char* lpcszLabel,
+		const char* lpcszMetric, const char* lpcszHelp, FnValue fnValue)
+	{
+		if (mapSeries.empty())
+			return;
+
+		AppendHeader(strOut, lpcszMetric, "counter", lpcszHelp);
+		for (auto& itrSeries : mapSeries)
+		{
+			std::string strLabels;
+			AppendLabel(strLabels, lpcszLabel, itrSeries.first);
+			AppendSample(strOut, lpcszMetric, "", strLabels, static_cast<double>(fnValue(itrSeries.second)));
+		}
+	}
+
+	static void AppendErrors(std::string& strOut, const std::map<std::string, MethodMetrics>& mapSeries, const char* lpcszLabel,
+		const char* lpcszMetric, const char* lpcszHelp)
+	{
+		bool bHeader = false;
+		for (auto& itrSeries : mapSeries)
+		{
+			for (auto& itrError : itrSeries.second.mapErrors)
+			{
+				if (!bHeader)
+				{
+					AppendHeader(strOut, lpcszMetric, "counter", lpcszHelp);
+					bHeader = true;
+				}
+				std::string strLabels;
+				AppendLabel(strLabels, lpcszLabel, itrSeries.first);
+				strLabels += ',';
+				AppendLabel(strLabels, "code", std::to_string(itrError.first));
+				AppendSample(strOut, lpcszMetric, "", strLabels, static_cast<double>(itrError.second));
+			}
+		}
+	}
+
+	template <class FnHistogram>
+	static void AppendHistogram(std::string& strOut, const std::map<std::string, MethodMetrics>& mapSeries, const char* lpcszLabel,
+		const char* lpcszMetric, const char* lpcszHelp, FnHistogram fnHistogram)
+	{
+		bool bHeader = false;
+		for (auto& itrSeries : mapSeries)
+		{
+			const MetricsHistogram& histogram = fnHistogram(itrSeries.second);
+			if (0 == histogram.ullCount)
+				continue;
+			if (!bHeader)
+			{
+				AppendHeader(strOut, lpcszMetric, "histogram", lpcszHelp);
+				bHeader = true;
+			}
+			std::string strSeries;
+			AppendLabel(strSeries, lpcszLabel, itrSeries.first);
+			unsigned long long ullCumulative = 0;
+			for (size_t nBucket = 0; nBucket < MetricsHistogram::BUCKET_COUNT; ++nBucket)
+			{
+				ullCumulative += histogram.arrBuckets[nBucket];
+				char szBound[32] = "+Inf";
+				if (nBucket < MetricsHistogram::BUCKET_COUNT - 1)
+					snprintf(szBound, sizeof(szBound), "%g", static_cast<double>(MetricsHistogram::s_arrBoundsUs[nBucket]) / 1e6);
+				std::string strLabels = strSeries + ",";
+				AppendLabel(strLabels, "le", szBound);
+				AppendSample(strOut, lpcszMetric, "_bucket", strLabels, static_cast<double>(ullCumulative));
+			}
+			AppendSample(strOut, lpcszMetric, "_sum", strSeries, static_cast<double>(histogram.ullSumUs) / 1e6);
+			AppendSample(strOut, lpcszMetric, "_count", strSeries, static_cast<double>(histogram.ullCount));
+		}
+	}
+
+	std::string MetricsSnapshot::ToPrometheus() const
+	{
+		std::string strOut;
+		AppendCounter(strOut, mapMethods, "method", "tinymcp_messages_total", "Messages received from clients.",
+			[](const MethodMetrics& metrics) { return metrics.ullCount; });
+		AppendErrors(strOut, mapMethods, "method", "tinymcp_message_errors_total", "Messages that failed, by error code.");
+		AppendCounter(strOut, mapMethods, "method", "tinymcp_message_received_bytes_total", "Bytes of the messages received.",
+			[](const MethodMetrics& metrics) { return metrics.ullBytesIn; });
+		AppendCounter(strOut, mapMethods, "method", "tinymcp_message_sent_bytes_total", "Bytes written while dispatching the messages.",
+			[](const MethodMetrics& metrics) { return metrics.ullBytesOut; });
+		AppendHistogram(strOut, mapMethods, "method", "tinymcp_message_duration_seconds", "Time spent dispatching a message.",
+			[](const MethodMetrics& metrics) -> const MetricsHistogram& { return metrics.latency; });
+
+		AppendCounter(strOut, mapTools, "tool", "tinymcp_tool_executions_total", "Tool tasks executed.",
+			[](const MethodMetrics& metrics) { return metrics.ullCount; });
+		AppendErrors(strOut, mapTools, "tool", "tinymcp_tool_errors_total", "Tool tasks that failed, by error code.");
+		AppendCounter(strOut, mapTools, "tool", "tinymcp_tool_sent_bytes_total", "Bytes written by the tool tasks.",
+			[](const MethodMetrics& metrics) { return metrics.ullBytesOut; });
+		AppendHistogram(strOut, mapTools, "tool", "tinymcp_tool_queue_wait_seconds", "Time a tool task waited for a worker.",
+			[](const MethodMetrics& metrics) -> const MetricsHistogram& { return metrics.queueWait; });
+		AppendHistogram(strOut, mapTools, "tool", "tinymcp_tool_execution_seconds", "Time spent in Execute() of a tool task.",
+			[](const MethodMetrics& metrics) -> const MetricsHistogram& { return metrics.latency; });
+
+		return strOut;
+	}
+
+	CMCPMetrics::CMCPMetrics()
+		: m_ullInstance(s_ullNextInstance++)
+	{
+	}
+
+	CMCPMetrics::~CMCPMetrics() = default;
+
+	void CMCPMetrics::SetEnabled(bool bEnabled)
+	{
+		m_bEnabled = bEnabled;
+	}
+
+	bool CMCPMetrics::IsEnabled() const
+	{
+		return m_bEnabled.load(std::memory_order_relaxed);
+	}
+
+	void CMCPMetrics::RecordMethod(const std::string& strMethod, int iErrCode, size_t nBytesIn, size_t nBytesOut, unsigned long long ullUs)
+	{
+		if (!IsEnabled())
+			return;
+
+		auto& shard = GetShard();
+		std::lock_guard<std::mutex> _lock(shard.mtxShard);
+		auto& metrics = shard.hashMethods[strMethod];
+		++metrics.ullCount;
+		if (ERRNO_OK != iErrCode)
+			++metrics.mapErrors[iErrCode];
+		metrics.ullBytesIn += nBytesIn;
+		metrics.ullBytesOut += nBytesOut;
+		metrics.latency.Record(ullUs);
+	}
+
+	void CMCPMetrics::RecordTool(const std::string& strTool, int iErrCode, size_t nBytesOut, unsigned long long ullWaitUs, unsigned long long ullRunUs)
+	{
+		if (!IsEnabled())
+			return;
+
+		auto& shard = GetShard();
+		std::lock_guard<std::mutex> _lock(shard.mtxShard);
+		auto& metrics = shard.hashTools[strTool];
+		++metrics.ullCount;
+		if (ERRNO_OK != iErrCode)
+			++metrics.mapErrors[iErrCode];
+		metrics.ullBytesOut += nBytesOut;
+		metrics.queueWait.Record(ullWaitUs);
+		metrics.latency.Record(ullRunUs);
+	}
+
+	MetricsSnapshot CMCPMetrics::Snapshot() const
+	{
+		MetricsSnapshot snapshot;
+		std::lock_guard<std::mutex> _lock(m_mtxShards);
+		for (auto& upShard : m_vecShards)
+		{
+			std::lock_guard<std::mutex> _shardLock(upShard->mtxShard);
+			for (auto& itrMethod : upShard->hashMethods)
+			{
+				snapshot.mapMethods[itrMethod.first].Merge(itrMethod.second);
+			}
+			for (auto& itrTool : upShard->hashTools)
+			{
+				snapshot.mapTools[itrTool.first].Merge(itrTool.second);
+			}
+		}
+
+		return snapshot;
+	}
+
+	void CMCPMetrics::CountBytesWritten(size_t nBytes)
+	{
+		t_nBytesWritten += nBytes;
+	}
+
+	size_t CMCPMetrics::TakeBytesWritten()
+	{
+		size_t nBytes = t_nBytesWritten;
+		t_nBytesWritten = 0;
+
+		return nBytes;
+	}
+
+	CMCPMetrics::Shard& CMCPMetrics::GetShard()
+	{
+		// Almost always a single entry: one server per process.
+		static thread_local std::vector<std::pair<unsigned long long, Shard*>> t_vecShards;
+		for (auto& itrShard : t_vecShards)
+		{
+			if (itrShard.first == m_ullInstance)
+				return *itrShard.second;
+		}
+
+		std::lock_guard<std::mutex> _lock(m_mtxShards);
+		m_vecShards.emplace_back(new Shard());
+		t_vecShards.emplace_back(m_ullInstance, m_vecShards.back().get());
+
+		return *m_vecShards.back();
+	}
+}
@@ -0,0 +1,98 @@
+#pragma once
+// To ensure good cross-platform compatibility, the MCP namespace code uses standard C++ only.
+// Avoid using platform-specific system APIs unless absolutely necessary.
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace MCP
+{
+	// Latencies counted into fixed buckets, so that histograms of different threads add up bucket
+	// by bucket and map directly onto a Prometheus histogram.
+	struct MetricsHistogram
+	{
+		// Upper bounds in microseconds; the last bucket counts everything above.
+		static constexpr size_t BUCKET_COUNT = 17;
+		static const unsigned long long s_arrBoundsUs[BUCKET_COUNT - 1];
+
+		unsigned long long arrBuckets[BUCKET_COUNT]{};
+		unsigned long long ullCount{ 0 };
+		unsigned long long ullSumUs{ 0 };
+
+		void Record(unsigned long long ullUs);
+		void Merge(const MetricsHistogram& other);
+	};
+
+	struct MethodMetrics
+	{
+		unsigned long long ullCount{ 0 };
+		// Failures by error code (ERRNO_*, i.e. the JSON-RPC error code).
+		std::map<int, unsigned long long> mapErrors;
+		unsigned long long ullBytesIn{ 0 };
+		unsigned long long ullBytesOut{ 0 };
+		// Methods: dispatching the message, handler included. Tools: Execute().
+		MetricsHistogram latency;
+		// Tools only: committed to the scheduler -> started.
+		MetricsHistogram queueWait;
+
+		void Merge(const MethodMetrics& other);
+	};
+
+	struct MetricsSnapshot
+	{
+		std::map<std::string, MethodMetrics> mapMethods;
+		std::map<std::string, MethodMetrics> mapTools;
+
+		// The Prometheus text exposition format (version 0.0.4).
+		std::string ToPrometheus() const;
+	};
+
+	// Per-method and per-tool counters and latency histograms of a server, shared by its sessions.
+	//
+	// Every thread records into a shard of its own, so recording never contends with other threads;
+	// the shard lock is only ever taken by its thread and by Snapshot(). Shards are kept when their
+	// thread exits, so nothing recorded is lost.
+	class CMCPMetrics
+	{
+	public:
+		CMCPMetrics();
+		~CMCPMetrics();
+		CMCPMetrics(const CMCPMetrics&) = delete;
+		CMCPMetrics& operator=(const CMCPMetrics&) = delete;
+
+		void SetEnabled(bool bEnabled);
+		bool IsEnabled() const;
+
+		void RecordMethod(const std::string& strMethod, int iErrCode, size_t nBytesIn, size_t nBytesOut, unsigned long long ullUs);
+		void RecordTool(const std::string& strTool, int iErrCode, size_t nBytesOut, unsigned long long ullWaitUs, unsigned long long ullRunUs);
+		MetricsSnapshot Snapshot() const;
+
+		// Bytes written to clients by the calling thread, counted by CMCPSession::WriteMessage() and
+		// attributed to the method or tool it was dispatching or executing meanwhile.
+		static void CountBytesWritten(size_t nBytes);
+		// Returns the count since the last call and starts over.
+		static size_t TakeBytesWritten();
+
+	private:
+		struct Shard
+		{
+			std::mutex mtxShard;
+			std::unordered_map<std::string, MethodMetrics> hashMethods;
+			std::unordered_map<std::string, MethodMetrics> hashTools;
+		};
+
+		Shard& GetShard();
+
+		// Identifies the instance in the per-thread shard lookup, which must not confuse an instance
+		// with a later one allocated at the same address.
+		const unsigned long long m_ullInstance;
+		std::atomic_bool m_bEnabled{ true };
+		mutable std::mutex m_mtxShards;
+		std::vector<std::unique_ptr<Shard>> m_vecShards;
+	};
+}
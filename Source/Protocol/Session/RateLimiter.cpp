@@ -0,0 +1,84 @@
+#include "RateLimiter.h"
+#include <algorithm>
+#include <functional>
+
+namespace MCP
+{
+	bool CMCPRateLimiter::TryAcquire(const std::string& strKey, double dRate, double dBurst, Clock::time_point tpNow)
+	{
+		if (dRate <= 0)
+			return true;
+		if (dBurst < 1)
+			dBurst = (std::max)(dRate, 1.0);
+
+		auto& shard = GetShard(strKey);
+		std::lock_guard<std::mutex> _lock(shard.mtxShard);
+		if (shard.hashBuckets.size() >= SWEEP_THRESHOLD && tpNow - shard.tpSwept >= std::chrono::seconds(1))
+		{
+			shard.tpSwept = tpNow;
+			for (auto itrBucket = shard.hashBuckets.begin(); itrBucket != shard.hashBuckets.end();)
+			{
+				Refill(itrBucket->second, tpNow);
+				// A full bucket behaves like one that does not exist.
+				if (itrBucket->second.dTokens >= itrBucket->second.dBurst)
+					itrBucket = shard.hashBuckets.erase(itrBucket);
+				else
+					++itrBucket;
+			}
+		}
+
+		auto itrBucket = shard.hashBuckets.find(strKey);
+		if (itrBucket == shard.hashBuckets.end())
+		{
+			Bucket bucket;
+			bucket.dTokens = dBurst;
+			bucket.tpRefill = tpNow;
+			itrBucket = shard.hashBuckets.emplace(strKey, bucket).first;
+		}
+		auto& bucket = itrBucket->second;
+		// A reload may change the limits of a live bucket.
+		bucket.dRate = dRate;
+		bucket.dBurst = dBurst;
+		Refill(bucket, tpNow);
+		if (bucket.dTokens < 1)
+			return false;
+		bucket.dTokens -= 1;
+
+		return true;
+	}
+
+	void CMCPRateLimiter::Release(const std::string& strKey)
+	{
+		auto& shard = GetShard(strKey);
+		std::lock_guard<std::mutex> _lock(shard.mtxShard);
+		auto itrBucket = shard.hashBuckets.find(strKey);
+		if (itrBucket != shard.hashBuckets.end())
+			itrBucket->second.dTokens = (std::min)(itrBucket->second.dTokens + 1, itrBucket->second.dBurst);
+	}
+
+	size_t CMCPRateLimiter::GetBucketCount() const
+	{
+		size_t nBuckets = 0;
+		for (auto& shard : m_arrShards)
+		{
+			std::lock_guard<std::mutex> _lock(shard.mtxShard);
+			nBuckets += shard.hashBuckets.size();
+		}
+
+		return nBuckets;
+	}
+
+	CMCPRateLimiter::Shard& CMCPRateLimiter::GetShard(const std::string& strKey)
+	{
+		return m_arrShards[std::hash<std::string>()(strKey) % SHARD_COUNT];
+	}
+
+	void CMCPRateLimiter::Refill(Bucket& bucket, Clock::time_point tpNow)
+	{
+		if (tpNow <= bucket.tpRefill)
+			return;
+		double dElapsedS = std::chrono::duration<double>(tpNow - bucket.tpRefill).count();
+		bucket.dTokens = (std::min)(bucket.dBurst, bucket.dTokens + dElapsedS * bucket.dRate);
+		bucket.tpRefill = tpNow;
+	}
+}
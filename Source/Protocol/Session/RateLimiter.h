@@ -0,0 +1,58 @@
+#pragma once
+// To ensure good cross-platform compatibility, the MCP namespace code uses standard C++ only.
+// Avoid using platform-specific system APIs unless absolutely necessary.
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace MCP
+{
+	// Token buckets by key (a client identity, a tool name), shared by all sessions.
+	//
+	// A bucket holds up to dBurst tokens and refills at dRate tokens per second; every admitted call
+	// takes one. Buckets are created full on first use, and those refilled completely are dropped
+	// once a shard holds many, so keys of clients that went away do not accumulate.
+	class CMCPRateLimiter
+	{
+	public:
+		using Clock = std::chrono::steady_clock;
+
+		CMCPRateLimiter() = default;
+		CMCPRateLimiter(const CMCPRateLimiter&) = delete;
+		CMCPRateLimiter& operator=(const CMCPRateLimiter&) = delete;
+
+		// Takes a token from the bucket of strKey; false when it is empty. dRate <= 0 admits everything.
+		// dBurst < 1 lets a key take one second worth of tokens at once.
+		bool TryAcquire(const std::string& strKey, double dRate, double dBurst, Clock::time_point tpNow = Clock::now());
+		// Gives back the token of a call refused by a later check.
+		void Release(const std::string& strKey);
+		size_t GetBucketCount() const;
+
+	private:
+		struct Bucket
+		{
+			double dTokens{ 0 };
+			double dRate{ 0 };
+			double dBurst{ 0 };
+			Clock::time_point tpRefill;
+		};
+
+		struct Shard
+		{
+			mutable std::mutex mtxShard;
+			std::unordered_map<std::string, Bucket> hashBuckets;
+			Clock::time_point tpSwept;
+		};
+
+		static constexpr size_t SHARD_COUNT = 16;
+		// Buckets per shard beyond which the full ones are dropped, at most once a second.
+		static constexpr size_t SWEEP_THRESHOLD = 256;
+
+		Shard& GetShard(const std::string& strKey);
+		static void Refill(Bucket& bucket, Clock::time_point tpNow);
+
+		Shard m_arrShards[SHARD_COUNT];
+	};
+}
@@ -0,0 +1,64 @@
+#include "ResourceCache.h"
+
+namespace MCP
+{
+	void CMCPResourceCache::SetCapacity(size_t nMaxBytes)
+	{
+		std::lock_guard<std::mutex> _lock(m_mtxCache);
+		m_nMaxBytes = nMaxBytes;
+		while (m_nBytes > m_nMaxBytes && !m_lstRecent.empty())
+			Erase(m_hashEntries.find(m_lstRecent.front()));
+	}
+
+	bool CMCPResourceCache::GetResponse(const std::string& strUri, unsigned long long ullVersion, const MCP::RequestId& requestId, std::string& strResponse)
+	{
+		std::lock_guard<std::mutex> _lock(m_mtxCache);
+		auto itEntry = m_hashEntries.find(strUri);
+		if (itEntry == m_hashEntries.end())
+			return false;
+		if (itEntry->second.ullVersion != ullVersion)
+		{
+			Erase(itEntry);
+			return false;
+		}
+
+		m_lstRecent.splice(m_lstRecent.end(), m_lstRecent, itEntry->second.itRecent);
+		MCP::Response::WrapResult(requestId, itEntry->second.strResult, strResponse);
+
+		return true;
+	}
+
+	void CMCPResourceCache::Put(const std::string& strUri, unsigned long long ullVersion, const std::string& strResult)
+	{
+		std::lock_guard<std::mutex> _lock(m_mtxCache);
+		auto itEntry = m_hashEntries.find(strUri);
+		if (itEntry != m_hashEntries.end())
+			Erase(itEntry);
+		if (strResult.size() > m_nMaxBytes / 8)
+			return;
+
+		while (m_nBytes + strResult.size() > m_nMaxBytes && !m_lstRecent.empty())
+			Erase(m_hashEntries.find(m_lstRecent.front()));
+		Entry entry;
+		entry.ullVersion = ullVersion;
+		entry.strResult = strResult;
+		entry.itRecent = m_lstRecent.insert(m_lstRecent.end(), strUri);
+		m_nBytes += strResult.size();
+		m_hashEntries.emplace(strUri, std::move(entry));
+	}
+
+	void CMCPResourceCache::Invalidate(const std::string& strUri)
+	{
+		std::lock_guard<std::mutex> _lock(m_mtxCache);
+		auto itEntry = m_hashEntries.find(strUri);
+		if (itEntry != m_hashEntries.end())
+			Erase(itEntry);
+	}
+
+	void CMCPResourceCache::Erase(std::unordered_map<std::string, Entry>::iterator itEntry)
+	{
+		m_nBytes -= itEntry->second.strResult.size();
+		m_lstRecent.erase(itEntry->second.itRecent);
+		m_hashEntries.erase(itEntry);
+	}
+}
@@ -0,0 +1,51 @@
+#pragma once
+// To ensure good cross-platform compatibility, the MCP namespace code uses standard C++ only.
+// Avoid using platform-specific system APIs unless absolutely necessary.
+
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "../Message/Response.h"
+
+namespace MCP
+{
+	// Serialized resources/read results, keyed by uri and shared by all sessions.
+	//
+	// An entry holds the "result" value for one version of the resource, as reported by
+	// CMCPResourceProvider::GetResourceVersion(); a read finding another version misses, so a
+	// changed resource is never served from the cache. The least recently used entries are dropped
+	// beyond [resources] read_cache_bytes, and results larger than an eighth of it are not kept.
+	class CMCPResourceCache
+	{
+	public:
+		CMCPResourceCache() = default;
+		CMCPResourceCache(const CMCPResourceCache&) = delete;
+		CMCPResourceCache& operator=(const CMCPResourceCache&) = delete;
+
+		// 0 disables the cache.
+		void SetCapacity(size_t nMaxBytes);
+
+		// Fills strResponse with the complete response message on a hit.
+		bool GetResponse(const std::string& strUri, unsigned long long ullVersion, const MCP::RequestId& requestId, std::string& strResponse);
+		void Put(const std::string& strUri, unsigned long long ullVersion, const std::string& strResult);
+		void Invalidate(const std::string& strUri);
+
+	private:
+		struct Entry
+		{
+			unsigned long long ullVersion{ 0 };
+			std::string strResult;
+			std::list<std::string>::iterator itRecent;
+		};
+
+		void Erase(std::unordered_map<std::string, Entry>::iterator itEntry);
+
+		std::mutex m_mtxCache;
+		size_t m_nMaxBytes{ 0 };
+		size_t m_nBytes{ 0 };
+		// Least recently used first.
+		std::list<std::string> m_lstRecent;
+		std::unordered_map<std::string, Entry> m_hashEntries;
+	};
+}
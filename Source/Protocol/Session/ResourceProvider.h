@@ -0,0 +1,33 @@
+#pragma once
+// To ensure good cross-platform compatibility, the MCP namespace code uses standard C++ only.
+// Avoid using platform-specific system APIs unless absolutely necessary.
+
+#include <string>
+#include <vector>
+#include "../Message/BasicMessage.h"
+#include "../Message/Request.h"
+#include "../Message/Response.h"
+
+namespace MCP
+{
+	// Serves resources/read, and supplies the resources listed by resources/list.
+	// Registered with CMCPServer::RegisterResourceProvider(); called from any session thread.
+	class CMCPResourceProvider
+	{
+	public:
+		virtual ~CMCPResourceProvider() {}
+
+		virtual int ListResources(std::vector<MCP::Resource>& vecResources) = 0;
+		// Adds the contents of the requested resource to result. Returns ERRNO_INVALID_PARAMS for
+		// an unknown uri or range; contents may reference data owned by the provider (see BinaryData).
+		virtual int ReadResource(const MCP::ReadResourceRequest& request, MCP::ReadResourceResult& result) = 0;
+		// A value that changes whenever the content of the resource may have changed (a modification
+		// time, a revision...), checked before reads are served from the cache and by the watcher of
+		// subscribed resources. Providers returning false are neither cached nor watched; they call
+		// CMCPServer::NotifyResourceUpdated() themselves.
+		virtual bool GetResourceVersion(const std::string& /*strUri*/, unsigned long long& /*ullVersion*/)
+		{
+			return false;
+		}
+	};
+}
@@ -0,0 +1,202 @@
+#include "ResourceWatcher.h"
+#include "Session.h"
+#include "../Message/JsonWriter.h"
+#include <algorithm>
+#include <chrono>
+#include <functional>
+
+namespace MCP
+{
+	CMCPResourceWatcher::~CMCPResourceWatcher()
+	{
+		Stop();
+	}
+
+	int CMCPResourceWatcher::Start(const std::shared_ptr<CMCPResourceProvider>& spProvider, CMCPResourceCache& cache, unsigned int nIntervalMs)
+	{
+		if (!spProvider)
+			return ERRNO_INTERNAL_ERROR;
+
+		std::lock_guard<std::mutex> _lock(m_mtxWatches);
+		if (m_bRunning)
+			return ERRNO_OK;
+		m_spProvider = spProvider;
+		m_pCache = &cache;
+		m_nIntervalMs = nIntervalMs > 0 ? nIntervalMs : 1;
+		m_bRunning = true;
+		m_thrWatcher = std::thread(&CMCPResourceWatcher::WatcherThreadProc, this);
+
+		return ERRNO_OK;
+	}
+
+	int CMCPResourceWatcher::Stop()
+	{
+		{
+			std::lock_guard<std::mutex> _lock(m_mtxWatches);
+			m_bRunning = false;
+			m_cvWatches.notify_all();
+		}
+		if (m_thrWatcher.joinable())
+			m_thrWatcher.join();
+
+		std::lock_guard<std::mutex> _lock(m_mtxWatches);
+		m_hashWatches.clear();
+
+		return ERRNO_OK;
+	}
+
+	void CMCPResourceWatcher::Subscribe(const std::string& strUri, const std::shared_ptr<CMCPSession>& spSession)
+	{
+		// The version at subscription time, so a change before the first check is not missed.
+		unsigned long long ullVersion = 0;
+		bool bVersioned = m_spProvider && m_spProvider->GetResourceVersion(strUri, ullVersion);
+
+		std::lock_guard<std::mutex> _lock(m_mtxWatches);
+		auto itWatch = m_hashWatches.find(strUri);
+		if (itWatch == m_hashWatches.end())
+		{
+			Watch watch;
+			watch.bVersioned = bVersioned;
+			watch.ullVersion = ullVersion;
+			itWatch = m_hashWatches.emplace(strUri, std::move(watch)).first;
+		}
+		auto& vecSessions = itWatch->second.vecSessions;
+		for (auto& wpSession : vecSessions)
+		{
+			if (wpSession.lock() == spSession)
+				return;
+		}
+		vecSessions.push_back(spSession);
+	}
+
+	void CMCPResourceWatcher::Unsubscribe(const std::string& strUri, const CMCPSession* pSession)
+	{
+		std::lock_guard<std::mutex> _lock(m_mtxWatches);
+		auto itWatch = m_hashWatches.find(strUri);
+		if (itWatch == m_hashWatches.end())
+			return;
+		auto& vecSessions = itWatch->second.vecSessions;
+		vecSessions.erase(std::remove_if(vecSessions.begin(), vecSessions.end(), [pSession](const std::weak_ptr<CMCPSession>& wpSession)
+			{
+				auto spSession = wpSession.lock();
+				return !spSession || spSession.get() == pSession;
+			}), vecSessions.end());
+		if (vecSessions.empty())
+			m_hashWatches.erase(itWatch);
+	}
+
+	void CMCPResourceWatcher::NotifyUpdated(const std::string& strUri)
+	{
+		if (m_pCache)
+			m_pCache->Invalidate(strUri);
+
+		std::vector<std::weak_ptr<CMCPSession>> vecSessions;
+		{
+			std::lock_guard<std::mutex> _lock(m_mtxWatches);
+			auto itWatch = m_hashWatches.find(strUri);
+			if (itWatch == m_hashWatches.end())
+				return;
+			// The next check takes the current content as its reference.
+			itWatch->second.bHashed = false;
+			itWatch->second.bVersioned = false;
+			vecSessions = itWatch->second.vecSessions;
+		}
+		NotifySessions(strUri, vecSessions);
+	}
+
+	void CMCPResourceWatcher::WatcherThreadProc()
+	{
+		std::unique_lock<std::mutex> _lock(m_mtxWatches);
+		while (true)
+		{
+			m_cvWatches.wait_for(_lock, std::chrono::milliseconds(m_nIntervalMs), [this]() { return !m_bRunning; });
+			if (!m_bRunning)
+				break;
+
+			std::vector<std::pair<std::string, Watch>> vecChecks;
+			vecChecks.reserve(m_hashWatches.size());
+			for (auto& watch : m_hashWatches)
+			{
+				Watch state;
+				state.bVersioned = watch.second.bVersioned;
+				state.ullVersion = watch.second.ullVersion;
+				state.bHashed = watch.second.bHashed;
+				state.nHash = watch.second.nHash;
+				vecChecks.emplace_back(watch.first, std::move(state));
+			}
+
+			// The provider is asked without the lock: reads may take a while.
+			_lock.unlock();
+			for (auto& check : vecChecks)
+			{
+				const std::string& strUri = check.first;
+				const Watch& state = check.second;
+				unsigned long long ullVersion = 0;
+				if (!m_spProvider->GetResourceVersion(strUri, ullVersion))
+					continue;
+				if (state.bHashed && ullVersion == state.ullVersion)
+					continue;
+
+				size_t nHash = ReadContent(strUri, ullVersion);
+				// Without a reference content, only a version that moved since the subscription is a change.
+				bool bChanged = false;
+				if (state.bHashed)
+					bChanged = nHash != state.nHash;
+				else if (state.bVersioned)
+					bChanged = ullVersion != state.ullVersion;
+
+				std::vector<std::weak_ptr<CMCPSession>> vecSessions;
+				{
+					std::lock_guard<std::mutex> _lockWatch(m_mtxWatches);
+					auto itWatch = m_hashWatches.find(strUri);
+					if (itWatch == m_hashWatches.end())
+						continue;
+					itWatch->second.bVersioned = true;
+					itWatch->second.ullVersion = ullVersion;
+					itWatch->second.bHashed = true;
+					itWatch->second.nHash = nHash;
+					if (bChanged)
+						vecSessions = itWatch->second.vecSessions;
+				}
+				if (bChanged)
+					NotifySessions(strUri, vecSessions);
+			}
+			_lock.lock();
+		}
+	}
+
+	size_t CMCPResourceWatcher::ReadContent(const std::string& strUri, unsigned long long ullVersion)
+	{
+		MCP::ReadResourceRequest request(false);
+		request.strMethod = METHOD_RESOURCES_READ;
+		request.strUri = strUri;
+		MCP::ReadResourceResult result(false);
+		if (ERRNO_OK != m_spProvider->ReadResource(request, result))
+		{
+			m_pCache->Invalidate(strUri);
+			return 0;
+		}
+
+		std::string strResult;
+		CMCPJsonWriter writer(strResult);
+		result.WriteResult(writer);
+		// A resource changing while it was read is cached by the next read.
+		unsigned long long ullReadVersion = 0;
+		if (m_spProvider->GetResourceVersion(strUri, ullReadVersion) && ullReadVersion == ullVersion)
+			m_pCache->Put(strUri, ullVersion, strResult);
+		else
+			m_pCache->Invalidate(strUri);
+
+		return std::hash<std::string>()(strResult);
+	}
+
+	void CMCPResourceWatcher::NotifySessions(const std::string& strUri, const std::vector<std::weak_ptr<CMCPSession>>& vecSessions)
+	{
+		for (auto& wpSession : vecSessions)
+		{
+			auto spSession = wpSession.lock();
+			if (spSession)
+				spSession->NotifyResourceUpdated(strUri);
+		}
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+// To ensure good cross-platform compatibility, the MCP namespace code uses standard C++ only.
+// Avoid using platform-specific system APIs unless absolutely necessary.
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "ResourceProvider.h"
+#include "ResourceCache.h"
+
+namespace MCP
+{
+	class CMCPSession;
+
+	// Sends notifications/resources/updated to the sessions subscribed to a resource.
+	//
+	// Every [resources] watch_interval_ms one thread asks the provider for the version of each
+	// subscribed resource. Only when it changed the resource is read again, and the subscribers are
+	// notified only when the serialized content differs from what was read before, so touching a
+	// file does not wake the clients. The new content replaces the cache entry on the way.
+	class CMCPResourceWatcher
+	{
+	public:
+		CMCPResourceWatcher() = default;
+		~CMCPResourceWatcher();
+		CMCPResourceWatcher(const CMCPResourceWatcher&) = delete;
+		CMCPResourceWatcher& operator=(const CMCPResourceWatcher&) = delete;
+
+		int Start(const std::shared_ptr<CMCPResourceProvider>& spProvider, CMCPResourceCache& cache, unsigned int nIntervalMs);
+		int Stop();
+
+		void Subscribe(const std::string& strUri, const std::shared_ptr<CMCPSession>& spSession);
+		void Unsubscribe(const std::string& strUri, const CMCPSession* pSession);
+		// Notifies the subscribers right away, for providers that know when their resources change.
+		void NotifyUpdated(const std::string& strUri);
+
+	private:
+		struct Watch
+		{
+			std::vector<std::weak_ptr<CMCPSession>> vecSessions;
+			bool bVersioned{ false };
+			unsigned long long ullVersion{ 0 };
+			// Whether nHash holds the content matching ullVersion.
+			bool bHashed{ false };
+			size_t nHash{ 0 };
+		};
+
+		void WatcherThreadProc();
+		// Reads the resource, returning a hash of its content (0 when it cannot be read).
+		size_t ReadContent(const std::string& strUri, unsigned long long ullVersion);
+		static void NotifySessions(const std::string& strUri, const std::vector<std::weak_ptr<CMCPSession>>& vecSessions);
+
+		std::shared_ptr<CMCPResourceProvider> m_spProvider;
+		CMCPResourceCache* m_pCache{ nullptr };
+		unsigned int m_nIntervalMs{ 1000 };
+
+		std::mutex m_mtxWatches;
+		std::condition_variable m_cvWatches;
+		bool m_bRunning{ false };
+		std::unordered_map<std::string, Watch> m_hashWatches;
+		std::thread m_thrWatcher;
+	};
+}
@@ -0,0 +1,55 @@
+#pragma once
+// To ensure good cross-platform compatibility, the MCP namespace code uses standard C++ only.
+// Avoid using platform-specific system APIs unless absolutely necessary.
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include "../Message/BasicMessage.h"
+#include "../Message/SchemaValidator.h"
+#include "../Task/BasicTask.h"
+#include "../Task/TaskPool.h"
+#include "MethodRegistry.h"
+#include "ListCache.h"
+#include "ResourceProvider.h"
+
+namespace MCP
+{
+	// The tools of a server and what serves their calls. Never modified once published: registering
+	// tools copies the current one, changes the copy and replaces it as a whole, so a tools/call keeps
+	// the tables it started with while the tools change under it.
+	struct ServerTools
+	{
+		std::vector<MCP::Tool> vecTools;
+		bool bPagination{ false };
+		// The input schemas of vecTools by tool name, compiled on the first call of each tool so that
+		// arguments are checked without walking the schema; shared by the copies made when the tools
+		// are registered again.
+		std::unordered_map<std::string, std::shared_ptr<const MCP::CMCPLazySchemaValidator>> hashValidators;
+		// The pools handing out clones of the prototype task of every tool to its calls.
+		std::unordered_map<std::string, std::shared_ptr<MCP::CMCPTaskPool>> hashCallToolsPools;
+		std::unordered_map<std::string, size_t> hashToolsConcurrency;
+		// Tools whose results are cached, with the lifetime of their entries in milliseconds.
+		std::unordered_map<std::string, unsigned int> hashToolsCacheTtl;
+	};
+
+	// Everything a server declares about itself: built once by CMCPServer before Start()
+	// and shared read-only by every session, so accepting a client copies nothing.
+	// The tools may be registered again while serving; see spTools.
+	struct ServerDefinition
+	{
+		MCP::Implementation serverInfo;
+		MCP::ServerCapabilities capabilities;
+		// Replaced as a whole with std::atomic_store() when tools are registered, read with
+		// std::atomic_load(); never null.
+		std::shared_ptr<const ServerTools> spTools{ std::make_shared<const ServerTools>() };
+		// Serialized list results, rebuilt whenever their items are registered.
+		CMCPListCache toolsList{ MSG_KEY_TOOLS };
+		CMCPListCache resourcesList{ MSG_KEY_RESOURCES };
+		CMCPListCache promptsList{ MSG_KEY_PROMPTS };
+		// Serves resources/read; none answers every read with invalid params.
+		std::shared_ptr<MCP::CMCPResourceProvider> spResourceProvider;
+		CMCPMethodRegistry methodRegistry;
+	};
+}
@@ -1,30 +1,76 @@
 #include "Session.h"
+#include "SessionManager.h"
 #include "../Public/PublicDef.h"
 #include "../Public/Config.h"
+#include "../Public/Trace.h"
 #include "../Message/BasicMessage.h"
 #include "../Message/Notification.h"
 #include "../Message/Request.h"
 #include "../Message/Response.h"
+#include "../Message/FlatBuffersCodec.h"
+#include "../Message/JsonWriter.h"
 #include "../Task/BasicTask.h"
+#include "MessageArena.h"
 
 #include <memory>
 #include <algorithm>
+#include <chrono>
 #include <json/json.h>
 
 namespace MCP
 {
-	CMCPSession CMCPSession::s_Instance;
+	// Parse trees never outlive ProcessFrame(), so every thread dispatching frames parses into one
+	// arena that ProcessFrame() releases in one go. nullptr when [session] message_arena_bytes is 0.
+	static CMCPMessageArena* GetThreadMessageArena()
+	{
+		static const int s_iArenaBytes = Config::GetInstance().GetMessageArenaBytes();
+		if (s_iArenaBytes <= 0)
+			return nullptr;
+		thread_local CMCPMessageArena s_arena(static_cast<size_t>(s_iArenaBytes));
+		return &s_arena;
+	}
+
+	// Numbers the sessions for the rate limit keys of unauthenticated clients.
+	static std::atomic<unsigned long long> s_ullNextSession{ 1 };
+
+	// The answer to a batch element that is no message, or to an empty batch: there is no id to
+	// answer with, so it carries a null one.
+	static void BuildInvalidRequestError(std::string& strResponse)
+	{
+		CMCPJsonWriter writer(strResponse);
+		writer.StartObject();
+		writer.Key(MSG_KEY_ERROR);
+		writer.StartObject();
+		writer.Key(MSG_KEY_CODE);
+		writer.Int(ERRNO_INVALID_REQUEST);
+		writer.Key(MSG_KEY_MESSAGE);
+		writer.String(ERROR_MESSAGE_INVALID_REQUEST);
+		writer.EndObject();
+		writer.Key(MSG_KEY_ID);
+		writer.Null();
+		writer.Key(MSG_KEY_JSONRPC);
+		writer.String(JSON_RPC_VER);
+		writer.EndObject();
+	}
 
-	CMCPSession& CMCPSession::GetInstance()
+	CMCPSession::CMCPSession(const std::shared_ptr<const ServerDefinition>& spDefinition, CMCPSessionManager& manager, const std::shared_ptr<CMCPTransport>& spTransport)
+		: m_spTransport(spTransport)
+		, m_spDefinition(spDefinition)
+		, m_manager(manager)
 	{
-		return s_Instance;
+		// A principal may hold several sessions, which then share its bucket.
+		const std::string& strPrincipal = spTransport ? spTransport->GetPrincipal() : std::string();
+		m_strRateLimitKey = strPrincipal.empty() ? "session:" + std::to_string(s_ullNextSession++) : "principal:" + strPrincipal;
 	}
 
 	int CMCPSession::Ready()
 	{
-		if (!m_spTransport)
+		if (!m_spTransport || !m_spDefinition)
 			return ERRNO_INTERNAL_ERROR;
 
+		int iHistorySize = Config::GetInstance().GetSessionHistorySize();
+		m_messageHistory.SetCapacity(iHistorySize > 0 ? static_cast<size_t>(iHistorySize) : 0);
+
 		int iErrCode = ERRNO_OK;
 		iErrCode = m_spTransport->Connect();
 		if (ERRNO_OK != iErrCode)
@@ -42,13 +88,12 @@ namespace MCP
 
 		while (true)
 		{
-			std::string strIncomingMsg;
-			iErrCode = m_spTransport->Read(strIncomingMsg);
+			const char* pBegin = nullptr;
+			const char* pEnd = nullptr;
+			iErrCode = m_spTransport->ReadFrame(pBegin, pEnd);
 			if (ERRNO_OK == iErrCode)
 			{
-				std::shared_ptr<MCP::Message> spMsg;
-				iErrCode = ParseMessage(strIncomingMsg, spMsg);
-				iErrCode = ProcessMessage(iErrCode, spMsg);
+				iErrCode = ProcessFrame(pBegin, pEnd);
 			}
 			else
 			{
@@ -59,11 +104,166 @@ namespace MCP
 		return iErrCode;
 	}
 
+	int CMCPSession::ProcessFrame(const char* pBegin, const char* pEnd)
+	{
+		int iErrCode = ERRNO_OK;
+		{
+			// Scoped: the tree is destroyed before its arena blocks are dropped.
+			Json::Value jVal;
+			std::shared_ptr<MCP::Message> spMsg;
+			{
+				MCP_TRACE_SCOPE("parse");
+				if (m_bFlatBuffers.load(std::memory_order_acquire))
+					iErrCode = DecodeFrame(pBegin, pEnd, jVal);
+				else
+					iErrCode = ParseFrame(pBegin, pEnd, jVal);
+				if (ERRNO_OK == iErrCode && !jVal.isArray())
+				{
+					iErrCode = ParseMessage(jVal, spMsg);
+					if (spMsg)
+					{
+						spMsg->Stamp();
+						MCP_TRACE_SET_ID(spMsg->ulRuntimeId);
+					}
+				}
+			}
+			if (ERRNO_OK == iErrCode && jVal.isArray())
+			{
+				iErrCode = ProcessBatch(jVal, static_cast<size_t>(pEnd - pBegin));
+			}
+			else
+			{
+				RecordMessage(spMsg, static_cast<size_t>(pEnd - pBegin), iErrCode);
+				iErrCode = ProcessMessage(iErrCode, spMsg, static_cast<size_t>(pEnd - pBegin));
+			}
+		}
+
+		MCP_TRACE_SET_ID(0);
+
+		auto pArena = GetThreadMessageArena();
+		if (pArena)
+			pArena->Reset();
+
+		return iErrCode;
+	}
+
+	int CMCPSession::ProcessBatch(const Json::Value& jBatch, size_t nSize)
+	{
+		// As JSON-RPC 2.0 asks, an empty batch gets a single error, and every element that is not a
+		// message an error of its own within the batch.
+		if (jBatch.empty())
+		{
+			std::string strResponse;
+			BuildInvalidRequestError(strResponse);
+			WriteMessage(strResponse);
+			return ERRNO_INVALID_REQUEST;
+		}
+
+		// spMsg is nullptr for the elements that are not a message.
+		std::vector<std::pair<int, std::shared_ptr<MCP::Message>>> vecMessages;
+		vecMessages.reserve(jBatch.size());
+		for (Json::ArrayIndex nIndex = 0; nIndex < jBatch.size(); ++nIndex)
+		{
+			std::shared_ptr<MCP::Message> spMsg;
+			int iErrCode = ParseMessage(jBatch[nIndex], spMsg);
+			vecMessages.emplace_back(iErrCode, std::move(spMsg));
+		}
+
+		// Every request is registered before the first one is processed, so that the batch cannot
+		// complete while some of its requests have not been dispatched yet.
+		bool bStreamResponses = Config::GetInstance().GetBatchStreamResponses();
+		std::shared_ptr<CMCPBatchResponse> spBatch;
+		// By element: a request whose id is already waiting for its response.
+		std::vector<bool> vecDuplicates(vecMessages.size(), false);
+		if (!bStreamResponses)
+		{
+			size_t nResponses = 0;
+			for (auto& itrMsg : vecMessages)
+			{
+				if (!itrMsg.second || MessageCategory_Request == itrMsg.second->eMessageCategory)
+					++nResponses;
+			}
+			if (nResponses > 0)
+			{
+				spBatch = std::make_shared<CMCPBatchResponse>(nResponses);
+				std::lock_guard<std::mutex> _lock(m_mtxBatches);
+				for (size_t nIndex = 0; nIndex < vecMessages.size(); ++nIndex)
+				{
+					auto& spMsg = vecMessages[nIndex].second;
+					if (!spMsg || MessageCategory_Request != spMsg->eMessageCategory)
+						continue;
+					auto& requestId = std::static_pointer_cast<MCP::Request>(spMsg)->requestId;
+					if (m_hashBatchedRequests.emplace(requestId, spBatch).second)
+						++m_nBatchedRequests;
+					else
+						vecDuplicates[nIndex] = true;
+				}
+			}
+		}
+
+		// Answers within the batch, or on their own when the responses are streamed.
+		auto fnAnswer = [this, &spBatch](const std::string& strResponse)
+			{
+				if (!spBatch)
+				{
+					WriteMessage(strResponse);
+					return;
+				}
+				std::string strBatch;
+				if (spBatch->Add(strResponse, strBatch) && !strBatch.empty() && m_spTransport)
+					WriteMessage(strBatch);
+			};
+
+		size_t nElementSize = nSize / vecMessages.size();
+		for (size_t nIndex = 0; nIndex < vecMessages.size(); ++nIndex)
+		{
+			int iErrCode = vecMessages[nIndex].first;
+			auto& spMsg = vecMessages[nIndex].second;
+			if (!spMsg)
+			{
+				std::string strResponse;
+				BuildInvalidRequestError(strResponse);
+				fnAnswer(strResponse);
+				continue;
+			}
+			spMsg->Stamp();
+			MCP_TRACE_SET_ID(spMsg->ulRuntimeId);
+			if (vecDuplicates[nIndex])
+			{
+				RecordMessage(spMsg, nElementSize, ERRNO_INVALID_REQUEST);
+				MCP::ErrorResponse errorResponse(true);
+				errorResponse.requestId = std::static_pointer_cast<MCP::Request>(spMsg)->requestId;
+				errorResponse.iCode = ERRNO_INVALID_REQUEST;
+				errorResponse.strMesage = ERROR_MESSAGE_DUPLICATE_REQUEST_ID;
+				std::string strResponse;
+				errorResponse.Serialize(strResponse);
+				fnAnswer(strResponse);
+				continue;
+			}
+			RecordMessage(spMsg, nElementSize, iErrCode);
+			ProcessMessage(iErrCode, spMsg, nElementSize);
+		}
+
+		return ERRNO_OK;
+	}
+
 	int CMCPSession::Terminate()
 	{
-		StopAsyncTaskThread();
-		if (m_upTaskThread && m_upTaskThread->joinable())
-			m_upTaskThread->join();
+		if (m_bTerminated.exchange(true))
+			return ERRNO_OK;
+
+		StopAsyncTasks();
+
+		std::set<std::string> setSubscriptions;
+		{
+			std::lock_guard<std::mutex> _lock(m_mtxSubscriptions);
+			setSubscriptions.swap(m_setSubscriptions);
+		}
+		for (auto& strUri : setSubscriptions)
+		{
+			m_manager.UnsubscribeResource(strUri, this);
+		}
+		m_manager.GetClientLogSink().RemoveSession(this);
 
 		if (!m_spTransport)
 			return ERRNO_INTERNAL_ERROR;
@@ -76,541 +276,735 @@ namespace MCP
 		return iErrCode;
 	}
 
-	int CMCPSession::ProcessMessage(int iErrCode, const std::shared_ptr<MCP::Message>& spMsg)
+	int CMCPSession::ProcessMessage(int iErrCode, const std::shared_ptr<MCP::Message>& spMsg, size_t nSize)
 	{
-		if (!spMsg || !spMsg->IsValid())
+		if (!spMsg)
 			return ERRNO_INTERNAL_ERROR;
 
+		auto& metrics = m_manager.GetMetrics();
+		const std::string* pstrMethod = nullptr;
 		switch (spMsg->eMessageCategory)
 		{
 			case MessageCategory_Request:
 			{
-				return ProcessRequest(iErrCode, spMsg);
+				pstrMethod = &std::static_pointer_cast<MCP::Request>(spMsg)->strMethod;
+			} break;
+			case MessageCategory_Notification:
+			{
+				pstrMethod = &std::static_pointer_cast<MCP::Notification>(spMsg)->strMethod;
 			} break;
 			case MessageCategory_Response:
 			{
 				return ProcessResponse(iErrCode, spMsg);
 			} break;
+			default:
+			{
+				return ERRNO_INTERNAL_ERROR;
+			} break;
+		}
+		if (!metrics.IsEnabled())
+		{
+			if (MessageCategory_Request == spMsg->eMessageCategory)
+				return ProcessRequest(iErrCode, spMsg);
+			return ProcessNotification(iErrCode, spMsg);
+		}
+
+		CMCPMetrics::TakeBytesWritten();
+		auto tpStart = std::chrono::steady_clock::now();
+		if (MessageCategory_Request == spMsg->eMessageCategory)
+			iErrCode = ProcessRequest(iErrCode, spMsg);
+		else
+			iErrCode = ProcessNotification(iErrCode, spMsg);
+		auto ullUs = static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::steady_clock::now() - tpStart).count());
+
+		// Methods nobody registered share one series, so clients cannot grow the label set at will.
+		static const std::string s_strUnknownMethod = "(unknown)";
+		if (!m_spDefinition->methodRegistry.Find(spMsg->eMessageCategory, *pstrMethod))
+			pstrMethod = &s_strUnknownMethod;
+		metrics.RecordMethod(*pstrMethod, iErrCode, nSize, CMCPMetrics::TakeBytesWritten(), ullUs);
+
+		return iErrCode;
+	}
+
+	void CMCPSession::RecordMessage(const std::shared_ptr<MCP::Message>& spMsg, size_t nSize, int iErrCode)
+	{
+		if (!spMsg)
+			return;
+
+		MessageRecord record;
+		record.eCategory = spMsg->eMessageCategory;
+		record.ulRuntimeId = spMsg->ulRuntimeId;
+		record.nSize = nSize;
+		record.ullReceivedMs = spMsg->ullTimestamp ? spMsg->ullTimestamp : CMCPMessageHistory::NowMs();
+		record.iStatus = iErrCode;
+		switch (spMsg->eMessageCategory)
+		{
+			case MessageCategory_Request:
+			{
+				auto spRequest = std::static_pointer_cast<MCP::Request>(spMsg);
+				record.requestId = spRequest->requestId;
+				record.strMethod = spRequest->strMethod;
+			} break;
+			case MessageCategory_Response:
+			{
+				auto spResponse = std::static_pointer_cast<MCP::Response>(spMsg);
+				record.requestId = spResponse->requestId;
+				record.ullCompletedMs = record.ullReceivedMs;
+			} break;
 			case MessageCategory_Notification:
 			{
-				return ProcessNotification(iErrCode, spMsg);
+				auto spNotification = std::static_pointer_cast<MCP::Notification>(spMsg);
+				record.strMethod = spNotification->strMethod;
+				record.ullCompletedMs = record.ullReceivedMs;
 			} break;
 			default: break;
 		}
 
-		return ERRNO_INTERNAL_ERROR;
+		m_messageHistory.Record(std::move(record));
+	}
+
+	std::vector<MCP::MessageRecord> CMCPSession::GetMessageHistory() const
+	{
+		return m_messageHistory.GetRecords();
 	}
 
 	int CMCPSession::ProcessRequest(int iErrCode, const std::shared_ptr<MCP::Message>& spMsg)
 	{
-		std::shared_ptr<MCP::Request> spRequest{ nullptr };
+		std::shared_ptr<MCP::Request> spRequest = std::dynamic_pointer_cast<MCP::Request>(spMsg);
+		const MethodEntry* pEntry{ nullptr };
 		std::string strMessage;
 
+		if (!spRequest)
+			return ERRNO_INTERNAL_ERROR;
 		if (ERRNO_OK != iErrCode)
 		{
 			goto PROC_END;
 		}
-		if (!spMsg || !spMsg->IsValid())
+		if (!spRequest->IsValid())
 		{
-			iErrCode = ERRNO_INTERNAL_ERROR;
+			iErrCode = ERRNO_INVALID_REQUEST;
 			goto PROC_END;
 		}
-		spRequest = std::dynamic_pointer_cast<MCP::Request>(spMsg);
-		if (!spRequest)
+		// Authorization check
+		{
+			MCP_TRACE_SCOPE("authorize");
+			iErrCode = AuthorizeRequest(spRequest);
+		}
+		if (ERRNO_OK != iErrCode)
 		{
-			iErrCode = ERRNO_INTERNAL_ERROR;
 			goto PROC_END;
 		}
-    m_hashMessage[MessageCategory_Request].push_back(spMsg);
-
-    // Authorization check (placeholder, always OK for now)
-    iErrCode = AuthorizeRequest(spRequest);
-    if (ERRNO_OK != iErrCode)
-    {
-        goto PROC_END;
-    }
 
-		switch (spRequest->eMessageType)
+		pEntry = m_spDefinition->methodRegistry.Find(MessageCategory_Request, spRequest->strMethod);
+		if (!pEntry)
 		{
-			case MessageType_InitializeRequest:
-			{
-				if (CMCPSession::SessionState_Original != CMCPSession::GetInstance().GetSessionState())
-				{
-					strMessage = ERROR_MESSAGE_INVALID_REQUEST;
-					iErrCode = ERRNO_INVALID_REQUEST;
-					goto PROC_END;
-				}
+			iErrCode = ERRNO_METHOD_NOT_FOUND;
+			goto PROC_END;
+		}
+		{
+			MCP_TRACE_SCOPE(spRequest->strMethod);
+			iErrCode = pEntry->fnHandle(*this, spRequest, strMessage);
+		}
 
-				auto spTask = std::make_shared<ProcessInitializeRequest>(spRequest);
-				if (!spTask)
-				{
-					iErrCode = ERRNO_INTERNAL_ERROR;
-					goto PROC_END;
-				}
-				iErrCode = spTask->Execute();
-				if (ERRNO_OK != iErrCode)
-				{
-					goto PROC_END;
-				}
+	PROC_END:
+		if (ERRNO_OK != iErrCode)
+		{
+			MCP_LOG_DEBUG("session", "{} failed with {}", spRequest->strMethod, iErrCode);
+			ProcessErrorRequest errorTask(spRequest);
+			errorTask.SetSession(shared_from_this());
+			errorTask.SetErrorCode(iErrCode);
+			errorTask.SetErrorMessage(strMessage);
+			errorTask.Execute();
+		}
+		// Requests answered by an asynchronous task are completed by CompleteAsyncTask().
+		if (ERRNO_OK != iErrCode || !IsAsyncTaskInFlight(spRequest->requestId))
+			m_messageHistory.Complete(spRequest->requestId, iErrCode);
 
-				iErrCode = SwitchState(SessionState_Initializing);
+		return iErrCode;
+	}
 
-			} break;
-			case MessageType_ListToolsRequest:
-			{
-				if (CMCPSession::SessionState_Initialized != CMCPSession::GetInstance().GetSessionState())
+	void CMCPSession::RegisterBuiltinMethods(CMCPMethodRegistry& registry)
+	{
+		auto fnRequest = [&registry](const char* lpcszMethod, MessageFactory fnCreate, int (CMCPSession::*pfnHandle)(const std::shared_ptr<MCP::Request>&, std::string&))
+		{
+			registry.Register(lpcszMethod, MessageCategory_Request, std::move(fnCreate),
+				[pfnHandle](CMCPSession& session, const std::shared_ptr<MCP::Message>& spMsg, std::string& strErrMsg)
 				{
-					strMessage = ERROR_MESSAGE_INVALID_REQUEST;
-					iErrCode = ERRNO_INVALID_REQUEST;
-					goto PROC_END;
-				}
-
-				auto spTask = std::make_shared<ProcessListToolsRequest>(spRequest);
-				if (!spTask)
+					auto spRequest = std::static_pointer_cast<MCP::Request>(spMsg);
+					return (session.*pfnHandle)(spRequest, strErrMsg);
+				});
+		};
+		auto fnNotification = [&registry](const char* lpcszMethod, MessageFactory fnCreate, int (CMCPSession::*pfnHandle)(const std::shared_ptr<MCP::Notification>&))
+		{
+			registry.Register(lpcszMethod, MessageCategory_Notification, std::move(fnCreate),
+				[pfnHandle](CMCPSession& session, const std::shared_ptr<MCP::Message>& spMsg, std::string&)
 				{
-					iErrCode = ERRNO_INTERNAL_ERROR;
-					goto PROC_END;
-				}
+					auto spNotification = std::static_pointer_cast<MCP::Notification>(spMsg);
+					return (session.*pfnHandle)(spNotification);
+				});
+		};
+
+		fnRequest(METHOD_INITIALIZE, &CreateMessage<MCP::InitializeRequest>, &CMCPSession::HandleInitializeRequest);
+		fnRequest(METHOD_PING, &CreateMessage<MCP::PingRequest>, &CMCPSession::HandlePingRequest);
+		fnRequest(METHOD_TOOLS_LIST, &CreateMessage<MCP::ListToolsRequest>, &CMCPSession::HandleListToolsRequest);
+		fnRequest(METHOD_TOOLS_CALL, &CreateMessage<MCP::CallToolRequest>, &CMCPSession::HandleCallToolRequest);
+		fnRequest(METHOD_RESOURCES_LIST, &CreateMessage<MCP::ListResourcesRequest>, &CMCPSession::HandleListResourcesRequest);
+		fnRequest(METHOD_RESOURCES_READ, &CreateMessage<MCP::ReadResourceRequest>, &CMCPSession::HandleReadResourceRequest);
+		fnRequest(METHOD_RESOURCES_SUBSCRIBE, &CreateMessage<MCP::SubscribeRequest>, &CMCPSession::HandleSubscribeRequest);
+		fnRequest(METHOD_RESOURCES_UNSUBSCRIBE, &CreateMessage<MCP::SubscribeRequest>, &CMCPSession::HandleUnsubscribeRequest);
+		fnRequest(METHOD_PROMPTS_LIST, &CreateMessage<MCP::ListPromptsRequest>, &CMCPSession::HandleListPromptsRequest);
+		fnRequest(METHOD_LOGGING_SET_LEVEL, &CreateMessage<MCP::SetLevelRequest>, &CMCPSession::HandleSetLevelRequest);
+
+		fnNotification(METHOD_NOTIFICATION_INITIALIZED, &CreateMessage<MCP::InitializedNotification>, &CMCPSession::HandleInitializedNotification);
+		fnNotification(METHOD_NOTIFICATION_CANCELLED, &CreateMessage<MCP::CancelledNotification>, &CMCPSession::HandleCancelledNotification);
+	}
 
-				iErrCode = spTask->Execute();
+	int CMCPSession::HandleInitializeRequest(const std::shared_ptr<MCP::Request>& spRequest, std::string& strErrMsg)
+	{
+		if (SessionState_Original != GetSessionState())
+		{
+			strErrMsg = ERROR_MESSAGE_INVALID_REQUEST;
+			return ERRNO_INVALID_REQUEST;
+		}
 
-			} break;
-			case MessageType_ListResourcesRequest:
-			{
-				auto spTask = std::make_shared<ProcessListResourcesRequest>(spRequest);
-				if (!spTask)
-				{
-					iErrCode = ERRNO_INTERNAL_ERROR;
-					goto PROC_END;
-				}
+		// The encoding switches right after the response, which is still JSON. Not offered when the
+		// response is held back for a batch, since it would be written after the switch.
+		auto spInitializeRequest = std::static_pointer_cast<MCP::InitializeRequest>(spRequest);
+		static const bool s_bFlatBuffers = Config::GetInstance().GetFlatBuffersEncoding() && CMCPFlatBuffersCodec::IsAvailable();
+		bool bFlatBuffers = s_bFlatBuffers
+			&& std::find(spInitializeRequest->vecEncodings.begin(), spInitializeRequest->vecEncodings.end(), ENCODING_FLATBUFFERS) != spInitializeRequest->vecEncodings.end()
+			&& m_spTransport->SupportsFrameFormat(FrameFormat_LengthPrefixed)
+			&& !IsBatchedRequest(spRequest->requestId);
+
+		ProcessInitializeRequest task(spRequest);
+		task.SetSession(shared_from_this());
+		if (bFlatBuffers)
+			task.SetEncoding(ENCODING_FLATBUFFERS);
+		int iErrCode = task.Execute();
+		if (ERRNO_OK != iErrCode)
+			return iErrCode;
 
-				iErrCode = spTask->Execute();
+		if (bFlatBuffers)
+		{
+			iErrCode = m_spTransport->SetFrameFormat(FrameFormat_LengthPrefixed);
+			if (ERRNO_OK != iErrCode)
+				return iErrCode;
+			m_bFlatBuffers.store(true, std::memory_order_release);
+		}
 
-			} break;
-			case MessageType_ReadResourceRequest:
-			{
-				auto spTask = std::make_shared<ProcessReadResourceRequest>(spRequest);
-				if (!spTask)
-				{
-					iErrCode = ERRNO_INTERNAL_ERROR;
-					goto PROC_END;
-				}
+		return SwitchState(SessionState_Initializing);
+	}
 
-				iErrCode = spTask->Execute();
+	int CMCPSession::HandlePingRequest(const std::shared_ptr<MCP::Request>& spRequest, std::string& /*strErrMsg*/)
+	{
+		if (SessionState_Initialized != GetSessionState())
+			return ERRNO_INVALID_REQUEST;
 
-			} break;
-			case MessageType_ListPromptsRequest:
-			{
-				auto spTask = std::make_shared<ProcessListPromptsRequest>(spRequest);
-				if (!spTask)
-				{
-					iErrCode = ERRNO_INTERNAL_ERROR;
-					goto PROC_END;
-				}
+		MCP::PingResult pingResult(true);
+		pingResult.requestId = spRequest->requestId;
 
-				iErrCode = spTask->Execute();
+		std::string strResponse;
+		if (ERRNO_OK != pingResult.Serialize(strResponse))
+			return ERRNO_INTERNAL_ERROR;
+		if (ERRNO_OK != WriteResponse(spRequest->requestId, strResponse))
+			return ERRNO_INTERNAL_ERROR;
 
-			} break;
-			case MessageType_CallToolRequest:
-			{
-				if (CMCPSession::SessionState_Initialized != CMCPSession::GetInstance().GetSessionState())
-				{
-					iErrCode = ERRNO_INVALID_REQUEST;
-					goto PROC_END;
-				}
+		return ERRNO_OK;
+	}
 
-				auto spCallToolRequest = std::dynamic_pointer_cast<MCP::CallToolRequest>(spRequest);
-				if (!spCallToolRequest)
-				{
-					iErrCode = ERRNO_INTERNAL_ERROR;
-					goto PROC_END;
-				}
-				auto spProcessCallToolRequest = CMCPSession::GetInstance().GetServerCallToolsTask(spCallToolRequest->strName);
-				if (!spProcessCallToolRequest)
-				{
-					strMessage = ERROR_MESSAGE_INVALID_PARAMS;
-					iErrCode = ERRNO_INVALID_PARAMS;
-					goto PROC_END;
-				}
-				auto spNewTask = spProcessCallToolRequest->Clone();
-				if (!spNewTask)
-				{
-					iErrCode = ERRNO_INTERNAL_ERROR;
-					goto PROC_END;
-				}
-				auto spNewProcessCallToolRequest = std::dynamic_pointer_cast<MCP::ProcessCallToolRequest>(spNewTask);
-				if (!spNewProcessCallToolRequest)
-				{
-					iErrCode = ERRNO_INTERNAL_ERROR;
-					goto PROC_END;
-				}
-				spNewProcessCallToolRequest->SetRequest(spRequest);
-				iErrCode = CommitAsyncTask(spNewProcessCallToolRequest);
+	int CMCPSession::HandleListToolsRequest(const std::shared_ptr<MCP::Request>& spRequest, std::string& strErrMsg)
+	{
+		if (SessionState_Initialized != GetSessionState())
+		{
+			strErrMsg = ERROR_MESSAGE_INVALID_REQUEST;
+			return ERRNO_INVALID_REQUEST;
+		}
 
-			} break;
-			case MessageType_PingRequest:
-			{
-				if (CMCPSession::SessionState_Initialized != CMCPSession::GetInstance().GetSessionState())
-				{
-					iErrCode = ERRNO_INVALID_REQUEST;
-					goto PROC_END;
-				}
+		ProcessListToolsRequest task(spRequest);
+		task.SetSession(shared_from_this());
+		return task.Execute();
+	}
 
-				auto spPing = std::make_shared<MCP::PingResult>(true);
-				if (!spPing)
-				{
-					iErrCode = ERRNO_INTERNAL_ERROR;
-					goto PROC_END;
-				}
-				spPing->requestId = spRequest->requestId;
-				{
-					std::string strResponse;
-					if (ERRNO_OK != spPing->Serialize(strResponse))
-						return ERRNO_INTERNAL_ERROR;
-					auto spTransport = CMCPSession::GetInstance().GetTransport();
-					if (!spTransport)
-						return ERRNO_INTERNAL_ERROR;
-					if (ERRNO_OK != spTransport->Write(strResponse))
-						return ERRNO_INTERNAL_ERROR;
-				}
+	int CMCPSession::HandleCallToolRequest(const std::shared_ptr<MCP::Request>& spRequest, std::string& strErrMsg)
+	{
+		if (SessionState_Initialized != GetSessionState())
+			return ERRNO_INVALID_REQUEST;
 
-			} break;
-			default: break;
+		// Registered together with CreateMessage<MCP::CallToolRequest>, see RegisterBuiltinMethods().
+		auto spCallToolRequest = std::static_pointer_cast<MCP::CallToolRequest>(spRequest);
+		// One version of the tools for the whole call, even if they are registered again meanwhile.
+		auto spTools = GetServerTools();
+		auto itrPool = spTools->hashCallToolsPools.find(spCallToolRequest->strName);
+		if (itrPool == spTools->hashCallToolsPools.end() || !itrPool->second)
+		{
+			strErrMsg = ERROR_MESSAGE_INVALID_PARAMS;
+			return ERRNO_INVALID_PARAMS;
 		}
 
-	PROC_END:
+		// Arguments not matching the input schema of the tool are rejected before a task is taken for them.
+		auto itrValidator = spTools->hashValidators.find(spCallToolRequest->strName);
+		if (itrValidator != spTools->hashValidators.end() && itrValidator->second)
 		{
-			auto spTask = std::make_shared<ProcessErrorRequest>(spRequest);
-			if (spTask)
+			// Absent arguments are validated as an empty object.
+			static const Json::Value s_jNoArguments(Json::objectValue);
+			const Json::Value& jArguments = spCallToolRequest->jArguments.isNull() ? s_jNoArguments : spCallToolRequest->jArguments;
+			std::string strReason;
+			if (!itrValidator->second->Validate(jArguments, MSG_KEY_ARGUMENTS, strReason))
 			{
-				spTask->SetErrorCode(iErrCode);
-				spTask->SetErrorMessage(strMessage);
-				spTask->Execute();
+				strErrMsg = std::string(ERROR_MESSAGE_INVALID_PARAMS) + ": " + strReason;
+				return ERRNO_INVALID_PARAMS;
 			}
 		}
 
-		return iErrCode;
-	}
+		int iAdmitted = AdmitToolCall(spCallToolRequest->strName);
+		if (ERRNO_OK != iAdmitted)
+			return iAdmitted;
+
+		// The client may shorten the configured deadline through _meta.timeoutMs, never extend it.
+		unsigned int nTimeoutMs = 0;
+		int iConfigTimeoutMs = Config::GetInstance().GetToolTimeoutMs(spCallToolRequest->strName);
+		if (iConfigTimeoutMs > 0)
+			nTimeoutMs = static_cast<unsigned int>(iConfigTimeoutMs);
+		if (spRequest->nTimeoutMs > 0 && (0 == nTimeoutMs || spRequest->nTimeoutMs < nTimeoutMs))
+			nTimeoutMs = spRequest->nTimeoutMs;
+
+		// Cacheable tools are answered from the cache without being run, and without taking a task
+		// from the pool (which may have to construct the prototype first).
+		auto itrTtl = spTools->hashToolsCacheTtl.find(spCallToolRequest->strName);
+		int iCacheTtlMs = Config::GetInstance().GetToolCacheTtlMs(spCallToolRequest->strName,
+			itrTtl != spTools->hashToolsCacheTtl.end() ? static_cast<int>(itrTtl->second) : 0);
+		std::string strCacheKey;
+		if (iCacheTtlMs > 0)
+		{
+			strCacheKey = CMCPToolResultCache::MakeKey(spCallToolRequest->strName, spCallToolRequest->jArguments);
+			std::string strResponse;
+			if (GetToolResultCache().GetResponse(strCacheKey, spRequest->requestId, strResponse))
+				return WriteResponse(spRequest->requestId, strResponse);
+		}
 
-	int CMCPSession::ProcessResponse(int iErrCode, const std::shared_ptr<MCP::Message>& spMsg)
-	{
-		if (!spMsg || !spMsg->IsValid())
-			return ERRNO_INTERNAL_ERROR;
-		auto spResponse = std::dynamic_pointer_cast<MCP::Response>(spMsg);
-		if (!spResponse)
+		auto spNewProcessCallToolRequest = itrPool->second->Acquire();
+		if (!spNewProcessCallToolRequest)
 			return ERRNO_INTERNAL_ERROR;
-		m_hashMessage[MessageCategory_Response].push_back(spMsg);
 
-		return ERRNO_INTERNAL_ERROR;
-	}
+		// Identical calls of cacheable tools arriving while one runs wait for its result instead of
+		// running the tool again.
+		std::shared_ptr<CMCPToolCallFlight> spFlight;
+		if (iCacheTtlMs > 0)
+		{
+			bool bJoined = false;
+			int iErrCode = ERRNO_OK;
+			spFlight = m_manager.GetToolCallFlights().Join(strCacheKey, static_cast<unsigned int>(iCacheTtlMs), shared_from_this(),
+				spRequest->requestId, spNewProcessCallToolRequest, bJoined, iErrCode);
+			if (ERRNO_INVALID_REQUEST == iErrCode)
+				strErrMsg = ERROR_MESSAGE_DUPLICATE_REQUEST_ID;
+			if (ERRNO_OK != iErrCode)
+				return iErrCode;
+			if (nTimeoutMs > 0)
+			{
+				// Every call of a flight times out on its own; the shared work has no deadline.
+				std::weak_ptr<CMCPToolCallFlight> wpFlight = spFlight;
+				std::weak_ptr<CMCPSession> wpSession = shared_from_this();
+				auto requestId = spRequest->requestId;
+				m_manager.ScheduleDeadline(CMCPCancellationToken::Clock::now() + std::chrono::milliseconds(nTimeoutMs), [wpFlight, wpSession, requestId]()
+					{
+						auto spFlight = wpFlight.lock();
+						auto spSession = wpSession.lock();
+						if (spFlight && spSession)
+							spFlight->Expire(spSession, requestId);
+					});
+			}
+			if (bJoined)
+				return ERRNO_OK;
+		}
 
-	int CMCPSession::ProcessNotification(int iErrCode, const std::shared_ptr<MCP::Message>& spMsg)
-	{
-		if (!spMsg || !spMsg->IsValid())
+		spNewProcessCallToolRequest->SetRequest(spRequest);
+		spNewProcessCallToolRequest->SetSession(shared_from_this());
+		spNewProcessCallToolRequest->SetSelf(spNewProcessCallToolRequest);
+		auto spToken = std::make_shared<MCP::CMCPCancellationToken>();
+		if (!spToken)
 			return ERRNO_INTERNAL_ERROR;
-		auto spNotification = std::dynamic_pointer_cast<MCP::Notification>(spMsg);
-		if (!spNotification)
-			return ERRNO_INTERNAL_ERROR;
-		m_hashMessage[MessageCategory_Notification].push_back(spMsg);
-
-		if (ERRNO_OK != iErrCode)
+		spNewProcessCallToolRequest->SetCancellationToken(spToken);
+		if (spRequest->progressToken.IsValid())
 		{
-			return ERRNO_OK;
+			int iProgressMaxRate = Config::GetInstance().GetProgressMaxRate();
+			auto interval = iProgressMaxRate > 0 ? std::chrono::duration_cast<CMCPProgressChannel::Clock::duration>(std::chrono::seconds(1)) / iProgressMaxRate
+				: CMCPProgressChannel::Clock::duration::zero();
+			spNewProcessCallToolRequest->SetProgressChannel(std::make_shared<MCP::CMCPProgressChannel>(spRequest->progressToken, shared_from_this(), interval));
 		}
 
-		switch (spNotification->eMessageType)
+		if (spFlight)
 		{
-			case MessageType_InitializedNotification:
+			// The flight registered the call already.
+			spNewProcessCallToolRequest->SetFlight(spFlight);
+			int iErrCode = m_manager.CommitTask(spNewProcessCallToolRequest, spCallToolRequest->strName);
+			if (ERRNO_OK != iErrCode)
 			{
-				int iErrCode = SwitchState(SessionState_Initialized);
-				if (ERRNO_OK == iErrCode)
-				{
-					return StartAsyncTaskThread();
-				}
-				return iErrCode;
+				spFlight->Leave(this, spRequest->requestId, CancelReason_Shutdown);
+				spFlight->Fail(iErrCode, ERRNO_SERVER_OVERLOADED == iErrCode ? ERROR_MESSAGE_SERVER_OVERLOADED : ERROR_MESSAGE_INTERNAL_ERROR);
+				std::unique_lock<std::mutex> _lock(m_mtxAsyncTasks);
+				m_hashInFlightTasks.erase(spRequest->requestId);
+			}
 
-			} break;
-			case MessageType_CancelledNotification:
-			{
-				auto spCancelledNotification = std::dynamic_pointer_cast<MCP::CancelledNotification>(spNotification);
-				if (spCancelledNotification && spCancelledNotification->IsValid())
-				{
-					return CancelAsyncTask(spCancelledNotification->requestId);
-				}
+			return iErrCode;
+		}
 
-			} break;
-			default: break;
+		if (nTimeoutMs > 0)
+			spToken->SetDeadline(CMCPCancellationToken::Clock::now() + std::chrono::milliseconds(nTimeoutMs));
+
+		int iErrCode = CommitAsyncTask(spNewProcessCallToolRequest, spRequest->requestId, spCallToolRequest->strName);
+		if (ERRNO_INVALID_REQUEST == iErrCode)
+			strErrMsg = ERROR_MESSAGE_DUPLICATE_REQUEST_ID;
+		if (ERRNO_OK != iErrCode)
+			return iErrCode;
+
+		if (spToken->HasDeadline())
+		{
+			std::weak_ptr<MCP::ProcessCallToolRequest> wpTask = spNewProcessCallToolRequest;
+			m_manager.ScheduleDeadline(spToken->GetDeadline(), [wpTask]()
+				{
+					auto spTask = wpTask.lock();
+					if (spTask)
+						spTask->NotifyDeadlineExceeded();
+				});
 		}
 
-		return ERRNO_INTERNAL_ERROR;
+		return ERRNO_OK;
 	}
 
-	int CMCPSession::ParseMessage(const std::string& strMsg, std::shared_ptr<MCP::Message>& spMsg)
+	int CMCPSession::HandleListResourcesRequest(const std::shared_ptr<MCP::Request>& spRequest, std::string& /*strErrMsg*/)
 	{
-		if (strMsg.empty())
-			return ERRNO_PARSE_ERROR;
+		ProcessListResourcesRequest task(spRequest);
+		task.SetSession(shared_from_this());
+		return task.Execute();
+	}
 
-		Json::Reader reader;
-		Json::Value jVal;
-		if (!reader.parse(strMsg, jVal) || !jVal.isObject())
-			return ERRNO_PARSE_ERROR;
+	int CMCPSession::HandleReadResourceRequest(const std::shared_ptr<MCP::Request>& spRequest, std::string& /*strErrMsg*/)
+	{
+		ProcessReadResourceRequest task(spRequest);
+		task.SetSession(shared_from_this());
+		return task.Execute();
+	}
 
-		MessageCategory eCategory{ MessageCategory_Unknown };
-		if (jVal.isMember(MSG_KEY_ID))
-		{
-			if (jVal.isMember(MSG_KEY_METHOD))
-			{
-				eCategory = MessageCategory_Request;
-			}
-			else
-			{
-				eCategory = MessageCategory_Response;
-			}
-		}
-		else
+	int CMCPSession::HandleSubscribeRequest(const std::shared_ptr<MCP::Request>& spRequest, std::string& strErrMsg)
+	{
+		if (SessionState_Initialized != GetSessionState() || !m_spDefinition->spResourceProvider)
 		{
-			if (jVal.isMember(MSG_KEY_METHOD))
-			{
-				eCategory = MessageCategory_Notification;
-			}
+			strErrMsg = ERROR_MESSAGE_INVALID_REQUEST;
+			return ERRNO_INVALID_REQUEST;
 		}
 
-		if (MessageCategory_Unknown == eCategory)
-			return ERRNO_PARSE_ERROR;
-
-		switch (eCategory)
+		// Registered together with CreateMessage<MCP::SubscribeRequest>, see RegisterBuiltinMethods().
+		auto spSubscribeRequest = std::static_pointer_cast<MCP::SubscribeRequest>(spRequest);
 		{
-			case MessageCategory_Request:
-			{
-				return ParseRequest(strMsg, spMsg);
-			} break;
-			case MessageCategory_Response:
-			{
-				return ParseResponse(strMsg, spMsg);
-			} break;
-			case MessageCategory_Notification:
-			{
-				return ParseNotification(strMsg, spMsg);
-			} break;
-			default: break;
+			std::lock_guard<std::mutex> _lock(m_mtxSubscriptions);
+			if (m_bTerminated)
+				return ERRNO_INTERNAL_ERROR;
+			if (m_setSubscriptions.insert(spSubscribeRequest->strUri).second)
+				m_manager.SubscribeResource(spSubscribeRequest->strUri, shared_from_this());
 		}
 
-		return ERRNO_INTERNAL_ERROR;
+		MCP::EmptyResult result(true);
+		result.requestId = spRequest->requestId;
+		std::string strResponse;
+		if (ERRNO_OK != result.Serialize(strResponse))
+			return ERRNO_INTERNAL_ERROR;
+
+		return WriteResponse(spRequest->requestId, strResponse);
 	}
 
-	int CMCPSession::ParseRequest(const std::string& strMsg, std::shared_ptr<MCP::Message>& spMsg)
+	int CMCPSession::HandleSetLevelRequest(const std::shared_ptr<MCP::Request>& spRequest, std::string& strErrMsg)
 	{
-		auto spRequest = std::make_shared<MCP::Request>(MessageType_Unknown, false);
-		if (!spRequest)
-			return ERRNO_PARSE_ERROR;
-
-		int iErrCode = ERRNO_OK;
-		iErrCode = spRequest->Deserialize(strMsg);
-		if (ERRNO_OK != iErrCode)
-			return iErrCode;
-		if (!spRequest->IsValid())
+		if (SessionState_Initialized != GetSessionState())
+		{
+			strErrMsg = ERROR_MESSAGE_INVALID_REQUEST;
 			return ERRNO_INVALID_REQUEST;
+		}
 
-		if (spRequest->strMethod.compare(METHOD_INITIALIZE) == 0)
+		// Registered together with CreateMessage<MCP::SetLevelRequest>, see RegisterBuiltinMethods().
+		auto spSetLevelRequest = std::static_pointer_cast<MCP::SetLevelRequest>(spRequest);
+		LogLevel eLevel = LogLevel_Off;
+		if (!ParseLogLevel(spSetLevelRequest->strLevel, eLevel) || LogLevel_Off == eLevel)
 		{
-			auto spInitializeRequest = std::make_shared<MCP::InitializeRequest>(true);
-			if (!spInitializeRequest)
-				return ERRNO_PARSE_ERROR;
-
-			iErrCode = spInitializeRequest->Deserialize(strMsg);
-			if (ERRNO_OK != iErrCode)
-				return ERRNO_INVALID_REQUEST;
-
-			spMsg = spInitializeRequest;
-
-			return ERRNO_OK;
+			strErrMsg = ERROR_MESSAGE_INVALID_PARAMS;
+			return ERRNO_INVALID_PARAMS;
 		}
-		else if (spRequest->strMethod.compare(METHOD_TOOLS_LIST) == 0)
-		{
-			auto spListToolsRequest = std::make_shared<MCP::ListToolsRequest>(true);
-			if (!spListToolsRequest)
-				return ERRNO_PARSE_ERROR;
+		if (m_bTerminated)
+			return ERRNO_INTERNAL_ERROR;
+		m_manager.GetClientLogSink().SetLevel(shared_from_this(), eLevel);
 
-			iErrCode = spListToolsRequest->Deserialize(strMsg);
-			if (ERRNO_OK != iErrCode)
-				return ERRNO_INVALID_REQUEST;
+		MCP::EmptyResult result(true);
+		result.requestId = spRequest->requestId;
+		std::string strResponse;
+		if (ERRNO_OK != result.Serialize(strResponse))
+			return ERRNO_INTERNAL_ERROR;
 
-			spMsg = spListToolsRequest;
+		return WriteResponse(spRequest->requestId, strResponse);
+	}
 
-			return ERRNO_OK;
+	int CMCPSession::HandleUnsubscribeRequest(const std::shared_ptr<MCP::Request>& spRequest, std::string& strErrMsg)
+	{
+		if (SessionState_Initialized != GetSessionState() || !m_spDefinition->spResourceProvider)
+		{
+			strErrMsg = ERROR_MESSAGE_INVALID_REQUEST;
+			return ERRNO_INVALID_REQUEST;
 		}
-		else if (spRequest->strMethod.compare(METHOD_TOOLS_CALL) == 0)
+
+		auto spSubscribeRequest = std::static_pointer_cast<MCP::SubscribeRequest>(spRequest);
 		{
-			auto spCallToolRequest = std::make_shared<MCP::CallToolRequest>(true);
-			if (!spCallToolRequest)
-				return ERRNO_PARSE_ERROR;
+			std::lock_guard<std::mutex> _lock(m_mtxSubscriptions);
+			if (m_setSubscriptions.erase(spSubscribeRequest->strUri) > 0)
+				m_manager.UnsubscribeResource(spSubscribeRequest->strUri, this);
+		}
 
-			iErrCode = spCallToolRequest->Deserialize(strMsg);
-			if (ERRNO_OK != iErrCode)
-				return ERRNO_INVALID_REQUEST;
+		MCP::EmptyResult result(true);
+		result.requestId = spRequest->requestId;
+		std::string strResponse;
+		if (ERRNO_OK != result.Serialize(strResponse))
+			return ERRNO_INTERNAL_ERROR;
 
-			spMsg = spCallToolRequest;
+		return WriteResponse(spRequest->requestId, strResponse);
+	}
 
-			return ERRNO_OK;
-		}
-		else if (spRequest->strMethod.compare(METHOD_PING) == 0)
-		{
-			auto spPingRequest = std::make_shared<MCP::PingRequest>(true);
-			if (!spPingRequest)
-				return ERRNO_PARSE_ERROR;
+	int CMCPSession::HandleListPromptsRequest(const std::shared_ptr<MCP::Request>& spRequest, std::string& /*strErrMsg*/)
+	{
+		ProcessListPromptsRequest task(spRequest);
+		task.SetSession(shared_from_this());
+		return task.Execute();
+	}
 
-			iErrCode = spPingRequest->Deserialize(strMsg);
-			if (ERRNO_OK != iErrCode)
-				return ERRNO_INVALID_REQUEST;
+	int CMCPSession::HandleInitializedNotification(const std::shared_ptr<MCP::Notification>& /*spNotification*/)
+	{
+		int iErrCode = SwitchState(SessionState_Initialized);
+		if (ERRNO_OK != iErrCode)
+			return iErrCode;
 
-			spMsg = spPingRequest;
+		std::unique_lock<std::mutex> _lock(m_mtxAsyncTasks);
+		if (!m_bTerminated)
+			m_bRunAsyncTask = true;
 
-			return ERRNO_OK;
-		}
-		else if (spRequest->strMethod.compare(METHOD_RESOURCES_LIST) == 0)
-		{
-			auto spListResourcesRequest = std::make_shared<MCP::ListResourcesRequest>(true);
-			if (!spListResourcesRequest)
-				return ERRNO_PARSE_ERROR;
+		return ERRNO_OK;
+	}
 
-			iErrCode = spListResourcesRequest->Deserialize(strMsg);
-			if (ERRNO_OK != iErrCode)
-				return ERRNO_INVALID_REQUEST;
+	int CMCPSession::HandleCancelledNotification(const std::shared_ptr<MCP::Notification>& spNotification)
+	{
+		auto spCancelledNotification = std::dynamic_pointer_cast<MCP::CancelledNotification>(spNotification);
+		if (!spCancelledNotification || !spCancelledNotification->IsValid())
+			return ERRNO_INVALID_NOTIFICATION;
 
-			spMsg = spListResourcesRequest;
+		return CancelAsyncTask(spCancelledNotification->requestId);
+	}
 
-			return ERRNO_OK;
-		}
-		else if (spRequest->strMethod.compare(METHOD_RESOURCES_READ) == 0)
-		{
-			auto spReadResourceRequest = std::make_shared<MCP::ReadResourceRequest>(true);
-			if (!spReadResourceRequest)
-				return ERRNO_PARSE_ERROR;
+	int CMCPSession::ProcessResponse(int /*iErrCode*/, const std::shared_ptr<MCP::Message>& spMsg)
+	{
+		if (!spMsg || !spMsg->IsValid())
+			return ERRNO_INTERNAL_ERROR;
+		auto spResponse = std::dynamic_pointer_cast<MCP::Response>(spMsg);
+		if (!spResponse)
+			return ERRNO_INTERNAL_ERROR;
 
-			iErrCode = spReadResourceRequest->Deserialize(strMsg);
-			if (ERRNO_OK != iErrCode)
-				return ERRNO_INVALID_REQUEST;
+		return ERRNO_INTERNAL_ERROR;
+	}
 
-			spMsg = spReadResourceRequest;
+	int CMCPSession::ProcessNotification(int iErrCode, const std::shared_ptr<MCP::Message>& spMsg)
+	{
+		if (!spMsg || !spMsg->IsValid())
+			return ERRNO_INTERNAL_ERROR;
+		auto spNotification = std::dynamic_pointer_cast<MCP::Notification>(spMsg);
+		if (!spNotification)
+			return ERRNO_INTERNAL_ERROR;
 
+		if (ERRNO_OK != iErrCode)
+		{
 			return ERRNO_OK;
 		}
-		else if (spRequest->strMethod.compare(METHOD_PROMPTS_LIST) == 0)
-		{
-			auto spListPromptsRequest = std::make_shared<MCP::ListPromptsRequest>(true);
-			if (!spListPromptsRequest)
-				return ERRNO_PARSE_ERROR;
 
-			iErrCode = spListPromptsRequest->Deserialize(strMsg);
-			if (ERRNO_OK != iErrCode)
-				return ERRNO_INVALID_REQUEST;
-
-			spMsg = spListPromptsRequest;
+		auto pEntry = m_spDefinition->methodRegistry.Find(MessageCategory_Notification, spNotification->strMethod);
+		if (!pEntry)
+			return ERRNO_METHOD_NOT_FOUND;
 
-			return ERRNO_OK;
-		}
+		// Notifications are never answered, so the error message is discarded.
+		MCP_TRACE_SCOPE(spNotification->strMethod);
+		std::string strErrMsg;
+		return pEntry->fnHandle(*this, spNotification, strErrMsg);
+	}
 
-		return ERRNO_INTERNAL_ERROR;
+	int CMCPSession::ParseMessage(const std::string& strMsg, std::shared_ptr<MCP::Message>& spMsg)
+	{
+		return ParseMessage(strMsg.data(), strMsg.data() + strMsg.size(), spMsg);
 	}
 
-	int CMCPSession::ParseResponse(const std::string& strMsg, std::shared_ptr<MCP::Message>& spMsg)
+	int CMCPSession::ParseMessage(const char* pBegin, const char* pEnd, std::shared_ptr<MCP::Message>& spMsg)
 	{
-		return ERRNO_INTERNAL_ERROR;
+		// Declared outside the scope: the tree is destroyed, and its arena blocks dropped, on return.
+		Json::Value jVal;
+		int iErrCode = ParseFrame(pBegin, pEnd, jVal);
+		if (ERRNO_OK != iErrCode)
+			return iErrCode;
+
+		return ParseMessage(jVal, spMsg);
 	}
 
-	int CMCPSession::ParseNotification(const std::string& strMsg, std::shared_ptr<MCP::Message>& spMsg)
+	int CMCPSession::ParseFrame(const char* pBegin, const char* pEnd, Json::Value& jVal)
 	{
-		auto spNotification = std::make_shared<MCP::Notification>(MessageType_Unknown, false);
-		if (!spNotification)
+		if (pBegin == pEnd)
 			return ERRNO_PARSE_ERROR;
 
-		int iErrCode = ERRNO_OK;
-		iErrCode = spNotification->Deserialize(strMsg);
-		if (ERRNO_OK != iErrCode)
-			return iErrCode;
-		if (!spNotification->IsValid())
-			return ERRNO_INVALID_NOTIFICATION;
+		// Only the parse tree comes from the arena; what the typed message copies out of it
+		// during Deserialize() lives on the heap and may outlive the frame.
+		Json::MemoryResourceScope arenaScope(GetThreadMessageArena());
+		if (!m_jsonParser.Parse(pBegin, pEnd, jVal) || !(jVal.isObject() || jVal.isArray()))
+			return ERRNO_PARSE_ERROR;
 
-		if (spNotification->strMethod.compare(METHOD_NOTIFICATION_INITIALIZED) == 0)
-		{
-			auto spInitializedNotification = std::make_shared<MCP::InitializedNotification>(true);
-			if (!spInitializedNotification)
-				return ERRNO_PARSE_ERROR;
+		return ERRNO_OK;
+	}
 
-			iErrCode = spInitializedNotification->Deserialize(strMsg);
-			if (ERRNO_OK != iErrCode)
-				return ERRNO_INVALID_NOTIFICATION;
+	int CMCPSession::DecodeFrame(const char* pBegin, const char* pEnd, Json::Value& jVal)
+	{
+		Json::MemoryResourceScope arenaScope(GetThreadMessageArena());
+		return CMCPFlatBuffersCodec::Decode(pBegin, pEnd, m_jsonParser, jVal);
+	}
 
-			spMsg = spInitializedNotification;
+	int CMCPSession::ParseMessage(const Json::Value& jVal, std::shared_ptr<MCP::Message>& spMsg)
+	{
+		if (!jVal.isObject())
+			return ERRNO_PARSE_ERROR;
 
-			return ERRNO_OK;
+		MessageCategory eCategory{ MessageCategory_Unknown };
+		if (jVal.isMember(MSG_KEY_ID))
+		{
+			if (jVal.isMember(MSG_KEY_METHOD))
+			{
+				eCategory = MessageCategory_Request;
+			}
+			else
+			{
+				eCategory = MessageCategory_Response;
+			}
 		}
-		else if (spNotification->strMethod.compare(METHOD_NOTIFICATION_CANCELLED) == 0)
+		else
 		{
-			auto spCancelledNotification = std::make_shared<MCP::CancelledNotification>(true);
-			if (!spCancelledNotification)
-				return ERRNO_PARSE_ERROR;
-
-			iErrCode = spCancelledNotification->Deserialize(strMsg);
-			if (ERRNO_OK != iErrCode)
-				return ERRNO_INVALID_NOTIFICATION;
+			if (jVal.isMember(MSG_KEY_METHOD))
+			{
+				eCategory = MessageCategory_Notification;
+			}
+		}
 
-			spMsg = spCancelledNotification;
+		if (MessageCategory_Unknown == eCategory)
+			return ERRNO_PARSE_ERROR;
 
-			return ERRNO_OK;
+		// The parsed tree is handed down as is, so every message is parsed exactly once.
+		switch (eCategory)
+		{
+			case MessageCategory_Request:
+			{
+				return ParseRequest(jVal, spMsg);
+			} break;
+			case MessageCategory_Response:
+			{
+				return ParseResponse(jVal, spMsg);
+			} break;
+			case MessageCategory_Notification:
+			{
+				return ParseNotification(jVal, spMsg);
+			} break;
+			default: break;
 		}
 
 		return ERRNO_INTERNAL_ERROR;
 	}
 
-	void CMCPSession::SetTransport(const std::shared_ptr<CMCPTransport>& spTransport)
+	int CMCPSession::ParseRequest(const Json::Value& jMsg, std::shared_ptr<MCP::Message>& spMsg)
 	{
-		m_spTransport = spTransport;
+		const char* lpcszBegin{ nullptr };
+		const char* lpcszEnd{ nullptr };
+		if (!jMsg[MSG_KEY_METHOD].getString(&lpcszBegin, &lpcszEnd) || lpcszBegin == lpcszEnd)
+			return ERRNO_INVALID_REQUEST;
+
+		int iErrCode = ERRNO_METHOD_NOT_FOUND;
+		auto pEntry = m_spDefinition->methodRegistry.Find(MessageCategory_Request, lpcszBegin, lpcszEnd);
+		if (pEntry)
+		{
+			auto spTypedMsg = pEntry->fnCreate();
+			if (!spTypedMsg)
+				return ERRNO_PARSE_ERROR;
+
+			if (ERRNO_OK == spTypedMsg->Deserialize(jMsg))
+			{
+				spMsg = spTypedMsg;
+				return ERRNO_OK;
+			}
+			iErrCode = ERRNO_INVALID_REQUEST;
+		}
+
+		// Keep the bare envelope so that the error response can still be addressed to the request id.
+		auto spRequest = std::make_shared<MCP::Request>(MessageType_Unknown, false);
+		if (spRequest && ERRNO_OK == spRequest->Deserialize(jMsg))
+			spMsg = spRequest;
+
+		return iErrCode;
 	}
 
-	void CMCPSession::SetServerInfo(const MCP::Implementation& impl)
+	int CMCPSession::ParseResponse(const Json::Value& /*jMsg*/, std::shared_ptr<MCP::Message>& /*spMsg*/)
 	{
-		m_serverInfo = impl;
+		return ERRNO_INTERNAL_ERROR;
 	}
 
-	void CMCPSession::SetServerCapabilities(const MCP::ServerCapabilities& capabilities)
+	int CMCPSession::ParseNotification(const Json::Value& jMsg, std::shared_ptr<MCP::Message>& spMsg)
 	{
-		m_capabilities = capabilities;
+		const char* lpcszBegin{ nullptr };
+		const char* lpcszEnd{ nullptr };
+		if (!jMsg[MSG_KEY_METHOD].getString(&lpcszBegin, &lpcszEnd) || lpcszBegin == lpcszEnd)
+			return ERRNO_INVALID_NOTIFICATION;
+
+		auto pEntry = m_spDefinition->methodRegistry.Find(MessageCategory_Notification, lpcszBegin, lpcszEnd);
+		if (!pEntry)
+			return ERRNO_METHOD_NOT_FOUND;
+
+		auto spTypedMsg = pEntry->fnCreate();
+		if (!spTypedMsg)
+			return ERRNO_PARSE_ERROR;
+		if (ERRNO_OK != spTypedMsg->Deserialize(jMsg))
+			return ERRNO_INVALID_NOTIFICATION;
+
+		spMsg = spTypedMsg;
+
+		return ERRNO_OK;
 	}
 
-	void CMCPSession::SetServerToolsPagination(bool bPagination)
+	const MCP::Implementation& CMCPSession::GetServerInfo() const
 	{
-		m_bToolsPagination = bPagination;
+		return m_spDefinition->serverInfo;
 	}
 
-	void CMCPSession::SetServerTools(const std::vector<MCP::Tool>& tools)
+	const MCP::ServerCapabilities& CMCPSession::GetServerCapabilities() const
 	{
-		m_tools = tools;
+		return m_spDefinition->capabilities;
 	}
 
-	void CMCPSession::SetServerCallToolsTasks(const std::unordered_map<std::string, std::shared_ptr<MCP::ProcessCallToolRequest>>& hashCallToolsTasks)
+	std::shared_ptr<const ServerTools> CMCPSession::GetServerTools() const
 	{
-		m_hashCallToolsTasks = hashCallToolsTasks;
+		return std::atomic_load(&m_spDefinition->spTools);
 	}
 
-	MCP::Implementation CMCPSession::GetServerInfo() const
+	const CMCPListCache& CMCPSession::GetServerToolsList() const
 	{
-		return m_serverInfo;
+		return m_spDefinition->toolsList;
 	}
 
-	MCP::ServerCapabilities CMCPSession::GetServerCapabilities() const
+	const CMCPListCache& CMCPSession::GetServerResourcesList() const
 	{
-		return m_capabilities;
+		return m_spDefinition->resourcesList;
 	}
 
-	bool CMCPSession::GetServerToolsPagination() const
+	const CMCPListCache& CMCPSession::GetServerPromptsList() const
 	{
-		return m_bToolsPagination;
+		return m_spDefinition->promptsList;
 	}
 
-	std::vector<MCP::Tool> CMCPSession::GetServerTools() const
+	std::shared_ptr<MCP::CMCPResourceProvider> CMCPSession::GetServerResourceProvider() const
 	{
-		return m_tools;
+		return m_spDefinition->spResourceProvider;
 	}
 
 	std::shared_ptr<CMCPTransport> CMCPSession::GetTransport() const
@@ -642,181 +1036,409 @@ namespace MCP
 		return m_eSessionState;
 	}
 
-	std::shared_ptr<MCP::ProcessRequest> CMCPSession::GetServerCallToolsTask(const std::string& strToolName)
+	std::shared_ptr<MCP::ProcessRequest> CMCPSession::GetServerCallToolsTask(const std::string& strToolName) const
 	{
-		if (m_hashCallToolsTasks.count(strToolName) > 0)
-			return m_hashCallToolsTasks[strToolName];
+		auto spTools = GetServerTools();
+		auto itrFound = spTools->hashCallToolsPools.find(strToolName);
+		if (itrFound != spTools->hashCallToolsPools.end() && itrFound->second)
+			return itrFound->second->GetPrototype();
 
 		return nullptr;
 	}
 
-	int CMCPSession::CommitAsyncTask(const std::shared_ptr<MCP::CMCPTask>& spTask)
+	int CMCPSession::CommitContinuation(const std::shared_ptr<MCP::CMCPTask>& spTask)
 	{
-		if (!spTask)
-			return ERRNO_INTERNAL_ERROR;
+		// Outside any tool group: the call it continues was admitted already.
+		return m_manager.CommitTask(spTask, std::string());
+	}
 
-		if (m_bRunAsyncTask) 
-		{
-			std::unique_lock<std::mutex> _lock(m_mtxAsyncThread);
+	int CMCPSession::ScheduleCallback(const CMCPDeadlineTimer::Clock::time_point& tpWhen, std::function<void()> fnCallback)
+	{
+		return m_manager.ScheduleDeadline(tpWhen, std::move(fnCallback));
+	}
 
-			if (!m_bRunAsyncTask)
-			{
-				_lock.unlock();
-				return ERRNO_OK;
-			}
+	MCP::TaskLaneStats CMCPSession::GetTaskLaneStats(MCP::TaskLane eLane) const
+	{
+		return m_manager.GetTaskLaneStats(eLane);
+	}
+
+	CMCPResourceCache& CMCPSession::GetResourceCache() const
+	{
+		return m_manager.GetResourceCache();
+	}
+
+	CMCPToolResultCache& CMCPSession::GetToolResultCache() const
+	{
+		return m_manager.GetToolResultCache();
+	}
 
-			m_deqAsyncTasks.push_back(spTask);
+	bool CMCPSession::IsOutputCongested() const
+	{
+		if (!m_spTransport)
+			return false;
+		int iHighWatermark = Config::GetInstance().GetSessionOutputHighWatermark();
+
+		return iHighWatermark > 0 && m_spTransport->GetPendingOutputBytes() > static_cast<size_t>(iHighWatermark);
+	}
 
-			_lock.unlock();
-			m_cvAsyncThread.notify_one();
+	int CMCPSession::WriteMessage(const std::string& strMessage)
+	{
+		MCP_TRACE_SCOPE("write");
+		if (!m_spTransport)
+			return ERRNO_INTERNAL_ERROR;
+		if (!m_bFlatBuffers.load(std::memory_order_acquire))
+		{
+			CMCPMetrics::CountBytesWritten(strMessage.size());
+			return m_spTransport->Write(strMessage);
 		}
 
+		std::string strFrame;
+		int iErrCode = CMCPFlatBuffersCodec::Encode(strMessage, strFrame);
+		if (ERRNO_OK != iErrCode)
+			return iErrCode;
+
+		CMCPMetrics::CountBytesWritten(strFrame.size());
+		return m_spTransport->Write(strFrame);
+	}
+
+	int CMCPSession::WriteResponse(const MCP::RequestId& requestId, const std::string& strResponse)
+	{
+		if (!m_spTransport)
+			return ERRNO_INTERNAL_ERROR;
+
+		auto spBatch = TakeBatch(requestId);
+		if (!spBatch)
+			return WriteMessage(strResponse);
+
+		std::string strBatch;
+		if (spBatch->Add(strResponse, strBatch) && !strBatch.empty())
+			return WriteMessage(strBatch);
+
 		return ERRNO_OK;
 	}
 
-	int CMCPSession::CancelAsyncTask(const MCP::RequestId& requestId)
+	// Collects a response written in pieces, so that it can take its place in the batch response,
+	// or be framed as a whole in a binary encoding.
+	class CBufferedResponseStream : public CMCPMessageStream
 	{
-		if (!requestId.IsValid())
-			return ERRNO_INVALID_NOTIFICATION;
+	public:
+		CBufferedResponseStream(CMCPSession& session, const MCP::RequestId& requestId)
+			: m_session(session)
+			, m_requestId(requestId)
+		{
+		}
 
-		if (m_bRunAsyncTask)
+		~CBufferedResponseStream()
 		{
-			std::unique_lock<std::mutex> _lock(m_mtxAsyncThread);
+			Close();
+		}
 
-			if (!m_bRunAsyncTask)
-			{
-				_lock.unlock();
-				return ERRNO_OK;
-			}
+		int Append(const char* pData, size_t nLength) override
+		{
+			if (m_bClosed)
+				return ERRNO_INTERNAL_ERROR;
+			m_strResponse.append(pData, nLength);
+
+			return ERRNO_OK;
+		}
 
-			m_vecCancelledTaskIds.push_back(requestId);
+		int Close() override
+		{
+			if (m_bClosed)
+				return ERRNO_OK;
+			m_bClosed = true;
 
-			_lock.unlock();
-			m_cvAsyncThread.notify_one();
+			return m_session.WriteResponse(m_requestId, m_strResponse);
 		}
 
-		return ERRNO_OK;
+	private:
+		CMCPSession& m_session;
+		MCP::RequestId m_requestId;
+		std::string m_strResponse;
+		bool m_bClosed{ false };
+	};
+
+	std::unique_ptr<CMCPMessageStream> CMCPSession::OpenResponseStream(const MCP::RequestId& requestId)
+	{
+		if (!m_spTransport)
+			return nullptr;
+
+		if (m_bFlatBuffers.load(std::memory_order_acquire) || IsBatchedRequest(requestId))
+			return std::unique_ptr<CMCPMessageStream>(new CBufferedResponseStream(*this, requestId));
+
+		return m_spTransport->OpenMessageStream();
+	}
+
+	bool CMCPSession::IsBatchedRequest(const MCP::RequestId& requestId)
+	{
+		if (0 == m_nBatchedRequests.load(std::memory_order_acquire))
+			return false;
+
+		std::lock_guard<std::mutex> _lock(m_mtxBatches);
+		return m_hashBatchedRequests.find(requestId) != m_hashBatchedRequests.end();
+	}
+
+	std::shared_ptr<CMCPBatchResponse> CMCPSession::TakeBatch(const MCP::RequestId& requestId)
+	{
+		// Most responses answer a request sent on its own: no lock is taken for them.
+		if (0 == m_nBatchedRequests.load(std::memory_order_acquire))
+			return nullptr;
+
+		std::lock_guard<std::mutex> _lock(m_mtxBatches);
+		auto itrBatch = m_hashBatchedRequests.find(requestId);
+		if (itrBatch == m_hashBatchedRequests.end())
+			return nullptr;
+		auto spBatch = std::move(itrBatch->second);
+		m_hashBatchedRequests.erase(itrBatch);
+		--m_nBatchedRequests;
+
+		return spBatch;
+	}
+
+	void CMCPSession::DropResponse(const MCP::RequestId& requestId)
+	{
+		auto spBatch = TakeBatch(requestId);
+		std::string strBatch;
+		if (spBatch && spBatch->Drop(strBatch) && !strBatch.empty() && m_spTransport)
+			WriteMessage(strBatch);
+	}
+
+	int CMCPSession::NotifyResourceUpdated(const std::string& strUri)
+	{
+		if (m_bTerminated || !m_spTransport)
+			return ERRNO_INTERNAL_ERROR;
+
+		MCP::ResourceUpdatedNotification notification(true);
+		notification.strMethod = METHOD_NOTIFICATION_RESOURCES_UPDATED;
+		notification.strUri = strUri;
+		std::string strNotification;
+		if (ERRNO_OK != notification.Serialize(strNotification))
+			return ERRNO_INTERNAL_ERROR;
+
+		return WriteMessage(strNotification);
+	}
+
+	int CMCPSession::NotifyToolsListChanged()
+	{
+		if (m_bTerminated || !m_spTransport)
+			return ERRNO_INTERNAL_ERROR;
+		// Announced in the capabilities or not at all; a client still initializing lists the new tools anyway.
+		if (!GetServerCapabilities().tools.bListChanged || SessionState_Initialized != GetSessionState())
+			return ERRNO_OK;
+
+		MCP::ToolListChangedNotification notification(true);
+		notification.strMethod = METHOD_NOTIFICATION_TOOLS_LIST_CHANGED;
+		std::string strNotification;
+		if (ERRNO_OK != notification.Serialize(strNotification))
+			return ERRNO_INTERNAL_ERROR;
+
+		return WriteMessage(strNotification);
+	}
+
+	int CMCPSession::SendLogMessage(const MCP::LogRecord& record)
+	{
+		if (m_bTerminated || !m_spTransport)
+			return ERRNO_INTERNAL_ERROR;
+		// Log records are the first to go when the client falls behind.
+		if (IsOutputCongested())
+			return ERRNO_OK;
+
+		MCP::LogNotification notification(true);
+		notification.strMethod = METHOD_NOTIFICATION_MESSAGE;
+		notification.strLevel = LogLevelName(record.eLevel);
+		notification.strLogger = record.lpcszLogger;
+		notification.jData = record.strMessage;
+		std::string strNotification;
+		if (ERRNO_OK != notification.Serialize(strNotification))
+			return ERRNO_INTERNAL_ERROR;
+
+		return WriteMessage(strNotification);
 	}
 
-	int CMCPSession::StartAsyncTaskThread()
+	int CMCPSession::AttachAsyncTask(const std::shared_ptr<MCP::CMCPTask>& spTask, const MCP::RequestId& requestId)
 	{
-		m_upTaskThread = std::make_unique<std::thread>(&CMCPSession::AsyncThreadProc, this);
-		if (!m_upTaskThread)
+		std::unique_lock<std::mutex> _lock(m_mtxAsyncTasks);
+		if (!m_bRunAsyncTask)
 			return ERRNO_INTERNAL_ERROR;
 
+		auto itrFound = m_hashInFlightTasks.find(requestId);
+		if (itrFound != m_hashInFlightTasks.end() && !itrFound->second.expired())
+			return ERRNO_INVALID_REQUEST;
+
+		m_hashInFlightTasks[requestId] = spTask;
+
 		return ERRNO_OK;
 	}
 
-	int CMCPSession::StopAsyncTaskThread()
+	int CMCPSession::AdmitToolCall(const std::string& strToolName)
 	{
-		std::unique_lock<std::mutex> _lock(m_mtxAsyncThread);
-		m_bRunAsyncTask = false;
-		_lock.unlock();
+		auto& config = Config::GetInstance();
+		int iToolRate = config.GetToolRateLimit(strToolName);
+		int iClientRate = config.GetClientRateLimit();
+		if (iToolRate <= 0 && iClientRate <= 0)
+			return ERRNO_OK;
 
-		m_cvAsyncThread.notify_all();
+		auto& rateLimiter = m_manager.GetRateLimiter();
+		auto tpNow = CMCPRateLimiter::Clock::now();
+		std::string strToolKey = "tool:" + strToolName;
+		if (!rateLimiter.TryAcquire(strToolKey, iToolRate, 0, tpNow))
+			return ERRNO_RATE_LIMITED;
+		if (!rateLimiter.TryAcquire(m_strRateLimitKey, iClientRate, config.GetClientRateBurst(), tpNow))
+		{
+			// The tool's budget is not spent on a call that is refused.
+			if (iToolRate > 0)
+				rateLimiter.Release(strToolKey);
+			return ERRNO_RATE_LIMITED;
+		}
 
 		return ERRNO_OK;
 	}
 
-	int CMCPSession::AsyncThreadProc()
+	int CMCPSession::CommitAsyncTask(const std::shared_ptr<MCP::CMCPTask>& spTask, const MCP::RequestId& requestId, const std::string& strGroup)
 	{
-		while (m_bRunAsyncTask) 
+		if (!spTask)
+			return ERRNO_INTERNAL_ERROR;
+
 		{
-			std::unique_lock<std::mutex> _lock(m_mtxAsyncThread);
+			std::unique_lock<std::mutex> _lock(m_mtxAsyncTasks);
+			if (!m_bRunAsyncTask)
+				return ERRNO_OK;
 
-			// Wait for tasks
-			m_cvAsyncThread.wait(
-				_lock, 
-				[this]() {
-				return !m_deqAsyncTasks.empty() || !m_vecCancelledTaskIds.empty() || !m_bRunAsyncTask;
-				});
+			auto itrFound = m_hashInFlightTasks.find(requestId);
+			if (itrFound != m_hashInFlightTasks.end() && !itrFound->second.expired())
+				return ERRNO_INVALID_REQUEST;
+
+			m_hashInFlightTasks[requestId] = spTask;
+		}
+
+		int iErrCode = m_manager.CommitTask(spTask, strGroup);
+		if (ERRNO_OK != iErrCode)
+		{
+			std::unique_lock<std::mutex> _lock(m_mtxAsyncTasks);
+			m_hashInFlightTasks.erase(requestId);
+		}
+
+		return iErrCode;
+	}
+
+	int CMCPSession::CancelAsyncTask(const MCP::RequestId& requestId)
+	{
+		if (!requestId.IsValid())
+			return ERRNO_INVALID_NOTIFICATION;
 
-			// Break the loop and clean up tasks
+		std::shared_ptr<MCP::CMCPTask> spTask;
+		{
+			std::unique_lock<std::mutex> _lock(m_mtxAsyncTasks);
 			if (!m_bRunAsyncTask)
-			{
-				_lock.unlock();
+				return ERRNO_OK;
 
-				std::for_each(m_vecAsyncTasksCache.begin(), m_vecAsyncTasksCache.end(), [this](auto& spTask)
-					{
-						if (spTask)
-						{
-							spTask->Cancel();
-						}
-					});
+			auto itrFound = m_hashInFlightTasks.find(requestId);
+			if (itrFound == m_hashInFlightTasks.end())
+				return ERRNO_OK;
+			spTask = itrFound->second.lock();
+			m_hashInFlightTasks.erase(itrFound);
+			m_hashDetachedTasks.erase(requestId);
+		}
 
-				break;
-			}
+		// Cancel outside the lock: tools may block in Cancel() while their worker reports completion.
+		if (spTask)
+			CancelTask(spTask, requestId, CancelReason_Client);
+		// Cancelled requests are not answered, the batch they came with must not wait for them.
+		DropResponse(requestId);
 
-			// Process new pending tasks
-			std::vector<std::shared_ptr<MCP::CMCPTask>> vecTasks;
-			while (!m_deqAsyncTasks.empty())
-			{
-				auto spTask = m_deqAsyncTasks.front();
-				vecTasks.push_back(spTask);
-				m_deqAsyncTasks.pop_front();
-			}
+		return ERRNO_OK;
+	}
 
-			//  Process task cancellation requests
-			std::for_each(m_vecAsyncTasksCache.begin(), m_vecAsyncTasksCache.end(), [this](auto& spTask) 
-				{
-					if (spTask)
-					{
-						auto spProcessRequestTask = std::dynamic_pointer_cast<MCP::ProcessRequest>(spTask);
-						if (spProcessRequestTask)
-						{
-							auto spRequest = spProcessRequestTask->GetRequest();
-							if (spRequest)
-							{
-								auto itrFound = std::find_if(m_vecCancelledTaskIds.begin(), m_vecCancelledTaskIds.end(), [&spRequest](auto& requestId)
-									{
-										if (requestId.IsEqual(spRequest->requestId))
-											return true;
-										return false;
-									}
-								);
-								if (itrFound != m_vecCancelledTaskIds.end())
-									spTask->Cancel();
-							}
-						}
-					}
-				});
-			m_vecCancelledTaskIds.clear();
-			_lock.unlock();
+	void CMCPSession::CancelTask(const std::shared_ptr<MCP::CMCPTask>& spTask, const MCP::RequestId& requestId, CancelReason eReason)
+	{
+		auto spCallToolTask = std::dynamic_pointer_cast<MCP::ProcessCallToolRequest>(spTask);
+		// The work of a flight is shared with other calls; it is only cancelled with the last of them.
+		auto spFlight = spCallToolTask ? spCallToolTask->GetFlight() : nullptr;
+		if (spFlight)
+		{
+			spFlight->Leave(this, requestId, eReason);
+			return;
+		}
+		if (spCallToolTask && spCallToolTask->GetCancellationToken())
+			spCallToolTask->GetCancellationToken()->Cancel(eReason);
+		spTask->Cancel();
+	}
 
-			// Clean up completed tasks
-			m_vecAsyncTasksCache.erase(
-				std::remove_if(m_vecAsyncTasksCache.begin(), m_vecAsyncTasksCache.end(), [](auto spTask) 
-					{
-						if (!spTask)
-							return true;
-						if (spTask->IsFinished() || spTask->IsCancelled())
-							return true;
-						return false;
-					}),
-				m_vecAsyncTasksCache.end());
-
-			// Cache new tasks
-			for (auto& spTask : vecTasks)
+	int CMCPSession::CompleteAsyncTask(const MCP::RequestId& requestId, int iStatus)
+	{
+		{
+			std::unique_lock<std::mutex> _lock(m_mtxAsyncTasks);
+			m_hashInFlightTasks.erase(requestId);
+			m_hashDetachedTasks.erase(requestId);
+		}
+		m_messageHistory.Complete(requestId, iStatus);
+
+		return ERRNO_OK;
+	}
+
+	bool CMCPSession::IsAsyncTaskInFlight(const MCP::RequestId& requestId)
+	{
+		std::unique_lock<std::mutex> _lock(m_mtxAsyncTasks);
+		return m_hashInFlightTasks.find(requestId) != m_hashInFlightTasks.end();
+	}
+
+	int CMCPSession::StopAsyncTasks()
+	{
+		// Cancel in-flight tasks first so that workers blocked in long tools can return.
+		std::vector<std::pair<MCP::RequestId, std::shared_ptr<MCP::CMCPTask>>> vecTasks;
+		{
+			std::unique_lock<std::mutex> _lock(m_mtxAsyncTasks);
+			m_bRunAsyncTask = false;
+			for (auto& itrTask : m_hashInFlightTasks)
 			{
+				auto spTask = itrTask.second.lock();
 				if (spTask)
-				{
-					if (ERRNO_OK == spTask->Execute())
-					{
-						m_vecAsyncTasksCache.push_back(spTask);
-					}
-				}
+					vecTasks.emplace_back(itrTask.first, spTask);
 			}
+			m_hashInFlightTasks.clear();
+			m_hashDetachedTasks.clear();
+		}
+		for (auto& itrTask : vecTasks)
+		{
+			CancelTask(itrTask.second, itrTask.first, CancelReason_Shutdown);
 		}
 
 		return ERRNO_OK;
 	}
+
+	void CMCPSession::OnAsyncTaskExecuted(const std::shared_ptr<MCP::CMCPTask>& spTask, int iErrCode)
+	{
+		auto spProcessRequestTask = std::static_pointer_cast<MCP::ProcessRequest>(spTask);
+		auto spRequest = spProcessRequestTask->GetRequest();
+		if (!spRequest)
+			return;
+
+		{
+			std::unique_lock<std::mutex> _lock(m_mtxAsyncTasks);
+			auto itrFound = m_hashInFlightTasks.find(spRequest->requestId);
+			if (itrFound == m_hashInFlightTasks.end() || itrFound->second.lock() != spTask)
+				return;
+
+			// A task that is still running on its own after Execute() returned stays tracked (and cancellable);
+			// the session keeps it alive until it reports its result.
+			if (ERRNO_OK == iErrCode && !spTask->IsFinished() && !spTask->IsCancelled())
+			{
+				m_hashDetachedTasks[spRequest->requestId] = spTask;
+				return;
+			}
+			m_hashInFlightTasks.erase(itrFound);
+		}
+		// The request was not answered.
+		if (ERRNO_OK != iErrCode)
+			DropResponse(spRequest->requestId);
+	}
 }
 
 namespace MCP
 {
     int CMCPSession::AuthorizeRequest(const std::shared_ptr<MCP::Request>& spRequest) const
     {
-        // Load configuration
+        // Read from the current snapshot without locking, see Config::Current().
         auto& config = Config::GetInstance();
         
         // If auth is disabled, allow all requests
@@ -825,19 +1447,12 @@ namespace MCP
             return ERRNO_OK;
         }
 
-        // In a real implementation, this would check:
-        // 1. API key from request headers
-        // 2. JWT tokens
-        // 3. OAuth2 tokens
-        // 4. Other authentication mechanisms
-        
-        // For now, we'll do a simple API key check
-        // In a real implementation, you'd extract the API key from the transport layer
-        // and compare it with the configured API key
-        
-        // Placeholder: always allow for now
-        // TODO: Implement proper authentication check
+        // The credentials are checked by the transport, once per connection or token (see
+        // CMCPAuthenticator), so the per request cost here is a virtual call.
         (void)spRequest;
+        if (!m_spTransport || !m_spTransport->IsAuthenticated())
+            return ERRNO_UNAUTHORIZED;
+
         return ERRNO_OK;
     }
 }
\ No newline at end of file
@@ -11,15 +11,30 @@
 #include <atomic>
 #include <condition_variable>
 #include <mutex>
+#include <functional>
 #include "../Public/PublicDef.h"
+#include "../Public/Logger.h"
 #include "../Message/Request.h"
+#include "../Message/Notification.h"
 #include "../Message/BasicMessage.h"
 #include "../Transport/Transport.h"
 #include "../Task/BasicTask.h"
+#include "../Task/TaskScheduler.h"
+#include "../Task/DeadlineTimer.h"
+#include "MethodRegistry.h"
+#include "MessageHistory.h"
+#include "ServerDefinition.h"
+#include "ResourceCache.h"
+#include "ToolResultCache.h"
+#include "BatchResponse.h"
 
 namespace MCP
 {
-	class CMCPSession
+	class CMCPSessionManager;
+
+	// The protocol state of one connected client. Sessions are created by CMCPSessionManager,
+	// one per transport, and only read the shared server definition.
+	class CMCPSession : public std::enable_shared_from_this<CMCPSession>
 	{
 	public:
 		enum SessionState
@@ -31,36 +46,90 @@ namespace MCP
 			SessionState_Shut,
 		};
 
+		CMCPSession(const std::shared_ptr<const ServerDefinition>& spDefinition, CMCPSessionManager& manager, const std::shared_ptr<CMCPTransport>& spTransport);
 		~CMCPSession() = default;
 		CMCPSession(const CMCPSession&) = delete;
 		CMCPSession& operator=(const CMCPSession&) = delete;
-		static CMCPSession& GetInstance();
 
 		int Ready();
+		// Reads and processes messages until the transport is closed.
 		int Run();
+		// Processes one message; used when the transport pushes messages instead of being read.
+		int ProcessFrame(const char* pBegin, const char* pEnd);
+		// Cancels the tasks of this session and disconnects its transport; safe to call more than once.
 		int Terminate();
 
-		void SetTransport(const std::shared_ptr<CMCPTransport>& spTransport);
-		void SetServerInfo(const MCP::Implementation& impl);
-		void SetServerCapabilities(const MCP::ServerCapabilities& capabilities);
-		void SetServerToolsPagination(bool bPagination);
-		void SetServerTools(const std::vector<MCP::Tool>& tools);
-		void SetServerCallToolsTasks(const std::unordered_map<std::string, std::shared_ptr<MCP::ProcessCallToolRequest>>& hashCallToolsTasks);
-		MCP::Implementation GetServerInfo() const;
-		MCP::ServerCapabilities GetServerCapabilities() const;
-		bool GetServerToolsPagination() const;
-		std::vector<MCP::Tool> GetServerTools() const;
+		const MCP::Implementation& GetServerInfo() const;
+		const MCP::ServerCapabilities& GetServerCapabilities() const;
+		// The tools as currently registered; hold on to the pointer to see one consistent version.
+		std::shared_ptr<const ServerTools> GetServerTools() const;
+		const CMCPListCache& GetServerToolsList() const;
+		const CMCPListCache& GetServerResourcesList() const;
+		const CMCPListCache& GetServerPromptsList() const;
+		std::shared_ptr<MCP::CMCPResourceProvider> GetServerResourceProvider() const;
 		std::shared_ptr<CMCPTransport> GetTransport() const;
 		SessionState GetSessionState() const;
-		std::shared_ptr<MCP::ProcessRequest> GetServerCallToolsTask(const std::string& strToolName);
+		std::shared_ptr<MCP::ProcessRequest> GetServerCallToolsTask(const std::string& strToolName) const;
+		// Runs fnCallback on the shared timer thread once tpWhen is reached; the callback must not block.
+		int ScheduleCallback(const CMCPDeadlineTimer::Clock::time_point& tpWhen, std::function<void()> fnCallback);
+		// Runs a task continuing an asynchronous tools/call on the task workers; see ProcessAsyncCallToolRequest.
+		int CommitContinuation(const std::shared_ptr<MCP::CMCPTask>& spTask);
+		// Tracks a call answered by a task committed for another one, see CMCPToolCallFlight.
+		int AttachAsyncTask(const std::shared_ptr<MCP::CMCPTask>& spTask, const MCP::RequestId& requestId);
+		// The client does not keep up with the output: more than [session] output_high_watermark_bytes
+		// are pending in the transport. Whatever can be dropped or coalesced should be held back.
+		bool IsOutputCongested() const;
+		// Writes a message in the encoding negotiated with the client; responses go through WriteResponse().
+		int WriteMessage(const std::string& strMessage);
+		// Writes the response to a request. The responses to the requests of a batch are held back
+		// and written together as the batch response once the last of them is answered.
+		int WriteResponse(const MCP::RequestId& requestId, const std::string& strResponse);
+		// The stream a response too large to be built in memory is written to, see WriteResponse().
+		std::unique_ptr<CMCPMessageStream> OpenResponseStream(const MCP::RequestId& requestId);
+		// Called by tool tasks once their result has been sent.
+		int CompleteAsyncTask(const MCP::RequestId& requestId, int iStatus = ERRNO_OK);
+		// Most recent incoming messages, oldest first; sized by [session] history_size.
+		std::vector<MCP::MessageRecord> GetMessageHistory() const;
+		// Queue depth and wait time of the asynchronous task lanes, shared by all sessions.
+		MCP::TaskLaneStats GetTaskLaneStats(MCP::TaskLane eLane) const;
+		// Serialized resources/read results, shared by all sessions.
+		CMCPResourceCache& GetResourceCache() const;
+		// Results of the tools registered with a cache TTL, shared by all sessions.
+		CMCPToolResultCache& GetToolResultCache() const;
+		// Sends notifications/resources/updated; called by the resource watcher.
+		int NotifyResourceUpdated(const std::string& strUri);
+		// Sends notifications/tools/list_changed to an initialized client; called when tools are
+		// registered again while serving.
+		int NotifyToolsListChanged();
+		// Sends a log record as notifications/message; called by the client log sink.
+		int SendLogMessage(const MCP::LogRecord& record);
+
+		// Adds the handlers of the methods implemented by the SDK.
+		static void RegisterBuiltinMethods(CMCPMethodRegistry& registry);
+
+		template <class T>
+		static std::shared_ptr<MCP::Message> CreateMessage()
+		{
+			return std::make_shared<T>(true);
+		}
 
 	private:
-		CMCPSession() = default;
+		friend class CMCPSessionManager;
+
 		int ParseMessage(const std::string& strMsg, std::shared_ptr<MCP::Message>& spMsg);
-		int ParseRequest(const std::string& strMsg, std::shared_ptr<MCP::Message>& spMsg);
-		int ParseResponse(const std::string& strMsg, std::shared_ptr<MCP::Message>& spMsg);
-		int ParseNotification(const std::string& strMsg, std::shared_ptr<MCP::Message>& spMsg);
-		int ProcessMessage(int iErrCode, const std::shared_ptr<MCP::Message>& spMsg);
+		int ParseMessage(const char* pBegin, const char* pEnd, std::shared_ptr<MCP::Message>& spMsg);
+		int ParseMessage(const Json::Value& jVal, std::shared_ptr<MCP::Message>& spMsg);
+		// Parses a message, or a JSON-RPC batch of them, into the arena of the thread.
+		int ParseFrame(const char* pBegin, const char* pEnd, Json::Value& jVal);
+		// Same for a frame in the FlatBuffers encoding; batches only exist in JSON.
+		int DecodeFrame(const char* pBegin, const char* pEnd, Json::Value& jVal);
+		int ParseRequest(const Json::Value& jMsg, std::shared_ptr<MCP::Message>& spMsg);
+		int ParseResponse(const Json::Value& jMsg, std::shared_ptr<MCP::Message>& spMsg);
+		int ParseNotification(const Json::Value& jMsg, std::shared_ptr<MCP::Message>& spMsg);
+		int ProcessMessage(int iErrCode, const std::shared_ptr<MCP::Message>& spMsg, size_t nSize);
+		// Dispatches the elements in order; tool calls among them run concurrently on the task scheduler.
+		int ProcessBatch(const Json::Value& jBatch, size_t nSize);
+		void RecordMessage(const std::shared_ptr<MCP::Message>& spMsg, size_t nSize, int iErrCode);
 		int ProcessRequest(int iErrCode, const std::shared_ptr<MCP::Message>& spMsg);
 		// Authorization hook: return ERRNO_OK if allowed, otherwise ERRNO_UNAUTHORIZED/ERRNO_FORBIDDEN
 		int AuthorizeRequest(const std::shared_ptr<MCP::Request>& spRequest) const;
@@ -68,33 +137,68 @@ namespace MCP
 		int ProcessNotification(int iErrCode, const std::shared_ptr<MCP::Message>& spMsg);
 		int SwitchState(SessionState eState);
 
+		// Built-in method handlers
+		int HandleInitializeRequest(const std::shared_ptr<MCP::Request>& spRequest, std::string& strErrMsg);
+		int HandlePingRequest(const std::shared_ptr<MCP::Request>& spRequest, std::string& strErrMsg);
+		int HandleListToolsRequest(const std::shared_ptr<MCP::Request>& spRequest, std::string& strErrMsg);
+		int HandleCallToolRequest(const std::shared_ptr<MCP::Request>& spRequest, std::string& strErrMsg);
+		int HandleListResourcesRequest(const std::shared_ptr<MCP::Request>& spRequest, std::string& strErrMsg);
+		int HandleReadResourceRequest(const std::shared_ptr<MCP::Request>& spRequest, std::string& strErrMsg);
+		int HandleSubscribeRequest(const std::shared_ptr<MCP::Request>& spRequest, std::string& strErrMsg);
+		int HandleUnsubscribeRequest(const std::shared_ptr<MCP::Request>& spRequest, std::string& strErrMsg);
+		int HandleListPromptsRequest(const std::shared_ptr<MCP::Request>& spRequest, std::string& strErrMsg);
+		int HandleSetLevelRequest(const std::shared_ptr<MCP::Request>& spRequest, std::string& strErrMsg);
+		int HandleInitializedNotification(const std::shared_ptr<MCP::Notification>& spNotification);
+		int HandleCancelledNotification(const std::shared_ptr<MCP::Notification>& spNotification);
+		// Takes a token of the client and of the tool, see [rate_limits]; ERRNO_RATE_LIMITED when either ran out.
+		int AdmitToolCall(const std::string& strToolName);
+
 		// Asynchronous task management
-		int CommitAsyncTask(const std::shared_ptr<MCP::CMCPTask>& spTask);
+		int CommitAsyncTask(const std::shared_ptr<MCP::CMCPTask>& spTask, const MCP::RequestId& requestId, const std::string& strGroup);
 		int CancelAsyncTask(const MCP::RequestId& requestId);
-		int StartAsyncTaskThread();
-		int StopAsyncTaskThread();
-		int AsyncThreadProc();
+		bool IsAsyncTaskInFlight(const MCP::RequestId& requestId);
+		void CancelTask(const std::shared_ptr<MCP::CMCPTask>& spTask, const MCP::RequestId& requestId, CancelReason eReason);
+		int StopAsyncTasks();
+		void OnAsyncTaskExecuted(const std::shared_ptr<MCP::CMCPTask>& spTask, int iErrCode);
 
-		static CMCPSession s_Instance;
+		// Batch responses
+		std::shared_ptr<CMCPBatchResponse> TakeBatch(const MCP::RequestId& requestId);
+		bool IsBatchedRequest(const MCP::RequestId& requestId);
+		// Settles a batched request that will not be answered.
+		void DropResponse(const MCP::RequestId& requestId);
 
 		SessionState m_eSessionState{ SessionState_Original };
 		std::shared_ptr<CMCPTransport> m_spTransport;
+		std::shared_ptr<const ServerDefinition> m_spDefinition;
+		CMCPSessionManager& m_manager;
+		std::atomic_bool m_bTerminated{ false };
+		// Only used by the thread dispatching the frames; reused so that parsing a line keeps the parser state.
+		MCP::CMCPJsonParser m_jsonParser;
+		// Set once the initialize response negotiating the FlatBuffers encoding has been written; every
+		// message read or written afterwards is a length prefixed frame, see CMCPFlatBuffersCodec.
+		std::atomic_bool m_bFlatBuffers{ false };
 
-		MCP::Implementation m_serverInfo;
-		MCP::ServerCapabilities m_capabilities;
-		std::vector<MCP::Tool> m_tools;
-		bool m_bToolsPagination{ false };
-
-		std::unordered_map<MessageCategory, std::vector<std::shared_ptr<MCP::Message>>> m_hashMessage;
-		std::unordered_map<std::string, std::shared_ptr<MCP::ProcessCallToolRequest>> m_hashCallToolsTasks;
+		CMCPMessageHistory m_messageHistory;
+		// Bucket key of the client in the rate limiter: its principal, or this session.
+		std::string m_strRateLimitKey;
 
 		// Asynchronous task management
-		std::unique_ptr<std::thread> m_upTaskThread;
-		std::atomic_bool m_bRunAsyncTask{ true };
-		std::mutex m_mtxAsyncThread;
-		std::condition_variable m_cvAsyncThread;
-		std::deque<std::shared_ptr<MCP::CMCPTask>> m_deqAsyncTasks;
-		std::vector<MCP::RequestId> m_vecCancelledTaskIds;
-		std::vector<std::shared_ptr<MCP::CMCPTask>> m_vecAsyncTasksCache;
+		std::mutex m_mtxAsyncTasks;
+		bool m_bRunAsyncTask{ false };
+		// Tasks committed to the scheduler that have not completed yet (queued, executing, or running on their own),
+		// used for O(1) cancellation, completion and duplicate id detection.
+		std::unordered_map<MCP::RequestId, std::weak_ptr<MCP::CMCPTask>, MCP::RequestIdHash> m_hashInFlightTasks;
+		// Owns the tasks that are still running on their own after Execute() returned.
+		std::unordered_map<MCP::RequestId, std::shared_ptr<MCP::CMCPTask>, MCP::RequestIdHash> m_hashDetachedTasks;
+
+		// Requests of the batches waiting for their responses; [session] batch_stream_responses
+		// answers the requests of a batch one by one instead.
+		std::mutex m_mtxBatches;
+		std::atomic<size_t> m_nBatchedRequests{ 0 };
+		std::unordered_map<MCP::RequestId, std::shared_ptr<CMCPBatchResponse>, MCP::RequestIdHash> m_hashBatchedRequests;
+
+		// Uris this session subscribed to, unsubscribed by Terminate().
+		std::mutex m_mtxSubscriptions;
+		std::set<std::string> m_setSubscriptions;
 	};
-}
\ No newline at end of file
+}
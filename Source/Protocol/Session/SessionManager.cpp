@@ -0,0 +1,404 @@
+#include "SessionManager.h"
+#include "Session.h"
+#include "../Public/Config.h"
+#include "../Public/Trace.h"
+#include "../Public/Logger.h"
+#include "../Task/BasicTask.h"
+
+namespace MCP
+{
+	CMCPSessionManager::~CMCPSessionManager()
+	{
+		Stop();
+	}
+
+	int CMCPSessionManager::Start(const std::shared_ptr<const ServerDefinition>& spDefinition)
+	{
+		if (!spDefinition)
+			return ERRNO_INTERNAL_ERROR;
+
+		{
+			std::unique_lock<std::mutex> _lock(m_mtxSessions);
+			if (m_bRunning)
+				return ERRNO_INTERNAL_ERROR;
+			m_bRunning = true;
+			m_spDefinition = spDefinition;
+		}
+
+		auto& config = Config::GetInstance();
+		ApplyConfig();
+		// The limits, cache sizes and metrics follow the file; the rest is applied once.
+		m_iReloadHandlerId = config.AddReloadHandler([this](const ConfigSnapshot&) { ApplyConfig(); });
+		config.StartWatching();
+
+		m_deadlineTimer.Start();
+
+		if (spDefinition->spResourceProvider)
+		{
+			int iInterval = config.GetResourceWatchInterval();
+			m_resourceWatcher.Start(spDefinition->spResourceProvider, m_resourceCache, iInterval > 0 ? static_cast<unsigned int>(iInterval) : 1000);
+		}
+
+		CMCPTrace::GetInstance().Start();
+		CMCPLogger::GetInstance().Start();
+		CMCPLogger::GetInstance().AddSink(m_spClientLogSink);
+
+		int iThreads = config.GetTaskWorkerThreads();
+		int iReserved = config.GetTaskReservedWorkers();
+		return m_taskScheduler.Start(iThreads > 0 ? static_cast<size_t>(iThreads) : 0, iReserved > 0 ? static_cast<size_t>(iReserved) : 0,
+			[this](const std::shared_ptr<MCP::CMCPTask>& spTask, int iErrCode, unsigned long long ullWaitUs, unsigned long long ullRunUs)
+			{
+				// Taken for every task, so that nothing written by one is attributed to the next.
+				size_t nBytesOut = CMCPMetrics::TakeBytesWritten();
+				auto spCallToolTask = std::dynamic_pointer_cast<MCP::ProcessCallToolRequest>(spTask);
+				if (spCallToolTask && m_metrics.IsEnabled())
+				{
+					auto spRequest = std::dynamic_pointer_cast<MCP::CallToolRequest>(spCallToolTask->GetRequest());
+					if (spRequest)
+						m_metrics.RecordTool(spRequest->strName, iErrCode, nBytesOut, ullWaitUs, ullRunUs);
+				}
+
+				// A tool failing without answering would leave the calls of its flight waiting,
+				// including those of other sessions.
+				if (ERRNO_OK != iErrCode)
+				{
+					MCP_LOG_WARNING("task", "task failed with {}", iErrCode);
+					auto spFlight = spCallToolTask ? spCallToolTask->GetFlight() : nullptr;
+					if (spFlight)
+						spFlight->Fail(ERRNO_INTERNAL_ERROR, ERROR_MESSAGE_INTERNAL_ERROR);
+				}
+				auto spProcessRequestTask = std::static_pointer_cast<MCP::ProcessRequest>(spTask);
+				auto spSession = spProcessRequestTask->GetSession();
+				if (spSession)
+					spSession->OnAsyncTaskExecuted(spTask, iErrCode);
+			});
+	}
+
+	int CMCPSessionManager::Stop()
+	{
+		std::list<std::shared_ptr<SessionSlot>> listSessions;
+		std::list<std::shared_ptr<CMCPSession>> listForegroundSessions;
+		std::unordered_map<CMCPSession*, std::shared_ptr<CMCPSession>> hashAttachedSessions;
+		{
+			std::unique_lock<std::mutex> _lock(m_mtxSessions);
+			if (!m_bRunning)
+				return ERRNO_OK;
+			m_bRunning = false;
+			listSessions.swap(m_listSessions);
+			listForegroundSessions.swap(m_listForegroundSessions);
+			hashAttachedSessions.swap(m_hashAttachedSessions);
+		}
+
+		// Terminating a session closes its transport, which makes its Run() return.
+		for (auto& spSlot : listSessions)
+		{
+			spSlot->spSession->Terminate();
+		}
+		for (auto& spSession : listForegroundSessions)
+		{
+			spSession->Terminate();
+		}
+		for (auto& itrSession : hashAttachedSessions)
+		{
+			itrSession.second->Terminate();
+		}
+		for (auto& spSlot : listSessions)
+		{
+			if (spSlot->thrSession.joinable())
+				spSlot->thrSession.join();
+		}
+
+		Config::GetInstance().RemoveReloadHandler(m_iReloadHandlerId);
+		m_resourceWatcher.Stop();
+		m_deadlineTimer.Stop();
+		CMCPTrace::GetInstance().Stop();
+		CMCPLogger::GetInstance().RemoveSink(m_spClientLogSink);
+		CMCPLogger::GetInstance().Stop();
+
+		return m_taskScheduler.Stop();
+	}
+
+	void CMCPSessionManager::ApplyConfig()
+	{
+		auto& config = Config::GetInstance();
+		std::shared_ptr<const ServerDefinition> spDefinition;
+		{
+			std::unique_lock<std::mutex> _lock(m_mtxSessions);
+			spDefinition = m_spDefinition;
+		}
+		if (!spDefinition)
+			return;
+
+		auto spTools = std::atomic_load(&spDefinition->spTools);
+		for (auto& itrPool : spTools->hashCallToolsPools)
+		{
+			size_t nLimit = 0;
+			auto itrLimit = spTools->hashToolsConcurrency.find(itrPool.first);
+			if (itrLimit != spTools->hashToolsConcurrency.end())
+				nLimit = itrLimit->second;
+			int iLimit = config.GetToolMaxConcurrency(itrPool.first, static_cast<int>(nLimit));
+			m_taskScheduler.SetGroupLimit(itrPool.first, iLimit > 0 ? static_cast<size_t>(iLimit) : 0);
+		}
+		int iMaxPending = config.GetTaskMaxPendingCalls();
+		m_taskScheduler.SetPendingLimit(iMaxPending > 0 ? static_cast<size_t>(iMaxPending) : 0);
+
+		int iToolCacheBytes = config.GetToolCacheBytes();
+		m_toolResultCache.SetCapacity(iToolCacheBytes > 0 ? static_cast<size_t>(iToolCacheBytes) : 0);
+		if (spDefinition->spResourceProvider)
+		{
+			int iCacheBytes = config.GetResourceReadCacheBytes();
+			m_resourceCache.SetCapacity(iCacheBytes > 0 ? static_cast<size_t>(iCacheBytes) : 0);
+		}
+
+		m_metrics.SetEnabled(config.GetMetricsEnabled());
+	}
+
+	std::shared_ptr<CMCPSession> CMCPSessionManager::CreateSession(const std::shared_ptr<CMCPTransport>& spTransport)
+	{
+		if (!spTransport)
+			return nullptr;
+
+		std::shared_ptr<const ServerDefinition> spDefinition;
+		{
+			std::unique_lock<std::mutex> _lock(m_mtxSessions);
+			if (!m_bRunning)
+				return nullptr;
+			spDefinition = m_spDefinition;
+		}
+
+		auto spSession = std::make_shared<CMCPSession>(spDefinition, *this, spTransport);
+		if (!spSession || ERRNO_OK != spSession->Ready())
+			return nullptr;
+
+		return spSession;
+	}
+
+	int CMCPSessionManager::StartSession(const std::shared_ptr<CMCPTransport>& spTransport)
+	{
+		ReapSessions();
+
+		auto spSession = CreateSession(spTransport);
+		if (!spSession)
+			return ERRNO_INTERNAL_ERROR;
+
+		std::weak_ptr<CMCPSession> wpSession = spSession;
+		{
+			std::unique_lock<std::mutex> _lock(m_mtxSessions);
+			m_hashAttachedSessions[spSession.get()] = spSession;
+		}
+		bool bAttached = spTransport->SetFrameHandler(
+			[wpSession](const char* pBegin, const char* pEnd)
+			{
+				auto spSession = wpSession.lock();
+				if (spSession)
+					spSession->ProcessFrame(pBegin, pEnd);
+			},
+			[this, wpSession]()
+			{
+				auto spSession = wpSession.lock();
+				if (spSession)
+					DetachSession(spSession);
+			});
+		if (bAttached)
+		{
+			std::unique_lock<std::mutex> _lock(m_mtxSessions);
+			if (m_bRunning)
+				return ERRNO_OK;
+			// Stop() ran meanwhile and may have missed the session.
+			m_hashAttachedSessions.erase(spSession.get());
+			_lock.unlock();
+			spSession->Terminate();
+			return ERRNO_INTERNAL_ERROR;
+		}
+		{
+			std::unique_lock<std::mutex> _lock(m_mtxSessions);
+			m_hashAttachedSessions.erase(spSession.get());
+		}
+
+		auto spSlot = std::make_shared<SessionSlot>();
+		spSlot->spSession = spSession;
+
+		std::unique_lock<std::mutex> _lock(m_mtxSessions);
+		if (!m_bRunning)
+		{
+			_lock.unlock();
+			spSession->Terminate();
+			return ERRNO_INTERNAL_ERROR;
+		}
+		// The slot is only touched by the thread through a weak reference: Stop() may already own it.
+		std::weak_ptr<SessionSlot> wpSlot = spSlot;
+		spSlot->thrSession = std::thread([spSession, wpSlot]()
+			{
+				spSession->Run();
+				spSession->Terminate();
+				auto spSlot = wpSlot.lock();
+				if (spSlot)
+					spSlot->bFinished = true;
+			});
+		m_listSessions.push_back(spSlot);
+
+		return ERRNO_OK;
+	}
+
+	int CMCPSessionManager::RunSession(const std::shared_ptr<CMCPTransport>& spTransport)
+	{
+		auto spSession = CreateSession(spTransport);
+		if (!spSession)
+			return ERRNO_INTERNAL_ERROR;
+
+		{
+			std::unique_lock<std::mutex> _lock(m_mtxSessions);
+			m_listForegroundSessions.push_back(spSession);
+		}
+
+		// Run() only returns once the client is gone, which is the normal end of the session.
+		spSession->Run();
+
+		{
+			std::unique_lock<std::mutex> _lock(m_mtxSessions);
+			m_listForegroundSessions.remove(spSession);
+		}
+		spSession->Terminate();
+
+		return ERRNO_OK;
+	}
+
+	void CMCPSessionManager::DetachSession(const std::shared_ptr<CMCPSession>& spSession)
+	{
+		{
+			std::unique_lock<std::mutex> _lock(m_mtxSessions);
+			m_hashAttachedSessions.erase(spSession.get());
+		}
+		spSession->Terminate();
+	}
+
+	void CMCPSessionManager::ReapSessions()
+	{
+		std::list<std::shared_ptr<SessionSlot>> listFinished;
+		{
+			std::unique_lock<std::mutex> _lock(m_mtxSessions);
+			for (auto itrSlot = m_listSessions.begin(); itrSlot != m_listSessions.end();)
+			{
+				if ((*itrSlot)->bFinished)
+				{
+					listFinished.push_back(*itrSlot);
+					itrSlot = m_listSessions.erase(itrSlot);
+				}
+				else
+				{
+					++itrSlot;
+				}
+			}
+		}
+		for (auto& spSlot : listFinished)
+		{
+			if (spSlot->thrSession.joinable())
+				spSlot->thrSession.join();
+		}
+	}
+
+	size_t CMCPSessionManager::GetSessionCount() const
+	{
+		std::unique_lock<std::mutex> _lock(m_mtxSessions);
+		size_t nCount = m_listForegroundSessions.size() + m_hashAttachedSessions.size();
+		for (auto& spSlot : m_listSessions)
+		{
+			if (!spSlot->bFinished)
+				++nCount;
+		}
+
+		return nCount;
+	}
+
+	MCP::TaskLaneStats CMCPSessionManager::GetTaskLaneStats(MCP::TaskLane eLane) const
+	{
+		return m_taskScheduler.GetLaneStats(eLane);
+	}
+
+	CMCPMetrics& CMCPSessionManager::GetMetrics()
+	{
+		return m_metrics;
+	}
+
+	const CMCPMetrics& CMCPSessionManager::GetMetrics() const
+	{
+		return m_metrics;
+	}
+
+	int CMCPSessionManager::CommitTask(const std::shared_ptr<MCP::CMCPTask>& spTask, const std::string& strGroup)
+	{
+		return m_taskScheduler.Commit(spTask, strGroup);
+	}
+
+	int CMCPSessionManager::ScheduleDeadline(const CMCPDeadlineTimer::Clock::time_point& tpDeadline, std::function<void()> fnCallback)
+	{
+		return m_deadlineTimer.Schedule(tpDeadline, std::move(fnCallback));
+	}
+
+	CMCPResourceCache& CMCPSessionManager::GetResourceCache()
+	{
+		return m_resourceCache;
+	}
+
+	CMCPToolResultCache& CMCPSessionManager::GetToolResultCache()
+	{
+		return m_toolResultCache;
+	}
+
+	CMCPToolCallFlights& CMCPSessionManager::GetToolCallFlights()
+	{
+		return m_toolCallFlights;
+	}
+
+	CMCPRateLimiter& CMCPSessionManager::GetRateLimiter()
+	{
+		return m_rateLimiter;
+	}
+
+	void CMCPSessionManager::SubscribeResource(const std::string& strUri, const std::shared_ptr<CMCPSession>& spSession)
+	{
+		m_resourceWatcher.Subscribe(strUri, spSession);
+	}
+
+	void CMCPSessionManager::UnsubscribeResource(const std::string& strUri, const CMCPSession* pSession)
+	{
+		m_resourceWatcher.Unsubscribe(strUri, pSession);
+	}
+
+	CMCPClientLogSink& CMCPSessionManager::GetClientLogSink()
+	{
+		return *m_spClientLogSink;
+	}
+
+	void CMCPSessionManager::NotifyResourceUpdated(const std::string& strUri)
+	{
+		m_resourceWatcher.NotifyUpdated(strUri);
+	}
+
+	void CMCPSessionManager::NotifyToolsChanged()
+	{
+		std::vector<std::shared_ptr<CMCPSession>> vecSessions;
+		{
+			std::unique_lock<std::mutex> _lock(m_mtxSessions);
+			if (!m_bRunning)
+				return;
+			for (auto& spSlot : m_listSessions)
+			{
+				if (!spSlot->bFinished)
+					vecSessions.push_back(spSlot->spSession);
+			}
+			vecSessions.insert(vecSessions.end(), m_listForegroundSessions.begin(), m_listForegroundSessions.end());
+			for (auto& itrSession : m_hashAttachedSessions)
+			{
+				vecSessions.push_back(itrSession.second);
+			}
+		}
+
+		// New tools get their [tool_limits] like those registered before Start().
+		ApplyConfig();
+		for (auto& spSession : vecSessions)
+		{
+			spSession->NotifyToolsListChanged();
+		}
+	}
+}
@@ -0,0 +1,110 @@
+#pragma once
+// To ensure good cross-platform compatibility, the MCP namespace code uses standard C++ only.
+// Avoid using platform-specific system APIs unless absolutely necessary.
+
+#include <memory>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include "../Public/PublicDef.h"
+#include "../Transport/Transport.h"
+#include "../Task/TaskScheduler.h"
+#include "../Task/DeadlineTimer.h"
+#include "ServerDefinition.h"
+#include "ResourceCache.h"
+#include "ResourceWatcher.h"
+#include "ToolResultCache.h"
+#include "ToolCallFlight.h"
+#include "Metrics.h"
+#include "ClientLogSink.h"
+#include "RateLimiter.h"
+
+namespace MCP
+{
+	class CMCPSession;
+
+	// Runs one CMCPSession per connected client.
+	// All sessions share the server definition, the tool task scheduler (so [tool_limits] and the
+	// worker pool apply to the server as a whole) and the deadline timer.
+	class CMCPSessionManager
+	{
+	public:
+		CMCPSessionManager() = default;
+		~CMCPSessionManager();
+		CMCPSessionManager(const CMCPSessionManager&) = delete;
+		CMCPSessionManager& operator=(const CMCPSessionManager&) = delete;
+
+		int Start(const std::shared_ptr<const ServerDefinition>& spDefinition);
+		// Terminates every session (cancelling their tasks) and joins the session threads.
+		int Stop();
+
+		// Runs a session for the transport: on the transport's own thread when it pushes messages
+		// (see CMCPTransport::SetFrameHandler), otherwise on a thread of the session.
+		int StartSession(const std::shared_ptr<CMCPTransport>& spTransport);
+		// Runs a session for the transport on the calling thread until the transport is closed.
+		int RunSession(const std::shared_ptr<CMCPTransport>& spTransport);
+
+		size_t GetSessionCount() const;
+		MCP::TaskLaneStats GetTaskLaneStats(MCP::TaskLane eLane) const;
+		// Counters and latencies of every session; see [metrics] in config.ini.
+		CMCPMetrics& GetMetrics();
+		const CMCPMetrics& GetMetrics() const;
+
+		// Used by sessions.
+		int CommitTask(const std::shared_ptr<MCP::CMCPTask>& spTask, const std::string& strGroup);
+		int ScheduleDeadline(const CMCPDeadlineTimer::Clock::time_point& tpDeadline, std::function<void()> fnCallback);
+		CMCPResourceCache& GetResourceCache();
+		CMCPToolResultCache& GetToolResultCache();
+		CMCPToolCallFlights& GetToolCallFlights();
+		// The token buckets of [rate_limits].
+		CMCPRateLimiter& GetRateLimiter();
+		void SubscribeResource(const std::string& strUri, const std::shared_ptr<CMCPSession>& spSession);
+		void UnsubscribeResource(const std::string& strUri, const CMCPSession* pSession);
+		// Where the sessions register the level of logging/setLevel.
+		CMCPClientLogSink& GetClientLogSink();
+
+		// Sends notifications/resources/updated to the sessions subscribed to the resource.
+		void NotifyResourceUpdated(const std::string& strUri);
+		// Applies the limits of tools registered while serving, and sends notifications/tools/list_changed
+		// to the sessions when the server announced listChanged.
+		void NotifyToolsChanged();
+
+	private:
+		struct SessionSlot
+		{
+			std::shared_ptr<CMCPSession> spSession;
+			std::thread thrSession;
+			std::atomic_bool bFinished{ false };
+		};
+
+		// Applies the settings that follow a reload of the configuration.
+		void ApplyConfig();
+		std::shared_ptr<CMCPSession> CreateSession(const std::shared_ptr<CMCPTransport>& spTransport);
+		void DetachSession(const std::shared_ptr<CMCPSession>& spSession);
+		// Joins the threads of sessions whose client has gone away.
+		void ReapSessions();
+
+		std::shared_ptr<const ServerDefinition> m_spDefinition;
+		CMCPTaskScheduler m_taskScheduler;
+		CMCPDeadlineTimer m_deadlineTimer;
+		CMCPResourceCache m_resourceCache;
+		CMCPResourceWatcher m_resourceWatcher;
+		CMCPToolResultCache m_toolResultCache;
+		CMCPToolCallFlights m_toolCallFlights{ m_toolResultCache };
+		CMCPMetrics m_metrics;
+		CMCPRateLimiter m_rateLimiter;
+		std::shared_ptr<CMCPClientLogSink> m_spClientLogSink{ std::make_shared<CMCPClientLogSink>() };
+		int m_iReloadHandlerId{ 0 };
+
+		mutable std::mutex m_mtxSessions;
+		bool m_bRunning{ false };
+		std::list<std::shared_ptr<SessionSlot>> m_listSessions;
+		// Sessions run by RunSession(), tracked so that Stop() can terminate them.
+		std::list<std::shared_ptr<CMCPSession>> m_listForegroundSessions;
+		// Sessions driven by their transport's thread.
+		std::unordered_map<CMCPSession*, std::shared_ptr<CMCPSession>> m_hashAttachedSessions;
+	};
+}
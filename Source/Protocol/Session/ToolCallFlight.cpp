@@ -0,0 +1,196 @@
+#include "ToolCallFlight.h"
+#include "Session.h"
+#include "../Message/Response.h"
+#include "../Task/BasicTask.h"
+#include <algorithm>
+
+namespace MCP
+{
+	CMCPToolCallFlight::CMCPToolCallFlight(CMCPToolCallFlights& flights, const std::string& strKey, unsigned int nCacheTtlMs)
+		: m_flights(flights)
+		, m_strKey(strKey)
+		, m_nCacheTtlMs(nCacheTtlMs)
+	{
+	}
+
+	bool CMCPToolCallFlight::AddWaiter(const std::shared_ptr<CMCPSession>& spSession, const MCP::RequestId& requestId, int& iErrCode)
+	{
+		// Registered under the lock, so that ending the flight finds every call the sessions track.
+		std::lock_guard<std::mutex> _lock(m_mtxWaiters);
+		if (m_bEnded || !m_spTask)
+			return false;
+		iErrCode = spSession->AttachAsyncTask(m_spTask, requestId);
+		if (ERRNO_OK == iErrCode)
+			m_vecWaiters.push_back(Waiter{ spSession, requestId });
+
+		return true;
+	}
+
+	bool CMCPToolCallFlight::RemoveWaiter(const CMCPSession* pSession, const MCP::RequestId& requestId,
+		std::shared_ptr<MCP::ProcessCallToolRequest>& spLastTask)
+	{
+		{
+			std::lock_guard<std::mutex> _lock(m_mtxWaiters);
+			auto itWaiter = std::find_if(m_vecWaiters.begin(), m_vecWaiters.end(), [pSession, &requestId](const Waiter& waiter)
+				{
+					return waiter.requestId == requestId && waiter.wpSession.lock().get() == pSession;
+				});
+			if (itWaiter == m_vecWaiters.end())
+				return false;
+			m_vecWaiters.erase(itWaiter);
+			if (!m_vecWaiters.empty())
+				return true;
+			m_bEnded = true;
+			spLastTask.swap(m_spTask);
+		}
+		m_flights.Remove(m_strKey, this);
+
+		return true;
+	}
+
+	void CMCPToolCallFlight::Leave(const CMCPSession* pSession, const MCP::RequestId& requestId, CancelReason eReason)
+	{
+		std::shared_ptr<MCP::ProcessCallToolRequest> spLastTask;
+		if (RemoveWaiter(pSession, requestId, spLastTask) && spLastTask)
+			CancelTask(spLastTask, eReason);
+	}
+
+	void CMCPToolCallFlight::Expire(const std::shared_ptr<CMCPSession>& spSession, const MCP::RequestId& requestId)
+	{
+		std::shared_ptr<MCP::ProcessCallToolRequest> spLastTask;
+		if (!RemoveWaiter(spSession.get(), requestId, spLastTask))
+			return;
+
+		Answer(Waiter{ spSession, requestId }, ERRNO_REQUEST_TIMEOUT, ERROR_MESSAGE_REQUEST_TIMEOUT);
+		if (spLastTask)
+			CancelTask(spLastTask, CancelReason_Deadline);
+	}
+
+	void CMCPToolCallFlight::Complete(const std::string& strResult, bool bCache)
+	{
+		// Cached first: an identical call arriving now either joins the flight or hits the cache.
+		if (bCache)
+			m_flights.m_cache.Put(m_strKey, strResult, m_nCacheTtlMs);
+
+		std::string strResponse;
+		for (auto& waiter : End())
+		{
+			auto spSession = waiter.wpSession.lock();
+			if (!spSession)
+				continue;
+			spSession->CompleteAsyncTask(waiter.requestId);
+			MCP::Response::WrapResult(waiter.requestId, strResult, strResponse);
+			spSession->WriteResponse(waiter.requestId, strResponse);
+		}
+	}
+
+	void CMCPToolCallFlight::Fail(int iCode, const std::string& strMessage)
+	{
+		for (auto& waiter : End())
+		{
+			Answer(waiter, iCode, strMessage);
+		}
+	}
+
+	bool CMCPToolCallFlight::Claim(const CMCPSession* pSession, const MCP::RequestId& requestId)
+	{
+		bool bClaimed = false;
+		for (auto& waiter : End())
+		{
+			if (!bClaimed && waiter.requestId == requestId && waiter.wpSession.lock().get() == pSession)
+				bClaimed = true;
+			else
+				Answer(waiter, ERRNO_INTERNAL_ERROR, ERROR_MESSAGE_INTERNAL_ERROR);
+		}
+
+		return bClaimed;
+	}
+
+	std::vector<CMCPToolCallFlight::Waiter> CMCPToolCallFlight::End()
+	{
+		m_flights.Remove(m_strKey, this);
+
+		std::vector<Waiter> vecWaiters;
+		std::shared_ptr<MCP::ProcessCallToolRequest> spTask;
+		{
+			std::lock_guard<std::mutex> _lock(m_mtxWaiters);
+			m_bEnded = true;
+			vecWaiters.swap(m_vecWaiters);
+			spTask.swap(m_spTask);
+		}
+
+		return vecWaiters;
+	}
+
+	void CMCPToolCallFlight::CancelTask(const std::shared_ptr<MCP::ProcessCallToolRequest>& spTask, CancelReason eReason)
+	{
+		if (spTask->GetCancellationToken())
+			spTask->GetCancellationToken()->Cancel(eReason);
+		spTask->Cancel();
+	}
+
+	void CMCPToolCallFlight::Answer(const Waiter& waiter, int iCode, const std::string& strMessage)
+	{
+		auto spSession = waiter.wpSession.lock();
+		if (!spSession)
+			return;
+		spSession->CompleteAsyncTask(waiter.requestId, iCode);
+
+		MCP::ErrorResponse errorResponse(true);
+		errorResponse.requestId = waiter.requestId;
+		errorResponse.iCode = iCode;
+		errorResponse.strMesage = strMessage;
+		std::string strResponse;
+		if (ERRNO_OK == errorResponse.Serialize(strResponse))
+			spSession->WriteResponse(waiter.requestId, strResponse);
+	}
+
+	CMCPToolCallFlights::CMCPToolCallFlights(CMCPToolResultCache& cache)
+		: m_cache(cache)
+	{
+	}
+
+	std::shared_ptr<CMCPToolCallFlight> CMCPToolCallFlights::Join(const std::string& strKey, unsigned int nCacheTtlMs,
+		const std::shared_ptr<CMCPSession>& spSession, const MCP::RequestId& requestId,
+		const std::shared_ptr<MCP::ProcessCallToolRequest>& spTask, bool& bJoined, int& iErrCode)
+	{
+		bJoined = false;
+		iErrCode = ERRNO_OK;
+
+		std::lock_guard<std::mutex> _lock(m_mtxFlights);
+		auto itFlight = m_hashFlights.find(strKey);
+		if (itFlight != m_hashFlights.end())
+		{
+			// A flight that has just ended is replaced by the new one.
+			auto spFlight = itFlight->second.lock();
+			if (spFlight && spFlight->AddWaiter(spSession, requestId, iErrCode))
+			{
+				bJoined = true;
+				return ERRNO_OK == iErrCode ? spFlight : nullptr;
+			}
+		}
+
+		auto spFlight = std::make_shared<CMCPToolCallFlight>(*this, strKey, nCacheTtlMs);
+		spFlight->m_spTask = spTask;
+		spFlight->AddWaiter(spSession, requestId, iErrCode);
+		if (ERRNO_OK != iErrCode)
+		{
+			spFlight->m_spTask.reset();
+			return nullptr;
+		}
+		m_hashFlights[strKey] = spFlight;
+
+		return spFlight;
+	}
+
+	void CMCPToolCallFlights::Remove(const std::string& strKey, const CMCPToolCallFlight* pFlight)
+	{
+		std::lock_guard<std::mutex> _lock(m_mtxFlights);
+		auto itFlight = m_hashFlights.find(strKey);
+		if (itFlight == m_hashFlights.end())
+			return;
+		auto spFlight = itFlight->second.lock();
+		if (!spFlight || spFlight.get() == pFlight)
+			m_hashFlights.erase(itFlight);
+	}
+}
@@ -0,0 +1,100 @@
+#pragma once
+// To ensure good cross-platform compatibility, the MCP namespace code uses standard C++ only.
+// Avoid using platform-specific system APIs unless absolutely necessary.
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../Message/BasicMessage.h"
+#include "../Task/CancellationToken.h"
+#include "ToolResultCache.h"
+
+namespace MCP
+{
+	class CMCPSession;
+	class CMCPToolCallFlights;
+	class ProcessCallToolRequest;
+
+	// One execution of a cacheable tool answering every identical tools/call that arrived while it
+	// ran. Each call waits as itself: it is in the in-flight index of its session under its own
+	// request id, is cancelled and times out on its own, and the shared work is only cancelled once
+	// no waiter is left. Only the call that started the flight receives progress notifications.
+	//
+	// The flight and the task running the tool own each other until the flight ends, so that the
+	// task outlives the session that started it while other calls still wait for it.
+	class CMCPToolCallFlight
+	{
+	public:
+		CMCPToolCallFlight(CMCPToolCallFlights& flights, const std::string& strKey, unsigned int nCacheTtlMs);
+		CMCPToolCallFlight(const CMCPToolCallFlight&) = delete;
+		CMCPToolCallFlight& operator=(const CMCPToolCallFlight&) = delete;
+
+		// Removes a cancelled waiter without answering it; cancels the work if it was the last one.
+		void Leave(const CMCPSession* pSession, const MCP::RequestId& requestId, CancelReason eReason);
+		// Answers a waiter whose deadline passed with a timeout error, see Leave().
+		void Expire(const std::shared_ptr<CMCPSession>& spSession, const MCP::RequestId& requestId);
+		// Caches the serialized "result" value if bCache, and answers every waiter with it.
+		void Complete(const std::string& strResult, bool bCache);
+		// Answers every waiter with an error response.
+		void Fail(int iCode, const std::string& strMessage);
+		// A streamed result cannot be shared: ends the flight, answers every other waiter with an
+		// error, and returns false if the given call is no longer waiting.
+		bool Claim(const CMCPSession* pSession, const MCP::RequestId& requestId);
+
+	private:
+		friend class CMCPToolCallFlights;
+
+		struct Waiter
+		{
+			std::weak_ptr<CMCPSession> wpSession;
+			MCP::RequestId requestId;
+		};
+
+		// Also registers the call in its session; returns false once the flight has ended.
+		bool AddWaiter(const std::shared_ptr<CMCPSession>& spSession, const MCP::RequestId& requestId, int& iErrCode);
+		// Returns false if the waiter is unknown. Ends the flight when none is left, handing out the task.
+		bool RemoveWaiter(const CMCPSession* pSession, const MCP::RequestId& requestId,
+			std::shared_ptr<MCP::ProcessCallToolRequest>& spLastTask);
+		// Takes the waiters; later identical calls start a new flight.
+		std::vector<Waiter> End();
+		static void CancelTask(const std::shared_ptr<MCP::ProcessCallToolRequest>& spTask, CancelReason eReason);
+		static void Answer(const Waiter& waiter, int iCode, const std::string& strMessage);
+
+		CMCPToolCallFlights& m_flights;
+		std::string m_strKey;
+		unsigned int m_nCacheTtlMs{ 0 };
+
+		std::mutex m_mtxWaiters;
+		bool m_bEnded{ false };
+		std::vector<Waiter> m_vecWaiters;
+		// Released when the flight ends.
+		std::shared_ptr<MCP::ProcessCallToolRequest> m_spTask;
+	};
+
+	// The flights in progress, keyed like the tool result cache and shared by all sessions.
+	class CMCPToolCallFlights
+	{
+	public:
+		explicit CMCPToolCallFlights(CMCPToolResultCache& cache);
+		CMCPToolCallFlights(const CMCPToolCallFlights&) = delete;
+		CMCPToolCallFlights& operator=(const CMCPToolCallFlights&) = delete;
+
+		// Attaches the call to the flight in progress for strKey and sets bJoined. Otherwise returns
+		// a new flight, run by spTask, with the call as its first waiter. Either way the call is
+		// registered in its session, and nullptr is returned with iErrCode if the session refused it.
+		std::shared_ptr<CMCPToolCallFlight> Join(const std::string& strKey, unsigned int nCacheTtlMs,
+			const std::shared_ptr<CMCPSession>& spSession, const MCP::RequestId& requestId,
+			const std::shared_ptr<MCP::ProcessCallToolRequest>& spTask, bool& bJoined, int& iErrCode);
+
+	private:
+		friend class CMCPToolCallFlight;
+
+		void Remove(const std::string& strKey, const CMCPToolCallFlight* pFlight);
+
+		CMCPToolResultCache& m_cache;
+		std::mutex m_mtxFlights;
+		std::unordered_map<std::string, std::weak_ptr<CMCPToolCallFlight>> m_hashFlights;
+	};
+}
@@ -0,0 +1,69 @@
+#include "ToolResultCache.h"
+#include "../Message/JsonWriter.h"
+
+namespace MCP
+{
+	void CMCPToolResultCache::SetCapacity(size_t nMaxBytes)
+	{
+		std::lock_guard<std::mutex> _lock(m_mtxCache);
+		m_nMaxBytes = nMaxBytes;
+		while (m_nBytes > m_nMaxBytes && !m_lstRecent.empty())
+			Erase(m_hashEntries.find(m_lstRecent.front()));
+	}
+
+	std::string CMCPToolResultCache::MakeKey(const std::string& strToolName, const Json::Value& jArguments)
+	{
+		// Json::Value keeps the members of objects sorted, so the compact text is canonical.
+		std::string strKey(strToolName);
+		strKey.push_back('\0');
+		CMCPJsonWriter writer(strKey);
+		writer.Value(jArguments);
+
+		return strKey;
+	}
+
+	bool CMCPToolResultCache::GetResponse(const std::string& strKey, const MCP::RequestId& requestId, std::string& strResponse)
+	{
+		std::lock_guard<std::mutex> _lock(m_mtxCache);
+		auto itEntry = m_hashEntries.find(strKey);
+		if (itEntry == m_hashEntries.end())
+			return false;
+		if (itEntry->second.tpExpiry <= Clock::now())
+		{
+			Erase(itEntry);
+			return false;
+		}
+
+		m_lstRecent.splice(m_lstRecent.end(), m_lstRecent, itEntry->second.itRecent);
+		MCP::Response::WrapResult(requestId, itEntry->second.strResult, strResponse);
+
+		return true;
+	}
+
+	void CMCPToolResultCache::Put(const std::string& strKey, const std::string& strResult, unsigned int nTtlMs)
+	{
+		std::lock_guard<std::mutex> _lock(m_mtxCache);
+		auto itEntry = m_hashEntries.find(strKey);
+		if (itEntry != m_hashEntries.end())
+			Erase(itEntry);
+		size_t nBytes = strKey.size() + strResult.size();
+		if (0 == nTtlMs || nBytes > m_nMaxBytes / 8)
+			return;
+
+		while (m_nBytes + nBytes > m_nMaxBytes && !m_lstRecent.empty())
+			Erase(m_hashEntries.find(m_lstRecent.front()));
+		Entry entry;
+		entry.tpExpiry = Clock::now() + std::chrono::milliseconds(nTtlMs);
+		entry.strResult = strResult;
+		entry.itRecent = m_lstRecent.insert(m_lstRecent.end(), strKey);
+		m_nBytes += nBytes;
+		m_hashEntries.emplace(strKey, std::move(entry));
+	}
+
+	void CMCPToolResultCache::Erase(std::unordered_map<std::string, Entry>::iterator itEntry)
+	{
+		m_nBytes -= itEntry->first.size() + itEntry->second.strResult.size();
+		m_lstRecent.erase(itEntry->second.itRecent);
+		m_hashEntries.erase(itEntry);
+	}
+}
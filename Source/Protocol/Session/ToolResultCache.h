@@ -0,0 +1,58 @@
+#pragma once
+// To ensure good cross-platform compatibility, the MCP namespace code uses standard C++ only.
+// Avoid using platform-specific system APIs unless absolutely necessary.
+
+#include <chrono>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <json/json.h>
+#include "../Message/Response.h"
+
+namespace MCP
+{
+	// Serialized tools/call results of the tools registered with a cache TTL, keyed by tool name
+	// and arguments and shared by all sessions.
+	//
+	// An entry holds the "result" value and expires after the TTL of its tool. The least recently
+	// used entries are dropped beyond [task] tool_cache_bytes, and results larger than an eighth of
+	// it are not kept.
+	class CMCPToolResultCache
+	{
+	public:
+		using Clock = std::chrono::steady_clock;
+
+		CMCPToolResultCache() = default;
+		CMCPToolResultCache(const CMCPToolResultCache&) = delete;
+		CMCPToolResultCache& operator=(const CMCPToolResultCache&) = delete;
+
+		// 0 disables the cache.
+		void SetCapacity(size_t nMaxBytes);
+
+		// Equal arguments give the same key whatever the order of their members.
+		static std::string MakeKey(const std::string& strToolName, const Json::Value& jArguments);
+
+		// Fills strResponse with the complete response message on a hit.
+		bool GetResponse(const std::string& strKey, const MCP::RequestId& requestId, std::string& strResponse);
+		void Put(const std::string& strKey, const std::string& strResult, unsigned int nTtlMs);
+
+	private:
+		struct Entry
+		{
+			Clock::time_point tpExpiry;
+			std::string strResult;
+			std::list<std::string>::iterator itRecent;
+		};
+
+		void Erase(std::unordered_map<std::string, Entry>::iterator itEntry);
+
+		std::mutex m_mtxCache;
+		size_t m_nMaxBytes{ 0 };
+		// Keys and results.
+		size_t m_nBytes{ 0 };
+		// Least recently used first.
+		std::list<std::string> m_lstRecent;
+		std::unordered_map<std::string, Entry> m_hashEntries;
+	};
+}
@@ -0,0 +1,375 @@
+#include "TrafficReplay.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include "../Message/JsonParser.h"
+#include "SessionManager.h"
+
+namespace MCP
+{
+	// A request of the recording, with what was recorded and what the replay got for it.
+	struct ReplayExchange
+	{
+		bool bRecordedRequest{ false };
+		unsigned long long ullRecordedRequestUs{ 0 };
+		bool bRecordedResponse{ false };
+		unsigned long long ullRecordedResponseUs{ 0 };
+		Json::Value jRecordedResponse;
+
+		bool bSent{ false };
+		std::chrono::steady_clock::time_point tpSent;
+		bool bAnswered{ false };
+		double dReplayUs{ 0 };
+		Json::Value jReplayResponse;
+	};
+
+	struct ReplayState
+	{
+		std::mutex mtx;
+		std::condition_variable cv;
+		std::unordered_map<std::string, ReplayExchange> hashExchanges;
+		size_t nUnanswered{ 0 };
+	};
+
+	static std::string ExchangeKey(unsigned long long ullSession, const Json::Value& jId)
+	{
+		std::string strKey = std::to_string(ullSession);
+		strKey += '/';
+		if (jId.isString())
+		{
+			strKey += '"';
+			strKey += jId.asString();
+			strKey += '"';
+		}
+		else
+		{
+			strKey += std::to_string(jId.asLargestInt());
+		}
+
+		return strKey;
+	}
+
+	// Calls fn(jMessage) for the message, or every message of a batch, of a JSON frame.
+	template <class Fn>
+	static void ForEachMessage(CMCPJsonParser& parser, const char* pBegin, const char* pEnd, Fn fn)
+	{
+		while (pBegin < pEnd && (' ' == *pBegin || '\t' == *pBegin || '\r' == *pBegin || '\n' == *pBegin))
+			++pBegin;
+		// Binary frames are not compared.
+		if (pBegin == pEnd || ('{' != *pBegin && '[' != *pBegin))
+			return;
+		Json::Value jFrame;
+		if (!parser.Parse(pBegin, pEnd, jFrame))
+			return;
+		if (jFrame.isArray())
+		{
+			for (auto& jMessage : jFrame)
+			{
+				if (jMessage.isObject())
+					fn(jMessage);
+			}
+		}
+		else if (jFrame.isObject())
+		{
+			fn(jFrame);
+		}
+	}
+
+	static bool IsRequest(const Json::Value& jMessage)
+	{
+		return jMessage.isMember(MSG_KEY_ID) && jMessage.isMember(MSG_KEY_METHOD);
+	}
+
+	static bool IsResponse(const Json::Value& jMessage)
+	{
+		return jMessage.isMember(MSG_KEY_ID) && !jMessage.isMember(MSG_KEY_METHOD);
+	}
+
+	// Stands for the client of one recorded session: frames are pushed to the session like an
+	// event loop transport does, and the responses written back are matched to their requests.
+	class CReplayTransport : public CMCPTransport
+	{
+	public:
+		CReplayTransport(unsigned long long ullSession, ReplayState& state)
+			: m_ullSession(ullSession)
+			, m_state(state)
+		{
+		}
+
+		int Connect() override { return ERRNO_OK; }
+		int Disconnect() override { return ERRNO_OK; }
+		int Read(std::string&) override { return ERRNO_INTERNAL_INPUT_TERMINATE; }
+		int Error(const std::string&) override { return ERRNO_OK; }
+
+		int Write(const std::string& strIn) override
+		{
+			auto tpNow = std::chrono::steady_clock::now();
+			std::lock_guard<std::mutex> _lock(m_state.mtx);
+			ForEachMessage(m_parser, strIn.data(), strIn.data() + strIn.size(), [&](const Json::Value& jMessage)
+				{
+					if (!IsResponse(jMessage))
+						return;
+					auto itrExchange = m_state.hashExchanges.find(ExchangeKey(m_ullSession, jMessage[MSG_KEY_ID]));
+					if (itrExchange == m_state.hashExchanges.end() || !itrExchange->second.bSent || itrExchange->second.bAnswered)
+						return;
+					auto& exchange = itrExchange->second;
+					exchange.bAnswered = true;
+					exchange.dReplayUs = std::chrono::duration<double, std::micro>(tpNow - exchange.tpSent).count();
+					exchange.jReplayResponse = jMessage;
+					--m_state.nUnanswered;
+				});
+			if (0 == m_state.nUnanswered)
+				m_state.cv.notify_all();
+
+			return ERRNO_OK;
+		}
+
+		bool SetFrameHandler(FrameHandler fnOnFrame, CloseHandler fnOnClose) override
+		{
+			m_fnOnFrame = std::move(fnOnFrame);
+			m_fnOnClose = std::move(fnOnClose);
+			return true;
+		}
+
+		// Frames are sent as recorded, whatever their encoding.
+		bool SupportsFrameFormat(FrameFormat) const override
+		{
+			return true;
+		}
+
+		void Push(const std::string& strFrame)
+		{
+			if (m_fnOnFrame && !m_bClosed)
+				m_fnOnFrame(strFrame.data(), strFrame.data() + strFrame.size());
+		}
+
+		void Close()
+		{
+			if (m_bClosed)
+				return;
+			m_bClosed = true;
+			if (m_fnOnClose)
+				m_fnOnClose();
+		}
+
+	private:
+		unsigned long long m_ullSession;
+		ReplayState& m_state;
+		// Guarded by the lock of the state.
+		CMCPJsonParser m_parser;
+		FrameHandler m_fnOnFrame;
+		CloseHandler m_fnOnClose;
+		bool m_bClosed{ false };
+	};
+
+	static double Percentile(std::vector<double>& vecValues, double dFraction)
+	{
+		if (vecValues.empty())
+			return 0;
+		size_t nIndex = std::min(vecValues.size() - 1, static_cast<size_t>(dFraction * vecValues.size()));
+		std::nth_element(vecValues.begin(), vecValues.begin() + nIndex, vecValues.end());
+		return vecValues[nIndex];
+	}
+
+	int CMCPTrafficReplay::Run(const std::vector<TrafficRecord>& vecRecords, const std::shared_ptr<const ServerDefinition>& spDefinition,
+		const TrafficReplayOptions& options, TrafficReplayReport& report)
+	{
+		report = TrafficReplayReport();
+		if (!spDefinition)
+			return ERRNO_INVALID_PARAMS;
+
+		// The recorded side first: which requests were made, and how they were answered.
+		ReplayState state;
+		CMCPJsonParser parser;
+		for (auto& record : vecRecords)
+		{
+			bool bInbound = TrafficRecord_Inbound == record.eKind;
+			if (!bInbound && TrafficRecord_Outbound != record.eKind)
+				continue;
+			ForEachMessage(parser, record.strFrame.data(), record.strFrame.data() + record.strFrame.size(), [&](const Json::Value& jMessage)
+				{
+					if (bInbound ? !IsRequest(jMessage) : !IsResponse(jMessage))
+						return;
+					auto& exchange = state.hashExchanges[ExchangeKey(record.ullSession, jMessage[MSG_KEY_ID])];
+					if (bInbound)
+					{
+						exchange.bRecordedRequest = true;
+						exchange.ullRecordedRequestUs = record.ullTimeUs;
+					}
+					else if (!exchange.bRecordedResponse)
+					{
+						exchange.bRecordedResponse = true;
+						exchange.ullRecordedResponseUs = record.ullTimeUs;
+						exchange.jRecordedResponse = jMessage;
+					}
+				});
+		}
+
+		CMCPSessionManager manager;
+		int iErrCode = manager.Start(spDefinition);
+		if (ERRNO_OK != iErrCode)
+			return iErrCode;
+
+		std::unordered_map<unsigned long long, std::shared_ptr<CReplayTransport>> hashTransports;
+		auto fnTransport = [&](unsigned long long ullSession) -> std::shared_ptr<CReplayTransport>
+		{
+			auto itrTransport = hashTransports.find(ullSession);
+			if (itrTransport != hashTransports.end())
+				return itrTransport->second;
+			auto spTransport = std::make_shared<CReplayTransport>(ullSession, state);
+			hashTransports[ullSession] = spTransport;
+			if (ERRNO_OK != manager.StartSession(spTransport))
+				return nullptr;
+			++report.nSessions;
+			return spTransport;
+		};
+
+		// Sessions are closed once every response came, not when the recording closed them, so
+		// that a replay slower than the recording still gets its answers.
+		auto tpStart = std::chrono::steady_clock::now();
+		bool bFirst = true;
+		unsigned long long ullFirstUs = 0;
+		for (auto& record : vecRecords)
+		{
+			if (TrafficRecord_Open == record.eKind)
+			{
+				fnTransport(record.ullSession);
+				continue;
+			}
+			if (TrafficRecord_Inbound != record.eKind)
+				continue;
+			auto spTransport = fnTransport(record.ullSession);
+			if (!spTransport)
+				continue;
+
+			if (bFirst)
+			{
+				bFirst = false;
+				ullFirstUs = record.ullTimeUs;
+			}
+			if (options.dSpeed > 0)
+			{
+				auto tpSend = tpStart + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+					std::chrono::duration<double, std::micro>((record.ullTimeUs - ullFirstUs) / options.dSpeed));
+				std::this_thread::sleep_until(tpSend);
+			}
+			{
+				auto tpNow = std::chrono::steady_clock::now();
+				std::lock_guard<std::mutex> _lock(state.mtx);
+				ForEachMessage(parser, record.strFrame.data(), record.strFrame.data() + record.strFrame.size(), [&](const Json::Value& jMessage)
+					{
+						if (!IsRequest(jMessage))
+							return;
+						auto& exchange = state.hashExchanges[ExchangeKey(record.ullSession, jMessage[MSG_KEY_ID])];
+						if (exchange.bSent)
+							return;
+						exchange.bSent = true;
+						exchange.tpSent = tpNow;
+						++state.nUnanswered;
+						++report.nRequests;
+					});
+			}
+			spTransport->Push(record.strFrame);
+		}
+
+		{
+			std::unique_lock<std::mutex> _lock(state.mtx);
+			state.cv.wait_for(_lock, std::chrono::milliseconds(options.nDrainTimeoutMs), [&]() { return 0 == state.nUnanswered; });
+		}
+		report.dElapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tpStart).count();
+		for (auto& itrTransport : hashTransports)
+			itrTransport.second->Close();
+		manager.Stop();
+
+		std::vector<double> vecRecordedUs;
+		std::vector<double> vecReplayUs;
+		std::lock_guard<std::mutex> _lock(state.mtx);
+		std::vector<std::string> vecMismatches;
+		for (auto& itrExchange : state.hashExchanges)
+		{
+			auto& exchange = itrExchange.second;
+			if (exchange.bRecordedRequest && exchange.bRecordedResponse && exchange.ullRecordedResponseUs >= exchange.ullRecordedRequestUs)
+				vecRecordedUs.push_back(static_cast<double>(exchange.ullRecordedResponseUs - exchange.ullRecordedRequestUs));
+			if (!exchange.bSent)
+				continue;
+			if (!exchange.bAnswered)
+			{
+				++report.nMissing;
+				continue;
+			}
+			++report.nResponses;
+			vecReplayUs.push_back(exchange.dReplayUs);
+			if (exchange.bRecordedResponse && !(exchange.jRecordedResponse == exchange.jReplayResponse))
+			{
+				++report.nMismatches;
+				vecMismatches.push_back(itrExchange.first);
+			}
+		}
+		// Reported in a stable order, whatever the order of the map.
+		std::sort(vecMismatches.begin(), vecMismatches.end());
+		if (vecMismatches.size() > 16)
+			vecMismatches.resize(16);
+		report.vecMismatches = std::move(vecMismatches);
+		report.dRecordedP50Us = Percentile(vecRecordedUs, 0.5);
+		report.dRecordedP99Us = Percentile(vecRecordedUs, 0.99);
+		report.dReplayP50Us = Percentile(vecReplayUs, 0.5);
+		report.dReplayP99Us = Percentile(vecReplayUs, 0.99);
+
+		return ERRNO_OK;
+	}
+
+	Json::Value TrafficReplayReport::ToJson() const
+	{
+		Json::Value jReport(Json::objectValue);
+		jReport["sessions"] = static_cast<Json::UInt64>(nSessions);
+		jReport["requests"] = static_cast<Json::UInt64>(nRequests);
+		jReport["responses"] = static_cast<Json::UInt64>(nResponses);
+		jReport["mismatches"] = static_cast<Json::UInt64>(nMismatches);
+		jReport["missing"] = static_cast<Json::UInt64>(nMissing);
+		jReport["elapsedMs"] = dElapsedMs;
+		jReport["recordedP50Us"] = dRecordedP50Us;
+		jReport["recordedP99Us"] = dRecordedP99Us;
+		jReport["replayP50Us"] = dReplayP50Us;
+		jReport["replayP99Us"] = dReplayP99Us;
+		Json::Value jMismatches(Json::arrayValue);
+		for (auto& strMismatch : vecMismatches)
+			jMismatches.append(strMismatch);
+		jReport["mismatchIds"] = std::move(jMismatches);
+
+		return jReport;
+	}
+
+	int TrafficReplayReport::FromJson(const Json::Value& jReport)
+	{
+		if (!jReport.isObject())
+			return ERRNO_INVALID_PARAMS;
+		nSessions = static_cast<size_t>(jReport["sessions"].asUInt64());
+		nRequests = static_cast<size_t>(jReport["requests"].asUInt64());
+		nResponses = static_cast<size_t>(jReport["responses"].asUInt64());
+		nMismatches = static_cast<size_t>(jReport["mismatches"].asUInt64());
+		nMissing = static_cast<size_t>(jReport["missing"].asUInt64());
+		dElapsedMs = jReport["elapsedMs"].asDouble();
+		dRecordedP50Us = jReport["recordedP50Us"].asDouble();
+		dRecordedP99Us = jReport["recordedP99Us"].asDouble();
+		dReplayP50Us = jReport["replayP50Us"].asDouble();
+		dReplayP99Us = jReport["replayP99Us"].asDouble();
+		vecMismatches.clear();
+		for (auto& jMismatch : jReport["mismatchIds"])
+			vecMismatches.push_back(jMismatch.asString());
+
+		return ERRNO_OK;
+	}
+
+	bool TrafficReplayReport::IsRegression(const TrafficReplayReport& baseline, double dTolerance) const
+	{
+		if (nMismatches > baseline.nMismatches || nMissing > baseline.nMissing)
+			return true;
+
+		return dReplayP50Us > baseline.dReplayP50Us * (1 + dTolerance)
+			|| dReplayP99Us > baseline.dReplayP99Us * (1 + dTolerance);
+	}
+}
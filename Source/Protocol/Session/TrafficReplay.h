@@ -0,0 +1,63 @@
+#pragma once
+// To ensure good cross-platform compatibility, the MCP namespace code uses standard C++ only.
+// Avoid using platform-specific system APIs unless absolutely necessary.
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <json/json.h>
+#include "../Transport/RecordingTransport.h"
+#include "ServerDefinition.h"
+
+namespace MCP
+{
+	struct TrafficReplayOptions
+	{
+		// 1 sends the frames at the pace they were recorded, 10 ten times faster; 0 sends each as
+		// soon as the one before has been handed to its session.
+		double dSpeed{ 1.0 };
+		// How long the responses still missing once the last frame was sent are waited for.
+		unsigned int nDrainTimeoutMs{ 10000 };
+	};
+
+	// What a replay found. Latencies run from a request to its response, in microseconds; the
+	// recorded ones are measured on the recording, the replayed ones on this run.
+	struct TrafficReplayReport
+	{
+		size_t nSessions{ 0 };
+		size_t nRequests{ 0 };
+		size_t nResponses{ 0 };
+		// Responses that differ from the recorded ones.
+		size_t nMismatches{ 0 };
+		// Requests not answered within the drain timeout.
+		size_t nMissing{ 0 };
+		double dElapsedMs{ 0 };
+		double dRecordedP50Us{ 0 };
+		double dRecordedP99Us{ 0 };
+		double dReplayP50Us{ 0 };
+		double dReplayP99Us{ 0 };
+		// "session/id" of the first mismatched responses.
+		std::vector<std::string> vecMismatches;
+
+		// For keeping a report as the baseline of later runs.
+		Json::Value ToJson() const;
+		int FromJson(const Json::Value& jReport);
+		// Whether this run did worse than the baseline: more mismatched or missing responses, or a
+		// replayed p50 or p99 latency more than dTolerance (0.2 = 20%) above the one of the baseline.
+		bool IsRegression(const TrafficReplayReport& baseline, double dTolerance) const;
+	};
+
+	// Replays a recording of CRecordingTransport against a server definition: every recorded session
+	// is served by a session of its own, the frames read from the client are sent to it again at the
+	// recorded times scaled by the speed, and the responses are compared with the recorded ones.
+	//
+	// The server must offer the tools of the recording and answer alike for the comparison to hold;
+	// responses depending on time or state (e.g. trace dumps) are reported as mismatches. Frames
+	// of a binary encoding are sent as recorded but not compared.
+	class CMCPTrafficReplay
+	{
+	public:
+		static int Run(const std::vector<TrafficRecord>& vecRecords, const std::shared_ptr<const ServerDefinition>& spDefinition,
+			const TrafficReplayOptions& options, TrafficReplayReport& report);
+	};
+}
@@ -0,0 +1,112 @@
+#include "AsyncTool.h"
+#include "../Session/Session.h"
+#include "../Public/Trace.h"
+
+namespace MCP
+{
+	// Runs a piece of an asynchronous call on a worker, keeping the call's task alive until then.
+	class CMCPContinuationTask : public ProcessRequest
+	{
+	public:
+		CMCPContinuationTask(const std::shared_ptr<ProcessCallToolRequest>& spOwner, TaskLane eLane, std::function<void()> fnContinuation)
+			: ProcessRequest(nullptr)
+			, m_spOwner(spOwner)
+			, m_eLane(eLane)
+			, m_fnContinuation(std::move(fnContinuation))
+		{
+
+		}
+
+		TaskLane GetLane() const override { return m_eLane; }
+		unsigned long GetTraceId() const override { return m_spOwner ? m_spOwner->GetTraceId() : 0; }
+		std::shared_ptr<CMCPTask> Clone() const override { return nullptr; }
+		bool IsValid() const override { return true; }
+
+		int Execute() override
+		{
+			MCP_TRACE_SCOPE("resume");
+			if (m_fnContinuation)
+				m_fnContinuation();
+			// Whatever the continuation captured goes with it, not with the next task of the worker.
+			m_fnContinuation = nullptr;
+			m_spOwner.reset();
+
+			return ERRNO_OK;
+		}
+
+	private:
+		std::shared_ptr<ProcessCallToolRequest> m_spOwner;
+		TaskLane m_eLane;
+		std::function<void()> m_fnContinuation;
+	};
+
+	int ProcessAsyncCallToolRequest::Execute()
+	{
+		if (!IsValid())
+			return ERRNO_INTERNAL_ERROR;
+
+		return ExecuteAsync();
+	}
+
+	int ProcessAsyncCallToolRequest::Resume(std::function<void()> fnContinuation)
+	{
+		auto spTask = std::make_shared<CMCPContinuationTask>(GetSelf(), GetLane(), std::move(fnContinuation));
+		auto spSession = GetSession();
+		if (spSession && ERRNO_OK == spSession->CommitContinuation(spTask))
+			return ERRNO_OK;
+
+		// Late rather than never: the call still has to end.
+		return spTask->Execute();
+	}
+
+	int ProcessAsyncCallToolRequest::ResumeAt(Clock::time_point tpWhen, std::function<void()> fnContinuation)
+	{
+		auto spSession = GetSession();
+		if (spSession)
+		{
+			auto spSelf = GetSelf();
+			auto spContinuation = std::make_shared<std::function<void()>>(std::move(fnContinuation));
+			int iErrCode = spSession->ScheduleCallback(tpWhen, [this, spSelf, spContinuation]()
+				{
+					Resume(std::move(*spContinuation));
+				});
+			if (ERRNO_OK == iErrCode)
+				return ERRNO_OK;
+			fnContinuation = std::move(*spContinuation);
+		}
+
+		// Without a timer the wait is cut short rather than never ending.
+		return Resume(std::move(fnContinuation));
+	}
+
+	int ProcessAsyncCallToolRequest::ResumeAfter(Clock::duration duration, std::function<void()> fnContinuation)
+	{
+		return ResumeAt(Clock::now() + duration, std::move(fnContinuation));
+	}
+
+	int ProcessAsyncCallToolRequest::NotifyError(int iErrCode)
+	{
+		if (IsFinished() || IsCancelled())
+			return ERRNO_OK;
+
+		auto spResult = BuildResult();
+		if (!spResult)
+			return ERRNO_INTERNAL_ERROR;
+		spResult->bIsError = true;
+		spResult->AddText("the tool failed with error code " + std::to_string(iErrCode));
+
+		return NotifyResult(std::move(spResult));
+	}
+
+	void ProcessAsyncCallToolRequest::WatchCancellation(std::function<void(int iErrCode)> fnOnCancel)
+	{
+		auto spToken = GetCancellationToken();
+		if (!spToken)
+			return;
+
+		spToken->RegisterCallback([fnOnCancel](CancelReason eReason)
+			{
+				fnOnCancel(CancelReason_Deadline == eReason ? ERRNO_REQUEST_TIMEOUT : ERRNO_REQUEST_CANCELLED);
+			});
+	}
+}
@@ -0,0 +1,311 @@
+#pragma once
+// To ensure good cross-platform compatibility, the MCP namespace code uses standard C++ only.
+// Avoid using platform-specific system APIs unless absolutely necessary.
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "BasicTask.h"
+
+// Compilers with C++20 coroutines also get ProcessCoroutineCallToolRequest; the callback
+// interface of ProcessAsyncCallToolRequest is available everywhere.
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+#include <coroutine>
+#include <exception>
+#define TINYMCP_HAS_COROUTINES 1
+#endif
+
+namespace MCP
+{
+	// A value some I/O produces later, settled exactly once by Resolve() or Fail() from any thread.
+	template <class T>
+	class CMCPAsyncResult
+	{
+	public:
+		using Continuation = std::function<void(CMCPAsyncResult<T>& result)>;
+
+		CMCPAsyncResult() = default;
+		CMCPAsyncResult(const CMCPAsyncResult&) = delete;
+		CMCPAsyncResult& operator=(const CMCPAsyncResult&) = delete;
+
+		// False if the result was settled already.
+		bool Resolve(T value)
+		{
+			return Settle(ERRNO_OK, std::unique_ptr<T>(new T(std::move(value))));
+		}
+		bool Fail(int iErrCode)
+		{
+			return Settle(ERRNO_OK == iErrCode ? ERRNO_INTERNAL_ERROR : iErrCode, nullptr);
+		}
+
+		// Runs fnContinuation once the result is settled: on the settling thread, or right away on the
+		// calling one if it already is.
+		void Then(Continuation fnContinuation)
+		{
+			{
+				std::lock_guard<std::mutex> _lock(m_mtxResult);
+				if (!m_bSettled)
+				{
+					m_vecContinuations.push_back(std::move(fnContinuation));
+					return;
+				}
+			}
+			fnContinuation(*this);
+		}
+
+		bool IsSettled() const
+		{
+			std::lock_guard<std::mutex> _lock(m_mtxResult);
+			return m_bSettled;
+		}
+		// ERRNO_OK once resolved.
+		int GetErrCode() const
+		{
+			std::lock_guard<std::mutex> _lock(m_mtxResult);
+			return m_iErrCode;
+		}
+		// Null unless resolved.
+		T* GetValue()
+		{
+			std::lock_guard<std::mutex> _lock(m_mtxResult);
+			return m_upValue.get();
+		}
+
+	private:
+		bool Settle(int iErrCode, std::unique_ptr<T> upValue)
+		{
+			std::vector<Continuation> vecContinuations;
+			{
+				std::lock_guard<std::mutex> _lock(m_mtxResult);
+				if (m_bSettled)
+					return false;
+				m_bSettled = true;
+				m_iErrCode = iErrCode;
+				m_upValue = std::move(upValue);
+				vecContinuations.swap(m_vecContinuations);
+			}
+			for (auto& fnContinuation : vecContinuations)
+			{
+				fnContinuation(*this);
+			}
+
+			return true;
+		}
+
+		mutable std::mutex m_mtxResult;
+		bool m_bSettled{ false };
+		int m_iErrCode{ ERRNO_INTERNAL_ERROR };
+		std::unique_ptr<T> m_upValue;
+		std::vector<Continuation> m_vecContinuations;
+	};
+
+	// Base of tools that wait on I/O (HTTP calls, databases) without holding a worker while they wait.
+	//
+	// ExecuteAsync() starts the work and returns; the call stays open - tracked, cancellable and
+	// bounded by its deadline - until NotifyResult() or BeginResult() answers it from whichever
+	// thread the work completes on. Code continuing the call is handed back to the task workers
+	// with Resume(), ResumeAfter() or Then(), so neither I/O threads nor the timer thread run tool
+	// code, and a few workers serve any number of waiting calls.
+	//
+	// Unlike a synchronous tool, a waiting call does not count against the tool's concurrency
+	// limit of [tool_limits]: that limit bounds the workers a tool occupies.
+	class ProcessAsyncCallToolRequest : public ProcessCallToolRequest
+	{
+	public:
+		using Clock = std::chrono::steady_clock;
+
+		ProcessAsyncCallToolRequest(const std::shared_ptr<MCP::Request>& spRequest)
+			: ProcessCallToolRequest(spRequest)
+		{
+
+		}
+
+		int Execute() override;
+
+		// Runs fnContinuation on a task worker, in the lane of the tool. It runs on the calling thread
+		// instead when the session is gone or the workers do not take it.
+		int Resume(std::function<void()> fnContinuation);
+		// Runs fnContinuation on a task worker once tpWhen is reached, without a thread waiting for it.
+		int ResumeAt(Clock::time_point tpWhen, std::function<void()> fnContinuation);
+		int ResumeAfter(Clock::duration duration, std::function<void()> fnContinuation);
+		// Runs fnContinuation on a task worker once spResult is settled. Cancelling the call fails the
+		// result with ERRNO_REQUEST_TIMEOUT (deadline) or ERRNO_REQUEST_CANCELLED, so a call waiting
+		// on I/O that never completes still ends.
+		template <class T>
+		void Then(const std::shared_ptr<CMCPAsyncResult<T>>& spResult, std::function<void(CMCPAsyncResult<T>& result)> fnContinuation)
+		{
+			if (!spResult)
+				return;
+			std::weak_ptr<CMCPAsyncResult<T>> wpResult = spResult;
+			WatchCancellation([wpResult](int iErrCode)
+				{
+					auto spResult = wpResult.lock();
+					if (spResult)
+						spResult->Fail(iErrCode);
+				});
+			// Holding the result until it is settled, which the cancellation above guarantees.
+			auto spSelf = GetSelf();
+			spResult->Then([this, spSelf, spResult, fnContinuation](CMCPAsyncResult<T>&)
+				{
+					Resume([spResult, fnContinuation]() { fnContinuation(*spResult); });
+				});
+		}
+
+		// Answers a call that has not been answered and is not cancelled with an error result.
+		int NotifyError(int iErrCode);
+
+	protected:
+		// Starts the call. Returning an error fails it like an error returned by Execute().
+		virtual int ExecuteAsync() = 0;
+
+	private:
+		// Invoked with the error the cancellation translates to; at once if the call is already cancelled.
+		void WatchCancellation(std::function<void(int iErrCode)> fnOnCancel);
+	};
+
+#ifdef TINYMCP_HAS_COROUTINES
+	class ProcessCoroutineCallToolRequest;
+
+	// Return type of ProcessCoroutineCallToolRequest::ExecuteCoroutine(). The coroutine keeps its task
+	// alive until it returns, and frees itself then.
+	class CMCPToolCoroutine
+	{
+	public:
+		struct promise_type
+		{
+			CMCPToolCoroutine get_return_object()
+			{
+				return CMCPToolCoroutine(std::coroutine_handle<promise_type>::from_promise(*this));
+			}
+			std::suspend_always initial_suspend() noexcept { return {}; }
+			std::suspend_never final_suspend() noexcept { return {}; }
+			void return_value(int iErrCode);
+			void unhandled_exception();
+
+			std::shared_ptr<ProcessCallToolRequest> spKeepAlive;
+			ProcessCoroutineCallToolRequest* pTask{ nullptr };
+		};
+
+		explicit CMCPToolCoroutine(std::coroutine_handle<promise_type> handle)
+			: m_handle(handle)
+		{
+		}
+		CMCPToolCoroutine(CMCPToolCoroutine&& other) noexcept
+			: m_handle(other.m_handle)
+		{
+			other.m_handle = nullptr;
+		}
+		CMCPToolCoroutine(const CMCPToolCoroutine&) = delete;
+		CMCPToolCoroutine& operator=(const CMCPToolCoroutine&) = delete;
+		~CMCPToolCoroutine()
+		{
+			// Only a coroutine that never started is still owned here.
+			if (m_handle)
+				m_handle.destroy();
+		}
+
+		// Runs the coroutine up to its first suspension.
+		void Start(const std::shared_ptr<ProcessCallToolRequest>& spKeepAlive, ProcessCoroutineCallToolRequest* pTask)
+		{
+			auto handle = m_handle;
+			m_handle = nullptr;
+			handle.promise().spKeepAlive = spKeepAlive;
+			handle.promise().pTask = pTask;
+			handle.resume();
+		}
+
+	private:
+		std::coroutine_handle<promise_type> m_handle;
+	};
+
+	// Tools written as C++20 coroutines:
+	//
+	//     MCP::CMCPToolCoroutine ExecuteCoroutine() override
+	//     {
+	//         auto spResponse = m_client.GetAsync(strUrl);		// a CMCPAsyncResult<T>
+	//         auto& response = co_await Wait(spResponse);
+	//         if (ERRNO_OK != response.GetErrCode())
+	//             co_return response.GetErrCode();
+	//         ...
+	//         co_return NotifyResult(spResult);
+	//     }
+	//
+	// Every co_await continues on a task worker. A coroutine returning an error without having
+	// answered the call answers it with an error result.
+	class ProcessCoroutineCallToolRequest : public ProcessAsyncCallToolRequest
+	{
+	public:
+		ProcessCoroutineCallToolRequest(const std::shared_ptr<MCP::Request>& spRequest)
+			: ProcessAsyncCallToolRequest(spRequest)
+		{
+
+		}
+
+		template <class T>
+		struct ResultAwaiter
+		{
+			ProcessCoroutineCallToolRequest* pTask;
+			std::shared_ptr<CMCPAsyncResult<T>> spResult;
+
+			bool await_ready() const { return !spResult || spResult->IsSettled(); }
+			void await_suspend(std::coroutine_handle<> handle)
+			{
+				pTask->Then<T>(spResult, [handle](CMCPAsyncResult<T>&) { handle.resume(); });
+			}
+			CMCPAsyncResult<T>& await_resume() { return *spResult; }
+		};
+
+		struct TimeAwaiter
+		{
+			ProcessCoroutineCallToolRequest* pTask;
+			Clock::time_point tpWhen;
+
+			bool await_ready() const { return tpWhen <= Clock::now(); }
+			void await_suspend(std::coroutine_handle<> handle)
+			{
+				pTask->ResumeAt(tpWhen, [handle]() { handle.resume(); });
+			}
+			void await_resume() {}
+		};
+
+		// co_await Wait(spResult): suspends until the result is settled, see Then().
+		template <class T>
+		ResultAwaiter<T> Wait(const std::shared_ptr<CMCPAsyncResult<T>>& spResult)
+		{
+			return ResultAwaiter<T>{ this, spResult };
+		}
+		// co_await WaitFor(duration): suspends without holding a thread.
+		TimeAwaiter WaitFor(Clock::duration duration)
+		{
+			return TimeAwaiter{ this, Clock::now() + duration };
+		}
+
+	protected:
+		virtual CMCPToolCoroutine ExecuteCoroutine() = 0;
+
+		int ExecuteAsync() override
+		{
+			auto spSelf = GetSelf();
+			if (!spSelf)
+				return ERRNO_INTERNAL_ERROR;
+			ExecuteCoroutine().Start(spSelf, this);
+
+			return ERRNO_OK;
+		}
+	};
+
+	inline void CMCPToolCoroutine::promise_type::return_value(int iErrCode)
+	{
+		if (ERRNO_OK != iErrCode && pTask)
+			pTask->NotifyError(iErrCode);
+	}
+
+	inline void CMCPToolCoroutine::promise_type::unhandled_exception()
+	{
+		if (pTask)
+			pTask->NotifyError(ERRNO_INTERNAL_ERROR);
+	}
+#endif
+}
@@ -1,9 +1,35 @@
 #include "BasicTask.h"
 #include "../Session/Session.h"
+#include "../Session/ToolCallFlight.h"
 #include "../Message/Notification.h"
 
 namespace MCP
 {
+	// Answers a list request from the pre-serialized pages of the list.
+	static int WriteListResponse(const std::shared_ptr<CMCPSession>& spSession, const CMCPListCache& listCache, const MCP::RequestId& requestId, const std::string& strCursor)
+	{
+		std::string strResponse;
+		int iErrCode = listCache.GetResponse(requestId, strCursor, strResponse);
+		if (ERRNO_INVALID_PARAMS == iErrCode)
+		{
+			ErrorResponse errorResponse(true);
+			errorResponse.requestId = requestId;
+			errorResponse.iCode = ERRNO_INVALID_PARAMS;
+			errorResponse.strMesage = "invalid params";
+			if (ERRNO_OK != errorResponse.Serialize(strResponse))
+				return ERRNO_INTERNAL_ERROR;
+		}
+		else if (ERRNO_OK != iErrCode)
+		{
+			return ERRNO_INTERNAL_ERROR;
+		}
+
+		if (ERRNO_OK != spSession->WriteResponse(requestId, strResponse))
+			return ERRNO_INTERNAL_ERROR;
+
+		return ERRNO_OK;
+	}
+
 	////////////////////////////////////////////////////////////////////////////////////////
 	// ProcessRequest
 	bool ProcessRequest::IsValid() const
@@ -39,11 +65,26 @@ namespace MCP
 		m_spRequest = spRequest;
 	}
 
-	std::shared_ptr<MCP::Request> ProcessRequest::GetRequest() const
+	const std::shared_ptr<MCP::Request>& ProcessRequest::GetRequest() const
 	{
 		return m_spRequest;
 	}
 
+	unsigned long ProcessRequest::GetTraceId() const
+	{
+		return m_spRequest ? m_spRequest->ulRuntimeId : 0;
+	}
+
+	void ProcessRequest::SetSession(const std::shared_ptr<CMCPSession>& spSession)
+	{
+		m_wpSession = spSession;
+	}
+
+	std::shared_ptr<CMCPSession> ProcessRequest::GetSession() const
+	{
+		return m_wpSession.lock();
+	}
+
 	////////////////////////////////////////////////////////////////////////////////////////
 	// ProcessErrorRequest
 	std::shared_ptr<CMCPTask> ProcessErrorRequest::Clone() const
@@ -53,12 +94,14 @@ namespace MCP
 
 	int ProcessErrorRequest::Execute()
 	{
+		auto spSession = GetSession();
+		if (!spSession)
+			return ERRNO_INTERNAL_ERROR;
 		if (!IsValid())
 			return ERRNO_INTERNAL_ERROR;
 
-		auto spErrorResponse = std::make_shared<ErrorResponse>(true);
-		if (!spErrorResponse)
-			return ERRNO_INTERNAL_ERROR;
+		// Serialized right away, so the response needs no allocation of its own.
+		ErrorResponse errorResponse(true);
 
 		if (m_strMessage.empty())
 		{
@@ -84,19 +127,29 @@ namespace MCP
 				{
 					m_strMessage = ERROR_MESSAGE_INTERNAL_ERROR;
 				} break;
+				case ERRNO_REQUEST_TIMEOUT:
+				{
+					m_strMessage = ERROR_MESSAGE_REQUEST_TIMEOUT;
+				} break;
+				case ERRNO_RATE_LIMITED:
+				{
+					m_strMessage = ERROR_MESSAGE_RATE_LIMITED;
+				} break;
+				case ERRNO_SERVER_OVERLOADED:
+				{
+					m_strMessage = ERROR_MESSAGE_SERVER_OVERLOADED;
+				} break;
 				default: break;
 			}
 		}
-		spErrorResponse->iCode = m_iCode;
-		spErrorResponse->strMesage = m_strMessage;
+		errorResponse.requestId = m_spRequest->requestId;
+		errorResponse.iCode = m_iCode;
+		errorResponse.strMesage = m_strMessage;
 
 		std::string strResponse;
-		if (ERRNO_OK != spErrorResponse->Serialize(strResponse))
-			return ERRNO_INTERNAL_ERROR;
-		auto spTransport = CMCPSession::GetInstance().GetTransport();
-		if (!spTransport)
+		if (ERRNO_OK != errorResponse.Serialize(strResponse))
 			return ERRNO_INTERNAL_ERROR;
-		if (ERRNO_OK != spTransport->Write(strResponse))
+		if (ERRNO_OK != spSession->WriteResponse(m_spRequest->requestId, strResponse))
 			return ERRNO_INTERNAL_ERROR;
 
 		return ERRNO_OK;
@@ -121,28 +174,32 @@ namespace MCP
 
 	int ProcessInitializeRequest::Execute()
 	{
+		auto spSession = GetSession();
+		if (!spSession)
+			return ERRNO_INTERNAL_ERROR;
 		if (!IsValid())
 			return ERRNO_INTERNAL_ERROR;
 
-		auto spInitializeResult = std::make_shared<InitializeResult>(true);
-		if (!spInitializeResult)
-			return ERRNO_INTERNAL_ERROR;
-		spInitializeResult->requestId = m_spRequest->requestId;
-		spInitializeResult->strProtocolVersion = PROTOCOL_VER;
-		spInitializeResult->capabilities = CMCPSession::GetInstance().GetServerCapabilities();
-		spInitializeResult->implServerInfo = CMCPSession::GetInstance().GetServerInfo();
+		InitializeResult initializeResult(true);
+		initializeResult.requestId = m_spRequest->requestId;
+		initializeResult.strProtocolVersion = PROTOCOL_VER;
+		initializeResult.capabilities = spSession->GetServerCapabilities();
+		initializeResult.implServerInfo = spSession->GetServerInfo();
+		initializeResult.strEncoding = m_strEncoding;
 		std::string strResponse;
-		if (ERRNO_OK != spInitializeResult->Serialize(strResponse))
-			return ERRNO_INTERNAL_ERROR;
-		auto spTransport = CMCPSession::GetInstance().GetTransport();
-		if (!spTransport)
+		if (ERRNO_OK != initializeResult.Serialize(strResponse))
 			return ERRNO_INTERNAL_ERROR;
-		if (ERRNO_OK != spTransport->Write(strResponse))
+		if (ERRNO_OK != spSession->WriteResponse(m_spRequest->requestId, strResponse))
 			return ERRNO_INTERNAL_ERROR;
 
 		return ERRNO_OK;
 	}
 
+	void ProcessInitializeRequest::SetEncoding(const std::string& strEncoding)
+	{
+		m_strEncoding = strEncoding;
+	}
+
 	////////////////////////////////////////////////////////////////////////////////////////
 	// ProcessListToolsRequest
 	std::shared_ptr<CMCPTask> ProcessListToolsRequest::Clone() const
@@ -152,6 +209,9 @@ namespace MCP
 
 	int ProcessListToolsRequest::Execute()
 	{
+		auto spSession = GetSession();
+		if (!spSession)
+			return ERRNO_INTERNAL_ERROR;
 		if (!IsValid())
 			return ERRNO_INTERNAL_ERROR;
 
@@ -159,108 +219,14 @@ namespace MCP
 		if (!spListToolRequest)
 			return ERRNO_INTERNAL_ERROR;
 		
-		std::shared_ptr<ListToolsResult> spListToolsResult = nullptr;
-		std::string strResponse;
-
-		bool bPagination = CMCPSession::GetInstance().GetServerToolsPagination();		
-		if (bPagination)
-		{
-			if (!spListToolRequest->strCursor.empty())
-			{
-				bool bValidCursor = true;
-				unsigned nCursor = 0;
-				try
-				{
-					nCursor = std::stoul(spListToolRequest->strCursor);
-				}
-				catch (const std::invalid_argument&)
-				{
-					bValidCursor = false;
-				}
-				catch (const std::out_of_range&)
-				{
-					bValidCursor = false;
-				}
-
-				auto vecServerTools = CMCPSession::GetInstance().GetServerTools();
-				if (bValidCursor)
-				{
-					if (nCursor >= vecServerTools.size())
-					{
-						bValidCursor = false;
-					}
-				}
-
-				if (!bValidCursor)
-				{
-					auto spErrorResponse = std::make_shared<ErrorResponse>(true);
-					if (!spErrorResponse)
-						return ERRNO_INTERNAL_ERROR;
-					spErrorResponse->iCode = ERRNO_INVALID_PARAMS;
-					spErrorResponse->strMesage = "invalid params";
-					if (ERRNO_OK != spErrorResponse->Serialize(strResponse))
-						return ERRNO_INTERNAL_ERROR;
-				}
-				else
-				{
-					spListToolsResult = std::make_shared<ListToolsResult>(true);
-					if (!spListToolsResult)
-						return ERRNO_INTERNAL_ERROR;
-					spListToolsResult->requestId = spListToolRequest->requestId;
-					spListToolsResult->vecTools.clear();
-					spListToolsResult->vecTools.push_back(vecServerTools[nCursor]);
-					if (nCursor < vecServerTools.size() - 1)
-					{
-						spListToolsResult->strNextCursor = std::to_string(nCursor + 1);
-					}
-				}
-			}
-			else
-			{
-				spListToolsResult = std::make_shared<ListToolsResult>(true);
-				if (!spListToolsResult)
-					return ERRNO_INTERNAL_ERROR;
-				spListToolsResult->requestId = spListToolRequest->requestId;
-				auto vecServerTools = CMCPSession::GetInstance().GetServerTools();
-				spListToolsResult->vecTools.clear();
-				if (vecServerTools.size() > 0)
-					spListToolsResult->vecTools.push_back(vecServerTools[0]);
-				if (vecServerTools.size() > 1)
-					spListToolsResult->strNextCursor = std::to_string(1);
-			}
-		}
-		else
-		{
-			spListToolsResult = std::make_shared<ListToolsResult>(true);
-			if (!spListToolsResult)
-				return ERRNO_INTERNAL_ERROR;
-			spListToolsResult->requestId = spListToolRequest->requestId;
-			spListToolsResult->vecTools = CMCPSession::GetInstance().GetServerTools();
-		}
-
-		if (spListToolsResult)
-		{
-			if (ERRNO_OK != spListToolsResult->Serialize(strResponse))
-				return ERRNO_INTERNAL_ERROR;
-		}
-
-		if (!strResponse.empty())
-		{
-			auto spTransport = CMCPSession::GetInstance().GetTransport();
-			if (!spTransport)
-				return ERRNO_INTERNAL_ERROR;
-			if (ERRNO_OK != spTransport->Write(strResponse))
-				return ERRNO_INTERNAL_ERROR;
-		}
-
-		return ERRNO_OK;
+		return WriteListResponse(spSession, spSession->GetServerToolsList(), spListToolRequest->requestId, spListToolRequest->strCursor);
 	}
 
 	////////////////////////////////////////////////////////////////////////////////////////
 	// ProcessCallToolRequest
 	bool ProcessCallToolRequest::IsFinished() const
 	{
-		return m_bFinished;
+		return m_spCancellationToken && m_spCancellationToken->IsCompleted();
 	}
 
 	////////////////////////////////////////////////////////////////////////////////////////
@@ -272,6 +238,9 @@ namespace MCP
 
 	int ProcessListResourcesRequest::Execute()
 	{
+		auto spSession = GetSession();
+		if (!spSession)
+			return ERRNO_INTERNAL_ERROR;
 		if (!IsValid())
 			return ERRNO_INTERNAL_ERROR;
 
@@ -279,21 +248,7 @@ namespace MCP
 		if (!spListRequest)
 			return ERRNO_INTERNAL_ERROR;
 
-		auto spResult = std::make_shared<ListResourcesResult>(true);
-		if (!spResult)
-			return ERRNO_INTERNAL_ERROR;
-		spResult->requestId = spListRequest->requestId;
-		// minimal empty list
-		std::string strResponse;
-		if (ERRNO_OK != spResult->Serialize(strResponse))
-			return ERRNO_INTERNAL_ERROR;
-		auto spTransport = CMCPSession::GetInstance().GetTransport();
-		if (!spTransport)
-			return ERRNO_INTERNAL_ERROR;
-		if (ERRNO_OK != spTransport->Write(strResponse))
-			return ERRNO_INTERNAL_ERROR;
-
-		return ERRNO_OK;
+		return WriteListResponse(spSession, spSession->GetServerResourcesList(), spListRequest->requestId, spListRequest->strCursor);
 	}
 
 	////////////////////////////////////////////////////////////////////////////////////////
@@ -305,6 +260,9 @@ namespace MCP
 
 	int ProcessReadResourceRequest::Execute()
 	{
+		auto spSession = GetSession();
+		if (!spSession)
+			return ERRNO_INTERNAL_ERROR;
 		if (!IsValid())
 			return ERRNO_INTERNAL_ERROR;
 
@@ -312,26 +270,49 @@ namespace MCP
 		if (!spReadRequest)
 			return ERRNO_INTERNAL_ERROR;
 
-		auto spResult = std::make_shared<ReadResourceResult>(true);
-		if (!spResult)
-			return ERRNO_INTERNAL_ERROR;
-		spResult->requestId = spReadRequest->requestId;
+		// Whole resources are cached per version, and only when the version is the same after reading.
+		auto spProvider = spSession->GetServerResourceProvider();
+		auto& resourceCache = spSession->GetResourceCache();
+		unsigned long long ullVersion = 0;
+		bool bCacheable = spProvider && !spReadRequest->bRange && spProvider->GetResourceVersion(spReadRequest->strUri, ullVersion);
+		std::string strResponse;
+		if (bCacheable && resourceCache.GetResponse(spReadRequest->strUri, ullVersion, spReadRequest->requestId, strResponse))
+		{
+			return spSession->WriteResponse(spReadRequest->requestId, strResponse);
+		}
 
-		// For now, return a simple text resource based on URI
-		// In a real implementation, this would read from file system, database, etc.
-		MCP::TextResourceContents textContent;
-		textContent.strUri = spReadRequest->strUri;
-		textContent.strMimeType = "text/plain";
-		textContent.strText = "Resource content for: " + spReadRequest->strUri;
-		spResult->vecTextContents.push_back(textContent);
+		// The contents may reference the provider's data (e.g. a mapped file) until they are serialized.
+		ReadResourceResult result(true);
+		result.requestId = spReadRequest->requestId;
+		int iErrCode = ERRNO_INVALID_PARAMS;
+		if (spProvider)
+			iErrCode = spProvider->ReadResource(*spReadRequest, result);
 
-		std::string strResponse;
-		if (ERRNO_OK != spResult->Serialize(strResponse))
-			return ERRNO_INTERNAL_ERROR;
-		auto spTransport = CMCPSession::GetInstance().GetTransport();
-		if (!spTransport)
-			return ERRNO_INTERNAL_ERROR;
-		if (ERRNO_OK != spTransport->Write(strResponse))
+		if (ERRNO_OK == iErrCode && bCacheable)
+		{
+			std::string strResult;
+			CMCPJsonWriter writer(strResult);
+			result.WriteResult(writer);
+			unsigned long long ullReadVersion = 0;
+			if (spProvider->GetResourceVersion(spReadRequest->strUri, ullReadVersion) && ullReadVersion == ullVersion)
+				resourceCache.Put(spReadRequest->strUri, ullVersion, strResult);
+			Response::WrapResult(spReadRequest->requestId, strResult, strResponse);
+		}
+		else if (ERRNO_OK == iErrCode)
+		{
+			if (ERRNO_OK != result.Serialize(strResponse))
+				return ERRNO_INTERNAL_ERROR;
+		}
+		else
+		{
+			ErrorResponse errorResponse(true);
+			errorResponse.requestId = spReadRequest->requestId;
+			errorResponse.iCode = ERRNO_INVALID_PARAMS == iErrCode ? ERRNO_INVALID_PARAMS : ERRNO_INTERNAL_ERROR;
+			errorResponse.strMesage = ERRNO_INVALID_PARAMS == iErrCode ? "unknown resource or range" : "resource unreadable";
+			if (ERRNO_OK != errorResponse.Serialize(strResponse))
+				return ERRNO_INTERNAL_ERROR;
+		}
+		if (ERRNO_OK != spSession->WriteResponse(spReadRequest->requestId, strResponse))
 			return ERRNO_INTERNAL_ERROR;
 
 		return ERRNO_OK;
@@ -346,6 +327,9 @@ namespace MCP
 
 	int ProcessListPromptsRequest::Execute()
 	{
+		auto spSession = GetSession();
+		if (!spSession)
+			return ERRNO_INTERNAL_ERROR;
 		if (!IsValid())
 			return ERRNO_INTERNAL_ERROR;
 
@@ -353,26 +337,12 @@ namespace MCP
 		if (!spListRequest)
 			return ERRNO_INTERNAL_ERROR;
 
-		auto spResult = std::make_shared<ListPromptsResult>(true);
-		if (!spResult)
-			return ERRNO_INTERNAL_ERROR;
-		spResult->requestId = spListRequest->requestId;
-		// minimal empty list
-		std::string strResponse;
-		if (ERRNO_OK != spResult->Serialize(strResponse))
-			return ERRNO_INTERNAL_ERROR;
-		auto spTransport = CMCPSession::GetInstance().GetTransport();
-		if (!spTransport)
-			return ERRNO_INTERNAL_ERROR;
-		if (ERRNO_OK != spTransport->Write(strResponse))
-			return ERRNO_INTERNAL_ERROR;
-
-		return ERRNO_OK;
+		return WriteListResponse(spSession, spSession->GetServerPromptsList(), spListRequest->requestId, spListRequest->strCursor);
 	}
 
 	bool ProcessCallToolRequest::IsCancelled() const
 	{
-		return m_bCancelled;
+		return m_spCancellationToken && m_spCancellationToken->IsCancelled();
 	}
 
 	std::shared_ptr<MCP::CallToolResult> ProcessCallToolRequest::BuildResult()
@@ -392,31 +362,58 @@ namespace MCP
 	{
 		if (!m_spRequest)
 			return ERRNO_INTERNAL_ERROR;
+		// The session opens a channel for every call carrying a progressToken.
+		if (!m_spProgressChannel)
+			return ERRNO_OK;
 
-		if (m_spRequest->progressToken.IsValid())
-		{
-			MCP::ProgressNotification progressNotification(false);
-			progressNotification.strMethod = METHOD_NOTIFICATION_PROGRESS;
-			progressNotification.progressToken = m_spRequest->progressToken;
-			progressNotification.iProgress = iProgress;
-			progressNotification.iTotal = iTotal;
-
-			std::string strNotification;
-			if (ERRNO_OK != progressNotification.Serialize(strNotification))
-				return ERRNO_INTERNAL_ERROR;
-			auto spTransport = CMCPSession::GetInstance().GetTransport();
-			if (!spTransport)
-				return ERRNO_INTERNAL_ERROR;
-			if (ERRNO_OK != spTransport->Write(strNotification))
-				return ERRNO_INTERNAL_ERROR;
-		}
+		return m_spProgressChannel->Publish(iProgress, iTotal);
+	}
 
-		return ERRNO_OK;
+	bool ProcessCallToolRequest::IsOutputCongested() const
+	{
+		auto spSession = GetSession();
+
+		return spSession && spSession->IsOutputCongested();
 	}
 
 	int ProcessCallToolRequest::NotifyResult(std::shared_ptr<MCP::CallToolResult> spResult)
 	{
-		m_bFinished = true;
+		// The calls of a flight may outlive the session that started it.
+		auto spFlight = m_spFlight;
+		auto spSession = GetSession();
+		if (!spSession && !spFlight)
+			return ERRNO_INTERNAL_ERROR;
+		if (m_spCancellationToken)
+		{
+			// Cancelled calls are not answered. A call finishing past its deadline before the timer
+			// fired answers the timeout itself, as NotifyDeadlineExceeded() no longer will.
+			bool bCancelled = m_spCancellationToken->IsCancelled();
+			if (!m_spCancellationToken->Complete())
+				return ERRNO_OK;
+			if (bCancelled)
+				return IsAnsweredOnCancel() && spSession ? AnswerDeadlineExceeded(spSession) : ERRNO_OK;
+		}
+		if (m_spRequest && spSession && !spFlight)
+			spSession->CompleteAsyncTask(m_spRequest->requestId);
+		if (m_spProgressChannel)
+		{
+			m_spProgressChannel->Flush();
+			m_spProgressChannel->Close();
+		}
+
+		if (spFlight)
+		{
+			if (!spResult || !spResult->IsValid())
+			{
+				spFlight->Fail(ERRNO_INTERNAL_ERROR, ERROR_MESSAGE_INTERNAL_ERROR);
+				return ERRNO_INTERNAL_ERROR;
+			}
+			std::string strResult;
+			CMCPJsonWriter writer(strResult);
+			spResult->WriteResult(writer);
+			spFlight->Complete(strResult, !spResult->bIsError);
+			return ERRNO_OK;
+		}
 
 		if (!spResult)
 			return ERRNO_INTERNAL_ERROR;
@@ -424,12 +421,134 @@ namespace MCP
 		std::string strResponse;
 		if (ERRNO_OK != spResult->Serialize(strResponse))
 			return ERRNO_INTERNAL_ERROR;
-		auto spTransport = CMCPSession::GetInstance().GetTransport();
-		if (!spTransport)
-			return ERRNO_INTERNAL_ERROR;
-		if (ERRNO_OK != spTransport->Write(strResponse))
+		if (ERRNO_OK != spSession->WriteResponse(spResult->requestId, strResponse))
 			return ERRNO_INTERNAL_ERROR;
 
 		return ERRNO_OK;
 	}
+
+	std::unique_ptr<MCP::CMCPToolResultWriter> ProcessCallToolRequest::BeginResult()
+	{
+		auto spFlight = m_spFlight;
+		auto spSession = GetSession();
+		if (!spSession || !m_spRequest)
+		{
+			if (spFlight)
+				spFlight->Fail(ERRNO_INTERNAL_ERROR, ERROR_MESSAGE_INTERNAL_ERROR);
+			return nullptr;
+		}
+		if (m_spCancellationToken)
+		{
+			bool bCancelled = m_spCancellationToken->IsCancelled();
+			if (!m_spCancellationToken->Complete())
+				return nullptr;
+			if (bCancelled)
+			{
+				if (IsAnsweredOnCancel())
+					AnswerDeadlineExceeded(spSession);
+				return nullptr;
+			}
+		}
+		if (spFlight && !spFlight->Claim(spSession.get(), m_spRequest->requestId))
+			return nullptr;
+		spSession->CompleteAsyncTask(m_spRequest->requestId);
+		if (m_spProgressChannel)
+		{
+			m_spProgressChannel->Flush();
+			m_spProgressChannel->Close();
+		}
+
+		auto upStream = spSession->OpenResponseStream(m_spRequest->requestId);
+		if (!upStream)
+			return nullptr;
+
+		return std::unique_ptr<MCP::CMCPToolResultWriter>(new MCP::CMCPToolResultWriter(m_spRequest->requestId, std::move(upStream)));
+	}
+
+	void ProcessCallToolRequest::SetCancellationToken(const std::shared_ptr<MCP::CMCPCancellationToken>& spToken)
+	{
+		m_spCancellationToken = spToken;
+	}
+
+	const std::shared_ptr<MCP::CMCPCancellationToken>& ProcessCallToolRequest::GetCancellationToken() const
+	{
+		return m_spCancellationToken;
+	}
+
+	void ProcessCallToolRequest::SetProgressChannel(const std::shared_ptr<MCP::CMCPProgressChannel>& spChannel)
+	{
+		m_spProgressChannel = spChannel;
+	}
+
+	int ProcessCallToolRequest::NotifyDeadlineExceeded()
+	{
+		auto spSession = GetSession();
+		if (!spSession)
+			return ERRNO_INTERNAL_ERROR;
+		if (!m_spCancellationToken || !m_spRequest)
+			return ERRNO_INTERNAL_ERROR;
+
+		m_spCancellationToken->Cancel(CancelReason_Deadline);
+		// The result may have come in first; it answered the timeout then if it came in late.
+		if (!m_spCancellationToken->Complete())
+			return ERRNO_OK;
+		Cancel();
+
+		return AnswerDeadlineExceeded(spSession);
+	}
+
+	int ProcessCallToolRequest::AnswerDeadlineExceeded(const std::shared_ptr<CMCPSession>& spSession)
+	{
+		if (!m_spRequest)
+			return ERRNO_INTERNAL_ERROR;
+
+		spSession->CompleteAsyncTask(m_spRequest->requestId, ERRNO_REQUEST_TIMEOUT);
+		if (m_spProgressChannel)
+			m_spProgressChannel->Close();
+
+		ProcessErrorRequest task(m_spRequest);
+		task.SetSession(spSession);
+		task.SetErrorCode(ERRNO_REQUEST_TIMEOUT);
+
+		return task.Execute();
+	}
+
+	bool ProcessCallToolRequest::IsAnsweredOnCancel() const
+	{
+		return !m_spFlight && m_spCancellationToken && CancelReason_Deadline == m_spCancellationToken->GetReason();
+	}
+
+	void ProcessCallToolRequest::SetFlight(const std::shared_ptr<MCP::CMCPToolCallFlight>& spFlight)
+	{
+		m_spFlight = spFlight;
+	}
+
+	std::shared_ptr<MCP::CMCPToolCallFlight> ProcessCallToolRequest::GetFlight() const
+	{
+		return m_spFlight;
+	}
+
+	void ProcessCallToolRequest::SetSelf(const std::weak_ptr<ProcessCallToolRequest>& wpSelf)
+	{
+		m_wpSelf = wpSelf;
+	}
+
+	std::shared_ptr<ProcessCallToolRequest> ProcessCallToolRequest::GetSelf() const
+	{
+		return m_wpSelf.lock();
+	}
+
+	void ProcessCallToolRequest::Reset()
+	{
+		m_spFlight.reset();
+		m_wpSelf.reset();
+		m_spRequest.reset();
+		m_wpSession.reset();
+		m_spCancellationToken.reset();
+		if (m_spProgressChannel)
+		{
+			m_spProgressChannel->Close();
+			m_spProgressChannel.reset();
+		}
+	}
 }
\ No newline at end of file
@@ -3,12 +3,18 @@
 // Avoid using platform-specific system APIs unless absolutely necessary.
 
 #include "Task.h"
+#include "CancellationToken.h"
+#include "ProgressChannel.h"
+#include "ResultWriter.h"
 #include "../Message/Request.h"
 #include "../Message/Response.h"
 #include <memory>
 
 namespace MCP
 {
+	class CMCPSession;
+	class CMCPToolCallFlight;
+
 	class ProcessRequest : public MCP::CMCPTask
 	{
 	public:
@@ -22,12 +28,18 @@ namespace MCP
 		bool IsCancelled() const override;
 		int Execute() override;
 		int Cancel() override;
+		unsigned long GetTraceId() const override;
 
 		void SetRequest(const std::shared_ptr<MCP::Request>& spRequest);
-		std::shared_ptr<MCP::Request> GetRequest() const;
+		const std::shared_ptr<MCP::Request>& GetRequest() const;
+		// The session the request came from; results and notifications are written to its transport.
+		void SetSession(const std::shared_ptr<CMCPSession>& spSession);
+		std::shared_ptr<CMCPSession> GetSession() const;
 
 	protected:
 		std::shared_ptr<MCP::Request> m_spRequest;
+		// Weak: a task finishing after its client went away must not keep the session alive.
+		std::weak_ptr<CMCPSession> m_wpSession;
 	};
 
 	class ProcessErrorRequest : public ProcessRequest
@@ -61,6 +73,12 @@ namespace MCP
 
 		std::shared_ptr<CMCPTask> Clone() const override;
 		int Execute() override;
+
+		// The encoding picked for the messages following the response, empty for JSON.
+		void SetEncoding(const std::string& strEncoding);
+
+	private:
+		std::string m_strEncoding;
 	};
 
 	class ProcessListToolsRequest : public ProcessRequest
@@ -115,6 +133,10 @@ namespace MCP
 		int Execute() override;
 	};
 
+	// Base of all tool tasks. Long running tools override GetLane() to return TaskLane_Bulk.
+	// The session gives every call its own cancellation token; tools poll IsCancelled() or register
+	// a callback on GetCancellationToken() instead of finishing work nobody waits for anymore.
+	// Instances are recycled across calls by CMCPTaskPool, see Reset().
 	class ProcessCallToolRequest : public ProcessRequest
 	{
 	public:
@@ -127,11 +149,49 @@ namespace MCP
 		bool IsFinished() const override;
 		bool IsCancelled() const override;
 		std::shared_ptr<MCP::CallToolResult> BuildResult();
+		// Cheap enough to call per item: updates are coalesced to [task] progress_max_rate notifications
+		// per second, and the latest one is always sent before the result. A no-op without a progressToken.
 		int NotifyProgress(int iProgress, int iTotal);
+		// The client is not keeping up with the output of the session: anything optional a tool writes
+		// now (progress, logs) is held back or dropped. Producers able to pace themselves may check it
+		// between items; the result is never dropped, whatever this returns.
+		bool IsOutputCongested() const;
+		// The result is dropped if the call was cancelled or has already timed out.
 		int NotifyResult(std::shared_ptr<MCP::CallToolResult> spResult);
+		// For results too large to be built in memory: completes the call like NotifyResult() and
+		// returns a writer the content is streamed to, or nullptr if the call was cancelled, has
+		// already timed out, or its session is gone.
+		std::unique_ptr<MCP::CMCPToolResultWriter> BeginResult();
+
+		void SetCancellationToken(const std::shared_ptr<MCP::CMCPCancellationToken>& spToken);
+		const std::shared_ptr<MCP::CMCPCancellationToken>& GetCancellationToken() const;
+		void SetProgressChannel(const std::shared_ptr<MCP::CMCPProgressChannel>& spChannel);
+		// Set by the session for cacheable tools: the result answers every call of the flight, and is
+		// cached unless it is an error. A streamed result only answers the call that started the
+		// flight and is not cached.
+		void SetFlight(const std::shared_ptr<MCP::CMCPToolCallFlight>& spFlight);
+		std::shared_ptr<MCP::CMCPToolCallFlight> GetFlight() const;
+		// Set by the session: the pointer the call is tracked by (a pooled instance has one of its own),
+		// for callbacks that keep the task alive after Execute() returned.
+		void SetSelf(const std::weak_ptr<ProcessCallToolRequest>& wpSelf);
+		std::shared_ptr<ProcessCallToolRequest> GetSelf() const;
+		// Called by the session when the deadline passed: answers the request with a timeout error.
+		int NotifyDeadlineExceeded();
+		// Called once a call is over, before the instance is handed to the next call. Overrides drop
+		// what belongs to the finished call, may keep warm state (buffers, connections) for the next
+		// one, and must call the base class.
+		virtual void Reset();
 
 	private:
-		bool m_bFinished{ false };
-		bool m_bCancelled{ false };
+		// Answers the request with a timeout error once the call has been completed past its deadline.
+		int AnswerDeadlineExceeded(const std::shared_ptr<CMCPSession>& spSession);
+		// Whether a call that was completed while cancelled still gets an answer: a timed out call
+		// does, unless it is part of a flight, which answers its waiters itself.
+		bool IsAnsweredOnCancel() const;
+
+		std::shared_ptr<MCP::CMCPCancellationToken> m_spCancellationToken;
+		std::shared_ptr<MCP::CMCPProgressChannel> m_spProgressChannel;
+		std::shared_ptr<MCP::CMCPToolCallFlight> m_spFlight;
+		std::weak_ptr<ProcessCallToolRequest> m_wpSelf;
 	};
 }
\ No newline at end of file
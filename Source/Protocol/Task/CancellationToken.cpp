@@ -0,0 +1,83 @@
+#include "CancellationToken.h"
+
+namespace MCP
+{
+	bool CMCPCancellationToken::Cancel(CancelReason eReason)
+	{
+		int iExpected = CancelReason_None;
+		if (!m_iReason.compare_exchange_strong(iExpected, eReason))
+			return false;
+
+		std::vector<Callback> vecCallbacks;
+		{
+			std::unique_lock<std::mutex> _lock(m_mtxCallbacks);
+			vecCallbacks.swap(m_vecCallbacks);
+		}
+		for (auto& fnCallback : vecCallbacks)
+		{
+			fnCallback(eReason);
+		}
+
+		return true;
+	}
+
+	bool CMCPCancellationToken::IsCancelled() const
+	{
+		if (CancelReason_None != m_iReason.load(std::memory_order_acquire))
+			return true;
+
+		return m_bHasDeadline && Clock::now() >= m_tpDeadline;
+	}
+
+	CancelReason CMCPCancellationToken::GetReason() const
+	{
+		auto eReason = static_cast<CancelReason>(m_iReason.load(std::memory_order_acquire));
+		if (CancelReason_None == eReason && m_bHasDeadline && Clock::now() >= m_tpDeadline)
+			return CancelReason_Deadline;
+
+		return eReason;
+	}
+
+	void CMCPCancellationToken::SetDeadline(const Clock::time_point& tpDeadline)
+	{
+		m_tpDeadline = tpDeadline;
+		m_bHasDeadline = true;
+	}
+
+	bool CMCPCancellationToken::HasDeadline() const
+	{
+		return m_bHasDeadline;
+	}
+
+	CMCPCancellationToken::Clock::time_point CMCPCancellationToken::GetDeadline() const
+	{
+		return m_tpDeadline;
+	}
+
+	void CMCPCancellationToken::RegisterCallback(Callback fnCallback)
+	{
+		if (!fnCallback)
+			return;
+
+		{
+			std::unique_lock<std::mutex> _lock(m_mtxCallbacks);
+			if (CancelReason_None == m_iReason.load(std::memory_order_acquire))
+			{
+				m_vecCallbacks.push_back(std::move(fnCallback));
+				return;
+			}
+		}
+
+		fnCallback(static_cast<CancelReason>(m_iReason.load(std::memory_order_acquire)));
+	}
+
+	bool CMCPCancellationToken::Complete()
+	{
+		return !m_bCompleted.exchange(true, std::memory_order_acq_rel);
+	}
+
+	bool CMCPCancellationToken::IsCompleted() const
+	{
+		return m_bCompleted.load(std::memory_order_acquire);
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+// To ensure good cross-platform compatibility, the MCP namespace code uses standard C++ only.
+// Avoid using platform-specific system APIs unless absolutely necessary.
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace MCP
+{
+	enum CancelReason
+	{
+		CancelReason_None,
+		CancelReason_Client,			// notifications/cancelled
+		CancelReason_Deadline,			// the per-call deadline passed
+		CancelReason_Shutdown,			// the session is terminating
+	};
+
+	// Cancellation state shared between the session and one tools/call execution.
+	//
+	// Tools poll IsCancelled() (one atomic load, plus a clock read when a deadline is set) or
+	// register a callback to abort blocking work. The token also settles the call exactly once:
+	// whoever wins Complete() - the tool reporting its result or the session reporting the
+	// timeout - is the only one allowed to answer the request.
+	class CMCPCancellationToken
+	{
+	public:
+		using Clock = std::chrono::steady_clock;
+		using Callback = std::function<void(CancelReason eReason)>;
+
+		CMCPCancellationToken() = default;
+		CMCPCancellationToken(const CMCPCancellationToken&) = delete;
+		CMCPCancellationToken& operator=(const CMCPCancellationToken&) = delete;
+
+		// Returns false if the token was already cancelled.
+		bool Cancel(CancelReason eReason);
+		bool IsCancelled() const;
+		CancelReason GetReason() const;
+
+		void SetDeadline(const Clock::time_point& tpDeadline);
+		bool HasDeadline() const;
+		Clock::time_point GetDeadline() const;
+
+		// Invoked once, on the cancelling thread; immediately if the token is already cancelled.
+		void RegisterCallback(Callback fnCallback);
+
+		// Returns true for the first caller only.
+		bool Complete();
+		bool IsCompleted() const;
+
+	private:
+		std::atomic<int> m_iReason{ CancelReason_None };
+		std::atomic<bool> m_bCompleted{ false };
+		bool m_bHasDeadline{ false };
+		Clock::time_point m_tpDeadline;
+
+		std::mutex m_mtxCallbacks;
+		std::vector<Callback> m_vecCallbacks;
+	};
+}
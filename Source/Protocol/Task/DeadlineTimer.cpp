@@ -0,0 +1,80 @@
+#include "DeadlineTimer.h"
+#include "../Public/PublicDef.h"
+
+namespace MCP
+{
+	CMCPDeadlineTimer::~CMCPDeadlineTimer()
+	{
+		Stop();
+	}
+
+	int CMCPDeadlineTimer::Start()
+	{
+		std::unique_lock<std::mutex> _lock(m_mtxTimer);
+		if (m_bRunning)
+			return ERRNO_OK;
+		m_bRunning = true;
+		m_thrTimer = std::thread(&CMCPDeadlineTimer::TimerThreadProc, this);
+
+		return ERRNO_OK;
+	}
+
+	int CMCPDeadlineTimer::Stop()
+	{
+		{
+			std::unique_lock<std::mutex> _lock(m_mtxTimer);
+			m_bRunning = false;
+			m_queueTimers = decltype(m_queueTimers)();
+		}
+		m_cvTimer.notify_all();
+		if (m_thrTimer.joinable() && m_thrTimer.get_id() != std::this_thread::get_id())
+			m_thrTimer.join();
+
+		return ERRNO_OK;
+	}
+
+	int CMCPDeadlineTimer::Schedule(const Clock::time_point& tpDeadline, std::function<void()> fnCallback)
+	{
+		if (!fnCallback)
+			return ERRNO_INTERNAL_ERROR;
+
+		bool bEarliest = false;
+		{
+			std::unique_lock<std::mutex> _lock(m_mtxTimer);
+			if (!m_bRunning)
+				return ERRNO_INTERNAL_ERROR;
+			bEarliest = m_queueTimers.empty() || tpDeadline < m_queueTimers.top().tpDeadline;
+			m_queueTimers.push(TimerEntry{ tpDeadline, std::move(fnCallback) });
+		}
+		if (bEarliest)
+			m_cvTimer.notify_one();
+
+		return ERRNO_OK;
+	}
+
+	void CMCPDeadlineTimer::TimerThreadProc()
+	{
+		std::unique_lock<std::mutex> _lock(m_mtxTimer);
+		while (m_bRunning)
+		{
+			if (m_queueTimers.empty())
+			{
+				m_cvTimer.wait(_lock);
+				continue;
+			}
+
+			auto tpDeadline = m_queueTimers.top().tpDeadline;
+			if (Clock::now() < tpDeadline)
+			{
+				m_cvTimer.wait_until(_lock, tpDeadline);
+				continue;
+			}
+
+			auto fnCallback = std::move(const_cast<TimerEntry&>(m_queueTimers.top()).fnCallback);
+			m_queueTimers.pop();
+			_lock.unlock();
+			fnCallback();
+			_lock.lock();
+		}
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+// To ensure good cross-platform compatibility, the MCP namespace code uses standard C++ only.
+// Avoid using platform-specific system APIs unless absolutely necessary.
+
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <queue>
+#include <vector>
+#include <thread>
+
+namespace MCP
+{
+	// One thread firing callbacks at their deadline, used to time out tools/call requests.
+	// Callbacks run on the timer thread and must not block.
+	class CMCPDeadlineTimer
+	{
+	public:
+		using Clock = std::chrono::steady_clock;
+
+		CMCPDeadlineTimer() = default;
+		~CMCPDeadlineTimer();
+		CMCPDeadlineTimer(const CMCPDeadlineTimer&) = delete;
+		CMCPDeadlineTimer& operator=(const CMCPDeadlineTimer&) = delete;
+
+		int Start();
+		// Drops the pending callbacks without running them.
+		int Stop();
+
+		int Schedule(const Clock::time_point& tpDeadline, std::function<void()> fnCallback);
+
+	private:
+		struct TimerEntry
+		{
+			Clock::time_point tpDeadline;
+			std::function<void()> fnCallback;
+
+			bool operator>(const TimerEntry& other) const { return tpDeadline > other.tpDeadline; }
+		};
+
+		void TimerThreadProc();
+
+		std::mutex m_mtxTimer;
+		std::condition_variable m_cvTimer;
+		bool m_bRunning{ false };
+		std::priority_queue<TimerEntry, std::vector<TimerEntry>, std::greater<TimerEntry>> m_queueTimers;
+		std::thread m_thrTimer;
+	};
+}
@@ -0,0 +1,98 @@
+#include "ProgressChannel.h"
+#include "../Session/Session.h"
+#include <algorithm>
+
+namespace MCP
+{
+	CMCPProgressChannel::CMCPProgressChannel(const MCP::ProgressToken& progressToken, const std::weak_ptr<CMCPSession>& wpSession, Clock::duration interval)
+		: m_wpSession(wpSession)
+		, m_interval(interval)
+	{
+		m_notification.strMethod = METHOD_NOTIFICATION_PROGRESS;
+		m_notification.progressToken = progressToken;
+	}
+
+	int CMCPProgressChannel::Publish(int iProgress, int iTotal)
+	{
+		m_ullLatest.store(Pack(iProgress, iTotal));
+		m_bPublished.store(true);
+		// An armed flush reads the value stored above when it runs.
+		if (m_bFlushArmed.exchange(true))
+			return ERRNO_OK;
+
+		auto tpNextWrite = Clock::time_point(Clock::duration(m_repNextWrite.load()));
+		if (tpNextWrite <= Clock::now())
+			return Flush();
+
+		auto spSession = m_wpSession.lock();
+		if (!spSession)
+			return ERRNO_INTERNAL_ERROR;
+		// Without a timer the update is written late rather than never.
+		if (!ArmFlush(spSession, tpNextWrite))
+			return Flush();
+
+		return ERRNO_OK;
+	}
+
+	int CMCPProgressChannel::Flush()
+	{
+		std::unique_lock<std::mutex> _lock(m_mtxWrite);
+		// Cleared before reading the value: a Publish() racing with this write arms the next flush.
+		m_bFlushArmed.store(false);
+		if (m_bClosed || !m_bPublished.load())
+			return ERRNO_OK;
+		unsigned long long ullLatest = m_ullLatest.load();
+		if (m_bWritten && ullLatest == m_ullWritten)
+			return ERRNO_OK;
+
+		auto spSession = m_wpSession.lock();
+		if (!spSession)
+			return ERRNO_INTERNAL_ERROR;
+		if (spSession->IsOutputCongested())
+		{
+			// Held back, not queued: later updates replace the value until the client catches up.
+			static const Clock::duration s_durMinRetry = std::chrono::milliseconds(10);
+			if (!m_bFlushArmed.exchange(true) && !ArmFlush(spSession, Clock::now() + (std::max)(m_interval, s_durMinRetry)))
+				m_bFlushArmed.store(false);
+			return ERRNO_OK;
+		}
+
+		m_notification.iProgress = static_cast<int>(static_cast<unsigned int>(ullLatest >> 32));
+		m_notification.iTotal = static_cast<int>(static_cast<unsigned int>(ullLatest));
+		if (ERRNO_OK != m_notification.Serialize(m_strNotification))
+			return ERRNO_INTERNAL_ERROR;
+		if (ERRNO_OK != spSession->WriteMessage(m_strNotification))
+			return ERRNO_INTERNAL_ERROR;
+
+		m_bWritten = true;
+		m_ullWritten = ullLatest;
+		m_repNextWrite.store((Clock::now() + m_interval).time_since_epoch().count());
+
+		return ERRNO_OK;
+	}
+
+	bool CMCPProgressChannel::ArmFlush(const std::shared_ptr<CMCPSession>& spSession, Clock::time_point tpWhen)
+	{
+		std::weak_ptr<CMCPProgressChannel> wpChannel = shared_from_this();
+		int iErrCode = spSession->ScheduleCallback(tpWhen, [wpChannel]()
+			{
+				auto spChannel = wpChannel.lock();
+				if (spChannel)
+					spChannel->Flush();
+			});
+
+		return ERRNO_OK == iErrCode;
+	}
+
+	void CMCPProgressChannel::Close()
+	{
+		std::unique_lock<std::mutex> _lock(m_mtxWrite);
+		m_bClosed = true;
+	}
+
+	unsigned long long CMCPProgressChannel::Pack(int iProgress, int iTotal)
+	{
+		return (static_cast<unsigned long long>(static_cast<unsigned int>(iProgress)) << 32)
+			| static_cast<unsigned long long>(static_cast<unsigned int>(iTotal));
+	}
+}
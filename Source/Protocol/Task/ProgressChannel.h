@@ -0,0 +1,63 @@
+#pragma once
+// To ensure good cross-platform compatibility, the MCP namespace code uses standard C++ only.
+// Avoid using platform-specific system APIs unless absolutely necessary.
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "../Message/Notification.h"
+
+namespace MCP
+{
+	class CMCPSession;
+
+	// Progress of one tools/call carrying a progressToken, sent at a bounded rate.
+	//
+	// Publish() only stores the latest (progress, total) in one atomic word. The first update after
+	// a quiet period is written at once; updates arriving faster than the interval arm a single
+	// flush on the session's timer, which writes whatever value is the latest by then. Flush()
+	// writes a value not sent yet right away and is called before the result, so the client always
+	// sees the final progress; after Close() nothing is written anymore.
+	//
+	// While the session's output is congested (CMCPSession::IsOutputCongested()) the write is put off
+	// by another interval instead, so a slow client gets fewer, later updates; one still pending when
+	// the result is written is dropped, the result supersedes it.
+	class CMCPProgressChannel : public std::enable_shared_from_this<CMCPProgressChannel>
+	{
+	public:
+		using Clock = std::chrono::steady_clock;
+
+		// An interval of zero writes every update.
+		CMCPProgressChannel(const MCP::ProgressToken& progressToken, const std::weak_ptr<CMCPSession>& wpSession, Clock::duration interval);
+		CMCPProgressChannel(const CMCPProgressChannel&) = delete;
+		CMCPProgressChannel& operator=(const CMCPProgressChannel&) = delete;
+
+		int Publish(int iProgress, int iTotal);
+		int Flush();
+		void Close();
+
+	private:
+		static unsigned long long Pack(int iProgress, int iTotal);
+		// Arms a flush at tpWhen on the session's timer; false if there is no timer.
+		bool ArmFlush(const std::shared_ptr<CMCPSession>& spSession, Clock::time_point tpWhen);
+
+		std::weak_ptr<CMCPSession> m_wpSession;
+		const Clock::duration m_interval;
+
+		std::atomic<unsigned long long> m_ullLatest{ 0 };
+		std::atomic_bool m_bPublished{ false };
+		std::atomic_bool m_bFlushArmed{ false };
+		// Earliest time of the next write, in Clock ticks.
+		std::atomic<Clock::rep> m_repNextWrite{ 0 };
+
+		// Serializes the writes; only taken at the bounded rate, never by Publish() alone.
+		std::mutex m_mtxWrite;
+		bool m_bClosed{ false };
+		bool m_bWritten{ false };
+		unsigned long long m_ullWritten{ 0 };
+		MCP::ProgressNotification m_notification{ false };
+		std::string m_strNotification;
+	};
+}
@@ -0,0 +1,205 @@
+#include "ResultWriter.h"
+#include <algorithm>
+
+namespace MCP
+{
+	// Bytes collected before they are passed on to the stream.
+	static constexpr size_t STREAM_PIECE_BYTES = 64 * 1024;
+
+	CMCPToolResultWriter::CMCPToolResultWriter(const MCP::RequestId& requestId, std::unique_ptr<CMCPMessageStream> upStream)
+		: m_upStream(std::move(upStream))
+	{
+		m_strBuffer.reserve(STREAM_PIECE_BYTES * 2);
+		// Same member order as CallToolResult::DoWrite().
+		m_writer.StartObject();
+		requestId.WriteMember(m_writer);
+		m_writer.Key(MSG_KEY_JSONRPC);
+		m_writer.String(JSON_RPC_VER);
+		m_writer.Key(MSG_KEY_RESULT);
+		m_writer.StartObject();
+		m_writer.Key(MSG_KEY_CONTENT);
+		m_writer.StartArray();
+	}
+
+	CMCPToolResultWriter::~CMCPToolResultWriter()
+	{
+		if (!m_bFinished)
+			Finish(true);
+	}
+
+	int CMCPToolResultWriter::AddText(const std::string& strText)
+	{
+		int iErrCode = BeginText();
+		if (ERRNO_OK != iErrCode)
+			return iErrCode;
+		iErrCode = AppendText(strText.data(), strText.size());
+		if (ERRNO_OK != iErrCode)
+			return iErrCode;
+
+		return EndText();
+	}
+
+	int CMCPToolResultWriter::AddImage(const MCP::ImageContent& image)
+	{
+		if (m_bFinished || m_bInText)
+			return ERRNO_INTERNAL_ERROR;
+		if (image.binData.IsEmpty())
+		{
+			image.DoWrite(m_writer);
+			return Drain(STREAM_PIECE_BYTES);
+		}
+
+		// Same member order as ImageContent::DoWrite().
+		m_writer.StartObject();
+		m_writer.Key(MSG_KEY_DATA);
+		int iErrCode = WriteBase64(image.binData);
+		m_writer.Key(MSG_KEY_MIMETYPE);
+		m_writer.String(image.strMimeType);
+		m_writer.Key(MSG_KEY_TYPE);
+		m_writer.String(image.strType);
+		m_writer.EndObject();
+		if (ERRNO_OK != iErrCode)
+			return iErrCode;
+
+		return Drain(STREAM_PIECE_BYTES);
+	}
+
+	int CMCPToolResultWriter::AddResource(const MCP::EmbeddedResource& resource)
+	{
+		if (m_bFinished || m_bInText)
+			return ERRNO_INTERNAL_ERROR;
+		auto& blob = resource.blobResource;
+		if (resource.textResource.IsValid() || !blob.IsValid() || blob.binBlob.IsEmpty())
+		{
+			resource.DoWrite(m_writer);
+			return Drain(STREAM_PIECE_BYTES);
+		}
+
+		// Same member order as EmbeddedResource::DoWrite() and BlobResourceContents::DoWrite().
+		m_writer.StartObject();
+		m_writer.Key(MSG_KEY_RESOURCE);
+		m_writer.StartObject();
+		m_writer.Key(MSG_KEY_BLOB);
+		int iErrCode = WriteBase64(blob.binBlob);
+		if (!blob.strMimeType.empty())
+		{
+			m_writer.Key(MSG_KEY_MIMETYPE);
+			m_writer.String(blob.strMimeType);
+		}
+		m_writer.Key(MSG_KEY_URI);
+		m_writer.String(blob.strUri);
+		m_writer.EndObject();
+		m_writer.Key(MSG_KEY_TYPE);
+		m_writer.String(resource.strType);
+		m_writer.EndObject();
+		if (ERRNO_OK != iErrCode)
+			return iErrCode;
+
+		return Drain(STREAM_PIECE_BYTES);
+	}
+
+	int CMCPToolResultWriter::BeginText()
+	{
+		if (m_bFinished || m_bInText)
+			return ERRNO_INTERNAL_ERROR;
+		m_bInText = true;
+		// Same member order as TextContent::DoWrite().
+		m_writer.StartObject();
+		m_writer.Key(MSG_KEY_TEXT);
+		m_writer.StartString();
+
+		return ERRNO_OK;
+	}
+
+	int CMCPToolResultWriter::AppendText(const char* pData, size_t nLength)
+	{
+		if (m_bFinished || !m_bInText)
+			return ERRNO_INTERNAL_ERROR;
+
+		// Escaping can multiply the size, so large pieces are escaped a slice at a time.
+		while (nLength > 0)
+		{
+			size_t nSlice = (std::min)(nLength, STREAM_PIECE_BYTES);
+			m_writer.StringChunk(pData, nSlice);
+			pData += nSlice;
+			nLength -= nSlice;
+
+			int iErrCode = Drain(STREAM_PIECE_BYTES);
+			if (ERRNO_OK != iErrCode)
+				return iErrCode;
+		}
+
+		return ERRNO_OK;
+	}
+
+	int CMCPToolResultWriter::EndText()
+	{
+		if (m_bFinished || !m_bInText)
+			return ERRNO_INTERNAL_ERROR;
+		m_bInText = false;
+		m_writer.EndString();
+		m_writer.Key(MSG_KEY_TYPE);
+		m_writer.String(CONST_TEXT);
+		m_writer.EndObject();
+
+		return Drain(STREAM_PIECE_BYTES);
+	}
+
+	int CMCPToolResultWriter::Finish(bool bIsError)
+	{
+		if (m_bFinished)
+			return ERRNO_INTERNAL_ERROR;
+		if (m_bInText)
+			EndText();
+		m_bFinished = true;
+
+		m_writer.EndArray();
+		m_writer.Key(MSG_KEY_IS_ERROR);
+		m_writer.Bool(bIsError);
+		m_writer.EndObject();
+		m_writer.EndObject();
+
+		int iErrCode = Drain(0);
+		if (!m_upStream)
+			return iErrCode;
+		int iCloseCode = m_upStream->Close();
+		m_upStream.reset();
+
+		return ERRNO_OK != iErrCode ? iErrCode : iCloseCode;
+	}
+
+	int CMCPToolResultWriter::WriteBase64(const MCP::BinaryData& data)
+	{
+		// Slices are a multiple of 3 bytes, and their encoding about one piece.
+		const size_t nSliceBytes = STREAM_PIECE_BYTES / 4 * 3;
+		const unsigned char* pData = data.pData;
+		size_t nLength = data.nSize;
+
+		m_writer.StartString();
+		int iErrCode = ERRNO_OK;
+		while (nLength > 0 && ERRNO_OK == iErrCode)
+		{
+			size_t nSlice = (std::min)(nLength, nSliceBytes);
+			m_writer.Base64Chunk(pData, nSlice);
+			pData += nSlice;
+			nLength -= nSlice;
+			iErrCode = Drain(STREAM_PIECE_BYTES);
+		}
+		m_writer.EndString();
+
+		return iErrCode;
+	}
+
+	int CMCPToolResultWriter::Drain(size_t nThreshold)
+	{
+		if (m_strBuffer.size() < nThreshold || m_strBuffer.empty())
+			return m_iErrCode;
+
+		// After a failed write the rest is dropped; the stream is still closed by Finish().
+		if (ERRNO_OK == m_iErrCode && m_upStream)
+			m_iErrCode = m_upStream->Append(m_strBuffer.data(), m_strBuffer.size());
+		m_strBuffer.clear();
+
+		return m_iErrCode;
+	}
+}
@@ -0,0 +1,53 @@
+#pragma once
+// To ensure good cross-platform compatibility, the MCP namespace code uses standard C++ only.
+// Avoid using platform-specific system APIs unless absolutely necessary.
+
+#include <memory>
+#include <string>
+#include "../Message/BasicMessage.h"
+#include "../Message/JsonWriter.h"
+#include "../Transport/Transport.h"
+
+namespace MCP
+{
+	// Writes a tools/call result item by item instead of building a CallToolResult first, so a tool
+	// producing a very large output never holds all of it. The text is escaped into a small buffer
+	// that is passed on to the transport's message stream whenever it fills up; the bytes written
+	// are the same as for the equivalent CallToolResult.
+	//
+	// Obtained from ProcessCallToolRequest::BeginResult(). Finish() completes the message; a writer
+	// destroyed before that completes it with isError set, so the client is always answered.
+	class CMCPToolResultWriter
+	{
+	public:
+		CMCPToolResultWriter(const MCP::RequestId& requestId, std::unique_ptr<CMCPMessageStream> upStream);
+		~CMCPToolResultWriter();
+		CMCPToolResultWriter(const CMCPToolResultWriter&) = delete;
+		CMCPToolResultWriter& operator=(const CMCPToolResultWriter&) = delete;
+
+		int AddText(const std::string& strText);
+		// Binary data (binData, binBlob) is encoded a slice at a time, never as a whole.
+		int AddImage(const MCP::ImageContent& image);
+		int AddResource(const MCP::EmbeddedResource& resource);
+
+		// One text item written in pieces; the pieces may split UTF-8 sequences.
+		int BeginText();
+		int AppendText(const char* pData, size_t nLength);
+		int EndText();
+
+		int Finish(bool bIsError = false);
+
+	private:
+		// Passes the buffer on once it holds at least nThreshold bytes.
+		int Drain(size_t nThreshold);
+		// Writes the bytes as a base64 string value, passing the buffer on as it fills up.
+		int WriteBase64(const MCP::BinaryData& data);
+
+		std::unique_ptr<CMCPMessageStream> m_upStream;
+		std::string m_strBuffer;
+		CMCPJsonWriter m_writer{ m_strBuffer };
+		bool m_bInText{ false };
+		bool m_bFinished{ false };
+		int m_iErrCode{ ERRNO_OK };
+	};
+}
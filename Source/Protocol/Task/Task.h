@@ -7,10 +7,22 @@
 
 namespace MCP
 {
+	// Scheduling lanes of asynchronous tasks, served in this order of priority.
+	enum TaskLane
+	{
+		TaskLane_Control,		// latency critical bookkeeping, never queued behind tool work
+		TaskLane_Interactive,	// default for tools/call
+		TaskLane_Bulk,			// long running tools, never allowed to occupy every worker
+		TaskLane_Count,
+	};
+
 	class CMCPTask
 	{
 	public:
 		virtual ~CMCPTask() {}
+		virtual TaskLane GetLane() const { return TaskLane_Interactive; }
+		// Runtime id of the message the task works on, tagging its trace spans (0 = none).
+		virtual unsigned long GetTraceId() const { return 0; }
 		virtual std::shared_ptr<CMCPTask> Clone() const = 0;
 		virtual bool IsValid() const = 0;
 		virtual bool IsFinished() const = 0;
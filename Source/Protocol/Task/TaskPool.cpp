@@ -0,0 +1,86 @@
+#include "TaskPool.h"
+#include <utility>
+
+namespace MCP
+{
+	CMCPTaskPool::CMCPTaskPool(const std::shared_ptr<MCP::ProcessCallToolRequest>& spPrototype, size_t nMaxIdle)
+		: m_spPrototype(spPrototype)
+		, m_nMaxIdle(nMaxIdle)
+	{
+		m_vecIdle.reserve(nMaxIdle);
+	}
+
+	CMCPTaskPool::CMCPTaskPool(PrototypeFactory fnCreatePrototype, size_t nMaxIdle)
+		: m_fnCreatePrototype(std::move(fnCreatePrototype))
+		, m_nMaxIdle(nMaxIdle)
+	{
+		m_vecIdle.reserve(nMaxIdle);
+	}
+
+	std::shared_ptr<MCP::ProcessCallToolRequest> CMCPTaskPool::Acquire()
+	{
+		std::shared_ptr<MCP::ProcessCallToolRequest> spTask;
+		{
+			std::unique_lock<std::mutex> _lock(m_mtxIdle);
+			if (!m_vecIdle.empty())
+			{
+				spTask = std::move(m_vecIdle.back());
+				m_vecIdle.pop_back();
+			}
+		}
+		if (!spTask)
+			spTask = CreateTask();
+		if (!spTask)
+			return nullptr;
+
+		auto pTask = spTask.get();
+		return std::shared_ptr<MCP::ProcessCallToolRequest>(pTask, Recycler{ shared_from_this(), std::move(spTask) });
+	}
+
+	size_t CMCPTaskPool::GetIdleCount() const
+	{
+		std::unique_lock<std::mutex> _lock(m_mtxIdle);
+		return m_vecIdle.size();
+	}
+
+	std::shared_ptr<MCP::ProcessCallToolRequest> CMCPTaskPool::GetPrototype() const
+	{
+		// Only taken when no idle instance is left, so calls served from the pool never wait on it.
+		std::unique_lock<std::mutex> _lock(m_mtxPrototype);
+		if (!m_spPrototype && m_fnCreatePrototype)
+		{
+			m_spPrototype = m_fnCreatePrototype();
+			if (m_spPrototype)
+				m_fnCreatePrototype = nullptr;
+		}
+
+		return m_spPrototype;
+	}
+
+	std::shared_ptr<MCP::ProcessCallToolRequest> CMCPTaskPool::CreateTask() const
+	{
+		auto spPrototype = GetPrototype();
+		if (!spPrototype)
+			return nullptr;
+		// The only dynamic cast left on the call path, paid once per instance instead of once per call.
+		return std::dynamic_pointer_cast<MCP::ProcessCallToolRequest>(spPrototype->Clone());
+	}
+
+	void CMCPTaskPool::Release(std::shared_ptr<MCP::ProcessCallToolRequest>&& spTask)
+	{
+		// Outside the lock: tools may release connections or other resources in Reset().
+		spTask->Reset();
+
+		std::unique_lock<std::mutex> _lock(m_mtxIdle);
+		if (m_vecIdle.size() < m_nMaxIdle)
+			m_vecIdle.push_back(std::move(spTask));
+	}
+
+	void CMCPTaskPool::Recycler::operator()(MCP::ProcessCallToolRequest*)
+	{
+		auto spPool = wpPool.lock();
+		if (spPool)
+			spPool->Release(std::move(spTask));
+		spTask.reset();
+	}
+}
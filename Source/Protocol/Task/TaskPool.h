@@ -0,0 +1,58 @@
+#pragma once
+// To ensure good cross-platform compatibility, the MCP namespace code uses standard C++ only.
+// Avoid using platform-specific system APIs unless absolutely necessary.
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "BasicTask.h"
+
+namespace MCP
+{
+	// Recycles the task instances of one tool instead of cloning the prototype for every tools/call.
+	//
+	// Acquire() hands out an idle instance, or a clone of the prototype when none is left. The
+	// returned pointer has a control block of its own: once the last reference to it is gone, the
+	// instance is Reset() and goes back to the pool, while weak references taken during the call
+	// (deadline timer, in-flight index) expire as they would for a fresh task. At most nMaxIdle
+	// instances are kept; the rest are destroyed.
+	//
+	// The prototype can also be given as a factory, called on the first Acquire(): tools that are
+	// costly to construct (models, connections...) then cost nothing until they are called.
+	class CMCPTaskPool : public std::enable_shared_from_this<CMCPTaskPool>
+	{
+	public:
+		using PrototypeFactory = std::function<std::shared_ptr<MCP::ProcessCallToolRequest>()>;
+
+		CMCPTaskPool(const std::shared_ptr<MCP::ProcessCallToolRequest>& spPrototype, size_t nMaxIdle);
+		CMCPTaskPool(PrototypeFactory fnCreatePrototype, size_t nMaxIdle);
+		CMCPTaskPool(const CMCPTaskPool&) = delete;
+		CMCPTaskPool& operator=(const CMCPTaskPool&) = delete;
+
+		std::shared_ptr<MCP::ProcessCallToolRequest> Acquire();
+		size_t GetIdleCount() const;
+		// Builds the prototype if it was not yet; nullptr if the factory failed, it is tried again
+		// on the next call.
+		std::shared_ptr<MCP::ProcessCallToolRequest> GetPrototype() const;
+
+	private:
+		struct Recycler
+		{
+			std::weak_ptr<CMCPTaskPool> wpPool;
+			std::shared_ptr<MCP::ProcessCallToolRequest> spTask;
+
+			void operator()(MCP::ProcessCallToolRequest*);
+		};
+
+		std::shared_ptr<MCP::ProcessCallToolRequest> CreateTask() const;
+		void Release(std::shared_ptr<MCP::ProcessCallToolRequest>&& spTask);
+
+		mutable std::mutex m_mtxPrototype;
+		mutable PrototypeFactory m_fnCreatePrototype;
+		mutable std::shared_ptr<MCP::ProcessCallToolRequest> m_spPrototype;
+		size_t m_nMaxIdle{ 0 };
+		mutable std::mutex m_mtxIdle;
+		std::vector<std::shared_ptr<MCP::ProcessCallToolRequest>> m_vecIdle;
+	};
+}
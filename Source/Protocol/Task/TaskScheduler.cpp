@@ -0,0 +1,347 @@
+#include "TaskScheduler.h"
+#include "../Public/PublicDef.h"
+#include "../Public/Trace.h"
+
+namespace MCP
+{
+	// Identifies the scheduler worker running on the current thread, if any.
+	static thread_local const CMCPTaskScheduler* t_pCurrentScheduler{ nullptr };
+	static thread_local size_t t_nCurrentWorker{ 0 };
+
+	CMCPTaskScheduler::~CMCPTaskScheduler()
+	{
+		Stop();
+	}
+
+	int CMCPTaskScheduler::Start(size_t nThreads, size_t nReservedWorkers, CompletionCallback fnOnComplete)
+	{
+		std::unique_lock<std::mutex> _lock(m_mtxIdle);
+		if (m_bRunning)
+			return ERRNO_INTERNAL_ERROR;
+
+		if (0 == nThreads)
+			nThreads = std::thread::hardware_concurrency();
+		if (0 == nThreads)
+			nThreads = 1;
+
+		m_nReservedWorkers = nReservedWorkers < nThreads ? nReservedWorkers : nThreads - 1;
+		m_fnOnComplete = std::move(fnOnComplete);
+		m_vecQueues.clear();
+		for (size_t i = 0; i < nThreads; ++i)
+		{
+			m_vecQueues.push_back(std::make_unique<WorkerQueue>());
+		}
+
+		m_bRunning = true;
+		for (size_t i = 0; i < nThreads; ++i)
+		{
+			m_vecWorkers.emplace_back(&CMCPTaskScheduler::WorkerProc, this, i);
+		}
+
+		return ERRNO_OK;
+	}
+
+	int CMCPTaskScheduler::Stop()
+	{
+		std::vector<std::thread> vecWorkers;
+		{
+			std::unique_lock<std::mutex> _lock(m_mtxIdle);
+			m_bRunning = false;
+			vecWorkers.swap(m_vecWorkers);
+		}
+		m_cvIdle.notify_all();
+
+		for (auto& worker : vecWorkers)
+		{
+			if (worker.joinable())
+				worker.join();
+		}
+
+		// Drop whatever is still queued.
+		for (auto& upQueue : m_vecQueues)
+		{
+			std::unique_lock<std::mutex> _lock(upQueue->mtxQueue);
+			for (size_t nLane = 0; nLane < TaskLane_Count; ++nLane)
+			{
+				m_arrCounters[nLane].nQueued -= upQueue->arrLanes[nLane].size();
+				upQueue->arrLanes[nLane].clear();
+			}
+		}
+		{
+			std::unique_lock<std::mutex> _lock(m_mtxGroups);
+			for (auto& group : m_hashGroups)
+			{
+				group.second.deqWaiting.clear();
+				group.second.nAdmitted = 0;
+			}
+			m_nWaiting = 0;
+		}
+
+		return ERRNO_OK;
+	}
+
+	bool CMCPTaskScheduler::IsRunning() const
+	{
+		return m_bRunning;
+	}
+
+	size_t CMCPTaskScheduler::GetThreadCount() const
+	{
+		std::unique_lock<std::mutex> _lock(m_mtxIdle);
+		return m_vecWorkers.size();
+	}
+
+	void CMCPTaskScheduler::SetGroupLimit(const std::string& strGroup, size_t nLimit)
+	{
+		std::unique_lock<std::mutex> _lock(m_mtxGroups);
+		m_hashGroups[strGroup].nLimit = nLimit;
+	}
+
+	void CMCPTaskScheduler::SetPendingLimit(size_t nMaxPending)
+	{
+		m_nMaxPending = nMaxPending;
+	}
+
+	size_t CMCPTaskScheduler::GetPendingCount() const
+	{
+		size_t nPending = m_nWaiting.load(std::memory_order_relaxed);
+		for (auto& counters : m_arrCounters)
+		{
+			nPending += counters.nQueued.load(std::memory_order_relaxed);
+		}
+
+		return nPending;
+	}
+
+	int CMCPTaskScheduler::Commit(const std::shared_ptr<CMCPTask>& spTask, const std::string& strGroup)
+	{
+		if (!spTask)
+			return ERRNO_INTERNAL_ERROR;
+		if (!m_bRunning)
+			return ERRNO_INTERNAL_ERROR;
+
+		ReadyTask readyTask;
+		readyTask.spTask = spTask;
+		readyTask.eLane = spTask->GetLane();
+		if (readyTask.eLane < TaskLane_Control || readyTask.eLane >= TaskLane_Count)
+			readyTask.eLane = TaskLane_Interactive;
+		// Checked without a lock, so concurrent commits may overshoot the limit by a few tasks.
+		size_t nMaxPending = m_nMaxPending.load(std::memory_order_relaxed);
+		if (nMaxPending > 0 && TaskLane_Control != readyTask.eLane && GetPendingCount() >= nMaxPending)
+			return ERRNO_SERVER_OVERLOADED;
+		m_arrCounters[readyTask.eLane].ullSubmitted++;
+
+		{
+			std::unique_lock<std::mutex> _lock(m_mtxGroups);
+			auto& group = m_hashGroups[strGroup];
+			readyTask.pGroup = &group;
+			if (group.nLimit > 0 && group.nAdmitted >= group.nLimit)
+			{
+				group.deqWaiting.push_back(spTask);
+				++m_nWaiting;
+				return ERRNO_OK;
+			}
+			++group.nAdmitted;
+		}
+
+		Enqueue(std::move(readyTask));
+
+		return ERRNO_OK;
+	}
+
+	TaskLaneStats CMCPTaskScheduler::GetLaneStats(TaskLane eLane) const
+	{
+		TaskLaneStats stats;
+		if (eLane < TaskLane_Control || eLane >= TaskLane_Count)
+			return stats;
+
+		auto& counters = m_arrCounters[eLane];
+		stats.nQueued = counters.nQueued;
+		stats.ullSubmitted = counters.ullSubmitted;
+		stats.ullExecuted = counters.ullExecuted;
+		stats.ullTotalWaitUs = counters.ullTotalWaitUs;
+		stats.ullMaxWaitUs = counters.ullMaxWaitUs;
+
+		return stats;
+	}
+
+	void CMCPTaskScheduler::Enqueue(ReadyTask&& readyTask)
+	{
+		if (m_vecQueues.empty())
+			return;
+
+		// Stay on the current worker when committed from inside the pool, otherwise spread the load.
+		size_t nQueue = 0;
+		if (t_pCurrentScheduler == this)
+			nQueue = t_nCurrentWorker;
+		else
+			nQueue = m_nNextQueue++ % m_vecQueues.size();
+
+		TaskLane eLane = readyTask.eLane;
+		readyTask.tpEnqueued = std::chrono::steady_clock::now();
+		{
+			auto& queue = *m_vecQueues[nQueue];
+			std::unique_lock<std::mutex> _lock(queue.mtxQueue);
+			queue.arrLanes[eLane].push_back(std::move(readyTask));
+			m_arrCounters[eLane].nQueued++;
+		}
+
+		// Taking the idle lock orders the counter update before a sleeping worker's predicate check.
+		{
+			std::unique_lock<std::mutex> _lock(m_mtxIdle);
+		}
+		// Reserved workers cannot take bulk tasks, so make sure an eligible one wakes up.
+		if (TaskLane_Bulk == eLane && m_nReservedWorkers > 0)
+			m_cvIdle.notify_all();
+		else
+			m_cvIdle.notify_one();
+	}
+
+	bool CMCPTaskScheduler::CanRunLane(size_t nIndex, TaskLane eLane) const
+	{
+		if (TaskLane_Bulk == eLane)
+			return nIndex >= m_nReservedWorkers;
+
+		return true;
+	}
+
+	bool CMCPTaskScheduler::HasRunnable(size_t nIndex) const
+	{
+		for (size_t nLane = 0; nLane < TaskLane_Count; ++nLane)
+		{
+			if (CanRunLane(nIndex, static_cast<TaskLane>(nLane)) && m_arrCounters[nLane].nQueued > 0)
+				return true;
+		}
+
+		return false;
+	}
+
+	bool CMCPTaskScheduler::PopFront(size_t nQueue, TaskLane eLane, ReadyTask& readyTask)
+	{
+		auto& queue = *m_vecQueues[nQueue];
+		std::unique_lock<std::mutex> _lock(queue.mtxQueue);
+		auto& deqLane = queue.arrLanes[eLane];
+		if (deqLane.empty())
+			return false;
+
+		readyTask = std::move(deqLane.front());
+		deqLane.pop_front();
+		m_arrCounters[eLane].nQueued--;
+
+		return true;
+	}
+
+	bool CMCPTaskScheduler::StealBack(size_t nQueue, TaskLane eLane, ReadyTask& readyTask)
+	{
+		auto& queue = *m_vecQueues[nQueue];
+		std::unique_lock<std::mutex> _lock(queue.mtxQueue, std::try_to_lock);
+		if (!_lock.owns_lock())
+			return false;
+		auto& deqLane = queue.arrLanes[eLane];
+		if (deqLane.empty())
+			return false;
+
+		readyTask = std::move(deqLane.back());
+		deqLane.pop_back();
+		m_arrCounters[eLane].nQueued--;
+
+		return true;
+	}
+
+	bool CMCPTaskScheduler::TryPop(size_t nIndex, ReadyTask& readyTask)
+	{
+		const size_t nQueues = m_vecQueues.size();
+		for (size_t nLane = 0; nLane < TaskLane_Count; ++nLane)
+		{
+			auto eLane = static_cast<TaskLane>(nLane);
+			if (!CanRunLane(nIndex, eLane))
+				continue;
+			if (0 == m_arrCounters[nLane].nQueued)
+				continue;
+
+			if (PopFront(nIndex, eLane, readyTask))
+				return true;
+			for (size_t nOffset = 1; nOffset < nQueues; ++nOffset)
+			{
+				if (StealBack((nIndex + nOffset) % nQueues, eLane, readyTask))
+					return true;
+			}
+		}
+
+		return false;
+	}
+
+	void CMCPTaskScheduler::OnTaskCompleted(Group* pGroup)
+	{
+		if (!pGroup)
+			return;
+
+		ReadyTask readyTask;
+		{
+			std::unique_lock<std::mutex> _lock(m_mtxGroups);
+			if (!m_bRunning)
+				return;
+
+			--pGroup->nAdmitted;
+			if (pGroup->deqWaiting.empty())
+				return;
+
+			++pGroup->nAdmitted;
+			readyTask.spTask = pGroup->deqWaiting.front();
+			readyTask.pGroup = pGroup;
+			pGroup->deqWaiting.pop_front();
+			--m_nWaiting;
+		}
+
+		readyTask.eLane = readyTask.spTask->GetLane();
+		if (readyTask.eLane < TaskLane_Control || readyTask.eLane >= TaskLane_Count)
+			readyTask.eLane = TaskLane_Interactive;
+		Enqueue(std::move(readyTask));
+	}
+
+	void CMCPTaskScheduler::WorkerProc(size_t nIndex)
+	{
+		t_pCurrentScheduler = this;
+		t_nCurrentWorker = nIndex;
+
+		while (m_bRunning)
+		{
+			ReadyTask readyTask;
+			if (!TryPop(nIndex, readyTask))
+			{
+				std::unique_lock<std::mutex> _lock(m_mtxIdle);
+				m_cvIdle.wait(_lock, [this, nIndex]() { return !m_bRunning || HasRunnable(nIndex); });
+				continue;
+			}
+
+			auto& counters = m_arrCounters[readyTask.eLane];
+			auto ullWaitUs = static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::microseconds>(
+				std::chrono::steady_clock::now() - readyTask.tpEnqueued).count());
+			counters.ullTotalWaitUs += ullWaitUs;
+			auto ullMaxWaitUs = counters.ullMaxWaitUs.load();
+			while (ullWaitUs > ullMaxWaitUs && !counters.ullMaxWaitUs.compare_exchange_weak(ullMaxWaitUs, ullWaitUs))
+			{
+			}
+
+			MCP_TRACE_SET_ID(readyTask.spTask->GetTraceId());
+			MCP_TRACE_SPAN("queue", MCP::CMCPTrace::NowUs() - ullWaitUs);
+			int iErrCode = ERRNO_OK;
+			auto tpStart = std::chrono::steady_clock::now();
+			if (!readyTask.spTask->IsCancelled())
+			{
+				MCP_TRACE_SCOPE("execute");
+				iErrCode = readyTask.spTask->Execute();
+			}
+			auto ullRunUs = static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::microseconds>(
+				std::chrono::steady_clock::now() - tpStart).count());
+			counters.ullExecuted++;
+			if (m_fnOnComplete)
+				m_fnOnComplete(readyTask.spTask, iErrCode, ullWaitUs, ullRunUs);
+			MCP_TRACE_SET_ID(0);
+
+			OnTaskCompleted(readyTask.pGroup);
+		}
+
+		t_pCurrentScheduler = nullptr;
+	}
+}
@@ -0,0 +1,134 @@
+#pragma once
+// To ensure good cross-platform compatibility, the MCP namespace code uses standard C++ only.
+// Avoid using platform-specific system APIs unless absolutely necessary.
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <functional>
+#include <chrono>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "Task.h"
+
+namespace MCP
+{
+	struct TaskLaneStats
+	{
+		size_t nQueued{ 0 };						// tasks ready to run but not picked up yet
+		unsigned long long ullSubmitted{ 0 };
+		unsigned long long ullExecuted{ 0 };
+		unsigned long long ullTotalWaitUs{ 0 };		// sum of enqueue -> start of execution
+		unsigned long long ullMaxWaitUs{ 0 };
+	};
+
+	// Work-stealing scheduler executing asynchronous tasks (tools/call) in parallel.
+	//
+	// Every worker owns one deque per lane. Tasks committed from outside the pool are spread
+	// round-robin over the workers, tasks committed by a worker stay on its own deque, and a
+	// worker that runs dry steals from the others. Lanes are always served in priority order
+	// (control, interactive, bulk) and the first nReservedWorkers workers never run bulk tasks,
+	// so long running tools cannot delay short ones by occupying the whole pool.
+	//
+	// Every task also belongs to a group (the tool name) which may be given a concurrency limit;
+	// tasks beyond the limit wait in the group until a running one of the same group completes.
+	//
+	// Admission control: with a pending limit set, Commit() refuses tasks (ERRNO_SERVER_OVERLOADED)
+	// while that many are queued or waiting in their groups, so an overloaded server answers at
+	// once instead of letting the queues, and with them the latencies, grow without bound.
+	// Control lane tasks are always admitted.
+	class CMCPTaskScheduler
+	{
+	public:
+		// Invoked on the worker thread after a task's Execute() returned, with the time the task waited
+		// in the queue and the time Execute() took.
+		using CompletionCallback = std::function<void(const std::shared_ptr<CMCPTask>& spTask, int iErrCode,
+			unsigned long long ullWaitUs, unsigned long long ullRunUs)>;
+
+		CMCPTaskScheduler() = default;
+		~CMCPTaskScheduler();
+		CMCPTaskScheduler(const CMCPTaskScheduler&) = delete;
+		CMCPTaskScheduler& operator=(const CMCPTaskScheduler&) = delete;
+
+		// nThreads == 0 selects std::thread::hardware_concurrency().
+		// nReservedWorkers is clamped so that at least one worker can run bulk tasks.
+		int Start(size_t nThreads, size_t nReservedWorkers, CompletionCallback fnOnComplete);
+		// Stops accepting tasks, drops the queued ones and joins the workers.
+		int Stop();
+		bool IsRunning() const;
+		size_t GetThreadCount() const;
+
+		// nLimit == 0 means unlimited.
+		void SetGroupLimit(const std::string& strGroup, size_t nLimit);
+		// nMaxPending == 0 means unlimited.
+		void SetPendingLimit(size_t nMaxPending);
+		// Tasks committed and not executing yet.
+		size_t GetPendingCount() const;
+		int Commit(const std::shared_ptr<CMCPTask>& spTask, const std::string& strGroup);
+
+		TaskLaneStats GetLaneStats(TaskLane eLane) const;
+
+	private:
+		struct Group
+		{
+			size_t nLimit{ 0 };
+			size_t nAdmitted{ 0 };	// queued on a lane or executing
+			std::deque<std::shared_ptr<CMCPTask>> deqWaiting;
+		};
+
+		struct ReadyTask
+		{
+			std::shared_ptr<CMCPTask> spTask;
+			Group* pGroup{ nullptr };
+			TaskLane eLane{ TaskLane_Interactive };
+			std::chrono::steady_clock::time_point tpEnqueued;
+		};
+
+		struct WorkerQueue
+		{
+			std::mutex mtxQueue;
+			std::deque<ReadyTask> arrLanes[TaskLane_Count];
+		};
+
+		struct LaneCounters
+		{
+			std::atomic<size_t> nQueued{ 0 };
+			std::atomic<unsigned long long> ullSubmitted{ 0 };
+			std::atomic<unsigned long long> ullExecuted{ 0 };
+			std::atomic<unsigned long long> ullTotalWaitUs{ 0 };
+			std::atomic<unsigned long long> ullMaxWaitUs{ 0 };
+		};
+
+		void WorkerProc(size_t nIndex);
+		bool TryPop(size_t nIndex, ReadyTask& readyTask);
+		bool PopFront(size_t nQueue, TaskLane eLane, ReadyTask& readyTask);
+		bool StealBack(size_t nQueue, TaskLane eLane, ReadyTask& readyTask);
+		bool HasRunnable(size_t nIndex) const;
+		bool CanRunLane(size_t nIndex, TaskLane eLane) const;
+		void Enqueue(ReadyTask&& readyTask);
+		void OnTaskCompleted(Group* pGroup);
+
+		std::atomic_bool m_bRunning{ false };
+		size_t m_nReservedWorkers{ 0 };
+		std::atomic<size_t> m_nNextQueue{ 0 };
+		std::vector<std::unique_ptr<WorkerQueue>> m_vecQueues;
+		std::vector<std::thread> m_vecWorkers;
+		LaneCounters m_arrCounters[TaskLane_Count];
+		std::atomic<size_t> m_nMaxPending{ 0 };
+		// Tasks in the deqWaiting of their group.
+		std::atomic<size_t> m_nWaiting{ 0 };
+		CompletionCallback m_fnOnComplete;
+
+		// Idle workers sleep here until a runnable task is enqueued.
+		mutable std::mutex m_mtxIdle;
+		std::condition_variable m_cvIdle;
+
+		// Guards group bookkeeping. Node-based map, so Group pointers held by ReadyTask stay valid.
+		mutable std::mutex m_mtxGroups;
+		std::unordered_map<std::string, Group> m_hashGroups;
+	};
+}
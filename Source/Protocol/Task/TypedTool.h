@@ -0,0 +1,320 @@
+#pragma once
+// To ensure good cross-platform compatibility, the MCP namespace code uses standard C++ only.
+// Avoid using platform-specific system APIs unless absolutely necessary.
+
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <json/json.h>
+#include "BasicTask.h"
+#include "../Message/Request.h"
+#include "../Message/Response.h"
+
+namespace MCP
+{
+	// Tools declared by the struct of their arguments instead of a schema string and a subclass of
+	// ProcessCallToolRequest:
+	//
+	//     struct EchoArguments
+	//     {
+	//         std::string strInput;
+	//         int iRepeat{ 1 };
+	//
+	//         static auto Arguments()
+	//         {
+	//             return std::make_tuple(
+	//                 MCP::RequiredArgument("input", &EchoArguments::strInput, "client input data"),
+	//                 MCP::OptionalArgument("repeat", &EchoArguments::iRepeat));
+	//         }
+	//     };
+	//
+	//     vecTools.push_back(RegisterTool<EchoArguments>("echo", "Echoes the input.",
+	//         [](EchoArguments& arguments, MCP::CallToolResult& result) { ... return MCP::ERRNO_OK; }));
+	//
+	// The input schema is generated from the member types when the tool is registered, and every call
+	// reads each argument straight into its member, with one lookup. Optional arguments that are absent
+	// keep the value the struct initializes them with.
+
+	// How arguments of type T are described and read; specialized for strings, bool, integers, floating
+	// point numbers, vectors of these, and Json::Value for anything else.
+	template <class T, class Enable = void>
+	struct ArgumentTraits;
+
+	template <>
+	struct ArgumentTraits<std::string>
+	{
+		static void WriteSchema(Json::Value& jSchema) { jSchema[MSG_KEY_TYPE] = "string"; }
+		static bool Read(const Json::Value& jValue, std::string& strValue)
+		{
+			if (!jValue.isString())
+				return false;
+			strValue = jValue.asString();
+			return true;
+		}
+	};
+
+	template <>
+	struct ArgumentTraits<bool>
+	{
+		static void WriteSchema(Json::Value& jSchema) { jSchema[MSG_KEY_TYPE] = "boolean"; }
+		static bool Read(const Json::Value& jValue, bool& bValue)
+		{
+			if (!jValue.isBool())
+				return false;
+			bValue = jValue.asBool();
+			return true;
+		}
+	};
+
+	template <class T>
+	struct ArgumentTraits<T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type>
+	{
+		static void WriteSchema(Json::Value& jSchema) { jSchema[MSG_KEY_TYPE] = "integer"; }
+		static bool Read(const Json::Value& jValue, T& value)
+		{
+			// Out of range values are refused rather than truncated.
+			if (std::is_signed<T>::value)
+			{
+				if (!jValue.isInt64())
+					return false;
+				Json::Int64 llValue = jValue.asInt64();
+				if (llValue < static_cast<Json::Int64>(std::numeric_limits<T>::min())
+					|| llValue > static_cast<Json::Int64>(std::numeric_limits<T>::max()))
+					return false;
+				value = static_cast<T>(llValue);
+				return true;
+			}
+			if (!jValue.isUInt64())
+				return false;
+			Json::UInt64 ullValue = jValue.asUInt64();
+			if (ullValue > static_cast<Json::UInt64>(std::numeric_limits<T>::max()))
+				return false;
+			value = static_cast<T>(ullValue);
+			return true;
+		}
+	};
+
+	template <class T>
+	struct ArgumentTraits<T, typename std::enable_if<std::is_floating_point<T>::value>::type>
+	{
+		static void WriteSchema(Json::Value& jSchema) { jSchema[MSG_KEY_TYPE] = "number"; }
+		static bool Read(const Json::Value& jValue, T& value)
+		{
+			if (!jValue.isNumeric() || jValue.isBool())
+				return false;
+			value = static_cast<T>(jValue.asDouble());
+			return true;
+		}
+	};
+
+	template <class T>
+	struct ArgumentTraits<std::vector<T>>
+	{
+		static void WriteSchema(Json::Value& jSchema)
+		{
+			jSchema[MSG_KEY_TYPE] = "array";
+			Json::Value jItems(Json::objectValue);
+			ArgumentTraits<T>::WriteSchema(jItems);
+			jSchema["items"] = std::move(jItems);
+		}
+		static bool Read(const Json::Value& jValue, std::vector<T>& vecValue)
+		{
+			if (!jValue.isArray())
+				return false;
+			vecValue.clear();
+			vecValue.resize(jValue.size());
+			for (Json::ArrayIndex i = 0; i < jValue.size(); ++i)
+			{
+				if (!ArgumentTraits<T>::Read(jValue[i], vecValue[i]))
+					return false;
+			}
+			return true;
+		}
+	};
+
+	// Any JSON value, for arguments without a fixed shape.
+	template <>
+	struct ArgumentTraits<Json::Value>
+	{
+		static void WriteSchema(Json::Value&) {}
+		static bool Read(const Json::Value& jValue, Json::Value& jOut)
+		{
+			jOut = jValue;
+			return true;
+		}
+	};
+
+	// One member of an arguments struct; made with RequiredArgument() or OptionalArgument().
+	template <class Args, class T>
+	struct ToolArgument
+	{
+		using ValueType = T;
+
+		const char* lpcszName;
+		T Args::* pMember;
+		const char* lpcszDescription;
+		bool bRequired;
+	};
+
+	// lpcszName and lpcszDescription must be literals, or otherwise outlive the tool.
+	template <class Args, class T>
+	ToolArgument<Args, T> RequiredArgument(const char* lpcszName, T Args::* pMember, const char* lpcszDescription = nullptr)
+	{
+		return ToolArgument<Args, T>{ lpcszName, pMember, lpcszDescription, true };
+	}
+
+	template <class Args, class T>
+	ToolArgument<Args, T> OptionalArgument(const char* lpcszName, T Args::* pMember, const char* lpcszDescription = nullptr)
+	{
+		return ToolArgument<Args, T>{ lpcszName, pMember, lpcszDescription, false };
+	}
+
+	namespace TypedTool
+	{
+		template <class Tuple, class Fn, size_t... I>
+		void ForEachArgument(const Tuple& tupleArguments, Fn&& fn, std::index_sequence<I...>)
+		{
+			int arrExpand[] = { 0, (fn(std::get<I>(tupleArguments)), 0)... };
+			(void)arrExpand;
+		}
+
+		template <class Args, class Fn>
+		void ForEachArgument(Fn&& fn)
+		{
+			auto tupleArguments = Args::Arguments();
+			ForEachArgument(tupleArguments, std::forward<Fn>(fn),
+				std::make_index_sequence<std::tuple_size<decltype(tupleArguments)>::value>());
+		}
+	}
+
+	// The input schema of a tool taking Args, built from the argument descriptions without parsing text.
+	template <class Args>
+	Json::Value BuildInputSchema()
+	{
+		Json::Value jSchema(Json::objectValue);
+		jSchema[MSG_KEY_TYPE] = "object";
+		Json::Value jProperties(Json::objectValue);
+		Json::Value jRequired(Json::arrayValue);
+		TypedTool::ForEachArgument<Args>([&](const auto& argument)
+			{
+				using ValueType = typename std::decay<decltype(argument)>::type::ValueType;
+				Json::Value jProperty(Json::objectValue);
+				ArgumentTraits<ValueType>::WriteSchema(jProperty);
+				if (argument.lpcszDescription)
+					jProperty[MSG_KEY_DESCRIPTION] = argument.lpcszDescription;
+				jProperties[argument.lpcszName] = std::move(jProperty);
+				if (argument.bRequired)
+					jRequired.append(argument.lpcszName);
+			});
+		jSchema["properties"] = std::move(jProperties);
+		if (!jRequired.empty())
+			jSchema[MSG_KEY_REQUIRED] = std::move(jRequired);
+
+		return jSchema;
+	}
+
+	// Reads the arguments of a call into args; strError names the first argument missing or of the
+	// wrong type. Arguments not described by Args are ignored.
+	template <class Args>
+	bool BindArguments(const Json::Value& jArguments, Args& args, std::string& strError)
+	{
+		bool bBound = true;
+		TypedTool::ForEachArgument<Args>([&](const auto& argument)
+			{
+				using ValueType = typename std::decay<decltype(argument)>::type::ValueType;
+				if (!bBound)
+					return;
+				const Json::Value* pjValue = jArguments.isObject()
+					? jArguments.find(argument.lpcszName, argument.lpcszName + strlen(argument.lpcszName)) : nullptr;
+				if (!pjValue || pjValue->isNull())
+				{
+					if (!argument.bRequired)
+						return;
+					bBound = false;
+					strError = std::string("missing argument: ") + argument.lpcszName;
+					return;
+				}
+				if (!ArgumentTraits<ValueType>::Read(*pjValue, args.*(argument.pMember)))
+				{
+					bBound = false;
+					strError = std::string("invalid argument: ") + argument.lpcszName;
+				}
+			});
+
+		return bBound;
+	}
+
+	// The task serving a tool registered with CMCPServer::RegisterTool(): binds the arguments and calls
+	// fn(Args&, CallToolResult&) on a task worker; the arguments belong to the call, so fn may move
+	// them into the result. An error returned by fn, or arguments that
+	// cannot be bound, answer the call with an error result.
+	template <class Args, class Fn>
+	class ProcessTypedCallToolRequest : public ProcessCallToolRequest
+	{
+	public:
+		ProcessTypedCallToolRequest(const std::shared_ptr<MCP::Request>& spRequest, const std::shared_ptr<const Fn>& spFn)
+			: ProcessCallToolRequest(spRequest)
+			, m_spFn(spFn)
+		{
+
+		}
+
+		std::shared_ptr<CMCPTask> Clone() const override
+		{
+			auto spClone = std::make_shared<ProcessTypedCallToolRequest>(nullptr, m_spFn);
+			if (spClone)
+			{
+				*spClone = *this;
+			}
+
+			return spClone;
+		}
+
+		int Execute() override
+		{
+			if (!IsValid() || !m_spFn)
+				return ERRNO_INTERNAL_ERROR;
+			auto spCallToolRequest = std::dynamic_pointer_cast<MCP::CallToolRequest>(m_spRequest);
+			auto spExecuteResult = BuildResult();
+			if (!spCallToolRequest || !spExecuteResult)
+				return ERRNO_INTERNAL_ERROR;
+
+			Args args;
+			std::string strError;
+			int iErrCode = ERRNO_INVALID_PARAMS;
+			if (BindArguments(spCallToolRequest->jArguments, args, strError))
+				iErrCode = (*m_spFn)(args, *spExecuteResult);
+			if (ERRNO_OK != iErrCode)
+			{
+				spExecuteResult->bIsError = true;
+				if (!strError.empty())
+				{
+					spExecuteResult->AddText(std::move(strError));
+				}
+				else if (spExecuteResult->vecTextContent.empty() && spExecuteResult->vecImageContent.empty()
+					&& spExecuteResult->vecEmbeddedResource.empty())
+				{
+					auto& textContent = spExecuteResult->AddText(u8"Unfortunately, the execution failed.");
+					textContent.strText += u8"Error code:";
+					textContent.strText += std::to_string(iErrCode);
+				}
+			}
+
+			return NotifyResult(std::move(spExecuteResult));
+		}
+
+		int Cancel() override
+		{
+			return ERRNO_OK;
+		}
+
+	private:
+		// Shared by the prototype and its clones.
+		std::shared_ptr<const Fn> m_spFn;
+	};
+}
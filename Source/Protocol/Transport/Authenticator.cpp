@@ -0,0 +1,285 @@
+#include "Authenticator.h"
+#include "../Message/JsonParser.h"
+#include "../Public/Base64.h"
+#include "../Public/Config.h"
+#include "../Public/PublicDef.h"
+#include <algorithm>
+#include <chrono>
+#include <functional>
+
+namespace MCP
+{
+	static const char s_szBearerPrefix[] = "Bearer ";
+	static const char s_szApiKeyPrincipalPrefix[] = "api_key:";
+	// Bytes of the digest of an API key naming its holder.
+	static constexpr size_t API_KEY_PRINCIPAL_BYTES = 8;
+
+	static void HashToken(const std::string& strToken, std::array<unsigned char, Sha256::DIGEST_SIZE>& arrDigest)
+	{
+		unsigned char arrHash[Sha256::DIGEST_SIZE];
+		Sha256::Hash(strToken.data(), strToken.size(), arrHash);
+		std::copy(arrHash, arrHash + Sha256::DIGEST_SIZE, arrDigest.begin());
+	}
+
+	// A NumericDate claim in milliseconds; false when absent, true with bValid=false when malformed.
+	static bool GetTimeClaim(const Json::Value& jPayload, const char* lpcszClaim, unsigned long long& ullMs, bool& bValid)
+	{
+		bValid = true;
+		if (!jPayload.isMember(lpcszClaim))
+			return false;
+		const Json::Value& jClaim = jPayload[lpcszClaim];
+		if (!jClaim.isNumeric() || jClaim.asDouble() < 0)
+		{
+			bValid = false;
+			return true;
+		}
+		ullMs = static_cast<unsigned long long>(jClaim.asDouble() * 1000);
+
+		return true;
+	}
+
+	CMCPAuthenticator::CMCPAuthenticator()
+		: m_spSettings(std::make_shared<Settings>())
+	{
+	}
+
+	CMCPAuthenticator::~CMCPAuthenticator() = default;
+
+	void CMCPAuthenticator::Configure(const std::string& strExtraKey)
+	{
+		auto& config = Config::GetInstance();
+		auto spSettings = std::make_shared<Settings>();
+		spSettings->bEnabled = config.IsAuthEnabled() || !strExtraKey.empty();
+
+		std::vector<std::string> vecKeys;
+		if (!strExtraKey.empty())
+			vecKeys.push_back(strExtraKey);
+		std::string strKeys = config.GetApiKey();
+		size_t nBegin = 0;
+		while (nBegin <= strKeys.size())
+		{
+			size_t nEnd = strKeys.find(',', nBegin);
+			if (std::string::npos == nEnd)
+				nEnd = strKeys.size();
+			std::string strKey = strKeys.substr(nBegin, nEnd - nBegin);
+			strKey.erase(0, strKey.find_first_not_of(" \t"));
+			strKey.erase(strKey.find_last_not_of(" \t") + 1);
+			if (!strKey.empty())
+				vecKeys.push_back(strKey);
+			nBegin = nEnd + 1;
+		}
+		for (auto& strKey : vecKeys)
+		{
+			spSettings->vecKeyDigests.emplace_back();
+			HashToken(strKey, spSettings->vecKeyDigests.back());
+		}
+
+		spSettings->strJwtSecret = config.GetJwtSecret();
+		spSettings->strJwtIssuer = config.GetJwtIssuer();
+		spSettings->strJwtAudience = config.GetJwtAudience();
+		int iClockSkewS = config.GetJwtClockSkew();
+		spSettings->ullClockSkewMs = iClockSkewS > 0 ? static_cast<unsigned long long>(iClockSkewS) * 1000 : 0;
+		int iCacheTtlS = config.GetTokenCacheTtl();
+		spSettings->ullCacheTtlMs = iCacheTtlS > 0 ? static_cast<unsigned long long>(iCacheTtlS) * 1000 : 0;
+		int iCacheSize = config.GetTokenCacheSize();
+		spSettings->nCacheEntriesPerShard = iCacheSize > 0 ? (static_cast<size_t>(iCacheSize) + CACHE_SHARDS - 1) / CACHE_SHARDS : 0;
+
+		{
+			std::lock_guard<std::mutex> _lock(m_mtxSettings);
+			m_spSettings = spSettings;
+			m_bEnabled = spSettings->bEnabled;
+			// Entries verified under the previous settings no longer match the generation.
+			++m_uGeneration;
+		}
+		for (auto& shard : m_arrCache)
+		{
+			std::lock_guard<std::mutex> _lock(shard.mtxShard);
+			shard.hashTokens.clear();
+		}
+	}
+
+	bool CMCPAuthenticator::IsEnabled() const
+	{
+		return m_bEnabled.load(std::memory_order_relaxed);
+	}
+
+	unsigned int CMCPAuthenticator::GetGeneration() const
+	{
+		return m_uGeneration.load(std::memory_order_acquire);
+	}
+
+	int CMCPAuthenticator::Authenticate(const std::string& strAuthorization, AuthResult& result)
+	{
+		const size_t nPrefix = sizeof(s_szBearerPrefix) - 1;
+		if (strAuthorization.size() <= nPrefix || 0 != strAuthorization.compare(0, nPrefix, s_szBearerPrefix))
+			return ERRNO_UNAUTHORIZED;
+		std::string strToken = strAuthorization.substr(nPrefix);
+
+		unsigned int uGeneration = 0;
+		auto spSettings = GetSettings(uGeneration);
+		auto ullNowMs = NowMs();
+		auto& shard = GetCacheShard(strToken);
+		{
+			std::lock_guard<std::mutex> _lock(shard.mtxShard);
+			auto itrEntry = shard.hashTokens.find(strToken);
+			if (itrEntry != shard.hashTokens.end())
+			{
+				if (itrEntry->second.uGeneration == uGeneration && itrEntry->second.result.ullExpiresAtMs > ullNowMs)
+				{
+					result = itrEntry->second.result;
+					return ERRNO_OK;
+				}
+				shard.hashTokens.erase(itrEntry);
+			}
+		}
+
+		int iErrCode = ERRNO_UNAUTHORIZED;
+		std::string strKeyPrincipal;
+		if (CheckApiKey(*spSettings, strToken, strKeyPrincipal))
+		{
+			result.strPrincipal = std::move(strKeyPrincipal);
+			result.ullExpiresAtMs = ullNowMs + spSettings->ullCacheTtlMs;
+			iErrCode = ERRNO_OK;
+		}
+		else if (!spSettings->strJwtSecret.empty() && 2 == std::count(strToken.begin(), strToken.end(), '.'))
+		{
+			iErrCode = VerifyJwt(*spSettings, strToken, ullNowMs, result);
+		}
+		if (ERRNO_OK != iErrCode || 0 == spSettings->nCacheEntriesPerShard || result.ullExpiresAtMs <= ullNowMs)
+			return iErrCode;
+
+		std::lock_guard<std::mutex> _lock(shard.mtxShard);
+		if (shard.hashTokens.size() >= spSettings->nCacheEntriesPerShard)
+		{
+			// Expired entries go first; a shard full of live ones gives up an arbitrary entry.
+			for (auto itrEntry = shard.hashTokens.begin(); itrEntry != shard.hashTokens.end();)
+			{
+				if (itrEntry->second.result.ullExpiresAtMs <= ullNowMs || itrEntry->second.uGeneration != uGeneration)
+					itrEntry = shard.hashTokens.erase(itrEntry);
+				else
+					++itrEntry;
+			}
+			if (shard.hashTokens.size() >= spSettings->nCacheEntriesPerShard)
+				shard.hashTokens.erase(shard.hashTokens.begin());
+		}
+		auto& entry = shard.hashTokens[strToken];
+		entry.result = result;
+		entry.uGeneration = uGeneration;
+
+		return ERRNO_OK;
+	}
+
+	unsigned long long CMCPAuthenticator::NowMs()
+	{
+		return static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::system_clock::now().time_since_epoch()).count());
+	}
+
+	std::shared_ptr<const CMCPAuthenticator::Settings> CMCPAuthenticator::GetSettings(unsigned int& uGeneration) const
+	{
+		std::lock_guard<std::mutex> _lock(m_mtxSettings);
+		uGeneration = m_uGeneration.load(std::memory_order_relaxed);
+
+		return m_spSettings;
+	}
+
+	bool CMCPAuthenticator::CheckApiKey(const Settings& settings, const std::string& strToken, std::string& strPrincipal) const
+	{
+		// Comparing digests keeps the length of the keys out of the timing as well.
+		std::array<unsigned char, Sha256::DIGEST_SIZE> arrDigest;
+		HashToken(strToken, arrDigest);
+		bool bMatched = false;
+		for (auto& arrKeyDigest : settings.vecKeyDigests)
+		{
+			bMatched |= Sha256::ConstantTimeEqual(arrDigest.data(), arrKeyDigest.data(), Sha256::DIGEST_SIZE);
+		}
+		if (!bMatched)
+			return false;
+
+		// Holders of different keys are different principals, and must not share sessions.
+		static const char s_szHexDigits[] = "0123456789abcdef";
+		strPrincipal = s_szApiKeyPrincipalPrefix;
+		for (size_t i = 0; i < API_KEY_PRINCIPAL_BYTES; ++i)
+		{
+			strPrincipal.push_back(s_szHexDigits[arrDigest[i] >> 4]);
+			strPrincipal.push_back(s_szHexDigits[arrDigest[i] & 0x0f]);
+		}
+
+		return true;
+	}
+
+	int CMCPAuthenticator::VerifyJwt(const Settings& settings, const std::string& strToken, unsigned long long ullNowMs, AuthResult& result) const
+	{
+		size_t nFirstDot = strToken.find('.');
+		size_t nSecondDot = strToken.find('.', nFirstDot + 1);
+
+		// The signature before anything else: nothing of an unsigned token is parsed beyond its header.
+		std::string strHeader;
+		std::string strSignature;
+		if (!Base64::DecodeUrl(strToken.data(), nFirstDot, strHeader)
+			|| !Base64::DecodeUrl(strToken.data() + nSecondDot + 1, strToken.size() - nSecondDot - 1, strSignature)
+			|| Sha256::DIGEST_SIZE != strSignature.size())
+			return ERRNO_UNAUTHORIZED;
+
+		CMCPJsonParser parser;
+		Json::Value jHeader;
+		if (!parser.Parse(strHeader, jHeader) || !jHeader.isObject()
+			|| !jHeader["alg"].isString() || jHeader["alg"].asString() != "HS256")
+			return ERRNO_UNAUTHORIZED;
+
+		unsigned char arrExpected[Sha256::DIGEST_SIZE];
+		Sha256::Hmac(settings.strJwtSecret.data(), settings.strJwtSecret.size(), strToken.data(), nSecondDot, arrExpected);
+		if (!Sha256::ConstantTimeEqual(arrExpected, reinterpret_cast<const unsigned char*>(strSignature.data()), Sha256::DIGEST_SIZE))
+			return ERRNO_UNAUTHORIZED;
+
+		std::string strPayload;
+		Json::Value jPayload;
+		if (!Base64::DecodeUrl(strToken.data() + nFirstDot + 1, nSecondDot - nFirstDot - 1, strPayload)
+			|| !parser.Parse(strPayload, jPayload) || !jPayload.isObject())
+			return ERRNO_UNAUTHORIZED;
+
+		bool bValid = true;
+		unsigned long long ullExpiresAtMs = ullNowMs + settings.ullCacheTtlMs;
+		unsigned long long ullClaimMs = 0;
+		if (GetTimeClaim(jPayload, "exp", ullClaimMs, bValid))
+		{
+			if (!bValid || ullClaimMs + settings.ullClockSkewMs <= ullNowMs)
+				return ERRNO_UNAUTHORIZED;
+			ullExpiresAtMs = (std::min)(ullExpiresAtMs, ullClaimMs + settings.ullClockSkewMs);
+		}
+		if (GetTimeClaim(jPayload, "nbf", ullClaimMs, bValid))
+		{
+			if (!bValid || ullClaimMs > ullNowMs + settings.ullClockSkewMs)
+				return ERRNO_UNAUTHORIZED;
+		}
+		if (!settings.strJwtIssuer.empty())
+		{
+			const Json::Value& jIssuer = jPayload["iss"];
+			if (!jIssuer.isString() || jIssuer.asString() != settings.strJwtIssuer)
+				return ERRNO_UNAUTHORIZED;
+		}
+		if (!settings.strJwtAudience.empty())
+		{
+			// A single string or an array of them.
+			const Json::Value& jAudience = jPayload["aud"];
+			bool bAudience = jAudience.isString() && jAudience.asString() == settings.strJwtAudience;
+			for (Json::ArrayIndex i = 0; !bAudience && jAudience.isArray() && i < jAudience.size(); ++i)
+			{
+				bAudience = jAudience[i].isString() && jAudience[i].asString() == settings.strJwtAudience;
+			}
+			if (!bAudience)
+				return ERRNO_UNAUTHORIZED;
+		}
+
+		const Json::Value& jSubject = jPayload["sub"];
+		result.strPrincipal = jSubject.isString() && !jSubject.asString().empty() ? jSubject.asString() : "jwt";
+		result.ullExpiresAtMs = ullExpiresAtMs;
+
+		return ERRNO_OK;
+	}
+
+	CMCPAuthenticator::CacheShard& CMCPAuthenticator::GetCacheShard(const std::string& strToken)
+	{
+		return m_arrCache[std::hash<std::string>()(strToken) % CACHE_SHARDS];
+	}
+}
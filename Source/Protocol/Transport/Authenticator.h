@@ -0,0 +1,91 @@
+#pragma once
+// To ensure good cross-platform compatibility, the MCP namespace code uses standard C++ only.
+// Avoid using platform-specific system APIs unless absolutely necessary.
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../Public/Sha256.h"
+
+namespace MCP
+{
+	struct AuthResult
+	{
+		// "api_key:" and the first 16 hex digits of the SHA-256 digest of the key for an API key, the
+		// sub claim (or "jwt") for a JWT.
+		std::string strPrincipal;
+		// Milliseconds since the epoch after which the credentials must be checked again.
+		unsigned long long ullExpiresAtMs{ 0 };
+	};
+
+	// Checks the bearer tokens of [auth]: API keys, and JWTs signed with HS256 when jwt_secret is set.
+	//
+	// API keys are compared by their SHA-256 digests in constant time, against every configured key,
+	// so neither the position of the first difference nor the matching key shows in the timing.
+	// Verified tokens are remembered in a sharded cache until token_cache_ttl_s (or a JWT's exp)
+	// passes, so a token costs a hash lookup after its first use; transports add a cache of their own
+	// per connection on top. Failures are not cached. Thread safe.
+	class CMCPAuthenticator
+	{
+	public:
+		CMCPAuthenticator();
+		~CMCPAuthenticator();
+		CMCPAuthenticator(const CMCPAuthenticator&) = delete;
+		CMCPAuthenticator& operator=(const CMCPAuthenticator&) = delete;
+
+		// Reads [auth] from the current configuration and forgets the cached tokens; strExtraKey (e.g.
+		// set by the application) is accepted as one more API key and enables authentication.
+		void Configure(const std::string& strExtraKey);
+		bool IsEnabled() const;
+		// Changes with every Configure(): results obtained under another generation are stale.
+		unsigned int GetGeneration() const;
+
+		// strAuthorization is the value of the Authorization header. ERRNO_OK, or ERRNO_UNAUTHORIZED.
+		int Authenticate(const std::string& strAuthorization, AuthResult& result);
+
+		static unsigned long long NowMs();
+
+	private:
+		struct Settings
+		{
+			bool bEnabled{ false };
+			std::vector<std::array<unsigned char, Sha256::DIGEST_SIZE>> vecKeyDigests;
+			std::string strJwtSecret;
+			std::string strJwtIssuer;
+			std::string strJwtAudience;
+			unsigned long long ullClockSkewMs{ 0 };
+			unsigned long long ullCacheTtlMs{ 0 };
+			size_t nCacheEntriesPerShard{ 0 };
+		};
+
+		struct CacheEntry
+		{
+			AuthResult result;
+			unsigned int uGeneration{ 0 };
+		};
+
+		struct CacheShard
+		{
+			std::mutex mtxShard;
+			std::unordered_map<std::string, CacheEntry> hashTokens;
+		};
+
+		static constexpr size_t CACHE_SHARDS = 16;
+
+		std::shared_ptr<const Settings> GetSettings(unsigned int& uGeneration) const;
+		// Sets strPrincipal when strToken is one of the keys.
+		bool CheckApiKey(const Settings& settings, const std::string& strToken, std::string& strPrincipal) const;
+		int VerifyJwt(const Settings& settings, const std::string& strToken, unsigned long long ullNowMs, AuthResult& result) const;
+		CacheShard& GetCacheShard(const std::string& strToken);
+
+		mutable std::mutex m_mtxSettings;
+		std::shared_ptr<const Settings> m_spSettings;
+		std::atomic_bool m_bEnabled{ false };
+		std::atomic<unsigned int> m_uGeneration{ 0 };
+		CacheShard m_arrCache[CACHE_SHARDS];
+	};
+}
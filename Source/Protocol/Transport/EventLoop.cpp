@@ -0,0 +1,463 @@
+#include "EventLoop.h"
+#include "IoUring.h"
+#include "../Public/PublicDef.h"
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#define MCP_EVENT_LOOP_EPOLL
+#ifdef TINYMCP_WITH_IO_URING
+#define MCP_EVENT_LOOP_IO_URING
+#endif
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || defined(__NetBSD__)
+#include <sys/types.h>
+#include <sys/event.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#define MCP_EVENT_LOOP_KQUEUE
+#endif
+
+namespace MCP
+{
+#ifndef MCP_EVENT_LOOP_IO_URING
+	// Never instantiated; completes the type for the member of CMCPEventLoop.
+	class CMCPIoUring
+	{
+	public:
+		int Add(int /*iFd*/, unsigned int /*nEvents*/, CMCPEventLoop::EventHandler /*fnHandler*/, CMCPEventLoop::DataHandler /*fnOnData*/) { return ERRNO_INTERNAL_ERROR; }
+		int Modify(int /*iFd*/, unsigned int /*nEvents*/) { return ERRNO_INTERNAL_ERROR; }
+		int Remove(int /*iFd*/) { return ERRNO_INTERNAL_ERROR; }
+		int RunOnce(int /*iTimeoutMs*/) { return ERRNO_INTERNAL_ERROR; }
+	};
+#endif
+
+	static constexpr int MAX_EVENTS_PER_WAIT = 256;
+
+	CMCPEventLoop::CMCPEventLoop() = default;
+
+	CMCPEventLoop::~CMCPEventLoop()
+	{
+		Close();
+	}
+
+#if defined(MCP_EVENT_LOOP_EPOLL)
+	int CMCPEventLoop::Open(bool bTryIoUring)
+	{
+		if (m_iPollFd >= 0 || m_upIoUring)
+			return ERRNO_OK;
+
+#ifdef MCP_EVENT_LOOP_IO_URING
+		if (bTryIoUring)
+			m_upIoUring = CMCPIoUring::Create();
+		if (m_upIoUring)
+		{
+			m_arrWakeupFds[0] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+			if (m_arrWakeupFds[0] < 0 || ERRNO_OK != m_upIoUring->Add(m_arrWakeupFds[0], EventFlags_Read, [this](int, unsigned int) { DrainWakeup(); }, nullptr))
+			{
+				Close();
+				return ERRNO_INTERNAL_ERROR;
+			}
+
+			return ERRNO_OK;
+		}
+#else
+		(void)bTryIoUring;
+#endif
+
+		m_iPollFd = epoll_create1(EPOLL_CLOEXEC);
+		if (m_iPollFd < 0)
+			return ERRNO_INTERNAL_ERROR;
+		m_arrWakeupFds[0] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if (m_arrWakeupFds[0] < 0)
+		{
+			Close();
+			return ERRNO_INTERNAL_ERROR;
+		}
+
+		struct epoll_event ev{};
+		ev.events = EPOLLIN;
+		ev.data.fd = m_arrWakeupFds[0];
+		if (0 != epoll_ctl(m_iPollFd, EPOLL_CTL_ADD, m_arrWakeupFds[0], &ev))
+		{
+			Close();
+			return ERRNO_INTERNAL_ERROR;
+		}
+
+		return ERRNO_OK;
+	}
+
+	static unsigned int ToEpollEvents(unsigned int nEvents)
+	{
+		unsigned int nEpollEvents = EPOLLRDHUP;
+		if (nEvents & CMCPEventLoop::EventFlags_Read)
+			nEpollEvents |= EPOLLIN;
+		if (nEvents & CMCPEventLoop::EventFlags_Write)
+			nEpollEvents |= EPOLLOUT;
+
+		return nEpollEvents;
+	}
+
+	int CMCPEventLoop::Add(int iFd, unsigned int nEvents, EventHandler fnHandler)
+	{
+		if (m_upIoUring)
+			return m_upIoUring->Add(iFd, nEvents, std::move(fnHandler), nullptr);
+
+		struct epoll_event ev{};
+		ev.events = ToEpollEvents(nEvents);
+		ev.data.fd = iFd;
+		if (0 != epoll_ctl(m_iPollFd, EPOLL_CTL_ADD, iFd, &ev))
+			return ERRNO_INTERNAL_ERROR;
+		m_hashHandlers[iFd] = std::make_shared<EventHandler>(std::move(fnHandler));
+
+		return ERRNO_OK;
+	}
+
+	int CMCPEventLoop::Modify(int iFd, unsigned int nEvents)
+	{
+		if (m_upIoUring)
+			return m_upIoUring->Modify(iFd, nEvents);
+
+		struct epoll_event ev{};
+		ev.events = ToEpollEvents(nEvents);
+		ev.data.fd = iFd;
+		if (0 != epoll_ctl(m_iPollFd, EPOLL_CTL_MOD, iFd, &ev))
+			return ERRNO_INTERNAL_ERROR;
+
+		return ERRNO_OK;
+	}
+
+	int CMCPEventLoop::Remove(int iFd)
+	{
+		if (m_upIoUring)
+			return m_upIoUring->Remove(iFd);
+
+		m_hashHandlers.erase(iFd);
+		if (0 != epoll_ctl(m_iPollFd, EPOLL_CTL_DEL, iFd, nullptr))
+			return ERRNO_INTERNAL_ERROR;
+
+		return ERRNO_OK;
+	}
+
+	void CMCPEventLoop::Wakeup()
+	{
+		uint64_t ullOne = 1;
+		ssize_t nWritten = write(m_arrWakeupFds[0], &ullOne, sizeof(ullOne));
+		(void)nWritten;
+	}
+
+	void CMCPEventLoop::DrainWakeup()
+	{
+		uint64_t ullCount = 0;
+		ssize_t nRead = read(m_arrWakeupFds[0], &ullCount, sizeof(ullCount));
+		(void)nRead;
+	}
+#elif defined(MCP_EVENT_LOOP_KQUEUE)
+	int CMCPEventLoop::Open(bool /*bTryIoUring*/)
+	{
+		if (m_iPollFd >= 0)
+			return ERRNO_OK;
+
+		m_iPollFd = kqueue();
+		if (m_iPollFd < 0)
+			return ERRNO_INTERNAL_ERROR;
+		if (0 != pipe(m_arrWakeupFds))
+		{
+			Close();
+			return ERRNO_INTERNAL_ERROR;
+		}
+		for (int iFd : m_arrWakeupFds)
+		{
+			fcntl(iFd, F_SETFL, fcntl(iFd, F_GETFL) | O_NONBLOCK);
+			fcntl(iFd, F_SETFD, FD_CLOEXEC);
+		}
+
+		struct kevent ev;
+		EV_SET(&ev, m_arrWakeupFds[0], EVFILT_READ, EV_ADD, 0, 0, nullptr);
+		if (0 != kevent(m_iPollFd, &ev, 1, nullptr, 0, nullptr))
+		{
+			Close();
+			return ERRNO_INTERNAL_ERROR;
+		}
+
+		return ERRNO_OK;
+	}
+
+	// kqueue has one filter per direction, so the interest set is applied as two changes.
+	static int ApplyKqueueEvents(int iPollFd, int iFd, unsigned int nEvents)
+	{
+		struct kevent arrChanges[2];
+		EV_SET(&arrChanges[0], iFd, EVFILT_READ, (nEvents & CMCPEventLoop::EventFlags_Read) ? EV_ADD | EV_ENABLE : EV_ADD | EV_DISABLE, 0, 0, nullptr);
+		EV_SET(&arrChanges[1], iFd, EVFILT_WRITE, (nEvents & CMCPEventLoop::EventFlags_Write) ? EV_ADD | EV_ENABLE : EV_ADD | EV_DISABLE, 0, 0, nullptr);
+		if (0 != kevent(iPollFd, arrChanges, 2, nullptr, 0, nullptr))
+			return ERRNO_INTERNAL_ERROR;
+
+		return ERRNO_OK;
+	}
+
+	int CMCPEventLoop::Add(int iFd, unsigned int nEvents, EventHandler fnHandler)
+	{
+		if (ERRNO_OK != ApplyKqueueEvents(m_iPollFd, iFd, nEvents))
+			return ERRNO_INTERNAL_ERROR;
+		m_hashHandlers[iFd] = std::make_shared<EventHandler>(std::move(fnHandler));
+
+		return ERRNO_OK;
+	}
+
+	int CMCPEventLoop::Modify(int iFd, unsigned int nEvents)
+	{
+		return ApplyKqueueEvents(m_iPollFd, iFd, nEvents);
+	}
+
+	int CMCPEventLoop::Remove(int iFd)
+	{
+		m_hashHandlers.erase(iFd);
+		struct kevent arrChanges[2];
+		EV_SET(&arrChanges[0], iFd, EVFILT_READ, EV_DELETE, 0, 0, nullptr);
+		EV_SET(&arrChanges[1], iFd, EVFILT_WRITE, EV_DELETE, 0, 0, nullptr);
+		kevent(m_iPollFd, arrChanges, 2, nullptr, 0, nullptr);
+
+		return ERRNO_OK;
+	}
+
+	void CMCPEventLoop::Wakeup()
+	{
+		char chOne = 1;
+		ssize_t nWritten = write(m_arrWakeupFds[1], &chOne, 1);
+		(void)nWritten;
+	}
+
+	void CMCPEventLoop::DrainWakeup()
+	{
+		char szBuffer[64];
+		while (read(m_arrWakeupFds[0], szBuffer, sizeof(szBuffer)) > 0)
+		{
+		}
+	}
+#else
+	int CMCPEventLoop::Open(bool /*bTryIoUring*/)
+	{
+		return ERRNO_INTERNAL_ERROR;
+	}
+
+	int CMCPEventLoop::Add(int /*iFd*/, unsigned int /*nEvents*/, EventHandler /*fnHandler*/)
+	{
+		return ERRNO_INTERNAL_ERROR;
+	}
+
+	int CMCPEventLoop::Modify(int /*iFd*/, unsigned int /*nEvents*/)
+	{
+		return ERRNO_INTERNAL_ERROR;
+	}
+
+	int CMCPEventLoop::Remove(int /*iFd*/)
+	{
+		return ERRNO_INTERNAL_ERROR;
+	}
+
+	void CMCPEventLoop::Wakeup()
+	{
+	}
+
+	void CMCPEventLoop::DrainWakeup()
+	{
+	}
+#endif
+
+	void CMCPEventLoop::Close()
+	{
+		m_upIoUring.reset();
+#if defined(MCP_EVENT_LOOP_EPOLL) || defined(MCP_EVENT_LOOP_KQUEUE)
+		for (int& iFd : m_arrWakeupFds)
+		{
+			if (iFd >= 0)
+				close(iFd);
+			iFd = -1;
+		}
+		if (m_iPollFd >= 0)
+			close(m_iPollFd);
+#endif
+		m_iPollFd = -1;
+		m_hashHandlers.clear();
+	}
+
+	const char* CMCPEventLoop::GetBackendName() const
+	{
+#if defined(MCP_EVENT_LOOP_EPOLL)
+		return m_upIoUring ? "io_uring" : "epoll";
+#elif defined(MCP_EVENT_LOOP_KQUEUE)
+		return "kqueue";
+#else
+		return "none";
+#endif
+	}
+
+	int CMCPEventLoop::AddReceiver(int iFd, unsigned int nEvents, EventHandler fnHandler, DataHandler fnOnData)
+	{
+		if (m_upIoUring)
+			return m_upIoUring->Add(iFd, nEvents, std::move(fnHandler), std::move(fnOnData));
+
+		return Add(iFd, nEvents, std::move(fnHandler));
+	}
+
+	bool CMCPEventLoop::ReceivesData() const
+	{
+		return static_cast<bool>(m_upIoUring);
+	}
+
+	void CMCPEventLoop::Post(Task fnTask)
+	{
+		{
+			std::unique_lock<std::mutex> _lock(m_mtxTasks);
+			m_vecTasks.push_back(std::move(fnTask));
+		}
+		Wakeup();
+	}
+
+	void CMCPEventLoop::SetTickHandler(unsigned int nIntervalMs, Task fnTick)
+	{
+		m_nTickIntervalMs = nIntervalMs;
+		m_fnTick = std::move(fnTick);
+		m_tpNextTick = std::chrono::steady_clock::now() + std::chrono::milliseconds(nIntervalMs);
+	}
+
+	void CMCPEventLoop::RunPostedTasks()
+	{
+		std::vector<Task> vecTasks;
+		{
+			std::unique_lock<std::mutex> _lock(m_mtxTasks);
+			vecTasks.swap(m_vecTasks);
+		}
+		for (auto& fnTask : vecTasks)
+		{
+			fnTask();
+		}
+	}
+
+	int CMCPEventLoop::Run()
+	{
+		if (m_iPollFd < 0 && !m_upIoUring)
+			return ERRNO_INTERNAL_ERROR;
+
+		m_idLoopThread = std::this_thread::get_id();
+		m_bRunning = true;
+		RunPostedTasks();
+
+		while (m_bRunning)
+		{
+			int iTimeoutMs = -1;
+			if (m_fnTick)
+			{
+				auto llRemainMs = std::chrono::duration_cast<std::chrono::milliseconds>(m_tpNextTick - std::chrono::steady_clock::now()).count();
+				iTimeoutMs = llRemainMs > 0 ? static_cast<int>(llRemainMs) : 0;
+			}
+
+#if defined(MCP_EVENT_LOOP_EPOLL)
+			if (m_upIoUring)
+			{
+				if (ERRNO_OK != m_upIoUring->RunOnce(iTimeoutMs))
+					return ERRNO_INTERNAL_ERROR;
+				RunPostedTasks();
+				RunTick();
+				continue;
+			}
+
+			struct epoll_event arrEvents[MAX_EVENTS_PER_WAIT];
+			int iCount = epoll_wait(m_iPollFd, arrEvents, MAX_EVENTS_PER_WAIT, iTimeoutMs);
+			if (iCount < 0 && EINTR != errno)
+				return ERRNO_INTERNAL_ERROR;
+			for (int i = 0; i < iCount; ++i)
+			{
+				int iFd = arrEvents[i].data.fd;
+				if (iFd == m_arrWakeupFds[0])
+				{
+					DrainWakeup();
+					continue;
+				}
+
+				unsigned int nEvents = 0;
+				if (arrEvents[i].events & (EPOLLIN | EPOLLPRI))
+					nEvents |= EventFlags_Read;
+				if (arrEvents[i].events & EPOLLOUT)
+					nEvents |= EventFlags_Write;
+				if (arrEvents[i].events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP))
+					nEvents |= EventFlags_Error;
+
+				// The handler may remove its own (or another) descriptor while running.
+				auto itrHandler = m_hashHandlers.find(iFd);
+				if (itrHandler == m_hashHandlers.end())
+					continue;
+				auto spHandler = itrHandler->second;
+				(*spHandler)(iFd, nEvents);
+			}
+#elif defined(MCP_EVENT_LOOP_KQUEUE)
+			struct kevent arrEvents[MAX_EVENTS_PER_WAIT];
+			struct timespec tsTimeout;
+			tsTimeout.tv_sec = iTimeoutMs / 1000;
+			tsTimeout.tv_nsec = (iTimeoutMs % 1000) * 1000000L;
+			int iCount = kevent(m_iPollFd, nullptr, 0, arrEvents, MAX_EVENTS_PER_WAIT, iTimeoutMs >= 0 ? &tsTimeout : nullptr);
+			if (iCount < 0 && EINTR != errno)
+				return ERRNO_INTERNAL_ERROR;
+			for (int i = 0; i < iCount; ++i)
+			{
+				int iFd = static_cast<int>(arrEvents[i].ident);
+				if (iFd == m_arrWakeupFds[0])
+				{
+					DrainWakeup();
+					continue;
+				}
+
+				unsigned int nEvents = 0;
+				if (EVFILT_READ == arrEvents[i].filter)
+					nEvents |= EventFlags_Read;
+				if (EVFILT_WRITE == arrEvents[i].filter)
+					nEvents |= EventFlags_Write;
+				if (arrEvents[i].flags & (EV_EOF | EV_ERROR))
+					nEvents |= EventFlags_Error;
+
+				auto itrHandler = m_hashHandlers.find(iFd);
+				if (itrHandler == m_hashHandlers.end())
+					continue;
+				auto spHandler = itrHandler->second;
+				(*spHandler)(iFd, nEvents);
+			}
+#else
+			(void)iTimeoutMs;
+			return ERRNO_INTERNAL_ERROR;
+#endif
+
+			RunPostedTasks();
+			RunTick();
+		}
+
+		RunPostedTasks();
+
+		return ERRNO_OK;
+	}
+
+	void CMCPEventLoop::RunTick()
+	{
+		if (m_fnTick && std::chrono::steady_clock::now() >= m_tpNextTick)
+		{
+			m_tpNextTick = std::chrono::steady_clock::now() + std::chrono::milliseconds(m_nTickIntervalMs);
+			m_fnTick();
+		}
+	}
+
+	void CMCPEventLoop::Stop()
+	{
+		Post([this]()
+			{
+				m_bRunning = false;
+			});
+	}
+
+	bool CMCPEventLoop::IsInLoopThread() const
+	{
+		return m_idLoopThread == std::this_thread::get_id();
+	}
+}
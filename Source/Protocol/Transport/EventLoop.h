@@ -0,0 +1,87 @@
+#pragma once
+// Readiness based event loop used by the network transports.
+// This is the one place where platform APIs are used: epoll on Linux, kqueue on macOS/BSD, and
+// io_uring on Linux when built with TINYMCP_WITH_IO_URING (see IoUring.h).
+// Other platforms are not supported yet and Open() fails there.
+
+#include <memory>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+
+namespace MCP
+{
+	class CMCPIoUring;
+
+	class CMCPEventLoop
+	{
+	public:
+		enum EventFlags
+		{
+			EventFlags_Read = 0x1,
+			EventFlags_Write = 0x2,
+			EventFlags_Error = 0x4,		// hang up or error, always reported
+		};
+
+		using EventHandler = std::function<void(int iFd, unsigned int nEvents)>;
+		using Task = std::function<void()>;
+		using DataHandler = std::function<void(const char* pData, size_t nLength)>;
+
+		CMCPEventLoop();
+		~CMCPEventLoop();
+		CMCPEventLoop(const CMCPEventLoop&) = delete;
+		CMCPEventLoop& operator=(const CMCPEventLoop&) = delete;
+
+		// With bTryIoUring, uses io_uring if the build and the kernel support it, epoll otherwise.
+		int Open(bool bTryIoUring = false);
+		void Close();
+		// "epoll", "io_uring" or "kqueue".
+		const char* GetBackendName() const;
+
+		// Must be called on the loop thread once Run() started.
+		int Add(int iFd, unsigned int nEvents, EventHandler fnHandler);
+		int Modify(int iFd, unsigned int nEvents);
+		int Remove(int iFd);
+		// Like Add(), but when ReceivesData() the loop reads the socket itself: received bytes go to
+		// fnOnData, then fnHandler gets EventFlags_Read (end of stream and errors EventFlags_Error)
+		// and must not read the descriptor. Otherwise the same as Add().
+		int AddReceiver(int iFd, unsigned int nEvents, EventHandler fnHandler, DataHandler fnOnData);
+		bool ReceivesData() const;
+
+		// Thread safe: runs fnTask on the loop thread.
+		void Post(Task fnTask);
+		// Runs fnTick on the loop thread roughly every nIntervalMs, for timeouts.
+		void SetTickHandler(unsigned int nIntervalMs, Task fnTick);
+
+		// Dispatches events on the calling thread until Stop().
+		int Run();
+		// Thread safe.
+		void Stop();
+		bool IsInLoopThread() const;
+
+	private:
+		void Wakeup();
+		void DrainWakeup();
+		void RunPostedTasks();
+		void RunTick();
+
+		int m_iPollFd{ -1 };
+		std::unique_ptr<CMCPIoUring> m_upIoUring;
+		int m_arrWakeupFds[2]{ -1, -1 };	// eventfd in [0] on Linux, a pipe elsewhere
+		std::atomic<bool> m_bRunning{ false };
+		std::thread::id m_idLoopThread;
+
+		std::unordered_map<int, std::shared_ptr<EventHandler>> m_hashHandlers;
+
+		std::mutex m_mtxTasks;
+		std::vector<Task> m_vecTasks;
+
+		unsigned int m_nTickIntervalMs{ 0 };
+		Task m_fnTick;
+		std::chrono::steady_clock::time_point m_tpNextTick;
+	};
+}
@@ -1,37 +1,333 @@
 #include "HttpSseTransport.h"
 #include "../Public/PublicDef.h"
 #include "../Public/Config.h"
+#include "../Public/Trace.h"
+#include "../Public/Logger.h"
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+#include <cctype>
+#include <random>
+#include <utility>
+
+#if defined(__linux__) || defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || defined(__NetBSD__)
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#define MCP_HTTP_TRANSPORT_POSIX
+#endif
+
+#if defined(MSG_NOSIGNAL)
+#define MCP_SEND_FLAGS MSG_NOSIGNAL
+#else
+#define MCP_SEND_FLAGS 0
+#endif
 
 namespace MCP
 {
+    static constexpr size_t MAX_HEADER_BYTES = 64 * 1024;
+    static constexpr size_t READ_CHUNK_BYTES = 64 * 1024;
+    static constexpr long long PARSE_BAD_REQUEST = -1;
+    static constexpr long long PARSE_TOO_LARGE = -2;
+    // Sessions handed to another loop per tick at most.
+    static constexpr size_t REBALANCE_BATCH = 16;
+
+    ////////////////////////////////////////////////////////////////////////////////////////
+    // Minimal scanning of the top level members of a JSON object, enough to route messages
+    // without building a Json::Value tree for every message passing through the transport.
+    static const char* SkipWhitespace(const char* p, const char* pEnd)
+    {
+        while (p < pEnd && (' ' == *p || '\t' == *p || '\r' == *p || '\n' == *p))
+            ++p;
+
+        return p;
+    }
+
+    static const char* SkipString(const char* p, const char* pEnd)
+    {
+        // p points at the opening quote
+        for (++p; p < pEnd; ++p)
+        {
+            if ('\\' == *p)
+                ++p;
+            else if ('"' == *p)
+                return p + 1;
+        }
+
+        return nullptr;
+    }
+
+    static const char* SkipValue(const char* p, const char* pEnd)
+    {
+        if (p >= pEnd)
+            return nullptr;
+        if ('"' == *p)
+            return SkipString(p, pEnd);
+
+        if ('{' == *p || '[' == *p)
+        {
+            int iDepth = 0;
+            while (p < pEnd)
+            {
+                if ('"' == *p)
+                {
+                    p = SkipString(p, pEnd);
+                    if (!p)
+                        return nullptr;
+                    continue;
+                }
+                if ('{' == *p || '[' == *p)
+                    ++iDepth;
+                else if ('}' == *p || ']' == *p)
+                {
+                    if (0 == --iDepth)
+                        return p + 1;
+                }
+                ++p;
+            }
+
+            return nullptr;
+        }
+
+        // number, true, false, null
+        while (p < pEnd && ',' != *p && '}' != *p && ']' != *p && ' ' != *p && '\t' != *p && '\r' != *p && '\n' != *p)
+            ++p;
+
+        return p;
+    }
+
+    static bool FindMember(const char* pBegin, const char* pEnd, const char* lpcszKey, const char*& pValueBegin, const char*& pValueEnd)
+    {
+        const size_t nKeyLength = strlen(lpcszKey);
+        const char* p = SkipWhitespace(pBegin, pEnd);
+        if (p >= pEnd || '{' != *p)
+            return false;
+        p = SkipWhitespace(p + 1, pEnd);
+
+        while (p < pEnd && '"' == *p)
+        {
+            const char* pKeyEnd = SkipString(p, pEnd);
+            if (!pKeyEnd)
+                return false;
+            bool bMatched = static_cast<size_t>(pKeyEnd - p - 2) == nKeyLength && 0 == memcmp(p + 1, lpcszKey, nKeyLength);
+
+            p = SkipWhitespace(pKeyEnd, pEnd);
+            if (p >= pEnd || ':' != *p)
+                return false;
+            p = SkipWhitespace(p + 1, pEnd);
+            const char* pValueStop = SkipValue(p, pEnd);
+            if (!pValueStop)
+                return false;
+            if (bMatched)
+            {
+                pValueBegin = p;
+                pValueEnd = pValueStop;
+                return true;
+            }
+
+            p = SkipWhitespace(pValueStop, pEnd);
+            if (p < pEnd && ',' == *p)
+                p = SkipWhitespace(p + 1, pEnd);
+        }
+
+        return false;
+    }
+
+    static bool FindMember(const std::string& strJson, const char* lpcszKey, std::string& strValue)
+    {
+        const char* pValueBegin = nullptr;
+        const char* pValueEnd = nullptr;
+        if (!FindMember(strJson.data(), strJson.data() + strJson.size(), lpcszKey, pValueBegin, pValueEnd))
+            return false;
+        strValue.assign(pValueBegin, pValueEnd);
+
+        return true;
+    }
+
+    // The bounds of the elements of a top level array; false if the JSON is no array or is cut off.
+    static bool SplitArray(const char* pBegin, const char* pEnd, std::vector<std::pair<const char*, const char*>>& vecElements)
+    {
+        const char* p = SkipWhitespace(pBegin, pEnd);
+        if (p >= pEnd || '[' != *p)
+            return false;
+        p = SkipWhitespace(p + 1, pEnd);
+
+        while (p < pEnd && ']' != *p)
+        {
+            const char* pElementEnd = SkipValue(p, pEnd);
+            if (!pElementEnd)
+                return false;
+            vecElements.emplace_back(p, pElementEnd);
+
+            p = SkipWhitespace(pElementEnd, pEnd);
+            if (p < pEnd && ',' == *p)
+                p = SkipWhitespace(p + 1, pEnd);
+        }
+
+        return p < pEnd;
+    }
+
+    // Raw JSON of params._meta.progressToken (or params.progressToken for notifications/progress).
+    static bool FindProgressToken(const std::string& strJson, bool bInMeta, std::string& strToken)
+    {
+        std::string strParams;
+        if (!FindMember(strJson, MSG_KEY_PARAMS, strParams))
+            return false;
+        if (!bInMeta)
+            return FindMember(strParams, MSG_KEY_PROGRESS_TOKEN, strToken);
+
+        std::string strMeta;
+        if (!FindMember(strParams, MSG_KEY_META, strMeta))
+            return false;
+
+        return FindMember(strMeta, MSG_KEY_PROGRESS_TOKEN, strToken);
+    }
+
+    static std::string ToLower(std::string str)
+    {
+        std::transform(str.begin(), str.end(), str.begin(), [](unsigned char ch) { return static_cast<char>(std::tolower(ch)); });
+        return str;
+    }
+
+    static std::string Trim(const std::string& str)
+    {
+        auto nBegin = str.find_first_not_of(" \t");
+        if (std::string::npos == nBegin)
+            return std::string();
+        auto nEnd = str.find_last_not_of(" \t");
+
+        return str.substr(nBegin, nEnd - nBegin + 1);
+    }
+
+    static bool ReadSystemRandom(unsigned char* pBytes, size_t nBytes)
+    {
+#if defined(MCP_HTTP_TRANSPORT_POSIX)
+        int iFd = open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+        if (iFd < 0)
+            return false;
+        size_t nRead = 0;
+        while (nRead < nBytes)
+        {
+            ssize_t nChunk = read(iFd, pBytes + nRead, nBytes - nRead);
+            if (nChunk < 0 && EINTR == errno)
+                continue;
+            if (nChunk <= 0)
+                break;
+            nRead += static_cast<size_t>(nChunk);
+        }
+        close(iFd);
+
+        return nRead == nBytes;
+#else
+        (void)pBytes;
+        (void)nBytes;
+        return false;
+#endif
+    }
+
+    static std::string GenerateSessionId()
+    {
+        // 128 bits from the system CSPRNG; the id is all a client needs to address a session, so it
+        // must not be predictable from the ids handed out before.
+        unsigned char arrBytes[16];
+        if (!ReadSystemRandom(arrBytes, sizeof(arrBytes)))
+        {
+            // Backed by the OS entropy source (rand_s on Windows, getrandom or /dev/urandom elsewhere).
+            std::random_device device;
+            for (size_t i = 0; i < sizeof(arrBytes); i += 4)
+            {
+                unsigned int nBits = device();
+                std::memcpy(arrBytes + i, &nBits, 4);
+            }
+        }
+        char szId[33];
+        for (size_t i = 0; i < sizeof(arrBytes); ++i)
+            snprintf(szId + i * 2, 3, "%02x", arrBytes[i]);
+
+        return szId;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////
+    // CHttpSseTransport
+    CHttpSseTransport::CHttpSseTransport(const std::weak_ptr<CHttpSseListener>& wpListener, const std::string& strSessionId)
+        : m_wpListener(wpListener)
+        , m_strSessionId(strSessionId)
+    {
+
+    }
+
+    CHttpSseTransport::~CHttpSseTransport()
+    {
+        CloseIncoming();
+    }
+
     int CHttpSseTransport::Connect()
     {
-        // Load configuration
-        LoadConfig();
-        
-        // Stub: mark as connected
-        // In a real implementation, this would establish HTTP/HTTPS connection
-        m_connected = true;
-        return ERRNO_OK;
+        return m_wpListener.expired() ? ERRNO_INTERNAL_ERROR : ERRNO_OK;
     }
 
     int CHttpSseTransport::Disconnect()
     {
-        m_connected = false;
+        CloseIncoming();
+        auto spListener = m_wpListener.lock();
+        if (spListener)
+            spListener->OnSessionClosed(m_nShard, m_strSessionId);
+
         return ERRNO_OK;
     }
 
     int CHttpSseTransport::Read(std::string& strOut)
     {
-        // Stub: SSE reading not implemented
-        (void)strOut;
-        return ERRNO_INTERNAL_INPUT_TERMINATE;
+        {
+            std::unique_lock<std::mutex> _lock(m_mtxIncoming);
+            m_cvIncoming.wait(_lock, [this]() { return m_bStopped || !m_queueIncoming.empty(); });
+            if (m_queueIncoming.empty())
+                return ERRNO_INTERNAL_INPUT_TERMINATE;
+
+            strOut = std::move(m_queueIncoming.front());
+            m_queueIncoming.pop_front();
+        }
+
+        auto spListener = m_wpListener.lock();
+        if (spListener)
+            spListener->OnInputConsumed(strOut.size());
+
+        return ERRNO_OK;
     }
 
     int CHttpSseTransport::Write(const std::string& strIn)
     {
-        // Stub: HTTP POST/stream send not implemented
-        (void)strIn;
+        auto spListener = m_wpListener.lock();
+        if (!spListener)
+            return ERRNO_INTERNAL_OUTPUT_ERROR;
+
+        // Written from the owning loop (a response produced while processing a request): route it right away.
+        size_t nShard = m_nShard;
+        if (spListener->IsInShardThread(nShard))
+        {
+            spListener->RouteOutgoing(*spListener->m_vecShards[nShard], m_strSessionId, strIn);
+            return ERRNO_OK;
+        }
+
+        CHttpSseListener* pListener = spListener.get();
+        std::string strSessionId = m_strSessionId;
+        auto spPendingOutput = m_spPendingOutput;
+        *spPendingOutput += strIn.size();
+        if (!spListener->Post(nShard, [pListener, nShard, strSessionId, strIn, spPendingOutput]()
+            {
+                pListener->RouteOutgoing(*pListener->m_vecShards[nShard], strSessionId, strIn);
+                *spPendingOutput -= strIn.size();
+            }))
+        {
+            *spPendingOutput -= strIn.size();
+            return ERRNO_INTERNAL_OUTPUT_ERROR;
+        }
+
         return ERRNO_OK;
     }
 
@@ -41,30 +337,1652 @@ namespace MCP
         return ERRNO_OK;
     }
 
-    void CHttpSseTransport::SetEndpoint(const std::string& url)
+    bool CHttpSseTransport::SetFrameHandler(FrameHandler fnOnFrame, CloseHandler fnOnClose)
+    {
+        std::unique_lock<std::mutex> _lock(m_mtxIncoming);
+        if (m_bStopped)
+            return false;
+        m_fnOnFrame = std::move(fnOnFrame);
+        m_fnOnClose = std::move(fnOnClose);
+
+        return true;
+    }
+
+    const std::string& CHttpSseTransport::GetSessionId() const
+    {
+        return m_strSessionId;
+    }
+
+    const std::string& CHttpSseTransport::GetPrincipal() const
+    {
+        return m_strPrincipal;
+    }
+
+    bool CHttpSseTransport::IsAuthenticated() const
+    {
+        // The listener answers unauthenticated requests with 401 before they reach the session.
+        return true;
+    }
+
+    size_t CHttpSseTransport::GetPendingOutputBytes() const
+    {
+        return m_spPendingOutput->load(std::memory_order_relaxed);
+    }
+
+    bool CHttpSseTransport::IsPushMode() const
+    {
+        // The handlers are installed before the first message and never change afterwards.
+        return static_cast<bool>(m_fnOnFrame);
+    }
+
+    bool CHttpSseTransport::Push(std::string&& strMsg)
+    {
+        if (IsPushMode())
+        {
+            {
+                std::unique_lock<std::mutex> _lock(m_mtxIncoming);
+                if (m_bStopped)
+                    return false;
+            }
+            m_fnOnFrame(strMsg.data(), strMsg.data() + strMsg.size());
+            return false;
+        }
+
+        {
+            std::unique_lock<std::mutex> _lock(m_mtxIncoming);
+            if (m_bStopped)
+                return false;
+            m_queueIncoming.push_back(std::move(strMsg));
+        }
+        m_cvIncoming.notify_one();
+
+        return true;
+    }
+
+    void CHttpSseTransport::CloseIncoming()
+    {
+        CloseHandler fnOnClose;
+        {
+            std::unique_lock<std::mutex> _lock(m_mtxIncoming);
+            if (m_bStopped)
+                return;
+            m_bStopped = true;
+            fnOnClose = std::move(m_fnOnClose);
+        }
+        m_cvIncoming.notify_all();
+
+        if (fnOnClose)
+            fnOnClose();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////
+    // CHttpSseListener
+    CHttpSseListener::~CHttpSseListener()
+    {
+        Close();
+    }
+
+    int CHttpSseListener::Listen(AcceptCallback fnOnAccept)
+    {
+        // Load configuration
+        LoadConfig();
+
+        // TLS needs a crypto library which the SDK does not bundle; terminate HTTPS in a reverse proxy.
+        if (m_httpsEnabled || !fnOnAccept)
+            return ERRNO_INTERNAL_ERROR;
+
+#if defined(MCP_HTTP_TRANSPORT_POSIX)
+        if (m_iListenFd >= 0)
+            return ERRNO_OK;
+        // Transports handed out earlier may still refer to the loops by index.
+        if (!m_vecShards.empty())
+            return ERRNO_INTERNAL_ERROR;
+
+        struct addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = AI_PASSIVE;
+        struct addrinfo* pAddrInfo = nullptr;
+        std::string strPort = std::to_string(m_iPort);
+        if (0 != getaddrinfo(m_strHost.empty() ? nullptr : m_strHost.c_str(), strPort.c_str(), &hints, &pAddrInfo))
+            return ERRNO_INTERNAL_ERROR;
+
+        for (auto pAddr = pAddrInfo; pAddr; pAddr = pAddr->ai_next)
+        {
+            int iFd = socket(pAddr->ai_family, pAddr->ai_socktype, pAddr->ai_protocol);
+            if (iFd < 0)
+                continue;
+            int iReuse = 1;
+            setsockopt(iFd, SOL_SOCKET, SO_REUSEADDR, &iReuse, sizeof(iReuse));
+            if (0 == bind(iFd, pAddr->ai_addr, pAddr->ai_addrlen) && 0 == listen(iFd, SOMAXCONN))
+            {
+                m_iListenFd = iFd;
+                break;
+            }
+            close(iFd);
+        }
+        freeaddrinfo(pAddrInfo);
+        if (m_iListenFd < 0)
+        {
+            MCP_LOG_ERROR("transport", "cannot listen on {}:{}", m_strHost, m_iPort);
+            return ERRNO_INTERNAL_ERROR;
+        }
+        fcntl(m_iListenFd, F_SETFL, fcntl(m_iListenFd, F_GETFL) | O_NONBLOCK);
+        fcntl(m_iListenFd, F_SETFD, FD_CLOEXEC);
+
+        size_t nEventLoops = m_nEventLoops;
+        if (0 == nEventLoops)
+            nEventLoops = std::max<size_t>(1, std::thread::hardware_concurrency());
+        for (size_t nIndex = 0; nIndex < nEventLoops; ++nIndex)
+        {
+            std::unique_ptr<HttpShard> upShard(new HttpShard());
+            upShard->nIndex = nIndex;
+            HttpShard* pShard = upShard.get();
+            m_vecShards.push_back(std::move(upShard));
+            if (ERRNO_OK != pShard->eventLoop.Open(m_bIoUring))
+            {
+                Close();
+                return ERRNO_INTERNAL_ERROR;
+            }
+            pShard->eventLoop.SetTickHandler(1000, [this, pShard]() { OnTick(*pShard); });
+        }
+        if (ERRNO_OK != m_vecShards[0]->eventLoop.Add(m_iListenFd, CMCPEventLoop::EventFlags_Read, [this](int, unsigned int) { OnAccept(); }))
+        {
+            Close();
+            return ERRNO_INTERNAL_ERROR;
+        }
+
+        MCP_LOG_INFO("transport", "{} event loops on {}", m_vecShards.size(), m_vecShards[0]->eventLoop.GetBackendName());
+        m_fnOnAccept = std::move(fnOnAccept);
+        for (auto& upShard : m_vecShards)
+        {
+            HttpShard* pShard = upShard.get();
+            {
+                std::unique_lock<std::mutex> _lock(pShard->mtxPost);
+                pShard->bOpen = true;
+            }
+            pShard->thrLoop = std::thread([pShard]() { pShard->eventLoop.Run(); });
+        }
+        // Keys and secrets are read per request; connections validated before a reload check again.
+        m_iReloadHandlerId = Config::GetInstance().AddReloadHandler([this](const ConfigSnapshot&) { m_authenticator.Configure(m_bearer); });
+
+        return ERRNO_OK;
+#else
+        return ERRNO_INTERNAL_ERROR;
+#endif
+    }
+
+    int CHttpSseListener::Close()
+    {
+        if (m_iReloadHandlerId >= 0)
+        {
+            Config::GetInstance().RemoveReloadHandler(m_iReloadHandlerId);
+            m_iReloadHandlerId = -1;
+        }
+        for (auto& upShard : m_vecShards)
+        {
+            std::unique_lock<std::mutex> _lock(upShard->mtxPost);
+            upShard->bOpen = false;
+        }
+        for (auto& upShard : m_vecShards)
+        {
+            if (upShard->thrLoop.joinable())
+            {
+                upShard->eventLoop.Stop();
+                upShard->thrLoop.join();
+            }
+        }
+
+        // The loop threads are gone, everything can be torn down from here.
+        std::vector<std::shared_ptr<CHttpSseTransport>> vecSessions;
+        for (auto& upShard : m_vecShards)
+        {
+#if defined(MCP_HTTP_TRANSPORT_POSIX)
+            for (auto& itrConn : upShard->hashConnections)
+            {
+                close(itrConn.second->iFd);
+                itrConn.second->iFd = -1;
+            }
+#endif
+            upShard->hashConnections.clear();
+            upShard->hashPendingRequests.clear();
+            upShard->hashProgressTokens.clear();
+            for (auto& itrSession : upShard->hashSessions)
+            {
+                vecSessions.push_back(itrSession.second);
+            }
+            upShard->hashSessions.clear();
+            upShard->nConnections = 0;
+            upShard->nSessions = 0;
+            upShard->eventLoop.Close();
+        }
+#if defined(MCP_HTTP_TRANSPORT_POSIX)
+        if (m_iListenFd >= 0)
+            close(m_iListenFd);
+#endif
+        m_iListenFd = -1;
+        {
+            std::unique_lock<std::mutex> _lock(m_mtxDirectory);
+            m_hashSessionShards.clear();
+        }
+
+        for (auto& spSession : vecSessions)
+        {
+            spSession->CloseIncoming();
+        }
+        m_fnOnAccept = nullptr;
+
+        return ERRNO_OK;
+    }
+
+    std::vector<HttpShardStats> CHttpSseListener::GetShardStats() const
+    {
+        std::vector<HttpShardStats> vecStats;
+        for (auto& upShard : m_vecShards)
+        {
+            HttpShardStats stats;
+            stats.nConnections = upShard->nConnections;
+            stats.nSessions = upShard->nSessions;
+            stats.ullSessionsMovedIn = upShard->ullSessionsMovedIn;
+            stats.ullSessionsMovedOut = upShard->ullSessionsMovedOut;
+            stats.ullConnectionsMovedIn = upShard->ullConnectionsMovedIn;
+            vecStats.push_back(stats);
+        }
+
+        return vecStats;
+    }
+
+    bool CHttpSseListener::Post(size_t nShard, CMCPEventLoop::Task fnTask)
+    {
+        if (nShard >= m_vecShards.size())
+            return false;
+
+        auto& shard = *m_vecShards[nShard];
+        std::unique_lock<std::mutex> _lock(shard.mtxPost);
+        if (!shard.bOpen)
+            return false;
+        shard.eventLoop.Post(std::move(fnTask));
+
+        return true;
+    }
+
+    bool CHttpSseListener::IsInShardThread(size_t nShard) const
+    {
+        return nShard < m_vecShards.size() && m_vecShards[nShard]->eventLoop.IsInLoopThread();
+    }
+
+    void CHttpSseListener::OnInputConsumed(size_t nBytes)
+    {
+        size_t nPending = m_nPendingInputBytes.fetch_sub(nBytes) - nBytes;
+        if (nPending <= m_nMaxPendingInputBytes / 2 && m_bInputPaused.exchange(false))
+            PauseReading(false);
+    }
+
+    void CHttpSseListener::OnSessionClosed(size_t nShard, const std::string& strSessionId)
+    {
+        Post(nShard, [this, nShard, strSessionId]()
+            {
+                RemoveSession(*m_vecShards[nShard], strSessionId);
+            });
+    }
+
+    void CHttpSseListener::SetEndpoint(const std::string& url)
     {
         m_url = url;
     }
 
-    void CHttpSseTransport::SetAuthorization(const std::string& bearerToken)
+    void CHttpSseListener::SetAuthorization(const std::string& bearerToken)
     {
         m_bearer = bearerToken;
     }
 
-    void CHttpSseTransport::LoadConfig()
+    void CHttpSseListener::SetMetricsHandler(std::function<std::string()> fnMetrics)
+    {
+        m_fnMetrics = std::move(fnMetrics);
+    }
+
+    int CHttpSseListener::GetPort() const
+    {
+#if defined(MCP_HTTP_TRANSPORT_POSIX)
+        if (m_iListenFd >= 0)
+        {
+            struct sockaddr_storage addr{};
+            socklen_t nLength = sizeof(addr);
+            if (0 == getsockname(m_iListenFd, reinterpret_cast<struct sockaddr*>(&addr), &nLength))
+            {
+                if (AF_INET == addr.ss_family)
+                    return ntohs(reinterpret_cast<struct sockaddr_in*>(&addr)->sin_port);
+                if (AF_INET6 == addr.ss_family)
+                    return ntohs(reinterpret_cast<struct sockaddr_in6*>(&addr)->sin6_port);
+            }
+        }
+#endif
+        return m_iPort;
+    }
+
+    void CHttpSseListener::LoadConfig()
     {
         auto& config = Config::GetInstance();
         m_httpsEnabled = config.IsHttpsEnabled();
         m_certFile = config.GetCertFile();
         m_keyFile = config.GetKeyFile();
-        
-        // Log configuration status (in a real implementation)
-        // std::cout << "HTTPS enabled: " << (m_httpsEnabled ? "yes" : "no") << std::endl;
-        // if (m_httpsEnabled) {
-        //     std::cout << "Cert file: " << m_certFile << std::endl;
-        //     std::cout << "Key file: " << m_keyFile << std::endl;
-        // }
+
+        m_strHost = config.GetHost();
+        m_iPort = config.GetPort();
+        m_strEndpointPath = config.GetHttpEndpoint();
+        if (!m_url.empty())
+        {
+            auto nScheme = m_url.find("://");
+            auto nPath = m_url.find('/', std::string::npos == nScheme ? 0 : nScheme + 3);
+            m_strEndpointPath = std::string::npos == nPath ? "/" : m_url.substr(nPath);
+        }
+        m_strMetricsPath = config.GetMetricsPrometheusPath();
+
+        m_authenticator.Configure(m_bearer);
+
+        auto fnSize = [](int iValue, size_t nDefault) { return iValue > 0 ? static_cast<size_t>(iValue) : nDefault; };
+        m_nMaxRequestBytes = fnSize(config.GetHttpMaxRequestBytes(), m_nMaxRequestBytes);
+        m_nOutputHighWatermark = fnSize(config.GetHttpOutputHighWatermark(), m_nOutputHighWatermark);
+        m_nMaxOutputBytes = fnSize(config.GetHttpMaxOutputBytes(), m_nMaxOutputBytes);
+        m_nMaxPendingInputBytes = fnSize(config.GetHttpMaxPendingInputBytes(), m_nMaxPendingInputBytes);
+        int iKeepAliveS = config.GetHttpKeepAliveTimeout();
+        m_durKeepAliveTimeout = std::chrono::seconds(iKeepAliveS > 0 ? iKeepAliveS : 60);
+        int iEventLoops = config.GetHttpEventLoops();
+        m_nEventLoops = iEventLoops > 0 ? static_cast<size_t>(iEventLoops) : 0;
+        m_bIoUring = config.GetHttpIoUring();
+        int iRebalanceThreshold = config.GetHttpRebalanceThreshold();
+        m_nRebalanceThreshold = iRebalanceThreshold > 0 ? static_cast<size_t>(iRebalanceThreshold) : 0;
+        m_bWebSocket = config.GetWebSocketEnabled();
+        m_bWebSocketDeflate = config.GetWebSocketDeflate();
+        int iDeflateMinBytes = config.GetWebSocketDeflateMinBytes();
+        m_nDeflateMinBytes = iDeflateMinBytes > 0 ? static_cast<size_t>(iDeflateMinBytes) : 0;
+        m_iDeflateLevel = config.GetWebSocketDeflateLevel();
+        int iPingIntervalS = config.GetWebSocketPingInterval();
+        m_durPingInterval = std::chrono::seconds(iPingIntervalS > 0 ? iPingIntervalS : 0);
     }
-}
 
+#if defined(MCP_HTTP_TRANSPORT_POSIX)
+    void CHttpSseListener::OnAccept()
+    {
+        while (true)
+        {
+            int iFd = accept(m_iListenFd, nullptr, nullptr);
+            if (iFd < 0)
+                return;
+
+            fcntl(iFd, F_SETFL, fcntl(iFd, F_GETFL) | O_NONBLOCK);
+            fcntl(iFd, F_SETFD, FD_CLOEXEC);
+            int iNoDelay = 1;
+            setsockopt(iFd, IPPROTO_TCP, TCP_NODELAY, &iNoDelay, sizeof(iNoDelay));
+#if defined(SO_NOSIGPIPE)
+            int iNoSigPipe = 1;
+            setsockopt(iFd, SOL_SOCKET, SO_NOSIGPIPE, &iNoSigPipe, sizeof(iNoSigPipe));
+#endif
+
+            auto spConn = std::make_shared<HttpConnection>();
+            spConn->ullId = ++m_ullNextConnectionId;
+            spConn->iFd = iFd;
+            spConn->tpLastActive = std::chrono::steady_clock::now();
+
+            // Counted when dispatched so that a burst of connections spreads over the loops.
+            size_t nTarget = LeastLoadedShard(false);
+            auto& target = *m_vecShards[nTarget];
+            ++target.nConnections;
+            if (0 == nTarget)
+            {
+                AddConnection(target, spConn);
+            }
+            else if (!Post(nTarget, [this, spConn, nTarget]() { AddConnection(*m_vecShards[nTarget], spConn); }))
+            {
+                --target.nConnections;
+                close(iFd);
+            }
+        }
+    }
+
+    void CHttpSseListener::AddConnection(HttpShard& shard, const std::shared_ptr<HttpConnection>& spConn)
+    {
+        spConn->pShard = &shard;
+        std::weak_ptr<HttpConnection> wpConn = spConn;
+        unsigned int nEvents = shard.bReadPaused ? 0 : CMCPEventLoop::EventFlags_Read;
+        auto fnOnEvent = [this, wpConn](int, unsigned int nEvents)
+            {
+                auto spConn = wpConn.lock();
+                if (spConn)
+                    OnConnectionEvent(spConn, nEvents);
+            };
+        // Only appends: the read event following the bytes processes them.
+        auto fnOnData = [wpConn](const char* pData, size_t nLength)
+            {
+                auto spConn = wpConn.lock();
+                if (spConn)
+                    spConn->strInput.append(pData, nLength);
+            };
+        if (ERRNO_OK != shard.eventLoop.AddReceiver(spConn->iFd, nEvents, fnOnEvent, fnOnData))
+        {
+            --shard.nConnections;
+            close(spConn->iFd);
+            spConn->iFd = -1;
+            return;
+        }
+        shard.hashConnections[spConn->ullId] = spConn;
+    }
+
+    void CHttpSseListener::MoveConnection(const std::shared_ptr<HttpConnection>& spConn, size_t nTarget)
+    {
+        auto& source = *spConn->pShard;
+        source.eventLoop.Remove(spConn->iFd);
+        source.hashConnections.erase(spConn->ullId);
+        --source.nConnections;
+
+        auto& target = *m_vecShards[nTarget];
+        ++target.nConnections;
+        spConn->pShard = nullptr;
+        if (!Post(nTarget, [this, spConn, nTarget]()
+            {
+                auto& target = *m_vecShards[nTarget];
+                AddConnection(target, spConn);
+                if (spConn->iFd < 0)
+                    return;
+                ++target.ullConnectionsMovedIn;
+                // The request that triggered the move is still at the head of the input.
+                ProcessInput(spConn);
+            }))
+        {
+            --target.nConnections;
+            close(spConn->iFd);
+            spConn->iFd = -1;
+        }
+    }
+
+    size_t CHttpSseListener::LeastLoadedShard(bool bBySessions) const
+    {
+        size_t nBest = 0;
+        size_t nBestLoad = static_cast<size_t>(-1);
+        for (auto& upShard : m_vecShards)
+        {
+            size_t nLoad = bBySessions ? upShard->nSessions.load() : upShard->nConnections.load();
+            if (nLoad < nBestLoad)
+            {
+                nBest = upShard->nIndex;
+                nBestLoad = nLoad;
+            }
+        }
+
+        return nBest;
+    }
+
+    void CHttpSseListener::OnConnectionEvent(const std::shared_ptr<HttpConnection>& spConn, unsigned int nEvents)
+    {
+        spConn->tpLastActive = std::chrono::steady_clock::now();
+
+        if (spConn->pShard->eventLoop.ReceivesData() && (nEvents & CMCPEventLoop::EventFlags_Error))
+        {
+            // The loop has received up to the end of the stream already.
+            CloseConnection(spConn);
+            return;
+        }
+        if (spConn->pShard->eventLoop.ReceivesData() && (nEvents & CMCPEventLoop::EventFlags_Read))
+        {
+            ProcessInput(spConn);
+        }
+        else if (nEvents & (CMCPEventLoop::EventFlags_Read | CMCPEventLoop::EventFlags_Error))
+        {
+            {
+                MCP_TRACE_SCOPE("read");
+                char szBuffer[READ_CHUNK_BYTES];
+                while (true)
+                {
+                    ssize_t nRead = recv(spConn->iFd, szBuffer, sizeof(szBuffer), 0);
+                    if (nRead > 0)
+                    {
+                        spConn->strInput.append(szBuffer, static_cast<size_t>(nRead));
+                        // Pipelined requests behind an open stream wait; do not buffer without bound.
+                        if (spConn->strInput.size() > m_nMaxRequestBytes + MAX_HEADER_BYTES)
+                            break;
+                        continue;
+                    }
+                    if (nRead < 0 && (EAGAIN == errno || EWOULDBLOCK == errno))
+                        break;
+                    if (nRead < 0 && EINTR == errno)
+                        continue;
+
+                    CloseConnection(spConn);
+                    return;
+                }
+            }
+            ProcessInput(spConn);
+        }
+
+        if (spConn->iFd >= 0 && spConn->pShard && (nEvents & CMCPEventLoop::EventFlags_Write))
+            FlushOutput(spConn);
+    }
+
+    void CHttpSseListener::ProcessInput(const std::shared_ptr<HttpConnection>& spConn)
+    {
+        // A response routed while handling a request finishes its stream and comes back here.
+        if (spConn->bProcessing)
+            return;
+        spConn->bProcessing = true;
+
+        while (spConn->iFd >= 0 && ConnectionState_Reading == spConn->eState && !spConn->bCloseAfterFlush && !spConn->strInput.empty())
+        {
+            HttpRequest request;
+            long long llConsumed = ParseRequest(spConn, request);
+            if (0 == llConsumed)
+                break;
+            if (PARSE_TOO_LARGE == llConsumed)
+            {
+                spConn->bKeepAlive = false;
+                SendResponse(spConn, 413, "Payload Too Large");
+                break;
+            }
+            if (llConsumed < 0)
+            {
+                spConn->bKeepAlive = false;
+                SendResponse(spConn, 400, "Bad Request");
+                break;
+            }
+
+            size_t nOwner = 0;
+            if (FindOwningShard(spConn, request, nOwner))
+            {
+                // Wait for the previous response to drain, FlushOutput() resumes here.
+                if (spConn->strOutput.size() != spConn->nOutputOffset)
+                    break;
+                spConn->bProcessing = false;
+                MoveConnection(spConn, nOwner);
+                return;
+            }
+
+            spConn->strInput.erase(0, static_cast<size_t>(llConsumed));
+            HandleRequest(spConn, request);
+        }
+        // Frames may follow the upgrade request right away.
+        if (spConn->iFd >= 0 && ConnectionState_WebSocket == spConn->eState)
+            ProcessFrames(spConn);
+        spConn->bProcessing = false;
+
+        if (spConn->iFd >= 0)
+            UpdateInterest(spConn);
+    }
+
+    long long CHttpSseListener::ParseRequest(const std::shared_ptr<HttpConnection>& spConn, HttpRequest& request)
+    {
+        const std::string& strInput = spConn->strInput;
+        auto nHeaderEnd = strInput.find("\r\n\r\n");
+        if (std::string::npos == nHeaderEnd)
+            return strInput.size() > MAX_HEADER_BYTES ? PARSE_BAD_REQUEST : 0;
+
+        auto nLineEnd = strInput.find("\r\n");
+        std::string strRequestLine = strInput.substr(0, nLineEnd);
+        auto nMethodEnd = strRequestLine.find(' ');
+        auto nPathEnd = strRequestLine.rfind(' ');
+        if (std::string::npos == nMethodEnd || nMethodEnd == nPathEnd)
+            return PARSE_BAD_REQUEST;
+        request.strMethod = strRequestLine.substr(0, nMethodEnd);
+        request.strPath = strRequestLine.substr(nMethodEnd + 1, nPathEnd - nMethodEnd - 1);
+        request.strVersion = strRequestLine.substr(nPathEnd + 1);
+        if (0 != request.strVersion.compare(0, 5, "HTTP/"))
+            return PARSE_BAD_REQUEST;
+
+        size_t nPos = nLineEnd + 2;
+        while (nPos < nHeaderEnd)
+        {
+            auto nEnd = strInput.find("\r\n", nPos);
+            auto nColon = strInput.find(':', nPos);
+            if (std::string::npos == nColon || nColon > nEnd)
+                return PARSE_BAD_REQUEST;
+            request.hashHeaders[ToLower(Trim(strInput.substr(nPos, nColon - nPos)))] = Trim(strInput.substr(nColon + 1, nEnd - nColon - 1));
+            nPos = nEnd + 2;
+        }
+
+        // Request bodies must carry a Content-Length; chunked uploads are not accepted.
+        if (request.hashHeaders.count("transfer-encoding"))
+            return PARSE_BAD_REQUEST;
+        size_t nContentLength = 0;
+        auto itrLength = request.hashHeaders.find("content-length");
+        if (itrLength != request.hashHeaders.end())
+        {
+            try
+            {
+                nContentLength = static_cast<size_t>(std::stoull(itrLength->second));
+            }
+            catch (...)
+            {
+                return PARSE_BAD_REQUEST;
+            }
+        }
+        if (nContentLength > m_nMaxRequestBytes)
+            return PARSE_TOO_LARGE;
+
+        size_t nBodyBegin = nHeaderEnd + 4;
+        if (strInput.size() < nBodyBegin + nContentLength)
+            return 0;
+        request.strBody = strInput.substr(nBodyBegin, nContentLength);
+
+        return static_cast<long long>(nBodyBegin + nContentLength);
+    }
+
+    bool CHttpSseListener::FindOwningShard(const std::shared_ptr<HttpConnection>& spConn, const HttpRequest& request, size_t& nShard)
+    {
+        auto itrHeader = request.hashHeaders.find("mcp-session-id");
+        if (itrHeader == request.hashHeaders.end() || spConn->pShard->hashSessions.count(itrHeader->second))
+            return false;
+
+        std::unique_lock<std::mutex> _lock(m_mtxDirectory);
+        auto itrOwner = m_hashSessionShards.find(itrHeader->second);
+        if (itrOwner == m_hashSessionShards.end() || itrOwner->second == spConn->pShard->nIndex)
+            return false;
+        nShard = itrOwner->second;
+
+        return true;
+    }
+
+    void CHttpSseListener::HandleRequest(const std::shared_ptr<HttpConnection>& spConn, HttpRequest& request)
+    {
+        std::string strConnection;
+        auto itrConnection = request.hashHeaders.find("connection");
+        if (itrConnection != request.hashHeaders.end())
+            strConnection = ToLower(itrConnection->second);
+        if (0 == request.strVersion.compare("HTTP/1.0"))
+            spConn->bKeepAlive = strConnection == "keep-alive";
+        else
+            spConn->bKeepAlive = strConnection != "close";
+
+        if (!AuthenticateRequest(spConn, request))
+            return;
+
+        std::string strPath = request.strPath.substr(0, request.strPath.find('?'));
+        if (m_fnMetrics && !m_strMetricsPath.empty() && strPath == m_strMetricsPath && strPath != m_strEndpointPath)
+        {
+            if ("GET" == request.strMethod)
+                SendResponse(spConn, 200, "OK", m_fnMetrics(), "text/plain; version=0.0.4");
+            else
+                SendResponse(spConn, 405, "Method Not Allowed");
+            return;
+        }
+        if (strPath != m_strEndpointPath)
+        {
+            SendResponse(spConn, 404, "Not Found");
+            return;
+        }
+
+        if ("POST" == request.strMethod)
+        {
+            HandlePost(spConn, request);
+        }
+        else if ("GET" == request.strMethod)
+        {
+            auto itrUpgrade = request.hashHeaders.find("upgrade");
+            if (m_bWebSocket && itrUpgrade != request.hashHeaders.end() && "websocket" == ToLower(itrUpgrade->second))
+            {
+                HandleUpgrade(spConn, request);
+                return;
+            }
+            auto itrAccept = request.hashHeaders.find("accept");
+            if (itrAccept == request.hashHeaders.end() || std::string::npos == itrAccept->second.find("text/event-stream"))
+            {
+                SendResponse(spConn, 405, "Method Not Allowed");
+                return;
+            }
+            auto spSession = FindSession(spConn, request);
+            if (!spSession)
+                return;
+            spConn->strSessionId = spSession->GetSessionId();
+            StartEventStream(spConn);
+            spConn->eState = ConnectionState_Standalone;
+        }
+        else if ("DELETE" == request.strMethod)
+        {
+            HandleDelete(spConn, request);
+        }
+        else
+        {
+            SendResponse(spConn, 405, "Method Not Allowed");
+        }
+    }
+
+    void CHttpSseListener::HandlePost(const std::shared_ptr<HttpConnection>& spConn, HttpRequest& request)
+    {
+        const char* pBody = SkipWhitespace(request.strBody.data(), request.strBody.data() + request.strBody.size());
+        if (pBody < request.strBody.data() + request.strBody.size() && '[' == *pBody)
+        {
+            HandleBatchPost(spConn, request);
+            return;
+        }
+
+        auto& shard = *spConn->pShard;
+        std::string strMethod;
+        std::string strId;
+        bool bHasMethod = FindMember(request.strBody, MSG_KEY_METHOD, strMethod);
+        bool bHasId = FindMember(request.strBody, MSG_KEY_ID, strId);
+        if (!bHasMethod && !bHasId)
+        {
+            SendResponse(spConn, 400, "Bad Request");
+            return;
+        }
+
+        std::shared_ptr<CHttpSseTransport> spSession;
+        if (!request.hashHeaders.count("mcp-session-id") && bHasMethod && bHasId
+            && strMethod == std::string("\"") + METHOD_INITIALIZE + "\"")
+        {
+            spSession = CreateSession(shard, spConn->strPrincipal);
+            if (!spSession)
+            {
+                spConn->bKeepAlive = false;
+                SendResponse(spConn, 503, "Service Unavailable");
+                return;
+            }
+        }
+        else
+        {
+            spSession = FindSession(spConn, request);
+            if (!spSession)
+                return;
+        }
+        spConn->strSessionId = spSession->GetSessionId();
+
+        if (bHasMethod && bHasId)
+        {
+            std::string strKey = spConn->strSessionId + '\n' + strId;
+            if (shard.hashPendingRequests.count(strKey))
+            {
+                SendResponse(spConn, 409, "Conflict");
+                return;
+            }
+
+            shard.hashPendingRequests[strKey] = spConn->ullId;
+            spConn->strRequestKey = strKey;
+            spConn->vecRequestIds.push_back(strId);
+            std::string strToken;
+            if (FindProgressToken(request.strBody, true, strToken))
+            {
+                spConn->strProgressKey = spConn->strSessionId + '\n' + strToken;
+                shard.hashProgressTokens[spConn->strProgressKey] = spConn->ullId;
+            }
+            StartEventStream(spConn);
+            spConn->eState = ConnectionState_Streaming;
+        }
+        else
+        {
+            SendResponse(spConn, 202, "Accepted");
+        }
+
+        QueueIncoming(spSession, std::move(request.strBody));
+    }
+
+    void CHttpSseListener::HandleBatchPost(const std::shared_ptr<HttpConnection>& spConn, HttpRequest& request)
+    {
+        auto& shard = *spConn->pShard;
+        std::vector<std::pair<const char*, const char*>> vecElements;
+        if (!SplitArray(request.strBody.data(), request.strBody.data() + request.strBody.size(), vecElements))
+        {
+            SendResponse(spConn, 400, "Bad Request");
+            return;
+        }
+
+        std::vector<std::string> vecIds;
+        bool bInvalid = vecElements.empty();
+        for (auto& element : vecElements)
+        {
+            const char* pMethod = nullptr;
+            const char* pMethodEnd = nullptr;
+            const char* pId = nullptr;
+            const char* pIdEnd = nullptr;
+            bool bHasMethod = FindMember(element.first, element.second, MSG_KEY_METHOD, pMethod, pMethodEnd);
+            bool bHasId = FindMember(element.first, element.second, MSG_KEY_ID, pId, pIdEnd);
+            if (bHasMethod && bHasId)
+                vecIds.emplace_back(pId, pIdEnd);
+            else if (!bHasMethod && !bHasId)
+                bInvalid = true;
+        }
+        // The session answers the invalid elements of a batch holding requests along with them.
+        if (vecIds.empty() && bInvalid)
+        {
+            SendResponse(spConn, 400, "Bad Request");
+            return;
+        }
 
+        // initialize cannot be batched: the session must exist.
+        auto spSession = FindSession(spConn, request);
+        if (!spSession)
+            return;
+        spConn->strSessionId = spSession->GetSessionId();
+
+        if (vecIds.empty())
+        {
+            SendResponse(spConn, 202, "Accepted");
+        }
+        else
+        {
+            for (auto& strId : vecIds)
+            {
+                if (shard.hashPendingRequests.count(spConn->strSessionId + '\n' + strId))
+                {
+                    SendResponse(spConn, 409, "Conflict");
+                    return;
+                }
+            }
+
+            // The array of responses carries the id of every request; the first one routes it here.
+            spConn->strRequestKey = spConn->strSessionId + '\n' + vecIds.front();
+            shard.hashPendingRequests[spConn->strRequestKey] = spConn->ullId;
+            spConn->vecRequestIds = std::move(vecIds);
+            StartEventStream(spConn);
+            spConn->eState = ConnectionState_Streaming;
+        }
+
+        QueueIncoming(spSession, std::move(request.strBody));
+    }
+
+    void CHttpSseListener::HandleDelete(const std::shared_ptr<HttpConnection>& spConn, HttpRequest& request)
+    {
+        auto spSession = FindSession(spConn, request);
+        if (!spSession)
+            return;
+
+        RemoveSession(*spConn->pShard, spSession->GetSessionId());
+        SendResponse(spConn, 200, "OK");
+        // The session sees the end of its input and terminates, cancelling its tasks.
+        spSession->CloseIncoming();
+    }
+
+    void CHttpSseListener::HandleUpgrade(const std::shared_ptr<HttpConnection>& spConn, HttpRequest& request)
+    {
+        auto itrKey = request.hashHeaders.find("sec-websocket-key");
+        auto itrVersion = request.hashHeaders.find("sec-websocket-version");
+        auto itrConnection = request.hashHeaders.find("connection");
+        if (itrKey == request.hashHeaders.end() || itrVersion == request.hashHeaders.end() || "13" != itrVersion->second
+            || itrConnection == request.hashHeaders.end() || std::string::npos == ToLower(itrConnection->second).find("upgrade"))
+        {
+            SendResponse(spConn, 400, "Bad Request");
+            return;
+        }
+
+        auto& shard = *spConn->pShard;
+        std::shared_ptr<CHttpSseTransport> spSession;
+        bool bOwnsSession = false;
+        if (request.hashHeaders.count("mcp-session-id"))
+        {
+            spSession = FindSession(spConn, request);
+            if (!spSession)
+                return;
+            if (shard.hashWebSockets.count(spSession->GetSessionId()))
+            {
+                SendResponse(spConn, 409, "Conflict");
+                return;
+            }
+        }
+        else
+        {
+            spSession = CreateSession(shard, spConn->strPrincipal);
+            if (!spSession)
+            {
+                spConn->bKeepAlive = false;
+                SendResponse(spConn, 503, "Service Unavailable");
+                return;
+            }
+            bOwnsSession = true;
+        }
+
+        std::unique_ptr<CMCPWebSocketCodec> upCodec(new CMCPWebSocketCodec(m_nMaxRequestBytes));
+        std::string strResponse = "HTTP/1.1 101 Switching Protocols\r\n"
+            "Upgrade: websocket\r\n"
+            "Connection: Upgrade\r\n"
+            "Sec-WebSocket-Accept: " + CMCPWebSocketCodec::GetAcceptKey(itrKey->second) + "\r\n";
+        auto itrProtocol = request.hashHeaders.find("sec-websocket-protocol");
+        if (itrProtocol != request.hashHeaders.end() && std::string::npos != itrProtocol->second.find("mcp"))
+            strResponse += "Sec-WebSocket-Protocol: mcp\r\n";
+        auto itrExtensions = request.hashHeaders.find("sec-websocket-extensions");
+        std::string strDeflate;
+        if (m_bWebSocketDeflate && itrExtensions != request.hashHeaders.end()
+            && upCodec->NegotiateDeflate(itrExtensions->second, m_nDeflateMinBytes, m_iDeflateLevel, strDeflate))
+            strResponse += "Sec-WebSocket-Extensions: " + strDeflate + "\r\n";
+        strResponse += "Mcp-Session-Id: " + spSession->GetSessionId() + "\r\n\r\n";
+
+        spConn->strSessionId = spSession->GetSessionId();
+        spConn->bOwnsSession = bOwnsSession;
+        spConn->upWebSocket = std::move(upCodec);
+        spConn->eState = ConnectionState_WebSocket;
+        shard.hashWebSockets[spConn->strSessionId] = spConn->ullId;
+        BindSessionOutput(spConn);
+        QueueOutput(spConn, strResponse.data(), strResponse.size());
+    }
+
+    void CHttpSseListener::ProcessFrames(const std::shared_ptr<HttpConnection>& spConn)
+    {
+        auto& codec = *spConn->upWebSocket;
+        size_t nOffset = 0;
+        std::string strPayload;
+        while (spConn->iFd >= 0 && !spConn->bCloseAfterFlush && nOffset < spConn->strInput.size())
+        {
+            size_t nConsumed = 0;
+            int iCloseCode = CMCPWebSocketCodec::CloseCode_Normal;
+            auto eResult = codec.Decode(spConn->strInput.data() + nOffset, spConn->strInput.size() - nOffset, nConsumed, strPayload, iCloseCode);
+            nOffset += nConsumed;
+            if (CMCPWebSocketCodec::DecodeResult_NeedMore == eResult)
+                break;
+
+            if (CMCPWebSocketCodec::DecodeResult_Message == eResult)
+            {
+                auto itrSession = spConn->pShard->hashSessions.find(spConn->strSessionId);
+                if (itrSession == spConn->pShard->hashSessions.end())
+                {
+                    CloseWebSocket(spConn, CMCPWebSocketCodec::CloseCode_GoingAway);
+                    break;
+                }
+                QueueIncoming(itrSession->second, std::move(strPayload));
+            }
+            else if (CMCPWebSocketCodec::DecodeResult_Ping == eResult)
+            {
+                std::string strPong;
+                CMCPWebSocketCodec::EncodeControl(CMCPWebSocketCodec::Opcode_Pong, strPayload.data(), strPayload.size(), strPong);
+                QueueOutput(spConn, strPong.data(), strPong.size());
+            }
+            else
+            {
+                // A close from the client is answered with its own status code.
+                if (CMCPWebSocketCodec::DecodeResult_Error == eResult)
+                    MCP_LOG_DEBUG("transport", "closing a WebSocket with status {}", iCloseCode);
+                CloseWebSocket(spConn, iCloseCode);
+            }
+        }
+        spConn->strInput.erase(0, nOffset);
+    }
+
+    bool CHttpSseListener::AuthenticateRequest(const std::shared_ptr<HttpConnection>& spConn, const HttpRequest& request)
+    {
+        if (!m_authenticator.IsEnabled())
+        {
+            spConn->strPrincipal.clear();
+            return true;
+        }
+
+        auto itrAuth = request.hashHeaders.find("authorization");
+        if (itrAuth != request.hashHeaders.end())
+        {
+            // Validated on this connection already: the header is compared, not verified again.
+            if (!spConn->strPrincipal.empty() && spConn->uAuthGeneration == m_authenticator.GetGeneration()
+                && spConn->ullAuthExpiresMs > CMCPAuthenticator::NowMs() && itrAuth->second == spConn->strAuthorization)
+                return true;
+
+            AuthResult result;
+            unsigned int uGeneration = m_authenticator.GetGeneration();
+            if (ERRNO_OK == m_authenticator.Authenticate(itrAuth->second, result))
+            {
+                spConn->strAuthorization = itrAuth->second;
+                spConn->strPrincipal = result.strPrincipal;
+                spConn->ullAuthExpiresMs = result.ullExpiresAtMs;
+                spConn->uAuthGeneration = uGeneration;
+                return true;
+            }
+        }
+
+        spConn->strAuthorization.clear();
+        spConn->strPrincipal.clear();
+        SendResponse(spConn, 401, "Unauthorized");
+        return false;
+    }
+
+    std::shared_ptr<CHttpSseTransport> CHttpSseListener::FindSession(const std::shared_ptr<HttpConnection>& spConn, const HttpRequest& request)
+    {
+        auto itrHeader = request.hashHeaders.find("mcp-session-id");
+        if (itrHeader == request.hashHeaders.end())
+        {
+            SendResponse(spConn, 400, "Bad Request");
+            return nullptr;
+        }
+        auto& hashSessions = spConn->pShard->hashSessions;
+        auto itrSession = hashSessions.find(itrHeader->second);
+        if (itrSession == hashSessions.end())
+        {
+            // Unknown or ended session: the client has to initialize again.
+            SendResponse(spConn, 404, "Not Found");
+            return nullptr;
+        }
+        if (itrSession->second->GetPrincipal() != spConn->strPrincipal)
+        {
+            SendResponse(spConn, 403, "Forbidden");
+            return nullptr;
+        }
+
+        return itrSession->second;
+    }
+
+    std::shared_ptr<CHttpSseTransport> CHttpSseListener::CreateSession(HttpShard& shard, const std::string& strPrincipal)
+    {
+        std::string strSessionId;
+        {
+            std::unique_lock<std::mutex> _lock(m_mtxDirectory);
+            do
+            {
+                strSessionId = GenerateSessionId();
+            } while (m_hashSessionShards.count(strSessionId));
+            m_hashSessionShards[strSessionId] = shard.nIndex;
+        }
+
+        auto spSession = std::make_shared<CHttpSseTransport>(shared_from_this(), strSessionId);
+        spSession->m_nShard = shard.nIndex;
+        spSession->m_strPrincipal = strPrincipal;
+        shard.hashSessions[strSessionId] = spSession;
+        ++shard.nSessions;
+        m_fnOnAccept(spSession);
+
+        // The server refuses a session (e.g. while shutting down) by disconnecting it right away.
+        bool bStopped = false;
+        {
+            std::unique_lock<std::mutex> _lock(spSession->m_mtxIncoming);
+            bStopped = spSession->m_bStopped;
+        }
+        if (bStopped)
+        {
+            RemoveSession(shard, strSessionId);
+            return nullptr;
+        }
+
+        return spSession;
+    }
+
+    void CHttpSseListener::RemoveSession(HttpShard& shard, const std::string& strSessionId)
+    {
+        auto itrSession = shard.hashSessions.find(strSessionId);
+        if (itrSession == shard.hashSessions.end())
+        {
+            // Moved to another loop before the removal got here.
+            size_t nOwner = shard.nIndex;
+            {
+                std::unique_lock<std::mutex> _lock(m_mtxDirectory);
+                auto itrOwner = m_hashSessionShards.find(strSessionId);
+                if (itrOwner != m_hashSessionShards.end())
+                    nOwner = itrOwner->second;
+            }
+            if (nOwner != shard.nIndex)
+                Post(nOwner, [this, nOwner, strSessionId]() { RemoveSession(*m_vecShards[nOwner], strSessionId); });
+            return;
+        }
+        shard.hashSessions.erase(itrSession);
+        --shard.nSessions;
+        {
+            std::unique_lock<std::mutex> _lock(m_mtxDirectory);
+            m_hashSessionShards.erase(strSessionId);
+        }
+
+        // Nothing will answer on the streams of the session any more.
+        std::vector<std::shared_ptr<HttpConnection>> vecStreams;
+        for (auto& itrConn : shard.hashConnections)
+        {
+            if (ConnectionState_Reading != itrConn.second->eState && itrConn.second->strSessionId == strSessionId)
+                vecStreams.push_back(itrConn.second);
+        }
+        for (auto& spConn : vecStreams)
+        {
+            if (ConnectionState_WebSocket == spConn->eState)
+                CloseWebSocket(spConn, CMCPWebSocketCodec::CloseCode_Normal);
+            else
+                CloseConnection(spConn);
+        }
+    }
+
+    void CHttpSseListener::QueueIncoming(const std::shared_ptr<CHttpSseTransport>& spSession, std::string&& strMsg)
+    {
+        size_t nSize = strMsg.size();
+        if (!spSession->Push(std::move(strMsg)))
+            return;
+
+        size_t nPending = m_nPendingInputBytes.fetch_add(nSize) + nSize;
+        if (nPending > m_nMaxPendingInputBytes && !m_bInputPaused.exchange(true))
+            PauseReading(true);
+    }
+
+    void CHttpSseListener::SendResponse(const std::shared_ptr<HttpConnection>& spConn, int iStatus, const char* lpcszReason, const std::string& strBody,
+        const char* lpcszContentType)
+    {
+        std::string strResponse = "HTTP/1.1 " + std::to_string(iStatus) + " " + lpcszReason + "\r\n";
+        if (!strBody.empty())
+            strResponse += std::string("Content-Type: ") + lpcszContentType + "\r\n";
+        strResponse += "Content-Length: " + std::to_string(strBody.size()) + "\r\n";
+        if (!spConn->bKeepAlive)
+            strResponse += "Connection: close\r\n";
+        strResponse += "\r\n";
+        strResponse += strBody;
+
+        if (!spConn->bKeepAlive)
+            spConn->bCloseAfterFlush = true;
+        QueueOutput(spConn, strResponse.data(), strResponse.size());
+    }
+
+    void CHttpSseListener::StartEventStream(const std::shared_ptr<HttpConnection>& spConn)
+    {
+        std::string strHeader = "HTTP/1.1 200 OK\r\n"
+            "Content-Type: text/event-stream\r\n"
+            "Cache-Control: no-cache\r\n"
+            "Transfer-Encoding: chunked\r\n";
+        if (!spConn->strSessionId.empty())
+            strHeader += "Mcp-Session-Id: " + spConn->strSessionId + "\r\n";
+        if (!spConn->bKeepAlive)
+            strHeader += "Connection: close\r\n";
+        strHeader += "\r\n";
+
+        BindSessionOutput(spConn);
+        QueueOutput(spConn, strHeader.data(), strHeader.size());
+    }
+
+    void CHttpSseListener::BindSessionOutput(const std::shared_ptr<HttpConnection>& spConn)
+    {
+        // What the connection still holds of a previous stream leaves the account of its session.
+        if (spConn->spSessionOutput)
+            *spConn->spSessionOutput -= spConn->nAccountedBytes;
+        spConn->nAccountedBytes = 0;
+        spConn->spSessionOutput.reset();
+        auto itrSession = spConn->pShard->hashSessions.find(spConn->strSessionId);
+        if (itrSession != spConn->pShard->hashSessions.end())
+            spConn->spSessionOutput = itrSession->second->m_spPendingOutput;
+    }
+
+    void CHttpSseListener::SendEvent(const std::shared_ptr<HttpConnection>& spConn, const char* pData, size_t nLength)
+    {
+        // One SSE event per chunk: "data: <json>\n\n"
+        char szChunkSize[32];
+        int iPrefix = snprintf(szChunkSize, sizeof(szChunkSize), "%zx\r\n", nLength + 8);
+        std::string strChunk;
+        strChunk.reserve(static_cast<size_t>(iPrefix) + nLength + 10);
+        strChunk.append(szChunkSize, static_cast<size_t>(iPrefix));
+        strChunk.append("data: ", 6);
+        strChunk.append(pData, nLength);
+        strChunk.append("\n\n\r\n", 4);
+        QueueOutput(spConn, strChunk.data(), strChunk.size());
+    }
+
+    void CHttpSseListener::FinishEventStream(const std::shared_ptr<HttpConnection>& spConn)
+    {
+        QueueOutput(spConn, "0\r\n\r\n", 5);
+        if (spConn->iFd < 0)
+            return;
+
+        auto& shard = *spConn->pShard;
+        if (!spConn->strRequestKey.empty())
+            shard.hashPendingRequests.erase(spConn->strRequestKey);
+        if (!spConn->strProgressKey.empty())
+            shard.hashProgressTokens.erase(spConn->strProgressKey);
+        spConn->strRequestKey.clear();
+        spConn->vecRequestIds.clear();
+        spConn->strProgressKey.clear();
+        spConn->eState = ConnectionState_Reading;
+        if (!spConn->bKeepAlive)
+        {
+            spConn->bCloseAfterFlush = true;
+            FlushOutput(spConn);
+            return;
+        }
+
+        // Requests pipelined behind the stream.
+        ProcessInput(spConn);
+    }
+
+    void CHttpSseListener::RouteOutgoing(HttpShard& shard, const std::string& strSessionId, const std::string& strMsg)
+    {
+        if (!shard.hashSessions.count(strSessionId))
+        {
+            // The session was moved to another loop after the message was posted here.
+            size_t nOwner = shard.nIndex;
+            {
+                std::unique_lock<std::mutex> _lock(m_mtxDirectory);
+                auto itrOwner = m_hashSessionShards.find(strSessionId);
+                if (itrOwner != m_hashSessionShards.end())
+                    nOwner = itrOwner->second;
+            }
+            if (nOwner != shard.nIndex)
+                Post(nOwner, [this, nOwner, strSessionId, strMsg]() { RouteOutgoing(*m_vecShards[nOwner], strSessionId, strMsg); });
+            return;
+        }
+
+        size_t nLength = strMsg.size();
+        while (nLength > 0 && ('\n' == strMsg[nLength - 1] || '\r' == strMsg[nLength - 1]))
+            --nLength;
+
+        std::vector<std::pair<const char*, const char*>> vecElements;
+        if (SplitArray(strMsg.data(), strMsg.data() + nLength, vecElements))
+        {
+            // The responses to a batch end its stream, registered under one of its requests.
+            for (auto& element : vecElements)
+            {
+                const char* pId = nullptr;
+                const char* pIdEnd = nullptr;
+                if (!FindMember(element.first, element.second, MSG_KEY_ID, pId, pIdEnd))
+                    continue;
+                auto itrPending = shard.hashPendingRequests.find(strSessionId + '\n' + std::string(pId, pIdEnd));
+                if (itrPending == shard.hashPendingRequests.end())
+                    continue;
+                auto itrConn = shard.hashConnections.find(itrPending->second);
+                if (itrConn == shard.hashConnections.end())
+                    return;
+                SendEvent(itrConn->second, strMsg.data(), nLength);
+                FinishEventStream(itrConn->second);
+                return;
+            }
+            SendToWebSocket(shard, strSessionId, strMsg.data(), nLength);
+            return;
+        }
+
+        std::string strMethod;
+        std::string strId;
+        bool bHasMethod = FindMember(strMsg, MSG_KEY_METHOD, strMethod);
+        bool bHasId = FindMember(strMsg, MSG_KEY_ID, strId);
+
+        std::shared_ptr<HttpConnection> spTarget;
+        if (bHasId && !bHasMethod)
+        {
+            // A response ends the stream of its request.
+            auto itrPending = shard.hashPendingRequests.find(strSessionId + '\n' + strId);
+            if (itrPending == shard.hashPendingRequests.end())
+            {
+                // Requests received over a WebSocket are answered on it.
+                SendToWebSocket(shard, strSessionId, strMsg.data(), nLength);
+                return;
+            }
+            auto itrConn = shard.hashConnections.find(itrPending->second);
+            if (itrConn == shard.hashConnections.end())
+                return;
+            spTarget = itrConn->second;
+            SendEvent(spTarget, strMsg.data(), nLength);
+            FinishEventStream(spTarget);
+            return;
+        }
+
+        std::string strToken;
+        if (bHasMethod && strMethod == std::string("\"") + METHOD_NOTIFICATION_PROGRESS + "\"" && FindProgressToken(strMsg, false, strToken))
+        {
+            auto itrToken = shard.hashProgressTokens.find(strSessionId + '\n' + strToken);
+            if (itrToken != shard.hashProgressTokens.end())
+            {
+                auto itrConn = shard.hashConnections.find(itrToken->second);
+                if (itrConn != shard.hashConnections.end())
+                    spTarget = itrConn->second;
+            }
+        }
+        if (spTarget)
+        {
+            SendEvent(spTarget, strMsg.data(), nLength);
+            return;
+        }
+
+        // Everything else goes to the WebSocket of the session, or else to its standalone streams;
+        // without either it is dropped.
+        if (SendToWebSocket(shard, strSessionId, strMsg.data(), nLength))
+            return;
+        std::vector<std::shared_ptr<HttpConnection>> vecStandalone;
+        for (auto& itrConn : shard.hashConnections)
+        {
+            if (ConnectionState_Standalone == itrConn.second->eState && itrConn.second->strSessionId == strSessionId)
+                vecStandalone.push_back(itrConn.second);
+        }
+        for (auto& spConn : vecStandalone)
+        {
+            SendEvent(spConn, strMsg.data(), nLength);
+        }
+    }
+
+    bool CHttpSseListener::SendToWebSocket(HttpShard& shard, const std::string& strSessionId, const char* pData, size_t nLength)
+    {
+        auto itrSocket = shard.hashWebSockets.find(strSessionId);
+        if (itrSocket == shard.hashWebSockets.end())
+            return false;
+        auto itrConn = shard.hashConnections.find(itrSocket->second);
+        if (itrConn == shard.hashConnections.end())
+            return false;
+
+        auto spConn = itrConn->second;
+        if (spConn->bCloseAfterFlush)
+            return true;
+        std::string strFrame;
+        spConn->upWebSocket->EncodeMessage(pData, nLength, strFrame);
+        QueueOutput(spConn, strFrame.data(), strFrame.size());
+
+        return true;
+    }
+
+    void CHttpSseListener::CloseWebSocket(const std::shared_ptr<HttpConnection>& spConn, int iCloseCode)
+    {
+        std::string strFrame;
+        CMCPWebSocketCodec::EncodeClose(iCloseCode, strFrame);
+        spConn->bCloseAfterFlush = true;
+        QueueOutput(spConn, strFrame.data(), strFrame.size());
+    }
+
+    void CHttpSseListener::QueueOutput(const std::shared_ptr<HttpConnection>& spConn, const char* pData, size_t nLength)
+    {
+        if (spConn->iFd < 0)
+            return;
+
+        // Nothing queued: try to write directly and only keep what the socket did not take.
+        if (spConn->strOutput.size() == spConn->nOutputOffset)
+        {
+            spConn->strOutput.clear();
+            spConn->nOutputOffset = 0;
+            while (nLength > 0)
+            {
+                ssize_t nSent = send(spConn->iFd, pData, nLength, MCP_SEND_FLAGS);
+                if (nSent > 0)
+                {
+                    pData += nSent;
+                    nLength -= static_cast<size_t>(nSent);
+                    continue;
+                }
+                if (nSent < 0 && EINTR == errno)
+                    continue;
+                if (nSent < 0 && (EAGAIN == errno || EWOULDBLOCK == errno))
+                    break;
+
+                MCP_LOG_DEBUG("transport", "send failed with errno {}, closing the connection", errno);
+                CloseConnection(spConn);
+                return;
+            }
+        }
+
+        if (nLength > 0)
+        {
+            spConn->strOutput.append(pData, nLength);
+            if (spConn->spSessionOutput)
+            {
+                *spConn->spSessionOutput += nLength;
+                spConn->nAccountedBytes += nLength;
+            }
+            if (spConn->strOutput.size() - spConn->nOutputOffset > m_nMaxOutputBytes)
+            {
+                // The client does not keep up with its stream.
+                MCP_LOG_WARNING("transport", "dropping a connection with {} bytes of output pending", spConn->strOutput.size() - spConn->nOutputOffset);
+                CloseConnection(spConn);
+                return;
+            }
+        }
+        else if (spConn->bCloseAfterFlush)
+        {
+            CloseConnection(spConn);
+            return;
+        }
+
+        UpdateInterest(spConn);
+    }
+
+    void CHttpSseListener::FlushOutput(const std::shared_ptr<HttpConnection>& spConn)
+    {
+        while (spConn->nOutputOffset < spConn->strOutput.size())
+        {
+            ssize_t nSent = send(spConn->iFd, spConn->strOutput.data() + spConn->nOutputOffset, spConn->strOutput.size() - spConn->nOutputOffset, MCP_SEND_FLAGS);
+            if (nSent > 0)
+            {
+                spConn->nOutputOffset += static_cast<size_t>(nSent);
+                continue;
+            }
+            if (nSent < 0 && EINTR == errno)
+                continue;
+            if (nSent < 0 && (EAGAIN == errno || EWOULDBLOCK == errno))
+                break;
+
+            MCP_LOG_DEBUG("transport", "send failed with errno {}, closing the connection", errno);
+            CloseConnection(spConn);
+            return;
+        }
+
+        SettleOutput(spConn);
+        if (spConn->nOutputOffset == spConn->strOutput.size())
+        {
+            spConn->strOutput.clear();
+            spConn->nOutputOffset = 0;
+            if (spConn->bCloseAfterFlush)
+            {
+                CloseConnection(spConn);
+                return;
+            }
+        }
+        else if (spConn->nOutputOffset > spConn->strOutput.size() / 2)
+        {
+            spConn->strOutput.erase(0, spConn->nOutputOffset);
+            spConn->nOutputOffset = 0;
+        }
+
+        UpdateInterest(spConn);
+        // Reading may have been paused by the output backlog.
+        if (ConnectionState_Reading == spConn->eState && !spConn->bReadPaused)
+            ProcessInput(spConn);
+    }
+
+    void CHttpSseListener::UpdateInterest(const std::shared_ptr<HttpConnection>& spConn)
+    {
+        if (!spConn->pShard)
+            return;
+
+        size_t nPendingOutput = spConn->strOutput.size() - spConn->nOutputOffset;
+        spConn->bReadPaused = nPendingOutput > m_nOutputHighWatermark
+            || (ConnectionState_Reading != spConn->eState && ConnectionState_WebSocket != spConn->eState && spConn->strInput.size() > m_nMaxRequestBytes);
+
+        unsigned int nEvents = 0;
+        if (!spConn->pShard->bReadPaused && !spConn->bReadPaused)
+            nEvents |= CMCPEventLoop::EventFlags_Read;
+        if (nPendingOutput > 0)
+            nEvents |= CMCPEventLoop::EventFlags_Write;
+        spConn->pShard->eventLoop.Modify(spConn->iFd, nEvents);
+    }
+
+    void CHttpSseListener::SettleOutput(const std::shared_ptr<HttpConnection>& spConn)
+    {
+        // The accounted bytes are the tail of strOutput, so they leave it last.
+        size_t nUnsent = spConn->iFd < 0 ? 0 : spConn->strOutput.size() - spConn->nOutputOffset;
+        if (spConn->nAccountedBytes <= nUnsent)
+            return;
+        if (spConn->spSessionOutput)
+            *spConn->spSessionOutput -= spConn->nAccountedBytes - nUnsent;
+        spConn->nAccountedBytes = nUnsent;
+    }
+
+    void CHttpSseListener::CloseConnection(const std::shared_ptr<HttpConnection>& spConn)
+    {
+        if (spConn->iFd < 0)
+            return;
+
+        auto& shard = *spConn->pShard;
+        shard.eventLoop.Remove(spConn->iFd);
+        close(spConn->iFd);
+        spConn->iFd = -1;
+        SettleOutput(spConn);
+
+        if (!spConn->strProgressKey.empty())
+            shard.hashProgressTokens.erase(spConn->strProgressKey);
+        if (!spConn->strRequestKey.empty())
+        {
+            shard.hashPendingRequests.erase(spConn->strRequestKey);
+
+            // Nobody is left to receive the result: let the session cancel the work. Delivered from
+            // its own loop task, as the connection may be closed while the session is writing.
+            auto itrSession = shard.hashSessions.find(spConn->strSessionId);
+            if (itrSession != shard.hashSessions.end())
+            {
+                auto spSession = itrSession->second;
+                for (auto& strRequestId : spConn->vecRequestIds)
+                {
+                    std::string strCancel = std::string("{\"jsonrpc\":\"2.0\",\"method\":\"") + METHOD_NOTIFICATION_CANCELLED
+                        + "\",\"params\":{\"requestId\":" + strRequestId + ",\"reason\":\"client disconnected\"}}";
+                    Post(shard.nIndex, [this, spSession, strCancel]()
+                        {
+                            std::string strMsg = strCancel;
+                            QueueIncoming(spSession, std::move(strMsg));
+                        });
+                }
+            }
+        }
+
+        if (ConnectionState_WebSocket == spConn->eState)
+        {
+            auto itrSocket = shard.hashWebSockets.find(spConn->strSessionId);
+            if (itrSocket != shard.hashWebSockets.end() && itrSocket->second == spConn->ullId)
+                shard.hashWebSockets.erase(itrSocket);
+
+            // A session opened by the upgrade ends with its connection, cancelling its tasks.
+            auto itrSession = shard.hashSessions.find(spConn->strSessionId);
+            if (spConn->bOwnsSession && itrSession != shard.hashSessions.end())
+            {
+                auto spSession = itrSession->second;
+                size_t nShard = shard.nIndex;
+                Post(nShard, [this, nShard, spSession]()
+                    {
+                        RemoveSession(*m_vecShards[nShard], spSession->GetSessionId());
+                        spSession->CloseIncoming();
+                    });
+            }
+        }
+
+        shard.hashConnections.erase(spConn->ullId);
+        --shard.nConnections;
+    }
+
+    void CHttpSseListener::PauseReading(bool bPause)
+    {
+        for (auto& upShard : m_vecShards)
+        {
+            HttpShard* pShard = upShard.get();
+            Post(pShard->nIndex, [this, pShard, bPause]()
+                {
+                    pShard->bReadPaused = bPause;
+                    for (auto& itrConn : pShard->hashConnections)
+                    {
+                        UpdateInterest(itrConn.second);
+                    }
+                });
+        }
+    }
+
+    void CHttpSseListener::OnTick(HttpShard& shard)
+    {
+        auto tpNow = std::chrono::steady_clock::now();
+        std::vector<std::shared_ptr<HttpConnection>> vecIdle;
+        for (auto& itrConn : shard.hashConnections)
+        {
+            auto& spConn = itrConn.second;
+            if (ConnectionState_Reading == spConn->eState && spConn->strOutput.empty() && tpNow - spConn->tpLastActive > m_durKeepAliveTimeout)
+                vecIdle.push_back(spConn);
+        }
+        for (auto& spConn : vecIdle)
+        {
+            CloseConnection(spConn);
+        }
+
+        // Proxies drop connections that look dead; a ping keeps idle WebSockets open.
+        if (m_durPingInterval.count() > 0)
+        {
+            std::vector<std::shared_ptr<HttpConnection>> vecPing;
+            for (auto& itrConn : shard.hashConnections)
+            {
+                auto& spConn = itrConn.second;
+                if (ConnectionState_WebSocket == spConn->eState && !spConn->bCloseAfterFlush && tpNow - spConn->tpLastActive > m_durPingInterval)
+                    vecPing.push_back(spConn);
+            }
+            for (auto& spConn : vecPing)
+            {
+                std::string strPing;
+                CMCPWebSocketCodec::EncodeControl(CMCPWebSocketCodec::Opcode_Ping, "", 0, strPing);
+                spConn->tpLastActive = tpNow;
+                QueueOutput(spConn, strPing.data(), strPing.size());
+            }
+        }
+
+        Rebalance(shard);
+    }
+
+    void CHttpSseListener::Rebalance(HttpShard& shard)
+    {
+        if (0 == m_nRebalanceThreshold || m_vecShards.size() < 2)
+            return;
+
+        size_t nTotal = 0;
+        for (auto& upShard : m_vecShards)
+        {
+            nTotal += upShard->nSessions;
+        }
+        size_t nAverage = (nTotal + m_vecShards.size() - 1) / m_vecShards.size();
+        size_t nLimit = std::max(nAverage * m_nRebalanceThreshold / 100, nAverage + 1);
+        size_t nOwn = shard.nSessions;
+        if (nOwn <= nLimit)
+            return;
+
+        // Sessions with an open stream stay: their connections and routing state live here.
+        std::unordered_map<std::string, bool> hashBusy;
+        for (auto& itrConn : shard.hashConnections)
+        {
+            if (ConnectionState_Reading != itrConn.second->eState)
+                hashBusy[itrConn.second->strSessionId] = true;
+        }
+
+        std::vector<std::shared_ptr<CHttpSseTransport>> vecMove;
+        size_t nMove = std::min(nOwn - nLimit, REBALANCE_BATCH);
+        for (auto& itrSession : shard.hashSessions)
+        {
+            if (vecMove.size() >= nMove)
+                break;
+            if (!hashBusy.count(itrSession.first))
+                vecMove.push_back(itrSession.second);
+        }
+
+        for (auto& spSession : vecMove)
+        {
+            size_t nTarget = LeastLoadedShard(true);
+            if (nTarget == shard.nIndex)
+                break;
+
+            const std::string& strSessionId = spSession->GetSessionId();
+            auto& target = *m_vecShards[nTarget];
+            shard.hashSessions.erase(strSessionId);
+            --shard.nSessions;
+            ++shard.ullSessionsMovedOut;
+            ++target.nSessions;
+            spSession->m_nShard = nTarget;
+
+            // Posted under the directory lock, so a loop that finds the new owner there and hands
+            // it a connection always posts behind the session.
+            std::unique_lock<std::mutex> _lock(m_mtxDirectory);
+            m_hashSessionShards[strSessionId] = nTarget;
+            Post(nTarget, [this, nTarget, spSession]()
+                {
+                    auto& target = *m_vecShards[nTarget];
+                    target.hashSessions[spSession->GetSessionId()] = spSession;
+                    ++target.ullSessionsMovedIn;
+                });
+        }
+    }
+#else
+    void CHttpSseListener::OnAccept() {}
+    void CHttpSseListener::AddConnection(HttpShard&, const std::shared_ptr<HttpConnection>&) {}
+    void CHttpSseListener::MoveConnection(const std::shared_ptr<HttpConnection>&, size_t) {}
+    size_t CHttpSseListener::LeastLoadedShard(bool) const { return 0; }
+    void CHttpSseListener::OnConnectionEvent(const std::shared_ptr<HttpConnection>&, unsigned int) {}
+    void CHttpSseListener::ProcessInput(const std::shared_ptr<HttpConnection>&) {}
+    long long CHttpSseListener::ParseRequest(const std::shared_ptr<HttpConnection>&, HttpRequest&) { return PARSE_BAD_REQUEST; }
+    bool CHttpSseListener::FindOwningShard(const std::shared_ptr<HttpConnection>&, const HttpRequest&, size_t&) { return false; }
+    void CHttpSseListener::HandleRequest(const std::shared_ptr<HttpConnection>&, HttpRequest&) {}
+    void CHttpSseListener::HandlePost(const std::shared_ptr<HttpConnection>&, HttpRequest&) {}
+    void CHttpSseListener::HandleDelete(const std::shared_ptr<HttpConnection>&, HttpRequest&) {}
+    void CHttpSseListener::HandleUpgrade(const std::shared_ptr<HttpConnection>&, HttpRequest&) {}
+    void CHttpSseListener::ProcessFrames(const std::shared_ptr<HttpConnection>&) {}
+    std::shared_ptr<CHttpSseTransport> CHttpSseListener::FindSession(const std::shared_ptr<HttpConnection>&, const HttpRequest&) { return nullptr; }
+    bool CHttpSseListener::AuthenticateRequest(const std::shared_ptr<HttpConnection>&, const HttpRequest&) { return false; }
+    std::shared_ptr<CHttpSseTransport> CHttpSseListener::CreateSession(HttpShard&, const std::string&) { return nullptr; }
+    void CHttpSseListener::RemoveSession(HttpShard&, const std::string&) {}
+    void CHttpSseListener::QueueIncoming(const std::shared_ptr<CHttpSseTransport>&, std::string&&) {}
+    void CHttpSseListener::SendResponse(const std::shared_ptr<HttpConnection>&, int, const char*, const std::string&, const char*) {}
+    void CHttpSseListener::BindSessionOutput(const std::shared_ptr<HttpConnection>&) {}
+    void CHttpSseListener::StartEventStream(const std::shared_ptr<HttpConnection>&) {}
+    void CHttpSseListener::SendEvent(const std::shared_ptr<HttpConnection>&, const char*, size_t) {}
+    void CHttpSseListener::FinishEventStream(const std::shared_ptr<HttpConnection>&) {}
+    bool CHttpSseListener::SendToWebSocket(HttpShard&, const std::string&, const char*, size_t) { return false; }
+    void CHttpSseListener::CloseWebSocket(const std::shared_ptr<HttpConnection>&, int) {}
+    void CHttpSseListener::RouteOutgoing(HttpShard&, const std::string&, const std::string&) {}
+    void CHttpSseListener::QueueOutput(const std::shared_ptr<HttpConnection>&, const char*, size_t) {}
+    void CHttpSseListener::FlushOutput(const std::shared_ptr<HttpConnection>&) {}
+    void CHttpSseListener::SettleOutput(const std::shared_ptr<HttpConnection>&) {}
+    void CHttpSseListener::UpdateInterest(const std::shared_ptr<HttpConnection>&) {}
+    void CHttpSseListener::CloseConnection(const std::shared_ptr<HttpConnection>&) {}
+    void CHttpSseListener::PauseReading(bool) {}
+    void CHttpSseListener::OnTick(HttpShard&) {}
+    void CHttpSseListener::Rebalance(HttpShard&) {}
+#endif
+}
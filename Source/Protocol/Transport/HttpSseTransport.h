@@ -1,36 +1,315 @@
 #pragma once
-// HTTP + Server-Sent Events transport scaffold (stub implementation)
-// This class provides an interface-compatible transport that can be
-// implemented later with a real HTTP client and SSE stream handling.
+// Streamable HTTP transport (MCP 2025-06-18) served from a non-blocking event loop.
+//
+// Clients POST JSON-RPC messages to a single endpoint (default /mcp). A POSTed request is
+// answered on the same HTTP/1.1 connection with a chunked text/event-stream carrying the
+// progress notifications of that request and finally its response; notifications and responses
+// from the client are acknowledged with 202. A POSTed batch holding requests is answered with
+// a stream carrying one event, the array of their responses. A GET on the endpoint opens a
+// standalone SSE stream for the other server-initiated messages. Connections are kept alive
+// between requests.
+//
+// Every client gets its own session: the initialize request creates it and its response carries
+// an Mcp-Session-Id header which the client sends with all later requests (DELETE ends it).
+// CHttpSseListener owns the sockets and hands one CHttpSseTransport per session to the server.
+//
+// Connections are spread over N event loop threads ([http] event_loops, one per core by default).
+// A session lives on the loop that accepted its initialize request: its messages are processed
+// and its streams written on that thread only, and results produced elsewhere (tool workers) are
+// posted to it. A connection carrying a request for a session of another loop is handed over to
+// that loop. Loops holding far more sessions than the average give idle sessions to the least
+// loaded loop.
+//
+// Back-pressure: a connection whose pending output exceeds the high watermark stops being read
+// until the client catches up (and is dropped beyond the hard limit), and all reading pauses
+// while the sessions have not consumed the messages already received.
+//
+// With [auth] enabled every request needs an Authorization: Bearer header (see CMCPAuthenticator).
+// A connection remembers the header it was validated with until the credentials expire, so the
+// later requests of a kept alive connection only compare the header. A session belongs to the
+// principal that initialized it; requests of another principal get 403.
+//
+// A GET on the endpoint with Upgrade: websocket switches the connection to WebSocket ([websocket]),
+// for clients behind proxies that do not pass SSE through: every message travels as one frame in
+// either direction. The upgrade creates a session, which ends with the connection, unless it names
+// one with Mcp-Session-Id. The messages of the session then all go to the WebSocket, except the
+// answers to requests POSTed over HTTP. permessage-deflate is negotiated when offered (see CMCPWebSocketCodec).
 
 #include <string>
+#include <vector>
 #include <memory>
+#include <deque>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <functional>
 #include "Transport.h"
+#include "EventLoop.h"
+#include "Authenticator.h"
+#include "WebSocket.h"
 #include "../Public/Config.h"
 
 namespace MCP
 {
+    class CHttpSseListener;
+
+    struct HttpShardStats
+    {
+        size_t nConnections{ 0 };
+        size_t nSessions{ 0 };
+        unsigned long long ullSessionsMovedIn{ 0 };
+        unsigned long long ullSessionsMovedOut{ 0 };
+        unsigned long long ullConnectionsMovedIn{ 0 };
+    };
+
+    // The messages of one client session. Created by CHttpSseListener.
     class CHttpSseTransport : public CMCPTransport
     {
     public:
+        CHttpSseTransport(const std::weak_ptr<CHttpSseListener>& wpListener, const std::string& strSessionId);
+        ~CHttpSseTransport();
+
         int Connect() override;
+        // Ends the session: its streams are closed and later requests carrying its id get 404.
         int Disconnect() override;
+        // Blocks until the client POSTs a message or the session ends.
         int Read(std::string& strOut) override;
+        // Thread safe: the message is handed to the event loop and routed to the stream of its request.
         int Write(const std::string& strIn) override;
         int Error(const std::string& strIn) override;
+        // Messages are then processed on the event loop thread owning the session.
+        bool SetFrameHandler(FrameHandler fnOnFrame, CloseHandler fnOnClose) override;
+
+        const std::string& GetSessionId() const;
+        // The principal that initialized the session; empty when authentication is disabled.
+        const std::string& GetPrincipal() const override;
+        // Every request of the session was authenticated by the listener.
+        bool IsAuthenticated() const override;
+        // Messages posted to the event loop and stream output of the session not sent yet.
+        size_t GetPendingOutputBytes() const override;
+
+    private:
+        friend class CHttpSseListener;
+
+        // Loop thread: hands a message received from the client to the session.
+        // Returns false if the message was not queued (push mode or closed).
+        bool Push(std::string&& strMsg);
+        // Makes Read() return once the queue is drained, or calls the close handler.
+        void CloseIncoming();
+        bool IsPushMode() const;
+
+        std::weak_ptr<CHttpSseListener> m_wpListener;
+        std::string m_strSessionId;
+        std::string m_strPrincipal;
+        // Shared with the connections streaming to the session, which may outlive it.
+        std::shared_ptr<std::atomic<size_t>> m_spPendingOutput{ std::make_shared<std::atomic<size_t>>(0) };
+        // Index of the event loop owning the session; changes when the session is rebalanced.
+        std::atomic<size_t> m_nShard{ 0 };
+        FrameHandler m_fnOnFrame;
+        CloseHandler m_fnOnClose;
+
+        std::mutex m_mtxIncoming;
+        std::condition_variable m_cvIncoming;
+        std::deque<std::string> m_queueIncoming;
+        bool m_bStopped{ false };
+    };
+
+    class CHttpSseListener : public CMCPListener, public std::enable_shared_from_this<CHttpSseListener>
+    {
+    public:
+        ~CHttpSseListener();
 
+        // Binds [server] host:port and starts the event loop threads.
+        // The listener must be owned by a std::shared_ptr.
+        int Listen(AcceptCallback fnOnAccept) override;
+        int Close() override;
+
+        // Only the path of the url is used, e.g. "http://127.0.0.1:9000/mcp" serves /mcp.
         void SetEndpoint(const std::string& url);
+        // Accepts bearerToken as an API key in addition to those of [auth], and enables authentication.
         void SetAuthorization(const std::string& bearerToken);
+        // Answers GET on [metrics] prometheus_path with the returned text (Prometheus exposition format).
+        // Called on an event loop thread; set before Listen().
+        void SetMetricsHandler(std::function<std::string()> fnMetrics);
         void LoadConfig();
 
+        // Bound port, useful when [server] port is 0.
+        int GetPort() const;
+        // One entry per event loop.
+        std::vector<HttpShardStats> GetShardStats() const;
+
     private:
+        friend class CHttpSseTransport;
+        struct HttpShard;
+
+        enum ConnectionState
+        {
+            ConnectionState_Reading,        // waiting for the next request
+            ConnectionState_Streaming,      // SSE stream answering a POSTed request
+            ConnectionState_Standalone,     // SSE stream opened by GET
+            ConnectionState_WebSocket,      // upgraded, carries every message of its session
+        };
+
+        struct HttpConnection
+        {
+            unsigned long long ullId{ 0 };
+            int iFd{ -1 };
+            ConnectionState eState{ ConnectionState_Reading };
+            std::string strInput;
+            std::string strOutput;
+            size_t nOutputOffset{ 0 };
+            bool bKeepAlive{ true };
+            bool bCloseAfterFlush{ false };
+            bool bReadPaused{ false };
+            std::string strSessionId;       // session of the stream being served
+            std::string strRequestKey;      // routing key of the request being answered, the first of a batch
+            std::vector<std::string> vecRequestIds; // raw JSON ids of the requests being answered
+            std::string strProgressKey;     // routing key of its progress token
+            bool bProcessing{ false };      // inside ProcessInput(), which must not recurse
+            HttpShard* pShard{ nullptr };   // event loop serving the connection
+            std::string strAuthorization;   // Authorization header validated last
+            std::string strPrincipal;       // ... the principal it names
+            unsigned long long ullAuthExpiresMs{ 0 };
+            unsigned int uAuthGeneration{ 0 };
+            // Pending output of the session being streamed to; nAccountedBytes of strOutput count there.
+            std::shared_ptr<std::atomic<size_t>> spSessionOutput;
+            size_t nAccountedBytes{ 0 };
+            std::chrono::steady_clock::time_point tpLastActive;
+            std::unique_ptr<CMCPWebSocketCodec> upWebSocket;
+            bool bOwnsSession{ false };     // the upgrade created the session, which ends with the connection
+        };
+
+        // One event loop thread and everything only that thread touches.
+        struct HttpShard
+        {
+            size_t nIndex{ 0 };
+            CMCPEventLoop eventLoop;
+            std::thread thrLoop;
+            // Guards posting to the loop against Close().
+            std::mutex mtxPost;
+            bool bOpen{ false };
+            std::unordered_map<unsigned long long, std::shared_ptr<HttpConnection>> hashConnections;
+            // Sessions owned by this loop, by Mcp-Session-Id.
+            std::unordered_map<std::string, std::shared_ptr<CHttpSseTransport>> hashSessions;
+            // Session id + raw JSON request id / progress token -> connection streaming the answer.
+            std::unordered_map<std::string, unsigned long long> hashPendingRequests;
+            std::unordered_map<std::string, unsigned long long> hashProgressTokens;
+            // Session id -> its WebSocket connection.
+            std::unordered_map<std::string, unsigned long long> hashWebSockets;
+            bool bReadPaused{ false };
+
+            // Read by other loops for balancing and by GetShardStats().
+            std::atomic<size_t> nConnections{ 0 };
+            std::atomic<size_t> nSessions{ 0 };
+            std::atomic<unsigned long long> ullSessionsMovedIn{ 0 };
+            std::atomic<unsigned long long> ullSessionsMovedOut{ 0 };
+            std::atomic<unsigned long long> ullConnectionsMovedIn{ 0 };
+        };
+
+        struct HttpRequest
+        {
+            std::string strMethod;
+            std::string strPath;
+            std::string strVersion;
+            std::unordered_map<std::string, std::string> hashHeaders;   // lower case names
+            std::string strBody;
+        };
+
+        // Thread safe; dropped once the listener is closed.
+        bool Post(size_t nShard, CMCPEventLoop::Task fnTask);
+        bool IsInShardThread(size_t nShard) const;
+        // Called by the session transports.
+        void OnInputConsumed(size_t nBytes);
+        void OnSessionClosed(size_t nShard, const std::string& strSessionId);
+
+        void OnAccept();
+        void AddConnection(HttpShard& shard, const std::shared_ptr<HttpConnection>& spConn);
+        void MoveConnection(const std::shared_ptr<HttpConnection>& spConn, size_t nTarget);
+        void OnConnectionEvent(const std::shared_ptr<HttpConnection>& spConn, unsigned int nEvents);
+        void ProcessInput(const std::shared_ptr<HttpConnection>& spConn);
+        // Returns 0 when more input is needed, the consumed byte count otherwise (-1 on a malformed request).
+        long long ParseRequest(const std::shared_ptr<HttpConnection>& spConn, HttpRequest& request);
+        // Index of the loop owning the session named by the request, if it is not the connection's loop.
+        bool FindOwningShard(const std::shared_ptr<HttpConnection>& spConn, const HttpRequest& request, size_t& nShard);
+        void HandleRequest(const std::shared_ptr<HttpConnection>& spConn, HttpRequest& request);
+        void HandlePost(const std::shared_ptr<HttpConnection>& spConn, HttpRequest& request);
+        // A JSON-RPC batch, answered with one event carrying the array of its responses.
+        void HandleBatchPost(const std::shared_ptr<HttpConnection>& spConn, HttpRequest& request);
+        void HandleDelete(const std::shared_ptr<HttpConnection>& spConn, HttpRequest& request);
+        void HandleUpgrade(const std::shared_ptr<HttpConnection>& spConn, HttpRequest& request);
+        // Hands the messages of an upgraded connection to its session and answers its control frames.
+        void ProcessFrames(const std::shared_ptr<HttpConnection>& spConn);
+        // Answers 401 itself unless the request carries valid credentials.
+        bool AuthenticateRequest(const std::shared_ptr<HttpConnection>& spConn, const HttpRequest& request);
+        // Resolves the Mcp-Session-Id header, answering 400/403/404 itself when there is no live session.
+        std::shared_ptr<CHttpSseTransport> FindSession(const std::shared_ptr<HttpConnection>& spConn, const HttpRequest& request);
+        std::shared_ptr<CHttpSseTransport> CreateSession(HttpShard& shard, const std::string& strPrincipal);
+        void RemoveSession(HttpShard& shard, const std::string& strSessionId);
+        void SendResponse(const std::shared_ptr<HttpConnection>& spConn, int iStatus, const char* lpcszReason, const std::string& strBody = "",
+            const char* lpcszContentType = "application/json");
+        // Counts the output of the connection towards the session it now serves.
+        void BindSessionOutput(const std::shared_ptr<HttpConnection>& spConn);
+        void StartEventStream(const std::shared_ptr<HttpConnection>& spConn);
+        void SendEvent(const std::shared_ptr<HttpConnection>& spConn, const char* pData, size_t nLength);
+        void FinishEventStream(const std::shared_ptr<HttpConnection>& spConn);
+        // False when the session has no WebSocket.
+        bool SendToWebSocket(HttpShard& shard, const std::string& strSessionId, const char* pData, size_t nLength);
+        // Sends a close frame and closes the connection once it is written.
+        void CloseWebSocket(const std::shared_ptr<HttpConnection>& spConn, int iCloseCode);
+        void RouteOutgoing(HttpShard& shard, const std::string& strSessionId, const std::string& strMsg);
+        void QueueIncoming(const std::shared_ptr<CHttpSseTransport>& spSession, std::string&& strMsg);
+        void QueueOutput(const std::shared_ptr<HttpConnection>& spConn, const char* pData, size_t nLength);
+        void FlushOutput(const std::shared_ptr<HttpConnection>& spConn);
+        // Takes the bytes of the connection's session that left strOutput off its pending output.
+        void SettleOutput(const std::shared_ptr<HttpConnection>& spConn);
+        void UpdateInterest(const std::shared_ptr<HttpConnection>& spConn);
+        void CloseConnection(const std::shared_ptr<HttpConnection>& spConn);
+        void PauseReading(bool bPause);
+        void OnTick(HttpShard& shard);
+        void Rebalance(HttpShard& shard);
+        size_t LeastLoadedShard(bool bBySessions) const;
+
         std::string m_url;
         std::string m_bearer;
-        bool m_connected{ false };
         bool m_httpsEnabled{ false };
         std::string m_certFile;
         std::string m_keyFile;
-    };
-}
 
+        std::string m_strHost;
+        int m_iPort{ 0 };
+        std::string m_strEndpointPath{ "/mcp" };
+        std::string m_strMetricsPath;
+        std::function<std::string()> m_fnMetrics;
+        CMCPAuthenticator m_authenticator;
+        int m_iReloadHandlerId{ -1 };
+        size_t m_nMaxRequestBytes{ 16 * 1024 * 1024 };
+        size_t m_nOutputHighWatermark{ 256 * 1024 };
+        size_t m_nMaxOutputBytes{ 16 * 1024 * 1024 };
+        size_t m_nMaxPendingInputBytes{ 64 * 1024 * 1024 };
+        std::chrono::seconds m_durKeepAliveTimeout{ 60 };
+        size_t m_nEventLoops{ 0 };
+        bool m_bIoUring{ true };
+        size_t m_nRebalanceThreshold{ 150 };
+        bool m_bWebSocket{ true };
+        bool m_bWebSocketDeflate{ true };
+        size_t m_nDeflateMinBytes{ 1024 };
+        int m_iDeflateLevel{ 6 };
+        std::chrono::seconds m_durPingInterval{ 30 };
 
+        AcceptCallback m_fnOnAccept;
+        // Shard 0 also accepts the connections.
+        std::vector<std::unique_ptr<HttpShard>> m_vecShards;
+        int m_iListenFd{ -1 };
+        std::atomic<unsigned long long> m_ullNextConnectionId{ 0 };
+        // Session id -> owning shard, consulted when a request arrives on another loop.
+        std::mutex m_mtxDirectory;
+        std::unordered_map<std::string, size_t> m_hashSessionShards;
+
+        // Bytes received from clients and not yet read by their sessions (Read() mode only).
+        std::atomic<size_t> m_nPendingInputBytes{ 0 };
+        std::atomic<bool> m_bInputPaused{ false };
+    };
+}
@@ -0,0 +1,558 @@
+#include "IoUring.h"
+
+#if defined(__linux__) && defined(TINYMCP_WITH_IO_URING)
+#include "../Public/PublicDef.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+
+namespace MCP
+{
+	static constexpr unsigned int RING_ENTRIES = 256;
+	// Provided buffers: the receive of every connection of the loop draws from the same ring.
+	static constexpr unsigned int BUFFER_COUNT = 128;		// a power of two
+	static constexpr size_t BUFFER_BYTES = 16 * 1024;
+	static constexpr uint16_t BUFFER_GROUP = 0;
+
+	// user_data of a submission: the descriptor, a token telling armings apart, and what it is.
+	static constexpr uint64_t KIND_POLL = 0;
+	static constexpr uint64_t KIND_RECV = 1;
+	static constexpr uint64_t KIND_CANCEL = 2;			// completions of cancellations are not looked at
+	static constexpr uint64_t COMPLETION_HANDLED = ~0ull;
+	static constexpr uint32_t TOKEN_MASK = 0x3fffffffu;
+
+	static uint64_t MakeUserData(int iFd, uint32_t uToken, uint64_t ullKind)
+	{
+		return (static_cast<uint64_t>(static_cast<uint32_t>(iFd)) << 32) | (static_cast<uint64_t>(uToken) << 2) | ullKind;
+	}
+
+	static int UserDataFd(uint64_t ullUserData)
+	{
+		return static_cast<int>(static_cast<uint32_t>(ullUserData >> 32));
+	}
+
+	static uint32_t UserDataToken(uint64_t ullUserData)
+	{
+		return static_cast<uint32_t>(ullUserData >> 2) & TOKEN_MASK;
+	}
+
+	static int SysSetup(unsigned int nEntries, io_uring_params* pParams)
+	{
+		return static_cast<int>(syscall(SYS_io_uring_setup, nEntries, pParams));
+	}
+
+	static int SysEnter(int iRingFd, unsigned int nToSubmit, unsigned int nMinComplete, unsigned int nFlags, void* pArg, size_t nArgSize)
+	{
+		return static_cast<int>(syscall(SYS_io_uring_enter, iRingFd, nToSubmit, nMinComplete, nFlags, pArg, nArgSize));
+	}
+
+	static int SysRegister(int iRingFd, unsigned int nOpcode, void* pArg, unsigned int nArgs)
+	{
+		return static_cast<int>(syscall(SYS_io_uring_register, iRingFd, nOpcode, pArg, nArgs));
+	}
+
+	std::unique_ptr<CMCPIoUring> CMCPIoUring::Create()
+	{
+		std::unique_ptr<CMCPIoUring> upRing(new CMCPIoUring());
+		if (ERRNO_OK != upRing->Setup() || !upRing->ProbeMultishotReceive())
+			return nullptr;
+
+		return upRing;
+	}
+
+	CMCPIoUring::~CMCPIoUring()
+	{
+		// Closing the ring cancels whatever is still armed.
+		if (m_iRingFd >= 0)
+			close(m_iRingFd);
+		if (m_pSqes)
+			munmap(m_pSqes, m_nSqesSize);
+		if (m_pSqRing)
+			munmap(m_pSqRing, m_nSqRingSize);
+		if (m_pBufferRing)
+			munmap(m_pBufferRing, m_nBufferRingSize);
+		if (m_pBuffers)
+			munmap(m_pBuffers, BUFFER_COUNT * BUFFER_BYTES);
+	}
+
+	int CMCPIoUring::Setup()
+	{
+		io_uring_params params;
+		memset(&params, 0, sizeof(params));
+		params.flags = IORING_SETUP_CLAMP | IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN;
+		m_iRingFd = SysSetup(RING_ENTRIES, &params);
+		if (m_iRingFd < 0 && EINVAL == errno)
+		{
+			memset(&params, 0, sizeof(params));
+			params.flags = IORING_SETUP_CLAMP;
+			m_iRingFd = SysSetup(RING_ENTRIES, &params);
+		}
+		// ENOSYS, or EPERM where kernel.io_uring_disabled or a seccomp filter forbids it.
+		if (m_iRingFd < 0)
+			return ERRNO_INTERNAL_ERROR;
+		m_nFeatures = params.features;
+		unsigned int nRequired = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG;
+		if ((m_nFeatures & nRequired) != nRequired)
+			return ERRNO_INTERNAL_ERROR;
+
+		size_t nSqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+		size_t nCqSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+		m_nSqRingSize = std::max(nSqSize, nCqSize);
+		void* pRing = mmap(nullptr, m_nSqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_iRingFd, IORING_OFF_SQ_RING);
+		if (MAP_FAILED == pRing)
+			return ERRNO_INTERNAL_ERROR;
+		m_pSqRing = m_pCqRing = pRing;
+		m_nSqesSize = params.sq_entries * sizeof(io_uring_sqe);
+		void* pSqes = mmap(nullptr, m_nSqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_iRingFd, IORING_OFF_SQES);
+		if (MAP_FAILED == pSqes)
+			return ERRNO_INTERNAL_ERROR;
+		m_pSqes = static_cast<io_uring_sqe*>(pSqes);
+
+		char* pSq = static_cast<char*>(m_pSqRing);
+		m_pSqHead = reinterpret_cast<unsigned int*>(pSq + params.sq_off.head);
+		m_pSqTail = reinterpret_cast<unsigned int*>(pSq + params.sq_off.tail);
+		m_uSqMask = *reinterpret_cast<unsigned int*>(pSq + params.sq_off.ring_mask);
+		m_pSqArray = reinterpret_cast<unsigned int*>(pSq + params.sq_off.array);
+		m_nSqEntries = params.sq_entries;
+		m_uSqLocalTail = *m_pSqTail;
+		char* pCq = static_cast<char*>(m_pCqRing);
+		m_pCqHead = reinterpret_cast<unsigned int*>(pCq + params.cq_off.head);
+		m_pCqTail = reinterpret_cast<unsigned int*>(pCq + params.cq_off.tail);
+		m_uCqMask = *reinterpret_cast<unsigned int*>(pCq + params.cq_off.ring_mask);
+		m_pCqes = reinterpret_cast<io_uring_cqe*>(pCq + params.cq_off.cqes);
+
+		// Opcodes the loop submits.
+		std::vector<char> vecProbe(sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op), 0);
+		auto pProbe = reinterpret_cast<io_uring_probe*>(vecProbe.data());
+		if (0 != SysRegister(m_iRingFd, IORING_REGISTER_PROBE, pProbe, 256))
+			return ERRNO_INTERNAL_ERROR;
+		for (unsigned int nOpcode : { IORING_OP_POLL_ADD, IORING_OP_POLL_REMOVE, IORING_OP_RECV, IORING_OP_ASYNC_CANCEL })
+		{
+			if (nOpcode > pProbe->last_op || !(pProbe->ops[nOpcode].flags & IO_URING_OP_SUPPORTED))
+				return ERRNO_INTERNAL_ERROR;
+		}
+
+		// The ring of provided buffers (Linux 5.19) and the buffers themselves.
+		m_nBufferRingSize = BUFFER_COUNT * sizeof(io_uring_buf);
+		void* pBufferRing = mmap(nullptr, m_nBufferRingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (MAP_FAILED == pBufferRing)
+			return ERRNO_INTERNAL_ERROR;
+		m_pBufferRing = static_cast<io_uring_buf*>(pBufferRing);
+		void* pBuffers = mmap(nullptr, BUFFER_COUNT * BUFFER_BYTES, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (MAP_FAILED == pBuffers)
+			return ERRNO_INTERNAL_ERROR;
+		m_pBuffers = static_cast<char*>(pBuffers);
+
+		io_uring_buf_reg reg;
+		memset(&reg, 0, sizeof(reg));
+		reg.ring_addr = reinterpret_cast<uint64_t>(m_pBufferRing);
+		reg.ring_entries = BUFFER_COUNT;
+		reg.bgid = BUFFER_GROUP;
+		if (0 != SysRegister(m_iRingFd, IORING_REGISTER_PBUF_RING, &reg, 1))
+			return ERRNO_INTERNAL_ERROR;
+		for (unsigned int i = 0; i < BUFFER_COUNT; ++i)
+		{
+			RecycleBuffer(static_cast<uint16_t>(i));
+		}
+
+		return ERRNO_OK;
+	}
+
+	// Multishot receive came with Linux 6.0 and the probe above cannot tell: try it on a socket pair.
+	bool CMCPIoUring::ProbeMultishotReceive()
+	{
+		int arrFds[2] = { -1, -1 };
+		if (0 != socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, arrFds))
+			return false;
+
+		Entry entry;
+		entry.spHandlers = std::make_shared<Handlers>();
+		entry.spHandlers->fnOnData = [](const char*, size_t) {};
+		ArmReceive(arrFds[0], entry);
+		uint64_t ullUserData = MakeUserData(arrFds[0], entry.uRecvToken, KIND_RECV);
+		char chByte = 0;
+		bool bSupported = false;
+		bool bEnded = false;
+		if (1 == write(arrFds[1], &chByte, 1))
+		{
+			for (int i = 0; i < 10 && !bEnded && !bSupported; ++i)
+			{
+				if (ERRNO_OK != Submit(1, 100))
+					break;
+				unsigned int uHead = *m_pCqHead;
+				unsigned int uTail = __atomic_load_n(m_pCqTail, __ATOMIC_ACQUIRE);
+				for (; uHead != uTail; ++uHead)
+				{
+					const io_uring_cqe& cqe = m_pCqes[uHead & m_uCqMask];
+					if (cqe.user_data != ullUserData)
+						continue;
+					if (cqe.flags & IORING_CQE_F_BUFFER)
+						RecycleBuffer(static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT));
+					bSupported = 1 == cqe.res && (cqe.flags & IORING_CQE_F_MORE);
+					bEnded = !(cqe.flags & IORING_CQE_F_MORE);
+				}
+				__atomic_store_n(m_pCqHead, uHead, __ATOMIC_RELEASE);
+			}
+		}
+
+		// Nothing of the probe may complete once real descriptors (which may reuse its numbers) are added.
+		if (!bEnded)
+		{
+			Cancel(arrFds[0], entry.uRecvToken, false);
+			for (int i = 0; i < 10 && !bEnded; ++i)
+			{
+				if (ERRNO_OK != Submit(1, 100))
+					break;
+				unsigned int uHead = *m_pCqHead;
+				unsigned int uTail = __atomic_load_n(m_pCqTail, __ATOMIC_ACQUIRE);
+				for (; uHead != uTail; ++uHead)
+				{
+					const io_uring_cqe& cqe = m_pCqes[uHead & m_uCqMask];
+					if (cqe.user_data == ullUserData && !(cqe.flags & IORING_CQE_F_MORE))
+						bEnded = true;
+					if (cqe.user_data == ullUserData && (cqe.flags & IORING_CQE_F_BUFFER))
+						RecycleBuffer(static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT));
+				}
+				__atomic_store_n(m_pCqHead, uHead, __ATOMIC_RELEASE);
+			}
+		}
+		close(arrFds[0]);
+		close(arrFds[1]);
+
+		return bSupported && bEnded;
+	}
+
+	io_uring_sqe* CMCPIoUring::GetSqe()
+	{
+		// A full submission queue goes to the kernel without waiting.
+		if (m_uSqLocalTail - __atomic_load_n(m_pSqHead, __ATOMIC_ACQUIRE) >= m_nSqEntries)
+			Submit(0, 0);
+
+		unsigned int uIndex = m_uSqLocalTail & m_uSqMask;
+		io_uring_sqe* pSqe = &m_pSqes[uIndex];
+		memset(pSqe, 0, sizeof(*pSqe));
+		m_pSqArray[uIndex] = uIndex;
+		m_uSqLocalTail++;
+
+		return pSqe;
+	}
+
+	int CMCPIoUring::Submit(unsigned int nMinComplete, int iTimeoutMs)
+	{
+		__atomic_store_n(m_pSqTail, m_uSqLocalTail, __ATOMIC_RELEASE);
+		unsigned int nToSubmit = m_uSqLocalTail - __atomic_load_n(m_pSqHead, __ATOMIC_ACQUIRE);
+		unsigned int nFlags = nMinComplete > 0 ? IORING_ENTER_GETEVENTS : 0;
+
+		int iResult = 0;
+		if (nMinComplete > 0 && iTimeoutMs >= 0)
+		{
+			__kernel_timespec ts;
+			ts.tv_sec = iTimeoutMs / 1000;
+			ts.tv_nsec = (iTimeoutMs % 1000) * 1000000LL;
+			io_uring_getevents_arg arg;
+			memset(&arg, 0, sizeof(arg));
+			arg.ts = reinterpret_cast<uint64_t>(&ts);
+			iResult = SysEnter(m_iRingFd, nToSubmit, nMinComplete, nFlags | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+		}
+		else
+		{
+			if (0 == nToSubmit && 0 == nMinComplete)
+				return ERRNO_OK;
+			iResult = SysEnter(m_iRingFd, nToSubmit, nMinComplete, nFlags, nullptr, 0);
+		}
+		// ETIME is the timeout; EBUSY a completion queue in overflow, which the next wait drains.
+		if (iResult < 0 && EINTR != errno && ETIME != errno && EBUSY != errno && EAGAIN != errno)
+			return ERRNO_INTERNAL_ERROR;
+
+		return ERRNO_OK;
+	}
+
+	uint32_t CMCPIoUring::NextToken()
+	{
+		m_uNextToken = (m_uNextToken + 1) & TOKEN_MASK;
+		if (0 == m_uNextToken)
+			m_uNextToken = 1;
+
+		return m_uNextToken;
+	}
+
+	void CMCPIoUring::ArmPoll(int iFd, Entry& entry)
+	{
+		entry.uPollToken = NextToken();
+		io_uring_sqe* pSqe = GetSqe();
+		pSqe->opcode = IORING_OP_POLL_ADD;
+		pSqe->fd = iFd;
+		pSqe->len = IORING_POLL_ADD_MULTI;
+		pSqe->poll32_events = entry.uPollMask;
+		pSqe->user_data = MakeUserData(iFd, entry.uPollToken, KIND_POLL);
+	}
+
+	void CMCPIoUring::ArmReceive(int iFd, Entry& entry)
+	{
+		entry.uRecvToken = NextToken();
+		io_uring_sqe* pSqe = GetSqe();
+		pSqe->opcode = IORING_OP_RECV;
+		pSqe->fd = iFd;
+		pSqe->ioprio = IORING_RECV_MULTISHOT;
+		pSqe->flags = IOSQE_BUFFER_SELECT;
+		pSqe->buf_group = BUFFER_GROUP;
+		pSqe->user_data = MakeUserData(iFd, entry.uRecvToken, KIND_RECV);
+	}
+
+	void CMCPIoUring::Cancel(int iFd, uint32_t uToken, bool bPoll)
+	{
+		io_uring_sqe* pSqe = GetSqe();
+		pSqe->opcode = bPoll ? IORING_OP_POLL_REMOVE : IORING_OP_ASYNC_CANCEL;
+		pSqe->fd = -1;
+		pSqe->addr = MakeUserData(iFd, uToken, bPoll ? KIND_POLL : KIND_RECV);
+		pSqe->user_data = MakeUserData(iFd, 0, KIND_CANCEL);
+	}
+
+	// Brings what is armed for the descriptor in line with its interest.
+	void CMCPIoUring::Arm(int iFd, Entry& entry)
+	{
+		bool bReceive = static_cast<bool>(entry.spHandlers->fnOnData);
+		// Readable is what the receive reports, and its end of stream the hang up.
+		uint32_t uMask = 0;
+		if (!bReceive)
+			uMask |= POLLRDHUP;
+		if (!bReceive && (entry.nEvents & CMCPEventLoop::EventFlags_Read))
+			uMask |= POLLIN;
+		if (entry.nEvents & CMCPEventLoop::EventFlags_Write)
+			uMask |= POLLOUT;
+		if (uMask != entry.uPollMask || (uMask && !entry.uPollToken))
+		{
+			if (entry.uPollToken)
+				Cancel(iFd, entry.uPollToken, true);
+			entry.uPollToken = 0;
+			entry.uPollMask = uMask;
+			if (uMask)
+				ArmPoll(iFd, entry);
+		}
+
+		bool bWantReceive = bReceive && (entry.nEvents & CMCPEventLoop::EventFlags_Read);
+		if (bWantReceive && !entry.uRecvToken)
+		{
+			ArmReceive(iFd, entry);
+		}
+		else if (!bWantReceive && entry.uRecvToken)
+		{
+			// Bytes received before the cancellation takes effect are still handed out.
+			Cancel(iFd, entry.uRecvToken, false);
+			entry.uRecvToken = 0;
+		}
+	}
+
+	int CMCPIoUring::Add(int iFd, unsigned int nEvents, EventHandler fnHandler, DataHandler fnOnData)
+	{
+		if (m_hashEntries.find(iFd) != m_hashEntries.end())
+			return ERRNO_INTERNAL_ERROR;
+
+		Entry& entry = m_hashEntries[iFd];
+		entry.nEvents = nEvents;
+		entry.uAddedToken = NextToken();
+		entry.spHandlers = std::make_shared<Handlers>();
+		entry.spHandlers->fnHandler = std::move(fnHandler);
+		entry.spHandlers->fnOnData = std::move(fnOnData);
+		Arm(iFd, entry);
+
+		return ERRNO_OK;
+	}
+
+	int CMCPIoUring::Modify(int iFd, unsigned int nEvents)
+	{
+		auto itrEntry = m_hashEntries.find(iFd);
+		if (itrEntry == m_hashEntries.end())
+			return ERRNO_INTERNAL_ERROR;
+
+		itrEntry->second.nEvents = nEvents;
+		Arm(iFd, itrEntry->second);
+
+		return ERRNO_OK;
+	}
+
+	int CMCPIoUring::Remove(int iFd)
+	{
+		auto itrEntry = m_hashEntries.find(iFd);
+		if (itrEntry == m_hashEntries.end())
+			return ERRNO_INTERNAL_ERROR;
+
+		Entry entry = itrEntry->second;
+		if (entry.uPollToken)
+			Cancel(iFd, entry.uPollToken, true);
+		if (!entry.uRecvToken)
+		{
+			m_hashEntries.erase(itrEntry);
+			return ERRNO_OK;
+		}
+
+		// Waits for the end of the receive; usually the cancellation completes on submission.
+		Cancel(iFd, entry.uRecvToken, false);
+		uint64_t ullUserData = MakeUserData(iFd, entry.uRecvToken, KIND_RECV);
+		bool bEnded = false;
+		for (int i = 0; i < 50 && !bEnded; ++i)
+		{
+			for (size_t nIndex = m_nNextCompletion; nIndex < m_vecCompletions.size(); ++nIndex)
+			{
+				io_uring_cqe& cqe = m_vecCompletions[nIndex];
+				if (COMPLETION_HANDLED == cqe.user_data || UserDataFd(cqe.user_data) != iFd || KIND_RECV != (cqe.user_data & 3))
+					continue;
+				DeliverData(iFd, cqe);
+				if (cqe.user_data == ullUserData && !(cqe.flags & IORING_CQE_F_MORE))
+					bEnded = true;
+				cqe.user_data = COMPLETION_HANDLED;
+			}
+			if (bEnded || ERRNO_OK != Submit(1, 20))
+				break;
+			Reap();
+		}
+		m_hashEntries.erase(iFd);
+
+		return ERRNO_OK;
+	}
+
+	void CMCPIoUring::Reap()
+	{
+		unsigned int uHead = *m_pCqHead;
+		unsigned int uTail = __atomic_load_n(m_pCqTail, __ATOMIC_ACQUIRE);
+		for (; uHead != uTail; ++uHead)
+		{
+			m_vecCompletions.push_back(m_pCqes[uHead & m_uCqMask]);
+		}
+		__atomic_store_n(m_pCqHead, uHead, __ATOMIC_RELEASE);
+	}
+
+	int CMCPIoUring::RunOnce(int iTimeoutMs)
+	{
+		// Completions Remove() reaped outside of a dispatch are waiting already.
+		bool bPending = m_nNextCompletion < m_vecCompletions.size();
+		if (ERRNO_OK != Submit(1, bPending ? 0 : iTimeoutMs))
+			return ERRNO_INTERNAL_ERROR;
+		Reap();
+
+		// Handlers may call Remove(), which appends to (and marks entries of) the completions.
+		while (m_nNextCompletion < m_vecCompletions.size())
+		{
+			io_uring_cqe cqe = m_vecCompletions[m_nNextCompletion++];
+			Dispatch(cqe);
+		}
+		m_vecCompletions.clear();
+		m_nNextCompletion = 0;
+
+		return ERRNO_OK;
+	}
+
+	void CMCPIoUring::RecycleBuffer(uint16_t uBufferId)
+	{
+		io_uring_buf& buf = m_pBufferRing[m_uBufferTail & (BUFFER_COUNT - 1)];
+		buf.addr = reinterpret_cast<uint64_t>(m_pBuffers + uBufferId * BUFFER_BYTES);
+		buf.len = static_cast<uint32_t>(BUFFER_BYTES);
+		buf.bid = uBufferId;
+		m_uBufferTail++;
+		__atomic_store_n(&m_pBufferRing[0].resv, m_uBufferTail, __ATOMIC_RELEASE);
+	}
+
+	// Hands the bytes of a receive completion to the data handler and returns its buffer.
+	bool CMCPIoUring::DeliverData(int iFd, const io_uring_cqe& cqe)
+	{
+		if (!(cqe.flags & IORING_CQE_F_BUFFER))
+			return false;
+
+		uint16_t uBufferId = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+		bool bDelivered = false;
+		auto itrEntry = m_hashEntries.find(iFd);
+		// Tokens only grow, so an older one belongs to an earlier descriptor of the same number.
+		if (cqe.res > 0 && itrEntry != m_hashEntries.end() && UserDataToken(cqe.user_data) >= itrEntry->second.uAddedToken)
+		{
+			auto spHandlers = itrEntry->second.spHandlers;
+			spHandlers->fnOnData(m_pBuffers + uBufferId * BUFFER_BYTES, static_cast<size_t>(cqe.res));
+			bDelivered = true;
+		}
+		RecycleBuffer(uBufferId);
+
+		return bDelivered;
+	}
+
+	static unsigned int ToEventFlags(uint32_t uRevents)
+	{
+		unsigned int nEvents = 0;
+		if (uRevents & (POLLIN | POLLPRI))
+			nEvents |= CMCPEventLoop::EventFlags_Read;
+		if (uRevents & POLLOUT)
+			nEvents |= CMCPEventLoop::EventFlags_Write;
+		if (uRevents & (POLLERR | POLLHUP | POLLRDHUP))
+			nEvents |= CMCPEventLoop::EventFlags_Error;
+
+		return nEvents;
+	}
+
+	void CMCPIoUring::Dispatch(const io_uring_cqe& cqe)
+	{
+		uint64_t ullKind = cqe.user_data & 3;
+		if (COMPLETION_HANDLED == cqe.user_data || KIND_CANCEL == ullKind)
+			return;
+
+		int iFd = UserDataFd(cqe.user_data);
+		uint32_t uToken = UserDataToken(cqe.user_data);
+		bool bMore = 0 != (cqe.flags & IORING_CQE_F_MORE);
+		unsigned int nEvents = 0;
+		if (KIND_RECV == ullKind)
+		{
+			bool bDelivered = DeliverData(iFd, cqe);
+			auto itrEntry = m_hashEntries.find(iFd);
+			if (itrEntry == m_hashEntries.end())
+				return;
+			Entry& entry = itrEntry->second;
+			if (!bMore && uToken == entry.uRecvToken)
+			{
+				entry.uRecvToken = 0;
+				// 0 is the end of the stream. Out of buffers (or stopped for any other reason the
+				// kernel has), the receive is armed again: buffers are back once handed out.
+				if (0 == cqe.res || (cqe.res < 0 && -ENOBUFS != cqe.res && -ECANCELED != cqe.res))
+					nEvents |= CMCPEventLoop::EventFlags_Error;
+				else if (entry.nEvents & CMCPEventLoop::EventFlags_Read)
+					ArmReceive(iFd, entry);
+			}
+			if (bDelivered)
+				nEvents |= CMCPEventLoop::EventFlags_Read;
+		}
+		else
+		{
+			auto itrEntry = m_hashEntries.find(iFd);
+			if (itrEntry == m_hashEntries.end() || uToken != itrEntry->second.uPollToken)
+				return;
+			Entry& entry = itrEntry->second;
+			if (cqe.res < 0)
+			{
+				entry.uPollToken = 0;
+				nEvents |= CMCPEventLoop::EventFlags_Error;
+			}
+			else
+			{
+				nEvents |= ToEventFlags(static_cast<uint32_t>(cqe.res));
+				// A multishot poll the kernel ended (e.g. on a completion queue overflow) is armed again.
+				if (!bMore)
+				{
+					entry.uPollToken = 0;
+					Arm(iFd, entry);
+				}
+			}
+		}
+		if (0 == nEvents)
+			return;
+
+		// The handler may remove its own (or another) descriptor while running.
+		auto itrEntry = m_hashEntries.find(iFd);
+		if (itrEntry == m_hashEntries.end())
+			return;
+		auto spHandlers = itrEntry->second.spHandlers;
+		spHandlers->fnHandler(iFd, nEvents);
+	}
+}
+#endif
@@ -0,0 +1,108 @@
+#pragma once
+// io_uring backend of CMCPEventLoop, compiled with TINYMCP_WITH_IO_URING on Linux only.
+// Uses the raw system calls (no liburing) and needs the headers of Linux 6.0 or later.
+
+#if defined(__linux__) && defined(TINYMCP_WITH_IO_URING)
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <linux/io_uring.h>
+#include "EventLoop.h"
+
+namespace MCP
+{
+	// Readiness is watched with multishot polls; descriptors added with a data handler are read by
+	// a multishot receive into a ring of buffers registered with the kernel, so the loop never calls
+	// recv() for them. Interest changes are queued as submissions and go to the kernel with the next
+	// wait: one io_uring_enter() per loop iteration, whatever the number of connections.
+	class CMCPIoUring
+	{
+	public:
+		using EventHandler = CMCPEventLoop::EventHandler;
+		using DataHandler = CMCPEventLoop::DataHandler;
+
+		// Null when the kernel lacks what the backend needs (or io_uring is disabled); the loop then
+		// uses epoll.
+		static std::unique_ptr<CMCPIoUring> Create();
+		~CMCPIoUring();
+		CMCPIoUring(const CMCPIoUring&) = delete;
+		CMCPIoUring& operator=(const CMCPIoUring&) = delete;
+
+		int Add(int iFd, unsigned int nEvents, EventHandler fnHandler, DataHandler fnOnData);
+		int Modify(int iFd, unsigned int nEvents);
+		// Cancels what is armed for the descriptor. Bytes a receive already took from the socket are
+		// handed to the data handler before it returns, so none are lost when the descriptor moves on
+		// to another loop.
+		int Remove(int iFd);
+
+		// Submits the queued changes, waits up to iTimeoutMs (-1 = no limit) and dispatches.
+		int RunOnce(int iTimeoutMs);
+
+	private:
+		struct Handlers
+		{
+			EventHandler fnHandler;
+			DataHandler fnOnData;
+		};
+
+		struct Entry
+		{
+			unsigned int nEvents{ 0 };
+			uint32_t uAddedToken{ 0 };		// receives armed before belong to an earlier descriptor
+			uint32_t uPollToken{ 0 };		// 0 = no poll armed
+			uint32_t uPollMask{ 0 };
+			uint32_t uRecvToken{ 0 };		// 0 = no receive armed
+			std::shared_ptr<Handlers> spHandlers;
+		};
+
+		CMCPIoUring() = default;
+
+		int Setup();
+		bool ProbeMultishotReceive();
+		io_uring_sqe* GetSqe();
+		int Submit(unsigned int nMinComplete, int iTimeoutMs);
+		void Arm(int iFd, Entry& entry);
+		void ArmPoll(int iFd, Entry& entry);
+		void ArmReceive(int iFd, Entry& entry);
+		void Cancel(int iFd, uint32_t uToken, bool bPoll);
+		uint32_t NextToken();
+		void Reap();
+		void Dispatch(const io_uring_cqe& cqe);
+		void RecycleBuffer(uint16_t uBufferId);
+		bool DeliverData(int iFd, const io_uring_cqe& cqe);
+
+		int m_iRingFd{ -1 };
+		unsigned int m_nFeatures{ 0 };
+
+		void* m_pSqRing{ nullptr };
+		size_t m_nSqRingSize{ 0 };
+		void* m_pCqRing{ nullptr };
+		io_uring_sqe* m_pSqes{ nullptr };
+		size_t m_nSqesSize{ 0 };
+		unsigned int* m_pSqHead{ nullptr };
+		unsigned int* m_pSqTail{ nullptr };
+		unsigned int m_uSqMask{ 0 };
+		unsigned int* m_pSqArray{ nullptr };
+		unsigned int* m_pCqHead{ nullptr };
+		unsigned int* m_pCqTail{ nullptr };
+		unsigned int m_uCqMask{ 0 };
+		io_uring_cqe* m_pCqes{ nullptr };
+		unsigned int m_nSqEntries{ 0 };
+		unsigned int m_uSqLocalTail{ 0 };
+
+		// Provided buffers the multishot receives fill. The ring is an array of io_uring_buf whose
+		// first resv field is the tail (io_uring_buf_ring, whose flexible array C++ lays out differently).
+		io_uring_buf* m_pBufferRing{ nullptr };
+		size_t m_nBufferRingSize{ 0 };
+		char* m_pBuffers{ nullptr };
+		uint16_t m_uBufferTail{ 0 };
+
+		uint32_t m_uNextToken{ 0 };
+		std::unordered_map<int, Entry> m_hashEntries;
+		// Completions of the current batch; Remove() appends to them while waiting for a cancellation.
+		std::vector<io_uring_cqe> m_vecCompletions;
+		size_t m_nNextCompletion{ 0 };
+	};
+}
+#endif
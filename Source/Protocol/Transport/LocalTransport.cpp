@@ -0,0 +1,1005 @@
+#include "LocalTransport.h"
+#include "../Public/PublicDef.h"
+#include "../Public/Config.h"
+#include "../Public/Logger.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <new>
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/uio.h>
+#endif
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+namespace MCP
+{
+	static const size_t FRAME_PREFIX_BYTES = 4;
+	// Set in the prefix of a frame whose bytes are in the descriptor sent along.
+	static const uint32_t FRAME_IN_DESCRIPTOR = 0x80000000u;
+	static const size_t READ_BUFFER_INITIAL_SIZE = 64 * 1024;
+	// Descriptors accepted per recvmsg(); a well-behaved peer sends one per frame.
+	static const size_t MAX_FDS_PER_READ = 16;
+
+	static void EncodePrefix(uint32_t uValue, unsigned char* pPrefix)
+	{
+		pPrefix[0] = static_cast<unsigned char>(uValue);
+		pPrefix[1] = static_cast<unsigned char>(uValue >> 8);
+		pPrefix[2] = static_cast<unsigned char>(uValue >> 16);
+		pPrefix[3] = static_cast<unsigned char>(uValue >> 24);
+	}
+
+	static uint32_t DecodePrefix(const char* pData)
+	{
+		auto pPrefix = reinterpret_cast<const unsigned char*>(pData);
+		return static_cast<uint32_t>(pPrefix[0])
+			| (static_cast<uint32_t>(pPrefix[1]) << 8)
+			| (static_cast<uint32_t>(pPrefix[2]) << 16)
+			| (static_cast<uint32_t>(pPrefix[3]) << 24);
+	}
+
+	// Serialized messages end with the newline of the line format, which frames do not need.
+	static size_t PayloadLength(const std::string& strIn)
+	{
+		return !strIn.empty() && '\n' == strIn.back() ? strIn.size() - 1 : strIn.size();
+	}
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	// CUnixSocketTransport
+#ifndef _WIN32
+	CUnixSocketTransport::CUnixSocketTransport(int iFd)
+		: m_iFd(iFd)
+	{
+#ifdef SO_NOSIGPIPE
+		int iOn = 1;
+		setsockopt(m_iFd, SOL_SOCKET, SO_NOSIGPIPE, &iOn, sizeof(iOn));
+#endif
+	}
+
+	CUnixSocketTransport::~CUnixSocketTransport()
+	{
+		Disconnect();
+		ReleaseMapping();
+		for (int iFd : m_queueFds)
+		{
+			close(iFd);
+		}
+		// Closed here only: a reader may still be inside recvmsg() when Disconnect() runs.
+		if (m_iFd >= 0)
+			close(m_iFd);
+	}
+
+	std::shared_ptr<CUnixSocketTransport> CUnixSocketTransport::ConnectTo(const std::string& strPath)
+	{
+		sockaddr_un addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		if (strPath.empty() || strPath.size() >= sizeof(addr.sun_path))
+			return nullptr;
+		memcpy(addr.sun_path, strPath.data(), strPath.size());
+
+		int iFd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (iFd < 0)
+			return nullptr;
+		fcntl(iFd, F_SETFD, FD_CLOEXEC);
+		if (0 != connect(iFd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)))
+		{
+			close(iFd);
+			return nullptr;
+		}
+
+		return std::make_shared<CUnixSocketTransport>(iFd);
+	}
+
+	int CUnixSocketTransport::Connect()
+	{
+		if (m_iFd < 0)
+			return ERRNO_INTERNAL_ERROR;
+
+		auto& config = Config::GetInstance();
+		int iMaxFrameBytes = config.GetTransportMaxFrameBytes();
+		if (iMaxFrameBytes > 0)
+			m_nMaxFrameBytes = std::min<size_t>(static_cast<size_t>(iMaxFrameBytes), FRAME_IN_DESCRIPTOR - 1);
+#ifdef __linux__
+		int iFdPassingBytes = config.GetLocalFdPassingBytes();
+		m_nFdPassingBytes = iFdPassingBytes > 0 ? static_cast<size_t>(iFdPassingBytes) : 0;
+#endif
+		m_bConnected = true;
+
+		return ERRNO_OK;
+	}
+
+	int CUnixSocketTransport::Disconnect()
+	{
+		if (m_bConnected.exchange(false) && m_iFd >= 0)
+			shutdown(m_iFd, SHUT_RDWR);
+
+		return ERRNO_OK;
+	}
+
+	int CUnixSocketTransport::Read(std::string& strOut)
+	{
+		const char* pBegin = nullptr;
+		const char* pEnd = nullptr;
+		const std::lock_guard<std::recursive_mutex> _lock(m_mtxRead);
+		int iErrCode = ReadFrame(pBegin, pEnd);
+		if (ERRNO_OK != iErrCode)
+			return iErrCode;
+		strOut.assign(pBegin, pEnd);
+
+		return ERRNO_OK;
+	}
+
+	int CUnixSocketTransport::ReadFrame(const char*& pBegin, const char*& pEnd)
+	{
+		const std::lock_guard<std::recursive_mutex> _lock(m_mtxRead);
+
+		ReleaseMapping();
+		while (true)
+		{
+			size_t nAvailable = m_nReadEnd - m_nReadBegin;
+			if (nAvailable >= FRAME_PREFIX_BYTES)
+			{
+				const char* pData = m_vecReadBuffer.data() + m_nReadBegin;
+				uint32_t uPrefix = DecodePrefix(pData);
+				size_t nLength = uPrefix & ~FRAME_IN_DESCRIPTOR;
+				if (nLength > m_nMaxFrameBytes)
+					return ERRNO_INTERNAL_INPUT_ERROR;
+				if (uPrefix & FRAME_IN_DESCRIPTOR)
+				{
+					// The descriptor came with the prefix, so it has been received by now.
+					m_nReadBegin += FRAME_PREFIX_BYTES;
+					if (m_queueFds.empty())
+						return ERRNO_INTERNAL_INPUT_ERROR;
+					int iFd = m_queueFds.front();
+					m_queueFds.pop_front();
+					return MapFrame(iFd, nLength, pBegin, pEnd);
+				}
+				if (nAvailable - FRAME_PREFIX_BYTES >= nLength)
+				{
+					pBegin = pData + FRAME_PREFIX_BYTES;
+					pEnd = pBegin + nLength;
+					m_nReadBegin += FRAME_PREFIX_BYTES + nLength;
+					return ERRNO_OK;
+				}
+			}
+
+			if (m_bReadEof)
+			{
+				if (m_nReadBegin == m_nReadEnd)
+					return ERRNO_INTERNAL_INPUT_TERMINATE;
+
+				// A truncated frame cannot be processed.
+				m_nReadBegin = m_nReadEnd;
+				return ERRNO_INTERNAL_INPUT_ERROR;
+			}
+
+			int iErrCode = FillReadBuffer();
+			if (ERRNO_OK != iErrCode)
+				return iErrCode;
+		}
+	}
+
+	int CUnixSocketTransport::FillReadBuffer()
+	{
+		if (m_vecReadBuffer.empty())
+			m_vecReadBuffer.resize(READ_BUFFER_INITIAL_SIZE);
+
+		if (m_nReadBegin == m_nReadEnd)
+		{
+			m_nReadBegin = m_nReadEnd = 0;
+		}
+		else if (m_nReadEnd == m_vecReadBuffer.size())
+		{
+			if (m_nReadBegin > 0)
+			{
+				memmove(m_vecReadBuffer.data(), m_vecReadBuffer.data() + m_nReadBegin, m_nReadEnd - m_nReadBegin);
+				m_nReadEnd -= m_nReadBegin;
+				m_nReadBegin = 0;
+			}
+			else
+			{
+				m_vecReadBuffer.resize(m_vecReadBuffer.size() * 2);
+			}
+		}
+
+		while (true)
+		{
+			iovec iov{ m_vecReadBuffer.data() + m_nReadEnd, m_vecReadBuffer.size() - m_nReadEnd };
+			union
+			{
+				cmsghdr header;
+				char szControl[CMSG_SPACE(sizeof(int) * MAX_FDS_PER_READ)];
+			} control;
+			msghdr msg;
+			memset(&msg, 0, sizeof(msg));
+			msg.msg_iov = &iov;
+			msg.msg_iovlen = 1;
+			msg.msg_control = control.szControl;
+			msg.msg_controllen = sizeof(control.szControl);
+			int iFlags = 0;
+#ifdef MSG_CMSG_CLOEXEC
+			iFlags |= MSG_CMSG_CLOEXEC;
+#endif
+			ssize_t iRead = recvmsg(m_iFd, &msg, iFlags);
+			if (iRead < 0)
+			{
+				if (EINTR == errno)
+					continue;
+				// Disconnect() shut the socket down.
+				if (!m_bConnected)
+					return ERRNO_INTERNAL_INPUT_TERMINATE;
+				return ERRNO_INTERNAL_INPUT_ERROR;
+			}
+
+			for (cmsghdr* pHeader = CMSG_FIRSTHDR(&msg); pHeader; pHeader = CMSG_NXTHDR(&msg, pHeader))
+			{
+				if (SOL_SOCKET != pHeader->cmsg_level || SCM_RIGHTS != pHeader->cmsg_type)
+					continue;
+				size_t nFds = (pHeader->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+				for (size_t i = 0; i < nFds; ++i)
+				{
+					int iFd = -1;
+					memcpy(&iFd, CMSG_DATA(pHeader) + i * sizeof(int), sizeof(int));
+					m_queueFds.push_back(iFd);
+				}
+			}
+			// Descriptors dropped for lack of room would shift every later frame onto the wrong one.
+			if (msg.msg_flags & MSG_CTRUNC)
+				return ERRNO_INTERNAL_INPUT_ERROR;
+
+			if (0 == iRead)
+				m_bReadEof = true;
+			else
+				m_nReadEnd += static_cast<size_t>(iRead);
+
+			return ERRNO_OK;
+		}
+	}
+
+	int CUnixSocketTransport::MapFrame(int iFd, size_t nLength, const char*& pBegin, const char*& pEnd)
+	{
+		int iErrCode = ERRNO_INTERNAL_INPUT_ERROR;
+		size_t nSize = FRAME_PREFIX_BYTES + nLength;
+		struct stat st;
+		do
+		{
+			if (0 != fstat(iFd, &st) || static_cast<size_t>(st.st_size) != nSize)
+				break;
+#ifdef __linux__
+			// Sealed against writes and truncation, the memfd cannot change under the parser
+			// (a truncated mapping would fault).
+			int iSeals = fcntl(iFd, F_GET_SEALS);
+			if (iSeals < 0 || (iSeals & (F_SEAL_WRITE | F_SEAL_SHRINK)) != (F_SEAL_WRITE | F_SEAL_SHRINK))
+				break;
+#endif
+			void* pMapping = mmap(nullptr, nSize, PROT_READ, MAP_SHARED, iFd, 0);
+			if (MAP_FAILED == pMapping)
+				break;
+			m_pMapping = pMapping;
+			m_nMappingSize = nSize;
+
+			const char* pData = static_cast<const char*>(pMapping);
+			if (DecodePrefix(pData) != nLength)
+				break;
+			pBegin = pData + FRAME_PREFIX_BYTES;
+			pEnd = pBegin + nLength;
+			iErrCode = ERRNO_OK;
+		} while (false);
+		close(iFd);
+
+		return iErrCode;
+	}
+
+	void CUnixSocketTransport::ReleaseMapping()
+	{
+		if (!m_pMapping)
+			return;
+		munmap(m_pMapping, m_nMappingSize);
+		m_pMapping = nullptr;
+		m_nMappingSize = 0;
+	}
+
+	int CUnixSocketTransport::Write(const std::string& strIn)
+	{
+		size_t nLength = PayloadLength(strIn);
+		if (nLength >= FRAME_IN_DESCRIPTOR)
+			return ERRNO_INTERNAL_OUTPUT_ERROR;
+
+		m_nPendingOutputBytes += nLength;
+		int iErrCode = ERRNO_OK;
+		{
+			std::lock_guard<std::mutex> _lock(m_mtxWrite);
+			if (!m_bConnected)
+				iErrCode = ERRNO_INTERNAL_OUTPUT_ERROR;
+			else if (m_nFdPassingBytes > 0 && nLength >= m_nFdPassingBytes)
+				iErrCode = SendDescriptor(strIn.data(), nLength);
+			else
+				iErrCode = SendInline(strIn.data(), nLength);
+		}
+		m_nPendingOutputBytes -= nLength;
+
+		return iErrCode;
+	}
+
+	int CUnixSocketTransport::SendInline(const char* pData, size_t nLength)
+	{
+		unsigned char arrPrefix[FRAME_PREFIX_BYTES];
+		EncodePrefix(static_cast<uint32_t>(nLength), arrPrefix);
+		iovec arrIov[2] = { { arrPrefix, sizeof(arrPrefix) }, { const_cast<char*>(pData), nLength } };
+		size_t nIndex = 0;
+		while (nIndex < 2)
+		{
+			msghdr msg;
+			memset(&msg, 0, sizeof(msg));
+			msg.msg_iov = &arrIov[nIndex];
+			msg.msg_iovlen = 2 - nIndex;
+			int iFlags = 0;
+#ifdef MSG_NOSIGNAL
+			iFlags |= MSG_NOSIGNAL;
+#endif
+			ssize_t nSent = sendmsg(m_iFd, &msg, iFlags);
+			if (nSent < 0)
+			{
+				if (EINTR == errno)
+					continue;
+				return ERRNO_INTERNAL_OUTPUT_ERROR;
+			}
+
+			size_t nRemaining = static_cast<size_t>(nSent);
+			while (nIndex < 2 && nRemaining >= arrIov[nIndex].iov_len)
+			{
+				nRemaining -= arrIov[nIndex].iov_len;
+				nIndex++;
+			}
+			if (nRemaining > 0)
+			{
+				arrIov[nIndex].iov_base = static_cast<char*>(arrIov[nIndex].iov_base) + nRemaining;
+				arrIov[nIndex].iov_len -= nRemaining;
+			}
+		}
+
+		return ERRNO_OK;
+	}
+
+	int CUnixSocketTransport::SendDescriptor(const char* pData, size_t nLength)
+	{
+#ifdef __linux__
+		int iMemFd = memfd_create("tinymcp-frame", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+		if (iMemFd < 0)
+			return SendInline(pData, nLength);
+
+		unsigned char arrPrefix[FRAME_PREFIX_BYTES];
+		EncodePrefix(static_cast<uint32_t>(nLength), arrPrefix);
+		int iErrCode = ERRNO_INTERNAL_OUTPUT_ERROR;
+		iovec arrIov[2] = { { arrPrefix, sizeof(arrPrefix) }, { const_cast<char*>(pData), nLength } };
+		size_t nTotal = FRAME_PREFIX_BYTES + nLength;
+		ssize_t nWritten = pwritev(iMemFd, arrIov, 2, 0);
+		// Short writes only happen when memory runs out.
+		if (nWritten == static_cast<ssize_t>(nTotal)
+			&& 0 == fcntl(iMemFd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL))
+		{
+			EncodePrefix(static_cast<uint32_t>(nLength) | FRAME_IN_DESCRIPTOR, arrPrefix);
+			iErrCode = SendAll(reinterpret_cast<const char*>(arrPrefix), sizeof(arrPrefix), iMemFd);
+		}
+		close(iMemFd);
+		if (ERRNO_OK != iErrCode && nWritten != static_cast<ssize_t>(nTotal))
+			return SendInline(pData, nLength);
+
+		return iErrCode;
+#else
+		return SendInline(pData, nLength);
+#endif
+	}
+
+	// The descriptor rides on the first byte sent.
+	int CUnixSocketTransport::SendAll(const char* pData, size_t nLength, int iFd)
+	{
+		while (nLength > 0)
+		{
+			iovec iov{ const_cast<char*>(pData), nLength };
+			union
+			{
+				cmsghdr header;
+				char szControl[CMSG_SPACE(sizeof(int))];
+			} control;
+			msghdr msg;
+			memset(&msg, 0, sizeof(msg));
+			msg.msg_iov = &iov;
+			msg.msg_iovlen = 1;
+			if (iFd >= 0)
+			{
+				memset(&control, 0, sizeof(control));
+				msg.msg_control = control.szControl;
+				msg.msg_controllen = sizeof(control.szControl);
+				cmsghdr* pHeader = CMSG_FIRSTHDR(&msg);
+				pHeader->cmsg_level = SOL_SOCKET;
+				pHeader->cmsg_type = SCM_RIGHTS;
+				pHeader->cmsg_len = CMSG_LEN(sizeof(int));
+				memcpy(CMSG_DATA(pHeader), &iFd, sizeof(int));
+			}
+			int iFlags = 0;
+#ifdef MSG_NOSIGNAL
+			iFlags |= MSG_NOSIGNAL;
+#endif
+			ssize_t nSent = sendmsg(m_iFd, &msg, iFlags);
+			if (nSent < 0)
+			{
+				if (EINTR == errno)
+					continue;
+				return ERRNO_INTERNAL_OUTPUT_ERROR;
+			}
+			iFd = -1;
+			pData += nSent;
+			nLength -= static_cast<size_t>(nSent);
+		}
+
+		return ERRNO_OK;
+	}
+
+	size_t CUnixSocketTransport::GetPendingOutputBytes() const
+	{
+		return m_nPendingOutputBytes.load(std::memory_order_relaxed);
+	}
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	// CUnixSocketListener
+	CUnixSocketListener::~CUnixSocketListener()
+	{
+		Close();
+	}
+
+	void CUnixSocketListener::SetPath(const std::string& strPath)
+	{
+		m_strPath = strPath;
+	}
+
+	const std::string& CUnixSocketListener::GetPath() const
+	{
+		return m_strPath;
+	}
+
+	int CUnixSocketListener::Listen(AcceptCallback fnOnAccept)
+	{
+		if (m_iListenFd >= 0 || !fnOnAccept)
+			return ERRNO_INTERNAL_ERROR;
+		if (m_strPath.empty())
+			m_strPath = Config::GetInstance().GetLocalSocketPath();
+
+		sockaddr_un addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		if (m_strPath.empty() || m_strPath.size() >= sizeof(addr.sun_path))
+			return ERRNO_INTERNAL_ERROR;
+		memcpy(addr.sun_path, m_strPath.data(), m_strPath.size());
+
+		// A socket file nobody accepts on is left over from a server that did not exit cleanly.
+		if (CUnixSocketTransport::ConnectTo(m_strPath))
+		{
+			MCP_LOG_ERROR("transport", "another server listens on {}", m_strPath);
+			return ERRNO_INTERNAL_ERROR;
+		}
+		unlink(m_strPath.c_str());
+
+		int iFd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (iFd < 0)
+			return ERRNO_INTERNAL_ERROR;
+		fcntl(iFd, F_SETFD, FD_CLOEXEC);
+		// Nobody can connect before listen(), so restricting the file after bind() leaves no window.
+		if (0 != bind(iFd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr))
+			|| 0 != chmod(m_strPath.c_str(), S_IRUSR | S_IWUSR)
+			|| 0 != listen(iFd, SOMAXCONN)
+			|| 0 != pipe(m_arrWakeupFds))
+		{
+			MCP_LOG_ERROR("transport", "cannot listen on {}: errno {}", m_strPath, errno);
+			close(iFd);
+			unlink(m_strPath.c_str());
+			return ERRNO_INTERNAL_ERROR;
+		}
+		fcntl(m_arrWakeupFds[0], F_SETFD, FD_CLOEXEC);
+		fcntl(m_arrWakeupFds[1], F_SETFD, FD_CLOEXEC);
+
+		m_iListenFd = iFd;
+		m_fnOnAccept = std::move(fnOnAccept);
+		m_thrAccept = std::thread(&CUnixSocketListener::AcceptThreadProc, this);
+		MCP_LOG_INFO("transport", "listening on {}", m_strPath);
+
+		return ERRNO_OK;
+	}
+
+	void CUnixSocketListener::AcceptThreadProc()
+	{
+		while (true)
+		{
+			pollfd arrPoll[2] = { { m_iListenFd, POLLIN, 0 }, { m_arrWakeupFds[0], POLLIN, 0 } };
+			if (poll(arrPoll, 2, -1) < 0)
+			{
+				if (EINTR == errno)
+					continue;
+				break;
+			}
+			if (arrPoll[1].revents)
+				break;
+			if (!(arrPoll[0].revents & POLLIN))
+				continue;
+
+			int iFd = accept(m_iListenFd, nullptr, nullptr);
+			if (iFd < 0)
+				continue;
+			fcntl(iFd, F_SETFD, FD_CLOEXEC);
+			auto spTransport = std::make_shared<CUnixSocketTransport>(iFd);
+			{
+				std::lock_guard<std::mutex> _lock(m_mtxTransports);
+				m_vecTransports.erase(std::remove_if(m_vecTransports.begin(), m_vecTransports.end(),
+					[](const std::weak_ptr<CUnixSocketTransport>& wpTransport) { return wpTransport.expired(); }), m_vecTransports.end());
+				m_vecTransports.push_back(spTransport);
+			}
+			m_fnOnAccept(spTransport);
+		}
+	}
+
+	int CUnixSocketListener::Close()
+	{
+		if (m_iListenFd < 0)
+			return ERRNO_OK;
+
+		char chWakeup = 0;
+		ssize_t nWritten = write(m_arrWakeupFds[1], &chWakeup, 1);
+		(void)nWritten;
+		if (m_thrAccept.joinable())
+			m_thrAccept.join();
+		close(m_iListenFd);
+		m_iListenFd = -1;
+		close(m_arrWakeupFds[0]);
+		close(m_arrWakeupFds[1]);
+		m_arrWakeupFds[0] = m_arrWakeupFds[1] = -1;
+		unlink(m_strPath.c_str());
+
+		std::vector<std::weak_ptr<CUnixSocketTransport>> vecTransports;
+		{
+			std::lock_guard<std::mutex> _lock(m_mtxTransports);
+			vecTransports.swap(m_vecTransports);
+		}
+		for (auto& wpTransport : vecTransports)
+		{
+			auto spTransport = wpTransport.lock();
+			if (spTransport)
+				spTransport->Disconnect();
+		}
+
+		return ERRNO_OK;
+	}
+#else
+	CUnixSocketTransport::CUnixSocketTransport(int iFd) : m_iFd(iFd) {}
+	CUnixSocketTransport::~CUnixSocketTransport() {}
+	std::shared_ptr<CUnixSocketTransport> CUnixSocketTransport::ConnectTo(const std::string& /*strPath*/) { return nullptr; }
+	int CUnixSocketTransport::Connect() { return ERRNO_INTERNAL_ERROR; }
+	int CUnixSocketTransport::Disconnect() { return ERRNO_OK; }
+	int CUnixSocketTransport::Read(std::string& /*strOut*/) { return ERRNO_INTERNAL_INPUT_ERROR; }
+	int CUnixSocketTransport::ReadFrame(const char*& /*pBegin*/, const char*& /*pEnd*/) { return ERRNO_INTERNAL_INPUT_ERROR; }
+	int CUnixSocketTransport::Write(const std::string& /*strIn*/) { return ERRNO_INTERNAL_OUTPUT_ERROR; }
+	size_t CUnixSocketTransport::GetPendingOutputBytes() const { return 0; }
+	CUnixSocketListener::~CUnixSocketListener() {}
+	void CUnixSocketListener::SetPath(const std::string& strPath) { m_strPath = strPath; }
+	const std::string& CUnixSocketListener::GetPath() const { return m_strPath; }
+	int CUnixSocketListener::Listen(AcceptCallback /*fnOnAccept*/) { return ERRNO_INTERNAL_ERROR; }
+	int CUnixSocketListener::Close() { return ERRNO_OK; }
+#endif
+
+	int CUnixSocketTransport::Error(const std::string& /*strIn*/)
+	{
+		return ERRNO_OK;
+	}
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	// CShmRingTransport
+	static const uint32_t SHM_MAGIC = 0x544d4350;	// "TMCP"
+	static const uint32_t SHM_VERSION = 1;
+	// Record headers: the length of the bytes following, and what the record is.
+	static const uint32_t RECORD_PADDING = 0x80000000u;		// the rest of the ring is unused, go on at its start
+	static const uint32_t RECORD_MORE = 0x40000000u;		// a piece, the message goes on in the next record
+	static const uint32_t RECORD_LENGTH_MASK = 0x3fffffffu;
+	static const size_t RECORD_ALIGNMENT = 8;
+	static const size_t SIDE_SERVER = 0;
+	static const size_t SIDE_CLIENT = 1;
+
+	static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex words must be plain 32-bit integers");
+	static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2, "the rings need address-free atomics");
+
+	// Shared by both processes; positions count bytes from the start and only grow.
+	struct CShmRingTransport::Ring
+	{
+		// Written by the producer.
+		alignas(64) std::atomic<uint64_t> ullHead;
+		std::atomic<uint32_t> uDataSeq;			// bumped after every publish, the consumer sleeps on it
+		std::atomic<uint32_t> uDataWaiting;
+		// Written by the consumer.
+		alignas(64) std::atomic<uint64_t> ullTail;
+		std::atomic<uint32_t> uSpaceSeq;		// bumped after every release, the producer sleeps on it
+		std::atomic<uint32_t> uSpaceWaiting;
+	};
+
+	struct CShmRingTransport::Segment
+	{
+		std::atomic<uint32_t> uMagic;			// set by the server once the segment is ready
+		uint32_t uVersion;
+		uint64_t ullRingBytes;
+		std::atomic<int32_t> arrPids[2];		// server, client
+		std::atomic<uint32_t> arrClosed[2];
+		Ring ringToServer;
+		Ring ringToClient;
+	};
+
+	static size_t AlignRecord(size_t nBytes)
+	{
+		return (nBytes + RECORD_ALIGNMENT - 1) & ~(RECORD_ALIGNMENT - 1);
+	}
+
+#ifdef __linux__
+	static void FutexWait(std::atomic<uint32_t>& uWord, uint32_t uExpected, int iTimeoutMs)
+	{
+		timespec ts{ iTimeoutMs / 1000, (iTimeoutMs % 1000) * 1000000L };
+		syscall(SYS_futex, reinterpret_cast<uint32_t*>(&uWord), FUTEX_WAIT, uExpected, &ts, nullptr, 0);
+	}
+
+	static void FutexWake(std::atomic<uint32_t>& uWord)
+	{
+		syscall(SYS_futex, reinterpret_cast<uint32_t*>(&uWord), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+	}
+#else
+	static void FutexWait(std::atomic<uint32_t>& /*uWord*/, uint32_t /*uExpected*/, int /*iTimeoutMs*/)
+	{
+		std::this_thread::sleep_for(std::chrono::microseconds(50));
+	}
+
+	static void FutexWake(std::atomic<uint32_t>& /*uWord*/)
+	{
+	}
+#endif
+
+	// A bump of the sequence is seen by a consumer about to sleep, which FUTEX_WAIT re-checks.
+	static void Signal(std::atomic<uint32_t>& uSeq, std::atomic<uint32_t>& uWaiting)
+	{
+		uSeq.fetch_add(1, std::memory_order_seq_cst);
+		if (uWaiting.load(std::memory_order_seq_cst))
+			FutexWake(uSeq);
+	}
+
+	CShmRingTransport::CShmRingTransport(const std::string& strName, bool bServer)
+		: m_strName(strName)
+		, m_bServer(bServer)
+	{
+
+	}
+
+	CShmRingTransport::~CShmRingTransport()
+	{
+		Disconnect();
+#ifndef _WIN32
+		if (m_pSegment)
+			munmap(m_pSegment, m_nSegmentSize);
+		if (m_bServer && m_pSegment)
+			shm_unlink(m_strName.c_str());
+#endif
+	}
+
+	int CShmRingTransport::Connect()
+	{
+#ifdef _WIN32
+		return ERRNO_INTERNAL_ERROR;
+#else
+		if (m_pSegment)
+			return ERRNO_OK;
+
+		auto& config = Config::GetInstance();
+		int iSpinUs = config.GetLocalSpinUs();
+		m_nSpinUs = iSpinUs > 0 ? static_cast<unsigned int>(iSpinUs) : 0;
+		// On a single core the spinning side only delays the peer it waits for.
+		if (std::thread::hardware_concurrency() <= 1)
+			m_nSpinUs = 0;
+
+		int iFd = -1;
+		size_t nRingBytes = 0;
+		if (m_bServer)
+		{
+			int iRingBytes = config.GetLocalShmRingBytes();
+			nRingBytes = 64 * 1024;
+			while (nRingBytes < static_cast<size_t>(iRingBytes > 0 ? iRingBytes : 0))
+				nRingBytes <<= 1;
+			shm_unlink(m_strName.c_str());
+			iFd = shm_open(m_strName.c_str(), O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+			if (iFd >= 0 && 0 != ftruncate(iFd, static_cast<off_t>(sizeof(Segment) + 2 * nRingBytes)))
+			{
+				close(iFd);
+				iFd = -1;
+			}
+		}
+		else
+		{
+			iFd = shm_open(m_strName.c_str(), O_RDWR, 0);
+		}
+		if (iFd < 0)
+		{
+			MCP_LOG_ERROR("transport", "cannot open the shared memory segment {}: errno {}", m_strName, errno);
+			return ERRNO_INTERNAL_ERROR;
+		}
+
+		struct stat st;
+		if (0 != fstat(iFd, &st) || static_cast<size_t>(st.st_size) < sizeof(Segment))
+		{
+			close(iFd);
+			return ERRNO_INTERNAL_ERROR;
+		}
+		size_t nSize = static_cast<size_t>(st.st_size);
+		void* pMapping = mmap(nullptr, nSize, PROT_READ | PROT_WRITE, MAP_SHARED, iFd, 0);
+		close(iFd);
+		if (MAP_FAILED == pMapping)
+			return ERRNO_INTERNAL_ERROR;
+
+		Segment* pSegment = static_cast<Segment*>(pMapping);
+		if (m_bServer)
+		{
+			pSegment = new (pMapping) Segment();
+			pSegment->uVersion = SHM_VERSION;
+			pSegment->ullRingBytes = nRingBytes;
+			pSegment->arrPids[SIDE_SERVER].store(static_cast<int32_t>(getpid()));
+			pSegment->uMagic.store(SHM_MAGIC, std::memory_order_release);
+		}
+		else
+		{
+			int32_t iNoClient = 0;
+			bool bValid = SHM_MAGIC == pSegment->uMagic.load(std::memory_order_acquire)
+				&& SHM_VERSION == pSegment->uVersion
+				&& sizeof(Segment) + 2 * pSegment->ullRingBytes == nSize;
+			// One client per segment: the server has a single session on it.
+			if (!bValid || 0 != pSegment->arrClosed[SIDE_SERVER].load()
+				|| !pSegment->arrPids[SIDE_CLIENT].compare_exchange_strong(iNoClient, static_cast<int32_t>(getpid())))
+			{
+				munmap(pMapping, nSize);
+				return ERRNO_INTERNAL_ERROR;
+			}
+			nRingBytes = static_cast<size_t>(pSegment->ullRingBytes);
+		}
+
+		m_pSegment = pSegment;
+		m_nSegmentSize = nSize;
+		m_nRingBytes = nRingBytes;
+		char* pRings = static_cast<char*>(pMapping) + sizeof(Segment);
+		m_pIncoming = m_bServer ? pRings : pRings + nRingBytes;
+		m_pOutgoing = m_bServer ? pRings + nRingBytes : pRings;
+
+		return ERRNO_OK;
+#endif
+	}
+
+	int CShmRingTransport::Disconnect()
+	{
+		if (!m_pSegment || m_bDisconnected.exchange(true))
+			return ERRNO_OK;
+
+		m_pSegment->arrClosed[m_bServer ? SIDE_SERVER : SIDE_CLIENT].store(1);
+		// Wakes both sides, whatever they wait for; our own reader included.
+		for (Ring* pRing : { &m_pSegment->ringToServer, &m_pSegment->ringToClient })
+		{
+			pRing->uDataSeq.fetch_add(1);
+			FutexWake(pRing->uDataSeq);
+			pRing->uSpaceSeq.fetch_add(1);
+			FutexWake(pRing->uSpaceSeq);
+		}
+
+		return ERRNO_OK;
+	}
+
+	bool CShmRingTransport::IsPeerGone() const
+	{
+		size_t nPeer = m_bServer ? SIDE_CLIENT : SIDE_SERVER;
+		if (m_pSegment->arrClosed[nPeer].load())
+			return true;
+#ifndef _WIN32
+		// A peer that crashed never says goodbye.
+		int32_t iPid = m_pSegment->arrPids[nPeer].load();
+		if (iPid > 0 && 0 != kill(iPid, 0) && ESRCH == errno)
+			return true;
+#endif
+
+		return false;
+	}
+
+	template <class Fn>
+	int CShmRingTransport::WaitFor(Ring& ring, bool bData, Fn fnReady)
+	{
+		if (fnReady())
+			return ERRNO_OK;
+
+		auto tpSpinEnd = std::chrono::steady_clock::now() + std::chrono::microseconds(m_nSpinUs);
+		while (std::chrono::steady_clock::now() < tpSpinEnd)
+		{
+			if (fnReady())
+				return ERRNO_OK;
+		}
+
+		std::atomic<uint32_t>& uSeq = bData ? ring.uDataSeq : ring.uSpaceSeq;
+		std::atomic<uint32_t>& uWaiting = bData ? ring.uDataWaiting : ring.uSpaceWaiting;
+		while (true)
+		{
+			uWaiting.store(1, std::memory_order_seq_cst);
+			uint32_t uExpected = uSeq.load(std::memory_order_seq_cst);
+			if (fnReady())
+				break;
+			if (m_bDisconnected || IsPeerGone())
+			{
+				uWaiting.store(0);
+				// What the peer wrote before it left is still read.
+				if (fnReady())
+					return ERRNO_OK;
+				return bData ? ERRNO_INTERNAL_INPUT_TERMINATE : ERRNO_INTERNAL_OUTPUT_ERROR;
+			}
+			// Bounded, so that a peer that died is noticed.
+			FutexWait(uSeq, uExpected, 100);
+		}
+		uWaiting.store(0);
+
+		return ERRNO_OK;
+	}
+
+	int CShmRingTransport::Write(const std::string& strIn)
+	{
+		if (!m_pSegment || m_bDisconnected)
+			return ERRNO_INTERNAL_OUTPUT_ERROR;
+
+		// Pieces of at most a quarter of the ring keep a writer and a reader of large messages going.
+		size_t nPieceBytes = std::min<size_t>(m_nRingBytes / 4, RECORD_LENGTH_MASK) - RECORD_ALIGNMENT;
+		size_t nLength = PayloadLength(strIn);
+		const char* pData = strIn.data();
+		std::lock_guard<std::mutex> _lock(m_mtxWrite);
+		do
+		{
+			size_t nPiece = std::min(nLength, nPieceBytes);
+			int iErrCode = WriteRecord(pData, nPiece, nPiece < nLength);
+			if (ERRNO_OK != iErrCode)
+				return iErrCode;
+			pData += nPiece;
+			nLength -= nPiece;
+		} while (nLength > 0);
+
+		return ERRNO_OK;
+	}
+
+	int CShmRingTransport::WriteRecord(const char* pData, size_t nLength, bool bMore)
+	{
+		Ring& ring = m_bServer ? m_pSegment->ringToClient : m_pSegment->ringToServer;
+		uint64_t ullHead = ring.ullHead.load(std::memory_order_relaxed);
+		size_t nOffset = static_cast<size_t>(ullHead & (m_nRingBytes - 1));
+		size_t nRecord = AlignRecord(sizeof(uint32_t) + nLength);
+		// Records are contiguous, so that the reader can parse them in place.
+		size_t nPadding = m_nRingBytes - nOffset < nRecord ? m_nRingBytes - nOffset : 0;
+		uint64_t ullNeeded = nPadding + nRecord;
+
+		int iErrCode = WaitFor(ring, false, [&]()
+			{
+				return m_nRingBytes - (ullHead - ring.ullTail.load(std::memory_order_acquire)) >= ullNeeded;
+			});
+		if (ERRNO_OK != iErrCode)
+			return iErrCode;
+
+		if (nPadding > 0)
+		{
+			uint32_t uPadding = RECORD_PADDING;
+			memcpy(m_pOutgoing + nOffset, &uPadding, sizeof(uPadding));
+			nOffset = 0;
+		}
+		uint32_t uHeader = static_cast<uint32_t>(nLength) | (bMore ? RECORD_MORE : 0);
+		memcpy(m_pOutgoing + nOffset, &uHeader, sizeof(uHeader));
+		memcpy(m_pOutgoing + nOffset + sizeof(uHeader), pData, nLength);
+		ring.ullHead.store(ullHead + ullNeeded, std::memory_order_release);
+		Signal(ring.uDataSeq, ring.uDataWaiting);
+
+		return ERRNO_OK;
+	}
+
+	void CShmRingTransport::Release(uint64_t ullPos)
+	{
+		Ring& ring = m_bServer ? m_pSegment->ringToServer : m_pSegment->ringToClient;
+		if (ring.ullTail.load(std::memory_order_relaxed) == ullPos)
+			return;
+		ring.ullTail.store(ullPos, std::memory_order_release);
+		Signal(ring.uSpaceSeq, ring.uSpaceWaiting);
+	}
+
+	int CShmRingTransport::Read(std::string& strOut)
+	{
+		const char* pBegin = nullptr;
+		const char* pEnd = nullptr;
+		int iErrCode = ReadFrame(pBegin, pEnd);
+		if (ERRNO_OK != iErrCode)
+			return iErrCode;
+		strOut.assign(pBegin, pEnd);
+
+		return ERRNO_OK;
+	}
+
+	int CShmRingTransport::ReadFrame(const char*& pBegin, const char*& pEnd)
+	{
+		if (!m_pSegment)
+			return ERRNO_INTERNAL_INPUT_ERROR;
+
+		const std::lock_guard<std::mutex> _lock(m_mtxRead);
+		Ring& ring = m_bServer ? m_pSegment->ringToServer : m_pSegment->ringToClient;
+		// The frame handed out last is done with.
+		Release(m_ullReadPos);
+		if (m_bAssembled)
+		{
+			m_strAssembly.clear();
+			m_bAssembled = false;
+		}
+
+		while (true)
+		{
+			int iErrCode = WaitFor(ring, true, [&]()
+				{
+					return ring.ullHead.load(std::memory_order_acquire) != m_ullReadPos;
+				});
+			if (ERRNO_OK != iErrCode)
+				return iErrCode;
+
+			size_t nOffset = static_cast<size_t>(m_ullReadPos & (m_nRingBytes - 1));
+			uint32_t uHeader = 0;
+			memcpy(&uHeader, m_pIncoming + nOffset, sizeof(uHeader));
+			if (uHeader & RECORD_PADDING)
+			{
+				m_ullReadPos += m_nRingBytes - nOffset;
+				continue;
+			}
+			size_t nLength = uHeader & RECORD_LENGTH_MASK;
+			size_t nRecord = AlignRecord(sizeof(uHeader) + nLength);
+			if (nRecord > m_nRingBytes - nOffset)
+				return ERRNO_INTERNAL_INPUT_ERROR;
+			const char* pData = m_pIncoming + nOffset + sizeof(uHeader);
+			m_ullReadPos += nRecord;
+
+			if (!(uHeader & RECORD_MORE) && m_strAssembly.empty())
+			{
+				pBegin = pData;
+				pEnd = pData + nLength;
+				return ERRNO_OK;
+			}
+
+			// Pieces are copied out right away, which makes room for the next ones.
+			m_strAssembly.append(pData, nLength);
+			Release(m_ullReadPos);
+			if (!(uHeader & RECORD_MORE))
+			{
+				m_bAssembled = true;
+				pBegin = m_strAssembly.data();
+				pEnd = pBegin + m_strAssembly.size();
+				return ERRNO_OK;
+			}
+		}
+	}
+
+	int CShmRingTransport::Error(const std::string& /*strIn*/)
+	{
+		return ERRNO_OK;
+	}
+
+	size_t CShmRingTransport::GetPendingOutputBytes() const
+	{
+		if (!m_pSegment)
+			return 0;
+		const Ring& ring = m_bServer ? m_pSegment->ringToClient : m_pSegment->ringToServer;
+
+		return static_cast<size_t>(ring.ullHead.load(std::memory_order_relaxed) - ring.ullTail.load(std::memory_order_relaxed));
+	}
+}
@@ -0,0 +1,165 @@
+#pragma once
+// To ensure good cross-platform compatibility, the MCP namespace code uses standard C++ only.
+// Avoid using platform-specific system APIs unless absolutely necessary.
+//
+// Transports for clients on the same host (sidecars, agents spawning nothing). Both use POSIX
+// APIs and are not available on Windows, where Connect() and Listen() fail.
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Transport.h"
+
+namespace MCP
+{
+	// One client over a connected Unix domain socket.
+	//
+	// Every message is a frame: a 32-bit little-endian byte count followed by the JSON text (without
+	// the newline of stdio), so the reader never scans for delimiters. A frame of [local]
+	// fd_passing_bytes or more does not go through the socket buffers: the sender writes it, prefix
+	// included, to a sealed memfd and sends only the prefix with bit 31 set and the descriptor attached
+	// (SCM_RIGHTS); the receiver maps the memfd and parses the message in place. Descriptors are only
+	// passed on Linux, other systems send every frame inline.
+	class CUnixSocketTransport : public CMCPTransport
+	{
+	public:
+		// Takes over a connected socket.
+		explicit CUnixSocketTransport(int iFd);
+		~CUnixSocketTransport();
+		CUnixSocketTransport(const CUnixSocketTransport&) = delete;
+		CUnixSocketTransport& operator=(const CUnixSocketTransport&) = delete;
+
+		// Client side: connects to the socket a CUnixSocketListener listens on; nullptr on failure.
+		static std::shared_ptr<CUnixSocketTransport> ConnectTo(const std::string& strPath);
+
+		int Connect() override;
+		// Shuts the socket down, which makes a Read() in progress return.
+		int Disconnect() override;
+		int Read(std::string& strOut) override;
+		// Thread safe; the message has been handed to the socket when it returns.
+		int Write(const std::string& strIn) override;
+		int Error(const std::string& strIn) override;
+		// The frame is in the read buffer or in the mapped memfd until the next call.
+		int ReadFrame(const char*& pBegin, const char*& pEnd) override;
+		size_t GetPendingOutputBytes() const override;
+
+	private:
+		int FillReadBuffer();
+		int MapFrame(int iFd, size_t nLength, const char*& pBegin, const char*& pEnd);
+		void ReleaseMapping();
+		int SendInline(const char* pData, size_t nLength);
+		int SendDescriptor(const char* pData, size_t nLength);
+		int SendAll(const char* pData, size_t nLength, int iFd);
+
+		int m_iFd{ -1 };
+		std::atomic<bool> m_bConnected{ false };
+		size_t m_nMaxFrameBytes{ 64 * 1024 * 1024 };
+		// 0 = frames are always sent inline.
+		size_t m_nFdPassingBytes{ 0 };
+
+		std::recursive_mutex m_mtxRead;
+		std::vector<char> m_vecReadBuffer;
+		size_t m_nReadBegin{ 0 };
+		size_t m_nReadEnd{ 0 };
+		bool m_bReadEof{ false };
+		// Descriptors received and not claimed by a frame yet, oldest first.
+		std::deque<int> m_queueFds;
+		void* m_pMapping{ nullptr };
+		size_t m_nMappingSize{ 0 };
+
+		std::mutex m_mtxWrite;
+		std::atomic<size_t> m_nPendingOutputBytes{ 0 };
+	};
+
+	// Accepts clients on [local] socket_path and hands one CUnixSocketTransport per connection to
+	// the server. The socket file is created with mode 0600, so only the user running the server
+	// (and root) can connect, and is removed by Close().
+	class CUnixSocketListener : public CMCPListener
+	{
+	public:
+		~CUnixSocketListener();
+
+		int Listen(AcceptCallback fnOnAccept) override;
+		int Close() override;
+
+		// Replaces [local] socket_path; takes effect on the next Listen().
+		void SetPath(const std::string& strPath);
+		const std::string& GetPath() const;
+
+	private:
+		void AcceptThreadProc();
+
+		std::string m_strPath;
+		int m_iListenFd{ -1 };
+		int m_arrWakeupFds[2]{ -1, -1 };
+		AcceptCallback m_fnOnAccept;
+		std::thread m_thrAccept;
+		std::mutex m_mtxTransports;
+		std::vector<std::weak_ptr<CUnixSocketTransport>> m_vecTransports;
+	};
+
+	// One client over a shared memory segment holding a ring buffer per direction.
+	//
+	// The server creates the segment ([local] shm_name, mode 0600, [local] shm_ring_bytes per ring)
+	// and the client opens it. A message is copied into the ring once and parsed in place by the
+	// reader, so no system call is made while both sides keep up. Each ring has one producer and
+	// one consumer: writers of a side take turns, and messages larger than a quarter of the ring go
+	// in pieces that the reader reassembles. A side with nothing to read or no room to write polls
+	// for [local] spin_us, then sleeps on a futex word in the segment (Linux; elsewhere it naps
+	// between polls). Like stdio, the transport serves a single client: the server's Read() ends once
+	// the client disconnected or its process is gone.
+	class CShmRingTransport : public CMCPTransport
+	{
+	public:
+		// The server (bServer) creates the segment, replacing a stale one of the same name.
+		CShmRingTransport(const std::string& strName, bool bServer);
+		~CShmRingTransport();
+		CShmRingTransport(const CShmRingTransport&) = delete;
+		CShmRingTransport& operator=(const CShmRingTransport&) = delete;
+
+		int Connect() override;
+		int Disconnect() override;
+		int Read(std::string& strOut) override;
+		// Thread safe; waits while the ring is full.
+		int Write(const std::string& strIn) override;
+		int Error(const std::string& strIn) override;
+		// The frame is in the ring, or reassembled in a buffer of the transport, until the next call.
+		int ReadFrame(const char*& pBegin, const char*& pEnd) override;
+		// Bytes in the outgoing ring the peer has not consumed yet.
+		size_t GetPendingOutputBytes() const override;
+
+	private:
+		struct Ring;
+		struct Segment;
+
+		int WriteRecord(const char* pData, size_t nLength, bool bMore);
+		void Release(uint64_t ullPos);
+		// Polls fnReady, then sleeps on uSeq; ERRNO_OK once it returned true.
+		template <class Fn>
+		int WaitFor(Ring& ring, bool bData, Fn fnReady);
+		bool IsPeerGone() const;
+
+		std::string m_strName;
+		bool m_bServer{ false };
+		Segment* m_pSegment{ nullptr };
+		size_t m_nSegmentSize{ 0 };
+		size_t m_nRingBytes{ 0 };
+		char* m_pIncoming{ nullptr };
+		char* m_pOutgoing{ nullptr };
+		unsigned int m_nSpinUs{ 50 };
+		std::atomic<bool> m_bDisconnected{ false };
+
+		std::mutex m_mtxRead;
+		// Consumed up to here; released to the producer when the frame handed out is done with.
+		uint64_t m_ullReadPos{ 0 };
+		std::string m_strAssembly;
+		bool m_bAssembled{ false };
+
+		std::mutex m_mtxWrite;
+	};
+}
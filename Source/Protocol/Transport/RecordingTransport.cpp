@@ -0,0 +1,361 @@
+#include "RecordingTransport.h"
+#include <cstring>
+#include <unordered_map>
+#include <utility>
+
+namespace MCP
+{
+	static const char s_szRecordingMagic[] = "TMCPREC1";
+	static const size_t RECORDING_MAGIC_LENGTH = sizeof(s_szRecordingMagic) - 1;
+
+	static void AppendVarint(std::string& strOut, unsigned long long ullValue)
+	{
+		while (ullValue >= 0x80)
+		{
+			strOut += static_cast<char>((ullValue & 0x7F) | 0x80);
+			ullValue >>= 7;
+		}
+		strOut += static_cast<char>(ullValue);
+	}
+
+	static bool ReadVarint(std::istream& is, unsigned long long& ullValue)
+	{
+		ullValue = 0;
+		for (unsigned int uShift = 0; uShift < 64; uShift += 7)
+		{
+			int iByte = is.get();
+			if (iByte < 0)
+				return false;
+			ullValue |= static_cast<unsigned long long>(iByte & 0x7F) << uShift;
+			if (0 == (iByte & 0x80))
+				return true;
+		}
+
+		return false;
+	}
+
+	CMCPTrafficRecorder::~CMCPTrafficRecorder()
+	{
+		Close();
+	}
+
+	int CMCPTrafficRecorder::Open(const std::string& strPath)
+	{
+		std::lock_guard<std::mutex> _lock(m_mtxFile);
+		if (m_ofs.is_open())
+			return ERRNO_INTERNAL_ERROR;
+		m_ofs.open(strPath, std::ios::binary | std::ios::app);
+		if (!m_ofs)
+			return ERRNO_INTERNAL_ERROR;
+		if (0 == m_ofs.tellp())
+			m_ofs.write(s_szRecordingMagic, RECORDING_MAGIC_LENGTH);
+
+		auto ullNowUs = std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::system_clock::now().time_since_epoch()).count();
+		m_tpLast = Clock::now();
+		WriteRecord(TrafficRecord_Epoch, 0, static_cast<unsigned long long>(ullNowUs), nullptr, 0);
+		if (!m_ofs.flush())
+			return ERRNO_INTERNAL_ERROR;
+
+		return ERRNO_OK;
+	}
+
+	int CMCPTrafficRecorder::Close()
+	{
+		std::lock_guard<std::mutex> _lock(m_mtxFile);
+		if (!m_ofs.is_open())
+			return ERRNO_OK;
+		m_ofs.close();
+
+		return m_ofs ? ERRNO_OK : ERRNO_INTERNAL_ERROR;
+	}
+
+	int CMCPTrafficRecorder::Flush()
+	{
+		std::lock_guard<std::mutex> _lock(m_mtxFile);
+		if (!m_ofs.is_open() || !m_ofs.flush())
+			return ERRNO_INTERNAL_ERROR;
+
+		return ERRNO_OK;
+	}
+
+	unsigned long long CMCPTrafficRecorder::OpenSession()
+	{
+		unsigned long long ullSession = m_ullNextSession++;
+		if (ERRNO_OK != Record(TrafficRecord_Open, ullSession, nullptr, 0))
+			return 0;
+
+		return ullSession;
+	}
+
+	int CMCPTrafficRecorder::Record(TrafficRecordKind eKind, unsigned long long ullSession, const char* pData, size_t nLength)
+	{
+		std::lock_guard<std::mutex> _lock(m_mtxFile);
+		if (!m_ofs.is_open())
+			return ERRNO_INTERNAL_ERROR;
+		// Taken under the lock, so that the records of the file are in time order.
+		auto tpNow = Clock::now();
+		auto llElapsedUs = std::chrono::duration_cast<std::chrono::microseconds>(tpNow - m_tpLast).count();
+		m_tpLast = tpNow;
+		WriteRecord(eKind, ullSession, llElapsedUs > 0 ? static_cast<unsigned long long>(llElapsedUs) : 0, pData, nLength);
+
+		return m_ofs ? ERRNO_OK : ERRNO_INTERNAL_ERROR;
+	}
+
+	void CMCPTrafficRecorder::WriteRecord(TrafficRecordKind eKind, unsigned long long ullSession, unsigned long long ullTimeUs,
+		const char* pData, size_t nLength)
+	{
+		m_strRecord.clear();
+		m_strRecord += static_cast<char>(eKind);
+		AppendVarint(m_strRecord, ullSession);
+		AppendVarint(m_strRecord, ullTimeUs);
+		AppendVarint(m_strRecord, nLength);
+		m_ofs.write(m_strRecord.data(), static_cast<std::streamsize>(m_strRecord.size()));
+		if (nLength > 0)
+			m_ofs.write(pData, static_cast<std::streamsize>(nLength));
+	}
+
+	int ReadTrafficRecording(const std::string& strPath, std::vector<TrafficRecord>& vecRecords)
+	{
+		vecRecords.clear();
+		std::ifstream ifs(strPath, std::ios::binary);
+		if (!ifs)
+			return ERRNO_INVALID_PARAMS;
+		char szMagic[RECORDING_MAGIC_LENGTH];
+		if (!ifs.read(szMagic, RECORDING_MAGIC_LENGTH) || 0 != memcmp(szMagic, s_szRecordingMagic, RECORDING_MAGIC_LENGTH))
+			return ERRNO_INVALID_PARAMS;
+
+		// Every recorder numbers its sessions from 1; they are renumbered over the file.
+		std::unordered_map<unsigned long long, unsigned long long> hashSessions;
+		unsigned long long ullNextSession = 1;
+		unsigned long long ullTimeUs = 0;
+		while (true)
+		{
+			int iKind = ifs.get();
+			if (iKind < 0)
+				break;
+			unsigned long long ullSession = 0;
+			unsigned long long ullElapsedUs = 0;
+			unsigned long long ullLength = 0;
+			if (iKind > TrafficRecord_Close || !ReadVarint(ifs, ullSession) || !ReadVarint(ifs, ullElapsedUs)
+				|| !ReadVarint(ifs, ullLength))
+				break;
+			TrafficRecord record;
+			record.eKind = static_cast<TrafficRecordKind>(iKind);
+			if (ullLength > 0)
+			{
+				record.strFrame.resize(static_cast<size_t>(ullLength));
+				if (!ifs.read(&record.strFrame[0], static_cast<std::streamsize>(ullLength)))
+					break;
+			}
+			if (TrafficRecord_Epoch == record.eKind)
+			{
+				ullTimeUs = ullElapsedUs;
+				hashSessions.clear();
+				continue;
+			}
+
+			ullTimeUs += ullElapsedUs;
+			record.ullTimeUs = ullTimeUs;
+			auto itrSession = hashSessions.find(ullSession);
+			if (itrSession == hashSessions.end())
+				itrSession = hashSessions.emplace(ullSession, ullNextSession++).first;
+			record.ullSession = itrSession->second;
+			vecRecords.push_back(std::move(record));
+		}
+
+		return ERRNO_OK;
+	}
+
+	class CRecordingTransport::CRecordingMessageStream : public CMCPMessageStream
+	{
+	public:
+		CRecordingMessageStream(CRecordingTransport& transport, std::unique_ptr<CMCPMessageStream>&& spStream)
+			: m_transport(transport)
+			, m_spStream(std::move(spStream))
+		{
+		}
+
+		~CRecordingMessageStream()
+		{
+			Close();
+		}
+
+		int Append(const char* pData, size_t nLength) override
+		{
+			if (!m_spStream)
+				return ERRNO_INTERNAL_ERROR;
+			m_strFrame.append(pData, nLength);
+			return m_spStream->Append(pData, nLength);
+		}
+
+		int Close() override
+		{
+			if (!m_spStream)
+				return ERRNO_OK;
+			int iErrCode = m_spStream->Close();
+			m_spStream.reset();
+			if (ERRNO_OK == iErrCode)
+				m_transport.m_spRecorder->Record(TrafficRecord_Outbound, m_transport.m_ullSession, m_strFrame.data(), m_strFrame.size());
+			m_strFrame.clear();
+
+			return iErrCode;
+		}
+
+	private:
+		CRecordingTransport& m_transport;
+		std::unique_ptr<CMCPMessageStream> m_spStream;
+		std::string m_strFrame;
+	};
+
+	CRecordingTransport::CRecordingTransport(std::shared_ptr<CMCPTransport> spTransport, std::shared_ptr<CMCPTrafficRecorder> spRecorder)
+		: m_spTransport(std::move(spTransport))
+		, m_spRecorder(std::move(spRecorder))
+	{
+		m_ullSession = m_spRecorder->OpenSession();
+	}
+
+	CRecordingTransport::~CRecordingTransport()
+	{
+		RecordClose();
+	}
+
+	int CRecordingTransport::Connect()
+	{
+		return m_spTransport->Connect();
+	}
+
+	int CRecordingTransport::Disconnect()
+	{
+		int iErrCode = m_spTransport->Disconnect();
+		RecordClose();
+
+		return iErrCode;
+	}
+
+	int CRecordingTransport::Read(std::string& strOut)
+	{
+		int iErrCode = m_spTransport->Read(strOut);
+		if (ERRNO_OK == iErrCode)
+			m_spRecorder->Record(TrafficRecord_Inbound, m_ullSession, strOut.data(), strOut.size());
+		else
+			RecordClose();
+
+		return iErrCode;
+	}
+
+	int CRecordingTransport::Write(const std::string& strIn)
+	{
+		int iErrCode = m_spTransport->Write(strIn);
+		if (ERRNO_OK == iErrCode)
+			m_spRecorder->Record(TrafficRecord_Outbound, m_ullSession, strIn.data(), strIn.size());
+
+		return iErrCode;
+	}
+
+	int CRecordingTransport::Error(const std::string& strIn)
+	{
+		return m_spTransport->Error(strIn);
+	}
+
+	int CRecordingTransport::ReadFrame(const char*& pBegin, const char*& pEnd)
+	{
+		int iErrCode = m_spTransport->ReadFrame(pBegin, pEnd);
+		if (ERRNO_OK == iErrCode)
+			m_spRecorder->Record(TrafficRecord_Inbound, m_ullSession, pBegin, static_cast<size_t>(pEnd - pBegin));
+		else
+			RecordClose();
+
+		return iErrCode;
+	}
+
+	bool CRecordingTransport::SetFrameHandler(FrameHandler fnOnFrame, CloseHandler fnOnClose)
+	{
+		// The recorder is held by the handlers: they may run after this transport is gone.
+		auto spRecorder = m_spRecorder;
+		auto spClosed = m_spClosed;
+		unsigned long long ullSession = m_ullSession;
+		return m_spTransport->SetFrameHandler(
+			[spRecorder, ullSession, fnOnFrame](const char* pBegin, const char* pEnd)
+			{
+				spRecorder->Record(TrafficRecord_Inbound, ullSession, pBegin, static_cast<size_t>(pEnd - pBegin));
+				fnOnFrame(pBegin, pEnd);
+			},
+			[spRecorder, ullSession, spClosed, fnOnClose]()
+			{
+				RecordClose(*spRecorder, ullSession, *spClosed);
+				if (fnOnClose)
+					fnOnClose();
+			});
+	}
+
+	std::unique_ptr<CMCPMessageStream> CRecordingTransport::OpenMessageStream()
+	{
+		return std::make_unique<CRecordingMessageStream>(*this, m_spTransport->OpenMessageStream());
+	}
+
+	bool CRecordingTransport::SupportsFrameFormat(FrameFormat eFormat) const
+	{
+		return m_spTransport->SupportsFrameFormat(eFormat);
+	}
+
+	int CRecordingTransport::SetFrameFormat(FrameFormat eFormat)
+	{
+		return m_spTransport->SetFrameFormat(eFormat);
+	}
+
+	bool CRecordingTransport::IsAuthenticated() const
+	{
+		return m_spTransport->IsAuthenticated();
+	}
+
+	const std::string& CRecordingTransport::GetPrincipal() const
+	{
+		return m_spTransport->GetPrincipal();
+	}
+
+	size_t CRecordingTransport::GetPendingOutputBytes() const
+	{
+		return m_spTransport->GetPendingOutputBytes();
+	}
+
+	void CRecordingTransport::RecordClose(CMCPTrafficRecorder& recorder, unsigned long long ullSession, std::atomic<bool>& bClosed)
+	{
+		if (!bClosed.exchange(true))
+			recorder.Record(TrafficRecord_Close, ullSession, nullptr, 0);
+	}
+
+	void CRecordingTransport::RecordClose()
+	{
+		RecordClose(*m_spRecorder, m_ullSession, *m_spClosed);
+	}
+
+	CRecordingListener::CRecordingListener(std::shared_ptr<CMCPListener> spListener, std::shared_ptr<CMCPTrafficRecorder> spRecorder)
+		: m_spListener(std::move(spListener))
+		, m_spRecorder(std::move(spRecorder))
+	{
+
+	}
+
+	int CRecordingListener::Listen(AcceptCallback fnOnAccept)
+	{
+		auto spRecorder = m_spRecorder;
+		return m_spListener->Listen([spRecorder, fnOnAccept](const std::shared_ptr<CMCPTransport>& spTransport)
+			{
+				fnOnAccept(std::make_shared<CRecordingTransport>(spTransport, spRecorder));
+			});
+	}
+
+	int CRecordingListener::Close()
+	{
+		int iErrCode = m_spListener->Close();
+		m_spRecorder->Flush();
+
+		return iErrCode;
+	}
+
+	const std::shared_ptr<CMCPListener>& CRecordingListener::GetListener() const
+	{
+		return m_spListener;
+	}
+}
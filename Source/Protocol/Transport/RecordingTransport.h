@@ -0,0 +1,135 @@
+#pragma once
+// To ensure good cross-platform compatibility, the MCP namespace code uses standard C++ only.
+// Avoid using platform-specific system APIs unless absolutely necessary.
+//
+// Capture of real sessions, to be replayed later by CMCPTrafficReplay (Session/TrafficReplay.h).
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Transport.h"
+
+namespace MCP
+{
+	enum TrafficRecordKind
+	{
+		// Written once by every recorder that opens the file: later records count their time from it.
+		TrafficRecord_Epoch = 0,
+		TrafficRecord_Open = 1,
+		// A frame read from the client.
+		TrafficRecord_Inbound = 2,
+		// A frame written to the client.
+		TrafficRecord_Outbound = 3,
+		TrafficRecord_Close = 4,
+	};
+
+	// One record of a recording, as read back by ReadTrafficRecording().
+	struct TrafficRecord
+	{
+		TrafficRecordKind eKind{ TrafficRecord_Open };
+		// Numbered from 1 over the whole file, also when several recorders appended to it.
+		unsigned long long ullSession{ 0 };
+		// Microseconds since the Unix epoch.
+		unsigned long long ullTimeUs{ 0 };
+		// The frame as it went over the transport, length prefix included for binary frames.
+		std::string strFrame;
+	};
+
+	// Appends the frames of any number of sessions to one file.
+	//
+	// The file starts with the magic "TMCPREC1"; every record is its kind (one byte) followed by
+	// three varints: the session, the microseconds elapsed since the previous record of the same
+	// recorder (since the Unix epoch for the epoch record), and the length of the frame, then the
+	// frame itself. Records are buffered by the stream; Flush() or Close() write them out, so a
+	// process that crashes loses the last of them, never the ones before.
+	class CMCPTrafficRecorder
+	{
+	public:
+		CMCPTrafficRecorder() = default;
+		~CMCPTrafficRecorder();
+		CMCPTrafficRecorder(const CMCPTrafficRecorder&) = delete;
+		CMCPTrafficRecorder& operator=(const CMCPTrafficRecorder&) = delete;
+
+		// Appends to the file, which is created when missing.
+		int Open(const std::string& strPath);
+		int Close();
+		int Flush();
+
+		// Writes the open record of a new session and returns its number; 0 when not open.
+		unsigned long long OpenSession();
+		int Record(TrafficRecordKind eKind, unsigned long long ullSession, const char* pData, size_t nLength);
+
+	private:
+		using Clock = std::chrono::steady_clock;
+
+		// Locked.
+		void WriteRecord(TrafficRecordKind eKind, unsigned long long ullSession, unsigned long long ullTimeUs,
+			const char* pData, size_t nLength);
+
+		std::mutex m_mtxFile;
+		std::ofstream m_ofs;
+		std::string m_strRecord;
+		Clock::time_point m_tpLast;
+		std::atomic<unsigned long long> m_ullNextSession{ 1 };
+	};
+
+	// Reads a recording written by CMCPTrafficRecorder into vecRecords, in file order. A record cut
+	// short at the end of the file (the writer crashed) is left out.
+	int ReadTrafficRecording(const std::string& strPath, std::vector<TrafficRecord>& vecRecords);
+
+	// Records every frame read from and written to the wrapped transport, which it otherwise
+	// passes everything to. Frames written through message streams are recorded once closed.
+	class CRecordingTransport : public CMCPTransport
+	{
+	public:
+		CRecordingTransport(std::shared_ptr<CMCPTransport> spTransport, std::shared_ptr<CMCPTrafficRecorder> spRecorder);
+		~CRecordingTransport();
+
+		int Connect() override;
+		int Disconnect() override;
+		int Read(std::string& strOut) override;
+		int Write(const std::string& strIn) override;
+		int Error(const std::string& strIn) override;
+		int ReadFrame(const char*& pBegin, const char*& pEnd) override;
+		bool SetFrameHandler(FrameHandler fnOnFrame, CloseHandler fnOnClose) override;
+		std::unique_ptr<CMCPMessageStream> OpenMessageStream() override;
+		bool SupportsFrameFormat(FrameFormat eFormat) const override;
+		int SetFrameFormat(FrameFormat eFormat) override;
+		bool IsAuthenticated() const override;
+		const std::string& GetPrincipal() const override;
+		size_t GetPendingOutputBytes() const override;
+
+	private:
+		class CRecordingMessageStream;
+
+		// Records the end of the session once, however it is noticed.
+		static void RecordClose(CMCPTrafficRecorder& recorder, unsigned long long ullSession, std::atomic<bool>& bClosed);
+		void RecordClose();
+
+		std::shared_ptr<CMCPTransport> m_spTransport;
+		std::shared_ptr<CMCPTrafficRecorder> m_spRecorder;
+		unsigned long long m_ullSession{ 0 };
+		// Shared with the close handler, which may run after this transport is gone.
+		std::shared_ptr<std::atomic<bool>> m_spClosed{ std::make_shared<std::atomic<bool>>(false) };
+	};
+
+	// Hands the server every transport of the wrapped listener wrapped in a CRecordingTransport.
+	class CRecordingListener : public CMCPListener
+	{
+	public:
+		CRecordingListener(std::shared_ptr<CMCPListener> spListener, std::shared_ptr<CMCPTrafficRecorder> spRecorder);
+
+		int Listen(AcceptCallback fnOnAccept) override;
+		int Close() override;
+
+		const std::shared_ptr<CMCPListener>& GetListener() const;
+
+	private:
+		std::shared_ptr<CMCPListener> m_spListener;
+		std::shared_ptr<CMCPTrafficRecorder> m_spRecorder;
+	};
+}
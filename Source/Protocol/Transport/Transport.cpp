@@ -1,16 +1,209 @@
 #include "Transport.h"
 #include "../Public/PublicDef.h"
+#include "../Public/Config.h"
+#include "../Public/Logger.h"
 #include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+#ifdef _WIN32
+#include <cstdio>
+#include <io.h>
+#else
+#include <unistd.h>
+#include <sys/uio.h>
+#include <climits>
+#include <cerrno>
+#endif
 
 namespace MCP
 {
+	// Collects the pieces for transports that can only send whole messages.
+	class CBufferedMessageStream : public CMCPMessageStream
+	{
+	public:
+		explicit CBufferedMessageStream(CMCPTransport& transport)
+			: m_transport(transport)
+		{
+		}
+
+		~CBufferedMessageStream()
+		{
+			Close();
+		}
+
+		int Append(const char* pData, size_t nLength) override
+		{
+			if (m_bClosed)
+				return ERRNO_INTERNAL_ERROR;
+			m_strMessage.append(pData, nLength);
+
+			return ERRNO_OK;
+		}
+
+		int Close() override
+		{
+			if (m_bClosed)
+				return ERRNO_OK;
+			m_bClosed = true;
+
+			return m_transport.Write(m_strMessage);
+		}
+
+	private:
+		CMCPTransport& m_transport;
+		std::string m_strMessage;
+		bool m_bClosed{ false };
+	};
+
+	std::unique_ptr<CMCPMessageStream> CMCPTransport::OpenMessageStream()
+	{
+		return std::make_unique<CBufferedMessageStream>(*this);
+	}
+
+	const std::string& CMCPTransport::GetPrincipal() const
+	{
+		static const std::string s_strNone;
+		return s_strNone;
+	}
+
+	class CStdioTransport::CStdioMessageStream : public CMCPMessageStream
+	{
+	public:
+		explicit CStdioMessageStream(CStdioTransport& transport)
+			: m_transport(transport)
+		{
+		}
+
+		~CStdioMessageStream()
+		{
+			Close();
+		}
+
+		int Append(const char* pData, size_t nLength) override
+		{
+			if (m_bClosed)
+				return ERRNO_INTERNAL_ERROR;
+			if (0 == nLength)
+				return ERRNO_OK;
+
+			{
+				// Bounded: the producer waits for the writer instead of queueing the whole message.
+				std::unique_lock<std::mutex> _lock(m_transport.m_mtxStream);
+				m_transport.m_cvStream.wait(_lock, [this]()
+					{
+						return m_transport.m_nStreamPendingBytes < m_transport.m_nStreamPendingLimit
+							|| !m_transport.m_bWriterRunning || ERRNO_OK != m_transport.m_iWriterError;
+					});
+			}
+
+			return m_transport.Enqueue(Outgoing{ std::string(pData, nLength), OutgoingKind_Piece });
+		}
+
+		int Close() override
+		{
+			if (m_bClosed)
+				return ERRNO_OK;
+			m_bClosed = true;
+
+			int iErrCode = m_transport.Enqueue(Outgoing{ std::string(), OutgoingKind_LastPiece });
+			m_transport.CloseMessageStream();
+
+			return iErrCode;
+		}
+
+	private:
+		CStdioTransport& m_transport;
+		bool m_bClosed{ false };
+	};
+
+	CStdioTransport::~CStdioTransport()
+	{
+		Disconnect();
+	}
+
 	int CStdioTransport::Connect()
 	{
+		if (!m_bPolicyConfigured)
+		{
+			auto& config = Config::GetInstance();
+			int iLatencyUs = config.GetStdoutFlushLatencyUs();
+			int iFlushBytes = config.GetStdoutFlushBytes();
+			m_nFlushLatencyUs = iLatencyUs > 0 ? static_cast<unsigned int>(iLatencyUs) : 0;
+			m_nFlushBytes = iFlushBytes > 0 ? static_cast<size_t>(iFlushBytes) : 1;
+		}
+		int iStreamPendingBytes = Config::GetInstance().GetStdoutStreamPendingBytes();
+		m_nStreamPendingLimit = iStreamPendingBytes > 0 ? static_cast<size_t>(iStreamPendingBytes) : 1;
+
+		if (m_bWriterRunning.exchange(true))
+			return ERRNO_OK;
+		m_iWriterError = ERRNO_OK;
+		m_thrWriter = std::thread(&CStdioTransport::WriterThreadProc, this);
+
 		return ERRNO_OK;
 	}
 
 	int CStdioTransport::Disconnect()
 	{
+		if (m_bWriterRunning.exchange(false))
+		{
+			{
+				std::lock_guard<std::mutex> _lock(m_mtxWriter);
+				m_cvWriter.notify_one();
+			}
+			if (m_thrWriter.joinable())
+				m_thrWriter.join();
+		}
+
+		// Messages enqueued while the writer was shutting down.
+		std::vector<Outgoing> vecBatch;
+		std::vector<Outgoing> vecDeferred;
+		bool bStreaming = false;
+		Outgoing pending;
+		while (m_queueOutgoing.TryPop(pending))
+		{
+			AddToBatch(std::move(pending), vecBatch, vecDeferred, bStreaming);
+		}
+		for (auto& deferred : vecDeferred)
+		{
+			vecBatch.push_back(std::move(deferred));
+		}
+		{
+			// Streams waiting for the writer fall back to writing directly.
+			std::lock_guard<std::mutex> _lock(m_mtxStream);
+			m_cvStream.notify_all();
+		}
+		if (!vecBatch.empty())
+			return FlushBatch(vecBatch);
+
+		return m_iWriterError;
+	}
+
+	void CStdioTransport::SetFlushPolicy(unsigned int nLatencyUs, size_t nFlushBytes)
+	{
+		m_nFlushLatencyUs = nLatencyUs;
+		m_nFlushBytes = nFlushBytes > 0 ? nFlushBytes : 1;
+		m_bPolicyConfigured = true;
+	}
+
+	bool CStdioTransport::SupportsFrameFormat(FrameFormat eFormat) const
+	{
+		return FrameFormat_Line == eFormat || FrameFormat_LengthPrefixed == eFormat;
+	}
+
+	int CStdioTransport::SetFrameFormat(FrameFormat eFormat)
+	{
+		if (!SupportsFrameFormat(eFormat))
+			return ERRNO_INTERNAL_ERROR;
+
+		{
+			const std::lock_guard<std::recursive_mutex> _lock(m_mtxStdin);
+			int iMaxFrameBytes = Config::GetInstance().GetTransportMaxFrameBytes();
+			if (iMaxFrameBytes > 0)
+				m_nMaxFrameBytes = static_cast<size_t>(iMaxFrameBytes);
+		}
+		m_eFrameFormat.store(eFormat);
+
 		return ERRNO_OK;
 	}
 
@@ -18,29 +211,398 @@ namespace MCP
 	{
 		const std::lock_guard<std::recursive_mutex> _lock(m_mtxStdin);
 
-		if (std::getline(std::cin, strOut))
+		const char* pBegin = nullptr;
+		const char* pEnd = nullptr;
+		int iErrCode = ReadFrame(pBegin, pEnd);
+		if (ERRNO_OK != iErrCode)
+			return iErrCode;
+		strOut.assign(pBegin, pEnd);
+
+		return ERRNO_OK;
+	}
+
+	int CStdioTransport::ReadFrame(const char*& pBegin, const char*& pEnd)
+	{
+		const std::lock_guard<std::recursive_mutex> _lock(m_mtxStdin);
+
+		if (FrameFormat_LengthPrefixed == m_eFrameFormat.load())
+			return ReadLengthPrefixedFrame(pBegin, pEnd);
+
+		while (true)
 		{
-			return ERRNO_OK;
+			char* pData = m_vecReadBuffer.data();
+			auto pNewline = static_cast<char*>(memchr(pData + m_nReadScan, '\n', m_nReadEnd - m_nReadScan));
+			if (pNewline)
+			{
+				pBegin = pData + m_nReadBegin;
+				pEnd = pNewline;
+				if (pEnd > pBegin && '\r' == *(pEnd - 1))
+					pEnd--;
+				m_nReadBegin = m_nReadScan = static_cast<size_t>(pNewline - pData) + 1;
+
+				return ERRNO_OK;
+			}
+			m_nReadScan = m_nReadEnd;
+
+			if (m_bReadEof)
+			{
+				if (m_nReadBegin == m_nReadEnd)
+					return ERRNO_INTERNAL_INPUT_TERMINATE;
+
+				// Last line without a terminating newline.
+				pBegin = pData + m_nReadBegin;
+				pEnd = pData + m_nReadEnd;
+				m_nReadBegin = m_nReadScan = m_nReadEnd;
+
+				return ERRNO_OK;
+			}
+
+			int iErrCode = FillReadBuffer();
+			if (ERRNO_OK != iErrCode)
+				return iErrCode;
 		}
-		else
+	}
+
+	int CStdioTransport::ReadLengthPrefixedFrame(const char*& pBegin, const char*& pEnd)
+	{
+		static const size_t s_nPrefixBytes = 4;
+
+		while (true)
 		{
-			if (std::cin.eof())
+			char* pData = m_vecReadBuffer.data();
+			size_t nAvailable = m_nReadEnd - m_nReadBegin;
+			if (nAvailable >= s_nPrefixBytes)
 			{
-				return ERRNO_INTERNAL_INPUT_TERMINATE;
+				auto pPrefix = reinterpret_cast<const unsigned char*>(pData + m_nReadBegin);
+				size_t nLength = static_cast<size_t>(pPrefix[0])
+					| (static_cast<size_t>(pPrefix[1]) << 8)
+					| (static_cast<size_t>(pPrefix[2]) << 16)
+					| (static_cast<size_t>(pPrefix[3]) << 24);
+				if (nLength > m_nMaxFrameBytes)
+					return ERRNO_INTERNAL_INPUT_ERROR;
+				if (nAvailable - s_nPrefixBytes >= nLength)
+				{
+					pBegin = pData + m_nReadBegin;
+					pEnd = pBegin + s_nPrefixBytes + nLength;
+					m_nReadBegin = m_nReadScan = m_nReadBegin + s_nPrefixBytes + nLength;
+
+					return ERRNO_OK;
+				}
 			}
-			else
+
+			if (m_bReadEof)
 			{
+				if (m_nReadBegin == m_nReadEnd)
+					return ERRNO_INTERNAL_INPUT_TERMINATE;
+
+				// A truncated frame cannot be processed.
+				m_nReadBegin = m_nReadScan = m_nReadEnd;
 				return ERRNO_INTERNAL_INPUT_ERROR;
 			}
+
+			int iErrCode = FillReadBuffer();
+			if (ERRNO_OK != iErrCode)
+				return iErrCode;
 		}
+	}
+
+	int CStdioTransport::FillReadBuffer()
+	{
+		if (m_vecReadBuffer.empty())
+			m_vecReadBuffer.resize(READ_BUFFER_INITIAL_SIZE);
 
-		return ERRNO_INTERNAL_ERROR;
+		if (m_nReadBegin == m_nReadEnd)
+		{
+			m_nReadBegin = m_nReadScan = m_nReadEnd = 0;
+		}
+		else if (m_nReadEnd == m_vecReadBuffer.size())
+		{
+			if (m_nReadBegin > 0)
+			{
+				memmove(m_vecReadBuffer.data(), m_vecReadBuffer.data() + m_nReadBegin, m_nReadEnd - m_nReadBegin);
+				m_nReadScan -= m_nReadBegin;
+				m_nReadEnd -= m_nReadBegin;
+				m_nReadBegin = 0;
+			}
+			else
+			{
+				m_vecReadBuffer.resize(m_vecReadBuffer.size() * 2);
+			}
+		}
+
+		while (true)
+		{
+			size_t nSpace = m_vecReadBuffer.size() - m_nReadEnd;
+#ifdef _WIN32
+			int iRead = _read(0, m_vecReadBuffer.data() + m_nReadEnd, static_cast<unsigned int>(nSpace));
+#else
+			ssize_t iRead = read(STDIN_FILENO, m_vecReadBuffer.data() + m_nReadEnd, nSpace);
+#endif
+			if (iRead > 0)
+			{
+				m_nReadEnd += static_cast<size_t>(iRead);
+				return ERRNO_OK;
+			}
+			if (0 == iRead)
+			{
+				m_bReadEof = true;
+				return ERRNO_OK;
+			}
+#ifndef _WIN32
+			if (EINTR == errno)
+				continue;
+#endif
+			return ERRNO_INTERNAL_INPUT_ERROR;
+		}
 	}
 
 	int CStdioTransport::Write(const std::string& strIn)
 	{
-		const std::lock_guard<std::recursive_mutex> _lock(m_mtxStdout);
-		std::cout << strIn << std::endl;
+		OutgoingKind eKind = FrameFormat_LengthPrefixed == m_eFrameFormat.load() ? OutgoingKind_Frame : OutgoingKind_Message;
+		return Enqueue(Outgoing{ strIn, eKind });
+	}
+
+	std::unique_ptr<CMCPMessageStream> CStdioTransport::OpenMessageStream()
+	{
+		std::unique_lock<std::mutex> _lock(m_mtxStream);
+		m_cvStream.wait(_lock, [this]() { return !m_bStreamOpen; });
+		m_bStreamOpen = true;
+
+		return std::make_unique<CStdioMessageStream>(*this);
+	}
+
+	void CStdioTransport::CloseMessageStream()
+	{
+		std::lock_guard<std::mutex> _lock(m_mtxStream);
+		m_bStreamOpen = false;
+		m_cvStream.notify_all();
+	}
+
+	int CStdioTransport::Enqueue(Outgoing&& outgoing)
+	{
+		int iErrCode = m_iWriterError;
+		if (ERRNO_OK != iErrCode)
+			return iErrCode;
+
+		if (IsStreamed(outgoing))
+			m_nStreamPendingBytes += outgoing.strData.size();
+		m_nPendingOutputBytes += outgoing.strData.size();
+		if (!m_bWriterRunning)
+		{
+			std::vector<Outgoing> vecBatch;
+			vecBatch.push_back(std::move(outgoing));
+			return FlushBatch(vecBatch);
+		}
+
+		m_queueOutgoing.Push(std::move(outgoing));
+		if (m_bWriterSleeping)
+		{
+			std::lock_guard<std::mutex> _lock(m_mtxWriter);
+			m_cvWriter.notify_one();
+		}
+
+		return ERRNO_OK;
+	}
+
+	void CStdioTransport::WriterThreadProc()
+	{
+		std::vector<Outgoing> vecBatch;
+		// Messages written while a streamed message is incomplete.
+		std::vector<Outgoing> vecDeferred;
+		bool bStreaming = false;
+		size_t nBatchBytes = 0;
+		auto tpFirstPending = std::chrono::steady_clock::now();
+		const auto durLatency = std::chrono::microseconds(m_nFlushLatencyUs);
+
+		while (true)
+		{
+			Outgoing outgoing;
+			while (m_queueOutgoing.TryPop(outgoing))
+			{
+				if (vecBatch.empty())
+					tpFirstPending = std::chrono::steady_clock::now();
+				nBatchBytes += outgoing.strData.size() + 1;
+				AddToBatch(std::move(outgoing), vecBatch, vecDeferred, bStreaming);
+				if (nBatchBytes >= m_nFlushBytes)
+				{
+					FlushBatch(vecBatch);
+					nBatchBytes = 0;
+				}
+			}
+
+			bool bRunning = m_bWriterRunning;
+			if (!vecBatch.empty())
+			{
+				if (!bRunning || 0 == m_nFlushLatencyUs || std::chrono::steady_clock::now() - tpFirstPending >= durLatency)
+				{
+					FlushBatch(vecBatch);
+					nBatchBytes = 0;
+					continue;
+				}
+			}
+			if (!m_queueOutgoing.IsEmpty())
+			{
+				// A producer is halfway through Push().
+				std::this_thread::yield();
+				continue;
+			}
+			if (!bRunning)
+			{
+				// A stream left open at shutdown; its message is incomplete anyway.
+				if (!vecDeferred.empty())
+					FlushBatch(vecDeferred);
+				break;
+			}
+
+			// Producers only notify when the writer announced that it sleeps, so the queue
+			// has to be checked again after the announcement.
+			std::unique_lock<std::mutex> _lock(m_mtxWriter);
+			m_bWriterSleeping = true;
+			if (m_queueOutgoing.IsEmpty() && m_bWriterRunning)
+			{
+				if (vecBatch.empty())
+					m_cvWriter.wait(_lock);
+				else
+					m_cvWriter.wait_until(_lock, tpFirstPending + durLatency);
+			}
+			m_bWriterSleeping = false;
+		}
+	}
+
+	void CStdioTransport::AddToBatch(Outgoing&& outgoing, std::vector<Outgoing>& vecBatch, std::vector<Outgoing>& vecDeferred, bool& bStreaming)
+	{
+		if (!IsStreamed(outgoing) && bStreaming)
+		{
+			vecDeferred.push_back(std::move(outgoing));
+			return;
+		}
+
+		OutgoingKind eKind = outgoing.eKind;
+		vecBatch.push_back(std::move(outgoing));
+		if (OutgoingKind_Piece == eKind)
+		{
+			bStreaming = true;
+		}
+		else if (OutgoingKind_LastPiece == eKind)
+		{
+			bStreaming = false;
+			for (auto& deferred : vecDeferred)
+			{
+				vecBatch.push_back(std::move(deferred));
+			}
+			vecDeferred.clear();
+		}
+	}
+
+	int CStdioTransport::FlushBatch(std::vector<Outgoing>& vecBatch)
+	{
+		int iErrCode = ERRNO_OK;
+		{
+			const std::lock_guard<std::recursive_mutex> _lock(m_mtxStdout);
+			iErrCode = WriteAll(vecBatch);
+		}
+		size_t nStreamBytes = 0;
+		size_t nBytes = 0;
+		for (auto& outgoing : vecBatch)
+		{
+			if (IsStreamed(outgoing))
+				nStreamBytes += outgoing.strData.size();
+			nBytes += outgoing.strData.size();
+		}
+		vecBatch.clear();
+		m_nPendingOutputBytes -= nBytes;
+		if (ERRNO_OK != iErrCode)
+		{
+			MCP_LOG_ERROR("transport", "writing to stdout failed with {}", iErrCode);
+			m_iWriterError = iErrCode;
+		}
+		if (nStreamBytes > 0 || ERRNO_OK != iErrCode)
+		{
+			m_nStreamPendingBytes -= nStreamBytes;
+			std::lock_guard<std::mutex> _lock(m_mtxStream);
+			m_cvStream.notify_all();
+		}
+
+		return iErrCode;
+	}
+
+	size_t CStdioTransport::GetPendingOutputBytes() const
+	{
+		return m_nPendingOutputBytes.load(std::memory_order_relaxed);
+	}
+
+	bool CStdioTransport::IsStreamed(const Outgoing& outgoing)
+	{
+		return OutgoingKind_Piece == outgoing.eKind || OutgoingKind_LastPiece == outgoing.eKind;
+	}
+
+	bool CStdioTransport::NeedsNewline(const Outgoing& outgoing)
+	{
+		switch (outgoing.eKind)
+		{
+		case OutgoingKind_Piece:
+		case OutgoingKind_Frame:
+			return false;
+		case OutgoingKind_LastPiece:
+			return true;
+		default:
+			return outgoing.strData.empty() || outgoing.strData.back() != '\n';
+		}
+	}
+
+	// Every message is terminated by exactly one newline; serialized messages already end with one.
+	// Streamed messages get theirs after the last piece, length prefixed frames none.
+	int CStdioTransport::WriteAll(const std::vector<Outgoing>& vecBatch)
+	{
+		static const char s_szNewline[] = "\n";
+
+#ifdef _WIN32
+		std::string strOut;
+		for (auto& outgoing : vecBatch)
+		{
+			strOut += outgoing.strData;
+			if (NeedsNewline(outgoing))
+				strOut += s_szNewline;
+		}
+		if (fwrite(strOut.data(), 1, strOut.size(), stdout) != strOut.size() || 0 != fflush(stdout))
+			return ERRNO_INTERNAL_OUTPUT_ERROR;
+#else
+		std::vector<struct iovec> vecIov;
+		vecIov.reserve(vecBatch.size() * 2);
+		for (auto& outgoing : vecBatch)
+		{
+			if (!outgoing.strData.empty())
+				vecIov.push_back({ const_cast<char*>(outgoing.strData.data()), outgoing.strData.size() });
+			if (NeedsNewline(outgoing))
+				vecIov.push_back({ const_cast<char*>(s_szNewline), 1 });
+		}
+
+		size_t nIndex = 0;
+		while (nIndex < vecIov.size())
+		{
+			int iCount = static_cast<int>(std::min<size_t>(vecIov.size() - nIndex, IOV_MAX));
+			ssize_t nWritten = writev(STDOUT_FILENO, &vecIov[nIndex], iCount);
+			if (nWritten < 0)
+			{
+				if (EINTR == errno)
+					continue;
+				return ERRNO_INTERNAL_OUTPUT_ERROR;
+			}
+
+			// Skip what was written, a partial write leaves the current iovec half done.
+			size_t nRemaining = static_cast<size_t>(nWritten);
+			while (nIndex < vecIov.size() && nRemaining >= vecIov[nIndex].iov_len)
+			{
+				nRemaining -= vecIov[nIndex].iov_len;
+				nIndex++;
+			}
+			if (nRemaining > 0)
+			{
+				vecIov[nIndex].iov_base = static_cast<char*>(vecIov[nIndex].iov_base) + nRemaining;
+				vecIov[nIndex].iov_len -= nRemaining;
+			}
+		}
+#endif
 
 		return ERRNO_OK;
 	}
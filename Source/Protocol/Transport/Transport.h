@@ -3,11 +3,38 @@
 // Avoid using platform-specific system APIs unless absolutely necessary.
 
 #include <string>
+#include <vector>
 #include <mutex>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+#include <memory>
+#include <functional>
 #include "../Public/PublicDef.h"
+#include "../Public/MpscQueue.h"
 
 namespace MCP
 {
+	// One outgoing message written in pieces, for messages too large to be built in memory first.
+	// Append() the JSON text in order, then Close() once; the stream must not outlive its transport.
+	class CMCPMessageStream
+	{
+	public:
+		virtual ~CMCPMessageStream() {}
+
+		virtual int Append(const char* pData, size_t nLength) = 0;
+		virtual int Close() = 0;
+	};
+
+	// How messages are delimited on the wire. Line frames are JSON text terminated by a newline.
+	// Length prefixed frames carry binary encodings: a 32-bit little-endian byte count followed by
+	// that many bytes; frames are read and written including their prefix.
+	enum FrameFormat
+	{
+		FrameFormat_Line,
+		FrameFormat_LengthPrefixed,
+	};
+
 	class CMCPTransport
 	{
 	public:
@@ -18,20 +45,176 @@ namespace MCP
 		virtual int Read(std::string& strOut) = 0;
 		virtual int Write(const std::string& strIn) = 0;
 		virtual int Error(const std::string& strIn) = 0;
+
+		// Reads the next message without copying it out of the transport. The frame stays valid
+		// until the next ReadFrame()/Read() call. The default implementation goes through Read().
+		virtual int ReadFrame(const char*& pBegin, const char*& pEnd)
+		{
+			int iErrCode = Read(m_strFrame);
+			if (ERRNO_OK != iErrCode)
+				return iErrCode;
+			pBegin = m_strFrame.data();
+			pEnd = pBegin + m_strFrame.size();
+
+			return ERRNO_OK;
+		}
+
+		using FrameHandler = std::function<void(const char* pBegin, const char* pEnd)>;
+		using CloseHandler = std::function<void()>;
+		// Push mode: a transport driven by an event loop calls fnOnFrame for every message on its loop
+		// thread, and fnOnClose once when the peer goes away, instead of being polled with Read().
+		// Must be set before the first message; returns false when the transport only supports Read().
+		virtual bool SetFrameHandler(FrameHandler /*fnOnFrame*/, CloseHandler /*fnOnClose*/)
+		{
+			return false;
+		}
+
+		// The default stream collects the pieces and Write()s the message on Close(); transports that
+		// can pass pieces on as they come override it.
+		virtual std::unique_ptr<CMCPMessageStream> OpenMessageStream();
+
+		virtual bool SupportsFrameFormat(FrameFormat eFormat) const
+		{
+			return FrameFormat_Line == eFormat;
+		}
+		// Applies to the frames read and written from now on; messages written before are still
+		// sent in the previous format.
+		virtual int SetFrameFormat(FrameFormat eFormat)
+		{
+			return SupportsFrameFormat(eFormat) ? ERRNO_OK : ERRNO_INTERNAL_ERROR;
+		}
+
+		// Whether the messages read come from a client that proved its credentials ([auth]).
+		// Network transports authenticate on their own and override it; a local process spawned
+		// over stdio gets its credentials from the environment, as the MCP specification puts it.
+		virtual bool IsAuthenticated() const
+		{
+			return true;
+		}
+		// Who authenticated, e.g. the sub of a JWT; empty when the transport does not authenticate.
+		virtual const std::string& GetPrincipal() const;
+
+		// Bytes accepted by Write() and not handed to the peer yet; sessions hold back what can be
+		// dropped (progress, log messages) while a slow client lets this grow. Thread safe.
+		virtual size_t GetPendingOutputBytes() const
+		{
+			return 0;
+		}
+
+	private:
+		std::string m_strFrame;
 	};
 
+	// Transports serving several clients hand out one CMCPTransport per client session.
+	class CMCPListener
+	{
+	public:
+		// Called for every new client, possibly on the listener's own thread.
+		using AcceptCallback = std::function<void(const std::shared_ptr<CMCPTransport>& spTransport)>;
+
+		virtual ~CMCPListener(){}
+
+		virtual int Listen(AcceptCallback fnOnAccept) = 0;
+		// Stops accepting clients and disconnects the transports handed out so far.
+		virtual int Close() = 0;
+	};
+
+	// Messages are written by a dedicated writer thread: Write() only enqueues, and the writer
+	// coalesces whatever is pending into one writev(2) per batch. A batch is flushed once it
+	// reaches the byte threshold, or once the queue drains and its oldest message has waited
+	// for the latency bound (0 flushes as soon as the queue drains).
 	class CStdioTransport : public CMCPTransport
 	{
 	public:
+		~CStdioTransport();
+
 		int Connect() override;
+		// Flushes every message written so far before returning.
 		int Disconnect() override;
 		int Read(std::string& strOut) override;
 		int Write(const std::string& strIn) override;
 		int Error(const std::string& strIn) override;
+		// Newline delimited or length prefixed frames read straight from the stdin descriptor.
+		int ReadFrame(const char*& pBegin, const char*& pEnd) override;
+
+		// Pieces go to the writer thread as they come, while the messages of other writers are held
+		// back until the streamed message is complete. One stream is open at a time (OpenMessageStream()
+		// waits for the previous one to be closed), and Append() waits while more than
+		// [transport] stream_pending_bytes of it are not written yet.
+		std::unique_ptr<CMCPMessageStream> OpenMessageStream() override;
+
+		// Takes effect on the next Connect().
+		void SetFlushPolicy(unsigned int nLatencyUs, size_t nFlushBytes);
+
+		bool SupportsFrameFormat(FrameFormat eFormat) const override;
+		int SetFrameFormat(FrameFormat eFormat) override;
+		size_t GetPendingOutputBytes() const override;
 
 	private:
+		class CStdioMessageStream;
+
+		enum OutgoingKind
+		{
+			OutgoingKind_Message,
+			OutgoingKind_Piece,			// part of the streamed message
+			OutgoingKind_LastPiece,		// completes the streamed message
+			OutgoingKind_Frame,			// length prefixed, written without a newline
+		};
+
+		struct Outgoing
+		{
+			std::string strData;
+			OutgoingKind eKind{ OutgoingKind_Message };
+		};
+
+		int FillReadBuffer();
+		int ReadLengthPrefixedFrame(const char*& pBegin, const char*& pEnd);
+		void WriterThreadProc();
+		int Enqueue(Outgoing&& outgoing);
+		void CloseMessageStream();
+		// Adds a message to the batch, or defers it while a streamed message is incomplete.
+		static void AddToBatch(Outgoing&& outgoing, std::vector<Outgoing>& vecBatch, std::vector<Outgoing>& vecDeferred, bool& bStreaming);
+		int FlushBatch(std::vector<Outgoing>& vecBatch);
+		static int WriteAll(const std::vector<Outgoing>& vecBatch);
+		static bool IsStreamed(const Outgoing& outgoing);
+		static bool NeedsNewline(const Outgoing& outgoing);
+
 		std::recursive_mutex m_mtxStdin;
 		std::recursive_mutex m_mtxStdout;
 		std::recursive_mutex m_mtxStderr;
+
+		// Input is read in large chunks into one reusable buffer. Frames are handed out in place;
+		// the unread tail is moved to the front when space runs out and the buffer only grows
+		// (doubling) when a single message does not fit, so multi-MB messages grow it a few times at most.
+		static constexpr size_t READ_BUFFER_INITIAL_SIZE = 64 * 1024;
+		std::vector<char> m_vecReadBuffer;
+		size_t m_nReadBegin{ 0 };		// first byte of the next frame
+		size_t m_nReadScan{ 0 };		// bytes before this offset contain no newline
+		size_t m_nReadEnd{ 0 };			// end of the valid data
+		bool m_bReadEof{ false };
+		std::atomic<FrameFormat> m_eFrameFormat{ FrameFormat_Line };
+		// Larger length prefixed frames are rejected rather than buffered, see [transport] max_frame_bytes.
+		size_t m_nMaxFrameBytes{ 64 * 1024 * 1024 };
+
+		unsigned int m_nFlushLatencyUs{ 0 };
+		size_t m_nFlushBytes{ 64 * 1024 };
+		bool m_bPolicyConfigured{ false };
+
+		CMCPMpscQueue<Outgoing> m_queueOutgoing;
+		std::atomic<bool> m_bWriterRunning{ false };
+		std::atomic<bool> m_bWriterSleeping{ false };
+		std::atomic<int> m_iWriterError{ ERRNO_OK };
+		std::mutex m_mtxWriter;
+		std::condition_variable m_cvWriter;
+		std::thread m_thrWriter;
+
+		size_t m_nStreamPendingLimit{ 1024 * 1024 };
+		std::mutex m_mtxStream;
+		std::condition_variable m_cvStream;
+		bool m_bStreamOpen{ false };
+		// Bytes of the streamed message queued but not written yet.
+		std::atomic<size_t> m_nStreamPendingBytes{ 0 };
+		// Bytes of every kind queued but not written yet.
+		std::atomic<size_t> m_nPendingOutputBytes{ 0 };
 	};
 }
@@ -0,0 +1,464 @@
+#include "WebSocket.h"
+#include "../Public/Base64.h"
+#include "../Public/Sha1.h"
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#ifdef TINYMCP_WITH_ZLIB
+#include <zlib.h>
+#endif
+
+namespace MCP
+{
+	// RFC 6455 section 1.3
+	static const char WEBSOCKET_GUID[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+	// A compressed message ends with an empty stored block, which is stripped on the wire (RFC 7692 7.2.1).
+	static const unsigned char DEFLATE_TAIL[4] = { 0x00, 0x00, 0xff, 0xff };
+
+#ifdef TINYMCP_WITH_ZLIB
+	struct CMCPWebSocketCodec::DeflateState
+	{
+		z_stream zsDeflate{};
+		z_stream zsInflate{};
+		bool bDeflateReady{ false };
+		bool bInflateReady{ false };
+
+		~DeflateState()
+		{
+			if (bDeflateReady)
+				deflateEnd(&zsDeflate);
+			if (bInflateReady)
+				inflateEnd(&zsInflate);
+		}
+	};
+#else
+	struct CMCPWebSocketCodec::DeflateState
+	{
+	};
+#endif
+
+	static std::string TrimSpaces(const std::string& str)
+	{
+		auto nBegin = str.find_first_not_of(" \t");
+		if (std::string::npos == nBegin)
+			return std::string();
+		auto nEnd = str.find_last_not_of(" \t");
+
+		return str.substr(nBegin, nEnd - nBegin + 1);
+	}
+
+	static std::vector<std::string> Split(const std::string& str, char chSeparator)
+	{
+		std::vector<std::string> vecParts;
+		size_t nBegin = 0;
+		while (true)
+		{
+			size_t nEnd = str.find(chSeparator, nBegin);
+			vecParts.push_back(TrimSpaces(str.substr(nBegin, std::string::npos == nEnd ? std::string::npos : nEnd - nBegin)));
+			if (std::string::npos == nEnd)
+				break;
+			nBegin = nEnd + 1;
+		}
+
+		return vecParts;
+	}
+
+	static void AppendHeader(unsigned char chFirst, size_t nLength, std::string& strOut)
+	{
+		// Server frames are not masked.
+		strOut.push_back(static_cast<char>(chFirst));
+		if (nLength < 126)
+		{
+			strOut.push_back(static_cast<char>(nLength));
+		}
+		else if (nLength <= 0xffff)
+		{
+			strOut.push_back(static_cast<char>(126));
+			strOut.push_back(static_cast<char>(nLength >> 8));
+			strOut.push_back(static_cast<char>(nLength));
+		}
+		else
+		{
+			strOut.push_back(static_cast<char>(127));
+			for (int i = 7; i >= 0; --i)
+			{
+				strOut.push_back(static_cast<char>(static_cast<unsigned long long>(nLength) >> (8 * i)));
+			}
+		}
+	}
+
+	CMCPWebSocketCodec::CMCPWebSocketCodec(size_t nMaxMessageBytes)
+		: m_nMaxMessageBytes(nMaxMessageBytes)
+	{
+
+	}
+
+	CMCPWebSocketCodec::~CMCPWebSocketCodec()
+	{
+
+	}
+
+	std::string CMCPWebSocketCodec::GetAcceptKey(const std::string& strKey)
+	{
+		std::string strInput = strKey + WEBSOCKET_GUID;
+		unsigned char arrDigest[Sha1::DIGEST_SIZE];
+		Sha1::Hash(strInput.data(), strInput.size(), arrDigest);
+		std::string strAccept;
+		Base64::Append(arrDigest, sizeof(arrDigest), strAccept);
+
+		return strAccept;
+	}
+
+	bool CMCPWebSocketCodec::IsDeflateAvailable()
+	{
+#ifdef TINYMCP_WITH_ZLIB
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	bool CMCPWebSocketCodec::NegotiateDeflate(const std::string& strOffers, size_t nMinBytes, int iLevel, std::string& strResponse)
+	{
+		if (!IsDeflateAvailable())
+			return false;
+
+		for (auto& strOffer : Split(strOffers, ','))
+		{
+			auto vecParams = Split(strOffer, ';');
+			if (vecParams[0] != "permessage-deflate")
+				continue;
+
+			bool bAccepted = true;
+			bool bServerNoContextTakeover = false;
+			int iServerWindowBits = 0;
+			std::string strSeen;
+			for (size_t i = 1; i < vecParams.size() && bAccepted; ++i)
+			{
+				auto nEqual = vecParams[i].find('=');
+				std::string strName = TrimSpaces(vecParams[i].substr(0, nEqual));
+				std::string strValue = std::string::npos == nEqual ? std::string() : TrimSpaces(vecParams[i].substr(nEqual + 1));
+				if (strValue.size() >= 2 && '"' == strValue.front() && '"' == strValue.back())
+					strValue = strValue.substr(1, strValue.size() - 2);
+				// Every parameter at most once (RFC 7692 section 7).
+				if (std::string::npos != strSeen.find(";" + strName + ";"))
+				{
+					bAccepted = false;
+					break;
+				}
+				strSeen += ";" + strName + ";";
+
+				if ("server_no_context_takeover" == strName && strValue.empty())
+				{
+					bServerNoContextTakeover = true;
+				}
+				else if ("client_no_context_takeover" == strName && strValue.empty())
+				{
+					// The client's choice; the inflater keeps its window either way.
+				}
+				else if ("server_max_window_bits" == strName)
+				{
+					iServerWindowBits = atoi(strValue.c_str());
+					// zlib cannot produce raw deflate streams with a 256 byte window.
+					bAccepted = iServerWindowBits >= 9 && iServerWindowBits <= 15;
+				}
+				else if ("client_max_window_bits" == strName)
+				{
+					// Any window of the client fits the inflater's, which uses the largest one.
+					bAccepted = strValue.empty() || (atoi(strValue.c_str()) >= 8 && atoi(strValue.c_str()) <= 15);
+				}
+				else
+				{
+					bAccepted = false;
+				}
+			}
+			if (!bAccepted)
+				continue;
+
+			m_bDeflate = true;
+			m_nDeflateMinBytes = nMinBytes;
+			m_iDeflateLevel = iLevel < 0 || iLevel > 9 ? 6 : iLevel;
+			m_iServerWindowBits = iServerWindowBits > 0 ? iServerWindowBits : 15;
+			m_bServerNoContextTakeover = bServerNoContextTakeover;
+			strResponse = "permessage-deflate";
+			if (bServerNoContextTakeover)
+				strResponse += "; server_no_context_takeover";
+			if (iServerWindowBits > 0)
+				strResponse += "; server_max_window_bits=" + std::to_string(iServerWindowBits);
+			return true;
+		}
+
+		return false;
+	}
+
+	bool CMCPWebSocketCodec::IsDeflateNegotiated() const
+	{
+		return m_bDeflate;
+	}
+
+	CMCPWebSocketCodec::DecodeResult CMCPWebSocketCodec::Decode(const char* pData, size_t nLength, size_t& nConsumed, std::string& strPayload, int& iCloseCode)
+	{
+		nConsumed = 0;
+		while (true)
+		{
+			auto pFrame = reinterpret_cast<const unsigned char*>(pData + nConsumed);
+			size_t nAvailable = nLength - nConsumed;
+			if (nAvailable < 2)
+				return DecodeResult_NeedMore;
+
+			bool bFinal = 0 != (pFrame[0] & 0x80);
+			unsigned int nReserved = pFrame[0] & 0x70;
+			unsigned int nOpcode = pFrame[0] & 0x0f;
+			bool bMasked = 0 != (pFrame[1] & 0x80);
+			unsigned long long ullPayload = pFrame[1] & 0x7f;
+			size_t nHeader = 2;
+			if (126 == ullPayload)
+			{
+				if (nAvailable < 4)
+					return DecodeResult_NeedMore;
+				ullPayload = (static_cast<unsigned long long>(pFrame[2]) << 8) | pFrame[3];
+				nHeader = 4;
+			}
+			else if (127 == ullPayload)
+			{
+				if (nAvailable < 10)
+					return DecodeResult_NeedMore;
+				ullPayload = 0;
+				for (int i = 2; i < 10; ++i)
+				{
+					ullPayload = (ullPayload << 8) | pFrame[i];
+				}
+				nHeader = 10;
+			}
+
+			// Clients must mask their frames (RFC 6455 section 5.1).
+			iCloseCode = CloseCode_ProtocolError;
+			if (!bMasked)
+				return DecodeResult_Error;
+			bool bControl = 0 != (nOpcode & 0x8);
+			if (bControl)
+			{
+				if (!bFinal || 0 != nReserved || ullPayload > 125
+					|| (Opcode_Close != nOpcode && Opcode_Ping != nOpcode && Opcode_Pong != nOpcode))
+					return DecodeResult_Error;
+			}
+			else
+			{
+				if (Opcode_Continuation != nOpcode && Opcode_Text != nOpcode && Opcode_Binary != nOpcode)
+					return DecodeResult_Error;
+				// A continuation needs a message in progress, a new message none.
+				if ((Opcode_Continuation == nOpcode) != m_bInMessage)
+					return DecodeResult_Error;
+				// RSV1 marks a compressed message, on its first frame only.
+				if ((nReserved & 0x30) || ((nReserved & 0x40) && (!m_bDeflate || Opcode_Continuation == nOpcode)))
+					return DecodeResult_Error;
+				if (ullPayload > m_nMaxMessageBytes || m_strFragments.size() + ullPayload > m_nMaxMessageBytes)
+				{
+					iCloseCode = CloseCode_TooLarge;
+					return DecodeResult_Error;
+				}
+			}
+
+			size_t nPayload = static_cast<size_t>(ullPayload);
+			if (nAvailable < nHeader + 4 + nPayload)
+				return DecodeResult_NeedMore;
+			const unsigned char* pMask = pFrame + nHeader;
+			const unsigned char* pMasked = pMask + 4;
+			nConsumed += nHeader + 4 + nPayload;
+
+			std::string& strTarget = bControl ? strPayload : m_strFragments;
+			if (bControl)
+				strPayload.clear();
+			else if (Opcode_Continuation != nOpcode)
+			{
+				m_strFragments.clear();
+				m_bInMessage = true;
+				m_bCompressedMessage = 0 != (nReserved & 0x40);
+			}
+			size_t nOffset = strTarget.size();
+			strTarget.resize(nOffset + nPayload);
+			char* pOut = &strTarget[0] + nOffset;
+			for (size_t i = 0; i < nPayload; ++i)
+			{
+				pOut[i] = static_cast<char>(pMasked[i] ^ pMask[i & 3]);
+			}
+
+			if (Opcode_Pong == nOpcode)
+				continue;
+			if (Opcode_Ping == nOpcode)
+				return DecodeResult_Ping;
+			if (Opcode_Close == nOpcode)
+			{
+				if (1 == nPayload)
+					return DecodeResult_Error;
+				iCloseCode = nPayload >= 2 ? (static_cast<unsigned char>(strPayload[0]) << 8) | static_cast<unsigned char>(strPayload[1]) : CloseCode_Normal;
+				return DecodeResult_Close;
+			}
+			if (!bFinal)
+				continue;
+
+			m_bInMessage = false;
+			if (m_bCompressedMessage)
+			{
+				bool bInflated = Inflate(m_strFragments, strPayload, iCloseCode);
+				m_strFragments.clear();
+				if (!bInflated)
+					return DecodeResult_Error;
+			}
+			else
+			{
+				strPayload = std::move(m_strFragments);
+				m_strFragments.clear();
+			}
+			return DecodeResult_Message;
+		}
+	}
+
+	void CMCPWebSocketCodec::EncodeMessage(const char* pData, size_t nLength, std::string& strOut)
+	{
+		// Once compressed the message is part of the context the client inflates with, so it must go
+		// out compressed whatever the ratio.
+		if (m_bDeflate && nLength >= m_nDeflateMinBytes && Deflate(pData, nLength, m_strCompressed))
+		{
+			strOut.reserve(strOut.size() + m_strCompressed.size() + 10);
+			AppendHeader(0x80 | 0x40 | Opcode_Text, m_strCompressed.size(), strOut);
+			strOut.append(m_strCompressed);
+			return;
+		}
+
+		strOut.reserve(strOut.size() + nLength + 10);
+		AppendHeader(0x80 | Opcode_Text, nLength, strOut);
+		strOut.append(pData, nLength);
+	}
+
+	void CMCPWebSocketCodec::EncodeControl(Opcode eOpcode, const char* pData, size_t nLength, std::string& strOut)
+	{
+		if (nLength > 125)
+			nLength = 125;
+		AppendHeader(static_cast<unsigned char>(0x80 | eOpcode), nLength, strOut);
+		strOut.append(pData, nLength);
+	}
+
+	void CMCPWebSocketCodec::EncodeClose(int iCloseCode, std::string& strOut)
+	{
+		char arrCode[2] = { static_cast<char>(iCloseCode >> 8), static_cast<char>(iCloseCode) };
+		EncodeControl(Opcode_Close, arrCode, sizeof(arrCode), strOut);
+	}
+
+#ifdef TINYMCP_WITH_ZLIB
+	bool CMCPWebSocketCodec::Deflate(const char* pData, size_t nLength, std::string& strCompressed)
+	{
+		if (nLength > UINT_MAX / 2)
+			return false;
+		if (!m_upDeflateState)
+			m_upDeflateState.reset(new DeflateState());
+		z_stream& zs = m_upDeflateState->zsDeflate;
+		if (!m_upDeflateState->bDeflateReady)
+		{
+			if (Z_OK != deflateInit2(&zs, m_iDeflateLevel, Z_DEFLATED, -m_iServerWindowBits, 8, Z_DEFAULT_STRATEGY))
+				return false;
+			m_upDeflateState->bDeflateReady = true;
+		}
+
+		strCompressed.resize(deflateBound(&zs, static_cast<uLong>(nLength)) + 16);
+		zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(pData));
+		zs.avail_in = static_cast<uInt>(nLength);
+		size_t nOut = 0;
+		do
+		{
+			if (nOut == strCompressed.size())
+				strCompressed.resize(strCompressed.size() * 2);
+			zs.next_out = reinterpret_cast<Bytef*>(&strCompressed[nOut]);
+			zs.avail_out = static_cast<uInt>(strCompressed.size() - nOut);
+			int iResult = deflate(&zs, Z_SYNC_FLUSH);
+			if (Z_OK != iResult && Z_BUF_ERROR != iResult)
+			{
+				// The stream is unusable; the client would not be able to follow it either.
+				m_bDeflate = false;
+				return false;
+			}
+			nOut = strCompressed.size() - zs.avail_out;
+		} while (zs.avail_in > 0 || 0 == zs.avail_out);
+
+		if (nOut < sizeof(DEFLATE_TAIL) || 0 != memcmp(&strCompressed[nOut - sizeof(DEFLATE_TAIL)], DEFLATE_TAIL, sizeof(DEFLATE_TAIL)))
+		{
+			m_bDeflate = false;
+			return false;
+		}
+		strCompressed.resize(nOut - sizeof(DEFLATE_TAIL));
+		if (m_bServerNoContextTakeover)
+			deflateReset(&zs);
+
+		return true;
+	}
+
+	bool CMCPWebSocketCodec::Inflate(const std::string& strCompressed, std::string& strPayload, int& iCloseCode)
+	{
+		iCloseCode = CloseCode_InvalidData;
+		if (!m_upDeflateState)
+			m_upDeflateState.reset(new DeflateState());
+		z_stream& zs = m_upDeflateState->zsInflate;
+		if (!m_upDeflateState->bInflateReady)
+		{
+			if (Z_OK != inflateInit2(&zs, -15))
+				return false;
+			m_upDeflateState->bInflateReady = true;
+		}
+
+		strPayload.clear();
+		strPayload.resize((std::min)(m_nMaxMessageBytes, strCompressed.size() * 4 + 256));
+		size_t nOut = 0;
+		// The input, then the tail the client stripped.
+		for (int iPart = 0; iPart < 2; ++iPart)
+		{
+			zs.next_in = iPart ? const_cast<Bytef*>(DEFLATE_TAIL) : reinterpret_cast<Bytef*>(const_cast<char*>(strCompressed.data()));
+			zs.avail_in = static_cast<uInt>(iPart ? sizeof(DEFLATE_TAIL) : strCompressed.size());
+			while (true)
+			{
+				if (nOut == strPayload.size())
+				{
+					// Refuses what inflates beyond the limit instead of buffering it.
+					if (nOut >= m_nMaxMessageBytes)
+					{
+						iCloseCode = CloseCode_TooLarge;
+						return false;
+					}
+					strPayload.resize((std::min)(m_nMaxMessageBytes, nOut * 2));
+				}
+				zs.next_out = reinterpret_cast<Bytef*>(&strPayload[nOut]);
+				zs.avail_out = static_cast<uInt>(strPayload.size() - nOut);
+				int iResult = inflate(&zs, Z_SYNC_FLUSH);
+				nOut = strPayload.size() - zs.avail_out;
+				if (Z_STREAM_END == iResult)
+				{
+					// The client ended the stream with a final block; the next message starts a new one.
+					inflateReset(&zs);
+					strPayload.resize(nOut);
+					return true;
+				}
+				if ((Z_OK != iResult && Z_BUF_ERROR != iResult) || (Z_BUF_ERROR == iResult && zs.avail_in > 0 && zs.avail_out > 0))
+					return false;
+				if (0 == zs.avail_in && zs.avail_out > 0)
+					break;
+			}
+		}
+		strPayload.resize(nOut);
+
+		return true;
+	}
+#else
+	bool CMCPWebSocketCodec::Deflate(const char*, size_t, std::string&)
+	{
+		return false;
+	}
+
+	bool CMCPWebSocketCodec::Inflate(const std::string&, std::string&, int& iCloseCode)
+	{
+		iCloseCode = CloseCode_InvalidData;
+		return false;
+	}
+#endif
+}
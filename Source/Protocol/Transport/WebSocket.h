@@ -0,0 +1,97 @@
+#pragma once
+// To ensure good cross-platform compatibility, the MCP namespace code uses standard C++ only.
+// Avoid using platform-specific system APIs unless absolutely necessary.
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace MCP
+{
+	// Server side framing of a WebSocket connection (RFC 6455), with the permessage-deflate extension
+	// (RFC 7692) in builds with TINYMCP_WITH_ZLIB. Every message is one JSON-RPC message; they are sent
+	// as text frames and accepted as text or binary frames, fragmented or not.
+	//
+	// Compression is decided per message: messages shorter than the threshold given to NegotiateDeflate()
+	// go out uncompressed, which leaves the compression context untouched, so small responses and
+	// notifications cost no CPU while large tools/list or resources/read results shrink several times.
+	// The zlib streams are created on first use. One codec per connection, not thread safe.
+	class CMCPWebSocketCodec
+	{
+	public:
+		enum Opcode
+		{
+			Opcode_Continuation = 0x0,
+			Opcode_Text = 0x1,
+			Opcode_Binary = 0x2,
+			Opcode_Close = 0x8,
+			Opcode_Ping = 0x9,
+			Opcode_Pong = 0xA,
+		};
+
+		enum CloseCode
+		{
+			CloseCode_Normal = 1000,
+			CloseCode_GoingAway = 1001,
+			CloseCode_ProtocolError = 1002,
+			CloseCode_InvalidData = 1007,
+			CloseCode_TooLarge = 1009,
+		};
+
+		enum DecodeResult
+		{
+			DecodeResult_NeedMore,		// no complete message in the input
+			DecodeResult_Message,		// strPayload holds a message (decompressed)
+			DecodeResult_Ping,			// to be answered with a pong carrying strPayload
+			DecodeResult_Close,			// the client closes with iCloseCode
+			DecodeResult_Error,			// the connection must be closed with iCloseCode
+		};
+
+		// Messages beyond nMaxMessageBytes, compressed or not, are refused with CloseCode_TooLarge.
+		explicit CMCPWebSocketCodec(size_t nMaxMessageBytes);
+		~CMCPWebSocketCodec();
+		CMCPWebSocketCodec(const CMCPWebSocketCodec&) = delete;
+		CMCPWebSocketCodec& operator=(const CMCPWebSocketCodec&) = delete;
+
+		// Sec-WebSocket-Accept of the response to an upgrade request carrying Sec-WebSocket-Key strKey.
+		static std::string GetAcceptKey(const std::string& strKey);
+		// Whether the build can compress (TINYMCP_WITH_ZLIB).
+		static bool IsDeflateAvailable();
+
+		// Takes the first permessage-deflate offer of a Sec-WebSocket-Extensions header that can be
+		// honoured and sets strResponse to the value of the response header; false when none was taken.
+		// Messages of nMinBytes or more are then compressed at zlib level iLevel.
+		bool NegotiateDeflate(const std::string& strOffers, size_t nMinBytes, int iLevel, std::string& strResponse);
+		bool IsDeflateNegotiated() const;
+
+		// Decodes frames from the input until a message or a control frame is complete. nConsumed
+		// bytes of the input were used, fragments also when the result is DecodeResult_NeedMore.
+		DecodeResult Decode(const char* pData, size_t nLength, size_t& nConsumed, std::string& strPayload, int& iCloseCode);
+
+		// Appends the frame carrying a message to strOut.
+		void EncodeMessage(const char* pData, size_t nLength, std::string& strOut);
+		// Ping, pong or close frames; pData holds at most 125 bytes.
+		static void EncodeControl(Opcode eOpcode, const char* pData, size_t nLength, std::string& strOut);
+		static void EncodeClose(int iCloseCode, std::string& strOut);
+
+	private:
+		struct DeflateState;
+
+		bool Deflate(const char* pData, size_t nLength, std::string& strCompressed);
+		bool Inflate(const std::string& strCompressed, std::string& strPayload, int& iCloseCode);
+
+		size_t m_nMaxMessageBytes{ 0 };
+		// Data frames of the message being received.
+		std::string m_strFragments;
+		bool m_bInMessage{ false };
+		bool m_bCompressedMessage{ false };
+
+		bool m_bDeflate{ false };
+		size_t m_nDeflateMinBytes{ 0 };
+		int m_iDeflateLevel{ 6 };
+		int m_iServerWindowBits{ 15 };
+		bool m_bServerNoContextTakeover{ false };
+		std::unique_ptr<DeflateState> m_upDeflateState;
+		std::string m_strCompressed;
+	};
+}
@@ -0,0 +1,180 @@
+// JSON string escaping throughput: the former character by character jsoncpp loop
+// against the vectorized jsoncpp writer and the streaming CMCPJsonWriter.
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <json/writer.h>
+#include "Source/Protocol/Message/JsonWriter.h"
+
+namespace {
+
+// valueToQuotedStringN() of jsoncpp 1.9.5 before the vectorized scan, as the baseline.
+unsigned int ReferenceCodepoint(const char*& s, const char* e) {
+    const unsigned int REPLACEMENT_CHARACTER = 0xFFFD;
+    unsigned int firstByte = static_cast<unsigned char>(*s);
+    if (firstByte < 0x80)
+        return firstByte;
+    if (firstByte < 0xE0) {
+        if (e - s < 2)
+            return REPLACEMENT_CHARACTER;
+        unsigned int calculated = ((firstByte & 0x1F) << 6) | (static_cast<unsigned int>(s[1]) & 0x3F);
+        s += 1;
+        return calculated < 0x80 ? REPLACEMENT_CHARACTER : calculated;
+    }
+    if (firstByte < 0xF0) {
+        if (e - s < 3)
+            return REPLACEMENT_CHARACTER;
+        unsigned int calculated = ((firstByte & 0x0F) << 12) | ((static_cast<unsigned int>(s[1]) & 0x3F) << 6) |
+                                  (static_cast<unsigned int>(s[2]) & 0x3F);
+        s += 2;
+        if (calculated >= 0xD800 && calculated <= 0xDFFF)
+            return REPLACEMENT_CHARACTER;
+        return calculated < 0x800 ? REPLACEMENT_CHARACTER : calculated;
+    }
+    if (firstByte < 0xF8) {
+        if (e - s < 4)
+            return REPLACEMENT_CHARACTER;
+        unsigned int calculated = ((firstByte & 0x07) << 18) | ((static_cast<unsigned int>(s[1]) & 0x3F) << 12) |
+                                  ((static_cast<unsigned int>(s[2]) & 0x3F) << 6) | (static_cast<unsigned int>(s[3]) & 0x3F);
+        s += 3;
+        return calculated < 0x10000 ? REPLACEMENT_CHARACTER : calculated;
+    }
+    return REPLACEMENT_CHARACTER;
+}
+
+void ReferenceHex(std::string& result, unsigned int ch) {
+    static const char digits[] = "0123456789abcdef";
+    char escape[6] = { '\\', 'u', digits[(ch >> 12) & 0xF], digits[(ch >> 8) & 0xF], digits[(ch >> 4) & 0xF], digits[ch & 0xF] };
+    result.append(escape, sizeof(escape));
+}
+
+std::string ReferenceQuote(const char* value, size_t length) {
+    bool plain = true;
+    for (size_t i = 0; i < length && plain; ++i) {
+        unsigned char c = static_cast<unsigned char>(value[i]);
+        plain = !(c == '\\' || c == '"' || c < 0x20 || c > 0x7F);
+    }
+    if (plain)
+        return std::string("\"") + value + "\"";
+
+    std::string result;
+    result.reserve(length * 2 + 3);
+    result += "\"";
+    const char* end = value + length;
+    for (const char* c = value; c != end; ++c) {
+        switch (*c) {
+        case '\"': result += "\\\""; break;
+        case '\\': result += "\\\\"; break;
+        case '\b': result += "\\b"; break;
+        case '\f': result += "\\f"; break;
+        case '\n': result += "\\n"; break;
+        case '\r': result += "\\r"; break;
+        case '\t': result += "\\t"; break;
+        default: {
+            unsigned int codepoint = ReferenceCodepoint(c, end);
+            if (codepoint < 0x20) {
+                ReferenceHex(result, codepoint);
+            } else if (codepoint < 0x80) {
+                result += static_cast<char>(codepoint);
+            } else if (codepoint < 0x10000) {
+                ReferenceHex(result, codepoint);
+            } else {
+                codepoint -= 0x10000;
+                ReferenceHex(result, 0xd800 + ((codepoint >> 10) & 0x3ff));
+                ReferenceHex(result, 0xdc00 + (codepoint & 0x3ff));
+            }
+        } break;
+        }
+    }
+    result += "\"";
+    return result;
+}
+
+struct Corpus {
+    const char* name;
+    std::vector<std::string> items;
+};
+
+std::string Repeat(const std::string& unit, size_t bytes) {
+    std::string text;
+    while (text.size() < bytes)
+        text += unit;
+    return text;
+}
+
+std::vector<Corpus> BuildCorpora() {
+    const size_t blob = 256 * 1024;
+    std::vector<Corpus> corpora;
+    corpora.push_back({ "prose 256K", { Repeat("The quick brown fox jumps over the lazy dog, again and again. ", blob) } });
+    corpora.push_back({ "log lines 256K", { Repeat("2025-06-18T10:00:00Z INFO worker-7 request served in 12ms\n", blob) } });
+    corpora.push_back({ "source code 256K", { Repeat("    if (path == \"C:\\\\tmp\") {\n\treturn \"\";\n    }\n", blob) } });
+    corpora.push_back({ "utf-8 text 256K", { Repeat("Gr\xc3\xbc\xc3\x9f" "e aus \xe4\xb8\x8a\xe6\xb5\xb7, plain ascii tail follows here. ", blob) } });
+    Corpus shortStrings{ "short strings 16B", {} };
+    for (int i = 0; i < 16 * 1024; ++i)
+        shortStrings.items.push_back("tool_name_" + std::to_string(100000 + i));
+    corpora.push_back(shortStrings);
+    return corpora;
+}
+
+template <class Fn>
+double MegabytesPerSecond(const Corpus& corpus, Fn fn) {
+    size_t bytes = 0;
+    for (auto& item : corpus.items)
+        bytes += item.size();
+
+    size_t sink = 0;
+    int rounds = 0;
+    auto start = std::chrono::steady_clock::now();
+    std::chrono::duration<double> elapsed{ 0 };
+    do {
+        for (auto& item : corpus.items)
+            sink += fn(item);
+        ++rounds;
+        elapsed = std::chrono::steady_clock::now() - start;
+    } while (elapsed.count() < 0.3);
+
+    if (sink == 0)
+        std::printf("(empty output)\n");
+    return bytes * static_cast<double>(rounds) / elapsed.count() / (1024.0 * 1024.0);
+}
+
+} // namespace
+
+int main() {
+    std::vector<Corpus> corpora = BuildCorpora();
+
+    for (auto& corpus : corpora) {
+        for (auto& item : corpus.items) {
+            std::string reference = ReferenceQuote(item.data(), item.size());
+            std::string written;
+            MCP::CMCPJsonWriter writer(written);
+            writer.String(item);
+            if (reference != Json::valueToQuotedString(item.c_str()) || reference != written) {
+                std::printf("output mismatch in corpus '%s'\n", corpus.name);
+                return 1;
+            }
+        }
+    }
+
+    std::printf("%-20s %14s %14s %14s\n", "corpus (MB/s)", "scalar loop", "jsoncpp", "CMCPJsonWriter");
+    for (auto& corpus : corpora) {
+        double reference = MegabytesPerSecond(corpus, [](const std::string& item) {
+            return ReferenceQuote(item.data(), item.size()).size();
+        });
+        double jsoncpp = MegabytesPerSecond(corpus, [](const std::string& item) {
+            return Json::valueToQuotedString(item.c_str()).size();
+        });
+        std::string buffer;
+        double streaming = MegabytesPerSecond(corpus, [&buffer](const std::string& item) {
+            buffer.clear();
+            MCP::CMCPJsonWriter writer(buffer);
+            writer.String(item);
+            return buffer.size();
+        });
+        std::printf("%-20s %14.0f %14.0f %14.0f\n", corpus.name, reference, jsoncpp, streaming);
+    }
+
+    return 0;
+}
@@ -0,0 +1,119 @@
+// Shared by the benchmarks running sessions: a server offering the echo tool, registered through
+// CMCPServer like any server, and a transport pushing frames into a session like an event loop
+// transport does. Included by one translation unit per benchmark executable.
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Source/Protocol/Entity/Server.h"
+#include "Source/Protocol/Message/JsonParser.h"
+#include "Source/Protocol/Message/Request.h"
+#include "Source/Protocol/Task/BasicTask.h"
+
+namespace bench {
+
+class CEchoTask : public MCP::ProcessCallToolRequest {
+public:
+    CEchoTask() : ProcessCallToolRequest(nullptr) {}
+
+    std::shared_ptr<CMCPTask> Clone() const override { return std::make_shared<CEchoTask>(); }
+    int Cancel() override { return MCP::ERRNO_OK; }
+    int Execute() override {
+        auto spResult = BuildResult();
+        if (!spResult)
+            return MCP::ERRNO_INTERNAL_ERROR;
+        const auto& request = static_cast<const MCP::CallToolRequest&>(*m_spRequest);
+        spResult->AddText(request.jArguments["input"].asString());
+        return NotifyResult(std::move(spResult));
+    }
+};
+
+class CBenchServer : public MCP::CMCPServer<CBenchServer> {
+public:
+    int Initialize() override {
+        MCP::Implementation serverInfo;
+        serverInfo.strName = "tinymcp_bench";
+        serverInfo.strVersion = "1.0.0";
+        SetServerInfo(serverInfo);
+        RegisterServerToolsCapabilities(MCP::Tools());
+
+        MCP::Tool tool;
+        tool.strName = "echo";
+        tool.strDescription = "Receive the data sent by the client and return it unchanged.";
+        MCP::CMCPJsonParser parser;
+        if (!parser.Parse(R"({"type":"object","properties":{"input":{"type":"string"}},"required":["input"]})", tool.jInputSchema))
+            return MCP::ERRNO_PARSE_ERROR;
+        RegisterToolsTasks(tool.strName, std::make_shared<CEchoTask>());
+        RegisterServerTools({ tool }, false);
+        return MCP::ERRNO_OK;
+    }
+
+private:
+    friend class MCP::CMCPServer<CBenchServer>;
+    CBenchServer() = default;
+    static CBenchServer s_Instance;
+};
+
+CBenchServer CBenchServer::s_Instance;
+
+// The definition of the bench server, initialized on first use; nullptr if that failed.
+inline std::shared_ptr<const MCP::ServerDefinition> BuildDefinition() {
+    static const int initialized = CBenchServer::GetInstance().Initialize();
+    return MCP::ERRNO_OK == initialized ? CBenchServer::GetInstance().GetDefinition() : nullptr;
+}
+
+// The client of a session started on it: pushes frames like an event loop transport and counts
+// the messages written back.
+class CScriptTransport : public MCP::CMCPTransport {
+public:
+    int Connect() override { return MCP::ERRNO_OK; }
+    int Disconnect() override { return MCP::ERRNO_OK; }
+    int Read(std::string&) override { return MCP::ERRNO_INTERNAL_INPUT_TERMINATE; }
+    int Write(const std::string&) override {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        ++m_nWritten;
+        m_cv.notify_all();
+        return MCP::ERRNO_OK;
+    }
+    int Error(const std::string&) override { return MCP::ERRNO_OK; }
+    bool SetFrameHandler(FrameHandler fnOnFrame, CloseHandler fnOnClose) override {
+        m_fnOnFrame = std::move(fnOnFrame);
+        m_fnOnClose = std::move(fnOnClose);
+        return true;
+    }
+
+    void Push(const std::string& frame) { m_fnOnFrame(frame.data(), frame.data() + frame.size()); }
+    // Delivers the frame and waits until the response to it has been written; returns the messages
+    // written in all.
+    size_t RoundTrip(const std::string& frame) {
+        std::unique_lock<std::mutex> lock(m_mtx);
+        size_t written = m_nWritten;
+        lock.unlock();
+        Push(frame);
+        lock.lock();
+        m_cv.wait(lock, [&]() { return m_nWritten > written; });
+        return m_nWritten;
+    }
+    // Waits until count messages have been written in all.
+    bool WaitWritten(size_t count) {
+        std::unique_lock<std::mutex> lock(m_mtx);
+        return m_cv.wait_for(lock, std::chrono::seconds(10), [&]() { return m_nWritten >= count; });
+    }
+    void Close() {
+        if (m_fnOnClose)
+            m_fnOnClose();
+    }
+
+private:
+    FrameHandler m_fnOnFrame;
+    CloseHandler m_fnOnClose;
+    std::mutex m_mtx;
+    std::condition_variable m_cv;
+    size_t m_nWritten{ 0 };
+};
+
+} // namespace bench
@@ -0,0 +1,321 @@
+// Hot paths of a session, measured on the messages of corpus/messages.jsonl: parsing a frame into
+// its typed message, serializing the results sent most, request id bookkeeping, and the round trip
+// of a frame through the dispatcher (and, for tools/call, the task scheduler) to its response.
+// Besides the time per operation, every row shows the heap allocations per operation (all threads).
+//
+// Usage: tinymcp_bench [corpus.jsonl]
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <new>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Source/Protocol/Message/JsonParser.h"
+#include "Source/Protocol/Message/Request.h"
+#include "Source/Protocol/Message/Response.h"
+#include "Source/Protocol/Session/MessageArena.h"
+#include "Source/Protocol/Session/Session.h"
+#include "Source/Protocol/Session/SessionManager.h"
+#include "Source/Protocol/Task/BasicTask.h"
+#include "Source/Protocol/Transport/Transport.h"
+#include "bench_fixture.h"
+
+#ifndef TINYMCP_BENCH_CORPUS
+#define TINYMCP_BENCH_CORPUS "benchmarks/corpus/messages.jsonl"
+#endif
+
+static std::atomic<unsigned long long> g_allocations{ 0 };
+
+void* operator new(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+namespace {
+
+// jsoncpp takes its memory with malloc(); trees built while this is installed count their blocks too.
+class CountingValueMemory : public Json::MemoryResource {
+public:
+    void Reset() { m_arena.Reset(); }
+
+private:
+    void* allocate(size_t bytes) override {
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+        return m_arena.Allocate(bytes);
+    }
+
+    MCP::CMCPMessageArena m_arena{ 256 * 1024 };
+};
+
+// The Json::Value tree of DoSerialize(), still built for messages without a DoWrite() of their own.
+size_t BuildTree(const MCP::Message& message, CountingValueMemory& memory) {
+    size_t members = 0;
+    {
+        Json::MemoryResourceScope scope(&memory);
+        Json::Value tree(Json::objectValue);
+        message.DoSerialize(tree);
+        members = tree.size();
+    }
+    memory.Reset();
+    return members;
+}
+
+struct Sample {
+    std::string label;
+    std::string text;
+};
+
+std::vector<Sample> LoadCorpus(const char* path) {
+    std::vector<Sample> samples;
+    std::ifstream input(path);
+    std::string line;
+    MCP::CMCPJsonParser parser;
+    while (std::getline(input, line)) {
+        if (line.empty())
+            continue;
+        Json::Value message;
+        if (!parser.Parse(line, message) || !message.isObject())
+            continue;
+        std::string label = message[MCP::MSG_KEY_METHOD].asString();
+        label += " (" + std::to_string(line.size()) + "B)";
+        samples.push_back({ label, line });
+    }
+    return samples;
+}
+
+struct Measurement {
+    double nanoseconds;
+    double allocations;
+};
+
+template <class Fn>
+Measurement PerOp(Fn fn) {
+    size_t sink = 0;
+    size_t ops = 0;
+    auto allocations = g_allocations.load();
+    auto start = std::chrono::steady_clock::now();
+    std::chrono::duration<double> elapsed{ 0 };
+    do {
+        for (int i = 0; i < 64; ++i)
+            sink += fn();
+        ops += 64;
+        elapsed = std::chrono::steady_clock::now() - start;
+    } while (elapsed.count() < 0.3);
+
+    if (sink == 0)
+        std::printf("(empty output)\n");
+    return { elapsed.count() * 1e9 / ops, static_cast<double>(g_allocations.load() - allocations) / ops };
+}
+
+void PrintRow(const std::string& name, const Measurement& measurement, size_t bytes) {
+    if (bytes > 0)
+        std::printf("%-44s %12.0f %12.1f %12.1f\n", name.c_str(), measurement.nanoseconds,
+                    bytes / measurement.nanoseconds * 1e9 / (1024.0 * 1024.0), measurement.allocations);
+    else
+        std::printf("%-44s %12.0f %12s %12.1f\n", name.c_str(), measurement.nanoseconds, "-", measurement.allocations);
+}
+
+// The steps of CMCPSession::ParseMessage(): one parse into the arena of the thread, the method
+// looked up in the registry, and the typed message deserialized from the tree.
+int ParseOne(const MCP::CMCPMethodRegistry& registry, MCP::CMCPJsonParser& parser, MCP::CMCPMessageArena& arena,
+             const std::string& text) {
+    int result = MCP::ERRNO_PARSE_ERROR;
+    {
+        Json::MemoryResourceScope arenaScope(&arena);
+        Json::Value message;
+        if (!parser.Parse(text.data(), text.data() + text.size(), message) || !message.isObject())
+            return result;
+        MCP::MessageCategory category = message.isMember(MCP::MSG_KEY_ID) ? MCP::MessageCategory_Request
+                                                                          : MCP::MessageCategory_Notification;
+        const char* begin = nullptr;
+        const char* end = nullptr;
+        message[MCP::MSG_KEY_METHOD].getString(&begin, &end);
+        auto entry = registry.Find(category, begin, end);
+        if (entry) {
+            auto typed = entry->fnCreate();
+            result = typed->Deserialize(message);
+        }
+    }
+    arena.Reset();
+    return result;
+}
+
+void BenchParse(const std::vector<Sample>& samples) {
+    MCP::CMCPMethodRegistry registry;
+    MCP::CMCPSession::RegisterBuiltinMethods(registry);
+    MCP::CMCPJsonParser parser;
+    MCP::CMCPMessageArena arena(64 * 1024);
+
+    for (auto& sample : samples) {
+        if (MCP::ERRNO_OK != ParseOne(registry, parser, arena, sample.text)) {
+            std::printf("parse failed: %s\n", sample.label.c_str());
+            continue;
+        }
+        auto measurement = PerOp([&]() {
+            return static_cast<size_t>(ParseOne(registry, parser, arena, sample.text) + 1);
+        });
+        PrintRow("parse " + sample.label, measurement, sample.text.size());
+    }
+}
+
+void BenchSerialize() {
+    std::string buffer;
+    CountingValueMemory memory;
+    for (size_t contents : { 1, 16, 256 }) {
+        MCP::CallToolResult result(false);
+        result.requestId.eIdDataType = MCP::DataType_Integer;
+        result.requestId.iId = 42;
+        for (size_t i = 0; i < contents; ++i) {
+            result.AddText("line " + std::to_string(i) + ": the quick brown fox jumps over the lazy dog\n");
+        }
+        result.Serialize(buffer);
+        auto measurement = PerOp([&]() {
+            result.Serialize(buffer);
+            return buffer.size();
+        });
+        PrintRow("serialize CallToolResult x" + std::to_string(contents), measurement, buffer.size());
+        measurement = PerOp([&]() { return BuildTree(result, memory); });
+        PrintRow("tree CallToolResult x" + std::to_string(contents), measurement, 0);
+    }
+
+    Json::Value schema;
+    MCP::CMCPJsonParser parser;
+    parser.Parse(R"({"type":"object","properties":{"input":{"type":"string","description":"client input data"},)"
+                 R"("count":{"type":"integer","minimum":1}},"required":["input"]})", schema);
+    for (size_t tools : { 1, 64, 1024 }) {
+        MCP::ListToolsResult result(false);
+        result.requestId.eIdDataType = MCP::DataType_Integer;
+        result.requestId.iId = 42;
+        for (size_t i = 0; i < tools; ++i) {
+            MCP::Tool tool;
+            tool.strName = "tool_" + std::to_string(i);
+            tool.strDescription = "Receive the data sent by the client and return it unchanged.";
+            tool.jInputSchema = schema;
+            result.vecTools.push_back(tool);
+        }
+        result.Serialize(buffer);
+        auto measurement = PerOp([&]() {
+            result.Serialize(buffer);
+            return buffer.size();
+        });
+        PrintRow("serialize ListToolsResult x" + std::to_string(tools), measurement, buffer.size());
+        if (tools <= 64) {
+            measurement = PerOp([&]() { return BuildTree(result, memory); });
+            PrintRow("tree ListToolsResult x" + std::to_string(tools), measurement, 0);
+        }
+    }
+}
+
+void BenchRequestId() {
+    std::vector<MCP::RequestId> integerIds(1024);
+    std::vector<MCP::RequestId> stringIds(1024);
+    for (int i = 0; i < 1024; ++i) {
+        integerIds[i].eIdDataType = MCP::DataType_Integer;
+        integerIds[i].iId = i;
+        stringIds[i].eIdDataType = MCP::DataType_String;
+        stringIds[i].strId = "req-" + std::to_string(0x5f1c2a + i);
+    }
+
+    for (auto* ids : { &integerIds, &stringIds }) {
+        const char* kind = ids == &integerIds ? "integer" : "string";
+        std::unordered_map<MCP::RequestId, int, MCP::RequestIdHash> inFlight;
+        size_t next = 0;
+        auto measurement = PerOp([&]() {
+            auto& id = (*ids)[next++ & 1023];
+            inFlight[id] = 1;
+            size_t found = inFlight.count(id);
+            inFlight.erase(id);
+            return found;
+        });
+        PrintRow(std::string("request id track/untrack ") + kind, measurement, 0);
+
+        Json::Value message(Json::objectValue);
+        measurement = PerOp([&]() {
+            auto& id = (*ids)[next++ & 1023];
+            message.clear();
+            id.DoSerialize(message);
+            MCP::RequestId parsed;
+            parsed.DoDeserialize(message);
+            return parsed.Hash() | 1;
+        });
+        PrintRow(std::string("request id round trip ") + kind, measurement, 0);
+    }
+}
+
+// Frames of the method with ids counting up from 1000, so that no call reuses the id of one in flight.
+std::vector<std::string> WithFreshIds(const std::string& text, size_t count) {
+    MCP::CMCPJsonParser parser;
+    Json::Value message;
+    parser.Parse(text, message);
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = "";
+    std::vector<std::string> frames;
+    for (size_t i = 0; i < count; ++i) {
+        message[MCP::MSG_KEY_ID] = static_cast<Json::UInt>(1000 + i);
+        frames.push_back(Json::writeString(builder, message));
+    }
+    return frames;
+}
+
+void BenchRoundTrip(const std::vector<Sample>& samples) {
+    auto spDefinition = bench::BuildDefinition();
+    MCP::CMCPSessionManager manager;
+    auto spTransport = std::make_shared<bench::CScriptTransport>();
+    if (!spDefinition || MCP::ERRNO_OK != manager.Start(spDefinition) || MCP::ERRNO_OK != manager.StartSession(spTransport)) {
+        std::printf("session failed to start\n");
+        return;
+    }
+
+    for (auto& sample : samples) {
+        if (0 == sample.label.compare(0, 10, "initialize")) {
+            spTransport->RoundTrip(sample.text);
+            break;
+        }
+    }
+    for (auto& sample : samples) {
+        if (0 == sample.label.compare(0, 25, "notifications/initialized"))
+            spTransport->Push(sample.text);
+    }
+
+    for (auto& sample : samples) {
+        bool sync = 0 == sample.label.compare(0, 5, "ping ") || 0 == sample.label.compare(0, 11, "tools/list ");
+        bool async = 0 == sample.label.compare(0, 11, "tools/call ");
+        if (!sync && !async)
+            continue;
+        std::vector<std::string> frames = WithFreshIds(sample.text, 1 << 16);
+        size_t next = 0;
+        auto measurement = PerOp([&]() {
+            return spTransport->RoundTrip(frames[next++ & 0xFFFF]);
+        });
+        PrintRow(std::string(async ? "commit->result " : "dispatch ") + sample.label, measurement, 0);
+    }
+
+    manager.Stop();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const char* path = argc > 1 ? argv[1] : TINYMCP_BENCH_CORPUS;
+    std::vector<Sample> samples = LoadCorpus(path);
+    if (samples.empty()) {
+        std::printf("no messages in corpus '%s'\n", path);
+        return 1;
+    }
+
+    std::printf("%-44s %12s %12s %12s\n", "benchmark", "ns/op", "MB/s", "allocs/op");
+    BenchParse(samples);
+    BenchSerialize();
+    BenchRequestId();
+    BenchRoundTrip(samples);
+
+    return 0;
+}
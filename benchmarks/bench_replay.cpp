@@ -0,0 +1,176 @@
+// Replays recorded traffic (see [recording] in config.ini and Transport/RecordingTransport.h) against
+// a server offering the echo tool, and compares the responses and their latency with the recording
+// and, optionally, with the report of an earlier run kept as the baseline.
+//
+// Without a recording, one is made first from the messages of corpus/messages.jsonl: a session
+// sending a few thousand pings, tools/list and echo calls, written to tinymcp_replay.rec.
+//
+// Usage: tinymcp_bench_replay [recording] [--speed x] [--baseline report.json] [--save-baseline report.json]
+//                             [--tolerance 0.2]
+// --speed 0 sends every frame as soon as possible; exits with 1 when the run regressed from the baseline.
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Source/Protocol/Message/JsonParser.h"
+#include "Source/Protocol/Session/SessionManager.h"
+#include "Source/Protocol/Session/TrafficReplay.h"
+#include "Source/Protocol/Transport/RecordingTransport.h"
+#include "bench_fixture.h"
+
+#ifndef TINYMCP_BENCH_CORPUS
+#define TINYMCP_BENCH_CORPUS "benchmarks/corpus/messages.jsonl"
+#endif
+
+namespace {
+
+using bench::BuildDefinition;
+using bench::CScriptTransport;
+
+std::string WithId(const std::string& text, unsigned int id) {
+    MCP::CMCPJsonParser parser;
+    Json::Value message;
+    parser.Parse(text, message);
+    message[MCP::MSG_KEY_ID] = id;
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = "";
+    return Json::writeString(builder, message);
+}
+
+// Records a session running the initialize handshake of the corpus, then its pings, tools/list and
+// tools/call requests over and over, a few in flight at a time.
+int Synthesize(const char* corpusPath, const std::string& recordingPath) {
+    std::vector<std::string> handshake;
+    std::vector<std::string> requests;
+    std::ifstream input(corpusPath);
+    std::string line;
+    MCP::CMCPJsonParser parser;
+    while (std::getline(input, line)) {
+        Json::Value message;
+        if (line.empty() || !parser.Parse(line, message) || !message.isObject())
+            continue;
+        std::string method = message[MCP::MSG_KEY_METHOD].asString();
+        if (method == MCP::METHOD_INITIALIZE || method == MCP::METHOD_NOTIFICATION_INITIALIZED)
+            handshake.push_back(line);
+        else if (method == MCP::METHOD_PING || method == MCP::METHOD_TOOLS_LIST
+                 || (method == MCP::METHOD_TOOLS_CALL && message[MCP::MSG_KEY_PARAMS][MCP::MSG_KEY_NAME].asString() == "echo"))
+            requests.push_back(line);
+    }
+    if (handshake.size() < 2 || requests.empty()) {
+        std::printf("corpus '%s' lacks the handshake or requests\n", corpusPath);
+        return MCP::ERRNO_INVALID_PARAMS;
+    }
+
+    std::remove(recordingPath.c_str());
+    auto spRecorder = std::make_shared<MCP::CMCPTrafficRecorder>();
+    if (MCP::ERRNO_OK != spRecorder->Open(recordingPath)) {
+        std::printf("cannot write '%s'\n", recordingPath.c_str());
+        return MCP::ERRNO_INTERNAL_ERROR;
+    }
+    auto spDefinition = BuildDefinition();
+    MCP::CMCPSessionManager manager;
+    auto spScript = std::make_shared<CScriptTransport>();
+    auto spTransport = std::make_shared<MCP::CRecordingTransport>(spScript, spRecorder);
+    if (!spDefinition || MCP::ERRNO_OK != manager.Start(spDefinition) || MCP::ERRNO_OK != manager.StartSession(spTransport)) {
+        std::printf("session failed to start\n");
+        return MCP::ERRNO_INTERNAL_ERROR;
+    }
+
+    spScript->Push(handshake[0]);
+    spScript->WaitWritten(1);
+    spScript->Push(handshake[1]);
+    const unsigned int total = 4096;
+    const unsigned int window = 4;
+    for (unsigned int i = 0; i < total; ++i) {
+        if (i >= window)
+            spScript->WaitWritten(1 + i - window);
+        spScript->Push(WithId(requests[i % requests.size()], 1000 + i));
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+    spScript->WaitWritten(1 + total);
+    spScript->Close();
+    manager.Stop();
+    return spRecorder->Close();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string recordingPath;
+    std::string baselinePath;
+    std::string saveBaselinePath;
+    double tolerance = 0.2;
+    MCP::TrafficReplayOptions options;
+    for (int i = 1; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (0 == std::strcmp(argv[i], "--speed") && hasValue)
+            options.dSpeed = std::atof(argv[++i]);
+        else if (0 == std::strcmp(argv[i], "--baseline") && hasValue)
+            baselinePath = argv[++i];
+        else if (0 == std::strcmp(argv[i], "--save-baseline") && hasValue)
+            saveBaselinePath = argv[++i];
+        else if (0 == std::strcmp(argv[i], "--tolerance") && hasValue)
+            tolerance = std::atof(argv[++i]);
+        else
+            recordingPath = argv[i];
+    }
+
+    if (recordingPath.empty()) {
+        recordingPath = "tinymcp_replay.rec";
+        if (MCP::ERRNO_OK != Synthesize(TINYMCP_BENCH_CORPUS, recordingPath))
+            return 1;
+    }
+    std::vector<MCP::TrafficRecord> records;
+    if (MCP::ERRNO_OK != MCP::ReadTrafficRecording(recordingPath, records)) {
+        std::printf("cannot read recording '%s'\n", recordingPath.c_str());
+        return 1;
+    }
+
+    auto spDefinition = BuildDefinition();
+    MCP::TrafficReplayReport report;
+    if (!spDefinition || MCP::ERRNO_OK != MCP::CMCPTrafficReplay::Run(records, spDefinition, options, report)) {
+        std::printf("replay failed\n");
+        return 1;
+    }
+
+    std::printf("replay of %s at speed %g: %zu records, %zu sessions, %.1f ms\n", recordingPath.c_str(), options.dSpeed,
+                records.size(), report.nSessions, report.dElapsedMs);
+    std::printf("requests %zu, responses %zu, mismatched %zu, missing %zu\n", report.nRequests, report.nResponses,
+                report.nMismatches, report.nMissing);
+    for (auto& mismatch : report.vecMismatches)
+        std::printf("  mismatched response %s\n", mismatch.c_str());
+    std::printf("%-12s %12s %12s\n", "latency us", "p50", "p99");
+    std::printf("%-12s %12.1f %12.1f\n", "recorded", report.dRecordedP50Us, report.dRecordedP99Us);
+    std::printf("%-12s %12.1f %12.1f\n", "replayed", report.dReplayP50Us, report.dReplayP99Us);
+
+    int exitCode = 0;
+    if (!baselinePath.empty()) {
+        std::ifstream input(baselinePath, std::ios::binary);
+        std::string text((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+        MCP::CMCPJsonParser parser;
+        Json::Value jBaseline;
+        MCP::TrafficReplayReport baseline;
+        if (!parser.Parse(text, jBaseline) || MCP::ERRNO_OK != baseline.FromJson(jBaseline)) {
+            std::printf("cannot read baseline '%s'\n", baselinePath.c_str());
+            return 1;
+        }
+        std::printf("%-12s %12.1f %12.1f (mismatched %zu, missing %zu)\n", "baseline", baseline.dReplayP50Us,
+                    baseline.dReplayP99Us, baseline.nMismatches, baseline.nMissing);
+        bool regressed = report.IsRegression(baseline, tolerance);
+        std::printf("%s (tolerance %.0f%%)\n", regressed ? "REGRESSION" : "no regression", tolerance * 100);
+        exitCode = regressed ? 1 : 0;
+    }
+    if (!saveBaselinePath.empty()) {
+        std::ofstream output(saveBaselinePath, std::ios::binary | std::ios::trunc);
+        output << report.ToJson().toStyledString();
+        if (!output)
+            std::printf("cannot write baseline '%s'\n", saveBaselinePath.c_str());
+    }
+
+    return exitCode;
+}
@@ -13,8 +13,8 @@ class TinyMCPConan(ConanFile):
     description = "TinyMCP - Lightweight C++ SDK for MCP Server"
     topics = ("mcp", "sdk", "json-rpc", "llm")
     settings = "os", "compiler", "build_type", "arch"
-    options = {"shared": [True, False]}
-    default_options = {"shared": False}
+    options = {"shared": [True, False], "with_flatbuffers": [True, False], "with_zlib": [True, False]}
+    default_options = {"shared": False, "with_flatbuffers": False, "with_zlib": False}
     exports_sources = (
         "CMakeLists.txt",
         "Source/*",
@@ -23,6 +23,14 @@ class TinyMCPConan(ConanFile):
         "LICENSE",
     )
 
+    def requirements(self):
+        if self.options.with_flatbuffers:
+            # Must match the flatc version mcp_generated.h was generated with
+            self.requires("flatbuffers/25.2.10")
+        if self.options.with_zlib:
+            # permessage-deflate of the WebSocket transport
+            self.requires("zlib/1.3.1")
+
     def layout(self):
         # Rely on CMake helper defaults (build/ and generators/)
         pass
@@ -31,6 +39,8 @@ class TinyMCPConan(ConanFile):
         tc = CMakeToolchain(self)
         tc.variables["TINYMCP_BUILD_SHARED"] = "ON" if self.options.shared else "OFF"
         tc.variables["TINYMCP_BUILD_EXAMPLES"] = "OFF"  # keep package lean
+        tc.variables["TINYMCP_WITH_FLATBUFFERS"] = "ON" if self.options.with_flatbuffers else "OFF"
+        tc.variables["TINYMCP_WITH_ZLIB"] = "ON" if self.options.with_zlib else "OFF"
         tc.generate()
 
         deps = CMakeDeps(self)
@@ -0,0 +1,148 @@
+// Checks the answers to JSON-RPC batches: empty batches, invalid elements, duplicate ids,
+// notifications only, and tool calls timing out inside a batch.
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include "Source/Protocol/Message/JsonParser.h"
+#include "Source/Protocol/Session/SessionManager.h"
+#include "test_support.h"
+
+namespace {
+
+using test::Expect;
+
+class CBatchClient {
+public:
+    CBatchClient() {
+        auto spDefinition = test::BuildDefinition();
+        m_bStarted = spDefinition && MCP::ERRNO_OK == m_manager.Start(spDefinition)
+                     && MCP::ERRNO_OK == m_manager.StartSession(m_spTransport);
+        if (!m_bStarted)
+            return;
+        m_spTransport->Push(test::INITIALIZE);
+        m_spTransport->Push(test::INITIALIZED);
+        m_bStarted = m_spTransport->WaitWritten(1);
+        m_nRead = 1;
+    }
+    ~CBatchClient() {
+        m_spTransport->Close();
+        m_manager.Stop();
+    }
+
+    bool IsStarted() const { return m_bStarted; }
+    MCP::CMCPSessionManager& GetManager() { return m_manager; }
+
+    void Push(const std::string& frame) { m_spTransport->Push(frame); }
+    // Sends the frame and returns the next message written by the session, null if none came.
+    Json::Value Send(const std::string& frame) {
+        Push(frame);
+        return Next();
+    }
+    Json::Value Next() {
+        Json::Value message;
+        if (!m_spTransport->WaitWritten(m_nRead + 1))
+            return message;
+        MCP::CMCPJsonParser parser;
+        if (!parser.Parse(m_spTransport->Written()[m_nRead++], message))
+            message = "unparsable";
+        return message;
+    }
+
+private:
+    MCP::CMCPSessionManager m_manager;
+    std::shared_ptr<test::CScriptTransport> m_spTransport{ std::make_shared<test::CScriptTransport>() };
+    size_t m_nRead{ 0 };
+    bool m_bStarted{ false };
+};
+
+bool IsError(const Json::Value& message, int code, const Json::Value& id) {
+    return message.isObject() && message.isMember(MCP::MSG_KEY_ID) && id == message[MCP::MSG_KEY_ID] && !message.isMember(MCP::MSG_KEY_RESULT)
+           && code == message[MCP::MSG_KEY_ERROR][MCP::MSG_KEY_CODE].asInt();
+}
+
+bool IsResult(const Json::Value& message, const Json::Value& id) {
+    return message.isObject() && id == message[MCP::MSG_KEY_ID] && message.isMember(MCP::MSG_KEY_RESULT);
+}
+
+// The element of the batch answering id; responses follow the order they complete in.
+Json::Value FindResponse(const Json::Value& batch, int id) {
+    if (batch.isArray())
+        for (auto& response : batch)
+            if (response[MCP::MSG_KEY_ID] == Json::Value(id))
+                return response;
+    return Json::Value();
+}
+
+void CheckInvalidBatches(CBatchClient& client) {
+    Json::Value response = client.Send("[]");
+    Expect(IsError(response, MCP::ERRNO_INVALID_REQUEST, Json::Value()), "empty batch answered with a single error");
+
+    response = client.Send("[1,2]");
+    Expect(response.isArray() && 2 == response.size(), "batch of invalid elements answered with one error each");
+    for (auto& element : response)
+        Expect(IsError(element, MCP::ERRNO_INVALID_REQUEST, Json::Value()), "invalid element answered as an invalid request");
+
+    response = client.Send(R"([{"jsonrpc":"2.0","id":1,"method":"ping"},"x",{"jsonrpc":"2.0","method":"notifications/cancelled","params":{"requestId":99}},[]])");
+    Expect(response.isArray() && 3 == response.size(), "mixed batch answers the request and both invalid elements");
+    Expect(IsResult(FindResponse(response, 1), 1), "valid request of a mixed batch answered");
+    int invalid = 0;
+    for (auto& element : response)
+        invalid += IsError(element, MCP::ERRNO_INVALID_REQUEST, Json::Value()) ? 1 : 0;
+    Expect(2 == invalid, "invalid elements of a mixed batch answered");
+}
+
+void CheckDuplicateIds(CBatchClient& client) {
+    Json::Value response = client.Send(R"([{"jsonrpc":"2.0","id":5,"method":"ping"},{"jsonrpc":"2.0","id":5,"method":"ping"},{"jsonrpc":"2.0","id":"5","method":"ping"}])");
+    Expect(response.isArray() && 3 == response.size(), "every element of a batch with a duplicate id answered");
+    if (!response.isArray() || 3 != response.size())
+        return;
+    // Responses are in request order when nothing is asynchronous: the first use of an id runs.
+    Expect(IsResult(response[0], 5), "first use of the id answered");
+    Expect(IsError(response[1], MCP::ERRNO_INVALID_REQUEST, 5), "second use of the id rejected");
+    Expect(IsResult(response[2], "5"), "string id equal in text is another id");
+}
+
+void CheckNotificationsOnly(CBatchClient& client) {
+    client.Push(R"([{"jsonrpc":"2.0","method":"notifications/cancelled","params":{"requestId":99}},)"
+                R"({"jsonrpc":"2.0","method":"notifications/cancelled","params":{"requestId":98}}])");
+    Expect(IsResult(client.Send(R"({"jsonrpc":"2.0","id":30,"method":"ping"})"), 30), "batch of notifications gets no response");
+}
+
+// A call timing out is answered inside its batch, with the requests around it.
+void CheckTimeout(CBatchClient& client) {
+    Json::Value response = client.Send(R"([{"jsonrpc":"2.0","id":8,"method":"tools/call","params":{"name":"slow","arguments":{},"_meta":{"timeoutMs":30}}},)"
+                                       R"({"jsonrpc":"2.0","id":9,"method":"ping"},)"
+                                       R"({"jsonrpc":"2.0","id":10,"method":"tools/call","params":{"name":"echo","arguments":{"input":"x"}}}])");
+    Expect(response.isArray() && 3 == response.size(), "batch with a timeout answered once");
+    Expect(IsError(FindResponse(response, 8), MCP::ERRNO_REQUEST_TIMEOUT, 8), "timed out call answered inside the batch");
+    Expect(IsResult(FindResponse(response, 9), 9) && IsResult(FindResponse(response, 10), 10), "other requests of the batch answered");
+
+    // The result of the tool arrives while the timer is still held up: the call still times out.
+    client.GetManager().ScheduleDeadline(std::chrono::steady_clock::now(),
+                                         []() { std::this_thread::sleep_for(std::chrono::milliseconds(test::SLOW_TOOL_MS * 4)); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    response = client.Send(R"([{"jsonrpc":"2.0","id":11,"method":"tools/call","params":{"name":"slow","arguments":{},"_meta":{"timeoutMs":30}}},)"
+                           R"({"jsonrpc":"2.0","id":12,"method":"ping"}])");
+    Expect(response.isArray() && 2 == response.size(), "batch with a late result answered once");
+    Expect(IsError(FindResponse(response, 11), MCP::ERRNO_REQUEST_TIMEOUT, 11), "late result answered as a timeout");
+    Expect(IsResult(FindResponse(response, 12), 12), "request next to the late result answered");
+
+    response = client.Send(R"({"jsonrpc":"2.0","id":13,"method":"ping"})");
+    Expect(IsResult(response, 13), "nothing written after the batch but the next response");
+}
+
+} // namespace
+
+int main() {
+    CBatchClient client;
+    Expect(client.IsStarted(), "session initialized");
+    if (test::Failures())
+        return test::Report("batch");
+
+    CheckInvalidBatches(client);
+    CheckDuplicateIds(client);
+    CheckNotificationsOnly(client);
+    CheckTimeout(client);
+    return test::Report("batch");
+}
@@ -0,0 +1,388 @@
+// Drives CHttpSseListener over plain sockets: the request parser, the status codes of the streamable
+// HTTP endpoint, and the routing of sessions between the event loops.
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <initializer_list>
+#include <map>
+#include <string>
+#include "Source/Protocol/Public/Config.h"
+#include "Source/Protocol/Session/SessionManager.h"
+#include "Source/Protocol/Transport/HttpSseTransport.h"
+#include "test_support.h"
+
+namespace {
+
+using test::Expect;
+
+struct HttpResponse {
+    int status = 0;
+    std::map<std::string, std::string> headers;
+    std::string body;
+};
+
+// One connection to the listener; responses are read in order, whatever the writes they span.
+class CClient {
+public:
+    explicit CClient(int port) {
+        m_fd = socket(AF_INET, SOCK_STREAM, 0);
+        struct timeval timeout{};
+        timeout.tv_sec = 5;
+        setsockopt(m_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        struct sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(static_cast<uint16_t>(port));
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (0 != connect(m_fd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address))) {
+            close(m_fd);
+            m_fd = -1;
+        }
+    }
+    ~CClient() {
+        if (m_fd >= 0)
+            close(m_fd);
+    }
+
+    bool Send(const std::string& data) {
+        size_t sent = 0;
+        while (m_fd >= 0 && sent < data.size()) {
+            ssize_t written = send(m_fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (written <= 0)
+                return false;
+            sent += static_cast<size_t>(written);
+        }
+        return m_fd >= 0;
+    }
+
+    // Reads the next response; a chunked body is returned decoded.
+    bool Receive(HttpResponse& response) {
+        response = HttpResponse();
+        size_t headerEnd;
+        while (std::string::npos == (headerEnd = m_buffer.find("\r\n\r\n")))
+            if (!Fill())
+                return false;
+        std::string head = m_buffer.substr(0, headerEnd);
+        m_buffer.erase(0, headerEnd + 4);
+
+        size_t lineEnd = head.find("\r\n");
+        std::string statusLine = head.substr(0, lineEnd);
+        if (0 != statusLine.compare(0, 9, "HTTP/1.1 "))
+            return false;
+        response.status = std::atoi(statusLine.c_str() + 9);
+        while (std::string::npos != lineEnd) {
+            size_t begin = lineEnd + 2;
+            lineEnd = head.find("\r\n", begin);
+            std::string line = head.substr(begin, std::string::npos == lineEnd ? std::string::npos : lineEnd - begin);
+            size_t colon = line.find(':');
+            if (std::string::npos == colon)
+                return false;
+            std::string name = line.substr(0, colon);
+            for (auto& c : name)
+                c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+            size_t valueBegin = line.find_first_not_of(' ', colon + 1);
+            response.headers[name] = std::string::npos == valueBegin ? "" : line.substr(valueBegin);
+        }
+
+        if ("chunked" == response.headers["transfer-encoding"]) {
+            while (true) {
+                size_t sizeEnd;
+                while (std::string::npos == (sizeEnd = m_buffer.find("\r\n")))
+                    if (!Fill())
+                        return false;
+                size_t size = std::stoul(m_buffer.substr(0, sizeEnd), nullptr, 16);
+                while (m_buffer.size() < sizeEnd + 2 + size + 2)
+                    if (!Fill())
+                        return false;
+                if (0 != m_buffer.compare(sizeEnd + 2 + size, 2, "\r\n"))
+                    return false;
+                response.body.append(m_buffer, sizeEnd + 2, size);
+                m_buffer.erase(0, sizeEnd + 2 + size + 2);
+                if (0 == size)
+                    return true;
+            }
+        }
+        size_t length = std::stoul(response.headers.count("content-length") ? response.headers["content-length"] : "0");
+        while (m_buffer.size() < length)
+            if (!Fill())
+                return false;
+        response.body = m_buffer.substr(0, length);
+        m_buffer.erase(0, length);
+        return true;
+    }
+
+    // The server closed the connection after what was read, within half a second.
+    bool IsClosed() {
+        struct pollfd pfd{};
+        pfd.fd = m_fd;
+        pfd.events = POLLIN;
+        char byte;
+        return m_buffer.empty() && 1 == poll(&pfd, 1, 500) && 0 == recv(m_fd, &byte, 1, 0);
+    }
+
+private:
+    bool Fill() {
+        char data[4096];
+        ssize_t received = m_fd >= 0 ? recv(m_fd, data, sizeof(data), 0) : -1;
+        if (received <= 0)
+            return false;
+        m_buffer.append(data, static_cast<size_t>(received));
+        return true;
+    }
+
+    int m_fd = -1;
+    std::string m_buffer;
+};
+
+std::string Post(const std::string& body, const std::string& sessionId = "", const std::string& path = "/mcp", const std::string& headers = "") {
+    std::string request = "POST " + path + " HTTP/1.1\r\nHost: 127.0.0.1\r\nContent-Type: application/json\r\n"
+                          "Accept: application/json, text/event-stream\r\n" + headers;
+    if (!sessionId.empty())
+        request += "Mcp-Session-Id: " + sessionId + "\r\n";
+    return request + "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+}
+
+std::string Ping(int id) {
+    return R"({"jsonrpc":"2.0","id":)" + std::to_string(id) + R"(,"method":"ping"})";
+}
+
+// The SSE stream answering a request carries exactly its response.
+bool IsEventFor(const HttpResponse& response, int id) {
+    auto itrType = response.headers.find("content-type");
+    return 200 == response.status && itrType != response.headers.end() && "text/event-stream" == itrType->second
+           && 0 == response.body.compare(0, 6, "data: ") && response.body.size() > 8
+           && 0 == response.body.compare(response.body.size() - 2, 2, "\n\n")
+           && std::string::npos != response.body.find("\"id\":" + std::to_string(id) + ",");
+}
+
+// The SSE stream answering a batch carries one event: the array of the responses to its requests.
+bool IsBatchEventFor(const HttpResponse& response, std::initializer_list<int> ids) {
+    if (!IsEventFor(response, *ids.begin()) || 0 != response.body.compare(0, 7, "data: [") || std::string::npos != response.body.find("\n\ndata: "))
+        return false;
+    for (int id : ids)
+        if (std::string::npos == response.body.find("\"id\":" + std::to_string(id) + ","))
+            return false;
+    return true;
+}
+
+bool IsSessionId(const std::string& id) {
+    if (32 != id.size())
+        return false;
+    for (char c : id)
+        if (!std::isxdigit(static_cast<unsigned char>(c)) || std::isupper(static_cast<unsigned char>(c)))
+            return false;
+    return true;
+}
+
+// Sends initialize and returns the id of the new session; empty on failure.
+std::string Initialize(CClient& client) {
+    HttpResponse response;
+    if (!client.Send(Post(test::INITIALIZE)) || !client.Receive(response) || !IsEventFor(response, 0))
+        return "";
+    std::string sessionId = response.headers["mcp-session-id"];
+    if (!client.Send(Post(test::INITIALIZED, sessionId)) || !client.Receive(response) || 202 != response.status)
+        return "";
+    return sessionId;
+}
+
+// Malformed requests and those the endpoint refuses get their status; the connection is kept
+// alive after a refusal, not after a malformed request.
+void CheckRefusals(int port) {
+    struct Case {
+        const char* name;
+        std::string request;
+        int status;
+        bool closes;
+    };
+    const Case cases[] = {
+        { "garbage request line", "GARBAGE\r\n\r\n", 400, true },
+        { "request line without version", "POST /mcp\r\nContent-Length: 0\r\n\r\n", 400, true },
+        { "header without colon", "POST /mcp HTTP/1.1\r\nHost\r\n\r\n", 400, true },
+        { "unknown path", Post(Ping(1), "", "/other"), 404, false },
+        { "PUT", "PUT /mcp HTTP/1.1\r\nContent-Length: 0\r\n\r\n", 405, false },
+        { "chunked body", "POST /mcp HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n0\r\n\r\n", 400, true },
+        { "invalid length", "POST /mcp HTTP/1.1\r\nContent-Length: x\r\n\r\n", 400, true },
+        { "oversized body", "POST /mcp HTTP/1.1\r\nContent-Length: 2048\r\n\r\n", 413, true },
+        { "body without method or id", Post(R"({"jsonrpc":"2.0"})"), 400, false },
+        { "missing session id", Post(Ping(1)), 400, false },
+        { "unknown session id", Post(Ping(1), "00000000000000000000000000000000"), 404, false },
+    };
+    for (auto& refusal : cases) {
+        CClient client(port);
+        HttpResponse response;
+        Expect(client.Send(refusal.request) && client.Receive(response), std::string("answer to ") + refusal.name);
+        Expect(refusal.status == response.status, std::string("status of ") + refusal.name + ": " + std::to_string(response.status));
+        Expect(refusal.closes == client.IsClosed(), std::string(refusal.closes ? "close after " : "keep-alive after ") + refusal.name);
+    }
+}
+
+// Every session gets its own random id; requests of a session are answered on their own stream.
+void CheckSessions(int port) {
+    CClient client(port);
+    std::string first = Initialize(client);
+    std::string second = Initialize(client);
+    Expect(IsSessionId(first) && IsSessionId(second), "session ids are 32 hex digits");
+    Expect(first != second, "session ids are distinct");
+
+    HttpResponse response;
+    Expect(client.Send(Post(Ping(7), second)) && client.Receive(response) && IsEventFor(response, 7), "ping answered");
+    Expect(second == response.headers["mcp-session-id"], "stream carries the session id");
+
+    Expect(client.Send("DELETE /mcp HTTP/1.1\r\nMcp-Session-Id: " + first + "\r\n\r\n") && client.Receive(response)
+               && 200 == response.status, "DELETE ends the session");
+    Expect(client.Send(Post(Ping(8), first)) && client.Receive(response) && 404 == response.status, "ended session is not found");
+    Expect(client.Send("DELETE /mcp HTTP/1.1\r\nMcp-Session-Id: " + first + "\r\n\r\n") && client.Receive(response)
+               && 404 == response.status, "ended session cannot be deleted again");
+    Expect(client.Send(Post(Ping(9), second)) && client.Receive(response) && IsEventFor(response, 9), "other session lives on");
+}
+
+// Requests are parsed whatever the writes they arrive in.
+void CheckFraming(int port) {
+    CClient client(port);
+    std::string sessionId = Initialize(client);
+    HttpResponse response;
+
+    std::string request = Post(Ping(10), sessionId);
+    for (size_t split : { size_t(3), request.find("\r\n\r\n") + 2, request.size() - 1 }) {
+        Expect(client.Send(request.substr(0, split)), "first part sent");
+        usleep(20000);
+        Expect(client.Send(request.substr(split)) && client.Receive(response) && IsEventFor(response, 10),
+               "request split at " + std::to_string(split) + " answered");
+    }
+
+    Expect(client.Send(Post(Ping(11), sessionId) + Post(Ping(12), sessionId) + Post(test::INITIALIZED, sessionId)),
+           "pipelined requests sent");
+    Expect(client.Receive(response) && IsEventFor(response, 11), "first pipelined request answered");
+    Expect(client.Receive(response) && IsEventFor(response, 12), "second pipelined request answered");
+    Expect(client.Receive(response) && 202 == response.status, "pipelined notification accepted");
+
+    Expect(client.Send("GET /mcp HTTP/1.1\r\nConnection: close\r\nMcp-Session-Id: " + sessionId + "\r\n\r\n")
+               && client.Receive(response) && 405 == response.status && client.IsClosed(),
+           "Connection: close honoured");
+}
+
+// A batch is answered on the stream of its POST; one without requests is accepted, one without
+// messages refused.
+void CheckBatches(int port) {
+    CClient client(port);
+    std::string sessionId = Initialize(client);
+    const std::string cancelled = R"({"jsonrpc":"2.0","method":"notifications/cancelled","params":{"requestId":99}})";
+    HttpResponse response;
+
+    Expect(client.Send(Post(" [" + Ping(40) + "," + Ping(41) + "]", sessionId)) && client.Receive(response) && IsBatchEventFor(response, { 40, 41 }),
+           "batch answered with one array");
+    Expect(client.Send(Post("[" + Ping(42) + R"(,"x",)" + cancelled + "]", sessionId)) && client.Receive(response)
+               && IsBatchEventFor(response, { 42 }) && std::string::npos != response.body.find("\"id\":null"),
+           "batch with an invalid element answered with its error");
+    Expect(client.Send(Post("[" + cancelled + "," + cancelled + "]", sessionId)) && client.Receive(response) && 202 == response.status,
+           "batch of notifications accepted");
+    Expect(client.Send(Post("[]", sessionId)) && client.Receive(response) && 400 == response.status, "empty batch refused");
+    Expect(client.Send(Post("[1,2]", sessionId)) && client.Receive(response) && 400 == response.status, "batch without messages refused");
+    Expect(client.Send(Post("[" + Ping(43), sessionId)) && client.Receive(response) && 400 == response.status, "cut off batch refused");
+    Expect(client.Send(Post("[" + Ping(44) + "]")) && client.Receive(response) && 400 == response.status, "batch without session refused");
+    Expect(client.Send(Post("[" + Ping(45) + "]", sessionId) + Post(Ping(46), sessionId)) && client.Receive(response)
+               && IsBatchEventFor(response, { 45 }) && client.Receive(response) && IsEventFor(response, 46),
+           "request pipelined behind a batch answered");
+}
+
+// Sessions live on the loop of the connection that created them; a request for another session
+// moves the connection to the loop owning it.
+void CheckRouting(int port, MCP::CHttpSseListener& listener) {
+    // New connections go to the loop with the fewest; let the loops see the earlier ones close.
+    usleep(200000);
+    CClient left(port);
+    CClient right(port);
+    std::string leftSession = Initialize(left);
+    std::string rightSession = Initialize(right);
+    auto fnMovedIn = [&]() {
+        unsigned long long moved = 0;
+        for (auto& stats : listener.GetShardStats())
+            moved += stats.ullConnectionsMovedIn;
+        return moved;
+    };
+    auto movedBefore = fnMovedIn();
+
+    HttpResponse response;
+    Expect(left.Send(Post(Ping(20), rightSession)) && left.Receive(response) && IsEventFor(response, 20), "request for the other loop answered");
+    Expect(left.Send(Post(Ping(21), leftSession)) && left.Receive(response) && IsEventFor(response, 21), "request for the own loop answered");
+    Expect(left.Send(Post(Ping(22), rightSession) + Post(Ping(23), leftSession)) && left.Receive(response) && IsEventFor(response, 22)
+               && left.Receive(response) && IsEventFor(response, 23),
+           "pipelined requests for both loops answered");
+    Expect(right.Send(Post(Ping(24), rightSession)) && right.Receive(response) && IsEventFor(response, 24), "owner connection unaffected");
+    Expect(fnMovedIn() >= movedBefore + 3, "connection moved between the loops");
+}
+
+// Every API key is a principal of its own: a session started with one key is not reachable with
+// another.
+void CheckKeyOwnership(MCP::CMCPSessionManager& manager) {
+    auto spListener = std::make_shared<MCP::CHttpSseListener>();
+    spListener->SetAuthorization("key-three");
+    Expect(MCP::ERRNO_OK == spListener->Listen([&](const std::shared_ptr<MCP::CMCPTransport>& spTransport) {
+        if (MCP::ERRNO_OK != manager.StartSession(spTransport))
+            spTransport->Disconnect();
+    }), "authenticating listener started");
+    const std::string keyOne = "Authorization: Bearer key-one\r\n";
+    const std::string keyTwo = "Authorization: Bearer key-two\r\n";
+
+    CClient owner(spListener->GetPort());
+    HttpResponse response;
+    Expect(owner.Send(Post(Ping(40))) && owner.Receive(response) && 401 == response.status, "request without a key refused");
+    Expect(owner.Send(Post(test::INITIALIZE, "", "/mcp", keyOne)) && owner.Receive(response) && IsEventFor(response, 0),
+           "session started with a configured key");
+    std::string sessionId = response.headers["mcp-session-id"];
+
+    CClient sameKey(spListener->GetPort());
+    Expect(sameKey.Send(Post(Ping(41), sessionId, "/mcp", keyOne)) && sameKey.Receive(response) && IsEventFor(response, 41),
+           "session reached with its key on another connection");
+    CClient otherKey(spListener->GetPort());
+    Expect(otherKey.Send(Post(Ping(42), sessionId, "/mcp", keyTwo)) && otherKey.Receive(response) && 403 == response.status,
+           "session refused to another configured key");
+    Expect(otherKey.Send(Post(Ping(43), sessionId, "/mcp", "Authorization: Bearer key-three\r\n")) && otherKey.Receive(response)
+               && 403 == response.status,
+           "session refused to the application key");
+
+    spListener->Close();
+}
+
+} // namespace
+
+int main() {
+    std::string configPath = "tinymcp_http_test_" + std::to_string(getpid()) + ".ini";
+    {
+        std::ofstream config(configPath);
+        config << "[server]\nhost=127.0.0.1\nport=0\n[http]\nendpoint=/mcp\nevent_loops=2\nio_uring=0\nmax_request_bytes=1024\n"
+                  "[websocket]\nenabled=0\n[auth]\nenable_auth=0\napi_key=key-one, key-two\n";
+    }
+    int loaded = MCP::Config::GetInstance().LoadFromFile(configPath);
+    std::remove(configPath.c_str());
+    Expect(MCP::ERRNO_OK == loaded, "config loaded");
+
+    auto spDefinition = test::BuildDefinition();
+    MCP::CMCPSessionManager manager;
+    Expect(spDefinition && MCP::ERRNO_OK == manager.Start(spDefinition), "session manager started");
+    auto spListener = std::make_shared<MCP::CHttpSseListener>();
+    int listening = spListener->Listen([&](const std::shared_ptr<MCP::CMCPTransport>& spTransport) {
+        if (MCP::ERRNO_OK != manager.StartSession(spTransport))
+            spTransport->Disconnect();
+    });
+    Expect(MCP::ERRNO_OK == listening && spListener->GetPort() > 0, "listening");
+    if (test::Failures())
+        return test::Report("http transport");
+
+    CheckRefusals(spListener->GetPort());
+    CheckSessions(spListener->GetPort());
+    CheckFraming(spListener->GetPort());
+    CheckBatches(spListener->GetPort());
+    CheckRouting(spListener->GetPort(), *spListener);
+    CheckKeyOwnership(manager);
+
+    spListener->Close();
+    manager.Stop();
+    return test::Report("http transport");
+}
@@ -0,0 +1,165 @@
+// Checks CMCPJsonParser against jsoncpp on documents both backends must agree on, and the
+// differences that remain between them. Build with -DTINYMCP_JSON_BACKEND=native to check the
+// native backend.
+#include <clocale>
+#include <cstdio>
+#include <cstring>
+#include <locale>
+#include <memory>
+#include <string>
+#include "Source/Protocol/Message/JsonParser.h"
+
+namespace {
+
+int failures = 0;
+
+void Expect(bool condition, const std::string& what) {
+    if (!condition) {
+        std::printf("FAIL: %s\n", what.c_str());
+        ++failures;
+    }
+}
+
+// The reference: jsoncpp with every extension off, as the jsoncpp backend configures it.
+bool ReferenceParse(const std::string& text, Json::Value& value) {
+    Json::CharReaderBuilder builder;
+    Json::CharReaderBuilder::strictMode(&builder.settings_);
+    builder["strictRoot"] = false;
+    builder["rejectDupKeys"] = false;
+    builder["skipBom"] = false;
+    std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+    try {
+        return reader->parse(text.data(), text.data() + text.size(), &value, nullptr);
+    } catch (const Json::Exception&) {
+        return false;
+    }
+}
+
+// Valid documents: both backends accept them and build the same tree as the reference.
+void CheckValid() {
+    const char* documents[] = {
+        "{}",
+        "[]",
+        "  2  ",
+        "-0",
+        "0.5",
+        "-12.25e-3",
+        "1E+2",
+        "9223372036854775807",
+        "-9223372036854775808",
+        "18446744073709551615",
+        "18446744073709551616",
+        "1e-400",
+        "\"\\u00e9\\ud83d\\ude00\\n\"",
+        "[true,false,null]",
+        R"({"a":1,"a":2})",
+        "\"tab\tand newline\n\"",
+        R"({"jsonrpc":"2.0","id":1,"method":"tools/call","params":{"name":"echo","arguments":{"input":"x"}}})",
+        R"([{"a":[1,{"b":[]}]},"c"])",
+    };
+    MCP::CMCPJsonParser parser;
+    for (const char* document : documents) {
+        Json::Value expected;
+        Json::Value actual;
+        Expect(ReferenceParse(document, expected), std::string("reference accepts ") + document);
+        Expect(parser.Parse(document, actual), std::string("parser accepts ") + document);
+        Expect(expected == actual, std::string("same tree for ") + document);
+    }
+}
+
+// Invalid documents: every backend rejects them, without throwing.
+void CheckInvalid() {
+    const char* documents[] = {
+        "",
+        "1e400",
+        "-1e400",
+        "[1e400]",
+        "NaN",
+        "Infinity",
+        "1 x",
+        "{} x",
+        "{}{}",
+        "[1,]",
+        R"({"a":1,})",
+        "1.5e",
+        "'a'",
+        "\"unterminated",
+        "\xEF\xBB\xBF{}",
+    };
+    MCP::CMCPJsonParser parser;
+    for (const char* document : documents) {
+        Json::Value value;
+        Expect(!parser.Parse(document, value), std::string("parser rejects '") + document + "'");
+    }
+}
+
+// Nesting past the limit of 1000 is rejected rather than overflowing the stack or throwing.
+void CheckNesting() {
+    MCP::CMCPJsonParser parser;
+    Json::Value value;
+    std::string shallow = std::string(1000, '[') + std::string(1000, ']');
+    Expect(parser.Parse(shallow, value), "parser accepts 1000 nested arrays");
+    for (size_t depth : { 1002, 5000, 100000 }) {
+        std::string deep(depth, '[');
+        bool parsed = true;
+        try {
+            parsed = parser.Parse(deep, value);
+        } catch (...) {
+            Expect(false, "parser throws on " + std::to_string(depth) + " nested arrays");
+        }
+        Expect(!parsed, "parser rejects " + std::to_string(depth) + " nested arrays");
+        std::string closed = deep + std::string(depth, ']');
+        Expect(!parser.Parse(closed, value), "parser rejects " + std::to_string(depth) + " closed nested arrays");
+    }
+}
+
+// Number forms outside RFC 8259 that jsoncpp reads leniently; the native backend rejects them.
+void CheckLenientNumbers() {
+    const char* documents[] = { "01", "1.", "-", "[01]", "[1.]", "[-]" };
+    bool native = 0 == std::strcmp(MCP::CMCPJsonParser::GetBackendName(), "native");
+    MCP::CMCPJsonParser parser;
+    for (const char* document : documents) {
+        Json::Value value;
+        Json::Value expected;
+        bool parsed = parser.Parse(document, value);
+        if (native)
+            Expect(!parsed, std::string("native parser rejects '") + document + "'");
+        else
+            Expect(parsed && ReferenceParse(document, expected) && expected == value,
+                   std::string("jsoncpp parser reads '") + document + "' as jsoncpp does");
+    }
+}
+
+// A decimal comma in the C locale, where one is installed, does not change how numbers are read;
+// nor, for the native backend, does one in the global C++ locale, which jsoncpp reads numbers with.
+struct CommaDecimalPoint : std::numpunct<char> {
+    char do_decimal_point() const override { return ','; }
+};
+
+void CheckLocale() {
+    const char* names[] = { "de_DE.UTF-8", "de_DE.utf8", "fr_FR.UTF-8", "fr_FR.utf8", "ru_RU.UTF-8" };
+    for (const char* name : names)
+        if (std::setlocale(LC_ALL, name))
+            break;
+    bool native = 0 == std::strcmp(MCP::CMCPJsonParser::GetBackendName(), "native");
+    std::locale previous = native ? std::locale::global(std::locale(std::locale::classic(), new CommaDecimalPoint)) : std::locale();
+    MCP::CMCPJsonParser parser;
+    Json::Value value;
+    Expect(parser.Parse("[1.5,-2.25e1]", value) && 1.5 == value[0].asDouble() && -22.5 == value[1].asDouble(),
+           std::string("numbers read with a decimal comma locale (C locale ") + std::setlocale(LC_ALL, nullptr) + ")");
+    if (native)
+        std::locale::global(previous);
+    std::setlocale(LC_ALL, "C");
+}
+
+} // namespace
+
+int main() {
+    CheckValid();
+    CheckInvalid();
+    CheckNesting();
+    CheckLenientNumbers();
+    CheckLocale();
+    std::printf("json parser (%s): %s\n", MCP::CMCPJsonParser::GetBackendName(), failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,160 @@
+// Shared by the tests running sessions: failure counting, a server offering an echo and a slow tool,
+// registered through CMCPServer like any server, and a transport pushing frames into a session like
+// an event loop transport does and keeping what the session writes. Included by one translation unit
+// per test executable.
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Source/Protocol/Entity/Server.h"
+#include "Source/Protocol/Message/JsonParser.h"
+#include "Source/Protocol/Message/Request.h"
+#include "Source/Protocol/Task/BasicTask.h"
+
+namespace test {
+
+inline int& Failures() {
+    static int failures = 0;
+    return failures;
+}
+
+inline void Expect(bool condition, const std::string& what) {
+    if (!condition) {
+        std::printf("FAIL: %s\n", what.c_str());
+        ++Failures();
+    }
+}
+
+// Prints the outcome; the exit code of the test.
+inline int Report(const char* name) {
+    std::printf("%s: %s\n", name, Failures() ? "FAILED" : "OK");
+    return Failures() ? 1 : 0;
+}
+
+class CEchoTask : public MCP::ProcessCallToolRequest {
+public:
+    CEchoTask() : ProcessCallToolRequest(nullptr) {}
+
+    std::shared_ptr<CMCPTask> Clone() const override { return std::make_shared<CEchoTask>(); }
+    int Cancel() override { return MCP::ERRNO_OK; }
+    int Execute() override {
+        auto spResult = BuildResult();
+        if (!spResult)
+            return MCP::ERRNO_INTERNAL_ERROR;
+        const auto& request = static_cast<const MCP::CallToolRequest&>(*m_spRequest);
+        spResult->AddText(request.jArguments["input"].asString());
+        return NotifyResult(std::move(spResult));
+    }
+};
+
+// Answers after SLOW_TOOL_MS whether or not it was cancelled meanwhile.
+constexpr int SLOW_TOOL_MS = 100;
+
+class CSlowTask : public MCP::ProcessCallToolRequest {
+public:
+    CSlowTask() : ProcessCallToolRequest(nullptr) {}
+
+    std::shared_ptr<CMCPTask> Clone() const override { return std::make_shared<CSlowTask>(); }
+    int Cancel() override { return MCP::ERRNO_OK; }
+    int Execute() override {
+        std::this_thread::sleep_for(std::chrono::milliseconds(SLOW_TOOL_MS));
+        auto spResult = BuildResult();
+        if (!spResult)
+            return MCP::ERRNO_INTERNAL_ERROR;
+        spResult->AddText("late");
+        return NotifyResult(std::move(spResult));
+    }
+};
+
+class CTestServer : public MCP::CMCPServer<CTestServer> {
+public:
+    int Initialize() override {
+        MCP::Implementation serverInfo;
+        serverInfo.strName = "tinymcp_test";
+        serverInfo.strVersion = "1.0.0";
+        SetServerInfo(serverInfo);
+        RegisterServerToolsCapabilities(MCP::Tools());
+
+        MCP::CMCPJsonParser parser;
+        MCP::Tool echo;
+        echo.strName = "echo";
+        echo.strDescription = "Returns the input.";
+        if (!parser.Parse(R"({"type":"object","properties":{"input":{"type":"string"}},"required":["input"]})", echo.jInputSchema))
+            return MCP::ERRNO_PARSE_ERROR;
+        MCP::Tool slow;
+        slow.strName = "slow";
+        slow.strDescription = "Answers after a while.";
+        if (!parser.Parse(R"({"type":"object"})", slow.jInputSchema))
+            return MCP::ERRNO_PARSE_ERROR;
+        RegisterToolsTasks(echo.strName, std::make_shared<CEchoTask>());
+        RegisterToolsTasks(slow.strName, std::make_shared<CSlowTask>());
+        RegisterServerTools({ echo, slow }, false);
+        return MCP::ERRNO_OK;
+    }
+
+private:
+    friend class MCP::CMCPServer<CTestServer>;
+    CTestServer() = default;
+    static CTestServer s_Instance;
+};
+
+CTestServer CTestServer::s_Instance;
+
+// The definition of the test server, initialized on first use; nullptr if that failed.
+inline std::shared_ptr<const MCP::ServerDefinition> BuildDefinition() {
+    static const int initialized = CTestServer::GetInstance().Initialize();
+    return MCP::ERRNO_OK == initialized ? CTestServer::GetInstance().GetDefinition() : nullptr;
+}
+
+const char* const INITIALIZE = R"({"jsonrpc":"2.0","id":0,"method":"initialize","params":{"protocolVersion":"2025-06-18","capabilities":{},"clientInfo":{"name":"test","version":"1.0.0"}}})";
+const char* const INITIALIZED = R"({"jsonrpc":"2.0","method":"notifications/initialized"})";
+
+// The client of a session started on it: pushes frames and keeps the messages written back.
+class CScriptTransport : public MCP::CMCPTransport {
+public:
+    int Connect() override { return MCP::ERRNO_OK; }
+    int Disconnect() override { return MCP::ERRNO_OK; }
+    int Read(std::string&) override { return MCP::ERRNO_INTERNAL_INPUT_TERMINATE; }
+    int Write(const std::string& strIn) override {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_vecWritten.push_back(strIn);
+        m_cv.notify_all();
+        return MCP::ERRNO_OK;
+    }
+    int Error(const std::string&) override { return MCP::ERRNO_OK; }
+    bool SetFrameHandler(FrameHandler fnOnFrame, CloseHandler fnOnClose) override {
+        m_fnOnFrame = std::move(fnOnFrame);
+        m_fnOnClose = std::move(fnOnClose);
+        return true;
+    }
+
+    void Push(const std::string& frame) { m_fnOnFrame(frame.data(), frame.data() + frame.size()); }
+    // Waits until count messages have been written in all; false after a few seconds.
+    bool WaitWritten(size_t count) {
+        std::unique_lock<std::mutex> lock(m_mtx);
+        return m_cv.wait_for(lock, std::chrono::seconds(5), [&]() { return m_vecWritten.size() >= count; });
+    }
+    std::vector<std::string> Written() {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        return m_vecWritten;
+    }
+    void Close() {
+        if (m_fnOnClose)
+            m_fnOnClose();
+    }
+
+private:
+    FrameHandler m_fnOnFrame;
+    CloseHandler m_fnOnClose;
+    std::mutex m_mtx;
+    std::condition_variable m_cv;
+    std::vector<std::string> m_vecWritten;
+};
+
+} // namespace test
@@ -0,0 +1,246 @@
+// Checks CMCPWebSocketCodec against frames built by hand: masking, lengths, fragmentation,
+// control frames, refused frames and, in builds with TINYMCP_WITH_ZLIB, permessage-deflate.
+#include <cstdio>
+#include <string>
+#include "Source/Protocol/Transport/WebSocket.h"
+
+namespace {
+
+using Codec = MCP::CMCPWebSocketCodec;
+
+int failures = 0;
+
+void Expect(bool condition, const std::string& what) {
+    if (!condition) {
+        std::printf("FAIL: %s\n", what.c_str());
+        ++failures;
+    }
+}
+
+// A frame as a client sends it, masked unless told otherwise.
+std::string Frame(unsigned int opcode, const std::string& payload, bool final = true, unsigned int reserved = 0, bool masked = true) {
+    const unsigned char mask[4] = { 0x37, 0xfa, 0x21, 0x3d };
+    std::string frame(1, static_cast<char>((final ? 0x80 : 0) | reserved | opcode));
+    unsigned char maskBit = masked ? 0x80 : 0;
+    if (payload.size() < 126) {
+        frame.push_back(static_cast<char>(maskBit | payload.size()));
+    } else if (payload.size() <= 0xffff) {
+        frame.push_back(static_cast<char>(maskBit | 126));
+        frame.push_back(static_cast<char>(payload.size() >> 8));
+        frame.push_back(static_cast<char>(payload.size()));
+    } else {
+        frame.push_back(static_cast<char>(maskBit | 127));
+        for (int i = 7; i >= 0; --i)
+            frame.push_back(static_cast<char>(static_cast<unsigned long long>(payload.size()) >> (8 * i)));
+    }
+    if (masked)
+        frame.append(reinterpret_cast<const char*>(mask), 4);
+    for (size_t i = 0; i < payload.size(); ++i)
+        frame.push_back(masked ? static_cast<char>(payload[i] ^ mask[i & 3]) : payload[i]);
+    return frame;
+}
+
+struct Decoded {
+    Codec::DecodeResult result = Codec::DecodeResult_NeedMore;
+    size_t consumed = 0;
+    std::string payload;
+    int closeCode = 0;
+};
+
+Decoded Decode(Codec& codec, const std::string& input) {
+    Decoded decoded;
+    decoded.result = codec.Decode(input.data(), input.size(), decoded.consumed, decoded.payload, decoded.closeCode);
+    return decoded;
+}
+
+// RFC 6455 section 1.3.
+void CheckAcceptKey() {
+    Expect("s3pPLMBiTxaQ9kYGzzhZRbK+xOo=" == Codec::GetAcceptKey("dGhlIHNhbXBsZSBub25jZQ=="), "accept key of the RFC example");
+}
+
+// Server frames are unmasked text frames with the shortest length encoding.
+void CheckEncode() {
+    struct Case {
+        size_t length;
+        size_t header;
+    };
+    for (auto& encoding : { Case{ 0, 2 }, Case{ 125, 2 }, Case{ 126, 4 }, Case{ 65535, 4 }, Case{ 65536, 10 } }) {
+        Codec codec(1 << 20);
+        std::string payload(encoding.length, 'x');
+        std::string frame;
+        codec.EncodeMessage(payload.data(), payload.size(), frame);
+        std::string what = "frame of " + std::to_string(encoding.length) + " bytes";
+        Expect(encoding.header + encoding.length == frame.size(), what + " has a " + std::to_string(encoding.header) + " byte header");
+        Expect('\x81' == frame[0] && 0 == (frame[1] & 0x80), what + " is a final unmasked text frame");
+        Expect(0 == frame.compare(encoding.header, std::string::npos, payload), what + " carries the payload");
+    }
+
+    std::string close;
+    Codec::EncodeClose(Codec::CloseCode_GoingAway, close);
+    Expect(std::string("\x88\x02\x03\xe9", 4) == close, "close frame carries the status code");
+    std::string pong;
+    std::string payload(200, 'p');
+    Codec::EncodeControl(Codec::Opcode_Pong, payload.data(), payload.size(), pong);
+    Expect(2 + 125 == pong.size() && '\x8a' == pong[0], "control payload is cut to 125 bytes");
+}
+
+void CheckMessages() {
+    Codec codec(1 << 20);
+    std::string payload(70000, 'm');
+    for (auto& message : { std::string(), std::string("{\"id\":1}"), std::string(300, 'a'), payload }) {
+        std::string frame = Frame(Codec::Opcode_Text, message);
+        Decoded decoded = Decode(codec, frame);
+        Expect(Codec::DecodeResult_Message == decoded.result && message == decoded.payload && frame.size() == decoded.consumed,
+               "text message of " + std::to_string(message.size()) + " bytes unmasked");
+    }
+    Decoded decoded = Decode(codec, Frame(Codec::Opcode_Binary, "bin"));
+    Expect(Codec::DecodeResult_Message == decoded.result && "bin" == decoded.payload, "binary message accepted");
+
+    // Frames following each other are decoded one per call.
+    std::string first = Frame(Codec::Opcode_Text, "one");
+    std::string input = first + Frame(Codec::Opcode_Text, "two");
+    decoded = Decode(codec, input);
+    Expect(Codec::DecodeResult_Message == decoded.result && "one" == decoded.payload && first.size() == decoded.consumed, "first of two frames");
+    decoded = Decode(codec, input.substr(decoded.consumed));
+    Expect(Codec::DecodeResult_Message == decoded.result && "two" == decoded.payload, "second of two frames");
+}
+
+// The input is fed as a transport reads it: consumed bytes are dropped, the rest is kept.
+void CheckPartialInput() {
+    std::string input = Frame(Codec::Opcode_Text, "ab", false) + Frame(Codec::Opcode_Continuation, std::string(300, 'c'), false)
+                        + Frame(Codec::Opcode_Continuation, "d");
+    Codec codec(1 << 20);
+    std::string buffer;
+    Decoded decoded;
+    size_t messages = 0;
+    for (size_t i = 0; i < input.size(); ++i) {
+        buffer.push_back(input[i]);
+        decoded = Decode(codec, buffer);
+        buffer.erase(0, decoded.consumed);
+        if (Codec::DecodeResult_NeedMore != decoded.result)
+            ++messages;
+    }
+    Expect(1 == messages && Codec::DecodeResult_Message == decoded.result && "ab" + std::string(300, 'c') + "d" == decoded.payload,
+           "message fed byte by byte decoded once");
+    Expect(buffer.empty(), "every byte consumed");
+}
+
+void CheckFragmentation() {
+    Codec codec(1 << 20);
+    std::string input = Frame(Codec::Opcode_Text, "ab", false) + Frame(Codec::Opcode_Continuation, "cd", false)
+                        + Frame(Codec::Opcode_Ping, "p") + Frame(Codec::Opcode_Pong, "q") + Frame(Codec::Opcode_Continuation, "ef");
+    Decoded decoded = Decode(codec, input);
+    Expect(Codec::DecodeResult_Ping == decoded.result && "p" == decoded.payload, "ping between fragments answered first");
+    decoded = Decode(codec, input.substr(decoded.consumed));
+    Expect(Codec::DecodeResult_Message == decoded.result && "abcdef" == decoded.payload, "pong skipped, fragments joined");
+
+    decoded = Decode(codec, Frame(Codec::Opcode_Text, "x", false));
+    Expect(Codec::DecodeResult_NeedMore == decoded.result && 0 < decoded.consumed, "first fragment consumed");
+    decoded = Decode(codec, Frame(Codec::Opcode_Text, "y"));
+    Expect(Codec::DecodeResult_Error == decoded.result && Codec::CloseCode_ProtocolError == decoded.closeCode,
+           "new message while one is in progress refused");
+}
+
+void CheckClose() {
+    Codec codec(1 << 20);
+    Decoded decoded = Decode(codec, Frame(Codec::Opcode_Close, std::string("\x03\xe9", 2) + "bye"));
+    Expect(Codec::DecodeResult_Close == decoded.result && Codec::CloseCode_GoingAway == decoded.closeCode, "close with a status code");
+    decoded = Decode(codec, Frame(Codec::Opcode_Close, ""));
+    Expect(Codec::DecodeResult_Close == decoded.result && Codec::CloseCode_Normal == decoded.closeCode, "close without a status code");
+    decoded = Decode(codec, Frame(Codec::Opcode_Close, "\x03"));
+    Expect(Codec::DecodeResult_Error == decoded.result && Codec::CloseCode_ProtocolError == decoded.closeCode, "close with one byte refused");
+}
+
+// Frames the server must not accept are refused with the status code to close with; lengths over
+// the limit as soon as the header is read.
+void CheckRefused() {
+    struct Case {
+        const char* name;
+        std::string frame;
+        int closeCode;
+    };
+    std::string tooLong = Frame(Codec::Opcode_Text, std::string(17, 'x'));
+    std::string huge("\x81\xff\x80\x00\x00\x00\x00\x00\x00\x00", 10);
+    const Case cases[] = {
+        { "unmasked frame", Frame(Codec::Opcode_Text, "x", true, 0, false), Codec::CloseCode_ProtocolError },
+        { "reserved data opcode", Frame(0x3, "x"), Codec::CloseCode_ProtocolError },
+        { "reserved control opcode", Frame(0xb, "x"), Codec::CloseCode_ProtocolError },
+        { "fragmented ping", Frame(Codec::Opcode_Ping, "x", false), Codec::CloseCode_ProtocolError },
+        { "ping over 125 bytes", Frame(Codec::Opcode_Ping, std::string(126, 'x')), Codec::CloseCode_ProtocolError },
+        { "continuation without a message", Frame(Codec::Opcode_Continuation, "x"), Codec::CloseCode_ProtocolError },
+        { "RSV1 without deflate", Frame(Codec::Opcode_Text, "x", true, 0x40), Codec::CloseCode_ProtocolError },
+        { "RSV2", Frame(Codec::Opcode_Text, "x", true, 0x20), Codec::CloseCode_ProtocolError },
+        { "RSV3", Frame(Codec::Opcode_Text, "x", true, 0x10), Codec::CloseCode_ProtocolError },
+        { "message over the limit", tooLong, Codec::CloseCode_TooLarge },
+        { "header of a message over the limit", tooLong.substr(0, 2), Codec::CloseCode_TooLarge },
+        { "64-bit length", huge, Codec::CloseCode_TooLarge },
+        { "fragments over the limit", Frame(Codec::Opcode_Text, std::string(10, 'x'), false) + Frame(Codec::Opcode_Continuation, std::string(10, 'x')),
+          Codec::CloseCode_TooLarge },
+    };
+    for (auto& refused : cases) {
+        Codec codec(16);
+        Decoded decoded = Decode(codec, refused.frame);
+        if (Codec::DecodeResult_NeedMore == decoded.result)
+            decoded = Decode(codec, refused.frame.substr(decoded.consumed));
+        Expect(Codec::DecodeResult_Error == decoded.result && refused.closeCode == decoded.closeCode, std::string(refused.name) + " refused");
+    }
+}
+
+// Compressed messages go out with RSV1 and come back through another codec's inflater, which sees
+// the same sequence of messages a client would send with context takeover.
+void CheckDeflate() {
+    Codec server(1 << 20);
+    std::string response;
+    if (!Codec::IsDeflateAvailable()) {
+        Expect(!server.NegotiateDeflate("permessage-deflate", 0, 6, response), "no deflate without zlib");
+        return;
+    }
+    Expect(!server.NegotiateDeflate("x-webkit-deflate-frame", 0, 6, response), "unknown extension declined");
+    Expect(server.NegotiateDeflate("permessage-deflate; client_max_window_bits", 64, 6, response) && server.IsDeflateNegotiated(),
+           "permessage-deflate negotiated");
+    Codec client(1 << 20);
+    std::string ignored;
+    Expect(client.NegotiateDeflate("permessage-deflate", 0, 6, ignored), "second codec negotiated");
+
+    for (auto& message : { std::string(1000, 'a'), std::string("short"), std::string(5000, 'b') + "{\"id\":2}", std::string(1000, 'a') }) {
+        std::string frame;
+        server.EncodeMessage(message.data(), message.size(), frame);
+        bool compressed = message.size() >= 64;
+        Expect(compressed == (0 != (frame[0] & 0x40)), "message of " + std::to_string(message.size()) + " bytes compressed only over the threshold");
+        if (compressed)
+            Expect(frame.size() < message.size(), "compressed frame is smaller");
+        size_t header = static_cast<unsigned char>(frame[1]) < 126 ? 2 : 4;
+        std::string wire = Frame(frame[0] & 0x0f, frame.substr(header), true, frame[0] & 0x40);
+        Decoded decoded = Decode(client, wire);
+        Expect(Codec::DecodeResult_Message == decoded.result && message == decoded.payload, "compressed message of " + std::to_string(message.size()) + " bytes inflated");
+    }
+
+    Decoded decoded = Decode(client, Frame(Codec::Opcode_Text, "not deflate data", true, 0x40));
+    Expect(Codec::DecodeResult_Error == decoded.result && Codec::CloseCode_InvalidData == decoded.closeCode, "corrupt compressed message refused");
+
+    Codec sender(1 << 20);
+    Codec limited(100);
+    Expect(sender.NegotiateDeflate("permessage-deflate", 0, 6, ignored) && limited.NegotiateDeflate("permessage-deflate", 0, 6, ignored),
+           "fresh codecs negotiated");
+    std::string bomb(10000, 'z');
+    std::string frame;
+    sender.EncodeMessage(bomb.data(), bomb.size(), frame);
+    size_t header = static_cast<unsigned char>(frame[1]) < 126 ? 2 : 4;
+    decoded = Decode(limited, Frame(Codec::Opcode_Text, frame.substr(header), true, 0x40));
+    Expect(Codec::DecodeResult_Error == decoded.result && Codec::CloseCode_TooLarge == decoded.closeCode, "message inflating over the limit refused");
+}
+
+} // namespace
+
+int main() {
+    CheckAcceptKey();
+    CheckEncode();
+    CheckMessages();
+    CheckPartialInput();
+    CheckFragmentation();
+    CheckClose();
+    CheckRefused();
+    CheckDeflate();
+    std::printf("websocket codec (deflate %s): %s\n", Codec::IsDeflateAvailable() ? "on" : "off", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}